@@ -0,0 +1,1114 @@
+/*
+ * kvdb.c - 日志结构键值存储
+ *
+ * 扇区(KVDB_SECTOR_SIZE)布局: 16字节扇区头 + 顺序追加的记录.
+ *   扇区头: magic, 擦除次数, 扇区序号及其反码(全0xFF表示已格式化未使用)
+ *   记录头: state, magic, 记录序号, key长度, value长度, CRC32, 之后是key和value, 4字节对齐
+ *
+ * 记录状态只从1往0编程: ERASED -> WRITING -> VALID -> DELETED.
+ * 写入时整条记录以WRITING写下, 再把state编程为VALID, 最后把旧记录编程为DELETED.
+ * 挂载时只认VALID且CRC正确的记录; 同一个key有两条VALID时(掉电在删旧记录之前), 序号大的胜出.
+ *
+ * 扇区按环形顺序分配, 整理总是回收序号最小(最旧)的扇区: 把其中仍被索引引用的记录
+ * 搬到当前扇区, 再擦除并写回扇区头, 所有扇区的擦除次数因此保持一致.
+ * 搬移和擦除之间掉电只会留下重复记录, 同样靠序号去重.
+ *
+ * 开启FAL_USING_WRITE_BUFFER时分区经fal_wbuf访问: 擦除已是全0xFF的扇区直接跳过,
+ * 整理搬移的记录合并成整页编程, 在擦除旧扇区之前一次写下. 其余写入都立即编程,
+ * 保持上面的写入顺序.
+ */
+#include "kvdb.h"
+#include <string.h>
+
+#ifdef RT_USING_FAL
+#include <fal.h>
+#endif
+
+#ifndef KVDB_HOST
+#define DBG_TAG "kvdb"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+#endif
+
+#define KVDB_SEC_MAGIC          0x3153564BUL    /* "KVS1" */
+#define KVDB_REC_MAGIC          0x3152564BUL    /* "KVR1" */
+#define KVDB_SEC_HDR_SIZE       16
+#define KVDB_REC_HDR_SIZE       20
+
+#define KVDB_REC_ERASED         0xFFFFFFFFUL
+#define KVDB_REC_WRITING        0xFFFFFF00UL
+#define KVDB_REC_VALID          0xFFFF0000UL
+#define KVDB_REC_DELETED        0x00000000UL
+
+#define KVDB_SLOT_EMPTY         0xFFFFFFFFUL
+#define KVDB_SLOT_TOMB          0xFFFFFFFEUL
+#define KVDB_INDEX_MIN          64
+
+#define KVDB_GC_RESERVE         1       /* 留给整理搬移的空闲扇区, 普通写入不能占用 */
+#define KVDB_GC_THREAD_STACK    2048
+#define KVDB_GC_THREAD_PRIO     (RT_THREAD_PRIORITY_MAX - 5)
+
+enum {
+    KVDB_SEC_RAW = 0,                   /* 内容未知, 使用前要擦除 */
+    KVDB_SEC_FREE,                      /* 已擦除并写好扇区头 */
+    KVDB_SEC_USED
+};
+
+struct kvdb_sector {
+    uint32_t    seq;
+    uint32_t    erase_cnt;
+    uint16_t    used;                   /* 下一条记录的扇区内偏移 */
+    uint8_t     state;
+};
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    erase_cnt;
+    uint32_t    seq;
+    uint32_t    seq_inv;                /* ~seq, 不一致说明序号写到一半 */
+} kvdb_sec_hdr_t;
+
+typedef struct {
+    uint32_t    state;
+    uint32_t    magic;
+    uint32_t    seq;
+    uint16_t    key_len;
+    uint16_t    val_len;
+    uint32_t    crc;                    /* seq, key_len, val_len, key, value */
+} kvdb_rec_t;
+
+static kvdb_t g_kvdb;
+static rt_bool_t g_kvdb_mounted = RT_FALSE;
+
+/* ==================== 闪存访问 ==================== */
+
+static int kvdb_flash_read(kvdb_t *db, uint32_t addr, void *buf, size_t size)
+{
+    if (db->ram)
+    {
+        rt_memcpy(buf, db->ram + addr, size);
+        return 0;
+    }
+#ifdef FAL_USING_WRITE_BUFFER
+    if (db->wbuf)
+        return fal_wbuf_read(db->wbuf, addr, buf, size) < 0 ? -1 : 0;
+#endif
+#ifdef RT_USING_FAL
+    return fal_partition_read(db->part, addr, buf, size) < 0 ? -1 : 0;
+#else
+    return -1;
+#endif
+}
+
+/* 把写缓冲里的数据编程到闪存 */
+static int kvdb_flash_sync(kvdb_t *db)
+{
+#ifdef FAL_USING_WRITE_BUFFER
+    if (db->wbuf)
+        return fal_wbuf_flush(db->wbuf) < 0 ? -1 : 0;
+#endif
+    return 0;
+}
+
+static int kvdb_flash_write(kvdb_t *db, uint32_t addr, const void *buf, size_t size)
+{
+    if (db->ram)
+    {
+        const uint8_t *src = buf;
+        size_t i, n = size;
+        int ret = 0;
+
+        /* 模拟掉电: 预算用完后的字节不再编程 */
+        if (db->ram_budget >= 0)
+        {
+            if (n > (size_t)db->ram_budget)
+            {
+                n = db->ram_budget;
+                ret = -1;
+            }
+            db->ram_budget -= n;
+        }
+        /* NOR只能把1编程为0 */
+        for (i = 0; i < n; i++)
+            db->ram[addr + i] &= src[i];
+        return ret;
+    }
+#ifdef FAL_USING_WRITE_BUFFER
+    if (db->wbuf)
+    {
+        if (fal_wbuf_write(db->wbuf, addr, buf, size) < 0)
+            return -1;
+        return db->wbuf_hold ? 0 : kvdb_flash_sync(db);
+    }
+#endif
+#ifdef RT_USING_FAL
+    return fal_partition_write(db->part, addr, buf, size) < 0 ? -1 : 0;
+#else
+    return -1;
+#endif
+}
+
+static int kvdb_flash_erase(kvdb_t *db, uint32_t addr, size_t size)
+{
+    if (db->ram)
+    {
+        if (db->ram_budget >= 0 && (size_t)db->ram_budget < size)
+        {
+            /* 擦除到一半掉电 */
+            rt_memset(db->ram + addr, 0xFF, size / 2);
+            db->ram_budget = 0;
+            return -1;
+        }
+        if (db->ram_budget >= 0)
+            db->ram_budget -= size;
+        rt_memset(db->ram + addr, 0xFF, size);
+        return 0;
+    }
+#ifdef FAL_USING_WRITE_BUFFER
+    if (db->wbuf)
+        return fal_wbuf_erase(db->wbuf, addr, size) < 0 ? -1 : 0;
+#endif
+#ifdef RT_USING_FAL
+    return fal_partition_erase(db->part, addr, size) < 0 ? -1 : 0;
+#else
+    return -1;
+#endif
+}
+
+/* ==================== 工具函数 ==================== */
+
+static uint32_t kvdb_crc32(uint32_t crc, const uint8_t *p, size_t len)
+{
+    static const uint32_t tab[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ tab[crc & 0x0F];
+        crc = (crc >> 4) ^ tab[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static uint32_t kvdb_rec_crc(const kvdb_rec_t *rec, const uint8_t *data)
+{
+    uint32_t crc = kvdb_crc32(0, (const uint8_t *)&rec->seq, 8);
+    return kvdb_crc32(crc, data, rec->key_len + rec->val_len);
+}
+
+/* FNV-1a */
+static uint32_t kvdb_hash(const char *key, size_t len)
+{
+    uint32_t h = 2166136261UL;
+
+    while (len--)
+    {
+        h ^= (uint8_t)*key++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+static uint32_t kvdb_rec_size(uint32_t key_len, uint32_t val_len)
+{
+    return RT_ALIGN(KVDB_REC_HDR_SIZE + key_len + val_len, 4);
+}
+
+static uint32_t kvdb_sector_addr(uint16_t sector)
+{
+    return (uint32_t)sector * KVDB_SECTOR_SIZE;
+}
+
+/* ==================== 哈希索引 ==================== */
+
+static rt_err_t kvdb_index_alloc(kvdb_t *db, uint32_t cap)
+{
+    kvdb_slot_t *old = db->index;
+    uint32_t old_cap = old ? db->index_mask + 1 : 0;
+    uint32_t i, j;
+
+    db->index = rt_malloc(cap * sizeof(kvdb_slot_t));
+    if (db->index == RT_NULL)
+    {
+        db->index = old;
+        return -RT_ENOMEM;
+    }
+    rt_memset(db->index, 0xFF, cap * sizeof(kvdb_slot_t));
+    db->index_mask = cap - 1;
+    db->index_used = 0;
+
+    for (i = 0; i < old_cap; i++)
+    {
+        if (old[i].addr == KVDB_SLOT_EMPTY || old[i].addr == KVDB_SLOT_TOMB)
+            continue;
+        j = old[i].hash & db->index_mask;
+        while (db->index[j].addr != KVDB_SLOT_EMPTY)
+            j = (j + 1) & db->index_mask;
+        db->index[j] = old[i];
+        db->index_used++;
+    }
+    rt_free(old);
+    return RT_EOK;
+}
+
+/* 保证还能再插入一个key, 负载(含墓碑)不超过3/4 */
+static rt_err_t kvdb_index_reserve(kvdb_t *db)
+{
+    uint32_t cap = KVDB_INDEX_MIN;
+
+    if ((db->index_used + 1) * 4 <= (db->index_mask + 1) * 3)
+        return RT_EOK;
+
+    while (cap < (db->keys + 1) * 2)
+        cap <<= 1;
+    return kvdb_index_alloc(db, cap);
+}
+
+static kvdb_slot_t *kvdb_index_find(kvdb_t *db, const char *key, uint16_t key_len,
+                                    uint32_t hash, kvdb_rec_t *rec)
+{
+    uint8_t tmp[KVDB_REC_HDR_SIZE + KVDB_KEY_MAX];
+    uint32_t i = hash & db->index_mask;
+    kvdb_slot_t *slot;
+    size_t n;
+
+    for (;;)
+    {
+        slot = &db->index[i];
+        if (slot->addr == KVDB_SLOT_EMPTY)
+            return RT_NULL;
+
+        if (slot->addr != KVDB_SLOT_TOMB && slot->hash == hash)
+        {
+            n = KVDB_REC_HDR_SIZE + key_len;
+            if (n > db->size - slot->addr)
+                n = db->size - slot->addr;
+            if (kvdb_flash_read(db, slot->addr, tmp, n) == 0)
+            {
+                rt_memcpy(rec, tmp, sizeof(kvdb_rec_t));
+                if (rec->key_len == key_len &&
+                    rt_memcmp(tmp + KVDB_REC_HDR_SIZE, key, key_len) == 0)
+                {
+                    return slot;
+                }
+            }
+        }
+        i = (i + 1) & db->index_mask;
+    }
+}
+
+static kvdb_slot_t *kvdb_index_find_addr(kvdb_t *db, uint32_t hash, uint32_t addr)
+{
+    uint32_t i = hash & db->index_mask;
+
+    while (db->index[i].addr != KVDB_SLOT_EMPTY)
+    {
+        if (db->index[i].addr == addr)
+            return &db->index[i];
+        i = (i + 1) & db->index_mask;
+    }
+    return RT_NULL;
+}
+
+/* 调用前已kvdb_index_reserve */
+static void kvdb_index_put(kvdb_t *db, uint32_t hash, uint32_t addr)
+{
+    uint32_t i = hash & db->index_mask;
+
+    while (db->index[i].addr != KVDB_SLOT_EMPTY && db->index[i].addr != KVDB_SLOT_TOMB)
+        i = (i + 1) & db->index_mask;
+
+    if (db->index[i].addr == KVDB_SLOT_EMPTY)
+        db->index_used++;
+    db->index[i].hash = hash;
+    db->index[i].addr = addr;
+    db->keys++;
+}
+
+/* ==================== 扇区与追加写 ==================== */
+
+static int kvdb_rec_mark(kvdb_t *db, uint32_t addr, uint32_t state)
+{
+    return kvdb_flash_write(db, addr, &state, sizeof(state));
+}
+
+/* 擦除并写扇区头, 之后为FREE */
+static rt_err_t kvdb_sector_format(kvdb_t *db, uint16_t sector)
+{
+    kvdb_sector_t *s = &db->sectors[sector];
+    kvdb_sec_hdr_t hdr;
+    uint8_t was_free = (s->state != KVDB_SEC_USED);
+
+    /* 先改RAM状态, 失败时这个扇区按RAW处理, 下次分配重新擦除 */
+    s->state = KVDB_SEC_RAW;
+    s->erase_cnt++;
+    if (!was_free)
+        db->free_num++;
+
+    if (kvdb_flash_erase(db, kvdb_sector_addr(sector), KVDB_SECTOR_SIZE) != 0)
+        return -RT_EIO;
+
+    hdr.magic = KVDB_SEC_MAGIC;
+    hdr.erase_cnt = s->erase_cnt;
+    hdr.seq = 0xFFFFFFFFUL;
+    hdr.seq_inv = 0xFFFFFFFFUL;
+    if (kvdb_flash_write(db, kvdb_sector_addr(sector), &hdr, sizeof(hdr)) != 0)
+        return -RT_EIO;
+
+    s->state = KVDB_SEC_FREE;
+    s->used = KVDB_SEC_HDR_SIZE;
+    s->seq = 0xFFFFFFFFUL;
+    return RT_EOK;
+}
+
+/* 环形顺序取下一个空闲扇区作为当前扇区 */
+static rt_err_t kvdb_sector_open(kvdb_t *db)
+{
+    uint32_t seq[2] = { db->sector_seq + 1, ~(db->sector_seq + 1) };
+    uint16_t n, i = 0;
+    kvdb_sector_t *s;
+
+    for (n = 1; n <= db->sector_num; n++)
+    {
+        i = (db->head + n) % db->sector_num;
+        if (db->sectors[i].state != KVDB_SEC_USED)
+            break;
+    }
+    if (n > db->sector_num)
+        return -RT_EFULL;
+
+    s = &db->sectors[i];
+    if (s->state == KVDB_SEC_RAW && kvdb_sector_format(db, i) != RT_EOK)
+        return -RT_EIO;
+
+    if (kvdb_flash_write(db, kvdb_sector_addr(i) + 8, seq, sizeof(seq)) != 0)
+    {
+        s->state = KVDB_SEC_RAW;
+        return -RT_EIO;
+    }
+    db->sector_seq = seq[0];
+    s->seq = seq[0];
+    s->state = KVDB_SEC_USED;
+    s->used = KVDB_SEC_HDR_SIZE;
+    db->head = i;
+    db->free_num--;
+    return RT_EOK;
+}
+
+/* rec以WRITING状态整条写入, 再编程为VALID */
+static rt_err_t kvdb_append(kvdb_t *db, const uint8_t *rec, uint32_t size,
+                            rt_bool_t gc, uint32_t *addr)
+{
+    kvdb_sector_t *s = &db->sectors[db->head];
+    rt_err_t ret;
+
+    if (s->state != KVDB_SEC_USED || s->used + size > KVDB_SECTOR_SIZE)
+    {
+        if (!gc && db->free_num <= KVDB_GC_RESERVE)
+            return -RT_EFULL;
+        ret = kvdb_sector_open(db);
+        if (ret != RT_EOK)
+            return ret;
+        s = &db->sectors[db->head];
+    }
+
+    *addr = kvdb_sector_addr(db->head) + s->used;
+    /* 写失败的这段空间也不再复用 */
+    s->used += size;
+    if (kvdb_flash_write(db, *addr, rec, size) != 0 ||
+        kvdb_rec_mark(db, *addr, KVDB_REC_VALID) != 0)
+    {
+        return -RT_EIO;
+    }
+    return RT_EOK;
+}
+
+/* 回收最旧的扇区 */
+static rt_err_t kvdb_gc_one(kvdb_t *db)
+{
+    kvdb_rec_t *rec;
+    kvdb_slot_t *slot;
+    uint32_t base, off, size, addr;
+    int victim = -1;
+    uint16_t i;
+    rt_err_t ret = RT_EOK;
+
+    for (i = 0; i < db->sector_num; i++)
+    {
+        if (db->sectors[i].state == KVDB_SEC_USED && i != db->head &&
+            (victim < 0 || db->sectors[i].seq < db->sectors[victim].seq))
+        {
+            victim = i;
+        }
+    }
+    if (victim < 0)
+        return -RT_EFULL;
+
+    base = kvdb_sector_addr(victim);
+    if (kvdb_flash_read(db, base, db->buf, KVDB_SECTOR_SIZE) != 0)
+        return -RT_EIO;
+
+    /* 旧记录在擦除前一直有效, 搬移的副本可以攒成整页再写 */
+    db->wbuf_hold = RT_TRUE;
+
+    for (off = KVDB_SEC_HDR_SIZE; off + KVDB_REC_HDR_SIZE <= db->sectors[victim].used; off += size)
+    {
+        rec = (kvdb_rec_t *)(db->buf + off);
+        if (rec->state == KVDB_REC_ERASED || rec->magic != KVDB_REC_MAGIC)
+            break;
+        size = kvdb_rec_size(rec->key_len, rec->val_len);
+        if (rec->state != KVDB_REC_VALID)
+            continue;
+
+        /* 只搬索引仍指向这里的记录 */
+        slot = kvdb_index_find_addr(db, kvdb_hash((const char *)(rec + 1), rec->key_len), base + off);
+        if (slot == RT_NULL)
+            continue;
+
+        rec->state = KVDB_REC_WRITING;
+        rec->seq = ++db->rec_seq;
+        rec->crc = kvdb_rec_crc(rec, (const uint8_t *)(rec + 1));
+        ret = kvdb_append(db, (const uint8_t *)rec, size, RT_TRUE, &addr);
+        if (ret != RT_EOK)
+            break;
+        slot->addr = addr;
+    }
+
+    db->wbuf_hold = RT_FALSE;
+    if (kvdb_flash_sync(db) != 0)
+        return -RT_EIO;
+    if (ret != RT_EOK)
+        return ret;
+
+    db->gc_runs++;
+    return kvdb_sector_format(db, victim);
+}
+
+/* 为size字节的新记录腾出空间 */
+static rt_err_t kvdb_reserve(kvdb_t *db, uint32_t size)
+{
+    kvdb_sector_t *s;
+    uint16_t tries;
+    rt_err_t ret;
+
+    for (tries = 0; tries <= db->sector_num; tries++)
+    {
+        s = &db->sectors[db->head];
+        if (s->state == KVDB_SEC_USED && s->used + size <= KVDB_SECTOR_SIZE)
+            return RT_EOK;
+        if (db->free_num > KVDB_GC_RESERVE)
+            return RT_EOK;
+
+        ret = kvdb_gc_one(db);
+        if (ret != RT_EOK)
+            return ret;
+    }
+    return -RT_EFULL;
+}
+
+/* ==================== 挂载 ==================== */
+
+static void kvdb_load_record(kvdb_t *db, uint32_t addr, const kvdb_rec_t *rec)
+{
+    const char *key = (const char *)(rec + 1);
+    uint32_t hash = kvdb_hash(key, rec->key_len);
+    kvdb_slot_t *slot;
+    kvdb_rec_t old;
+
+    if (kvdb_index_reserve(db) != RT_EOK)
+        return;
+
+    slot = kvdb_index_find(db, key, rec->key_len, hash, &old);
+    if (slot == RT_NULL)
+    {
+        kvdb_index_put(db, hash, addr);
+        return;
+    }
+
+    /* 上次掉电在删除旧记录之前, 保留序号大的 */
+    if (old.seq > rec->seq)
+    {
+        kvdb_rec_mark(db, addr, KVDB_REC_DELETED);
+    }
+    else
+    {
+        kvdb_rec_mark(db, slot->addr, KVDB_REC_DELETED);
+        slot->addr = addr;
+    }
+}
+
+static void kvdb_scan_sector(kvdb_t *db, uint16_t sector)
+{
+    uint32_t base = kvdb_sector_addr(sector);
+    uint32_t off, size;
+    kvdb_rec_t *rec;
+
+    if (kvdb_flash_read(db, base, db->buf, KVDB_SECTOR_SIZE) != 0)
+    {
+        db->sectors[sector].used = KVDB_SECTOR_SIZE;
+        return;
+    }
+
+    for (off = KVDB_SEC_HDR_SIZE; off + KVDB_REC_HDR_SIZE <= KVDB_SECTOR_SIZE; off += size)
+    {
+        rec = (kvdb_rec_t *)(db->buf + off);
+        if (rec->state == KVDB_REC_ERASED)
+            break;
+
+        size = kvdb_rec_size(rec->key_len, rec->val_len);
+        if (rec->magic != KVDB_REC_MAGIC || rec->key_len == 0 || rec->key_len > KVDB_KEY_MAX ||
+            size > KVDB_SECTOR_SIZE - off)
+        {
+            /* 写到一半的记录头, 长度不可信, 这个扇区不再追加 */
+            off = KVDB_SECTOR_SIZE;
+            break;
+        }
+
+        if (rec->state == KVDB_REC_VALID && rec->crc == kvdb_rec_crc(rec, (const uint8_t *)(rec + 1)))
+        {
+            if (rec->seq > db->rec_seq)
+                db->rec_seq = rec->seq;
+            kvdb_load_record(db, base + off, rec);
+        }
+    }
+    db->sectors[sector].used = off;
+}
+
+static rt_err_t kvdb_mount(kvdb_t *db)
+{
+    rt_tick_t start = rt_tick_get_millisecond();
+    kvdb_sec_hdr_t hdr;
+    kvdb_sector_t *s;
+    int head = -1;
+    uint16_t i;
+
+    db->keys = 0;
+    db->free_num = 0;
+    db->sector_seq = 0;
+    db->rec_seq = 0;
+    rt_free(db->index);
+    db->index = RT_NULL;
+    if (kvdb_index_alloc(db, KVDB_INDEX_MIN) != RT_EOK)
+        return -RT_ENOMEM;
+
+    /* 先读全部扇区头找出当前扇区, 再扫描记录 */
+    for (i = 0; i < db->sector_num; i++)
+    {
+        s = &db->sectors[i];
+        rt_memset(s, 0, sizeof(*s));
+        s->used = KVDB_SEC_HDR_SIZE;
+        if (kvdb_flash_read(db, kvdb_sector_addr(i), &hdr, sizeof(hdr)) != 0 ||
+            hdr.magic != KVDB_SEC_MAGIC)
+        {
+            s->state = KVDB_SEC_RAW;
+            db->free_num++;
+            continue;
+        }
+        s->erase_cnt = hdr.erase_cnt;
+        s->seq = hdr.seq;
+        if (hdr.seq != ~hdr.seq_inv)
+        {
+            /* 全0xFF是格式化后未用, 否则是写序号时掉电, 扇区里还没有记录 */
+            s->state = (hdr.seq == 0xFFFFFFFFUL && hdr.seq_inv == 0xFFFFFFFFUL) ?
+                       KVDB_SEC_FREE : KVDB_SEC_RAW;
+            db->free_num++;
+            continue;
+        }
+        s->state = KVDB_SEC_USED;
+        if (head < 0 || hdr.seq > db->sector_seq)
+        {
+            head = i;
+            db->sector_seq = hdr.seq;
+        }
+    }
+
+    for (i = 0; i < db->sector_num; i++)
+    {
+        if (db->sectors[i].state == KVDB_SEC_USED)
+            kvdb_scan_sector(db, i);
+    }
+
+    /* 空库时从0号扇区开始 */
+    db->head = head >= 0 ? head : db->sector_num - 1;
+    db->mount_ms = rt_tick_get_millisecond() - start;
+    return RT_EOK;
+}
+
+/* ==================== 后台整理 ==================== */
+
+static void kvdb_gc_entry(void *parameter)
+{
+    kvdb_t *db = parameter;
+    uint16_t before;
+    rt_err_t ret;
+
+    while (db->running)
+    {
+        rt_sem_take(&db->gc_wake, RT_WAITING_FOREVER);
+
+        while (db->running)
+        {
+            rt_mutex_take(&db->lock, RT_WAITING_FOREVER);
+            if (db->free_num >= KVDB_GC_FREE_SECTORS)
+            {
+                rt_mutex_release(&db->lock);
+                break;
+            }
+            before = db->free_num;
+            ret = kvdb_gc_one(db);
+            rt_mutex_release(&db->lock);
+
+            /* 最旧的扇区全是有效记录时回收不出空间, 等下次写入再试 */
+            if (ret != RT_EOK || db->free_num <= before)
+                break;
+        }
+    }
+
+    db->gc_thread = RT_NULL;
+}
+
+/* ==================== 接口 ==================== */
+
+static rt_err_t kvdb_setup(kvdb_t *db, const char *name, uint32_t size)
+{
+    rt_err_t ret;
+
+    rt_strncpy(db->name, name, RT_NAME_MAX - 1);
+    db->size = size - size % KVDB_SECTOR_SIZE;
+    db->sector_num = db->size / KVDB_SECTOR_SIZE;
+    if (db->sector_num < KVDB_GC_RESERVE + 2)
+    {
+        LOG_E("%s: %u bytes is too small", name, size);
+        return -RT_EINVAL;
+    }
+
+    db->sectors = rt_calloc(db->sector_num, sizeof(kvdb_sector_t));
+    db->buf = rt_malloc(KVDB_SECTOR_SIZE);
+    if (db->sectors == RT_NULL || db->buf == RT_NULL)
+    {
+        ret = -RT_ENOMEM;
+        goto __fail;
+    }
+
+    ret = kvdb_mount(db);
+    if (ret != RT_EOK)
+        goto __fail;
+
+    rt_mutex_init(&db->lock, name, RT_IPC_FLAG_PRIO);
+    rt_sem_init(&db->gc_wake, name, 0, RT_IPC_FLAG_PRIO);
+    db->running = RT_TRUE;
+    db->gc_thread = rt_thread_create("kvdb_gc", kvdb_gc_entry, db,
+                                     KVDB_GC_THREAD_STACK, KVDB_GC_THREAD_PRIO, 10);
+    if (db->gc_thread)
+        rt_thread_startup(db->gc_thread);
+    else
+        db->running = RT_FALSE;
+
+    LOG_I("%s: %u keys, %u/%u sectors free, mounted in %u ms", name, db->keys,
+          db->free_num, db->sector_num, db->mount_ms);
+    return RT_EOK;
+
+__fail:
+    rt_free(db->index);
+    rt_free(db->buf);
+    rt_free(db->sectors);
+    db->index = RT_NULL;
+    db->buf = RT_NULL;
+    db->sectors = RT_NULL;
+    return ret;
+}
+
+rt_err_t kvdb_init(kvdb_t *db, const char *part_name)
+{
+#ifdef RT_USING_FAL
+    const struct fal_partition *part;
+    const struct fal_flash_dev *flash;
+    rt_err_t ret;
+
+    rt_memset(db, 0, sizeof(*db));
+    db->ram_budget = -1;
+
+    part = fal_partition_find(part_name);
+    if (part == RT_NULL)
+    {
+        LOG_E("partition %s not found", part_name);
+        return -RT_ENOENT;
+    }
+    flash = fal_flash_device_find(part->flash_name);
+    if (flash == RT_NULL || flash->blk_size == 0 || KVDB_SECTOR_SIZE % flash->blk_size != 0 ||
+        part->offset % flash->blk_size != 0)
+    {
+        LOG_E("%s: erase block does not fit a %d byte sector", part_name, KVDB_SECTOR_SIZE);
+        return -RT_EINVAL;
+    }
+    db->part = part;
+#ifdef FAL_USING_WRITE_BUFFER
+    /* 打不开就直接访问分区 */
+    db->wbuf = fal_wbuf_open(part, 0);
+#endif
+    ret = kvdb_setup(db, part_name, part->len);
+#ifdef FAL_USING_WRITE_BUFFER
+    if (ret != RT_EOK && db->wbuf)
+    {
+        fal_wbuf_close(db->wbuf);
+        db->wbuf = RT_NULL;
+    }
+#endif
+    return ret;
+#else
+    return -RT_ENOSYS;
+#endif
+}
+
+rt_err_t kvdb_init_ram(kvdb_t *db, const char *name, void *mem, uint32_t size)
+{
+    rt_memset(db, 0, sizeof(*db));
+    db->ram_budget = -1;
+    db->ram = mem;
+    return kvdb_setup(db, name, size);
+}
+
+void kvdb_deinit(kvdb_t *db)
+{
+    if (db->sectors == RT_NULL)
+        return;
+
+    if (db->gc_thread)
+    {
+        db->running = RT_FALSE;
+        rt_sem_release(&db->gc_wake);
+        /* 线程收尾时清空gc_thread */
+        while (db->gc_thread != RT_NULL)
+            rt_thread_mdelay(10);
+    }
+    rt_sem_detach(&db->gc_wake);
+    rt_mutex_detach(&db->lock);
+#ifdef FAL_USING_WRITE_BUFFER
+    if (db->wbuf)
+    {
+        fal_wbuf_close(db->wbuf);
+        db->wbuf = RT_NULL;
+    }
+#endif
+
+    rt_free(db->index);
+    rt_free(db->buf);
+    rt_free(db->sectors);
+    db->index = RT_NULL;
+    db->buf = RT_NULL;
+    db->sectors = RT_NULL;
+}
+
+rt_err_t kvdb_remount(kvdb_t *db)
+{
+    rt_err_t ret;
+
+    rt_mutex_take(&db->lock, RT_WAITING_FOREVER);
+    ret = kvdb_mount(db);
+    rt_mutex_release(&db->lock);
+    return ret;
+}
+
+int kvdb_get(kvdb_t *db, const char *key, void *buf, size_t size)
+{
+    size_t key_len = rt_strlen(key);
+    kvdb_slot_t *slot;
+    kvdb_rec_t rec;
+    int ret;
+
+    if (key_len == 0 || key_len > KVDB_KEY_MAX)
+        return -RT_EINVAL;
+
+    rt_mutex_take(&db->lock, RT_WAITING_FOREVER);
+    slot = kvdb_index_find(db, key, key_len, kvdb_hash(key, key_len), &rec);
+    if (slot == RT_NULL)
+    {
+        ret = -RT_ENOENT;
+    }
+    else
+    {
+        if (size > rec.val_len)
+            size = rec.val_len;
+        ret = rec.val_len;
+        if (size && kvdb_flash_read(db, slot->addr + KVDB_REC_HDR_SIZE + key_len, buf, size) != 0)
+            ret = -RT_EIO;
+    }
+    rt_mutex_release(&db->lock);
+    return ret;
+}
+
+rt_err_t kvdb_set(kvdb_t *db, const char *key, const void *value, size_t len)
+{
+    size_t key_len = rt_strlen(key);
+    uint32_t hash, size, addr;
+    kvdb_rec_t *rec, old;
+    kvdb_slot_t *slot;
+    rt_err_t ret;
+
+    if (key_len == 0 || key_len > KVDB_KEY_MAX || len > KVDB_VALUE_MAX)
+        return -RT_EINVAL;
+
+    hash = kvdb_hash(key, key_len);
+    size = kvdb_rec_size(key_len, len);
+
+    rt_mutex_take(&db->lock, RT_WAITING_FOREVER);
+    ret = kvdb_reserve(db, size);
+    if (ret == RT_EOK)
+        ret = kvdb_index_reserve(db);
+    if (ret != RT_EOK)
+        goto __exit;
+
+    /* 整理可能搬动了记录, 之后再查 */
+    slot = kvdb_index_find(db, key, key_len, hash, &old);
+    if (slot && old.val_len == len)
+    {
+        /* 值没变就不写, 减少磨损 */
+        if (len == 0 || (kvdb_flash_read(db, slot->addr + KVDB_REC_HDR_SIZE + key_len, db->buf, len) == 0 &&
+                         rt_memcmp(db->buf, value, len) == 0))
+        {
+            goto __exit;
+        }
+    }
+
+    rt_memset(db->buf, 0xFF, size);
+    rec = (kvdb_rec_t *)db->buf;
+    rec->state = KVDB_REC_WRITING;
+    rec->magic = KVDB_REC_MAGIC;
+    rec->seq = ++db->rec_seq;
+    rec->key_len = key_len;
+    rec->val_len = len;
+    rt_memcpy(rec + 1, key, key_len);
+    rt_memcpy((uint8_t *)(rec + 1) + key_len, value, len);
+    rec->crc = kvdb_rec_crc(rec, (const uint8_t *)(rec + 1));
+
+    ret = kvdb_append(db, db->buf, size, RT_FALSE, &addr);
+    if (ret != RT_EOK)
+        goto __exit;
+
+    if (slot)
+    {
+        kvdb_rec_mark(db, slot->addr, KVDB_REC_DELETED);
+        slot->addr = addr;
+    }
+    else
+    {
+        kvdb_index_put(db, hash, addr);
+    }
+
+__exit:
+    if (db->free_num < KVDB_GC_FREE_SECTORS && db->gc_thread)
+        rt_sem_release(&db->gc_wake);
+    rt_mutex_release(&db->lock);
+    return ret;
+}
+
+rt_err_t kvdb_del(kvdb_t *db, const char *key)
+{
+    size_t key_len = rt_strlen(key);
+    kvdb_slot_t *slot;
+    kvdb_rec_t rec;
+    rt_err_t ret = RT_EOK;
+
+    if (key_len == 0 || key_len > KVDB_KEY_MAX)
+        return -RT_EINVAL;
+
+    rt_mutex_take(&db->lock, RT_WAITING_FOREVER);
+    slot = kvdb_index_find(db, key, key_len, kvdb_hash(key, key_len), &rec);
+    if (slot == RT_NULL)
+    {
+        ret = -RT_ENOENT;
+    }
+    else if (kvdb_rec_mark(db, slot->addr, KVDB_REC_DELETED) != 0)
+    {
+        ret = -RT_EIO;
+    }
+    else
+    {
+        slot->addr = KVDB_SLOT_TOMB;
+        db->keys--;
+    }
+    rt_mutex_release(&db->lock);
+    return ret;
+}
+
+/* 回调在锁内执行, 不能再访问同一个实例 */
+void kvdb_foreach(kvdb_t *db, kvdb_iter_t iter, void *arg)
+{
+    char key[KVDB_KEY_MAX + 1];
+    kvdb_rec_t *rec;
+    uint32_t i;
+
+    rt_mutex_take(&db->lock, RT_WAITING_FOREVER);
+    for (i = 0; i <= db->index_mask; i++)
+    {
+        if (db->index[i].addr == KVDB_SLOT_EMPTY || db->index[i].addr == KVDB_SLOT_TOMB)
+            continue;
+        rec = (kvdb_rec_t *)db->buf;
+        if (kvdb_flash_read(db, db->index[i].addr, rec, KVDB_REC_HDR_SIZE) != 0 ||
+            kvdb_flash_read(db, db->index[i].addr + KVDB_REC_HDR_SIZE, rec + 1,
+                            rec->key_len + rec->val_len) != 0)
+        {
+            continue;
+        }
+        rt_memcpy(key, rec + 1, rec->key_len);
+        key[rec->key_len] = '\0';
+        if (iter(key, (uint8_t *)(rec + 1) + rec->key_len, rec->val_len, arg) != 0)
+            break;
+    }
+    rt_mutex_release(&db->lock);
+}
+
+rt_err_t kvdb_gc(kvdb_t *db)
+{
+    rt_err_t ret;
+
+    rt_mutex_take(&db->lock, RT_WAITING_FOREVER);
+    ret = kvdb_gc_one(db);
+    rt_mutex_release(&db->lock);
+    return ret;
+}
+
+void kvdb_get_stats(kvdb_t *db, kvdb_stats_t *stats)
+{
+    uint16_t i;
+
+    rt_memset(stats, 0, sizeof(*stats));
+    rt_mutex_take(&db->lock, RT_WAITING_FOREVER);
+    stats->keys = db->keys;
+    stats->sectors = db->sector_num;
+    stats->free_sectors = db->free_num;
+    stats->erase_min = 0xFFFFFFFFUL;
+    for (i = 0; i < db->sector_num; i++)
+    {
+        if (db->sectors[i].erase_cnt < stats->erase_min)
+            stats->erase_min = db->sectors[i].erase_cnt;
+        if (db->sectors[i].erase_cnt > stats->erase_max)
+            stats->erase_max = db->sectors[i].erase_cnt;
+    }
+    stats->gc_runs = db->gc_runs;
+    stats->mount_ms = db->mount_ms;
+    stats->index_size = db->index_mask + 1;
+    rt_mutex_release(&db->lock);
+}
+
+kvdb_t *kvdb_default(void)
+{
+    return g_kvdb_mounted ? &g_kvdb : RT_NULL;
+}
+
+int kvdb_get_str(const char *key, char *buf, size_t size)
+{
+    int len;
+
+    if (size == 0)
+        return -RT_EINVAL;
+    buf[0] = '\0';
+    if (!g_kvdb_mounted)
+        return -RT_ENOENT;
+
+    len = kvdb_get(&g_kvdb, key, buf, size - 1);
+    if (len < 0)
+        return len;
+    buf[(size_t)len < size - 1 ? (size_t)len : size - 1] = '\0';
+    return len;
+}
+
+rt_err_t kvdb_set_str(const char *key, const char *value)
+{
+    if (!g_kvdb_mounted)
+        return -RT_ENOENT;
+    return kvdb_set(&g_kvdb, key, value, rt_strlen(value));
+}
+
+#ifdef RT_USING_FAL
+/* fal_init在INIT_ENV阶段完成 */
+static int kvdb_default_init(void)
+{
+    if (kvdb_init(&g_kvdb, KVDB_PART_NAME) == RT_EOK)
+        g_kvdb_mounted = RT_TRUE;
+    return 0;
+}
+INIT_APP_EXPORT(kvdb_default_init);
+#endif
+
+/* ==================== MSH命令 ==================== */
+
+#ifdef RT_USING_FINSH
+static int kvdb_print(const char *key, const void *value, uint16_t len, void *arg)
+{
+    const uint8_t *p = value;
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        if (p[i] < 0x20 || p[i] > 0x7E)
+            break;
+    }
+    if (i == len)
+        rt_kprintf("%-24s = %.*s\n", key, len, (const char *)value);
+    else
+        rt_kprintf("%-24s = <%u bytes>\n", key, len);
+    return 0;
+}
+
+static void kv(int argc, char **argv)
+{
+    kvdb_t *db = kvdb_default();
+    kvdb_stats_t stats;
+    char buf[128];
+    int len;
+
+    if (db == RT_NULL)
+    {
+        rt_kprintf("kvdb is not mounted\n");
+        return;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "set") == 0)
+    {
+        if (kvdb_set_str(argv[2], argv[3]) != RT_EOK)
+            rt_kprintf("set failed\n");
+    }
+    else if (argc == 3 && strcmp(argv[1], "get") == 0)
+    {
+        len = kvdb_get_str(argv[2], buf, sizeof(buf));
+        if (len < 0)
+            rt_kprintf("%s not found\n", argv[2]);
+        else
+            kvdb_print(argv[2], buf, rt_strlen(buf), RT_NULL);
+    }
+    else if (argc == 3 && strcmp(argv[1], "del") == 0)
+    {
+        if (kvdb_del(db, argv[2]) != RT_EOK)
+            rt_kprintf("%s not found\n", argv[2]);
+    }
+    else if (argc == 2 && strcmp(argv[1], "list") == 0)
+    {
+        kvdb_foreach(db, kvdb_print, RT_NULL);
+    }
+    else if (argc == 2 && strcmp(argv[1], "gc") == 0)
+    {
+        if (kvdb_gc(db) != RT_EOK)
+            rt_kprintf("gc failed\n");
+    }
+    else if (argc == 2 && strcmp(argv[1], "info") == 0)
+    {
+        kvdb_get_stats(db, &stats);
+        rt_kprintf("%s: %u keys, index %u slots\n", db->name, stats.keys, stats.index_size);
+        rt_kprintf("sectors %u, free %u, erase count %u..%u, gc runs %u, mount %u ms\n",
+                   stats.sectors, stats.free_sectors, stats.erase_min, stats.erase_max,
+                   stats.gc_runs, stats.mount_ms);
+    }
+    else
+    {
+        rt_kprintf("Usage: kv set <key> <value>\n");
+        rt_kprintf("       kv get|del <key>\n");
+        rt_kprintf("       kv list|info|gc\n");
+    }
+}
+MSH_CMD_EXPORT(kv, key-value store: kv set|get|del|list|info|gc);
+#endif /* RT_USING_FINSH */
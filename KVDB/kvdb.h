@@ -0,0 +1,196 @@
+/*
+ * kvdb.h - 日志结构键值存储(FAL分区, 默认 "easyflash")
+ *
+ * 记录只追加写, 扇区按顺序轮转使用(磨损均衡), 旧扇区由后台线程整理回收.
+ * 挂载时扫描全部记录, 在RAM里重建开放寻址哈希索引, 查找一次哈希 + 一次闪存读.
+ * 每条记录先以WRITING状态写入(带CRC32), 再单独编程为VALID, 掉电不会留下半条记录.
+ *
+ * 也可以挂在一块RAM上(kvdb_init_ram), 按NOR语义模拟闪存, 用于kv_bench/kv_check.
+ */
+#ifndef __KVDB_H__
+#define __KVDB_H__
+
+#include <stdint.h>
+
+#ifdef KVDB_HOST
+/* PC上编译kv_check(见kvdb_bench.c)时用到的RT-Thread定义 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef int rt_err_t;
+typedef int rt_bool_t;
+typedef uint32_t rt_tick_t;
+typedef void *rt_thread_t;
+struct rt_mutex { int unused; };
+struct rt_semaphore { int unused; };
+
+#define RT_NAME_MAX             8
+#define RT_THREAD_PRIORITY_MAX  32
+#define RT_TRUE                 1
+#define RT_FALSE                0
+#define RT_NULL                 NULL
+#define RT_EOK                  0
+#define RT_EFULL                3
+#define RT_ENOMEM               5
+#define RT_ENOSYS               6
+#define RT_EIO                  8
+#define RT_EINVAL               10
+#define RT_ENOENT               19
+#define RT_WAITING_FOREVER      (-1)
+#define RT_IPC_FLAG_PRIO        0
+#define RT_ALIGN(size, align)   (((size) + (align) - 1) & ~((align) - 1))
+
+#define rt_kprintf              printf
+#define rt_snprintf             snprintf
+#define rt_memcpy               memcpy
+#define rt_memset               memset
+#define rt_memcmp               memcmp
+#define rt_strlen               strlen
+#define rt_strncpy              strncpy
+#define rt_malloc               malloc
+#define rt_calloc               calloc
+#define rt_free                 free
+#define rt_tick_get()           ((rt_tick_t)time(NULL))
+#define rt_tick_get_millisecond() ((rt_tick_t)(clock() * 1000 / CLOCKS_PER_SEC))
+/* 单线程运行: 锁为空操作, 不创建整理线程, 整理都在写入时内联完成 */
+#define rt_mutex_init(m, n, f)  ((void)(m))
+#define rt_mutex_detach(m)      ((void)(m))
+#define rt_mutex_take(m, t)     ((void)(m))
+#define rt_mutex_release(m)     ((void)(m))
+#define rt_sem_init(s, n, v, f) ((void)(s))
+#define rt_sem_detach(s)        ((void)(s))
+#define rt_sem_take(s, t)       ((void)(s))
+#define rt_sem_release(s)       ((void)(s))
+#define rt_thread_create(n, e, p, s, pr, t) ((void)(e), RT_NULL)
+#define rt_thread_startup(t)    ((void)(t))
+#define rt_thread_mdelay(ms)    ((void)(ms))
+#define INIT_APP_EXPORT(fn)
+#define LOG_E(...)              (printf("E/kvdb: " __VA_ARGS__), printf("\n"))
+#define LOG_I(...)              (printf("I/kvdb: " __VA_ARGS__), printf("\n"))
+#else
+#include <rtthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef KVDB_PART_NAME
+#define KVDB_PART_NAME          "easyflash"
+#endif
+#define KVDB_SECTOR_SIZE        4096    /* 日志扇区大小, 必须是闪存擦除块的整数倍 */
+#define KVDB_KEY_MAX            64      /* key最大长度(不含结尾0) */
+#define KVDB_VALUE_MAX          (KVDB_SECTOR_SIZE - 16 - 20 - KVDB_KEY_MAX)
+#define KVDB_GC_FREE_SECTORS    4       /* 空闲扇区少于此数时唤醒后台整理 */
+
+typedef struct kvdb_sector kvdb_sector_t;
+
+typedef struct {
+    uint32_t    hash;
+    uint32_t    addr;                   /* 记录在分区内的偏移 */
+} kvdb_slot_t;
+
+typedef struct {
+    uint32_t    keys;
+    uint16_t    sectors;
+    uint16_t    free_sectors;
+    uint32_t    erase_min;              /* 各扇区擦除次数的最小/最大值 */
+    uint32_t    erase_max;
+    uint32_t    gc_runs;
+    uint32_t    mount_ms;
+    uint32_t    index_size;
+} kvdb_stats_t;
+
+typedef struct kvdb {
+    char                name[RT_NAME_MAX];
+    const void         *part;           /* struct fal_partition, RAM模拟时为RT_NULL */
+    void               *wbuf;           /* fal_wbuf_t, 开启FAL_USING_WRITE_BUFFER时经写缓冲访问分区 */
+    rt_bool_t           wbuf_hold;      /* 为真时写入先留在缓冲里, 由kvdb_flash_sync()编程 */
+    uint8_t            *ram;            /* RAM模拟的闪存 */
+    volatile int32_t    ram_budget;     /* >=0时为模拟掉电前还能编程的字节数 */
+    uint32_t            size;
+
+    kvdb_sector_t      *sectors;
+    uint16_t            sector_num;
+    uint16_t            free_num;
+    uint16_t            head;           /* 当前追加的扇区 */
+    uint32_t            sector_seq;     /* 最新扇区序号 */
+    uint32_t            rec_seq;        /* 最新记录序号 */
+
+    kvdb_slot_t        *index;
+    uint32_t            index_mask;
+    uint32_t            index_used;     /* 有效 + 墓碑槽 */
+    uint32_t            keys;
+
+    uint8_t            *buf;            /* 一个扇区大小的工作缓冲 */
+    struct rt_mutex     lock;
+    struct rt_semaphore gc_wake;
+    rt_thread_t         gc_thread;
+    volatile rt_bool_t  running;
+    uint32_t            gc_runs;
+    uint32_t            mount_ms;
+} kvdb_t;
+
+/* kvdb_foreach回调, 返回非0停止遍历 */
+typedef int (*kvdb_iter_t)(const char *key, const void *value, uint16_t len, void *arg);
+
+/**
+ * @brief 挂载FAL分区上的存储, 分区为空时自动格式化
+ */
+rt_err_t kvdb_init(kvdb_t *db, const char *part_name);
+
+/**
+ * @brief 挂载RAM模拟的闪存, mem内容保留则等同于重新上电挂载
+ */
+rt_err_t kvdb_init_ram(kvdb_t *db, const char *name, void *mem, uint32_t size);
+
+/**
+ * @brief 停止后台整理并释放索引, 不修改闪存
+ */
+void kvdb_deinit(kvdb_t *db);
+
+/**
+ * @brief 丢弃RAM状态, 像重新上电一样从闪存重建索引
+ */
+rt_err_t kvdb_remount(kvdb_t *db);
+
+/**
+ * @brief 读取value
+ * @return value长度(大于size时只拷贝size字节), 不存在返回-RT_ENOENT
+ */
+int kvdb_get(kvdb_t *db, const char *key, void *buf, size_t size);
+
+/**
+ * @brief 写入或覆盖, 返回时记录已提交到闪存
+ */
+rt_err_t kvdb_set(kvdb_t *db, const char *key, const void *value, size_t len);
+
+rt_err_t kvdb_del(kvdb_t *db, const char *key);
+
+void kvdb_foreach(kvdb_t *db, kvdb_iter_t iter, void *arg);
+
+/**
+ * @brief 立即整理最旧的扇区
+ */
+rt_err_t kvdb_gc(kvdb_t *db);
+
+void kvdb_get_stats(kvdb_t *db, kvdb_stats_t *stats);
+
+/**
+ * @brief easyflash分区上的默认实例, 未挂载时返回RT_NULL
+ */
+kvdb_t *kvdb_default(void);
+
+/**
+ * @brief 默认实例上的字符串读写, 读取结果总以0结尾
+ */
+int kvdb_get_str(const char *key, char *buf, size_t size);
+rt_err_t kvdb_set_str(const char *key, const char *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KVDB_H__ */
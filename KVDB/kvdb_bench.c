@@ -0,0 +1,298 @@
+/*
+ * kvdb_bench.c - 键值存储的性能测试和掉电自检
+ *
+ * kv_bench默认在RAM模拟的闪存上跑(与easyflash分区同样大小), 不磨损NOR;
+ * 加flash参数时在默认实例上用"bench."前缀的key测试, 结束后删除.
+ * kv_check在一块小的RAM闪存上随机写入/删除, 随机位置模拟掉电后重新挂载,
+ * 检查每个key都是最后一次提交的值(掉电时正在写的key可以是新值或旧值).
+ *
+ * kv_check也能在PC上编译运行(锁和整理线程为空操作, 整理在写入时内联完成):
+ *   cc -O2 -DKVDB_HOST -o kv_check KVDB/kvdb.c KVDB/kvdb_bench.c
+ *   ./kv_check [rounds]
+ */
+#include "kvdb.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define KV_BENCH_KEYS           1000
+#define KV_BENCH_VALUE_SIZE     32
+#define KV_BENCH_RAM_SIZE       (960 * 1024)
+
+#define KV_CHECK_RAM_SIZE       (16 * KVDB_SECTOR_SIZE)
+#define KV_CHECK_KEYS           40
+#define KV_CHECK_VALUE_MAX      300
+#define KV_CHECK_OPS            500     /* 每轮最多操作数, 通常更早掉电 */
+
+#ifdef RT_USING_FINSH
+
+/* ==================== kv_bench ==================== */
+
+typedef struct {
+    uint32_t    total_ms;
+    uint32_t    max_ms;
+    uint32_t    errors;
+} kv_bench_result_t;
+
+static void kv_bench_report(const char *name, kv_bench_result_t *r)
+{
+    rt_kprintf("%-10s %5u us/op avg, %3u ms max, %u errors\n", name,
+               r->total_ms * 1000 / KV_BENCH_KEYS, r->max_ms, r->errors);
+}
+
+static void kv_bench_key(char *key, size_t size, const char *prefix, int i)
+{
+    rt_snprintf(key, size, "%skey%04d", prefix, i);
+}
+
+/* op: 0 set, 1 get, 2 del */
+static void kv_bench_pass(kvdb_t *db, const char *name, const char *prefix, int op, uint8_t seed)
+{
+    uint8_t value[KV_BENCH_VALUE_SIZE];
+    uint8_t check[KV_BENCH_VALUE_SIZE];
+    kv_bench_result_t r = {0};
+    uint32_t start, ms;
+    char key[32];
+    int i, ret;
+
+    for (i = 0; i < KV_BENCH_KEYS; i++)
+    {
+        kv_bench_key(key, sizeof(key), prefix, i);
+        rt_memset(value, (uint8_t)(seed + i), sizeof(value));
+
+        start = rt_tick_get_millisecond();
+        if (op == 0)
+            ret = kvdb_set(db, key, value, sizeof(value));
+        else if (op == 1)
+            ret = kvdb_get(db, key, check, sizeof(check));
+        else
+            ret = kvdb_del(db, key);
+        ms = rt_tick_get_millisecond() - start;
+
+        r.total_ms += ms;
+        if (ms > r.max_ms)
+            r.max_ms = ms;
+        if (ret < 0 || (op == 1 && (ret != sizeof(value) || rt_memcmp(check, value, sizeof(value)) != 0)))
+            r.errors++;
+    }
+    kv_bench_report(name, &r);
+}
+
+static void kv_bench_mount(kvdb_t *db)
+{
+    kvdb_stats_t stats;
+
+    kvdb_remount(db);
+    kvdb_get_stats(db, &stats);
+    rt_kprintf("mount      %5u ms, %u keys, %u/%u sectors free, erase count %u..%u\n",
+               stats.mount_ms, stats.keys, stats.free_sectors, stats.sectors,
+               stats.erase_min, stats.erase_max);
+}
+
+static void kv_bench(int argc, char **argv)
+{
+    rt_bool_t flash = (argc > 1 && strcmp(argv[1], "flash") == 0);
+    const char *prefix = flash ? "bench." : "";
+    kvdb_t ram_db, *db;
+    uint8_t *mem = RT_NULL;
+
+    if (flash)
+    {
+        db = kvdb_default();
+        if (db == RT_NULL)
+        {
+            rt_kprintf("kvdb is not mounted\n");
+            return;
+        }
+    }
+    else
+    {
+        mem = rt_malloc(KV_BENCH_RAM_SIZE);
+        if (mem == RT_NULL)
+        {
+            rt_kprintf("no memory for the RAM flash\n");
+            return;
+        }
+        rt_memset(mem, 0xFF, KV_BENCH_RAM_SIZE);
+        if (kvdb_init_ram(&ram_db, "kvbench", mem, KV_BENCH_RAM_SIZE) != RT_EOK)
+        {
+            rt_free(mem);
+            return;
+        }
+        db = &ram_db;
+    }
+
+    rt_kprintf("%s, %d keys, %d byte values\n", flash ? "flash" : "RAM flash",
+               KV_BENCH_KEYS, KV_BENCH_VALUE_SIZE);
+    kv_bench_pass(db, "set new", prefix, 0, 0);
+    kv_bench_pass(db, "get", prefix, 1, 0);
+    kv_bench_pass(db, "overwrite", prefix, 0, 0x55);
+    kv_bench_mount(db);
+    kv_bench_pass(db, "get", prefix, 1, 0x55);
+    kv_bench_pass(db, "del", prefix, 2, 0);
+
+    if (!flash)
+    {
+        kvdb_deinit(db);
+        rt_free(mem);
+    }
+}
+MSH_CMD_EXPORT(kv_bench, key-value store benchmark: kv_bench [flash]);
+#endif /* RT_USING_FINSH */
+
+#if defined(RT_USING_FINSH) || defined(KVDB_HOST)
+
+/* ==================== kv_check ==================== */
+
+typedef struct {
+    rt_bool_t   exist;
+    uint8_t     seed;
+    uint16_t    len;
+} kv_check_model_t;
+
+static void kv_check_fill(uint8_t *buf, uint8_t seed, uint16_t len)
+{
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+        buf[i] = (uint8_t)(seed + i * 7);
+}
+
+/* 读出来的值和模型一致返回RT_TRUE */
+static rt_bool_t kv_check_match(const kv_check_model_t *m, int len, const uint8_t *value, uint8_t *tmp)
+{
+    if (!m->exist)
+        return len == -RT_ENOENT;
+    if (len != m->len)
+        return RT_FALSE;
+    kv_check_fill(tmp, m->seed, m->len);
+    return rt_memcmp(tmp, value, len) == 0;
+}
+
+/* 通过返回0 */
+static int kv_check_run(int rounds)
+{
+    kv_check_model_t model[KV_CHECK_KEYS], pending;
+    uint8_t *mem, *value, *tmp;
+    kvdb_stats_t stats;
+    uint32_t keys, cuts = 0;
+    int pending_key, round, op, k, len, result = -1;
+    rt_err_t ret;
+    char key[16];
+    kvdb_t db;
+
+    mem = rt_malloc(KV_CHECK_RAM_SIZE);
+    value = rt_malloc(KV_CHECK_VALUE_MAX * 2);
+    if (mem == RT_NULL || value == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        goto __exit;
+    }
+    tmp = value + KV_CHECK_VALUE_MAX;
+    rt_memset(mem, 0xFF, KV_CHECK_RAM_SIZE);
+    rt_memset(model, 0, sizeof(model));
+    srand(rt_tick_get());
+
+    if (kvdb_init_ram(&db, "kvcheck", mem, KV_CHECK_RAM_SIZE) != RT_EOK)
+        goto __exit;
+
+    for (round = 0; round < rounds; round++)
+    {
+        pending_key = -1;
+        db.ram_budget = rand() % 30000;
+
+        for (op = 0; op < KV_CHECK_OPS; op++)
+        {
+            k = rand() % KV_CHECK_KEYS;
+            rt_snprintf(key, sizeof(key), "key%d", k);
+            pending.exist = (rand() % 4) != 0;
+            pending.seed = rand();
+            pending.len = rand() % KV_CHECK_VALUE_MAX + 1;
+
+            if (pending.exist)
+            {
+                kv_check_fill(value, pending.seed, pending.len);
+                ret = kvdb_set(&db, key, value, pending.len);
+            }
+            else
+            {
+                ret = kvdb_del(&db, key);
+                if (ret == -RT_ENOENT && !model[k].exist)
+                    ret = RT_EOK;
+            }
+
+            if (ret == RT_EOK)
+            {
+                model[k] = pending;
+                continue;
+            }
+            if (db.ram_budget != 0)
+            {
+                rt_kprintf("round %d: %s failed %d without a power cut\n", round, key, ret);
+                goto __deinit;
+            }
+            pending_key = k;
+            cuts++;
+            break;
+        }
+
+        /* 重新上电 */
+        db.ram_budget = -1;
+        kvdb_remount(&db);
+
+        keys = 0;
+        for (k = 0; k < KV_CHECK_KEYS; k++)
+        {
+            rt_snprintf(key, sizeof(key), "key%d", k);
+            len = kvdb_get(&db, key, value, KV_CHECK_VALUE_MAX);
+            if (kv_check_match(&model[k], len, value, tmp))
+            {
+                keys += model[k].exist;
+                continue;
+            }
+            if (k == pending_key && kv_check_match(&pending, len, value, tmp))
+            {
+                model[k] = pending;
+                keys += model[k].exist;
+                continue;
+            }
+            rt_kprintf("round %d: %s has length %d, expected %d\n", round, key, len,
+                       model[k].exist ? model[k].len : -RT_ENOENT);
+            goto __deinit;
+        }
+
+        kvdb_get_stats(&db, &stats);
+        if (stats.keys != keys)
+        {
+            rt_kprintf("round %d: %u keys indexed, expected %u\n", round, stats.keys, keys);
+            goto __deinit;
+        }
+    }
+
+    kvdb_get_stats(&db, &stats);
+    rt_kprintf("kv_check passed: %d rounds, %u power cuts, %u gc runs, erase count %u..%u\n",
+               rounds, cuts, stats.gc_runs, stats.erase_min, stats.erase_max);
+    result = 0;
+
+__deinit:
+    kvdb_deinit(&db);
+__exit:
+    rt_free(value);
+    rt_free(mem);
+    return result;
+}
+#endif /* RT_USING_FINSH || KVDB_HOST */
+
+#ifdef RT_USING_FINSH
+static void kv_check(int argc, char **argv)
+{
+    kv_check_run(argc > 1 ? atoi(argv[1]) : 100);
+}
+MSH_CMD_EXPORT(kv_check, key-value store power cut self check: kv_check [rounds]);
+#endif /* RT_USING_FINSH */
+
+#ifdef KVDB_HOST
+int main(int argc, char **argv)
+{
+    return kv_check_run(argc > 1 ? atoi(argv[1]) : 300) == 0 ? 0 : 1;
+}
+#endif /* KVDB_HOST */
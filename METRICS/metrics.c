@@ -0,0 +1,252 @@
+/*
+ * metrics.c - 运行时指标注册表
+ *
+ * 注册在互斥锁下追加到单链表, 只增不删; 更新走原子操作, 不加锁.
+ * 导出线程遍历链表时持锁, 但只读取原子值, 不会阻塞更新方.
+ */
+#include "metrics.h"
+#include <string.h>
+
+#ifdef RT_USING_WIFI
+#include <wlan_mgnt.h>
+#endif
+
+static metric_t *g_metric_head = RT_NULL;
+static struct rt_mutex g_metric_lock;
+static rt_bool_t g_metric_lock_inited = RT_FALSE;
+
+static void metrics_lock(void)
+{
+    if (!g_metric_lock_inited)
+    {
+        rt_enter_critical();
+        if (!g_metric_lock_inited)
+        {
+            rt_mutex_init(&g_metric_lock, "metrics", RT_IPC_FLAG_PRIO);
+            g_metric_lock_inited = RT_TRUE;
+        }
+        rt_exit_critical();
+    }
+    rt_mutex_take(&g_metric_lock, RT_WAITING_FOREVER);
+}
+
+static void metrics_unlock(void)
+{
+    rt_mutex_release(&g_metric_lock);
+}
+
+static metric_t *metric_find(const char *name)
+{
+    metric_t *m;
+
+    for (m = g_metric_head; m; m = m->next)
+    {
+        if (rt_strncmp(m->name, name, METRIC_NAME_MAX) == 0)
+            return m;
+    }
+    return RT_NULL;
+}
+
+/* 查找或新建, 同名不同类型返回RT_NULL */
+static metric_t *metric_register(const char *name, metric_type_t type, metric_read_t read,
+                                 const int32_t *bounds, int bucket_num)
+{
+    metric_t *m;
+
+    if (name == RT_NULL || name[0] == '\0')
+        return RT_NULL;
+
+    metrics_lock();
+
+    m = metric_find(name);
+    if (m)
+    {
+        if (m->type != type)
+        {
+            rt_kprintf("[Metrics] %s already registered with another type\n", name);
+            m = RT_NULL;
+        }
+        metrics_unlock();
+        return m;
+    }
+
+    m = rt_calloc(1, sizeof(metric_t));
+    if (m == RT_NULL)
+    {
+        metrics_unlock();
+        return RT_NULL;
+    }
+
+    rt_strncpy(m->name, name, METRIC_NAME_MAX - 1);
+    m->type = type;
+    m->read = read;
+
+    if (type == METRIC_HISTOGRAM)
+    {
+        m->bounds = bounds;
+        m->bucket_num = bucket_num;
+        m->buckets = rt_calloc(bucket_num + 1, sizeof(rt_atomic_t));
+        m->last_buckets = rt_calloc(bucket_num + 1, sizeof(uint32_t));
+        if (m->buckets == RT_NULL || m->last_buckets == RT_NULL)
+        {
+            if (m->buckets) rt_free(m->buckets);
+            if (m->last_buckets) rt_free(m->last_buckets);
+            rt_free(m);
+            metrics_unlock();
+            return RT_NULL;
+        }
+    }
+
+    /* 头插, 导出线程可能正在遍历, 先填好next再发布 */
+    m->next = g_metric_head;
+    g_metric_head = m;
+
+    metrics_unlock();
+    return m;
+}
+
+metric_t *metric_counter(const char *name)
+{
+    return metric_register(name, METRIC_COUNTER, RT_NULL, RT_NULL, 0);
+}
+
+metric_t *metric_gauge(const char *name)
+{
+    return metric_register(name, METRIC_GAUGE, RT_NULL, RT_NULL, 0);
+}
+
+metric_t *metric_counter_fn(const char *name, metric_read_t read)
+{
+    return metric_register(name, METRIC_COUNTER, read, RT_NULL, 0);
+}
+
+metric_t *metric_gauge_fn(const char *name, metric_read_t read)
+{
+    return metric_register(name, METRIC_GAUGE, read, RT_NULL, 0);
+}
+
+metric_t *metric_histogram(const char *name, const int32_t *bounds, int bucket_num)
+{
+    if (bounds == RT_NULL || bucket_num <= 0 || bucket_num > METRIC_BUCKET_MAX)
+        return RT_NULL;
+
+    return metric_register(name, METRIC_HISTOGRAM, RT_NULL, bounds, bucket_num);
+}
+
+void metric_observe(metric_t *m, int32_t v)
+{
+    int i;
+
+    if (m == RT_NULL || m->type != METRIC_HISTOGRAM)
+        return;
+
+    /* 分桶数不超过16, 线性查找比二分更省 */
+    for (i = 0; i < m->bucket_num; i++)
+    {
+        if (v <= m->bounds[i])
+            break;
+    }
+
+    rt_atomic_add(&m->buckets[i], 1);
+    rt_atomic_add(&m->count, 1);
+    rt_atomic_add(&m->sum, (rt_atomic_t)v);
+}
+
+uint32_t metric_value(metric_t *m)
+{
+    if (m == RT_NULL)
+        return 0;
+
+    if (m->read)
+        return m->read();
+
+    return (uint32_t)rt_atomic_load(&m->value);
+}
+
+void metrics_foreach(metric_visit_t visit, void *arg)
+{
+    metric_t *m;
+
+    metrics_lock();
+    for (m = g_metric_head; m; m = m->next)
+    {
+        visit(m, arg);
+    }
+    metrics_unlock();
+}
+
+/* ==================== 系统指标 ==================== */
+
+static uint32_t sys_heap_used(void)
+{
+    rt_size_t total = 0, used = 0, max_used = 0;
+
+    rt_memory_info(&total, &used, &max_used);
+    return used;
+}
+
+static uint32_t sys_heap_max(void)
+{
+    rt_size_t total = 0, used = 0, max_used = 0;
+
+    rt_memory_info(&total, &used, &max_used);
+    return max_used;
+}
+
+static uint32_t sys_uptime(void)
+{
+    return rt_tick_get() / RT_TICK_PER_SECOND;
+}
+
+#ifdef RT_USING_WIFI
+static uint32_t sys_wifi_rssi(void)
+{
+    /* 未连接时为0, gauge按有符号导出 */
+    return rt_wlan_is_connected() ? (uint32_t)rt_wlan_get_rssi() : 0;
+}
+#endif
+
+static int metrics_sys_init(void)
+{
+    metric_gauge_fn("sys.heap_used", sys_heap_used);
+    metric_gauge_fn("sys.heap_max", sys_heap_max);
+    metric_gauge_fn("sys.uptime_s", sys_uptime);
+#ifdef RT_USING_WIFI
+    metric_gauge_fn("wifi.rssi", sys_wifi_rssi);
+#endif
+    return 0;
+}
+INIT_APP_EXPORT(metrics_sys_init);
+
+/* ==================== MSH命令 ==================== */
+
+static void metrics_show(metric_t *m, void *arg)
+{
+    int i;
+
+    switch (m->type)
+    {
+    case METRIC_COUNTER:
+        rt_kprintf("%-32s counter   %u\n", m->name, metric_value(m));
+        break;
+    case METRIC_GAUGE:
+        rt_kprintf("%-32s gauge     %d\n", m->name, (int32_t)metric_value(m));
+        break;
+    case METRIC_HISTOGRAM:
+        rt_kprintf("%-32s histogram count=%u sum=%d\n", m->name,
+                   (uint32_t)rt_atomic_load(&m->count), (int32_t)rt_atomic_load(&m->sum));
+        for (i = 0; i < m->bucket_num; i++)
+        {
+            rt_kprintf("    <= %-8d %u\n", m->bounds[i], (uint32_t)rt_atomic_load(&m->buckets[i]));
+        }
+        rt_kprintf("    >  %-8d %u\n", m->bounds[m->bucket_num - 1],
+                   (uint32_t)rt_atomic_load(&m->buckets[m->bucket_num]));
+        break;
+    }
+}
+
+static void metrics(int argc, char **argv)
+{
+    metrics_foreach(metrics_show, RT_NULL);
+}
+MSH_CMD_EXPORT(metrics, list registered runtime metrics);
@@ -0,0 +1,112 @@
+/*
+ * metrics.h - 运行时指标注册表(counter / gauge / 固定分桶histogram)
+ *
+ * 任何模块按名字注册指标并缓存返回的句柄, 更新只是一次原子加/写,
+ * 不加锁, 可以在线程和中断里使用. 导出由metrics_export.c的低优先级线程完成.
+ */
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <rtthread.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define METRIC_NAME_MAX         32      /* 指标名最大长度(含结尾0) */
+#define METRIC_BUCKET_MAX       16      /* histogram最大分桶数(不含溢出桶) */
+
+typedef enum {
+    METRIC_COUNTER = 0,                 /* 单调递增计数 */
+    METRIC_GAUGE,                       /* 瞬时值 */
+    METRIC_HISTOGRAM                    /* 固定分桶分布 */
+} metric_type_t;
+
+/* 导出时采样的指标, 用于已有统计变量(如inmp441_get_stats) */
+typedef uint32_t (*metric_read_t)(void);
+
+typedef struct metric {
+    char            name[METRIC_NAME_MAX];
+    metric_type_t   type;
+    metric_read_t   read;               /* 非NULL时导出时调用, 不用value */
+    rt_atomic_t     value;              /* counter累计值 / gauge当前值 */
+
+    /* histogram */
+    const int32_t  *bounds;             /* 升序上界, 落在(bounds[i-1], bounds[i]]的计入第i桶 */
+    uint8_t         bucket_num;
+    rt_atomic_t    *buckets;            /* bucket_num + 1个, 最后一个为溢出桶 */
+    rt_atomic_t     count;
+    rt_atomic_t     sum;
+
+    /* 仅导出线程使用: 上次导出的值, 用于StatsD差分 */
+    uint32_t        last_value;
+    uint32_t        last_count;
+    uint32_t        last_sum;
+    uint32_t       *last_buckets;
+
+    struct metric  *next;
+} metric_t;
+
+/**
+ * @brief 注册(或查找同名已有的)指标
+ * @return 指标句柄, 内存不足或同名不同类型时返回RT_NULL
+ */
+metric_t *metric_counter(const char *name);
+metric_t *metric_gauge(const char *name);
+metric_t *metric_counter_fn(const char *name, metric_read_t read);
+metric_t *metric_gauge_fn(const char *name, metric_read_t read);
+
+/**
+ * @brief 注册histogram
+ * @param bounds      升序分桶上界, 需在整个运行期有效(通常为static const)
+ * @param bucket_num  分桶数, 不超过METRIC_BUCKET_MAX
+ */
+metric_t *metric_histogram(const char *name, const int32_t *bounds, int bucket_num);
+
+/* 更新接口, 句柄为RT_NULL时忽略 */
+rt_inline void metric_add(metric_t *m, uint32_t v)
+{
+    if (m) rt_atomic_add(&m->value, (rt_atomic_t)v);
+}
+
+rt_inline void metric_inc(metric_t *m)
+{
+    metric_add(m, 1);
+}
+
+rt_inline void metric_set(metric_t *m, int32_t v)
+{
+    if (m) rt_atomic_store(&m->value, (rt_atomic_t)v);
+}
+
+void metric_observe(metric_t *m, int32_t v);
+
+/* 读取当前值(counter/gauge) */
+uint32_t metric_value(metric_t *m);
+
+/* 遍历所有指标(导出线程和msh使用) */
+typedef void (*metric_visit_t)(metric_t *m, void *arg);
+void metrics_foreach(metric_visit_t visit, void *arg);
+
+/* ==================== UDP导出(metrics_export.c) ==================== */
+
+typedef enum {
+    METRICS_FMT_STATSD = 0,             /* name:v|c / name:v|g, counter发送差分 */
+    METRICS_FMT_INFLUX                  /* InfluxDB行协议, counter发送累计值 */
+} metrics_fmt_t;
+
+/**
+ * @brief 启动导出线程, 已在运行时先停止再按新参数启动
+ * @param ip          接收端IPv4地址
+ * @param port        接收端UDP端口
+ * @param interval_ms 导出周期
+ */
+rt_err_t metrics_export_start(const char *ip, uint16_t port, uint32_t interval_ms, metrics_fmt_t fmt);
+void metrics_export_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __METRICS_H__ */
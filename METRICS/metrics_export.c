@@ -0,0 +1,388 @@
+/*
+ * metrics_export.c - 指标UDP批量导出
+ *
+ * 低优先级线程按周期遍历注册表, 把所有指标拼进尽量少的UDP数据报
+ * (每包不超过METRICS_EXPORT_MTU, 避免IP分片), 支持StatsD和InfluxDB行协议.
+ * 遍历时持有注册表锁, 只把各行拼进暂存区; 解锁后才sendto, 网络阻塞不会
+ * 卡住注册新指标的线程.
+ * UDP发送失败只计数不重试, 下个周期StatsD差分会把丢失的增量补回.
+ */
+#include "metrics.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netdev.h>
+
+#define DBG_TAG "metrics"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+
+#ifndef METRICS_EXPORT_MTU
+#define METRICS_EXPORT_MTU          1200    /* 单个数据报最大字节数 */
+#endif
+#ifndef METRICS_EXPORT_INTERVAL
+#define METRICS_EXPORT_INTERVAL     10000   /* 默认导出周期(ms) */
+#endif
+#ifndef METRICS_HOST_NAME
+#define METRICS_HOST_NAME           "artpi2"
+#endif
+#define METRICS_THREAD_STACK        3072
+#define METRICS_THREAD_PRIO         (RT_THREAD_PRIORITY_MAX - 4)
+#define METRICS_LINE_MAX            160     /* counter/gauge单行 */
+#define METRICS_HIST_LINE_MAX       (METRICS_LINE_MAX + METRIC_BUCKET_MAX * 24)
+#ifndef METRICS_EXPORT_DGRAM_MAX
+#define METRICS_EXPORT_DGRAM_MAX    16      /* 每周期最多数据报数, 超出的行丢弃并计入tx_errors */
+#endif
+
+typedef struct {
+    rt_thread_t         thread;
+    struct rt_semaphore wake;
+    struct rt_semaphore exit;           /* 线程退出前释放, stop在此等待 */
+    volatile rt_bool_t  running;
+
+    int                 sock;
+    struct sockaddr_in  addr;
+    uint32_t            interval_ms;
+    metrics_fmt_t       fmt;
+    char                host[24];       /* StatsD前缀 / Influx host标签 */
+
+    /* 暂存区: 本周期的数据报首尾相接, ends[i]为第i个数据报的结束偏移 */
+    char               *stage;
+    uint32_t            cap;
+    uint32_t            len;
+    uint32_t            start;          /* 当前数据报起始偏移 */
+    uint32_t            ends[METRICS_EXPORT_DGRAM_MAX];
+    int                 num;
+    rt_bool_t           full;           /* 数据报数已满, 本周期余下的行丢弃 */
+} metrics_export_ctx_t;
+
+static metrics_export_ctx_t g_export = {0};
+static metric_t *g_tx_datagrams = RT_NULL;
+static metric_t *g_tx_errors = RT_NULL;
+
+/* ==================== 数据报拼装 ==================== */
+
+/* 结束当前数据报, 之后的行进入下一个 */
+static void export_seal(metrics_export_ctx_t *ctx)
+{
+    if (ctx->len == ctx->start)
+        return;
+
+    ctx->ends[ctx->num++] = ctx->len;
+    ctx->start = ctx->len;
+}
+
+/* 解锁后调用: 逐个发出暂存的数据报 */
+static void export_send(metrics_export_ctx_t *ctx)
+{
+    uint32_t off = 0;
+    int i;
+
+    for (i = 0; i < ctx->num; i++)
+    {
+        if (sendto(ctx->sock, ctx->stage + off, ctx->ends[i] - off, 0,
+                   (struct sockaddr *)&ctx->addr, sizeof(ctx->addr)) == (int)(ctx->ends[i] - off))
+        {
+            metric_inc(g_tx_datagrams);
+        }
+        else
+        {
+            metric_inc(g_tx_errors);
+        }
+        off = ctx->ends[i];
+    }
+}
+
+/* 一行放不下当前包就先封包, 行不会被拆到两个包里 */
+static void export_append(metrics_export_ctx_t *ctx, const char *line, int n)
+{
+    char *stage;
+
+    if (ctx->len - ctx->start + n > METRICS_EXPORT_MTU)
+    {
+        if (ctx->num == METRICS_EXPORT_DGRAM_MAX - 1)
+            ctx->full = RT_TRUE;
+        else
+            export_seal(ctx);
+    }
+    if (!ctx->full && ctx->len + n > ctx->cap)
+    {
+        /* 按包长扩容, 之后各周期复用 */
+        stage = rt_realloc(ctx->stage, ctx->cap + METRICS_EXPORT_MTU);
+        if (stage == RT_NULL)
+        {
+            ctx->full = RT_TRUE;
+        }
+        else
+        {
+            ctx->stage = stage;
+            ctx->cap += METRICS_EXPORT_MTU;
+        }
+    }
+    if (ctx->full)
+    {
+        metric_inc(g_tx_errors);
+        return;
+    }
+
+    rt_memcpy(ctx->stage + ctx->len, line, n);
+    ctx->len += n;
+}
+
+static void export_line(metrics_export_ctx_t *ctx, const char *fmt, ...)
+{
+    char line[METRICS_LINE_MAX];
+    va_list args;
+    int n;
+
+    va_start(args, fmt);
+    n = rt_vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if (n <= 0 || n >= (int)sizeof(line))
+        return;
+
+    export_append(ctx, line, n);
+}
+
+/* ==================== StatsD ==================== */
+
+static uint32_t statsd_delta(uint32_t now, uint32_t *last)
+{
+    uint32_t delta = now - *last;   /* 32位回绕时差分仍然正确 */
+
+    *last = now;
+    return delta;
+}
+
+static void export_statsd(metric_t *m, void *arg)
+{
+    metrics_export_ctx_t *ctx = (metrics_export_ctx_t *)arg;
+    int32_t gauge;
+    uint32_t d;
+    int i;
+
+    switch (m->type)
+    {
+    case METRIC_COUNTER:
+        d = statsd_delta(metric_value(m), &m->last_value);
+        if (d)
+            export_line(ctx, "%s.%s:%u|c\n", ctx->host, m->name, d);
+        break;
+
+    case METRIC_GAUGE:
+        gauge = (int32_t)metric_value(m);
+        /* StatsD里带符号的gauge表示增减, 负值要先归零再设置 */
+        if (gauge < 0)
+            export_line(ctx, "%s.%s:0|g\n%s.%s:%d|g\n", ctx->host, m->name, ctx->host, m->name, gauge);
+        else
+            export_line(ctx, "%s.%s:%d|g\n", ctx->host, m->name, gauge);
+        break;
+
+    case METRIC_HISTOGRAM:
+        d = statsd_delta((uint32_t)rt_atomic_load(&m->count), &m->last_count);
+        if (d == 0)
+            break;
+        export_line(ctx, "%s.%s.count:%u|c\n", ctx->host, m->name, d);
+        d = statsd_delta((uint32_t)rt_atomic_load(&m->sum), &m->last_sum);
+        export_line(ctx, "%s.%s.sum:%d|c\n", ctx->host, m->name, (int32_t)d);
+        for (i = 0; i <= m->bucket_num; i++)
+        {
+            d = statsd_delta((uint32_t)rt_atomic_load(&m->buckets[i]), &m->last_buckets[i]);
+            if (d == 0)
+                continue;
+            if (i < m->bucket_num)
+                export_line(ctx, "%s.%s.le_%d:%u|c\n", ctx->host, m->name, m->bounds[i], d);
+            else
+                export_line(ctx, "%s.%s.le_inf:%u|c\n", ctx->host, m->name, d);
+        }
+        break;
+    }
+}
+
+/* ==================== InfluxDB行协议 ==================== */
+
+static void export_influx(metric_t *m, void *arg)
+{
+    metrics_export_ctx_t *ctx = (metrics_export_ctx_t *)arg;
+    char line[METRICS_HIST_LINE_MAX];
+    int n, i;
+
+    switch (m->type)
+    {
+    case METRIC_COUNTER:
+        export_line(ctx, "%s,host=%s value=%ui\n", m->name, ctx->host, metric_value(m));
+        break;
+
+    case METRIC_GAUGE:
+        export_line(ctx, "%s,host=%s value=%di\n", m->name, ctx->host, (int32_t)metric_value(m));
+        break;
+
+    case METRIC_HISTOGRAM:
+        /* 分桶作为同一行的多个field, 行长超过METRICS_LINE_MAX, 单独拼装 */
+        n = rt_snprintf(line, sizeof(line), "%s,host=%s count=%ui,sum=%di", m->name, ctx->host,
+                        (uint32_t)rt_atomic_load(&m->count), (int32_t)rt_atomic_load(&m->sum));
+        for (i = 0; i < m->bucket_num && n < (int)sizeof(line); i++)
+        {
+            n += rt_snprintf(line + n, sizeof(line) - n, ",le_%d=%ui",
+                             m->bounds[i], (uint32_t)rt_atomic_load(&m->buckets[i]));
+        }
+        if (n < (int)sizeof(line))
+        {
+            n += rt_snprintf(line + n, sizeof(line) - n, ",le_inf=%ui\n",
+                             (uint32_t)rt_atomic_load(&m->buckets[m->bucket_num]));
+        }
+        if (n >= (int)sizeof(line))
+            break;
+
+        export_append(ctx, line, n);
+        break;
+    }
+}
+
+/* ==================== 导出线程 ==================== */
+
+static void export_host_name(metrics_export_ctx_t *ctx)
+{
+    struct netdev *netdev = netdev_default;
+
+    /* 多块板子发往同一接收端, 用MAC后3字节区分 */
+    if (netdev && netdev->hwaddr_len >= 6)
+    {
+        rt_snprintf(ctx->host, sizeof(ctx->host), "%s-%02x%02x%02x", METRICS_HOST_NAME,
+                    netdev->hwaddr[3], netdev->hwaddr[4], netdev->hwaddr[5]);
+    }
+    else
+    {
+        rt_strncpy(ctx->host, METRICS_HOST_NAME, sizeof(ctx->host) - 1);
+    }
+}
+
+static void metrics_export_entry(void *param)
+{
+    metrics_export_ctx_t *ctx = (metrics_export_ctx_t *)param;
+
+    while (ctx->running)
+    {
+        /* stop时释放信号量提前唤醒 */
+        rt_sem_take(&ctx->wake, rt_tick_from_millisecond(ctx->interval_ms));
+        if (!ctx->running)
+            break;
+
+        if (ctx->host[0] == '\0')
+            export_host_name(ctx);
+
+        ctx->len = 0;
+        ctx->start = 0;
+        ctx->num = 0;
+        ctx->full = RT_FALSE;
+        metrics_foreach(ctx->fmt == METRICS_FMT_INFLUX ? export_influx : export_statsd, ctx);
+        export_seal(ctx);
+        export_send(ctx);
+    }
+
+    closesocket(ctx->sock);
+    ctx->sock = -1;
+    ctx->thread = RT_NULL;
+    rt_sem_release(&ctx->exit);
+}
+
+rt_err_t metrics_export_start(const char *ip, uint16_t port, uint32_t interval_ms, metrics_fmt_t fmt)
+{
+    metrics_export_ctx_t *ctx = &g_export;
+    in_addr_t addr;
+
+    metrics_export_stop();
+
+    addr = inet_addr(ip);
+    if (addr == INADDR_NONE || port == 0)
+        return -RT_EINVAL;
+
+    g_tx_datagrams = metric_counter("metrics.tx_datagrams");
+    g_tx_errors = metric_counter("metrics.tx_errors");
+
+    ctx->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (ctx->sock < 0)
+    {
+        LOG_E("socket failed");
+        return -RT_ERROR;
+    }
+
+    rt_memset(&ctx->addr, 0, sizeof(ctx->addr));
+    ctx->addr.sin_family = AF_INET;
+    ctx->addr.sin_port = htons(port);
+    ctx->addr.sin_addr.s_addr = addr;
+    ctx->interval_ms = interval_ms ? interval_ms : METRICS_EXPORT_INTERVAL;
+    ctx->fmt = fmt;
+    ctx->host[0] = '\0';
+    ctx->len = 0;
+
+    rt_sem_init(&ctx->wake, "mexp", 0, RT_IPC_FLAG_PRIO);
+    rt_sem_init(&ctx->exit, "mexit", 0, RT_IPC_FLAG_PRIO);
+    ctx->running = RT_TRUE;
+    ctx->thread = rt_thread_create("metrics", metrics_export_entry, ctx,
+                                   METRICS_THREAD_STACK, METRICS_THREAD_PRIO, 10);
+    if (ctx->thread == RT_NULL)
+    {
+        ctx->running = RT_FALSE;
+        rt_sem_detach(&ctx->wake);
+        rt_sem_detach(&ctx->exit);
+        closesocket(ctx->sock);
+        ctx->sock = -1;
+        return -RT_ENOMEM;
+    }
+    rt_thread_startup(ctx->thread);
+
+    LOG_I("exporting to %s:%d every %d ms (%s)", ip, port, ctx->interval_ms,
+          fmt == METRICS_FMT_INFLUX ? "influx" : "statsd");
+    return RT_EOK;
+}
+
+void metrics_export_stop(void)
+{
+    metrics_export_ctx_t *ctx = &g_export;
+
+    if (!ctx->running)
+        return;
+
+    ctx->running = RT_FALSE;
+    rt_sem_release(&ctx->wake);
+
+    /* 线程关闭socket后释放exit */
+    rt_sem_take(&ctx->exit, RT_WAITING_FOREVER);
+    rt_sem_detach(&ctx->exit);
+    rt_sem_detach(&ctx->wake);
+}
+
+/* ==================== MSH命令 ==================== */
+
+static void metrics_export(int argc, char **argv)
+{
+    metrics_fmt_t fmt = METRICS_FMT_STATSD;
+    uint32_t interval = METRICS_EXPORT_INTERVAL;
+
+    if (argc == 2 && strcmp(argv[1], "stop") == 0)
+    {
+        metrics_export_stop();
+        return;
+    }
+
+    if (argc < 3)
+    {
+        rt_kprintf("Usage: metrics_export <ip> <port> [interval_ms] [statsd|influx]\n");
+        rt_kprintf("       metrics_export stop\n");
+        return;
+    }
+
+    if (argc > 3)
+        interval = atoi(argv[3]);
+    if (argc > 4 && strcmp(argv[4], "influx") == 0)
+        fmt = METRICS_FMT_INFLUX;
+
+    if (metrics_export_start(argv[1], atoi(argv[2]), interval, fmt) != RT_EOK)
+        rt_kprintf("metrics_export start failed\n");
+}
+MSH_CMD_EXPORT(metrics_export, export metrics over UDP: metrics_export <ip> <port> [ms] [statsd|influx]);
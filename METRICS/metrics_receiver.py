@@ -0,0 +1,67 @@
+# -*- coding: utf-8 -*-
+# 本地UDP指标接收端, 解析板端metrics_export发出的StatsD/InfluxDB行协议并打印
+#
+# 运行:
+#   python3 metrics_receiver.py 0.0.0.0 8125
+# 板端:
+#   metrics_export <PC的IP> 8125 5000 statsd
+#   metrics_export <PC的IP> 8125 5000 influx
+import socket
+import sys
+import time
+
+
+def parse_statsd(line):
+    # host.name:value|type
+    name, rest = line.split(':', 1)
+    value, kind = rest.split('|', 1)
+    return name, {'c': 'counter', 'g': 'gauge'}.get(kind, kind), int(value)
+
+
+def parse_influx(line):
+    # name,host=xxx field=1i[,field=2i...]
+    head, fields = line.split(' ', 1)
+    name, _, tags = head.partition(',')
+    values = {}
+    for field in fields.split(','):
+        key, value = field.split('=', 1)
+        values[key] = int(value.rstrip('i'))
+    return name, tags, values
+
+
+def main():
+    if len(sys.argv) < 3:
+        print('Usage: %s <ip> <port>' % sys.argv[0])
+        return
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((sys.argv[1], int(sys.argv[2])))
+    print('Waiting for metrics on %s:%s...' % (sys.argv[1], sys.argv[2]))
+
+    # StatsD counter是差分, 这里累加出总量便于和板端metrics命令对照
+    totals = {}
+    while True:
+        data, addr = sock.recvfrom(2048)
+        lines = data.decode('utf-8', 'replace').splitlines()
+        print('--- %s %s:%d %d bytes, %d lines' % (time.strftime('%H:%M:%S'), addr[0], addr[1],
+                                                   len(data), len(lines)))
+        for line in lines:
+            if not line:
+                continue
+            try:
+                if '|' in line:
+                    name, kind, value = parse_statsd(line)
+                    if kind == 'counter':
+                        totals[name] = totals.get(name, 0) + value
+                        print('  %-48s %-8s +%d (total %d)' % (name, kind, value, totals[name]))
+                    else:
+                        print('  %-48s %-8s %d' % (name, kind, value))
+                else:
+                    name, tags, values = parse_influx(line)
+                    print('  %-32s %-20s %s' % (name, tags,
+                                                ' '.join('%s=%d' % kv for kv in values.items())))
+            except ValueError:
+                print('  malformed: %r' % line)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,797 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Description: Sample rate converter, mixer and IMA ADPCM decoder for the
+ *              prompt player
+ *
+ * The self-test runs on the board (prompt selftest) and on a PC:
+ *
+ *   cc -O2 -DAUDIO_DSP_HOST -ISAI -o audio_dsp SAI/audio_dsp.c -lm
+ *   ./audio_dsp
+ */
+
+#include <string.h>
+#include <math.h>
+#include "audio_dsp.h"
+
+#ifdef AUDIO_DSP_HOST
+#include <stdio.h>
+#include <stdlib.h>
+#define dsp_printf              printf
+#define dsp_malloc              malloc
+#define dsp_free                free
+#else
+#include <rtthread.h>
+#define dsp_printf              rt_kprintf
+#define dsp_malloc              rt_malloc
+#define dsp_free                rt_free
+#endif
+
+#define DSP_PI                  3.14159265358979323846
+
+static int16_t _sat16(int32_t v)
+{
+    if (v > 32767)
+        return 32767;
+    if (v < -32768)
+        return -32768;
+    return (int16_t)v;
+}
+
+/* ==================== Sample rate converter ==================== */
+
+static uint32_t _gcd(uint32_t a, uint32_t b)
+{
+    uint32_t t;
+
+    while (b)
+    {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* windowed sinc, n in 0 .. len - 1 of the prototype at the upsampled rate */
+static double _proto(uint32_t n, uint32_t len, double fc)
+{
+    double x = 2.0 * fc * ((double)n - (len - 1) / 2.0);
+    double w = 0.42 - 0.5 * cos(2.0 * DSP_PI * n / (len - 1)) + 0.08 * cos(4.0 * DSP_PI * n / (len - 1));
+
+    if (x == 0.0)
+        return w;
+    return w * sin(DSP_PI * x) / (DSP_PI * x);
+}
+
+static void _design(struct audio_src *s)
+{
+    uint32_t len = (uint32_t)s->up * s->taps;
+    double fc = AUDIO_SRC_PASSBAND / (s->up > s->down ? s->up : s->down);
+    double v[AUDIO_SRC_TAPS_MAX], sum;
+    int32_t total, q;
+    int p, j, peak;
+
+    for (p = 0; p < s->up; p++)
+    {
+        sum = 0.0;
+        for (j = 0; j < s->taps; j++)
+        {
+            v[j] = _proto(p + (uint32_t)j * s->up, len, fc);
+            sum += v[j];
+        }
+
+        /* each phase to exactly 1.0, the rounding left on its largest tap */
+        total = 0;
+        peak = 0;
+        for (j = 0; j < s->taps; j++)
+        {
+            q = (int32_t)floor(v[j] / sum * 32768.0 + 0.5);
+            s->coeffs[p * s->taps + s->taps - 1 - j] = _sat16(q);
+            total += _sat16(q);
+            if (v[j] > v[peak])
+                peak = j;
+        }
+        q = s->coeffs[p * s->taps + s->taps - 1 - peak] + 32768 - total;
+        s->coeffs[p * s->taps + s->taps - 1 - peak] = _sat16(q);
+    }
+}
+
+int audio_src_init(struct audio_src *s, uint32_t in_rate, uint32_t out_rate)
+{
+    uint32_t g, ratio;
+
+    memset(s, 0, sizeof(*s));
+    if (in_rate == 0 || out_rate == 0)
+        return -1;
+
+    g = _gcd(in_rate, out_rate);
+    if (out_rate / g > AUDIO_SRC_UP_MAX || in_rate / g > 0xFFFF - AUDIO_SRC_UP_MAX)
+        return -1;
+    s->up = out_rate / g;
+    s->down = in_rate / g;
+    if (s->up == s->down)
+        return 0;
+
+    /* as many zero crossings in the decimated band as at ratio 1 */
+    ratio = (s->down + s->up - 1) / s->up;
+    s->taps = 2 * AUDIO_SRC_ZEROS * ratio;
+    if (s->taps > AUDIO_SRC_TAPS_MAX)
+        s->taps = AUDIO_SRC_TAPS_MAX;
+
+    s->coeffs = dsp_malloc((uint32_t)s->up * s->taps * sizeof(int16_t));
+    s->history = dsp_malloc(2 * s->taps * sizeof(int16_t));
+    if (s->coeffs == NULL || s->history == NULL)
+    {
+        audio_src_free(s);
+        return -1;
+    }
+
+    _design(s);
+    audio_src_reset(s);
+    return 0;
+}
+
+void audio_src_free(struct audio_src *s)
+{
+    if (s->coeffs)
+        dsp_free(s->coeffs);
+    if (s->history)
+        dsp_free(s->history);
+    s->coeffs = NULL;
+    s->history = NULL;
+    s->taps = 0;
+}
+
+void audio_src_reset(struct audio_src *s)
+{
+    s->phase = s->up;
+    s->head = 0;
+    if (s->history)
+        memset(s->history, 0, 2 * s->taps * sizeof(int16_t));
+}
+
+int audio_src_delay(const struct audio_src *s)
+{
+    return s->taps / 2;
+}
+
+int audio_src_process(struct audio_src *s, const int16_t *in, int n_in, int *used,
+                      int16_t *out, int n_out)
+{
+    const int16_t *c, *w;
+    int64_t acc;
+    int produced = 0, taken = 0, k;
+
+    if (s->taps == 0)
+    {
+        produced = n_in < n_out ? n_in : n_out;
+        memcpy(out, in, produced * sizeof(int16_t));
+        *used = produced;
+        return produced;
+    }
+
+    for (;;)
+    {
+        /* inputs up to the one the next output starts from */
+        while (s->phase >= s->up)
+        {
+            if (taken == n_in)
+                goto __exit;
+            s->history[s->head] = s->history[s->head + s->taps] = in[taken++];
+            if (++s->head == s->taps)
+                s->head = 0;
+            s->phase -= s->up;
+        }
+        if (produced == n_out)
+            break;
+
+        c = s->coeffs + s->phase * s->taps;
+        w = s->history + s->head;
+        acc = 1 << 14;
+        for (k = 0; k < s->taps; k++)
+            acc += (int32_t)c[k] * w[k];
+        out[produced++] = _sat16((int32_t)(acc >> 15));
+        s->phase += s->down;
+    }
+
+__exit:
+    *used = taken;
+    return produced;
+}
+
+/* ==================== Mixer ==================== */
+
+void audio_mix_add(int32_t *mix, const int16_t *in, int n, int16_t *gain, int16_t target)
+{
+    int32_t g = *gain;
+    int i = 0;
+
+    for (; i < n && g != target; i++)
+    {
+        if (g < target)
+            g = (g + AUDIO_MIX_RAMP_STEP < target) ? g + AUDIO_MIX_RAMP_STEP : target;
+        else
+            g = (g - AUDIO_MIX_RAMP_STEP > target) ? g - AUDIO_MIX_RAMP_STEP : target;
+        mix[i] += (in[i] * g + 0x4000) >> 15;
+    }
+    for (; i < n; i++)
+        mix[i] += (in[i] * g + 0x4000) >> 15;
+
+    *gain = (int16_t)g;
+}
+
+int audio_mix_out(int16_t *out, const int32_t *mix, int n)
+{
+    int i, clipped = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        out[i] = _sat16(mix[i]);
+        clipped += (out[i] != mix[i]);
+    }
+
+    return clipped;
+}
+
+/* ==================== IMA ADPCM ==================== */
+
+static const int16_t _ima_steps[89] =
+{
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t _ima_index[16] =
+{
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+struct ima_state
+{
+    int32_t pred;
+    int32_t index;
+};
+
+static int16_t _ima_decode(struct ima_state *st, uint8_t code)
+{
+    int32_t step = _ima_steps[st->index];
+    int32_t diff = step >> 3;
+
+    if (code & 4)
+        diff += step;
+    if (code & 2)
+        diff += step >> 1;
+    if (code & 1)
+        diff += step >> 2;
+
+    st->pred = _sat16((code & 8) ? st->pred - diff : st->pred + diff);
+    st->index += _ima_index[code];
+    if (st->index < 0)
+        st->index = 0;
+    else if (st->index > 88)
+        st->index = 88;
+
+    return (int16_t)st->pred;
+}
+
+int audio_adpcm_block_samples(int block_align, int channels)
+{
+    if (channels < 1 || channels > 2 || block_align <= 4 * channels ||
+        (block_align - 4 * channels) % (4 * channels) != 0)
+        return 0;
+    return (block_align - 4 * channels) * 2 / channels + 1;
+}
+
+int audio_adpcm_decode_block(const uint8_t *block, int block_align, int channels, int16_t *out)
+{
+    struct ima_state st[2];
+    int samples = audio_adpcm_block_samples(block_align, channels);
+    int ch, i, b, n;
+
+    if (samples == 0)
+        return -1;
+
+    /* per channel: the first sample and the step index */
+    for (ch = 0; ch < channels; ch++, block += 4)
+    {
+        st[ch].pred = (int16_t)(block[0] | block[1] << 8);
+        st[ch].index = block[2];
+        if (st[ch].index > 88)
+            return -1;
+        out[ch] = (int16_t)st[ch].pred;
+    }
+
+    /* then 4 bytes, 8 samples, of each channel in turn, low nibble first */
+    for (i = 1; i < samples; i += 8)
+    {
+        for (ch = 0; ch < channels; ch++)
+        {
+            for (b = 0; b < 4; b++, block++)
+            {
+                n = i + b * 2;
+                out[n * channels + ch] = _ima_decode(&st[ch], *block & 0x0F);
+                out[(n + 1) * channels + ch] = _ima_decode(&st[ch], *block >> 4);
+            }
+        }
+    }
+
+    return samples;
+}
+
+/* ==================== self-test ==================== */
+
+#define DSP_TEST_INPUTS         400
+#define DSP_TEST_TONE_OUTPUTS   1024
+#define DSP_TEST_MIX            300
+#define DSP_TEST_ADPCM_BLOCK    256
+
+struct dsp_test
+{
+    int16_t in[DSP_TEST_INPUTS * 4];
+    int16_t out[DSP_TEST_INPUTS * 4];
+    int16_t ref[DSP_TEST_INPUTS * 4];
+    int32_t mix[DSP_TEST_MIX];
+    int32_t mix_ref[DSP_TEST_MIX];
+    uint32_t seed;
+    int cases;
+    int failures;
+};
+
+static uint32_t _test_rand(struct dsp_test *t)
+{
+    t->seed = t->seed * 1664525UL + 1013904223UL;
+    return t->seed >> 8;
+}
+
+/* run the converter over in with odd chunk sizes, so the phase is carried between calls */
+static int _src_run(struct dsp_test *t, struct audio_src *s, const int16_t *in, int n_in,
+                    int16_t *out, int n_out)
+{
+    int done = 0, produced = 0, chunk, used, room;
+
+    while (done < n_in && produced < n_out)
+    {
+        chunk = 1 + _test_rand(t) % 37;
+        if (chunk > n_in - done)
+            chunk = n_in - done;
+        room = 1 + _test_rand(t) % 53;
+        if (room > n_out - produced)
+            room = n_out - produced;
+        produced += audio_src_process(s, in + done, chunk, &used, out + produced, room);
+        done += used;
+    }
+
+    return produced;
+}
+
+/*
+ * The converter by its definition: the input zero-stuffed by L, convolved
+ * with the whole prototype filter, every M-th result kept.
+ */
+static int _src_reference(struct dsp_test *t, const struct audio_src *s, int n_in)
+{
+    uint32_t len = (uint32_t)s->up * s->taps;
+    uint32_t n, u;
+    int64_t acc;
+    int m;
+
+    for (m = 0; (uint32_t)m * s->down / s->up < (uint32_t)n_in; m++)
+    {
+        u = (uint32_t)m * s->down;
+        acc = 1 << 14;
+        for (n = 0; n < len && n <= u; n++)
+        {
+            if ((u - n) % s->up == 0)
+                acc += (int32_t)s->coeffs[(n % s->up) * s->taps + s->taps - 1 - n / s->up] * t->in[(u - n) / s->up];
+        }
+        t->ref[m] = _sat16((int32_t)(acc >> 15));
+    }
+
+    return m;
+}
+
+static void _check_src(struct dsp_test *t, uint32_t in_rate, uint32_t out_rate)
+{
+    struct audio_src s;
+    int i, produced, expect;
+
+    t->cases++;
+    if (audio_src_init(&s, in_rate, out_rate) != 0)
+    {
+        dsp_printf("audio_dsp: src %u -> %u not accepted\n", (unsigned)in_rate, (unsigned)out_rate);
+        t->failures++;
+        return;
+    }
+
+    for (i = 0; i < DSP_TEST_INPUTS; i++)
+        t->in[i] = (int16_t)(_test_rand(t) & 0xFFFF);
+    /* full scale steps ring past the rails */
+    for (i = DSP_TEST_INPUTS / 2; i < DSP_TEST_INPUTS / 2 + 40; i++)
+        t->in[i] = (i / 10) & 1 ? 32767 : -32768;
+
+    produced = _src_run(t, &s, t->in, DSP_TEST_INPUTS, t->out, DSP_TEST_INPUTS * 4);
+    if (s.taps == 0)
+    {
+        for (i = 0; i < DSP_TEST_INPUTS; i++)
+            t->ref[i] = t->in[i];
+        expect = DSP_TEST_INPUTS;
+    }
+    else
+    {
+        expect = _src_reference(t, &s, DSP_TEST_INPUTS);
+    }
+
+    if (produced != expect)
+    {
+        dsp_printf("audio_dsp: src %u -> %u: %d outputs, expected %d\n", (unsigned)in_rate,
+                   (unsigned)out_rate, produced, expect);
+        t->failures++;
+        goto __exit;
+    }
+    for (i = 0; i < produced; i++)
+    {
+        if (t->out[i] != t->ref[i])
+        {
+            dsp_printf("audio_dsp: src %u -> %u out[%d] = %d, expected %d\n", (unsigned)in_rate,
+                       (unsigned)out_rate, i, t->out[i], t->ref[i]);
+            t->failures++;
+            goto __exit;
+        }
+    }
+
+    /* past the filter filling up, DC comes out exactly */
+    t->cases++;
+    audio_src_reset(&s);
+    for (i = 0; i < DSP_TEST_INPUTS; i++)
+        t->in[i] = -12345;
+    produced = _src_run(t, &s, t->in, DSP_TEST_INPUTS, t->out, DSP_TEST_INPUTS * 4);
+    for (i = (s.taps + 1) * s.up / s.down; i < produced; i++)
+    {
+        if (t->out[i] != -12345)
+        {
+            dsp_printf("audio_dsp: src %u -> %u dc out[%d] = %d\n", (unsigned)in_rate,
+                       (unsigned)out_rate, i, t->out[i]);
+            t->failures++;
+            break;
+        }
+    }
+
+__exit:
+    audio_src_free(&s);
+}
+
+/*
+ * A tone of freq at in_rate through the converter: the level of the output at
+ * expect Hz (freq itself, or where it aliases to) in dB of the input level,
+ * and the rest of the output in dB below that.
+ */
+static void _src_tone(struct dsp_test *t, struct audio_src *s, uint32_t in_rate, uint32_t out_rate,
+                      uint32_t freq, uint32_t expect, double *level, double *rest)
+{
+    int16_t in[64], out[64];
+    double a = 0, b = 0, e = 0, w, y, amp;
+    int skip = 2 * s->taps * s->up / s->down + 16, n = 0, k = 0, used, got, i;
+    uint32_t pos = 0;
+
+    while (n < skip + DSP_TEST_TONE_OUTPUTS)
+    {
+        if (k == 0)
+        {
+            for (i = 0; i < 64; i++, pos++)
+                in[i] = (int16_t)floor(16000.0 * sin(2.0 * DSP_PI * freq * pos / in_rate) + 0.5);
+        }
+        got = audio_src_process(s, in + k, 64 - k, &used, out, 64);
+        k = (k + used) % 64;
+        for (i = 0; i < got && n < skip + DSP_TEST_TONE_OUTPUTS; i++, n++)
+        {
+            if (n < skip)
+                continue;
+            w = 2.0 * DSP_PI * expect * (n - skip) / out_rate;
+            a += out[i] * sin(w);
+            b += out[i] * cos(w);
+            t->ref[n - skip] = out[i];
+        }
+    }
+
+    a *= 2.0 / DSP_TEST_TONE_OUTPUTS;
+    b *= 2.0 / DSP_TEST_TONE_OUTPUTS;
+    amp = sqrt(a * a + b * b);
+    for (i = 0; i < DSP_TEST_TONE_OUTPUTS; i++)
+    {
+        w = 2.0 * DSP_PI * expect * i / out_rate;
+        y = t->ref[i] - a * sin(w) - b * cos(w);
+        e += y * y;
+    }
+    e = sqrt(2.0 * e / DSP_TEST_TONE_OUTPUTS);
+
+    *level = 20.0 * log10((amp + 1e-3) / 16000.0);
+    *rest = 20.0 * log10((e + 1e-3) / (amp + 1e-3));
+}
+
+static void _check_src_response(struct dsp_test *t, uint32_t in_rate, uint32_t out_rate)
+{
+    struct audio_src s;
+    double level, rest;
+    uint32_t alias;
+
+    if (audio_src_init(&s, in_rate, out_rate) != 0 || s.taps == 0)
+    {
+        audio_src_free(&s);
+        return;
+    }
+
+    /* whole periods in the window: 1 kHz at 16 kHz passes at its level, nothing else over the Q15 floor */
+    t->cases++;
+    _src_tone(t, &s, in_rate, out_rate, out_rate / 16, out_rate / 16, &level, &rest);
+    if (level < -0.1 || level > 0.1 || rest > -70.0)
+    {
+        dsp_printf("audio_dsp: src %u -> %u tone at %d.%02d dB, rest %d dB\n", (unsigned)in_rate,
+                   (unsigned)out_rate, (int)level, (int)(fabs(level) * 100) % 100, (int)rest);
+        t->failures++;
+    }
+
+    /* a tone that would fold back to a quarter of the output rate is gone */
+    alias = out_rate + out_rate / 4;
+    if (in_rate / 2 > alias)
+    {
+        t->cases++;
+        audio_src_reset(&s);
+        _src_tone(t, &s, in_rate, out_rate, alias, out_rate / 4, &level, &rest);
+        if (level > -70.0)
+        {
+            dsp_printf("audio_dsp: src %u -> %u alias at %d dB\n", (unsigned)in_rate, (unsigned)out_rate,
+                       (int)level);
+            t->failures++;
+        }
+    }
+
+    audio_src_free(&s);
+}
+
+static void _check_mix(struct dsp_test *t)
+{
+    static const int16_t gains[][2] =
+    {
+        {0, AUDIO_MIX_UNITY}, {AUDIO_MIX_UNITY, 0}, {16384, 16384}, {1000, 30000}, {-32768, 32767},
+    };
+    int16_t gain, in[2][DSP_TEST_MIX], out[DSP_TEST_MIX];
+    int32_t g[2], target;
+    int i, k, clipped, clipped_ref;
+
+    for (k = 0; k < (int)(sizeof(gains) / sizeof(gains[0])); k++)
+    {
+        t->cases++;
+        for (i = 0; i < DSP_TEST_MIX; i++)
+        {
+            in[0][i] = (int16_t)(_test_rand(t) & 0xFFFF);
+            in[1][i] = (i & 16) ? 32767 : -32768;
+        }
+        memset(t->mix, 0, sizeof(t->mix));
+
+        /* two streams, the second one ramping the other way */
+        gain = gains[k][0];
+        audio_mix_add(t->mix, in[0], 100, &gain, gains[k][1]);
+        audio_mix_add(t->mix + 100, in[0] + 100, DSP_TEST_MIX - 100, &gain, gains[k][1]);
+        gain = gains[k][1];
+        audio_mix_add(t->mix, in[1], DSP_TEST_MIX, &gain, gains[k][0]);
+        clipped = audio_mix_out(out, t->mix, DSP_TEST_MIX);
+
+        /* the gain of each sample stepped on its own, the sum clamped in 64 bits */
+        g[0] = gains[k][0];
+        g[1] = gains[k][1];
+        clipped_ref = 0;
+        for (i = 0; i < DSP_TEST_MIX; i++)
+        {
+            target = gains[k][1];
+            g[0] += (g[0] < target) ? AUDIO_MIX_RAMP_STEP : (g[0] > target) ? -AUDIO_MIX_RAMP_STEP : 0;
+            if ((gains[k][0] < target && g[0] > target) || (gains[k][0] > target && g[0] < target))
+                g[0] = target;
+            target = gains[k][0];
+            g[1] += (g[1] < target) ? AUDIO_MIX_RAMP_STEP : (g[1] > target) ? -AUDIO_MIX_RAMP_STEP : 0;
+            if ((gains[k][1] < target && g[1] > target) || (gains[k][1] > target && g[1] < target))
+                g[1] = target;
+
+            t->mix_ref[i] = (int32_t)(((int64_t)in[0][i] * g[0] + 0x4000) >> 15) +
+                            (int32_t)(((int64_t)in[1][i] * g[1] + 0x4000) >> 15);
+            if (t->mix_ref[i] != _sat16(t->mix_ref[i]))
+                clipped_ref++;
+            if (out[i] != _sat16(t->mix_ref[i]))
+            {
+                dsp_printf("audio_dsp: mix %d out[%d] = %d, expected %d\n", k, i, out[i],
+                           _sat16(t->mix_ref[i]));
+                t->failures++;
+                break;
+            }
+        }
+        if (i == DSP_TEST_MIX && clipped != clipped_ref)
+        {
+            dsp_printf("audio_dsp: mix %d clipped %d, expected %d\n", k, clipped, clipped_ref);
+            t->failures++;
+        }
+    }
+}
+
+/* the encoder of the IMA recommendation, its reconstruction is what a decoder must output */
+static uint8_t _ima_encode(struct ima_state *st, int16_t sample)
+{
+    int32_t step = _ima_steps[st->index];
+    int32_t diff = sample - st->pred;
+    int32_t vpdiff = step >> 3;
+    uint8_t code = 0;
+
+    if (diff < 0)
+    {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step)
+    {
+        code |= 4;
+        diff -= step;
+        vpdiff += step;
+    }
+    step >>= 1;
+    if (diff >= step)
+    {
+        code |= 2;
+        diff -= step;
+        vpdiff += step;
+    }
+    step >>= 1;
+    if (diff >= step)
+    {
+        code |= 1;
+        vpdiff += step;
+    }
+
+    st->pred += (code & 8) ? -vpdiff : vpdiff;
+    if (st->pred > 32767)
+        st->pred = 32767;
+    else if (st->pred < -32768)
+        st->pred = -32768;
+    st->index += _ima_index[code];
+    if (st->index < 0)
+        st->index = 0;
+    else if (st->index > 88)
+        st->index = 88;
+
+    return code;
+}
+
+static void _check_adpcm(struct dsp_test *t, int channels)
+{
+    uint8_t block[DSP_TEST_ADPCM_BLOCK];
+    struct ima_state st[2];
+    int samples = audio_adpcm_block_samples(DSP_TEST_ADPCM_BLOCK, channels);
+    int ch, i, b, n, got;
+    double e = 0, p = 0;
+
+    t->cases++;
+    /* a sweep on the left, a tone with some noise on the right */
+    for (i = 0; i < samples; i++)
+    {
+        t->in[i * channels] = (int16_t)(12000.0 * sin(DSP_PI * i * i / (samples * 8.0)));
+        if (channels == 2)
+            t->in[i * 2 + 1] = (int16_t)(8000.0 * sin(2.0 * DSP_PI * i / 32) + (_test_rand(t) & 0x1FF) - 0x100);
+    }
+
+    for (ch = 0; ch < channels; ch++)
+    {
+        st[ch].pred = t->in[ch];
+        st[ch].index = 40 + ch;
+        block[ch * 4] = (uint8_t)st[ch].pred;
+        block[ch * 4 + 1] = (uint8_t)(st[ch].pred >> 8);
+        block[ch * 4 + 2] = (uint8_t)st[ch].index;
+        block[ch * 4 + 3] = 0;
+        t->ref[ch] = t->in[ch];
+    }
+    for (i = 1, n = 4 * channels; i < samples; i += 8)
+    {
+        for (ch = 0; ch < channels; ch++)
+        {
+            for (b = 0; b < 8; b += 2, n++)
+            {
+                block[n] = _ima_encode(&st[ch], t->in[(i + b) * channels + ch]);
+                t->ref[(i + b) * channels + ch] = (int16_t)st[ch].pred;
+                block[n] |= _ima_encode(&st[ch], t->in[(i + b + 1) * channels + ch]) << 4;
+                t->ref[(i + b + 1) * channels + ch] = (int16_t)st[ch].pred;
+            }
+        }
+    }
+
+    got = audio_adpcm_decode_block(block, DSP_TEST_ADPCM_BLOCK, channels, t->out);
+    if (got != samples)
+    {
+        dsp_printf("audio_dsp: adpcm %d ch: %d samples, expected %d\n", channels, got, samples);
+        t->failures++;
+        return;
+    }
+    for (i = 0; i < samples * channels; i++)
+    {
+        if (t->out[i] != t->ref[i])
+        {
+            dsp_printf("audio_dsp: adpcm %d ch out[%d] = %d, expected %d\n", channels, i, t->out[i],
+                       t->ref[i]);
+            t->failures++;
+            return;
+        }
+        e += (double)(t->out[i] - t->in[i]) * (t->out[i] - t->in[i]);
+        p += (double)t->in[i] * t->in[i];
+    }
+
+    /* and it is still the signal: 4 bits per sample keep well over 20 dB */
+    t->cases++;
+    if (10.0 * log10(p / (e + 1.0)) < 20.0)
+    {
+        dsp_printf("audio_dsp: adpcm %d ch snr %d dB\n", channels, (int)(10.0 * log10(p / (e + 1.0))));
+        t->failures++;
+    }
+
+    /* a step index past the table is refused */
+    t->cases++;
+    block[2] = 89;
+    if (audio_adpcm_decode_block(block, DSP_TEST_ADPCM_BLOCK, channels, t->out) != -1)
+    {
+        dsp_printf("audio_dsp: adpcm %d ch accepted index 89\n", channels);
+        t->failures++;
+    }
+}
+
+int audio_dsp_selftest(void)
+{
+    static const uint32_t rates[] = {8000, 11025, 16000, 22050, 32000, 44100, 48000};
+    struct dsp_test *t;
+    struct audio_src s;
+    int i, failures;
+
+    t = dsp_malloc(sizeof(*t));
+    if (t == NULL)
+        return 1;
+    memset(t, 0, sizeof(*t));
+    t->seed = 1;
+
+    for (i = 0; i < (int)(sizeof(rates) / sizeof(rates[0])); i++)
+    {
+        _check_src(t, rates[i], 16000);
+        _check_src_response(t, rates[i], 16000);
+    }
+    _check_src(t, 16000, 8000);
+    _check_src(t, 16000, 48000);
+    _check_src(t, 44100, 48000);
+    _check_src_response(t, 44100, 48000);
+
+    /* 1 Hz steps cannot be reduced to a phase table */
+    t->cases++;
+    if (audio_src_init(&s, 44101, 16000) == 0)
+    {
+        dsp_printf("audio_dsp: src 44101 -> 16000 accepted\n");
+        t->failures++;
+        audio_src_free(&s);
+    }
+
+    _check_mix(t);
+    _check_adpcm(t, 1);
+    _check_adpcm(t, 2);
+
+    dsp_printf("audio_dsp: %d cases, %d failures\n", t->cases, t->failures);
+
+    failures = t->failures;
+    dsp_free(t);
+    return failures;
+}
+
+#ifdef AUDIO_DSP_HOST
+int main(void)
+{
+    return audio_dsp_selftest() == 0 ? 0 : 1;
+}
+#endif /* AUDIO_DSP_HOST */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Description: Sample rate converter, mixer and IMA ADPCM decoder for the
+ *              prompt player
+ *
+ * No RT-Thread dependency, so the same code is checked on a PC (see
+ * audio_dsp.c) and on the board (prompt selftest).
+ */
+
+#ifndef __AUDIO_DSP_H__
+#define __AUDIO_DSP_H__
+
+#include <stdint.h>
+
+/* ==================== Sample rate converter ==================== */
+
+/*
+ * Polyphase rational resampler, out = in * up / down: the input zero-stuffed
+ * by up, a windowed-sinc low-pass at the lower of the two Nyquist rates, then
+ * every down-th sample kept. Only the taps that meet a non-zero input are
+ * computed, one phase of the filter per output, the coefficients laid out
+ * phase by phase in reverse like arm_fir_interpolate_q15().
+ *
+ * Every phase sums to exactly 1.0 in Q15, so DC passes unchanged. Taps per
+ * phase grow with the decimation ratio, to keep the transition band in
+ * proportion to the output rate.
+ */
+
+#define AUDIO_SRC_ZEROS         8       /* sinc zero crossings each side, at ratio 1 */
+#define AUDIO_SRC_TAPS_MAX      64      /* per phase */
+#define AUDIO_SRC_UP_MAX        640     /* 11025 -> 16000 */
+#define AUDIO_SRC_PASSBAND      0.45    /* cutoff, in cycles of the lower rate */
+
+struct audio_src
+{
+    uint16_t up;                /* L */
+    uint16_t down;              /* M */
+    uint16_t taps;              /* per phase, 0 when in and out rates are equal */
+    uint16_t phase;             /* of the next output, >= up when it needs an input first */
+    uint16_t head;              /* next write in history */
+    int16_t *coeffs;            /* up * taps, Q15 */
+    int16_t *history;           /* 2 * taps, the newest taps samples at head .. head + taps - 1 */
+};
+
+/* 0, or -1 when the ratio does not reduce to L <= AUDIO_SRC_UP_MAX or memory ran out */
+int audio_src_init(struct audio_src *s, uint32_t in_rate, uint32_t out_rate);
+void audio_src_free(struct audio_src *s);
+void audio_src_reset(struct audio_src *s);
+/* the filter delay, in input samples */
+int audio_src_delay(const struct audio_src *s);
+/*
+ * Convert up to n_in samples of in into at most n_out samples of out.
+ * Returns the outputs produced and stores the inputs taken in *used; an
+ * input is only taken when an output needs it, so call again with the rest.
+ */
+int audio_src_process(struct audio_src *s, const int16_t *in, int n_in, int *used,
+                      int16_t *out, int n_out);
+
+/* ==================== Mixer ==================== */
+
+#define AUDIO_MIX_UNITY         32767   /* Q15 gain of 1.0 */
+#define AUDIO_MIX_RAMP_STEP     128     /* gain change per sample, 256 samples from 0 to 1.0 */
+
+/*
+ * Add n samples of in, scaled by *gain, into the mix. *gain moves toward
+ * target by AUDIO_MIX_RAMP_STEP per sample, so starts, stops and volume
+ * changes do not click.
+ */
+void audio_mix_add(int32_t *mix, const int16_t *in, int n, int16_t *gain, int16_t target);
+/* saturate the mix into out, returns the samples clipped */
+int audio_mix_out(int16_t *out, const int32_t *mix, int n);
+
+/* ==================== IMA ADPCM ==================== */
+
+/* samples per channel in a WAV IMA ADPCM block (format 0x11, 4 bits) */
+int audio_adpcm_block_samples(int block_align, int channels);
+/*
+ * Decode a WAV IMA ADPCM block of block_align bytes into interleaved 16-bit
+ * samples. Returns the samples per channel, -1 for a broken header.
+ */
+int audio_adpcm_decode_block(const uint8_t *block, int block_align, int channels, int16_t *out);
+
+/* compare with the direct form of each, returns the failures */
+int audio_dsp_selftest(void);
+
+#endif /* __AUDIO_DSP_H__ */
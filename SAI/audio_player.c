@@ -0,0 +1,770 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Description: Prompt player - WAV and IMA ADPCM prompts from SD card or
+ *              flash, mixed into the replay device
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <string.h>
+#include <stdlib.h>
+#include "audio_player.h"
+#include "audio_dsp.h"
+#include "stm32h7rsxx_hal.h"
+
+#ifdef RT_USING_DFS
+#include <dfs_file.h>
+#ifdef RT_USING_POSIX_FS
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <dfs_posix.h>
+#endif
+#endif
+
+#define DBG_TAG "audio.player"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+
+#define WAV_FORMAT_PCM          0x0001
+#define WAV_FORMAT_IMA_ADPCM    0x0011
+
+/* stream states */
+#define STREAM_FREE             0
+#define STREAM_PLAYING          1
+#define STREAM_STOPPING         2           /* fading out */
+#define STREAM_DONE             3           /* finished, its statistics kept until the slot is reused */
+
+typedef struct {
+    rt_uint8_t state;
+    int id;
+    char name[32];
+
+    /* source: a file, or a WAV image in memory */
+    int fd;
+    const rt_uint8_t *mem;
+    rt_uint32_t mem_pos;
+    rt_uint32_t data_left;              /* bytes of the data chunk not read yet */
+
+    rt_uint16_t format;
+    rt_uint16_t channels;
+    rt_uint16_t block_align;
+    rt_uint32_t rate;
+
+    rt_uint8_t *raw;                    /* one ADPCM block */
+    rt_int16_t *pcm;                    /* decoded, mono */
+    int pcm_len;
+    int pcm_pos;
+    int flush;                          /* zeros still to push through the converter at the end */
+    struct audio_src src;
+
+    rt_int16_t gain;                    /* Q15, ramping toward volume */
+    rt_int16_t volume;
+
+    /* statistics */
+    rt_tick_t requested;
+    rt_uint32_t latency_us;             /* request to the first sample leaving the SAI, 0 until known */
+    rt_uint64_t cycles;                 /* decode, convert and mix */
+    rt_uint64_t io_cycles;              /* reading the source */
+    rt_uint32_t samples;                /* output samples */
+} player_stream_t;
+
+typedef struct {
+    player_stream_t streams[AUDIO_PLAYER_STREAMS_MAX];
+    struct rt_mutex lock;
+    struct rt_semaphore wake;
+    rt_thread_t thread;
+    int next_id;
+
+    rt_device_t dev;                    /* open while anything plays */
+    rt_uint32_t rate;
+    rt_uint32_t written;                /* replay blocks written */
+    volatile rt_uint32_t consumed;      /* replay blocks handed to the SAI DMA */
+
+    rt_int32_t mix[AUDIO_PLAYER_PERIOD];
+    rt_int16_t out[AUDIO_PLAYER_PERIOD];
+    rt_int16_t tmp[AUDIO_PLAYER_PERIOD];
+
+    struct {
+        rt_uint32_t periods;
+        rt_uint32_t starved;            /* periods written with nothing queued ahead */
+        rt_uint32_t clipped;
+        rt_uint64_t mix_cycles;         /* saturating the mix, shared by all streams */
+        rt_uint32_t streams;
+        rt_uint32_t latency_min_us;
+        rt_uint32_t latency_max_us;
+        rt_uint64_t latency_sum_us;
+    } stats;
+} audio_player_t;
+
+static audio_player_t g_player;
+
+/* ==================== Source ==================== */
+
+static int stream_read(player_stream_t *s, void *buf, rt_uint32_t len)
+{
+    rt_uint32_t start = DWT->CYCCNT;
+    int got;
+
+    if (s->mem)
+    {
+        rt_memcpy(buf, s->mem + s->mem_pos, len);
+        s->mem_pos += len;
+        got = len;
+    }
+    else
+    {
+#ifdef RT_USING_DFS
+        got = read(s->fd, buf, len);
+#else
+        got = -1;
+#endif
+    }
+
+    s->io_cycles += DWT->CYCCNT - start;
+    return got;
+}
+
+static int stream_skip(player_stream_t *s, rt_uint32_t len)
+{
+    if (s->mem)
+    {
+        s->mem_pos += len;
+        return 0;
+    }
+#ifdef RT_USING_DFS
+    return lseek(s->fd, len, SEEK_CUR) < 0 ? -1 : 0;
+#else
+    return -1;
+#endif
+}
+
+static rt_uint16_t le16(const rt_uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static rt_uint32_t le32(const rt_uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (rt_uint32_t)p[3] << 24;
+}
+
+/* up to the start of the data chunk, with the format of it */
+static rt_err_t stream_parse(player_stream_t *s, rt_uint32_t size)
+{
+    rt_uint8_t hdr[20];
+    rt_uint32_t chunk, pos = 12;
+    rt_uint16_t bits = 0;
+
+    if (stream_read(s, hdr, 12) != 12 || rt_memcmp(hdr, "RIFF", 4) || rt_memcmp(hdr + 8, "WAVE", 4))
+        return -RT_EINVAL;
+
+    for (;;)
+    {
+        if (pos + 8 > size || stream_read(s, hdr, 8) != 8)
+            return -RT_EINVAL;
+        chunk = le32(hdr + 4);
+        pos += 8;
+
+        if (!rt_memcmp(hdr, "data", 4))
+            break;
+        if (chunk > size - pos)
+            return -RT_EINVAL;
+
+        if (!rt_memcmp(hdr, "fmt ", 4) && chunk >= 16)
+        {
+            if (stream_read(s, hdr, 16) != 16)
+                return -RT_EINVAL;
+            s->format = le16(hdr);
+            s->channels = le16(hdr + 2);
+            s->rate = le32(hdr + 4);
+            s->block_align = le16(hdr + 12);
+            bits = le16(hdr + 14);
+            chunk -= 16;
+            pos += 16;
+        }
+        /* chunks are padded to an even size */
+        if (stream_skip(s, chunk + (chunk & 1)) != 0)
+            return -RT_EINVAL;
+        pos += chunk + (chunk & 1);
+    }
+
+    /* a data chunk size past the end of the file is how streamed WAVs come */
+    s->data_left = chunk;
+    if (pos + s->data_left > size)
+        s->data_left = size - pos;
+
+    if (s->channels < 1 || s->channels > 2)
+        return -RT_EINVAL;
+    if (s->format == WAV_FORMAT_PCM && bits == 16)
+        return RT_EOK;
+    if (s->format == WAV_FORMAT_IMA_ADPCM && bits == 4 && s->block_align <= AUDIO_PLAYER_ADPCM_BLOCK_MAX &&
+        audio_adpcm_block_samples(s->block_align, s->channels) > 0)
+        return RT_EOK;
+
+    LOG_W("%s: format 0x%04X %d bit not supported", s->name, s->format, bits);
+    return -RT_ENOSYS;
+}
+
+/* the next chunk of the source, decoded to mono; 0 at the end */
+static int stream_decode(player_stream_t *s)
+{
+    rt_uint32_t bytes;
+    int frames, i, align;
+
+    if (s->data_left == 0)
+        return 0;
+
+    if (s->format == WAV_FORMAT_PCM)
+    {
+        /* little endian like the core, read straight into place */
+        bytes = AUDIO_PLAYER_PCM_CHUNK * 2 * s->channels;
+        if (bytes > s->data_left)
+            bytes = s->data_left;
+        if (stream_read(s, s->pcm, bytes) != (int)bytes)
+            return 0;
+        s->data_left -= bytes;
+        frames = bytes / (2 * s->channels);
+    }
+    else
+    {
+        /* the last block may be short, decode what it holds */
+        bytes = s->block_align < s->data_left ? s->block_align : s->data_left;
+        if (stream_read(s, s->raw, bytes) != (int)bytes)
+            return 0;
+        s->data_left -= bytes;
+        align = 4 * s->channels;
+        if (bytes <= (rt_uint32_t)align)
+            return 0;
+        align += (bytes - align) / align * align;
+        frames = audio_adpcm_decode_block(s->raw, align, s->channels, s->pcm);
+        if (frames <= 0)
+            return 0;
+    }
+
+    /* stereo prompts to the mono replay */
+    if (s->channels == 2)
+    {
+        for (i = 0; i < frames; i++)
+            s->pcm[i] = (rt_int16_t)((s->pcm[2 * i] + s->pcm[2 * i + 1]) / 2);
+    }
+
+    s->pcm_len = frames;
+    s->pcm_pos = 0;
+    return frames;
+}
+
+/* n output samples at the player rate, fewer once the stream has ended */
+static int stream_pull(player_stream_t *s, rt_int16_t *out, int n)
+{
+    int produced = 0, used;
+
+    while (produced < n)
+    {
+        if (s->pcm_pos == s->pcm_len && stream_decode(s) == 0)
+        {
+            /* the tail of the prompt still in the filter */
+            if (s->flush == 0)
+                break;
+            s->pcm_len = s->flush < AUDIO_PLAYER_PCM_CHUNK ? s->flush : AUDIO_PLAYER_PCM_CHUNK;
+            s->pcm_pos = 0;
+            s->flush -= s->pcm_len;
+            rt_memset(s->pcm, 0, s->pcm_len * sizeof(rt_int16_t));
+        }
+
+        produced += audio_src_process(&s->src, s->pcm + s->pcm_pos, s->pcm_len - s->pcm_pos, &used,
+                                      out + produced, n - produced);
+        s->pcm_pos += used;
+    }
+
+    return produced;
+}
+
+static void stream_release(player_stream_t *s)
+{
+#ifdef RT_USING_DFS
+    if (s->fd >= 0)
+        close(s->fd);
+#endif
+    s->fd = -1;
+    audio_src_free(&s->src);
+    if (s->raw)
+        rt_free(s->raw);
+    if (s->pcm)
+        rt_free(s->pcm);
+    s->raw = RT_NULL;
+    s->pcm = RT_NULL;
+}
+
+/* ==================== Player Thread ==================== */
+
+static rt_err_t player_tx_done(rt_device_t dev, void *buffer)
+{
+    /* a replay block went into the SAI DMA buffer */
+    g_player.consumed++;
+    return RT_EOK;
+}
+
+static rt_uint32_t player_rate(void)
+{
+    struct rt_audio_caps caps;
+    rt_device_t dev = rt_device_find(INMP441_REPLAY_DEVICE);
+
+    /* the replay runs on the clocks of the microphone, so at its rate */
+    caps.main_type = AUDIO_TYPE_OUTPUT;
+    caps.sub_type = AUDIO_DSP_SAMPLERATE;
+    if (dev == RT_NULL || rt_device_control(dev, AUDIO_CTL_GETCAPS, &caps) != RT_EOK)
+        return 0;
+    return caps.udata.config.samplerate;
+}
+
+static rt_err_t player_open(audio_player_t *p)
+{
+    struct rt_audio_caps caps;
+    rt_err_t result;
+
+    p->dev = rt_device_find(INMP441_REPLAY_DEVICE);
+    if (p->dev == RT_NULL)
+        return -RT_ENOSYS;
+
+    p->rate = player_rate();
+    caps.main_type = AUDIO_TYPE_OUTPUT;
+    caps.sub_type = AUDIO_DSP_PARAM;
+    caps.udata.config.samplerate = p->rate;
+    caps.udata.config.channels = 1;
+    caps.udata.config.samplebits = 16;
+    result = rt_device_control(p->dev, AUDIO_CTL_CONFIGURE, &caps);
+    if (result == RT_EOK)
+        result = rt_device_open(p->dev, RT_DEVICE_OFLAG_WRONLY);
+    if (result != RT_EOK)
+    {
+        LOG_E("open %s failed: %d", INMP441_REPLAY_DEVICE, result);
+        p->dev = RT_NULL;
+        return result;
+    }
+
+    p->written = p->consumed = 0;
+    rt_device_set_tx_complete(p->dev, player_tx_done);
+    LOG_D("%s open, %d Hz", INMP441_REPLAY_DEVICE, p->rate);
+    return RT_EOK;
+}
+
+static void player_close(audio_player_t *p)
+{
+    rt_device_set_tx_complete(p->dev, RT_NULL);
+    rt_device_close(p->dev);
+    p->dev = RT_NULL;
+    LOG_D("%s closed", INMP441_REPLAY_DEVICE);
+}
+
+static rt_bool_t player_active(audio_player_t *p)
+{
+    int i;
+
+    for (i = 0; i < AUDIO_PLAYER_STREAMS_MAX; i++)
+    {
+        if (p->streams[i].state == STREAM_PLAYING || p->streams[i].state == STREAM_STOPPING)
+            return RT_TRUE;
+    }
+    return RT_FALSE;
+}
+
+static void player_finish(audio_player_t *p, player_stream_t *s)
+{
+    stream_release(s);
+    s->state = STREAM_DONE;
+    LOG_D("%s done, %d samples", s->name, s->samples);
+}
+
+/* how long until a sample written now leaves the SAI: the queued blocks and both DMA halves */
+static rt_uint32_t player_ahead_us(audio_player_t *p)
+{
+    rt_uint32_t queued = p->written - p->consumed;
+    rt_uint32_t bytes = queued * RT_AUDIO_REPLAY_MP_BLOCK_SIZE + 2 * SAI_TX_BLOCK_BYTES;
+
+    return (rt_uint32_t)((rt_uint64_t)bytes * 1000000 / (p->rate * sizeof(rt_int16_t)));
+}
+
+static void player_latency(audio_player_t *p, player_stream_t *s)
+{
+    rt_uint32_t waited = (rt_tick_get() - s->requested) * (1000000 / RT_TICK_PER_SECOND);
+
+    s->latency_us = waited + player_ahead_us(p);
+    if (p->stats.streams == 0 || s->latency_us < p->stats.latency_min_us)
+        p->stats.latency_min_us = s->latency_us;
+    if (s->latency_us > p->stats.latency_max_us)
+        p->stats.latency_max_us = s->latency_us;
+    p->stats.latency_sum_us += s->latency_us;
+    p->stats.streams++;
+}
+
+static void player_period(audio_player_t *p)
+{
+    player_stream_t *s;
+    rt_uint32_t start;
+    rt_uint64_t io;
+    int i, n;
+
+    rt_memset(p->mix, 0, sizeof(p->mix));
+
+    rt_mutex_take(&p->lock, RT_WAITING_FOREVER);
+    for (i = 0; i < AUDIO_PLAYER_STREAMS_MAX; i++)
+    {
+        s = &p->streams[i];
+        if (s->state != STREAM_PLAYING && s->state != STREAM_STOPPING)
+            continue;
+
+        /* the file reads are not the player's CPU time, the DSP is */
+        io = s->io_cycles;
+        start = DWT->CYCCNT;
+        n = stream_pull(s, p->tmp, AUDIO_PLAYER_PERIOD);
+        audio_mix_add(p->mix, p->tmp, n, &s->gain, s->state == STREAM_STOPPING ? 0 : s->volume);
+        s->cycles += (rt_uint32_t)(DWT->CYCCNT - start) - (s->io_cycles - io);
+
+        if (s->samples == 0 && n > 0)
+            player_latency(p, s);
+        s->samples += n;
+
+        if (n < (int)AUDIO_PLAYER_PERIOD || (s->state == STREAM_STOPPING && s->gain == 0))
+            player_finish(p, s);
+    }
+    rt_mutex_release(&p->lock);
+
+    start = DWT->CYCCNT;
+    p->stats.clipped += audio_mix_out(p->out, p->mix, AUDIO_PLAYER_PERIOD);
+    p->stats.mix_cycles += (rt_uint32_t)(DWT->CYCCNT - start);
+
+    if (p->written > 0 && p->written == p->consumed)
+        p->stats.starved++;
+
+    /* one replay block, waits while both queued blocks are still to go */
+    rt_device_write(p->dev, 0, p->out, sizeof(p->out));
+    p->written++;
+    p->stats.periods++;
+}
+
+static void player_entry(void *parameter)
+{
+    audio_player_t *p = (audio_player_t *)parameter;
+
+    while (1)
+    {
+        if (!player_active(p))
+        {
+            if (p->dev == RT_NULL)
+            {
+                rt_sem_take(&p->wake, RT_WAITING_FOREVER);
+            }
+            else if (rt_sem_take(&p->wake, rt_tick_from_millisecond(AUDIO_PLAYER_IDLE_MS)) != RT_EOK)
+            {
+                /* keeps the replay running between prompts of one dialog */
+                player_close(p);
+            }
+            continue;
+        }
+
+        if (p->dev == RT_NULL && player_open(p) != RT_EOK)
+        {
+            /* nothing to play them on */
+            rt_mutex_take(&p->lock, RT_WAITING_FOREVER);
+            for (int i = 0; i < AUDIO_PLAYER_STREAMS_MAX; i++)
+            {
+                if (p->streams[i].state == STREAM_PLAYING || p->streams[i].state == STREAM_STOPPING)
+                    player_finish(p, &p->streams[i]);
+            }
+            rt_mutex_release(&p->lock);
+            continue;
+        }
+
+        player_period(p);
+    }
+}
+
+/* ==================== Public API ==================== */
+
+int audio_player_init(void)
+{
+    audio_player_t *p = &g_player;
+
+    if (p->thread)
+        return RT_EOK;
+
+    rt_mutex_init(&p->lock, "player", RT_IPC_FLAG_PRIO);
+    rt_sem_init(&p->wake, "player", 0, RT_IPC_FLAG_FIFO);
+    for (int i = 0; i < AUDIO_PLAYER_STREAMS_MAX; i++)
+        p->streams[i].fd = -1;
+
+    p->thread = rt_thread_create("player", player_entry, p, AUDIO_PLAYER_STACK_SIZE,
+                                 AUDIO_PLAYER_PRIORITY, 10);
+    if (p->thread == RT_NULL)
+    {
+        LOG_E("Failed to create player thread");
+        return -RT_ENOMEM;
+    }
+
+    rt_thread_startup(p->thread);
+    return RT_EOK;
+}
+INIT_APP_EXPORT(audio_player_init);
+
+static int player_start(player_stream_t *src, rt_uint32_t size, int volume)
+{
+    audio_player_t *p = &g_player;
+    player_stream_t *s = RT_NULL;
+    rt_uint32_t rate, samples;
+    rt_err_t result;
+    int i;
+
+    if (p->thread == RT_NULL)
+        return -RT_ERROR;
+
+    rate = player_rate();
+    result = stream_parse(src, size);
+    if (result == RT_EOK && (rate == 0 || audio_src_init(&src->src, src->rate, rate) != 0))
+    {
+        LOG_W("%s: no conversion from %d Hz to %d Hz", src->name, src->rate, rate);
+        result = -RT_ENOSYS;
+    }
+
+    if (result == RT_EOK)
+    {
+        /* the zeros flushing the converter go through pcm too */
+        samples = AUDIO_PLAYER_PCM_CHUNK * src->channels;
+        if (src->format == WAV_FORMAT_IMA_ADPCM)
+        {
+            samples = audio_adpcm_block_samples(src->block_align, src->channels) * src->channels;
+            if (samples < AUDIO_PLAYER_PCM_CHUNK)
+                samples = AUDIO_PLAYER_PCM_CHUNK;
+            src->raw = rt_malloc(src->block_align);
+            if (src->raw == RT_NULL)
+                result = -RT_ENOMEM;
+        }
+        src->pcm = rt_malloc(samples * sizeof(rt_int16_t));
+        if (src->pcm == RT_NULL)
+            result = -RT_ENOMEM;
+    }
+    if (result != RT_EOK)
+    {
+        stream_release(src);
+        return result;
+    }
+
+    if (volume < 0)
+        volume = 0;
+    else if (volume > 100)
+        volume = 100;
+    src->flush = 2 * audio_src_delay(&src->src);
+    src->volume = (rt_int16_t)(volume * AUDIO_MIX_UNITY / 100);
+    src->gain = 0;
+
+    rt_mutex_take(&p->lock, RT_WAITING_FOREVER);
+    for (i = 0; i < AUDIO_PLAYER_STREAMS_MAX; i++)
+    {
+        if (p->streams[i].state == STREAM_FREE || p->streams[i].state == STREAM_DONE)
+        {
+            s = &p->streams[i];
+            break;
+        }
+    }
+    if (s)
+    {
+        *s = *src;
+        s->id = ++p->next_id;
+        s->state = STREAM_PLAYING;
+    }
+    rt_mutex_release(&p->lock);
+
+    if (s == RT_NULL)
+    {
+        LOG_W("%s: all %d streams busy", src->name, AUDIO_PLAYER_STREAMS_MAX);
+        stream_release(src);
+        return -RT_EBUSY;
+    }
+
+    LOG_I("#%d %s: %s %d Hz %d ch -> %d Hz", s->id, s->name,
+          s->format == WAV_FORMAT_PCM ? "PCM" : "IMA ADPCM", s->rate, s->channels, rate);
+    rt_sem_release(&p->wake);
+    return s->id;
+}
+
+int audio_player_play(const char *path, int volume)
+{
+#ifdef RT_USING_DFS
+    player_stream_t src;
+    struct stat st;
+
+    rt_memset(&src, 0, sizeof(src));
+    src.requested = rt_tick_get();
+    rt_strncpy(src.name, path, sizeof(src.name) - 1);
+
+    if (stat(path, &st) != 0)
+        return -RT_EEMPTY;
+    src.fd = open(path, O_RDONLY);
+    if (src.fd < 0)
+    {
+        LOG_E("Failed to open %s", path);
+        return -RT_EIO;
+    }
+
+    return player_start(&src, st.st_size, volume);
+#else
+    return -RT_ENOSYS;
+#endif
+}
+
+int audio_player_play_wav(const void *wav, rt_size_t size, int volume)
+{
+    player_stream_t src;
+
+    rt_memset(&src, 0, sizeof(src));
+    src.requested = rt_tick_get();
+    rt_strncpy(src.name, "(memory)", sizeof(src.name) - 1);
+    src.fd = -1;
+    src.mem = (const rt_uint8_t *)wav;
+
+    return player_start(&src, size, volume);
+}
+
+rt_err_t audio_player_stop(int id)
+{
+    audio_player_t *p = &g_player;
+    rt_err_t result = -RT_EEMPTY;
+    int i;
+
+    rt_mutex_take(&p->lock, RT_WAITING_FOREVER);
+    for (i = 0; i < AUDIO_PLAYER_STREAMS_MAX; i++)
+    {
+        if (p->streams[i].state == STREAM_PLAYING && (id < 0 || p->streams[i].id == id))
+        {
+            p->streams[i].state = STREAM_STOPPING;
+            result = RT_EOK;
+        }
+    }
+    rt_mutex_release(&p->lock);
+
+    return result;
+}
+
+rt_err_t audio_player_set_volume(int id, int volume)
+{
+    audio_player_t *p = &g_player;
+    rt_err_t result = -RT_EEMPTY;
+    int i;
+
+    if (volume < 0 || volume > 100)
+        return -RT_EINVAL;
+
+    rt_mutex_take(&p->lock, RT_WAITING_FOREVER);
+    for (i = 0; i < AUDIO_PLAYER_STREAMS_MAX; i++)
+    {
+        if (p->streams[i].state == STREAM_PLAYING && p->streams[i].id == id)
+        {
+            p->streams[i].volume = (rt_int16_t)(volume * AUDIO_MIX_UNITY / 100);
+            result = RT_EOK;
+        }
+    }
+    rt_mutex_release(&p->lock);
+
+    return result;
+}
+
+rt_bool_t audio_player_busy(void)
+{
+    return player_active(&g_player);
+}
+
+/* ==================== Shell Commands ==================== */
+
+/* cycles over the audio they produced, in hundredths of a percent of the CPU */
+static rt_uint32_t player_cpu(rt_uint64_t cycles, rt_uint32_t samples, rt_uint32_t rate)
+{
+    if (samples == 0)
+        return 0;
+    return (rt_uint32_t)(cycles * rate * 10000 / ((rt_uint64_t)samples * SystemCoreClock));
+}
+
+static void player_stat(audio_player_t *p)
+{
+    static const char *states[] = {"free", "playing", "stopping", "done"};
+    player_stream_t *s;
+    rt_uint32_t cpu, period_us;
+    int i;
+
+    period_us = p->rate ? (rt_uint32_t)((rt_uint64_t)AUDIO_PLAYER_PERIOD * 1000000 / p->rate) : 0;
+    rt_kprintf("player: %s %s, %u Hz mono, period %u samples (%u us)\n", INMP441_REPLAY_DEVICE,
+               p->dev ? "open" : "closed", p->rate, (rt_uint32_t)AUDIO_PLAYER_PERIOD, period_us);
+    rt_kprintf("  %u periods, %u starved, %u samples clipped, %u blocks queued now\n",
+               p->stats.periods, p->stats.starved, p->stats.clipped,
+               p->dev ? p->written - p->consumed : 0);
+    if (p->stats.streams)
+    {
+        rt_kprintf("  latency over %u streams: min %u us, avg %u us, max %u us\n", p->stats.streams,
+                   p->stats.latency_min_us, (rt_uint32_t)(p->stats.latency_sum_us / p->stats.streams),
+                   p->stats.latency_max_us);
+    }
+    cpu = player_cpu(p->stats.mix_cycles, p->stats.periods * AUDIO_PLAYER_PERIOD, p->rate);
+    rt_kprintf("  mix out: %u.%02u%% CPU\n", cpu / 100, cpu % 100);
+
+    rt_kprintf("  id  state     in           latency  CPU     io ms  name\n");
+    for (i = 0; i < AUDIO_PLAYER_STREAMS_MAX; i++)
+    {
+        s = &p->streams[i];
+        if (s->state == STREAM_FREE)
+            continue;
+        cpu = player_cpu(s->cycles, s->samples, p->rate);
+        rt_kprintf("  %-3d %-9s %-5s %5uHz %5u us  %u.%02u%%  %-5u  %s\n", s->id, states[s->state],
+                   s->format == WAV_FORMAT_PCM ? "pcm" : "adpcm", s->rate, s->latency_us,
+                   cpu / 100, cpu % 100, (rt_uint32_t)(s->io_cycles / (SystemCoreClock / 1000)), s->name);
+    }
+}
+
+static int prompt(int argc, char **argv)
+{
+    audio_player_t *p = &g_player;
+    int result;
+
+    if (argc >= 3 && !rt_strcmp(argv[1], "play"))
+    {
+        result = audio_player_play(argv[2], argc >= 4 ? atoi(argv[3]) : 80);
+        if (result < 0)
+            rt_kprintf("play %s failed: %d\n", argv[2], result);
+        else
+            rt_kprintf("#%d playing\n", result);
+    }
+    else if (argc >= 2 && !rt_strcmp(argv[1], "stop"))
+    {
+        audio_player_stop(argc >= 3 ? atoi(argv[2]) : -1);
+    }
+    else if (argc >= 4 && !rt_strcmp(argv[1], "volume"))
+    {
+        if (audio_player_set_volume(atoi(argv[2]), atoi(argv[3])) != RT_EOK)
+            rt_kprintf("no stream #%s playing\n", argv[2]);
+    }
+    else if (argc >= 2 && !rt_strcmp(argv[1], "stat"))
+    {
+        if (argc >= 3 && !rt_strcmp(argv[2], "reset"))
+            rt_memset(&p->stats, 0, sizeof(p->stats));
+        else
+            player_stat(p);
+    }
+    else if (argc >= 2 && !rt_strcmp(argv[1], "selftest"))
+    {
+        audio_dsp_selftest();
+    }
+    else
+    {
+        rt_kprintf("Usage:\n");
+        rt_kprintf("prompt play <file.wav> [volume] - play a prompt, volume 0..100\n");
+        rt_kprintf("prompt stop [id]                - fade out one or all prompts\n");
+        rt_kprintf("prompt volume <id> <volume>     - change the volume of a prompt\n");
+        rt_kprintf("prompt stat [reset]             - latency and CPU per stream\n");
+        rt_kprintf("prompt selftest                 - check converter, mixer and ADPCM\n");
+    }
+
+    return 0;
+}
+MSH_CMD_EXPORT(prompt, audio prompts: prompt <play|stop|volume|stat|selftest>);
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Description: Prompt player - WAV and IMA ADPCM prompts from SD card or
+ *              flash, mixed into the replay device
+ *
+ * Each stream is decoded, converted to the SAI rate and mixed in the player
+ * thread, one period at a time, into INMP441_REPLAY_DEVICE. The replay runs
+ * on the clocks of the microphone, so recording goes on while it plays.
+ */
+
+#ifndef __AUDIO_PLAYER_H__
+#define __AUDIO_PLAYER_H__
+
+#include <rtthread.h>
+#include "drv_sai_inmp441.h"
+
+/* Player Configuration */
+#define AUDIO_PLAYER_STREAMS_MAX        4
+#define AUDIO_PLAYER_STACK_SIZE         2048
+#define AUDIO_PLAYER_PRIORITY           8           /* above capture and processing, it must not starve the DMA */
+#define AUDIO_PLAYER_IDLE_MS            2000        /* sound0 stays open this long after the last stream */
+#define AUDIO_PLAYER_PCM_CHUNK          256         /* frames read from a PCM file at a time */
+#define AUDIO_PLAYER_ADPCM_BLOCK_MAX    2048        /* largest IMA ADPCM block_align accepted */
+
+/* one replay block of mono 16-bit samples per period */
+#define AUDIO_PLAYER_PERIOD             (RT_AUDIO_REPLAY_MP_BLOCK_SIZE / sizeof(rt_int16_t))
+
+/**
+ * @brief Initialize the player thread, done at boot
+ */
+int audio_player_init(void);
+
+/**
+ * @brief Play a WAV file (16-bit PCM or IMA ADPCM, mono or stereo, any rate)
+ * @param path file on any mounted file system, /sdcard or flash
+ * @param volume 0..100
+ * @return stream id (> 0), or a negative error code
+ */
+int audio_player_play(const char *path, int volume);
+
+/**
+ * @brief Play a WAV image in memory, e.g. a prompt linked into the firmware
+ *        or the result of a TTS request; it must stay valid until played
+ */
+int audio_player_play_wav(const void *wav, rt_size_t size, int volume);
+
+/**
+ * @brief Fade out and stop a stream, -1 for all of them
+ */
+rt_err_t audio_player_stop(int id);
+
+/**
+ * @brief Change the volume of a playing stream, 0..100
+ */
+rt_err_t audio_player_set_volume(int id, int volume);
+
+/**
+ * @brief Whether any stream is still playing
+ */
+rt_bool_t audio_player_busy(void);
+
+#endif /* __AUDIO_PLAYER_H__ */
@@ -7,6 +7,7 @@
  */
 
 #include "audio_process.h"
+#include "metrics.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -60,6 +61,22 @@ typedef struct {
 static audio_process_ctx_t g_audio_ctx = {0};
 static vad_context_t g_vad_ctx = {0};
 
+/* Metrics readers, sampled by the exporter without taking ctx->lock */
+static uint32_t metric_read_processed(void)
+{
+    return g_audio_ctx.stats.frames_processed;
+}
+
+static uint32_t metric_read_speech(void)
+{
+    return g_audio_ctx.stats.speech_detected;
+}
+
+static uint32_t metric_read_max_energy(void)
+{
+    return g_audio_ctx.stats.max_energy;
+}
+
 /* Forward declarations */
 static void audio_process_thread_entry(void *parameter);
 static rt_bool_t vad_detect_speech(audio_frame_t *frame);
@@ -129,6 +146,10 @@ rt_err_t audio_process_init(speech_data_callback_t callback)
         return -RT_ENOMEM;
     }
 
+    metric_counter_fn("audio.frames_processed", metric_read_processed);
+    metric_counter_fn("audio.speech_segments", metric_read_speech);
+    metric_gauge_fn("audio.max_energy", metric_read_max_energy);
+
     rt_kprintf("[AudioProcess] Initialization successful\n");
     return RT_EOK;
 }
@@ -3,23 +3,26 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  *
- * Description: SAI1 Hardware I2S Driver for INMP441 Microphone
+ * Description: SAI2 Hardware I2S Driver for INMP441 Microphone
  *
- * CRITICAL FIX: PE3 is SAI1_SD_B (AF6), NOT SAI2_SD_B!
+ * The SAI is registered as two rt_audio devices:
+ * - "mic0"   record, SAI2_Block_B master receiver, SD on PE7 (AF10)
+ * - "sound0" replay, SAI1_Block_B transmitter synchronous to SAI2, SD on PE3 (AF6)
  *
- * According to ART-PI II schematic:
- * - PE3 (Pin 38, #PCM-IN) = SAI1_SD_B (AF6) - Data Input
- * - PE2 (Pin 21) = SAI1_CK1/MCLK (AF2) - Can be used as clock reference
+ * SAI2_Block_B drives SCK (PA2) and FS (PC0) for both, so it runs whenever
+ * either stream does. The receive interrupt converts the DMA buffer once,
+ * straight into blocks of the record pipe, and every reader of the pipe
+ * (the inmp441_* API below, USB audio, recorders) gets those blocks by
+ * reference.
  *
- * Since SAI1_Block_B doesn't have dedicated SCK/FS pins exposed on header,
- * we need to use SAI1 in SYNCHRONOUS mode with Block_A providing clocks,
- * OR use software-generated clocks.
- *
- * Alternative: Use SAI2 with PE7 for SD if hardware allows rewiring.
+ * Note: PE3 is SAI1_SD_B, not SAI2_SD_B, so the INMP441 SD has to be on PE7
+ * (Pin 40) instead of PE3 (Pin 38).
  */
 
 #include "drv_sai_inmp441.h"
 #include "drv_common.h"
+#include "metrics.h"
+#include <rthw.h>
 #include <string.h>
 
 /* STM32 HAL Headers */
@@ -30,43 +33,53 @@
 #define DBG_LVL DBG_INFO
 #include <rtdbg.h>
 
-/* ==================== CONFIGURATION OPTIONS ==================== */
-
-/*
- * Option 1: Use SAI1 with PE3 as SD (requires clock from Block_A or external)
- * Option 2: Use SAI2 with PE7 as SD (requires rewiring INMP441 SD to PE7)
- *
- * Currently implementing Option 2 since SAI2 has proper SCK (PA2) and FS (PC0)
- * User needs to rewire: INMP441 SD -> PE7 (Pin 40) instead of PE3 (Pin 38)
- */
-#define USE_SAI2_WITH_PE7   1   /* Set to 1 to use SAI2 + PE7 */
-
 /* ==================== Private Variables ==================== */
 
-static inmp441_device_t g_inmp441_dev = {0};
-
-#if USE_SAI2_WITH_PE7
-/* SAI2 handles */
+/* SAI2_Block_B receives and drives the clocks, SAI1_Block_B sends with them */
 static SAI_HandleTypeDef hsai2b = {0};
 static DMA_HandleTypeDef hdma_sai2b = {0};
+static SAI_HandleTypeDef hsai1b = {0};
+static DMA_HandleTypeDef hdma_sai1b = {0};
 
 /* Corrected pin for SAI2 SD */
 #define SAI2_SD_PIN_CORRECTED   GPIO_PIN_7  /* PE7 - SAI2_SD_B (AF10) */
 #define SAI2_SD_PORT_CORRECTED  GPIOE
 #define SAI2_SD_AF_CORRECTED    GPIO_AF10_SAI2
 
-#else
-/* SAI1 handles - for future implementation */
-static SAI_HandleTypeDef hsai1a = {0};  /* Block A for clock generation */
-static SAI_HandleTypeDef hsai1b = {0};  /* Block B for data reception */
-static DMA_HandleTypeDef hdma_sai1b = {0};
-#endif
+/* streams that need the SAI2 clocks running */
+#define SAI_USER_RECORD         0x01
+#define SAI_USER_REPLAY         0x02
 
-/* DMA buffer */
-static int32_t dma_buffer[SAI_DMA_BUFFER_SIZE * 2] __attribute__((aligned(32)));
+/* stereo words per DMA half, one frame is two of them */
+#define SAI_HALF_FRAMES         (SAI_DMA_BUFFER_SIZE / 2)
 
-/* Debug counter */
-static volatile uint32_t debug_print_counter = 0;
+struct sai_audio_stats
+{
+    rt_uint32_t rx_halves;          /* DMA halves received while recording */
+    rt_uint32_t rx_blocks;          /* record pipe blocks committed */
+    rt_uint32_t rx_overruns;        /* halves cut short, a reader still held the block */
+    rt_uint64_t rx_cycles;          /* CPU cycles converting into the pipe */
+    rt_uint32_t tx_halves;          /* replay blocks played */
+    rt_uint32_t dma_errors;         /* DMA error count */
+};
+
+struct sai_audio
+{
+    struct rt_audio_device record;  /* INMP441_RECORD_DEVICE */
+    struct rt_audio_device replay;  /* INMP441_REPLAY_DEVICE */
+    struct rt_audio_configure rx_config;    /* what the record pipe carries */
+    struct rt_audio_configure tx_config;    /* what is written to the replay device */
+    rt_uint8_t users;               /* SAI_USER_x running the clocks */
+    volatile rt_bool_t recording;
+    struct sai_audio_stats stats;
+};
+
+static struct sai_audio g_sai;
+static inmp441_device_t g_inmp441_dev = {0};
+
+/* DMA buffers */
+static int32_t dma_buffer[SAI_DMA_BUFFER_SIZE * 2] __attribute__((aligned(32)));
+static rt_uint8_t tx_buffer[SAI_TX_BLOCK_BYTES * 2] __attribute__((aligned(32)));
 
 /* ==================== GPIO Initialization ==================== */
 
@@ -78,7 +91,6 @@ static void sai_gpio_init(void)
     __HAL_RCC_GPIOC_CLK_ENABLE();
     __HAL_RCC_GPIOE_CLK_ENABLE();
 
-#if USE_SAI2_WITH_PE7
     /* PA2 - SAI2_SCK_B (AF8) */
     GPIO_InitStruct.Pin = GPIO_PIN_2;
     GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
@@ -103,13 +115,7 @@ static void sai_gpio_init(void)
     GPIO_InitStruct.Alternate = SAI2_SD_AF_CORRECTED;
     HAL_GPIO_Init(SAI2_SD_PORT_CORRECTED, &GPIO_InitStruct);
 
-    LOG_I("GPIO: PA2(SCK/AF8), PC0(FS/AF8), PE7(SD/AF10)");
-    rt_kprintf("\n");
-    rt_kprintf("!!! IMPORTANT: Connect INMP441 SD to PE7 (Pin 40), NOT PE3 !!!\n");
-    rt_kprintf("\n");
-#else
-    /* SAI1 configuration - PE3 is SAI1_SD_B */
-    /* PE3 - SAI1_SD_B (AF6) */
+    /* PE3 - SAI1_SD_B (AF6) - replay data output */
     GPIO_InitStruct.Pin = GPIO_PIN_3;
     GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
     GPIO_InitStruct.Pull = GPIO_NOPULL;
@@ -117,52 +123,46 @@ static void sai_gpio_init(void)
     GPIO_InitStruct.Alternate = GPIO_AF6_SAI1;
     HAL_GPIO_Init(GPIOE, &GPIO_InitStruct);
 
-    LOG_I("GPIO: PE3(SD/AF6) - SAI1_SD_B");
-#endif
-}
-
-static void sai_gpio_deinit(void)
-{
-#if USE_SAI2_WITH_PE7
-    HAL_GPIO_DeInit(GPIOA, GPIO_PIN_2);
-    HAL_GPIO_DeInit(GPIOC, GPIO_PIN_0);
-    HAL_GPIO_DeInit(GPIOE, SAI2_SD_PIN_CORRECTED);
-#else
-    HAL_GPIO_DeInit(GPIOE, GPIO_PIN_3);
-#endif
+    LOG_I("GPIO: PA2(SCK/AF8), PC0(FS/AF8), PE7(SD in/AF10), PE3(SD out/AF6)");
+    rt_kprintf("\n");
+    rt_kprintf("!!! IMPORTANT: Connect INMP441 SD to PE7 (Pin 40), NOT PE3 !!!\n");
+    rt_kprintf("\n");
 }
 
 /* ==================== SAI Peripheral Configuration ==================== */
 
-#if USE_SAI2_WITH_PE7
-
-static rt_err_t sai_peripheral_init(void)
+static rt_bool_t sai_rate_valid(rt_uint32_t rate)
 {
-    RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
-    HAL_StatusTypeDef status;
-
-    /* Configure SAI2 clock */
-    PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_SAI2;
-    PeriphClkInit.Sai2ClockSelection = RCC_SAI2CLKSOURCE_PLL1Q;
-    if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
+    switch (rate)
     {
-        LOG_E("SAI2 clock config failed");
-        return -RT_ERROR;
+    case SAI_AUDIO_FREQUENCY_8K:
+    case SAI_AUDIO_FREQUENCY_11K:
+    case SAI_AUDIO_FREQUENCY_16K:
+    case SAI_AUDIO_FREQUENCY_22K:
+    case SAI_AUDIO_FREQUENCY_32K:
+    case SAI_AUDIO_FREQUENCY_44K:
+    case SAI_AUDIO_FREQUENCY_48K:
+        return RT_TRUE;
+    default:
+        return RT_FALSE;
     }
+}
 
-    __HAL_RCC_SAI2_CLK_ENABLE();
+static rt_err_t sai_rx_init(rt_uint32_t rate)
+{
+    HAL_StatusTypeDef status;
 
     hsai2b.Instance = SAI2_Block_B;
     __HAL_SAI_DISABLE(&hsai2b);
 
-    /* Master receiver configuration */
+    /* Master receiver configuration, the clocks also go out to SAI1 */
     hsai2b.Init.AudioMode = SAI_MODEMASTER_RX;
     hsai2b.Init.Synchro = SAI_ASYNCHRONOUS;
-    hsai2b.Init.SynchroExt = SAI_SYNCEXT_DISABLE;
+    hsai2b.Init.SynchroExt = SAI_SYNCEXT_OUTBLOCKB_ENABLE;
     hsai2b.Init.OutputDrive = SAI_OUTPUTDRIVE_ENABLE;  /* Drive SCK/FS outputs */
     hsai2b.Init.NoDivider = SAI_MASTERDIVIDER_ENABLE;
     hsai2b.Init.FIFOThreshold = SAI_FIFOTHRESHOLD_1QF;
-    hsai2b.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_16K;
+    hsai2b.Init.AudioFrequency = rate;
     hsai2b.Init.MckOutput = SAI_MCK_OUTPUT_DISABLE;
     hsai2b.Init.MonoStereoMode = SAI_STEREOMODE;  /* Use stereo to receive I2S format */
     hsai2b.Init.CompandingMode = SAI_NOCOMPANDING;
@@ -194,41 +194,65 @@ static rt_err_t sai_peripheral_init(void)
         return -RT_ERROR;
     }
 
-    LOG_I("SAI2_Block_B initialized (Master RX, I2S, 16kHz)");
+    LOG_I("SAI2_Block_B initialized (Master RX, I2S, %d Hz)", rate);
     return RT_EOK;
 }
 
-static void sai_peripheral_deinit(void)
+/* the frame of SAI2_Block_B, sent in the slots its clocks give */
+static rt_err_t sai_tx_init(const struct rt_audio_configure *config)
 {
-    HAL_SAI_DeInit(&hsai2b);
-    __HAL_RCC_SAI2_CLK_DISABLE();
-}
-
-#else /* Use SAI1 */
+    HAL_StatusTypeDef status;
 
-static rt_err_t sai_peripheral_init(void)
-{
-    /* SAI1 implementation would go here */
-    /* This is more complex as SAI1_Block_B needs clocks from Block_A */
-    LOG_E("SAI1 mode not yet implemented");
-    LOG_E("Please use SAI2 mode: rewire INMP441 SD to PE7");
-    return -RT_ERROR;
-}
+    hsai1b.Instance = SAI1_Block_B;
+    __HAL_SAI_DISABLE(&hsai1b);
+
+    hsai1b.Init.AudioMode = SAI_MODESLAVE_TX;
+    hsai1b.Init.Synchro = SAI_SYNCHRONOUS_EXT_SAI2;
+    hsai1b.Init.SynchroExt = SAI_SYNCEXT_DISABLE;
+    hsai1b.Init.OutputDrive = SAI_OUTPUTDRIVE_ENABLE;
+    hsai1b.Init.NoDivider = SAI_MASTERDIVIDER_ENABLE;
+    hsai1b.Init.FIFOThreshold = SAI_FIFOTHRESHOLD_1QF;
+    hsai1b.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_MCKDIV;   /* slave, no divider */
+    hsai1b.Init.Mckdiv = 0;
+    hsai1b.Init.MckOutput = SAI_MCK_OUTPUT_DISABLE;
+    hsai1b.Init.MonoStereoMode = (config->channels == 1) ? SAI_MONOMODE : SAI_STEREOMODE;
+    hsai1b.Init.CompandingMode = SAI_NOCOMPANDING;
+    hsai1b.Init.TriState = SAI_OUTPUT_NOTRELEASED;
+
+    hsai1b.Init.Protocol = SAI_FREE_PROTOCOL;
+    hsai1b.Init.DataSize = (config->samplebits == 16) ? SAI_DATASIZE_16 : SAI_DATASIZE_32;
+    hsai1b.Init.FirstBit = SAI_FIRSTBIT_MSB;
+    hsai1b.Init.ClockStrobing = SAI_CLOCKSTROBING_RISINGEDGE;
+
+    hsai1b.FrameInit.FrameLength = 64;
+    hsai1b.FrameInit.ActiveFrameLength = 32;
+    hsai1b.FrameInit.FSDefinition = SAI_FS_CHANNEL_IDENTIFICATION;
+    hsai1b.FrameInit.FSPolarity = SAI_FS_ACTIVE_LOW;
+    hsai1b.FrameInit.FSOffset = SAI_FS_BEFOREFIRSTBIT;
+
+    hsai1b.SlotInit.FirstBitOffset = 0;
+    hsai1b.SlotInit.SlotSize = SAI_SLOTSIZE_32B;
+    hsai1b.SlotInit.SlotNumber = 2;
+    hsai1b.SlotInit.SlotActive = SAI_SLOTACTIVE_0 | SAI_SLOTACTIVE_1;
+
+    status = HAL_SAI_Init(&hsai1b);
+    if (status != HAL_OK)
+    {
+        LOG_E("SAI1 init failed: %d, err=0x%08X", status, hsai1b.ErrorCode);
+        return -RT_ERROR;
+    }
 
-static void sai_peripheral_deinit(void)
-{
-    /* SAI1 cleanup */
+    LOG_I("SAI1_Block_B initialized (Slave TX, synchronous to SAI2, %d bit %d ch)",
+          config->samplebits, config->channels);
+    return RT_EOK;
 }
 
-#endif
-
 /* ==================== DMA Configuration ==================== */
 
-static rt_err_t sai_dma_init(void)
+static rt_err_t sai_rx_dma_init(void)
 {
     __HAL_RCC_GPDMA1_CLK_ENABLE();
 
-#if USE_SAI2_WITH_PE7
     HAL_DMA_DeInit(&hdma_sai2b);
 
     hdma_sai2b.Instance = GPDMA1_Channel0;
@@ -256,18 +280,52 @@ static rt_err_t sai_dma_init(void)
 
     HAL_NVIC_SetPriority(GPDMA1_Channel0_IRQn, 5, 0);
     HAL_NVIC_EnableIRQ(GPDMA1_Channel0_IRQn);
-#endif
 
     LOG_I("DMA initialized");
     return RT_EOK;
 }
 
-static void sai_dma_deinit(void)
+static rt_err_t sai_tx_dma_init(const struct rt_audio_configure *config)
 {
-    HAL_NVIC_DisableIRQ(GPDMA1_Channel0_IRQn);
-#if USE_SAI2_WITH_PE7
-    HAL_DMA_DeInit(&hdma_sai2b);
-#endif
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+    HAL_DMA_DeInit(&hdma_sai1b);
+
+    hdma_sai1b.Instance = GPDMA1_Channel1;
+    hdma_sai1b.Init.Request = GPDMA1_REQUEST_SAI1_B;
+    hdma_sai1b.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+    hdma_sai1b.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_sai1b.Init.SrcInc = DMA_SINC_INCREMENTED;
+    hdma_sai1b.Init.DestInc = DMA_DINC_FIXED;
+    if (config->samplebits == 16)
+    {
+        hdma_sai1b.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_HALFWORD;
+        hdma_sai1b.Init.DestDataWidth = DMA_DEST_DATAWIDTH_HALFWORD;
+    }
+    else
+    {
+        hdma_sai1b.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_WORD;
+        hdma_sai1b.Init.DestDataWidth = DMA_DEST_DATAWIDTH_WORD;
+    }
+    hdma_sai1b.Init.Priority = DMA_HIGH_PRIORITY;
+    hdma_sai1b.Init.SrcBurstLength = 1;
+    hdma_sai1b.Init.DestBurstLength = 1;
+    hdma_sai1b.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT1 | DMA_DEST_ALLOCATED_PORT0;
+    hdma_sai1b.Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+    hdma_sai1b.Init.Mode = DMA_NORMAL;
+
+    if (HAL_DMA_Init(&hdma_sai1b) != HAL_OK)
+    {
+        LOG_E("TX DMA init failed");
+        return -RT_ERROR;
+    }
+
+    __HAL_LINKDMA(&hsai1b, hdmatx, hdma_sai1b);
+
+    HAL_NVIC_SetPriority(GPDMA1_Channel1_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(GPDMA1_Channel1_IRQn);
+
+    return RT_EOK;
 }
 
 /* ==================== Interrupt Handlers ==================== */
@@ -275,139 +333,578 @@ static void sai_dma_deinit(void)
 void GPDMA1_Channel0_IRQHandler(void)
 {
     rt_interrupt_enter();
-#if USE_SAI2_WITH_PE7
     HAL_DMA_IRQHandler(&hdma_sai2b);
-#endif
     rt_interrupt_leave();
 }
 
-/* ==================== Data Processing ==================== */
-
-static void process_dma_data(int32_t *src, uint32_t sample_count)
+void GPDMA1_Channel1_IRQHandler(void)
 {
-    inmp441_device_t *dev = &g_inmp441_dev;
+    rt_interrupt_enter();
+    HAL_DMA_IRQHandler(&hdma_sai1b);
+    rt_interrupt_leave();
+}
 
-    if (!dev->is_running)
-        return;
+/* ==================== Stream Control ==================== */
 
-    /* Debug output every ~100 calls */
-    if (debug_print_counter++ % 100 == 0)
+static rt_err_t sai_rx_dma_start(void)
+{
+    rt_memset(dma_buffer, 0, sizeof(dma_buffer));
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t *)dma_buffer, sizeof(dma_buffer));
+
+    if (HAL_SAI_Receive_DMA(&hsai2b, (uint8_t *)dma_buffer, SAI_DMA_BUFFER_SIZE * 2) != HAL_OK)
     {
-        rt_kprintf("\n[DMA] samples=%d\n", sample_count);
-        rt_kprintf("  Raw: 0x%08X, 0x%08X, 0x%08X, 0x%08X\n",
-                   (uint32_t)src[0], (uint32_t)src[1],
-                   (uint32_t)src[2], (uint32_t)src[3]);
+        LOG_E("Failed to start DMA: err=0x%08X", hsai2b.ErrorCode);
+        return -RT_ERROR;
     }
 
-    if (dev->frame_count >= AUDIO_BUFFER_COUNT)
+    return RT_EOK;
+}
+
+static rt_err_t sai_tx_dma_start(void)
+{
+    /* in units of the SAI data size */
+    rt_uint32_t items = sizeof(tx_buffer) / (g_sai.tx_config.samplebits / 8);
+
+    SCB_CleanDCache_by_Addr((uint32_t *)tx_buffer, sizeof(tx_buffer));
+    if (HAL_SAI_Transmit_DMA(&hsai1b, tx_buffer, items) != HAL_OK)
     {
-        dev->overrun_count++;
-        return;
+        LOG_E("Failed to start TX DMA: err=0x%08X", hsai1b.ErrorCode);
+        return -RT_ERROR;
     }
 
-    audio_frame_t *frame = &dev->frames[dev->write_idx];
+    return RT_EOK;
+}
 
-    /*
-     * SAI is configured in STEREO mode, data format: [L, R, L, R, ...]
-     * INMP441 L/R pin = GND: outputs on LEFT channel (index 0, 2, 4, ...)
-     *
-     * Debug: print both channels to see which one has data
-     */
-    uint32_t mono_count = sample_count / 2;  /* Half the samples after extracting mono */
-    uint32_t copy_size = (mono_count < AUDIO_FRAME_SIZE) ? mono_count : AUDIO_FRAME_SIZE;
+/* SAI2 runs while any stream needs its clocks */
+static rt_err_t sai_clock_get(rt_uint8_t user)
+{
+    rt_err_t result = RT_EOK;
+
+    if (g_sai.users == 0)
+        result = sai_rx_dma_start();
+    if (result == RT_EOK)
+        g_sai.users |= user;
+
+    return result;
+}
+
+static void sai_clock_put(rt_uint8_t user)
+{
+    g_sai.users &= ~user;
+    if (g_sai.users == 0)
+        HAL_SAI_DMAStop(&hsai2b);
+}
+
+/* both blocks follow the rate of SAI2, restart whatever was running */
+static rt_err_t sai_set_rate(rt_uint32_t rate)
+{
+    rt_uint32_t old = g_sai.rx_config.samplerate;
+    rt_err_t result;
 
-    /* Debug: check both channels */
-    if (debug_print_counter % 100 == 1)
+    if (g_sai.users & SAI_USER_REPLAY)
+        HAL_SAI_DMAStop(&hsai1b);
+    if (g_sai.users)
+        HAL_SAI_DMAStop(&hsai2b);
+
+    result = sai_rx_init(rate);
+    if (result != RT_EOK)
+        sai_rx_init(old);
+    else
+        g_sai.rx_config.samplerate = g_sai.tx_config.samplerate = rate;
+
+    if (g_sai.users & SAI_USER_REPLAY)
+        sai_tx_dma_start();
+    if (g_sai.users)
+        sai_rx_dma_start();
+
+    return result;
+}
+
+/* ==================== Data Processing ==================== */
+
+/* frames of the left (and right) slot, into the record format */
+static void sai_convert(rt_uint8_t *dst, const int32_t *src, rt_uint32_t frames,
+                        const struct rt_audio_configure *config)
+{
+    rt_uint32_t i, n = frames * 2;
+    rt_uint32_t step = (config->channels == 1) ? 2 : 1;
+    int32_t v;
+
+    switch (config->samplebits)
     {
-        rt_kprintf("  L[0]=0x%08X R[0]=0x%08X L[1]=0x%08X R[1]=0x%08X\n",
-                   (uint32_t)src[0], (uint32_t)src[1],
-                   (uint32_t)src[2], (uint32_t)src[3]);
+    case 16:
+        for (i = 0; i < n; i += step)
+            *(int16_t *)dst = (int16_t)(src[i] >> 16), dst += 2;
+        break;
+    case 24:
+        for (i = 0; i < n; i += step)
+        {
+            v = src[i] >> 8;
+            dst[0] = (rt_uint8_t)v;
+            dst[1] = (rt_uint8_t)(v >> 8);
+            dst[2] = (rt_uint8_t)(v >> 16);
+            dst += 3;
+        }
+        break;
+    default:
+        for (i = 0; i < n; i += step)
+            *(int32_t *)dst = src[i], dst += 4;
+        break;
     }
+}
+
+static void process_dma_data(int32_t *src, uint32_t sample_count)
+{
+    struct rt_audio_configure *config = &g_sai.rx_config;
+    rt_uint32_t frames = sample_count / 2;
+    rt_uint32_t frame_bytes, per_block, n;
+    rt_uint32_t start;
+    rt_uint8_t *block;
+
+    if (!g_sai.recording)
+        return;
+
+    SCB_InvalidateDCache_by_Addr((uint32_t *)src, sample_count * sizeof(int32_t));
+
+#ifdef RT_USBD_MIC_PUSH
+    /* USB 麦克风直接取 DMA 缓冲的左声道, 不经过帧队列, VAD/STT 读得慢也不影响它 */
+    rt_usbd_uac_mic_write(src, sample_count / 2, 2);
+#endif
 
-    /* INMP441 L/R=GND: Extract LEFT channel (src[0], src[2], src[4], ...)
-     * INMP441输出24-bit数据左对齐在32-bit中
-     * 右移8位得到24-bit有符号值，保留足够的动态范围
+    start = DWT->CYCCNT;
+    g_sai.stats.rx_halves++;
+
+    /*
+     * SAI is configured in STEREO mode, data format: [L, R, L, R, ...]
+     * INMP441 L/R pin = GND: outputs on LEFT channel (index 0, 2, 4, ...),
+     * 24-bit data left aligned in 32-bit. Converted once into the pipe
+     * blocks, the readers share them.
      */
-    for (uint32_t i = 0; i < copy_size; i++)
+    frame_bytes = config->channels * (config->samplebits / 8);
+    per_block = g_sai.record.record->pipe.block_size / frame_bytes;
+    while (frames)
     {
-        frame->buffer[i] = src[i * 2] >> 8;  /* 右移8位: 保留24-bit动态范围 */
-    }
+        block = rt_audio_rx_claim(&g_sai.record);
+        if (block == RT_NULL)
+        {
+            g_sai.stats.rx_overruns++;
+            break;
+        }
 
-    frame->size = copy_size;
-    frame->sample_rate = INMP441_SAMPLE_RATE;
-    frame->channels = INMP441_CHANNEL_NUM;
-    frame->bit_width = INMP441_BIT_WIDTH;
-    frame->timestamp = rt_tick_get();
+        n = (frames < per_block) ? frames : per_block;
+        sai_convert(block, src, n, config);
+        rt_audio_rx_commit(&g_sai.record, n * frame_bytes);
+        g_sai.stats.rx_blocks++;
 
-    dev->write_idx = (dev->write_idx + 1) % AUDIO_BUFFER_COUNT;
-    dev->frame_count++;
-    dev->total_frames++;
+        src += n * 2;
+        frames -= n;
+    }
 
-    if (dev->buffer_sem)
-        rt_sem_release(dev->buffer_sem);
+    g_sai.stats.rx_cycles += DWT->CYCCNT - start;
 }
 
 /* ==================== HAL Callbacks ==================== */
 
 void HAL_SAI_RxHalfCpltCallback(SAI_HandleTypeDef *hsai)
 {
-#if USE_SAI2_WITH_PE7
     if (hsai->Instance == SAI2_Block_B)
     {
         process_dma_data(&dma_buffer[0], SAI_DMA_BUFFER_SIZE);
     }
-#endif
 }
 
 void HAL_SAI_RxCpltCallback(SAI_HandleTypeDef *hsai)
 {
-#if USE_SAI2_WITH_PE7
     if (hsai->Instance == SAI2_Block_B)
     {
         process_dma_data(&dma_buffer[SAI_DMA_BUFFER_SIZE], SAI_DMA_BUFFER_SIZE);
 
-        if (g_inmp441_dev.is_running)
+        if (g_sai.users)
         {
             HAL_SAI_Receive_DMA(hsai, (uint8_t *)dma_buffer, SAI_DMA_BUFFER_SIZE * 2);
         }
     }
-#endif
+}
+
+void HAL_SAI_TxHalfCpltCallback(SAI_HandleTypeDef *hsai)
+{
+    if (hsai->Instance == SAI1_Block_B)
+    {
+        /* the first block went out, the framework refills it */
+        g_sai.stats.tx_halves++;
+        rt_audio_tx_complete(&g_sai.replay);
+    }
+}
+
+void HAL_SAI_TxCpltCallback(SAI_HandleTypeDef *hsai)
+{
+    if (hsai->Instance == SAI1_Block_B)
+    {
+        g_sai.stats.tx_halves++;
+        if (g_sai.users & SAI_USER_REPLAY)
+        {
+            HAL_SAI_Transmit_DMA(hsai, tx_buffer, sizeof(tx_buffer) / (g_sai.tx_config.samplebits / 8));
+        }
+        rt_audio_tx_complete(&g_sai.replay);
+    }
 }
 
 void HAL_SAI_ErrorCallback(SAI_HandleTypeDef *hsai)
 {
-#if USE_SAI2_WITH_PE7
     if (hsai->Instance == SAI2_Block_B)
     {
-        g_inmp441_dev.dma_errors++;
+        g_sai.stats.dma_errors++;
         LOG_E("SAI error: 0x%08X", hsai->ErrorCode);
 
         HAL_SAI_DMAStop(hsai);
-        if (g_inmp441_dev.is_running)
+        if (g_sai.users)
         {
             HAL_SAI_Receive_DMA(hsai, (uint8_t *)dma_buffer, SAI_DMA_BUFFER_SIZE * 2);
         }
     }
-#endif
+    else if (hsai->Instance == SAI1_Block_B)
+    {
+        g_sai.stats.dma_errors++;
+        LOG_E("SAI1 error: 0x%08X", hsai->ErrorCode);
+
+        HAL_SAI_DMAStop(hsai);
+        if (g_sai.users & SAI_USER_REPLAY)
+        {
+            HAL_SAI_Transmit_DMA(hsai, tx_buffer, sizeof(tx_buffer) / (g_sai.tx_config.samplebits / 8));
+        }
+    }
+}
+
+/* ==================== Audio Device Operations ==================== */
+
+static rt_err_t sai_audio_getcaps(struct rt_audio_device *audio, struct rt_audio_caps *caps)
+{
+    rt_err_t result = RT_EOK;
+    rt_bool_t record = (audio == &g_sai.record);
+    struct rt_audio_configure *config = record ? &g_sai.rx_config : &g_sai.tx_config;
+
+    switch (caps->main_type)
+    {
+    case AUDIO_TYPE_QUERY:
+        if (caps->sub_type == AUDIO_TYPE_QUERY)
+            caps->udata.mask = record ? AUDIO_TYPE_INPUT : AUDIO_TYPE_OUTPUT;
+        else
+            result = -RT_ERROR;
+        break;
+
+    case AUDIO_TYPE_INPUT:
+    case AUDIO_TYPE_OUTPUT:
+        switch (caps->sub_type)
+        {
+        case AUDIO_DSP_PARAM:
+            caps->udata.config = *config;
+            break;
+        case AUDIO_DSP_SAMPLERATE:
+            caps->udata.config.samplerate = config->samplerate;
+            break;
+        case AUDIO_DSP_CHANNELS:
+            caps->udata.config.channels = config->channels;
+            break;
+        case AUDIO_DSP_SAMPLEBITS:
+            caps->udata.config.samplebits = config->samplebits;
+            break;
+        default:
+            result = -RT_ERROR;
+            break;
+        }
+        break;
+
+    default:
+        result = -RT_ERROR;
+        break;
+    }
+
+    return result;
+}
+
+static rt_err_t sai_audio_configure(struct rt_audio_device *audio, struct rt_audio_caps *caps)
+{
+    rt_err_t result = RT_EOK;
+    rt_bool_t record = (audio == &g_sai.record);
+    struct rt_audio_configure config = record ? g_sai.rx_config : g_sai.tx_config;
+    rt_base_t level;
+
+    /* neither side has a mixer: no gain on the INMP441, no codec */
+    if (caps->main_type != (record ? AUDIO_TYPE_INPUT : AUDIO_TYPE_OUTPUT))
+        return -RT_ENOSYS;
+
+    switch (caps->sub_type)
+    {
+    case AUDIO_DSP_PARAM:
+        config = caps->udata.config;
+        break;
+    case AUDIO_DSP_SAMPLERATE:
+        config.samplerate = caps->udata.config.samplerate;
+        break;
+    case AUDIO_DSP_CHANNELS:
+        config.channels = caps->udata.config.channels;
+        break;
+    case AUDIO_DSP_SAMPLEBITS:
+        config.samplebits = caps->udata.config.samplebits;
+        break;
+    default:
+        return -RT_ERROR;
+    }
+
+    if (!sai_rate_valid(config.samplerate) || config.channels < 1 || config.channels > 2)
+        return -RT_EINVAL;
+    /* replay sends 16 or 32 bit words, packed 24 bit is for recording */
+    if (config.samplebits != 16 && config.samplebits != 32 &&
+        !(record && config.samplebits == 24))
+        return -RT_EINVAL;
+
+    if (config.samplerate != g_sai.rx_config.samplerate)
+    {
+        result = sai_set_rate(config.samplerate);
+        if (result != RT_EOK)
+            return result;
+    }
+
+    if (record)
+    {
+        /* the receive interrupt picks it up at the next half */
+        level = rt_hw_interrupt_disable();
+        g_sai.rx_config.channels = config.channels;
+        g_sai.rx_config.samplebits = config.samplebits;
+        rt_hw_interrupt_enable(level);
+    }
+    else if (config.channels != g_sai.tx_config.channels ||
+             config.samplebits != g_sai.tx_config.samplebits)
+    {
+        if (g_sai.users & SAI_USER_REPLAY)
+            return -RT_EBUSY;
+
+        g_sai.tx_config.channels = config.channels;
+        g_sai.tx_config.samplebits = config.samplebits;
+        result = sai_tx_init(&g_sai.tx_config);
+        if (result == RT_EOK)
+            result = sai_tx_dma_init(&g_sai.tx_config);
+    }
+
+    LOG_D("%s: %d Hz, %d ch, %d bit", record ? "record" : "replay",
+          config.samplerate, config.channels, config.samplebits);
+    return result;
+}
+
+static rt_err_t sai_record_init(struct rt_audio_device *audio)
+{
+    RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
+    rt_err_t result;
+
+    /* Configure SAI2 clock */
+    PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_SAI2;
+    PeriphClkInit.Sai2ClockSelection = RCC_SAI2CLKSOURCE_PLL1Q;
+    if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
+    {
+        LOG_E("SAI2 clock config failed");
+        return -RT_ERROR;
+    }
+    __HAL_RCC_SAI2_CLK_ENABLE();
+
+    sai_gpio_init();
+
+    result = sai_rx_init(g_sai.rx_config.samplerate);
+    if (result == RT_EOK)
+        result = sai_rx_dma_init();
+
+    return result;
+}
+
+static rt_err_t sai_replay_init(struct rt_audio_device *audio)
+{
+    rt_err_t result;
+
+    __HAL_RCC_SAI1_CLK_ENABLE();
+
+    result = sai_tx_init(&g_sai.tx_config);
+    if (result == RT_EOK)
+        result = sai_tx_dma_init(&g_sai.tx_config);
+
+    return result;
+}
+
+static rt_err_t sai_audio_start(struct rt_audio_device *audio, int stream)
+{
+    rt_err_t result = RT_EOK;
+
+    if (stream == AUDIO_STREAM_RECORD)
+    {
+        result = sai_clock_get(SAI_USER_RECORD);
+        if (result == RT_EOK)
+            g_sai.recording = RT_TRUE;
+        LOG_I("Record started");
+    }
+    else
+    {
+        /* silence until the framework fills the first block */
+        rt_memset(tx_buffer, 0, sizeof(tx_buffer));
+
+        /* the slave goes first so it is ready for the first frame of the master */
+        result = sai_tx_dma_start();
+        if (result == RT_EOK)
+        {
+            result = sai_clock_get(SAI_USER_REPLAY);
+            if (result != RT_EOK)
+                HAL_SAI_DMAStop(&hsai1b);
+        }
+        LOG_I("Replay started");
+    }
+
+    return result;
+}
+
+static rt_err_t sai_audio_stop(struct rt_audio_device *audio, int stream)
+{
+    if (stream == AUDIO_STREAM_RECORD)
+    {
+        g_sai.recording = RT_FALSE;
+        sai_clock_put(SAI_USER_RECORD);
+        LOG_I("Record stopped (blocks=%d, errors=%d)", g_sai.stats.rx_blocks, g_sai.stats.dma_errors);
+    }
+    else
+    {
+        HAL_SAI_DMAStop(&hsai1b);
+        sai_clock_put(SAI_USER_REPLAY);
+        LOG_I("Replay stopped (blocks=%d)", g_sai.stats.tx_halves);
+    }
+
+    return RT_EOK;
+}
+
+static rt_ssize_t sai_audio_transmit(struct rt_audio_device *audio, const void *writeBuf, void *readBuf, rt_size_t size)
+{
+    /* the framework filled a block of tx_buffer in place, DMA reads it from memory */
+    SCB_CleanDCache_by_Addr((uint32_t *)writeBuf, size);
+    return size;
+}
+
+static void sai_audio_buffer_info(struct rt_audio_device *audio, struct rt_audio_buf_info *info)
+{
+    info->buffer = tx_buffer;
+    info->block_size = SAI_TX_BLOCK_BYTES;
+    info->block_count = 2;
+    info->total_size = sizeof(tx_buffer);
+}
+
+static struct rt_audio_ops sai_record_ops =
+{
+    .getcaps     = sai_audio_getcaps,
+    .configure   = sai_audio_configure,
+    .init        = sai_record_init,
+    .start       = sai_audio_start,
+    .stop        = sai_audio_stop,
+    .transmit    = RT_NULL,
+    .buffer_info = RT_NULL,
+};
+
+static struct rt_audio_ops sai_replay_ops =
+{
+    .getcaps     = sai_audio_getcaps,
+    .configure   = sai_audio_configure,
+    .init        = sai_replay_init,
+    .start       = sai_audio_start,
+    .stop        = sai_audio_stop,
+    .transmit    = sai_audio_transmit,
+    .buffer_info = sai_audio_buffer_info,
+};
+
+int rt_hw_sai_audio_init(void)
+{
+    rt_err_t result;
+
+    g_sai.rx_config.samplerate = INMP441_SAMPLE_RATE;
+    g_sai.rx_config.channels = INMP441_CHANNEL_NUM;
+    g_sai.rx_config.samplebits = 32;
+    g_sai.tx_config.samplerate = INMP441_SAMPLE_RATE;
+    g_sai.tx_config.channels = 2;
+    g_sai.tx_config.samplebits = 16;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    g_sai.record.ops = &sai_record_ops;
+    result = rt_audio_register(&g_sai.record, INMP441_RECORD_DEVICE, RT_DEVICE_FLAG_RDONLY, &g_sai);
+    if (result != RT_EOK)
+    {
+        LOG_E("register %s failed: %d", INMP441_RECORD_DEVICE, result);
+        return result;
+    }
+
+    g_sai.replay.ops = &sai_replay_ops;
+    result = rt_audio_register(&g_sai.replay, INMP441_REPLAY_DEVICE, RT_DEVICE_FLAG_WRONLY, &g_sai);
+    if (result != RT_EOK)
+        LOG_E("register %s failed: %d", INMP441_REPLAY_DEVICE, result);
+
+    return result;
+}
+INIT_DEVICE_EXPORT(rt_hw_sai_audio_init);
+
+/* ==================== Metrics ==================== */
+
+static uint32_t metric_read_frames(void)
+{
+    return g_inmp441_dev.total_frames;
+}
+
+static uint32_t metric_read_overruns(void)
+{
+    return g_inmp441_dev.reader.dropped + g_sai.stats.rx_overruns;
+}
+
+static uint32_t metric_read_dma_errors(void)
+{
+    return g_sai.stats.dma_errors;
 }
 
 /* ==================== Public API ==================== */
 
+/*
+ * The inmp441_* API is one reader of the record pipe: 24-bit samples right
+ * aligned in int32, left channel, whatever format the device is set to.
+ */
+
+static uint32_t inmp441_convert(int32_t *dst, const rt_uint8_t *src, uint32_t count,
+                                const struct rt_audio_configure *config)
+{
+    uint32_t frame_bytes = config->channels * (config->samplebits / 8);
+    uint32_t i;
+
+    for (i = 0; i < count; i++, src += frame_bytes)
+    {
+        switch (config->samplebits)
+        {
+        case 16:
+            dst[i] = (int32_t)(*(const int16_t *)src) * 256;
+            break;
+        case 24:
+            dst[i] = ((int32_t)((uint32_t)src[0] << 8 | (uint32_t)src[1] << 16 | (uint32_t)src[2] << 24)) >> 8;
+            break;
+        default:
+            dst[i] = *(const int32_t *)src >> 8;  /* 右移8位: 保留24-bit动态范围 */
+            break;
+        }
+    }
+
+    return count * frame_bytes;
+}
+
 rt_err_t inmp441_init(void)
 {
     inmp441_device_t *dev = &g_inmp441_dev;
+    struct rt_audio_caps caps;
     rt_err_t result;
 
     rt_kprintf("\n");
     rt_kprintf("================================================\n");
-    rt_kprintf("  INMP441 Driver - FIXED VERSION\n");
+    rt_kprintf("  INMP441 Driver - rt_audio device %s\n", INMP441_RECORD_DEVICE);
     rt_kprintf("================================================\n");
-#if USE_SAI2_WITH_PE7
     rt_kprintf("  Mode: SAI2_Block_B\n");
     rt_kprintf("  Pins: PA2(SCK), PC0(WS), PE7(SD) <-- NOTE: PE7!\n");
-#else
-    rt_kprintf("  Mode: SAI1_Block_B (not implemented)\n");
-#endif
     rt_kprintf("================================================\n\n");
 
     if (dev->is_initialized)
@@ -418,53 +915,34 @@ rt_err_t inmp441_init(void)
 
     rt_memset(dev, 0, sizeof(inmp441_device_t));
 
-    dev->buffer_sem = rt_sem_create("sai_sem", 0, RT_IPC_FLAG_FIFO);
-    if (!dev->buffer_sem)
+    dev->dev = rt_device_find(INMP441_RECORD_DEVICE);
+    if (!dev->dev)
     {
-        LOG_E("Failed to create semaphore");
-        return -RT_ENOMEM;
+        LOG_E("No device %s", INMP441_RECORD_DEVICE);
+        return -RT_ENOSYS;
     }
 
-    dev->lock = rt_mutex_create("sai_lock", RT_IPC_FLAG_PRIO);
-    if (!dev->lock)
-    {
-        result = -RT_ENOMEM;
-        goto _exit;
-    }
-
-    for (int i = 0; i < AUDIO_BUFFER_COUNT; i++)
+    caps.main_type = AUDIO_TYPE_INPUT;
+    caps.sub_type = AUDIO_DSP_PARAM;
+    caps.udata.config.samplerate = INMP441_SAMPLE_RATE;
+    caps.udata.config.channels = INMP441_CHANNEL_NUM;
+    caps.udata.config.samplebits = 32;
+    result = rt_device_control(dev->dev, AUDIO_CTL_CONFIGURE, &caps);
+    if (result != RT_EOK)
     {
-        dev->frames[i].buffer = rt_malloc(AUDIO_FRAME_SIZE * sizeof(int32_t));
-        if (!dev->frames[i].buffer)
-        {
-            result = -RT_ENOMEM;
-            goto _exit;
-        }
-        rt_memset(dev->frames[i].buffer, 0, AUDIO_FRAME_SIZE * sizeof(int32_t));
+        LOG_E("Configure %s failed: %d", INMP441_RECORD_DEVICE, result);
+        return result;
     }
 
-    sai_gpio_init();
-
-    result = sai_peripheral_init();
-    if (result != RT_EOK)
-        goto _exit;
+    dev->is_initialized = RT_TRUE;
 
-    result = sai_dma_init();
-    if (result != RT_EOK)
-        goto _exit;
+    /* 导出时直接读取驱动计数, 中断路径不增加开销 */
+    metric_counter_fn("sai.frames", metric_read_frames);
+    metric_counter_fn("sai.overruns", metric_read_overruns);
+    metric_counter_fn("sai.dma_errors", metric_read_dma_errors);
 
-    dev->is_initialized = RT_TRUE;
     LOG_I("Initialization complete");
     return RT_EOK;
-
-_exit:
-    if (dev->buffer_sem) rt_sem_delete(dev->buffer_sem);
-    if (dev->lock) rt_mutex_delete(dev->lock);
-    for (int i = 0; i < AUDIO_BUFFER_COUNT; i++)
-    {
-        if (dev->frames[i].buffer) rt_free(dev->frames[i].buffer);
-    }
-    return result;
 }
 
 rt_err_t inmp441_deinit(void)
@@ -477,22 +955,6 @@ rt_err_t inmp441_deinit(void)
     if (dev->is_running)
         inmp441_stop();
 
-    sai_dma_deinit();
-    sai_peripheral_deinit();
-    sai_gpio_deinit();
-
-    for (int i = 0; i < AUDIO_BUFFER_COUNT; i++)
-    {
-        if (dev->frames[i].buffer)
-        {
-            rt_free(dev->frames[i].buffer);
-            dev->frames[i].buffer = RT_NULL;
-        }
-    }
-
-    if (dev->buffer_sem) rt_sem_delete(dev->buffer_sem);
-    if (dev->lock) rt_mutex_delete(dev->lock);
-
     dev->is_initialized = RT_FALSE;
     LOG_I("Deinitialized");
     return RT_EOK;
@@ -501,6 +963,7 @@ rt_err_t inmp441_deinit(void)
 rt_err_t inmp441_start(void)
 {
     inmp441_device_t *dev = &g_inmp441_dev;
+    rt_err_t result;
 
     if (!dev->is_initialized)
     {
@@ -511,19 +974,15 @@ rt_err_t inmp441_start(void)
     if (dev->is_running)
         return RT_EOK;
 
-    dev->write_idx = 0;
-    dev->read_idx = 0;
-    dev->frame_count = 0;
-
-    rt_memset(dma_buffer, 0, sizeof(dma_buffer));
-
-#if USE_SAI2_WITH_PE7
-    if (HAL_SAI_Receive_DMA(&hsai2b, (uint8_t *)dma_buffer, SAI_DMA_BUFFER_SIZE * 2) != HAL_OK)
+    /* the first reader to open it starts the SAI */
+    result = rt_device_open(dev->dev, RT_DEVICE_OFLAG_RDONLY);
+    if (result != RT_EOK)
     {
-        LOG_E("Failed to start DMA: err=0x%08X", hsai2b.ErrorCode);
-        return -RT_ERROR;
+        LOG_E("Failed to open %s: %d", INMP441_RECORD_DEVICE, result);
+        return result;
     }
-#endif
+    rt_audio_pipe_reader_attach(&((struct rt_audio_device *)dev->dev)->record->pipe,
+                                &dev->reader, "inmp441");
 
     dev->is_running = RT_TRUE;
     LOG_I("Started");
@@ -537,60 +996,70 @@ rt_err_t inmp441_stop(void)
     if (!dev->is_running)
         return RT_EOK;
 
-#if USE_SAI2_WITH_PE7
-    HAL_SAI_DMAStop(&hsai2b);
-#endif
-
     dev->is_running = RT_FALSE;
-    LOG_I("Stopped (frames=%d, errors=%d)", dev->total_frames, dev->dma_errors);
+    rt_audio_pipe_reader_detach(&((struct rt_audio_device *)dev->dev)->record->pipe, &dev->reader);
+    rt_device_close(dev->dev);
+
+    LOG_I("Stopped (frames=%d, dropped=%d)", dev->total_frames, dev->reader.dropped);
     return RT_EOK;
 }
 
 rt_err_t inmp441_read_frame(audio_frame_t *frame, rt_int32_t timeout)
 {
     inmp441_device_t *dev = &g_inmp441_dev;
+    struct rt_audio_pipe *pipe;
+    struct rt_audio_configure config;
+    const void *data;
+    rt_ssize_t avail;
+    uint32_t count;
 
     if (!dev->is_running || !frame)
         return -RT_ERROR;
 
-    if (rt_sem_take(dev->buffer_sem, timeout) != RT_EOK)
+    pipe = &((struct rt_audio_device *)dev->dev)->record->pipe;
+    avail = rt_audio_pipe_acquire(pipe, &dev->reader, &data, timeout);
+    if (avail <= 0)
         return -RT_ETIMEOUT;
 
-    rt_mutex_take(dev->lock, RT_WAITING_FOREVER);
+    config = g_sai.rx_config;
+    count = avail / (config.channels * (config.samplebits / 8));
+    if (count > AUDIO_FRAME_SIZE)
+        count = AUDIO_FRAME_SIZE;
+    if (count == 0)
+    {
+        rt_audio_pipe_release(pipe, &dev->reader, avail);
+        return -RT_ETIMEOUT;
+    }
 
-    audio_frame_t *src = &dev->frames[dev->read_idx];
-    frame->buffer = rt_malloc(src->size * sizeof(int32_t));
+    frame->buffer = rt_malloc(count * sizeof(int32_t));
     if (!frame->buffer)
     {
-        rt_mutex_release(dev->lock);
+        rt_audio_pipe_release(pipe, &dev->reader, 0);
         return -RT_ENOMEM;
     }
 
-    rt_memcpy(frame->buffer, src->buffer, src->size * sizeof(int32_t));
-    frame->size = src->size;
-    frame->sample_rate = src->sample_rate;
-    frame->channels = src->channels;
-    frame->bit_width = src->bit_width;
-    frame->timestamp = src->timestamp;
-
-    dev->read_idx = (dev->read_idx + 1) % AUDIO_BUFFER_COUNT;
-    dev->frame_count--;
+    rt_audio_pipe_release(pipe, &dev->reader, inmp441_convert(frame->buffer, data, count, &config));
+    frame->size = count;
+    frame->sample_rate = config.samplerate;
+    frame->channels = INMP441_CHANNEL_NUM;
+    frame->bit_width = INMP441_BIT_WIDTH;
+    frame->timestamp = rt_tick_get();
 
-    rt_mutex_release(dev->lock);
+    dev->total_frames++;
     return RT_EOK;
 }
 
 void inmp441_get_stats(uint32_t *total_frames, uint32_t *overrun_count)
 {
     if (total_frames) *total_frames = g_inmp441_dev.total_frames;
-    if (overrun_count) *overrun_count = g_inmp441_dev.overrun_count;
+    if (overrun_count) *overrun_count = g_inmp441_dev.reader.dropped;
 }
 
 void inmp441_reset_stats(void)
 {
     g_inmp441_dev.total_frames = 0;
-    g_inmp441_dev.overrun_count = 0;
-    g_inmp441_dev.dma_errors = 0;
+    g_inmp441_dev.reader.dropped = 0;
+    g_sai.stats.dma_errors = 0;
 }
 
 rt_bool_t inmp441_is_running(void)
@@ -603,13 +1072,68 @@ inmp441_device_t *inmp441_get_device(void)
     return &g_inmp441_dev;
 }
 
+/* ==================== Statistics ==================== */
+
+static int sai_audio(int argc, char **argv)
+{
+    struct sai_audio_stats st;
+    rt_uint32_t rate = g_sai.rx_config.samplerate;
+    rt_uint32_t per_half, tx_frame_bytes;
+    rt_base_t level;
+
+    if (argc > 1 && !rt_strcmp(argv[1], "reset"))
+    {
+        level = rt_hw_interrupt_disable();
+        rt_memset(&g_sai.stats, 0, sizeof(g_sai.stats));
+        rt_hw_interrupt_enable(level);
+        return 0;
+    }
+    else if (argc > 1)
+    {
+        rt_kprintf("Usage: sai_audio [reset]\n");
+        return -1;
+    }
+
+    level = rt_hw_interrupt_disable();
+    st = g_sai.stats;
+    rt_hw_interrupt_enable(level);
+
+    per_half = st.rx_halves ? (rt_uint32_t)(st.rx_cycles / st.rx_halves) : 0;
+    tx_frame_bytes = g_sai.tx_config.channels * (g_sai.tx_config.samplebits / 8);
+
+    rt_kprintf("sai: %u Hz, clocks for%s%s%s\n", rate,
+               (g_sai.users & SAI_USER_RECORD) ? " record" : "",
+               (g_sai.users & SAI_USER_REPLAY) ? " replay" : "",
+               g_sai.users ? "" : " nothing, stopped");
+    rt_kprintf("%s: %u ch %u bit, %u halves, %u blocks, %u overruns\n", INMP441_RECORD_DEVICE,
+               g_sai.rx_config.channels, g_sai.rx_config.samplebits,
+               st.rx_halves, st.rx_blocks, st.rx_overruns);
+    /* a half holds SAI_HALF_FRAMES frames, in hundredths of a percent */
+    rt_kprintf("  %u cycles per half into the pipe, %u.%02u%% CPU\n", per_half,
+               (rt_uint32_t)((rt_uint64_t)per_half * rate * 100 / SAI_HALF_FRAMES / SystemCoreClock),
+               (rt_uint32_t)((rt_uint64_t)per_half * rate * 10000 / SAI_HALF_FRAMES / SystemCoreClock % 100));
+    rt_kprintf("%s: %u ch %u bit, %u blocks played, 2 x %u B = %u ms buffered\n", INMP441_REPLAY_DEVICE,
+               g_sai.tx_config.channels, g_sai.tx_config.samplebits, st.tx_halves,
+               SAI_TX_BLOCK_BYTES, (rt_uint32_t)(sizeof(tx_buffer) / tx_frame_bytes * 1000 / rate));
+    rt_kprintf("dma errors: %u\n", st.dma_errors);
+    if (g_sai.recording)
+    {
+        /* the start of the DMA buffer, as the microphone sent it */
+        SCB_InvalidateDCache_by_Addr((uint32_t *)dma_buffer, 4 * sizeof(int32_t));
+        rt_kprintf("raw: 0x%08X, 0x%08X, 0x%08X, 0x%08X\n", (uint32_t)dma_buffer[0],
+                   (uint32_t)dma_buffer[1], (uint32_t)dma_buffer[2], (uint32_t)dma_buffer[3]);
+    }
+
+    return 0;
+}
+MSH_CMD_EXPORT(sai_audio, SAI record and replay statistics: sai_audio [reset]);
+
 /* ==================== Debug Functions ==================== */
 
 void inmp441_debug_direct_read(void)
 {
     rt_kprintf("\n========== SAI Debug ==========\n");
 
-#if USE_SAI2_WITH_PE7
     rt_kprintf("Using SAI2_Block_B with PE7 for SD\n");
     rt_kprintf("SAI2_Block_B->CR1: 0x%08X\n", SAI2_Block_B->CR1);
     rt_kprintf("SAI2_Block_B->SR:  0x%08X\n", SAI2_Block_B->SR);
@@ -633,16 +1157,6 @@ void inmp441_debug_direct_read(void)
         rt_kprintf("WARNING: PE7 stuck LOW - check wiring!\n");
     else if (high > 100 && low > 100)
         rt_kprintf("OK: PE7 shows activity\n");
-#else
-    rt_kprintf("SAI1 mode - checking PE3\n");
-    int high = 0, low = 0;
-    for (int i = 0; i < 1000; i++)
-    {
-        if (GPIOE->IDR & GPIO_PIN_3) high++;
-        else low++;
-    }
-    rt_kprintf("PE3 sampling: HIGH=%d, LOW=%d\n", high, low);
-#endif
 
     rt_kprintf("================================\n\n");
 }
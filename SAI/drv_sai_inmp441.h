@@ -10,12 +10,16 @@
  * --------      --------------------------------
  * SCK    <-->   PA2  (Pin 12, SAI2_SCK_B)  - Bit Clock (AF8)
  * WS     <-->   PC0  (Pin 33, SAI2_FS_B)   - Word Select / Frame Sync (AF8)
- * SD     <-->   PE3  (Pin 38, SAI2_SD_B)   - Serial Data Input (AF10)  *** CHANGED from PE7 ***
+ * SD     <-->   PE7  (Pin 40, SAI2_SD_B)   - Serial Data Input (AF10)
  * L/R    <-->   GND                        - Left Channel
  * VDD    <-->   +3.3V (Pin 1)
  * GND    <-->   GND (Pin 39/40 area)
  *
- * Note: PE7 (Pin 40) is PCM-OUT (output), PE3 (Pin 38) is PCM-IN (input)!
+ * Replay (I2S amplifier/DAC, shares SCK and WS above):
+ * DIN    <-->   PE3  (Pin 38, SAI1_SD_B)   - Serial Data Output (AF6)
+ *
+ * Note: the P1 silkscreen names PE7 PCM-OUT and PE3 PCM-IN, the driver uses
+ *       PE7 as input and PE3 as output, see drv_sai_inmp441.c
  * Note: MCLK (PE14) is NOT needed for INMP441
  */
 
@@ -38,9 +42,21 @@ extern "C" {
 
 /* Buffer Configuration */
 #define SAI_DMA_BUFFER_SIZE         1024        /* DMA buffer size in samples */
-#define AUDIO_BUFFER_COUNT          4           /* Number of audio frame buffers */
 #define AUDIO_FRAME_SIZE            512         /* Frame size in samples */
 
+/* rt_audio devices: record from SAI2_Block_B, replay on SAI1_Block_B */
+#define INMP441_RECORD_DEVICE       "mic0"
+#define INMP441_REPLAY_DEVICE       "sound0"
+
+/*
+ * Replay: two blocks of SAI_TX_BLOCK_BYTES, the audio framework fills one
+ * while DMA plays the other. SAI1_Block_B sends on PE3 (P1 Pin 38,
+ * SAI1_SD_B AF6) with the bit clock and frame sync of SAI2 on PA2/PC0.
+ * 512 bytes is 16 ms of 16 kHz mono, the same as a replay pool block, so
+ * prompts start after at most four of them.
+ */
+#define SAI_TX_BLOCK_BYTES          512
+
 /* SAI2 Pin Definitions (AF8/AF10) */
 #define SAI2_SCK_PIN                GPIO_PIN_2  /* PA2 - SAI2_SCK_B (AF8) */
 #define SAI2_SCK_PORT               GPIOA
@@ -70,21 +86,16 @@ typedef struct {
 
 /**
  * @brief INMP441 device structure
+ * @note One reader of the record pipe of INMP441_RECORD_DEVICE, next to
+ *       whatever else reads it (USB audio, recorders)
  */
 typedef struct {
-    rt_sem_t buffer_sem;            /* Buffer semaphore */
-    rt_mutex_t lock;                /* Device lock */
-
-    /* Audio Frame Buffers */
-    audio_frame_t frames[AUDIO_BUFFER_COUNT];
-    volatile uint32_t write_idx;    /* Write index */
-    volatile uint32_t read_idx;     /* Read index */
-    volatile uint32_t frame_count;  /* Available frame count */
+    rt_device_t dev;                /* INMP441_RECORD_DEVICE */
+    struct rt_audio_pipe_reader reader;
 
     /* Statistics */
     uint32_t total_frames;          /* Total frames captured */
     uint32_t overrun_count;         /* Buffer overrun count */
-    uint32_t dma_errors;            /* DMA error count */
 
     rt_bool_t is_initialized;       /* Initialization state */
     rt_bool_t is_running;           /* Running state */
@@ -113,6 +124,7 @@ rt_err_t inmp441_start(void);
 /**
  * @brief Stop audio capture
  * @return RT_EOK on success, error code otherwise
+ * @note The SAI keeps running while other readers have the device open
  */
 rt_err_t inmp441_stop(void);
 
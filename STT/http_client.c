@@ -1,5 +1,8 @@
 /*
- * http_client.c - 轻量级HTTP客户端(基于SAL/POSIX socket)
+ * http_client.c - 轻量级HTTP/HTTPS客户端(基于SAL/POSIX socket)
+ *
+ * 443/8443端口走SAL TLS(proto_mbedtls), 同一主机的TLS会话由SAL缓存并在
+ * 下次握手时恢复; 响应按Content-Length/chunked定界, 连接保持空闲以便复用.
  */
 #include "http_client.h"
 #include "stt_config.h"
@@ -11,8 +14,62 @@
 #include <sys/select.h>
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
+#ifdef SAL_USING_TLS
+#include <sal_tls.h>
+#endif
 
-/* 内部: 创建TCP连接 */
+#define HTTP_HOST_MAX_LEN   64
+
+/* 空闲长连接 */
+struct http_conn
+{
+    char      host[HTTP_HOST_MAX_LEN];
+    uint16_t  port;
+    int       sock;                 /* -1: 空槽 */
+    rt_tick_t idle_tick;            /* 进入空闲的时刻 */
+};
+
+/* 最近一次请求的连接信息, 供https_bench统计 */
+struct http_conn_info
+{
+    rt_bool_t tls;
+    rt_bool_t reused;
+    uint32_t  connect_ms;           /* TCP建连 + TLS握手 */
+};
+
+static struct http_conn conn_cache[HTTP_KEEPALIVE_CONN_NUM];
+static struct rt_mutex conn_lock;
+static rt_bool_t conn_cache_inited = RT_FALSE;
+static struct http_conn_info last_info;
+
+static rt_bool_t http_use_tls(uint16_t port)
+{
+#ifdef SAL_USING_TLS
+    return port == HTTPS_PORT || port == HTTPS_TEST_PORT;
+#else
+    return RT_FALSE;
+#endif
+}
+
+static void conn_cache_init(void)
+{
+    int i;
+
+    if (conn_cache_inited)
+        return;
+
+    rt_enter_critical();
+    if (!conn_cache_inited)
+    {
+        rt_mutex_init(&conn_lock, "http", RT_IPC_FLAG_PRIO);
+        for (i = 0; i < HTTP_KEEPALIVE_CONN_NUM; i++)
+            conn_cache[i].sock = -1;
+        conn_cache_inited = RT_TRUE;
+    }
+    rt_exit_critical();
+}
+
+/* 内部: 创建TCP(或TLS)连接 */
 static int http_connect(const char *host, uint16_t port)
 {
     struct hostent *he;
@@ -20,8 +77,9 @@ static int http_connect(const char *host, uint16_t port)
     int sock;
     struct timeval tv;
     int opt;
+    rt_tick_t start;
 
-    rt_kprintf("[HTTP] Connecting to %s:%d\n", host, port);
+    rt_kprintf("[HTTP] Connecting to %s:%d%s\n", host, port, http_use_tls(port) ? " (TLS)" : "");
 
     he = gethostbyname(host);
     if (he == RT_NULL)
@@ -30,13 +88,24 @@ static int http_connect(const char *host, uint16_t port)
         return -1;
     }
 
-    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#ifdef SAL_USING_TLS
+    if (http_use_tls(port))
+        sock = socket(AF_INET, SOCK_STREAM, PROTOCOL_TLS);
+    else
+#endif
+        sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (sock < 0)
     {
         rt_kprintf("[HTTP] Socket create failed\n");
         return -1;
     }
 
+#ifdef SAL_USING_TLS
+    /* SNI及TLS会话恢复都以主机名为键 */
+    if (http_use_tls(port))
+        setsockopt(sock, SOL_TLS, TLS_HOST_NAME, host, rt_strlen(host));
+#endif
+
     /* 设置发送/接收超时 */
     tv.tv_sec  = HTTP_SEND_TIMEOUT;
     tv.tv_usec = 0;
@@ -57,17 +126,109 @@ static int http_connect(const char *host, uint16_t port)
     server_addr.sin_port   = htons(port);
     server_addr.sin_addr   = *((struct in_addr *)he->h_addr);
 
+    start = rt_tick_get();
     if (connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
     {
         rt_kprintf("[HTTP] Connect failed: %s:%d\n", host, port);
         closesocket(sock);
         return -1;
     }
+    last_info.connect_ms = (rt_tick_get() - start) * 1000 / RT_TICK_PER_SECOND;
 
-    rt_kprintf("[HTTP] Connected successfully\n");
+    rt_kprintf("[HTTP] Connected successfully (%d ms)\n", last_info.connect_ms);
     return sock;
 }
 
+/* 内部: 取一个到host:port的连接, 优先复用空闲长连接 */
+static int http_open(const char *host, uint16_t port, rt_bool_t *reused)
+{
+    int i, sock = -1;
+
+    conn_cache_init();
+
+    rt_mutex_take(&conn_lock, RT_WAITING_FOREVER);
+    for (i = 0; i < HTTP_KEEPALIVE_CONN_NUM; i++)
+    {
+        struct http_conn *conn = &conn_cache[i];
+
+        if (conn->sock < 0 || conn->port != port || rt_strcmp(conn->host, host) != 0)
+            continue;
+
+        if (rt_tick_get() - conn->idle_tick < rt_tick_from_millisecond(HTTP_KEEPALIVE_IDLE_MS))
+            sock = conn->sock;
+        else
+            closesocket(conn->sock);
+        conn->sock = -1;
+        break;
+    }
+    rt_mutex_release(&conn_lock);
+
+    last_info.tls = http_use_tls(port);
+    if (sock >= 0)
+    {
+        *reused = RT_TRUE;
+        last_info.reused = RT_TRUE;
+        last_info.connect_ms = 0;
+        return sock;
+    }
+
+    *reused = RT_FALSE;
+    last_info.reused = RT_FALSE;
+    return http_connect(host, port);
+}
+
+/* 内部: 请求结束, keep为真时放回空闲连接缓存, 否则关闭 */
+static void http_release(const char *host, uint16_t port, int sock, rt_bool_t keep)
+{
+    struct http_conn *slot = RT_NULL;
+    int i;
+
+    if (!keep || rt_strlen(host) >= HTTP_HOST_MAX_LEN)
+    {
+        closesocket(sock);
+        return;
+    }
+
+    rt_mutex_take(&conn_lock, RT_WAITING_FOREVER);
+    for (i = 0; i < HTTP_KEEPALIVE_CONN_NUM; i++)
+    {
+        /* 优先空槽, 否则替换空闲最久的连接 */
+        if (conn_cache[i].sock < 0)
+        {
+            slot = &conn_cache[i];
+            break;
+        }
+        if (slot == RT_NULL || (rt_int32_t)(conn_cache[i].idle_tick - slot->idle_tick) < 0)
+            slot = &conn_cache[i];
+    }
+    if (slot->sock >= 0)
+        closesocket(slot->sock);
+    rt_strncpy(slot->host, host, HTTP_HOST_MAX_LEN);
+    slot->port = port;
+    slot->sock = sock;
+    slot->idle_tick = rt_tick_get();
+    rt_mutex_release(&conn_lock);
+}
+
+/* 关闭所有空闲长连接 */
+void http_keepalive_flush(void)
+{
+    int i;
+
+    conn_cache_init();
+
+    rt_mutex_take(&conn_lock, RT_WAITING_FOREVER);
+    for (i = 0; i < HTTP_KEEPALIVE_CONN_NUM; i++)
+    {
+        if (conn_cache[i].sock >= 0)
+        {
+            closesocket(conn_cache[i].sock);
+            conn_cache[i].sock = -1;
+        }
+    }
+    rt_mutex_release(&conn_lock);
+}
+
 /* 内部: 发送全部数据 (分块发送大数据) */
 static rt_err_t http_send_all(int sock, const void *data, uint32_t len)
 {
@@ -115,20 +276,134 @@ static rt_err_t http_send_all(int sock, const void *data, uint32_t len)
     return RT_EOK;
 }
 
-/* 内部: 接收HTTP响应并解析 */
-static rt_err_t http_recv_response(int sock, http_response_t *resp)
+/* 内部: 不区分大小写地查找响应头, 返回值的起始位置 */
+static const char *http_header_find(const char *hdr, const char *hdr_end, const char *name)
+{
+    size_t name_len = rt_strlen(name);
+    const char *line = hdr;
+
+    while (line && line < hdr_end)
+    {
+        const char *p = line;
+        size_t i;
+
+        for (i = 0; i < name_len && p < hdr_end; i++, p++)
+        {
+            char c = *p;
+            if (c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+            if (c != name[i])
+                break;
+        }
+        if (i == name_len && p < hdr_end && *p == ':')
+        {
+            p++;
+            while (p < hdr_end && (*p == ' ' || *p == '\t'))
+                p++;
+            return p;
+        }
+
+        line = strstr(line, "\r\n");
+        if (line)
+            line += 2;
+    }
+
+    return RT_NULL;
+}
+
+static rt_bool_t http_value_is(const char *value, const char *expect)
+{
+    size_t i;
+
+    for (i = 0; expect[i]; i++)
+    {
+        char c = value[i];
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        if (c != expect[i])
+            return RT_FALSE;
+    }
+
+    return RT_TRUE;
+}
+
+/*
+ * 内部: 检查/解码chunked响应体
+ * decode为0时只判断是否接收完整, 为1时原地解码
+ * 返回: 1完整, 0不完整, -1格式错误
+ */
+static int http_chunked(char *body, int len, int decode, int *out_len)
+{
+    char *p = body, *end = body + len, *out = body;
+
+    while (p < end)
+    {
+        char *line_end = strstr(p, "\r\n");
+        unsigned long size;
+
+        if (line_end == RT_NULL)
+            return 0;
+        size = strtoul(p, RT_NULL, 16);
+        p = line_end + 2;
+
+        if (size == 0)
+        {
+            /* 跳过trailer, 直到空行 */
+            while (1)
+            {
+                line_end = strstr(p, "\r\n");
+                if (line_end == RT_NULL)
+                    return 0;
+                if (line_end == p)
+                {
+                    if (decode)
+                        *out_len = out - body;
+                    return 1;
+                }
+                p = line_end + 2;
+            }
+        }
+
+        if ((unsigned long)(end - p) < size + 2)
+            return 0;
+        if (p[size] != '\r' || p[size + 1] != '\n')
+            return -1;
+        if (decode)
+        {
+            rt_memmove(out, p, size);
+            out += size;
+        }
+        p += size + 2;
+    }
+
+    return 0;
+}
+
+/*
+ * 内部: 接收HTTP响应并解析
+ * 按Content-Length或chunked定界, 这样连接可以保持; 两者都没有时读到对端关闭.
+ * keep输出连接是否可以复用
+ */
+static rt_err_t http_recv_response(int sock, http_response_t *resp, rt_bool_t *keep)
 {
     char *recv_buf;
     int total_len = 0;
     int ret;
     int buf_capacity = HTTP_RECV_BUF_SIZE;
+    int hdr_len = 0;            /* 含空行, 0表示头部未收全 */
+    int content_len = -1;
+    rt_bool_t chunked = RT_FALSE;
+    rt_bool_t complete = RT_FALSE;
+    const char *value;
+
+    *keep = RT_FALSE;
 
     recv_buf = (char *)rt_malloc(buf_capacity);
     if (recv_buf == RT_NULL)
         return -RT_ENOMEM;
 
     /* 接收数据 */
-    while (1)
+    while (!complete)
     {
         if (total_len >= buf_capacity - 1)
         {
@@ -145,6 +420,41 @@ static rt_err_t http_recv_response(int sock, http_response_t *resp)
         if (ret <= 0)
             break;
         total_len += ret;
+        recv_buf[total_len] = '\0';
+
+        if (hdr_len == 0)
+        {
+            char *hdr_end = strstr(recv_buf, "\r\n\r\n");
+            int status;
+
+            if (hdr_end == RT_NULL)
+                continue;
+            hdr_len = hdr_end + 4 - recv_buf;
+
+            /* 解析状态码: "HTTP/1.x NNN" */
+            status = 0;
+            if (rt_strncmp(recv_buf, "HTTP/", 5) == 0 && strchr(recv_buf, ' '))
+                status = atoi(strchr(recv_buf, ' ') + 1);
+
+            value = http_header_find(recv_buf, hdr_end, "content-length");
+            if (value)
+                content_len = atoi(value);
+            value = http_header_find(recv_buf, hdr_end, "transfer-encoding");
+            if (value && http_value_is(value, "chunked"))
+                chunked = RT_TRUE;
+            if (status == 204 || status == 304 || (status >= 100 && status < 200))
+                content_len = 0;
+
+            *keep = (chunked || content_len >= 0);
+            value = http_header_find(recv_buf, hdr_end, "connection");
+            if (value && http_value_is(value, "close"))
+                *keep = RT_FALSE;
+        }
+
+        if (chunked)
+            complete = (http_chunked(recv_buf + hdr_len, total_len - hdr_len, 0, RT_NULL) != 0);
+        else if (content_len >= 0)
+            complete = (total_len - hdr_len >= content_len);
     }
 
     recv_buf[total_len] = '\0';
@@ -155,6 +465,10 @@ static rt_err_t http_recv_response(int sock, http_response_t *resp)
         return -RT_ERROR;
     }
 
+    /* 未按定界收完(超时/对端关闭/内存不足)的连接不能复用 */
+    if (!complete)
+        *keep = RT_FALSE;
+
     /* 解析状态码: "HTTP/1.x NNN" */
     resp->status_code = 0;
     char *status_start = strstr(recv_buf, "HTTP/");
@@ -166,11 +480,22 @@ static rt_err_t http_recv_response(int sock, http_response_t *resp)
     }
 
     /* 找到body (空行 \r\n\r\n 之后) */
-    char *body_start = strstr(recv_buf, "\r\n\r\n");
-    if (body_start)
+    if (hdr_len > 0)
     {
-        body_start += 4;
-        resp->body_len = total_len - (body_start - recv_buf);
+        char *body_start = recv_buf + hdr_len;
+        int body_len = total_len - hdr_len;
+
+        if (chunked)
+        {
+            if (http_chunked(body_start, body_len, 1, &body_len) != 1)
+                body_len = 0;
+        }
+        else if (content_len >= 0 && body_len > content_len)
+        {
+            body_len = content_len;
+        }
+
+        resp->body_len = body_len;
         resp->body = (char *)rt_malloc(resp->body_len + 1);
         if (resp->body)
         {
@@ -188,46 +513,72 @@ static rt_err_t http_recv_response(int sock, http_response_t *resp)
     return RT_EOK;
 }
 
+/*
+ * 内部: 发送请求并接收响应
+ * 复用的连接可能已被服务器关闭, 此时在新连接上重试一次
+ */
+static rt_err_t http_request(const char *host, uint16_t port,
+                             const char *header, int hdr_len,
+                             const uint8_t *body, uint32_t body_len,
+                             http_response_t *resp)
+{
+    rt_bool_t reused, keep;
+    rt_err_t ret = -RT_ERROR;
+    int sock;
+    int attempt;
+
+    for (attempt = 0; attempt < 2; attempt++)
+    {
+        rt_memset(resp, 0, sizeof(http_response_t));
+
+        sock = http_open(host, port, &reused);
+        if (sock < 0)
+            return -RT_ERROR;
+
+        ret = http_send_all(sock, header, hdr_len);
+        if (ret == RT_EOK && body_len > 0)
+            ret = http_send_all(sock, body, body_len);
+        if (ret == RT_EOK)
+            ret = http_recv_response(sock, resp, &keep);
+
+        if (ret == RT_EOK)
+        {
+            http_release(host, port, sock, HTTP_KEEPALIVE_ENABLE && keep);
+            return RT_EOK;
+        }
+
+        closesocket(sock);
+        if (!reused)
+            break;
+        rt_kprintf("[HTTP] Reused connection failed, retry on a new one\n");
+    }
+
+    return ret;
+}
+
 rt_err_t http_get(const char *host, uint16_t port,
                   const char *path, http_response_t *resp)
 {
-    int sock;
     char *request;
     int req_len;
     rt_err_t ret;
 
     rt_memset(resp, 0, sizeof(http_response_t));
 
-    sock = http_connect(host, port);
-    if (sock < 0)
-        return -RT_ERROR;
-
     /* 构造GET请求 */
     request = (char *)rt_malloc(512 + rt_strlen(path));
     if (request == RT_NULL)
-    {
-        closesocket(sock);
         return -RT_ENOMEM;
-    }
 
     req_len = rt_snprintf(request, 512 + rt_strlen(path),
         "GET %s HTTP/1.1\r\n"
         "Host: %s\r\n"
-        "Connection: close\r\n"
+        "Connection: %s\r\n"
         "\r\n",
-        path, host);
+        path, host, HTTP_KEEPALIVE_ENABLE ? "keep-alive" : "close");
 
-    ret = http_send_all(sock, request, req_len);
+    ret = http_request(host, port, request, req_len, RT_NULL, 0, resp);
     rt_free(request);
-
-    if (ret != RT_EOK)
-    {
-        closesocket(sock);
-        return ret;
-    }
-
-    ret = http_recv_response(sock, resp);
-    closesocket(sock);
     return ret;
 }
 
@@ -237,54 +588,29 @@ rt_err_t http_post(const char *host, uint16_t port,
                    const char *content_type,
                    http_response_t *resp)
 {
-    int sock;
     char *header;
     int hdr_len;
     rt_err_t ret;
 
     rt_memset(resp, 0, sizeof(http_response_t));
 
-    sock = http_connect(host, port);
-    if (sock < 0)
-        return -RT_ERROR;
-
     /* 构造POST头 */
     header = (char *)rt_malloc(512 + rt_strlen(path));
     if (header == RT_NULL)
-    {
-        closesocket(sock);
         return -RT_ENOMEM;
-    }
 
     hdr_len = rt_snprintf(header, 512 + rt_strlen(path),
         "POST %s HTTP/1.1\r\n"
         "Host: %s\r\n"
         "Content-Type: %s\r\n"
         "Content-Length: %d\r\n"
-        "Connection: close\r\n"
+        "Connection: %s\r\n"
         "\r\n",
-        path, host, content_type, body_len);
+        path, host, content_type, body_len,
+        HTTP_KEEPALIVE_ENABLE ? "keep-alive" : "close");
 
-    /* 发送头 */
-    ret = http_send_all(sock, header, hdr_len);
+    ret = http_request(host, port, header, hdr_len, body, body_len, resp);
     rt_free(header);
-
-    if (ret != RT_EOK)
-    {
-        closesocket(sock);
-        return ret;
-    }
-
-    /* 发送body */
-    ret = http_send_all(sock, body, body_len);
-    if (ret != RT_EOK)
-    {
-        closesocket(sock);
-        return ret;
-    }
-
-    ret = http_recv_response(sock, resp);
-    closesocket(sock);
     return ret;
 }
 
@@ -297,3 +623,53 @@ void http_response_free(http_response_t *resp)
         resp->body_len = 0;
     }
 }
+
+#ifdef RT_USING_FINSH
+#include <finsh.h>
+
+/*
+ * https_bench <host> [port] [path]
+ * 依次测量: 新连接(首次为完整握手), 新连接(TLS会话恢复), 复用长连接
+ * 握手次数与平均耗时见tls_stats
+ */
+static void https_bench(int argc, char **argv)
+{
+    static const char *const names[] = { "new", "resumed", "reused" };
+    const char *host, *path = "/";
+    uint16_t port = HTTPS_PORT;
+    http_response_t resp;
+    rt_tick_t start;
+    int i;
+
+    if (argc < 2)
+    {
+        rt_kprintf("Usage: https_bench <host> [port] [path]\n");
+        return;
+    }
+    host = argv[1];
+    if (argc > 2)
+        port = atoi(argv[2]);
+    if (argc > 3)
+        path = argv[3];
+
+    for (i = 0; i < 3; i++)
+    {
+        /* 前两次关闭空闲连接, 强制重新建连/握手 */
+        if (i < 2)
+            http_keepalive_flush();
+
+        start = rt_tick_get();
+        if (http_get(host, port, path, &resp) != RT_EOK)
+        {
+            rt_kprintf("[HTTP] %-8s request failed\n", names[i]);
+            return;
+        }
+        rt_kprintf("[HTTP] %-8s %s status %d, connect %d ms, total %d ms%s\n", names[i],
+                   last_info.tls ? "tls" : "tcp", resp.status_code, last_info.connect_ms,
+                   (rt_tick_get() - start) * 1000 / RT_TICK_PER_SECOND,
+                   last_info.reused ? " (reused)" : "");
+        http_response_free(&resp);
+    }
+}
+MSH_CMD_EXPORT(https_bench, measure HTTPS connect/handshake time new vs resumed vs reused);
+#endif /* RT_USING_FINSH */
@@ -1,5 +1,5 @@
 /*
- * http_client.h - 轻量级HTTP客户端(基于SAL socket)
+ * http_client.h - 轻量级HTTP/HTTPS客户端(基于SAL socket)
  */
 #ifndef __HTTP_CLIENT_H__
 #define __HTTP_CLIENT_H__
@@ -21,7 +21,7 @@ typedef struct {
 /**
  * @brief 发送HTTP GET请求
  * @param host      主机名
- * @param port      端口
+ * @param port      端口(443/8443走TLS)
  * @param path      请求路径(含query string)
  * @param resp      输出: 响应结构
  * @return RT_EOK成功
@@ -51,6 +51,11 @@ rt_err_t http_post(const char *host, uint16_t port,
  */
 void http_response_free(http_response_t *resp);
 
+/**
+ * @brief 关闭所有空闲长连接(网络断开或切换时调用)
+ */
+void http_keepalive_flush(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,64 @@
+# -*- coding: utf-8 -*-
+# 本地HTTPS测试服务器, 代替百度API测量TLS握手/会话恢复/长连接耗时
+#
+# 生成自签名证书:
+#   openssl req -x509 -newkey rsa:2048 -nodes -days 365 \
+#       -keyout stub.key -out stub.crt -subj "/CN=stt-stub"
+# 运行:
+#   python3 https_stub_server.py 0.0.0.0 8443 stub.crt stub.key
+# 板端(需把stub.crt加入mbedtls软件包的证书列表):
+#   https_bench <PC的IP> 8443 /
+#   tls_stats
+import json
+import ssl
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+class StubHandler(BaseHTTPRequestHandler):
+    # HTTP/1.1: 默认长连接
+    protocol_version = 'HTTP/1.1'
+
+    def reply(self, obj):
+        body = json.dumps(obj).encode('utf-8')
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        if self.path.startswith('/oauth/2.0/token'):
+            self.reply({'access_token': 'stub-token', 'expires_in': 2592000})
+        else:
+            self.reply({'time': time.time()})
+
+    def do_POST(self):
+        length = int(self.headers.get('Content-Length', 0))
+        self.rfile.read(length)
+        self.reply({'err_no': 0, 'err_msg': 'success.', 'result': ['stub %d bytes' % length]})
+
+    def log_message(self, fmt, *args):
+        conn = self.connection
+        print('%s %s (tls %s, resumed %s)' % (self.address_string(), fmt % args,
+                                             conn.version(), conn.session_reused))
+
+
+def main():
+    if len(sys.argv) < 5:
+        print('Usage: %s <ip> <port> <cert> <key>' % sys.argv[0])
+        return
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    # mbedTLS 2.x客户端按TLS 1.2握手, 会话ticket在OpenSSL中默认开启
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+    ctx.load_cert_chain(sys.argv[3], sys.argv[4])
+
+    server = ThreadingHTTPServer((sys.argv[1], int(sys.argv[2])), StubHandler)
+    server.socket = ctx.wrap_socket(server.socket, server_side=True)
+    print('Waiting for connection on %s:%s...' % (sys.argv[1], sys.argv[2]))
+    server.serve_forever()
+
+
+if __name__ == '__main__':
+    main()
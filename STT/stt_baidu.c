@@ -12,6 +12,8 @@
  */
 #include "stt_baidu.h"
 #include "http_client.h"
+#include "metrics.h"
+#include "kvdb.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -25,6 +27,21 @@ static rt_bool_t g_token_valid = RT_FALSE;
 /* dev_pid: 1537=普通话+标点 */
 #define BAIDU_DEV_PID   "1537"
 
+/* 请求耗时分布(ms), 上界按TLS握手~ASR识别的量级划分 */
+static const int32_t g_latency_bounds[] = {
+    100, 200, 500, 1000, 2000, 3000, 5000, 10000
+};
+#define LATENCY_BUCKETS (sizeof(g_latency_bounds) / sizeof(g_latency_bounds[0]))
+
+static metric_t *g_token_latency = RT_NULL;
+static metric_t *g_asr_latency = RT_NULL;
+static metric_t *g_asr_errors = RT_NULL;
+
+static int32_t tick_to_ms(rt_tick_t start)
+{
+    return (int32_t)((rt_tick_get() - start) * 1000 / RT_TICK_PER_SECOND);
+}
+
 /* ==================== 内部: 简易JSON字段提取 ==================== */
 
 /**
@@ -123,6 +140,15 @@ rt_err_t stt_baidu_init(void)
 {
     http_response_t resp;
     char path[256];
+    char api_key[64], secret_key[64];
+
+    /* 键值存储里的 baidu.api_key / baidu.secret_key 优先于编译期配置 */
+    if (kvdb_get_str("baidu.api_key", api_key, sizeof(api_key)) <= 0)
+        rt_strncpy(api_key, BAIDU_API_KEY, sizeof(api_key) - 1);
+    if (kvdb_get_str("baidu.secret_key", secret_key, sizeof(secret_key)) <= 0)
+        rt_strncpy(secret_key, BAIDU_SECRET_KEY, sizeof(secret_key) - 1);
+    api_key[sizeof(api_key) - 1] = '\0';
+    secret_key[sizeof(secret_key) - 1] = '\0';
 
     rt_kprintf("[BaiduSTT] Requesting access_token...\n");
 
@@ -133,9 +159,18 @@ rt_err_t stt_baidu_init(void)
      */
     rt_snprintf(path, sizeof(path),
         "%s?grant_type=client_credentials&client_id=%s&client_secret=%s",
-        BAIDU_TOKEN_PATH, BAIDU_API_KEY, BAIDU_SECRET_KEY);
+        BAIDU_TOKEN_PATH, api_key, secret_key);
+
+    if (g_token_latency == RT_NULL)
+    {
+        g_token_latency = metric_histogram("stt.token_ms", g_latency_bounds, LATENCY_BUCKETS);
+        g_asr_latency = metric_histogram("stt.asr_ms", g_latency_bounds, LATENCY_BUCKETS);
+        g_asr_errors = metric_counter("stt.asr_errors");
+    }
 
+    rt_tick_t start = rt_tick_get();
     rt_err_t ret = http_get(BAIDU_TOKEN_HOST, BAIDU_TOKEN_PORT, path, &resp);
+    metric_observe(g_token_latency, tick_to_ms(start));
     if (ret != RT_EOK)
     {
         rt_kprintf("[BaiduSTT] Token request failed\n");
@@ -196,14 +231,17 @@ rt_err_t stt_baidu_recognize(const uint8_t *wav_data, uint32_t wav_len,
 
     rt_kprintf("[BaiduSTT] Sending %d bytes audio...\n", wav_len);
 
+    rt_tick_t start = rt_tick_get();
     ret = http_post(BAIDU_ASR_HOST, BAIDU_ASR_PORT,
                     path,
                     wav_data, wav_len,
                     "audio/wav;rate=16000",
                     &resp);
+    metric_observe(g_asr_latency, tick_to_ms(start));
 
     if (ret != RT_EOK)
     {
+        metric_inc(g_asr_errors);
         rt_kprintf("[BaiduSTT] Request failed\n");
         result->err_no = -1;
         rt_strncpy(result->err_msg, "HTTP request failed", sizeof(result->err_msg) - 1);
@@ -4,8 +4,11 @@
 #ifndef __STT_CONFIG_H__
 #define __STT_CONFIG_H__
 
+#include <rtconfig.h>
+
 /* ==================== 百度API配置 ==================== */
 /* 请在百度AI开放平台申请: https://ai.baidu.com/tech/speech */
+/* 运行时可用 kv set baidu.api_key / baidu.secret_key 覆盖, 不必重新编译 */
 #define BAIDU_API_KEY       "hNsazCqEr3uBDhHEAdByUzKq"
 #define BAIDU_SECRET_KEY    "7zWq8boftq2gFNOV0zhC9m0UB1E0culg"
 
@@ -14,8 +17,15 @@
 #define BAIDU_TOKEN_PATH    "/oauth/2.0/token"
 #define BAIDU_ASR_HOST      "vop.baidu.com"
 #define BAIDU_ASR_PATH      "/server_api/"
-#define BAIDU_TOKEN_PORT    80
+#ifdef SAL_USING_TLS
+#define BAIDU_TOKEN_PORT    443         /* HTTPS */
+#define BAIDU_ASR_PORT      443
+#elif defined(STT_ALLOW_PLAIN_HTTP)
+#define BAIDU_TOKEN_PORT    80          /* 仅调试: 显式允许时才走明文HTTP */
 #define BAIDU_ASR_PORT      80
+#else
+#error "STT需要HTTPS: 请启用SAL_USING_TLS和PKG_USING_MBEDTLS, 调试明文HTTP需定义STT_ALLOW_PLAIN_HTTP"
+#endif
 
 /* ==================== 音频参数 ==================== */
 #define STT_SAMPLE_RATE     16000       /* 百度要求16000Hz */
@@ -32,6 +42,15 @@
 #define HTTP_RECV_TIMEOUT   15          /* 接收超时(秒) */
 #define HTTP_TOKEN_LEN      128         /* Token最大长度 */
 
+/* HTTPS: 以下端口走TLS, 8443用于本地TLS测试服务器(https_stub_server.py) */
+#define HTTPS_PORT          443
+#define HTTPS_TEST_PORT     8443
+
+/* 长连接: 复用空闲连接, 省去TCP建连和TLS握手 */
+#define HTTP_KEEPALIVE_ENABLE   1
+#define HTTP_KEEPALIVE_CONN_NUM 2       /* 缓存的空闲连接数(token + asr) */
+#define HTTP_KEEPALIVE_IDLE_MS  30000   /* 空闲超过此时间的连接不再复用 */
+
 /* ==================== STT结果 ==================== */
 #define STT_RESULT_MAX_LEN  256         /* 识别结果最大长度 */
 
@@ -7,12 +7,14 @@
  * Date           Author       Notes
  * 2020-09-02     RT-Thread    first version
  * 2025-01-27     AI           Added WiFi and INMP441 audio capture support
+ * 2025-02-21     RT-Thread    Read the WiFi credentials from the key-value store
  */
 
 #include <rtthread.h>
 #include <rtdevice.h>
 #include "drv_common.h"
 #include "../IIC/iic_thread.h"
+#include "kvdb.h"
 
 #ifdef RT_USING_WIFI
 #include <wlan_mgnt.h>
@@ -22,6 +24,7 @@
 
 #define LED_PIN GET_PIN(O, 5)
 
+/* 键值存储里没有 wifi.ssid / wifi.password 时使用的默认值 */
 #define WIFI_SSID "CMCC-Vm3m"
 #define WIFI_PASSWORD "w3wegscf"
 
@@ -76,8 +79,13 @@ static rt_err_t wait_wlan_init_done(rt_uint32_t time_ms)
         return -RT_ETIMEOUT;
     }
 
-    /* 额外等待一段时间确保驱动完全就绪 */
-    rt_thread_mdelay(500);
+    /* 等待STA模式设置完成, 最多500ms, 不再固定延时 */
+    time_cnt = 0;
+    while ((rt_wlan_get_mode(RT_WLAN_DEVICE_STA_NAME) != RT_WLAN_STATION) && (time_cnt < 25))
+    {
+        time_cnt++;
+        rt_thread_mdelay(20);
+    }
 
     return RT_EOK;
 }
@@ -86,6 +94,7 @@ static rt_err_t wait_wlan_init_done(rt_uint32_t time_ms)
 static rt_err_t wifi_connect(const char *ssid, const char *password)
 {
     rt_err_t result = RT_EOK;
+    rt_tick_t start_tick;
 
     /* 保存SSID和密码 */
     rt_strncpy(wifi_ssid, ssid, sizeof(wifi_ssid) - 1);
@@ -96,16 +105,17 @@ static rt_err_t wifi_connect(const char *ssid, const char *password)
     rt_kprintf("[WiFi] Password: %s\n", password);
     rt_kprintf("[WiFi] Connecting...\n");
 
-    /* 连接WiFi */
+    /* 连接WiFi (有缓存的BSSID/信道时跳过扫描直接关联) */
+    start_tick = rt_tick_get();
     result = rt_wlan_connect(ssid, password);
 
     if (result == RT_EOK)
     {
         /* 等待连接就绪 */
         rt_uint32_t timeout = 0;
-        while (!rt_wlan_is_ready() && timeout < 100)
+        while (!rt_wlan_is_ready() && timeout < 500)
         {
-            rt_thread_mdelay(100);
+            rt_thread_mdelay(20);
             timeout++;
         }
 
@@ -113,6 +123,7 @@ static rt_err_t wifi_connect(const char *ssid, const char *password)
         {
             wifi_connected = RT_TRUE;
             rt_kprintf("[WiFi] Connected successfully!\n");
+            rt_kprintf("[WiFi] Join to IP: %d ms\n", (rt_tick_get() - start_tick) * 1000 / RT_TICK_PER_SECOND);
             rt_kprintf("[WiFi] Status: Connected\n");
         }
         else
@@ -150,10 +161,19 @@ int main(void)
     rt_kprintf("[Main] Waiting for WiFi initialization...\n");
     if (wait_wlan_init_done(10000) == RT_EOK)
     {
+        /* 32字节的SSID, 63字符的密码或64位十六进制PSK, 加结尾0 */
+        char ssid[33], password[65];
+
         rt_kprintf("[Main] WiFi initialization done\n");
 
-        /* 连接WiFi */
-        wifi_connect(WIFI_SSID, WIFI_PASSWORD);
+        /* 连接WiFi, 优先使用 kv set wifi.ssid/wifi.password 保存的配置 */
+        if (kvdb_get_str("wifi.ssid", ssid, sizeof(ssid)) <= 0)
+            rt_strncpy(ssid, WIFI_SSID, sizeof(ssid) - 1);
+        if (kvdb_get_str("wifi.password", password, sizeof(password)) <= 0)
+            rt_strncpy(password, WIFI_PASSWORD, sizeof(password) - 1);
+        ssid[sizeof(ssid) - 1] = '\0';
+        password[sizeof(password) - 1] = '\0';
+        wifi_connect(ssid, password);
     }
     else
     {
@@ -36,20 +36,20 @@
   * @brief This is the list of modules to be used in the HAL driver
   */
 #define HAL_MODULE_ENABLED
-/* #define HAL_ADC_MODULE_ENABLED   */
+#define HAL_ADC_MODULE_ENABLED
 /* #define HAL_CEC_MODULE_ENABLED   */
 /* #define HAL_CORDIC_MODULE_ENABLED   */
-/* #define HAL_CRC_MODULE_ENABLED   */
-/* #define HAL_CRYP_MODULE_ENABLED   */
+#define HAL_CRC_MODULE_ENABLED
+#define HAL_CRYP_MODULE_ENABLED
 #define HAL_DCMIPP_MODULE_ENABLED
 /* #define HAL_DMA2D_MODULE_ENABLED   */
 /* #define HAL_DTS_MODULE_ENABLED   */
 /* #define HAL_ETH_MODULE_ENABLED   */
-/* #define HAL_FDCAN_MODULE_ENABLED   */
+#define HAL_FDCAN_MODULE_ENABLED
 /* #define HAL_GFXMMU_MODULE_ENABLED   */
 /* #define HAL_GFXTIM_MODULE_ENABLED   */
 /* #define HAL_GPU2D_MODULE_ENABLED   */
-/* #define HAL_HASH_MODULE_ENABLED   */
+#define HAL_HASH_MODULE_ENABLED
 /* #define HAL_HCD_MODULE_ENABLED   */
 #define HAL_I2C_MODULE_ENABLED
 /* #define HAL_I2S_MODULE_ENABLED   */
@@ -66,11 +66,11 @@
 /* #define HAL_NAND_MODULE_ENABLED   */
 /* #define HAL_NOR_MODULE_ENABLED   */
 #define HAL_PCD_MODULE_ENABLED
-/* #define HAL_PKA_MODULE_ENABLED   */
+#define HAL_PKA_MODULE_ENABLED
 /* #define HAL_PSSI_MODULE_ENABLED   */
 /* #define HAL_RAMECC_MODULE_ENABLED   */
 /* #define HAL_RCC_MODULE_ENABLED   */
-/* #define HAL_RNG_MODULE_ENABLED   */
+#define HAL_RNG_MODULE_ENABLED
 /* #define HAL_RTC_MODULE_ENABLED   */
 #define HAL_SAI_MODULE_ENABLED
 #define HAL_SD_MODULE_ENABLED
@@ -253,7 +253,7 @@
 
 /* ################## HASH peripheral configuration ########################## */
 
-#define USE_HAL_HASH_SUSPEND_RESUME   0U
+#define USE_HAL_HASH_SUSPEND_RESUME   1U
 
 /* ################## SDMMC peripheral configuration ######################### */
 
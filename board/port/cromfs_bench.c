@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-25     RT-Thread     first version
+ */
+
+/*
+ * crom_bench: read cost of the compressed assets against the same files
+ * stored uncompressed. Every file under the cromfs directory is read whole
+ * with the block cache emptied (cold) and again (warm, all hits while the
+ * assets fit in the cache), then small reads at random offsets. Given a
+ * second directory holding the same tree (a romfs image, or a copy on /flash
+ * or /sdcard), the passes run there too.
+ *
+ * The files are opened with O_DIRECT so the page cache does not hide the
+ * file system; the flash footprint is reported by tools/mkcromfs.py.
+ */
+
+#include <rtthread.h>
+
+#if defined(BSP_USING_CROMFS_ASSETS) && defined(RT_USING_FINSH) && defined(DFS_USING_POSIX)
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "dfs_cromfs.h"
+
+#define CROM_BENCH_FILES        64
+#define CROM_BENCH_PATH_MAX     128
+#define CROM_BENCH_CHUNK        (16 * 1024)
+#define CROM_BENCH_RANDOM_READS 1000
+#define CROM_BENCH_RANDOM_SIZE  512
+
+#ifdef O_DIRECT
+#define CROM_BENCH_OFLAGS       (O_RDONLY | O_DIRECT)
+#else
+#define CROM_BENCH_OFLAGS       O_RDONLY
+#endif
+
+struct crom_bench_file
+{
+    char name[CROM_BENCH_PATH_MAX];     /* relative to the directory */
+    rt_uint32_t size;
+};
+
+struct crom_bench
+{
+    struct crom_bench_file *files;
+    int nr;
+    char *buf;
+};
+
+static rt_uint32_t _kbps(rt_uint32_t bytes, rt_uint32_t ms)
+{
+    return ms ? (rt_uint32_t)((rt_uint64_t)bytes * 1000 / 1024 / ms) : 0;
+}
+
+static void _collect(struct crom_bench *b, const char *root, const char *rel)
+{
+    char path[CROM_BENCH_PATH_MAX];
+    char sub[CROM_BENCH_PATH_MAX];
+    struct dirent *de;
+    struct stat st;
+    DIR *dir;
+
+    rt_snprintf(path, sizeof(path), "%s%s", root, rel);
+    dir = opendir(path);
+    if (dir == RT_NULL)
+        return;
+
+    while ((de = readdir(dir)) != RT_NULL && b->nr < CROM_BENCH_FILES)
+    {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        rt_snprintf(sub, sizeof(sub), "%s/%s", rel, de->d_name);
+        rt_snprintf(path, sizeof(path), "%s%s", root, sub);
+        if (stat(path, &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+        {
+            _collect(b, root, sub);
+        }
+        else if (S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            rt_strncpy(b->files[b->nr].name, sub, CROM_BENCH_PATH_MAX - 1);
+            b->files[b->nr].size = st.st_size;
+            b->nr++;
+        }
+    }
+    closedir(dir);
+}
+
+/* read every file whole, return the time in ms or -1 */
+static int _read_all(struct crom_bench *b, const char *root, rt_uint32_t *bytes)
+{
+    char path[CROM_BENCH_PATH_MAX];
+    rt_uint32_t start;
+    int i, fd, len;
+
+    *bytes = 0;
+    start = rt_tick_get_millisecond();
+    for (i = 0; i < b->nr; i++)
+    {
+        rt_snprintf(path, sizeof(path), "%s%s", root, b->files[i].name);
+        fd = open(path, CROM_BENCH_OFLAGS);
+        if (fd < 0)
+        {
+            rt_kprintf("open %s failed\n", path);
+            return -1;
+        }
+        while ((len = read(fd, b->buf, CROM_BENCH_CHUNK)) > 0)
+            *bytes += len;
+        close(fd);
+    }
+
+    return rt_tick_get_millisecond() - start;
+}
+
+static void _bench_whole(struct crom_bench *b, const char *root, const char *name)
+{
+    rt_uint32_t bytes;
+    int ms;
+
+    ms = _read_all(b, root, &bytes);
+    if (ms < 0)
+        return;
+    rt_kprintf("%-6s whole %6u KB/s, %5u us/file (%u KB in %d ms)\n", name, _kbps(bytes, ms),
+               ms * 1000 / b->nr, bytes / 1024, ms);
+}
+
+static void _bench_random(struct crom_bench *b, const char *root)
+{
+    char path[CROM_BENCH_PATH_MAX];
+    rt_uint32_t start, ms;
+    struct crom_bench_file *f;
+    int i, fd;
+
+    srand(1);
+    start = rt_tick_get_millisecond();
+    for (i = 0; i < CROM_BENCH_RANDOM_READS; i++)
+    {
+        f = &b->files[rand() % b->nr];
+        rt_snprintf(path, sizeof(path), "%s%s", root, f->name);
+        fd = open(path, CROM_BENCH_OFLAGS);
+        if (fd < 0)
+            break;
+        if (f->size > CROM_BENCH_RANDOM_SIZE)
+            lseek(fd, rand() % (f->size - CROM_BENCH_RANDOM_SIZE), SEEK_SET);
+        read(fd, b->buf, CROM_BENCH_RANDOM_SIZE);
+        close(fd);
+    }
+    ms = rt_tick_get_millisecond() - start;
+    rt_kprintf("random %dB  %5u us/read (open, seek, read, close; %d reads in %u ms)\n",
+               CROM_BENCH_RANDOM_SIZE, i ? ms * 1000 / i : 0, i, ms);
+}
+
+static void _print_cache(const char *root)
+{
+    struct dfs_cromfs_cache_stats stats;
+
+    if (dfs_cromfs_cache_stats(root, &stats) != 0)
+        return;
+    rt_kprintf("       cache %u x %u B, %u hits, %u misses, %u inflated\n", stats.blocks,
+               stats.block_size, stats.hits, stats.misses, stats.inflated);
+}
+
+static void crom_bench(int argc, char **argv)
+{
+    struct crom_bench b = {0};
+
+    if (argc < 2 || argc > 3)
+    {
+        rt_kprintf("Usage: crom_bench <cromfs dir> [<uncompressed dir>], e.g. crom_bench /assets /flash/assets\n");
+        return;
+    }
+#ifndef O_DIRECT
+    rt_kprintf("no O_DIRECT, warm passes include the page cache\n");
+#endif
+
+    b.files = rt_malloc(CROM_BENCH_FILES * sizeof(*b.files));
+    b.buf = rt_malloc_align(CROM_BENCH_CHUNK, 32);
+    if (b.files == RT_NULL || b.buf == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        goto __exit;
+    }
+
+    _collect(&b, argv[1], "");
+    if (b.nr == 0)
+    {
+        rt_kprintf("no files under %s\n", argv[1]);
+        goto __exit;
+    }
+    rt_kprintf("%d files under %s\n", b.nr, argv[1]);
+
+    /* the counters are cumulative after the drop */
+    dfs_cromfs_cache_drop(argv[1]);
+    _bench_whole(&b, argv[1], "cold");
+    _print_cache(argv[1]);
+    _bench_whole(&b, argv[1], "warm");
+    _print_cache(argv[1]);
+    _bench_random(&b, argv[1]);
+    _print_cache(argv[1]);
+
+    if (argc == 3)
+    {
+        rt_kprintf("uncompressed under %s\n", argv[2]);
+        _bench_whole(&b, argv[2], "cold");
+        _bench_whole(&b, argv[2], "warm");
+        _bench_random(&b, argv[2]);
+    }
+
+__exit:
+    if (b.buf != RT_NULL)
+        rt_free_align(b.buf);
+    rt_free(b.files);
+}
+MSH_CMD_EXPORT(crom_bench, compressed assets read benchmark: crom_bench <cromfs dir> [<uncompressed dir>]);
+
+#endif /* BSP_USING_CROMFS_ASSETS && RT_USING_FINSH && DFS_USING_POSIX */
@@ -39,14 +39,22 @@ extern struct fal_flash_dev nor_flash0;
     &nor_flash0,                                                     \
 }
 /* ====================== Partition Configuration ========================== */
+/*
+ * norflash0 is the whole XSPI2 NOR from offset 0, so the offsets below are the
+ * ones the flashing tools use (memory-mapped at 0x70000000 + offset). The
+ * firmware image executes from the first 8 MB and the driver refuses to
+ * program or erase it; the partitions start after it.
+ */
 #ifdef FAL_PART_HAS_TABLE_CFG
-#define FAL_PART_TABLE                                                                     \
-{                                                                                          \
-    {FAL_PART_MAGIC_WORD, "wifi_image", NOR_FLASH_DEV_NAME,           0,     512*1024, 0}, \
-    {FAL_PART_MAGIC_WORD, "bt_image",   NOR_FLASH_DEV_NAME,    512*1024,     512*1024, 0}, \
-    {FAL_PART_MAGIC_WORD, "download",   NOR_FLASH_DEV_NAME,   1024*1024,  2*1024*1024, 0}, \
-    {FAL_PART_MAGIC_WORD, "easyflash",  NOR_FLASH_DEV_NAME, 3*1024*1024,  1*1024*1024, 0}, \
-    {FAL_PART_MAGIC_WORD, "filesystem", NOR_FLASH_DEV_NAME, 4*1024*1024, 12*1024*1024, 0}, \
+#define FAL_PART_TABLE                                                                      \
+{                                                                                           \
+    {FAL_PART_MAGIC_WORD, "wifi_image", NOR_FLASH_DEV_NAME,  8*1024*1024,     512*1024, 0}, \
+    {FAL_PART_MAGIC_WORD, "bt_image",   NOR_FLASH_DEV_NAME,  8704*1024,       512*1024, 0}, \
+    {FAL_PART_MAGIC_WORD, "download",   NOR_FLASH_DEV_NAME,  9*1024*1024,  2*1024*1024, 0}, \
+    {FAL_PART_MAGIC_WORD, "easyflash",  NOR_FLASH_DEV_NAME, 11*1024*1024,     960*1024, 0}, \
+    {FAL_PART_MAGIC_WORD, "wlan_cfg",   NOR_FLASH_DEV_NAME, 12224*1024,        64*1024, 0}, \
+    {FAL_PART_MAGIC_WORD, "filesystem", NOR_FLASH_DEV_NAME, 12*1024*1024, 12*1024*1024, 0}, \
+    {FAL_PART_MAGIC_WORD, "assets",     NOR_FLASH_DEV_NAME, 24*1024*1024,  8*1024*1024, 0}, \
 }
 #endif /* FAL_PART_HAS_TABLE_CFG */
 
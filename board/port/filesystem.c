@@ -7,32 +7,51 @@
  * Date           Author        Notes
  * 2018-12-13     balanceTWK    add sdcard port file
  * 2019-06-11     WillianChan   Add SD card hot plug detection
+ * 2025-02-18     RT-Thread     Mount the on-board eMMC to '/emmc'
+ * 2025-02-19     RT-Thread     Flush the elm-FAT sector cache on card removal
+ * 2025-02-20     RT-Thread     Build with DFS v2
+ * 2025-02-23     RT-Thread     Mount littlefs on the NOR 'filesystem' partition to '/flash'
+ * 2025-02-25     RT-Thread     Mount the cromfs 'assets' partition to '/assets'
  */
 
 #include <rtthread.h>
 
 #ifdef BSP_USING_FS
+/* DFS v2 mounts and registers file systems without a fixed table */
+#ifdef RT_USING_DFS_V1
 #if DFS_FILESYSTEMS_MAX < 4
 #error "Please define DFS_FILESYSTEMS_MAX more than 4"
 #endif
 #if DFS_FILESYSTEM_TYPES_MAX < 4
 #error "Please define DFS_FILESYSTEM_TYPES_MAX more than 4"
 #endif
+#endif /* RT_USING_DFS_V1 */
 
-#ifdef BSP_USING_SPI_FLASH_FS
+#if defined(BSP_USING_SPI_FLASH_FS) || defined(BSP_USING_CROMFS_ASSETS)
 #include "fal.h"
 #endif
 
 #include <dfs_fs.h>
 #include "dfs_romfs.h"
 #include "drv_sdmmc.h"
+#ifdef RT_DFS_ELM_USING_CACHE
+#include "dfs_elm.h"
+#endif
 
 #define DBG_TAG "app.filesystem"
 #define DBG_LVL DBG_INFO
 #include <rtdbg.h>
 
 static const struct romfs_dirent _romfs_root[] = {
-//    {ROMFS_DIRENT_DIR, "flash", RT_NULL, 0},
+#ifdef BSP_USING_CROMFS_ASSETS
+    {ROMFS_DIRENT_DIR, "assets", RT_NULL, 0},
+#endif
+#ifdef BSP_USING_SPI_FLASH_FS
+    {ROMFS_DIRENT_DIR, "flash", RT_NULL, 0},
+#endif
+#ifdef BSP_USING_EMMC_FS
+    {ROMFS_DIRENT_DIR, "emmc", RT_NULL, 0},
+#endif
     {ROMFS_DIRENT_DIR, "sdcard", RT_NULL, 0}};
 
 const struct romfs_dirent romfs_root = {
@@ -78,6 +97,13 @@ static void _sdcard_mount(void)
 
 static void _sdcard_unmount(void)
 {
+#ifdef RT_DFS_ELM_USING_CACHE
+    /* the card may still be in contact, write the cached sectors back before the debounce */
+    if (dfs_elm_cache_flush() != RT_EOK)
+    {
+        LOG_W("sd card removed before the cached sectors were written");
+    }
+#endif
     rt_thread_mdelay(200);
     dfs_unmount("/sdcard");
     LOG_I("Unmount \"/sdcard\"");
@@ -112,6 +138,43 @@ static void sd_mount(void *parameter)
 
 #endif /* BSP_USING_SDCARD_FS */
 
+#ifdef BSP_USING_EMMC_FS
+
+/* the eMMC is not removable, mount it once it has been probed */
+static void emmc_mount(void *parameter)
+{
+    rt_device_t device = RT_NULL;
+    int retry;
+
+    for (retry = 0; retry < 10 && device == RT_NULL; retry++)
+    {
+        device = rt_device_find("sd0");
+        if (device == RT_NULL)
+        {
+            mmcsd_wait_cd_changed(rt_tick_from_millisecond(500));
+        }
+    }
+    if (device == RT_NULL)
+    {
+        LOG_E("emmc not found!");
+        return;
+    }
+
+    if (dfs_mount("sd0", "/emmc", "elm", 0, 0) != RT_EOK)
+    {
+        LOG_W("mount to '/emmc' failed! try to mkfs sd0");
+        dfs_mkfs("elm", "sd0");
+        if (dfs_mount("sd0", "/emmc", "elm", 0, 0) != RT_EOK)
+        {
+            LOG_E("emmc mount to '/emmc' failed!");
+            return;
+        }
+    }
+    LOG_I("emmc mount to '/emmc'");
+}
+
+#endif /* BSP_USING_EMMC_FS */
+
 int mount_init(void)
 {
     sdcard_mount = rt_sem_create("sdcard_mount", 0, RT_IPC_FLAG_PRIO);
@@ -124,10 +187,7 @@ int mount_init(void)
 #ifdef BSP_USING_SPI_FLASH_FS
     struct rt_device *flash_dev = RT_NULL;
 
-#ifndef RT_USING_WIFI
-    fal_init();
-#endif
-
+    /* FAL is initialized by the XSPI NOR driver at INIT_ENV */
     flash_dev = fal_mtd_nor_device_create("filesystem");
 
     if (flash_dev)
@@ -149,10 +209,22 @@ int mount_init(void)
     }
     else
     {
-        LOG_E("Can't create  block device  filesystem or bt_image partition.");
+        LOG_E("Can't create the MTD NOR device on the 'filesystem' partition.");
     }
 
 #endif
+#ifdef BSP_USING_CROMFS_ASSETS
+    /* read only image written by tools/mkcromfs.py, never formatted here */
+    if (fal_char_device_create("assets") == RT_NULL ||
+        dfs_mount("assets", "/assets", "crom", 0, 0) != 0)
+    {
+        LOG_W("mount to '/assets' failed! is the cromfs image written?");
+    }
+    else
+    {
+        LOG_I("mount to '/assets' success!");
+    }
+#endif
 
 #ifdef BSP_USING_SDCARD_FS
     rt_thread_t tid;
@@ -169,6 +241,20 @@ int mount_init(void)
     {
         LOG_E("create sd_mount thread err!");
     }
+#endif
+#ifdef BSP_USING_EMMC_FS
+    rt_thread_t emmc_tid;
+
+    emmc_tid = rt_thread_create("emmc_mnt", emmc_mount, RT_NULL,
+                                2048, RT_THREAD_PRIORITY_MAX - 2, 20);
+    if (emmc_tid != RT_NULL)
+    {
+        rt_thread_startup(emmc_tid);
+    }
+    else
+    {
+        LOG_E("create emmc_mnt thread err!");
+    }
 #endif
     return RT_EOK;
 }
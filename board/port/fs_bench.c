@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-20     RT-Thread     first version
+ * 2025-02-23     RT-Thread     small file only mode and the append workload
+ */
+
+/*
+ * fs_bench: sequential, random and small file workloads through the POSIX
+ * API only, so the same command runs on DFS v1 and DFS v2. Build the BSP with
+ * each version and run it on the same card to compare.
+ *
+ * "fs_bench <dir> small" skips the 16 MB file, for the NOR flash file system:
+ * compare "fs_bench /flash small" with "fs_bench /sdcard small".
+ */
+
+#include <rtthread.h>
+
+#if defined(BSP_USING_FS) && defined(RT_USING_FINSH) && defined(DFS_USING_POSIX)
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef RT_USING_POSIX_MMAN
+#include <sys/mman.h>
+#endif
+
+#define FS_BENCH_FILE_MB        16
+#define FS_BENCH_CHUNK          (32 * 1024)
+#define FS_BENCH_RANDOM_READS   1000
+#define FS_BENCH_SMALL_FILES    200
+#define FS_BENCH_SMALL_SIZE     1024
+#define FS_BENCH_LOG_FILES      8
+#define FS_BENCH_APPENDS        400     /* spread over the log files */
+#define FS_BENCH_APPEND_SIZE    64
+
+static rt_uint32_t _kbps(rt_uint32_t bytes, rt_uint32_t ms)
+{
+    return ms ? (rt_uint32_t)((rt_uint64_t)bytes * 1000 / 1024 / ms) : 0;
+}
+
+static rt_uint32_t _ops(rt_uint32_t ops, rt_uint32_t ms)
+{
+    return ms ? ops * 1000 / ms : 0;
+}
+
+static int _bench_sequential(const char *path, char *buf)
+{
+    rt_uint32_t size = FS_BENCH_FILE_MB * 1024 * 1024;
+    rt_uint32_t done, start, ms;
+    int fd, pass;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0)
+    {
+        rt_kprintf("open %s failed\n", path);
+        return -1;
+    }
+    start = rt_tick_get_millisecond();
+    for (done = 0; done < size; done += FS_BENCH_CHUNK)
+    {
+        if (write(fd, buf, FS_BENCH_CHUNK) != FS_BENCH_CHUNK)
+            break;
+    }
+    fsync(fd);
+    close(fd);
+    ms = rt_tick_get_millisecond() - start;
+    rt_kprintf("seq write    %6u KB/s (%u KB in %u ms)\n", _kbps(done, ms), done / 1024, ms);
+    if (done < size)
+        return -1;
+
+    /* the second pass shows what a page cache keeps */
+    for (pass = 1; pass <= 2; pass++)
+    {
+        fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return -1;
+        start = rt_tick_get_millisecond();
+        for (done = 0; done < size; done += FS_BENCH_CHUNK)
+        {
+            if (read(fd, buf, FS_BENCH_CHUNK) != FS_BENCH_CHUNK)
+                break;
+        }
+        close(fd);
+        ms = rt_tick_get_millisecond() - start;
+        rt_kprintf("seq read #%d  %6u KB/s (%u KB in %u ms)\n", pass, _kbps(done, ms), done / 1024, ms);
+    }
+
+    return 0;
+}
+
+static void _bench_random(const char *path, char *buf, int size)
+{
+    rt_uint32_t blocks = FS_BENCH_FILE_MB * 1024 * 1024 / size;
+    rt_uint32_t start, ms;
+    int fd, i;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+
+    srand(1);
+    start = rt_tick_get_millisecond();
+    for (i = 0; i < FS_BENCH_RANDOM_READS; i++)
+    {
+        lseek(fd, (off_t)(rand() % blocks) * size, SEEK_SET);
+        if (read(fd, buf, size) != size)
+            break;
+    }
+    close(fd);
+    ms = rt_tick_get_millisecond() - start;
+    rt_kprintf("random %4dB %6u IOPS (%d reads in %u ms)\n", size, _ops(i, ms), i, ms);
+}
+
+static void _bench_small_files(const char *dir, char *buf)
+{
+    char path[64];
+    rt_uint32_t start, ms;
+    struct dirent *ent;
+    struct stat st;
+    DIR *d;
+    int fd, i, n;
+
+    rt_snprintf(path, sizeof(path), "%s/fs_bench", dir);
+    mkdir(path, 0);
+
+    start = rt_tick_get_millisecond();
+    for (i = 0; i < FS_BENCH_SMALL_FILES; i++)
+    {
+        rt_snprintf(path, sizeof(path), "%s/fs_bench/f%03d.bin", dir, i);
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC);
+        if (fd < 0)
+            break;
+        write(fd, buf, FS_BENCH_SMALL_SIZE);
+        close(fd);
+    }
+    ms = rt_tick_get_millisecond() - start;
+    rt_kprintf("small create %6u ops/s (%d files in %u ms)\n", _ops(i, ms), i, ms);
+
+    start = rt_tick_get_millisecond();
+    n = 0;
+    rt_snprintf(path, sizeof(path), "%s/fs_bench", dir);
+    d = opendir(path);
+    if (d)
+    {
+        while ((ent = readdir(d)) != RT_NULL)
+        {
+            rt_snprintf(path, sizeof(path), "%s/fs_bench/%s", dir, ent->d_name);
+            if (stat(path, &st) == 0)
+                n++;
+        }
+        closedir(d);
+    }
+    ms = rt_tick_get_millisecond() - start;
+    rt_kprintf("small stat   %6u ops/s (%d entries in %u ms)\n", _ops(n, ms), n, ms);
+
+    start = rt_tick_get_millisecond();
+    for (i = 0; i < FS_BENCH_SMALL_FILES; i++)
+    {
+        rt_snprintf(path, sizeof(path), "%s/fs_bench/f%03d.bin", dir, i);
+        fd = open(path, O_RDONLY);
+        if (fd < 0)
+            break;
+        read(fd, buf, FS_BENCH_SMALL_SIZE);
+        close(fd);
+    }
+    ms = rt_tick_get_millisecond() - start;
+    rt_kprintf("small read   %6u ops/s (%d files in %u ms)\n", _ops(i, ms), i, ms);
+
+    start = rt_tick_get_millisecond();
+    for (i = 0; i < FS_BENCH_SMALL_FILES; i++)
+    {
+        rt_snprintf(path, sizeof(path), "%s/fs_bench/f%03d.bin", dir, i);
+        unlink(path);
+    }
+    ms = rt_tick_get_millisecond() - start;
+    rt_kprintf("small delete %6u ops/s (%d files in %u ms)\n", _ops(i, ms), i, ms);
+
+    rt_snprintf(path, sizeof(path), "%s/fs_bench", dir);
+    rmdir(path);
+}
+
+/* log style: open, append a short record and close, so every record is on the media */
+static void _bench_append(const char *dir, char *buf)
+{
+    char path[64];
+    rt_uint32_t start, ms;
+    struct stat st;
+    int fd, i, n = 0;
+
+    start = rt_tick_get_millisecond();
+    for (i = 0; i < FS_BENCH_APPENDS; i++)
+    {
+        rt_snprintf(path, sizeof(path), "%s/fs_bench%d.log", dir, i % FS_BENCH_LOG_FILES);
+        fd = open(path, O_WRONLY | O_CREAT | O_APPEND);
+        if (fd < 0)
+            break;
+        if (write(fd, buf, FS_BENCH_APPEND_SIZE) == FS_BENCH_APPEND_SIZE)
+            n++;
+        close(fd);
+    }
+    ms = rt_tick_get_millisecond() - start;
+    rt_kprintf("small append %6u ops/s (%d x %d B in %u ms)\n", _ops(n, ms), n, FS_BENCH_APPEND_SIZE, ms);
+
+    for (i = 0; i < FS_BENCH_LOG_FILES; i++)
+    {
+        rt_snprintf(path, sizeof(path), "%s/fs_bench%d.log", dir, i);
+        if (n == FS_BENCH_APPENDS && stat(path, &st) == 0 &&
+            st.st_size != FS_BENCH_APPENDS / FS_BENCH_LOG_FILES * FS_BENCH_APPEND_SIZE)
+            rt_kprintf("%s has %d bytes after the appends\n", path, (int)st.st_size);
+        unlink(path);
+    }
+}
+
+#ifdef RT_USING_POSIX_MMAN
+/* map 1 MB of the file twice, the second mapping shares the first copy */
+static void _bench_mmap(const char *path)
+{
+    rt_uint32_t start, ms, sum = 0, i;
+    rt_uint8_t *p1, *p2;
+    size_t len = 1024 * 1024;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+
+    start = rt_tick_get_millisecond();
+    p1 = mmap(RT_NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    ms = rt_tick_get_millisecond() - start;
+    if (p1 == MAP_FAILED)
+    {
+        rt_kprintf("mmap failed\n");
+        close(fd);
+        return;
+    }
+    start = rt_tick_get_millisecond();
+    p2 = mmap(RT_NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    for (i = 0; i < len; i += 64)
+        sum += p1[i];
+    rt_kprintf("mmap 1MB     %6u ms, again %u ms (%s), checksum %u\n", ms,
+               rt_tick_get_millisecond() - start, p2 == p1 ? "shared" : "copied", sum);
+    if (p2 != MAP_FAILED)
+        munmap(p2, len);
+    munmap(p1, len);
+    close(fd);
+}
+#endif /* RT_USING_POSIX_MMAN */
+
+static void fs_bench(int argc, char **argv)
+{
+    char path[64];
+    char *buf;
+
+    if (argc < 2 || (argc == 3 && strcmp(argv[2], "small") != 0) || argc > 3)
+    {
+        rt_kprintf("Usage: fs_bench <dir> [small], e.g. fs_bench /sdcard\n");
+        return;
+    }
+
+#if defined(RT_USING_DFS_V2)
+#ifdef RT_USING_PAGECACHE
+    rt_kprintf("DFS v2, page cache %d pages\n", RT_PAGECACHE_COUNT);
+#else
+    rt_kprintf("DFS v2, no page cache\n");
+#endif
+#else
+    rt_kprintf("DFS v1\n");
+#endif
+
+    buf = rt_malloc_align(FS_BENCH_CHUNK, 32);
+    if (buf == RT_NULL)
+        return;
+    rt_memset(buf, 0xa5, FS_BENCH_CHUNK);
+
+    if (argc == 2)
+    {
+        rt_snprintf(path, sizeof(path), "%s/fs_bench.bin", argv[1]);
+        if (_bench_sequential(path, buf) == 0)
+        {
+            _bench_random(path, buf, 512);
+            _bench_random(path, buf, 4096);
+#ifdef RT_USING_POSIX_MMAN
+            _bench_mmap(path);
+#endif
+        }
+        unlink(path);
+    }
+
+    _bench_small_files(argv[1], buf);
+    _bench_append(argv[1], buf);
+    rt_free_align(buf);
+}
+MSH_CMD_EXPORT(fs_bench, file system benchmark: fs_bench <dir> [small]);
+
+#endif /* BSP_USING_FS && RT_USING_FINSH && DFS_USING_POSIX */
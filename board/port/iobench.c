@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-26     RT-Thread     first version
+ */
+
+/*
+ * iobench on the board: the targets, DWT cycle timing and one thread per
+ * queue slot. Examples:
+ *
+ *   iobench blk:sd0 -b 512,4k,64k -q 1,4
+ *   iobench file:/sdcard/iobench.bin -c /sdcard/iobench.csv -l baseline
+ *   iobench fal:download -s 1m -W
+ *   iobench mem:psram -b 4k,64k
+ *
+ * The I/O buffers come from the AXI SRAM heap when it has room, so mem:psram
+ * measures PSRAM against on-chip memory and mem:heap the AXI SRAM itself.
+ */
+
+#include <rtthread.h>
+
+#ifdef RT_USING_FINSH
+
+#include <rtdevice.h>
+#include <board.h>
+#include <string.h>
+#include "iobench.h"
+
+#ifdef DFS_USING_POSIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+#ifdef RT_USING_FAL
+#include <fal.h>
+#endif
+
+#define IOBENCH_STACK_SIZE      2048
+#define IOBENCH_ALIGN           32      /* D-cache line, for the DMA of the SD and eMMC */
+#define IOBENCH_FILL_CHUNK      (32 * 1024)
+#define IOBENCH_MEM_MIN         (64 * 1024)
+
+/* ==================== platform ==================== */
+
+uint32_t iobench_millis(void)
+{
+    return rt_tick_get_millisecond();
+}
+
+uint32_t iobench_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t iobench_cycles_per_us(void)
+{
+    return SystemCoreClock / 1000000;
+}
+
+void *iobench_malloc(size_t size)
+{
+    rt_size_t total = size + IOBENCH_ALIGN + sizeof(void *);
+    struct rt_memheap *sram;
+    void *raw = RT_NULL;
+    void **ptr;
+
+    sram = (struct rt_memheap *)rt_object_find("heap", RT_Object_Class_MemHeap);
+    if (sram != RT_NULL)
+        raw = rt_memheap_alloc(sram, total);
+    if (raw == RT_NULL)
+        raw = rt_malloc(total);
+    if (raw == RT_NULL)
+        return RT_NULL;
+
+    ptr = (void **)RT_ALIGN((rt_ubase_t)raw + sizeof(void *), IOBENCH_ALIGN);
+    ptr[-1] = raw;
+    return ptr;
+}
+
+void iobench_free(void *ptr)
+{
+    rt_free(((void **)ptr)[-1]);
+}
+
+static void _worker_thread(void *parameter)
+{
+    struct iobench_worker *w = parameter;
+
+    iobench_worker_entry(w);
+    rt_sem_release((rt_sem_t)w->job->done);
+}
+
+int iobench_run_workers(struct iobench_job *job)
+{
+    struct rt_semaphore done;
+    rt_thread_t tid;
+    char name[RT_NAME_MAX];
+    int i, started = 0;
+
+    if (job->qd == 1)
+    {
+        iobench_worker_entry(&job->workers[0]);
+        return 0;
+    }
+
+    rt_sem_init(&done, "iob", 0, RT_IPC_FLAG_PRIO);
+    job->done = &done;
+    for (i = 0; i < job->qd; i++)
+    {
+        rt_snprintf(name, sizeof(name), "iob%d", i);
+        tid = rt_thread_create(name, _worker_thread, &job->workers[i], IOBENCH_STACK_SIZE,
+                               rt_thread_self()->current_priority, 10);
+        if (tid == RT_NULL)
+        {
+            job->workers[i].error = -RT_ENOMEM;
+            break;
+        }
+        rt_thread_startup(tid);
+        started++;
+    }
+    while (started--)
+        rt_sem_take(&done, RT_WAITING_FOREVER);
+    rt_sem_detach(&done);
+
+    return 0;
+}
+
+#ifdef DFS_USING_POSIX
+int iobench_csv_append(const char *path, const char *header, const char *line)
+{
+    struct stat st;
+    int fd, ret = 0;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_APPEND);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) == 0 && st.st_size == 0)
+    {
+        if (write(fd, header, strlen(header)) < 0 || write(fd, "\n", 1) != 1)
+            ret = -1;
+    }
+    if (write(fd, line, strlen(line)) < 0 || write(fd, "\n", 1) != 1)
+        ret = -1;
+    close(fd);
+    return ret;
+}
+#else
+int iobench_csv_append(const char *path, const char *header, const char *line)
+{
+    return -1;
+}
+#endif /* DFS_USING_POSIX */
+
+/* ==================== blk: ==================== */
+
+static int _blk_read(struct iobench_target *t, uint64_t off, void *buf, uint32_t len)
+{
+    rt_size_t n = len / t->unit;
+
+    return rt_device_read((rt_device_t)t->priv, off / t->unit, buf, n) == n ? 0 : -RT_EIO;
+}
+
+static int _blk_write(struct iobench_target *t, uint64_t off, const void *buf, uint32_t len)
+{
+    rt_size_t n = len / t->unit;
+
+    return rt_device_write((rt_device_t)t->priv, off / t->unit, buf, n) == n ? 0 : -RT_EIO;
+}
+
+static void _blk_close(struct iobench_target *t)
+{
+    rt_device_close((rt_device_t)t->priv);
+}
+
+static int _blk_open(struct iobench_target *t, const char *name)
+{
+    struct rt_device_blk_geometry geometry;
+    rt_device_t dev = rt_device_find(name);
+
+    if (dev == RT_NULL || dev->type != RT_Device_Class_Block)
+        return -RT_ERROR;
+    if (rt_device_open(dev, RT_DEVICE_OFLAG_RDWR) != RT_EOK)
+        return -RT_EIO;
+    if (rt_device_control(dev, RT_DEVICE_CTRL_BLK_GETGEOME, &geometry) != RT_EOK ||
+        geometry.bytes_per_sector == 0)
+    {
+        rt_device_close(dev);
+        return -RT_EIO;
+    }
+
+    t->size = (uint64_t)geometry.sector_count * geometry.bytes_per_sector;
+    t->unit = geometry.bytes_per_sector;
+    t->destructive = 1;
+    t->read = _blk_read;
+    t->write = _blk_write;
+    t->close = _blk_close;
+    t->priv = dev;
+    return 0;
+}
+
+/* ==================== file: ==================== */
+
+#ifdef DFS_USING_POSIX
+
+#ifdef O_DIRECT
+#define IOBENCH_FILE_OFLAGS     (O_RDWR | O_CREAT | O_DIRECT)
+#else
+#define IOBENCH_FILE_OFLAGS     (O_RDWR | O_CREAT)
+#endif
+
+static int _file_read(struct iobench_target *t, uint64_t off, void *buf, uint32_t len)
+{
+    return pread((int)(rt_ubase_t)t->priv, buf, len, off) == (ssize_t)len ? 0 : -RT_EIO;
+}
+
+static int _file_write(struct iobench_target *t, uint64_t off, const void *buf, uint32_t len)
+{
+    return pwrite((int)(rt_ubase_t)t->priv, buf, len, off) == (ssize_t)len ? 0 : -RT_EIO;
+}
+
+static void _file_close(struct iobench_target *t)
+{
+    close((int)(rt_ubase_t)t->priv);
+}
+
+/* the file is the bench's own, grown to the area once and then kept */
+static int _file_open(struct iobench_target *t, const char *path, uint64_t area)
+{
+    struct stat st;
+    void *chunk;
+    int fd, len;
+
+    fd = open(path, IOBENCH_FILE_OFLAGS);
+    if (fd < 0)
+        return -RT_EIO;
+    if (fstat(fd, &st) != 0)
+        goto __fail;
+
+    if ((uint64_t)st.st_size < area)
+    {
+        chunk = iobench_malloc(IOBENCH_FILL_CHUNK);
+        if (chunk == RT_NULL)
+            goto __fail;
+        rt_memset(chunk, 0x5a, IOBENCH_FILL_CHUNK);
+        iobench_printf("growing %s to %u KB\n", path, (uint32_t)(area / 1024));
+        lseek(fd, st.st_size, SEEK_SET);
+        while ((uint64_t)st.st_size < area)
+        {
+            len = area - st.st_size > IOBENCH_FILL_CHUNK ? IOBENCH_FILL_CHUNK : area - st.st_size;
+            if (write(fd, chunk, len) != len)
+                break;
+            st.st_size += len;
+        }
+        iobench_free(chunk);
+        if ((uint64_t)st.st_size < area)
+            goto __fail;
+    }
+
+    t->size = st.st_size;
+    t->unit = 512;
+    t->read = _file_read;
+    t->write = _file_write;
+    t->close = _file_close;
+    t->priv = (void *)(rt_ubase_t)fd;
+    return 0;
+
+__fail:
+    close(fd);
+    return -RT_EIO;
+}
+
+#endif /* DFS_USING_POSIX */
+
+/* ==================== fal: ==================== */
+
+#ifdef RT_USING_FAL
+
+static int _fal_read(struct iobench_target *t, uint64_t off, void *buf, uint32_t len)
+{
+    return fal_partition_read(t->priv, off, buf, len) == (int)len ? 0 : -RT_EIO;
+}
+
+static int _fal_write(struct iobench_target *t, uint64_t off, const void *buf, uint32_t len)
+{
+    return fal_partition_write(t->priv, off, buf, len) == (int)len ? 0 : -RT_EIO;
+}
+
+static int _fal_prepare(struct iobench_target *t, uint64_t off, uint64_t len)
+{
+    return fal_partition_erase(t->priv, off, len) >= 0 ? 0 : -RT_EIO;
+}
+
+static int _fal_open(struct iobench_target *t, const char *name)
+{
+    const struct fal_partition *part = fal_partition_find(name);
+
+    if (part == RT_NULL)
+        return -RT_ERROR;
+
+    t->size = part->len;
+    t->unit = 1;
+    t->destructive = 1;
+    t->erase_before_write = 1;
+    t->read = _fal_read;
+    t->write = _fal_write;
+    t->prepare = _fal_prepare;
+    t->priv = (void *)part;
+    return 0;
+}
+
+#endif /* RT_USING_FAL */
+
+/* ==================== mem: ==================== */
+
+#ifdef RT_USING_MEMHEAP
+
+static int _mem_read(struct iobench_target *t, uint64_t off, void *buf, uint32_t len)
+{
+    rt_memcpy(buf, (uint8_t *)t->priv + off, len);
+    return 0;
+}
+
+static int _mem_write(struct iobench_target *t, uint64_t off, const void *buf, uint32_t len)
+{
+    rt_memcpy((uint8_t *)t->priv + off, buf, len);
+    return 0;
+}
+
+static void _mem_close(struct iobench_target *t)
+{
+    rt_memheap_free(t->priv);
+}
+
+/* the area is allocated in the heap, halved until it fits */
+static int _mem_open(struct iobench_target *t, const char *name, uint64_t area)
+{
+    struct rt_memheap *heap = (struct rt_memheap *)rt_object_find(name, RT_Object_Class_MemHeap);
+    void *mem = RT_NULL;
+
+    if (heap == RT_NULL)
+        return -RT_ERROR;
+    while (area >= IOBENCH_MEM_MIN)
+    {
+        mem = rt_memheap_alloc(heap, area);
+        if (mem != RT_NULL)
+            break;
+        area /= 2;
+    }
+    if (mem == RT_NULL)
+        return -RT_ENOMEM;
+
+    t->size = area;
+    t->unit = 4;
+    t->read = _mem_read;
+    t->write = _mem_write;
+    t->close = _mem_close;
+    t->priv = mem;
+    return 0;
+}
+
+#endif /* RT_USING_MEMHEAP */
+
+int iobench_target_open(struct iobench_target *t, const char *spec, uint64_t area)
+{
+    const char *name = strchr(spec, ':');
+    int ret = -RT_ERROR;
+
+    if (name == RT_NULL)
+        return -RT_EINVAL;
+    name++;
+    rt_strncpy(t->name, name, sizeof(t->name) - 1);
+
+    if (strncmp(spec, "blk:", 4) == 0)
+    {
+        t->kind = "blk";
+        ret = _blk_open(t, name);
+    }
+#ifdef DFS_USING_POSIX
+    else if (strncmp(spec, "file:", 5) == 0)
+    {
+        t->kind = "file";
+        ret = _file_open(t, name, area);
+    }
+#endif
+#ifdef RT_USING_FAL
+    else if (strncmp(spec, "fal:", 4) == 0)
+    {
+        t->kind = "fal";
+        ret = _fal_open(t, name);
+    }
+#endif
+#ifdef RT_USING_MEMHEAP
+    else if (strncmp(spec, "mem:", 4) == 0)
+    {
+        t->kind = "mem";
+        ret = _mem_open(t, name, area);
+    }
+#endif
+
+    return ret;
+}
+
+/* ==================== msh ==================== */
+
+static int iobench(int argc, char **argv)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    return iobench_main(argc, argv);
+}
+MSH_CMD_EXPORT(iobench, storage benchmark: iobench <kind:name> [-p] [-b] [-q] [-s] [-o] [-n] [-c] [-l] [-W]);
+
+#endif /* RT_USING_FINSH */
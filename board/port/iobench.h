@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-26     RT-Thread     first version
+ */
+
+/*
+ * iobench: the same sequential and random read/write patterns against every
+ * storage tier, reported as MB/s, IOPS and latency percentiles.
+ *
+ * iobench_core.c holds the patterns and the report and builds both on the
+ * board and on a PC; the platform supplies the targets, the clocks and the
+ * worker threads: iobench.c (msh command) on RT-Thread, iobench_host.c with
+ * file-backed stand-ins on the host, so results can be compared between
+ * changes on the same machine.
+ */
+
+#ifndef __IOBENCH_H__
+#define __IOBENCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef IOBENCH_HOST
+#include <stdio.h>
+#define iobench_printf          printf
+#define iobench_snprintf        snprintf
+#else
+#include <rtthread.h>
+#define iobench_printf          rt_kprintf
+#define iobench_snprintf        rt_snprintf
+#endif
+
+#define IOBENCH_QD_MAX          8       /* worker threads, each with one request in flight */
+#define IOBENCH_SIZES_MAX       8
+#define IOBENCH_LAT_MAX         (16 * 1024)
+#define IOBENCH_MIN_MS          200     /* a pass is repeated until it ran this long */
+
+enum iobench_pattern
+{
+    IOBENCH_SEQ_READ = 0,
+    IOBENCH_RND_READ,
+    IOBENCH_SEQ_WRITE,
+    IOBENCH_RND_WRITE,
+    IOBENCH_PATTERNS
+};
+
+struct iobench_target
+{
+    char name[32];
+    const char *kind;           /* "blk", "file", "fal", "mem" */
+    uint64_t size;
+    uint32_t unit;              /* offsets and lengths are multiples of it */
+    int destructive;            /* writes destroy data the target held before */
+    int erase_before_write;     /* a block is written once per pass, after prepare() */
+
+    int (*read)(struct iobench_target *t, uint64_t off, void *buf, uint32_t len);
+    int (*write)(struct iobench_target *t, uint64_t off, const void *buf, uint32_t len);
+    /* before a write pass, not timed; NULL when nothing is needed */
+    int (*prepare)(struct iobench_target *t, uint64_t off, uint64_t len);
+    void (*close)(struct iobench_target *t);
+    void *priv;
+};
+
+struct iobench_job;
+
+struct iobench_worker
+{
+    struct iobench_job *job;
+    int id;
+    uint8_t *buf;
+    uint32_t *lat;              /* latency of the last ops, in us */
+    uint32_t lat_cap;
+    uint32_t ops;
+    int error;
+};
+
+struct iobench_job
+{
+    struct iobench_target *target;
+    enum iobench_pattern pattern;
+    uint64_t offset;
+    uint32_t bs;
+    uint32_t blocks;            /* in the test area */
+    uint32_t stride;            /* block step of the random patterns */
+    uint32_t share;             /* blocks per pass */
+    int qd;
+    int once;
+    void *done;                 /* completion of the platform's worker threads */
+    struct iobench_worker workers[IOBENCH_QD_MAX];
+};
+
+/* ---- provided by the platform ---- */
+
+uint32_t iobench_millis(void);
+uint32_t iobench_cycles(void);
+uint32_t iobench_cycles_per_us(void);
+void *iobench_malloc(size_t size);
+void iobench_free(void *ptr);
+/* open "kind:name", the area is the size the patterns will use */
+int iobench_target_open(struct iobench_target *t, const char *spec, uint64_t area);
+/* run iobench_worker_entry() for each of job->qd workers and wait for them */
+int iobench_run_workers(struct iobench_job *job);
+/* append a line, after the header when the file is new or empty */
+int iobench_csv_append(const char *path, const char *header, const char *line);
+
+/* ---- core ---- */
+
+void iobench_worker_entry(struct iobench_worker *w);
+int iobench_main(int argc, char **argv);
+
+#endif /* __IOBENCH_H__ */
@@ -0,0 +1,496 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-26     RT-Thread     first version
+ */
+
+/*
+ * Patterns and report of iobench, shared by the board and the host build.
+ *
+ * The test area is split into blocks of the block size. A pass visits
+ * every block once: in order for the sequential patterns, with a stride
+ * coprime to the block count for the random ones, so no block is visited
+ * twice and the NOR partitions can be erased once before a write pass. The
+ * workers take every qd-th block of the pass, and repeat their share until
+ * the pass ran IOBENCH_MIN_MS, except on targets that need an erase.
+ */
+
+#include "iobench.h"
+
+#if defined(IOBENCH_HOST) || defined(RT_USING_FINSH)
+
+#include <stdlib.h>
+#include <string.h>
+
+#define IOBENCH_DEFAULT_AREA    (4 * 1024 * 1024)
+#define IOBENCH_DEFAULT_OPS     1000
+#define IOBENCH_BS_MAX          (1024 * 1024)
+
+static const char *const _pattern_name[IOBENCH_PATTERNS] =
+{
+    "seqrd", "rndrd", "seqwr", "rndwr"
+};
+
+static const char _csv_header[] =
+    "label,target,kind,pattern,bs,qd,ops,kbytes,ms,kbps,iops,p50_us,p90_us,p99_us,p999_us,max_us";
+
+struct iobench_args
+{
+    const char *spec;
+    const char *csv;
+    const char *label;
+    uint32_t patterns;          /* bit per enum iobench_pattern, 0 for the default */
+    uint32_t bs[IOBENCH_SIZES_MAX];
+    int bs_nr;
+    int qd[IOBENCH_SIZES_MAX];
+    int qd_nr;
+    uint64_t area;
+    uint64_t offset;
+    uint32_t ops;
+    int allow_write;
+};
+
+struct iobench_result
+{
+    uint32_t ops;
+    uint64_t bytes;
+    uint32_t ms;
+    uint32_t p50, p90, p99, p999, max;
+};
+
+/* 4096, 4k, 1m */
+static uint64_t _parse_size(const char *str)
+{
+    char *end;
+    uint64_t value = strtoul(str, &end, 0);
+
+    if (*end == 'k' || *end == 'K')
+        value *= 1024;
+    else if (*end == 'm' || *end == 'M')
+        value *= 1024 * 1024;
+    return value;
+}
+
+/* comma separated list, returns the number of items */
+static int _parse_list(const char *str, uint32_t *items, int max)
+{
+    int nr = 0;
+
+    while (*str && nr < max)
+    {
+        items[nr++] = (uint32_t)_parse_size(str);
+        str = strchr(str, ',');
+        if (str == NULL)
+            break;
+        str++;
+    }
+    return nr;
+}
+
+static int _parse_patterns(const char *str, uint32_t *patterns)
+{
+    int i;
+
+    *patterns = 0;
+    while (*str)
+    {
+        for (i = 0; i < IOBENCH_PATTERNS; i++)
+        {
+            if (strncmp(str, _pattern_name[i], 5) == 0)
+                break;
+        }
+        if (i == IOBENCH_PATTERNS)
+            return -1;
+        *patterns |= 1UL << i;
+        str += 5;
+        if (*str == ',')
+            str++;
+    }
+    return 0;
+}
+
+static void _usage(void)
+{
+    iobench_printf("Usage: iobench <kind:name> [-p seqrd,rndrd,seqwr,rndwr] [-b 4k,64k] [-q 1,4]\n"
+                   "               [-s area] [-o offset] [-n random ops] [-c csv] [-l label] [-W]\n"
+                   "  blk:sd0        raw block device (SD card or eMMC)\n"
+                   "  file:<path>    file in a file system, e.g. file:/sdcard/iobench.bin\n"
+                   "  fal:<part>     FAL partition, e.g. fal:download\n"
+                   "  mem:<heap>     memcpy from/to a memory heap, e.g. mem:psram, mem:heap\n"
+                   "  writes to blk: and fal: destroy their data and need -W\n");
+}
+
+static int _parse_args(int argc, char **argv, struct iobench_args *a)
+{
+    int i;
+
+    memset(a, 0, sizeof(*a));
+    a->area = IOBENCH_DEFAULT_AREA;
+    a->ops = IOBENCH_DEFAULT_OPS;
+    a->label = "";
+    a->bs[0] = 4096;
+    a->bs[1] = 64 * 1024;
+    a->bs_nr = 2;
+    a->qd[0] = 1;
+    a->qd_nr = 1;
+
+    if (argc < 2 || argv[1][0] == '-')
+        return -1;
+    a->spec = argv[1];
+
+    for (i = 2; i < argc; i++)
+    {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(opt, "-W") == 0)
+        {
+            a->allow_write = 1;
+            continue;
+        }
+        if (opt[0] != '-' || opt[2] != '\0' || val == NULL)
+            return -1;
+        i++;
+
+        switch (opt[1])
+        {
+        case 'p':
+            if (_parse_patterns(val, &a->patterns) != 0)
+                return -1;
+            break;
+        case 'b':
+            a->bs_nr = _parse_list(val, a->bs, IOBENCH_SIZES_MAX);
+            break;
+        case 'q':
+            a->qd_nr = _parse_list(val, (uint32_t *)a->qd, IOBENCH_SIZES_MAX);
+            break;
+        case 's':
+            a->area = _parse_size(val);
+            break;
+        case 'o':
+            a->offset = _parse_size(val);
+            break;
+        case 'n':
+            a->ops = (uint32_t)_parse_size(val);
+            break;
+        case 'c':
+            a->csv = val;
+            break;
+        case 'l':
+            a->label = val;
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    for (i = 0; i < a->bs_nr; i++)
+    {
+        if (a->bs[i] == 0 || a->bs[i] > IOBENCH_BS_MAX)
+            return -1;
+    }
+    for (i = 0; i < a->qd_nr; i++)
+    {
+        if (a->qd[i] < 1 || a->qd[i] > IOBENCH_QD_MAX)
+            return -1;
+    }
+    return (a->bs_nr && a->qd_nr && a->ops) ? 0 : -1;
+}
+
+static uint32_t _gcd(uint32_t a, uint32_t b)
+{
+    while (b)
+    {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* a step near the golden ratio of the area, visiting every block once */
+static uint32_t _stride(uint32_t blocks)
+{
+    uint32_t stride = (uint32_t)((uint64_t)blocks * 618 / 1000) | 1;
+
+    while (_gcd(stride, blocks) != 1)
+        stride += 2;
+    return stride % blocks;
+}
+
+void iobench_worker_entry(struct iobench_worker *w)
+{
+    struct iobench_job *job = w->job;
+    struct iobench_target *t = job->target;
+    int random = (job->pattern == IOBENCH_RND_READ || job->pattern == IOBENCH_RND_WRITE);
+    int write = (job->pattern >= IOBENCH_SEQ_WRITE);
+    uint32_t cpu = iobench_cycles_per_us();
+    uint32_t start = iobench_millis();
+    uint32_t i, blk, c0;
+    uint64_t off;
+    int ret;
+
+    for (;;)
+    {
+        for (i = w->id; i < job->share; i += job->qd)
+        {
+            blk = random ? (uint32_t)((uint64_t)i * job->stride % job->blocks) : i;
+            off = job->offset + (uint64_t)blk * job->bs;
+
+            c0 = iobench_cycles();
+            if (write)
+                ret = t->write(t, off, w->buf, job->bs);
+            else
+                ret = t->read(t, off, w->buf, job->bs);
+            if (ret != 0)
+            {
+                w->error = ret;
+                return;
+            }
+            w->lat[w->ops % w->lat_cap] = (iobench_cycles() - c0) / cpu;
+            w->ops++;
+        }
+        if ((write && job->once) || iobench_millis() - start >= IOBENCH_MIN_MS)
+            break;
+    }
+}
+
+static int _cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void _percentiles(struct iobench_job *job, struct iobench_result *r)
+{
+    uint32_t *all, nr = 0, n;
+    int i;
+
+    all = iobench_malloc(IOBENCH_LAT_MAX * sizeof(uint32_t));
+    if (all == NULL)
+        return;
+    for (i = 0; i < job->qd; i++)
+    {
+        struct iobench_worker *w = &job->workers[i];
+
+        n = w->ops < w->lat_cap ? w->ops : w->lat_cap;
+        memcpy(all + nr, w->lat, n * sizeof(uint32_t));
+        nr += n;
+    }
+    if (nr)
+    {
+        qsort(all, nr, sizeof(uint32_t), _cmp_u32);
+        r->p50 = all[(uint64_t)nr * 500 / 1000];
+        r->p90 = all[(uint64_t)nr * 900 / 1000];
+        r->p99 = all[(uint64_t)nr * 990 / 1000];
+        r->p999 = all[(uint64_t)nr * 999 / 1000];
+        r->max = all[nr - 1];
+    }
+    iobench_free(all);
+}
+
+static void _job_free(struct iobench_job *job)
+{
+    int i;
+
+    for (i = 0; i < IOBENCH_QD_MAX; i++)
+    {
+        if (job->workers[i].buf)
+            iobench_free(job->workers[i].buf);
+        if (job->workers[i].lat)
+            iobench_free(job->workers[i].lat);
+    }
+}
+
+static int _run(struct iobench_args *a, struct iobench_target *t, struct iobench_job *job,
+                struct iobench_result *r)
+{
+    int random = (job->pattern == IOBENCH_RND_READ || job->pattern == IOBENCH_RND_WRITE);
+    int write = (job->pattern >= IOBENCH_SEQ_WRITE);
+    uint32_t start;
+    int i, ret = 0;
+
+    job->target = t;
+    job->offset = a->offset;
+    job->blocks = (uint32_t)(a->area / job->bs);
+    job->stride = _stride(job->blocks);
+    job->share = random && a->ops < job->blocks ? a->ops : job->blocks;
+    job->once = t->erase_before_write;
+    if (job->qd > (int)job->share)
+        job->qd = job->share;
+
+    for (i = 0; i < job->qd; i++)
+    {
+        struct iobench_worker *w = &job->workers[i];
+
+        w->job = job;
+        w->id = i;
+        w->lat_cap = IOBENCH_LAT_MAX / job->qd;
+        w->buf = iobench_malloc(job->bs);
+        w->lat = iobench_malloc(w->lat_cap * sizeof(uint32_t));
+        if (w->buf == NULL || w->lat == NULL)
+        {
+            iobench_printf("no memory for %u byte blocks\n", job->bs);
+            ret = -1;
+            goto __exit;
+        }
+        memset(w->buf, 0xa5 + i, job->bs);
+    }
+
+    if (write && t->prepare)
+    {
+        start = iobench_millis();
+        ret = t->prepare(t, job->offset, (uint64_t)job->blocks * job->bs);
+        if (ret != 0)
+        {
+            iobench_printf("prepare %s failed %d\n", t->name, ret);
+            goto __exit;
+        }
+        iobench_printf("       erase %u KB in %u ms, not counted\n",
+                       (uint32_t)((uint64_t)job->blocks * job->bs / 1024), iobench_millis() - start);
+    }
+
+    start = iobench_millis();
+    ret = iobench_run_workers(job);
+    r->ms = iobench_millis() - start;
+    if (r->ms == 0)
+        r->ms = 1;
+
+    for (i = 0; i < job->qd; i++)
+    {
+        r->ops += job->workers[i].ops;
+        if (job->workers[i].error)
+            ret = job->workers[i].error;
+    }
+    if (ret != 0)
+    {
+        iobench_printf("%s %s failed %d\n", t->name, _pattern_name[job->pattern], ret);
+        goto __exit;
+    }
+    r->bytes = (uint64_t)r->ops * job->bs;
+    _percentiles(job, r);
+
+__exit:
+    _job_free(job);
+    return ret;
+}
+
+static void _report(struct iobench_args *a, struct iobench_target *t, struct iobench_job *job,
+                    struct iobench_result *r)
+{
+    uint32_t kbps = (uint32_t)(r->bytes * 1000 / 1024 / r->ms);
+    uint32_t iops = (uint32_t)((uint64_t)r->ops * 1000 / r->ms);
+    char line[200];
+
+    iobench_printf("%-6s %7u %2d %5u.%02u %8u %7u %7u %7u %7u %8u\n", _pattern_name[job->pattern],
+                   job->bs, job->qd, kbps / 1024, (kbps % 1024) * 100 / 1024, iops,
+                   r->p50, r->p90, r->p99, r->p999, r->max);
+
+    if (a->csv == NULL)
+        return;
+    iobench_snprintf(line, sizeof(line), "%s,%s,%s,%s,%u,%d,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u",
+                     a->label, t->name, t->kind, _pattern_name[job->pattern], job->bs, job->qd,
+                     r->ops, (uint32_t)(r->bytes / 1024), r->ms, kbps, iops,
+                     r->p50, r->p90, r->p99, r->p999, r->max);
+    if (iobench_csv_append(a->csv, _csv_header, line) != 0)
+    {
+        iobench_printf("write %s failed\n", a->csv);
+        a->csv = NULL;
+    }
+}
+
+int iobench_main(int argc, char **argv)
+{
+    struct iobench_args args;
+    struct iobench_target target;
+    struct iobench_job *job;
+    struct iobench_result r;
+    int p, b, q, ret = 0;
+
+    if (_parse_args(argc, argv, &args) != 0)
+    {
+        _usage();
+        return -1;
+    }
+
+    memset(&target, 0, sizeof(target));
+    if (iobench_target_open(&target, args.spec, args.offset + args.area) != 0)
+    {
+        iobench_printf("can't open %s\n", args.spec);
+        return -1;
+    }
+    if (args.offset % target.unit || args.offset >= target.size)
+    {
+        iobench_printf("offset must be a multiple of %u below %u KB\n",
+                       target.unit, (uint32_t)(target.size / 1024));
+        ret = -1;
+        goto __close;
+    }
+    if (args.area > target.size - args.offset)
+        args.area = target.size - args.offset;
+
+    if (args.patterns == 0)
+    {
+        args.patterns = (1UL << IOBENCH_SEQ_READ) | (1UL << IOBENCH_RND_READ);
+        if (!target.destructive || args.allow_write)
+            args.patterns |= (1UL << IOBENCH_SEQ_WRITE) | (1UL << IOBENCH_RND_WRITE);
+    }
+    else if (target.destructive && !args.allow_write &&
+             (args.patterns & ((1UL << IOBENCH_SEQ_WRITE) | (1UL << IOBENCH_RND_WRITE))))
+    {
+        iobench_printf("writes destroy the data on %s, add -W\n", target.name);
+        ret = -1;
+        goto __close;
+    }
+
+    job = iobench_malloc(sizeof(*job));
+    if (job == NULL)
+    {
+        ret = -1;
+        goto __close;
+    }
+
+    iobench_printf("%s %s, %u KB, area %u KB at %u KB, %u random ops\n", target.kind, target.name,
+                   (uint32_t)(target.size / 1024), (uint32_t)(args.area / 1024),
+                   (uint32_t)(args.offset / 1024), args.ops);
+    iobench_printf("pattern     bs qd    MB/s     IOPS  p50 us  p90 us  p99 us p999 us   max us\n");
+
+    for (b = 0; b < args.bs_nr && ret == 0; b++)
+    {
+        if (args.bs[b] % target.unit || args.bs[b] > args.area)
+        {
+            iobench_printf("skip %u byte blocks, not a multiple of %u or larger than the area\n",
+                           args.bs[b], target.unit);
+            continue;
+        }
+        for (q = 0; q < args.qd_nr && ret == 0; q++)
+        {
+            for (p = 0; p < IOBENCH_PATTERNS && ret == 0; p++)
+            {
+                if (!(args.patterns & (1UL << p)))
+                    continue;
+                memset(job, 0, sizeof(*job));
+                memset(&r, 0, sizeof(r));
+                job->pattern = (enum iobench_pattern)p;
+                job->bs = args.bs[b];
+                job->qd = args.qd[q];
+                ret = _run(&args, &target, job, &r);
+                if (ret == 0)
+                    _report(&args, &target, job, &r);
+            }
+        }
+    }
+    iobench_free(job);
+
+__close:
+    if (target.close)
+        target.close(&target);
+    return ret;
+}
+
+#endif /* IOBENCH_HOST || RT_USING_FINSH */
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-26     RT-Thread     first version
+ */
+
+/*
+ * iobench on a PC, against file-backed stand-ins of the board targets, to
+ * compare the I/O patterns of a change before and after on the same host:
+ *
+ *   cc -O2 -DIOBENCH_HOST -o iobench board/port/iobench_core.c \
+ *      board/port/iobench_host.c -lpthread
+ *   ./iobench file:/tmp/sd0.img -b 512,4k,64k -q 1,4 -c iobench.csv -l before
+ *
+ * Targets: file:<path> (the file is grown to the area, like on the board),
+ * fal:<path> (a file treated like a NOR partition, erased to 0xFF before
+ * each write pass) and mem:<any> (malloc). The file page cache of the host
+ * is in the numbers; the stand-ins measure the code, not the hardware.
+ * Nothing here is built for the board.
+ */
+
+#ifdef IOBENCH_HOST
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "iobench.h"
+
+#define IOBENCH_FILL_CHUNK      (1024 * 1024)
+
+static uint64_t _now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t iobench_millis(void)
+{
+    return (uint32_t)(_now_us() / 1000);
+}
+
+uint32_t iobench_cycles(void)
+{
+    return (uint32_t)_now_us();
+}
+
+uint32_t iobench_cycles_per_us(void)
+{
+    return 1;
+}
+
+void *iobench_malloc(size_t size)
+{
+    void *ptr = NULL;
+
+    return posix_memalign(&ptr, 32, size) == 0 ? ptr : NULL;
+}
+
+void iobench_free(void *ptr)
+{
+    free(ptr);
+}
+
+static void *_worker_thread(void *parameter)
+{
+    iobench_worker_entry(parameter);
+    return NULL;
+}
+
+int iobench_run_workers(struct iobench_job *job)
+{
+    pthread_t tid[IOBENCH_QD_MAX];
+    int i, started;
+
+    for (started = 0; started < job->qd; started++)
+    {
+        if (pthread_create(&tid[started], NULL, _worker_thread, &job->workers[started]) != 0)
+        {
+            job->workers[started].error = -1;
+            break;
+        }
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(tid[i], NULL);
+    return 0;
+}
+
+int iobench_csv_append(const char *path, const char *header, const char *line)
+{
+    FILE *fp = fopen(path, "a");
+
+    if (fp == NULL)
+        return -1;
+    if (ftell(fp) == 0)
+        fprintf(fp, "%s\n", header);
+    fprintf(fp, "%s\n", line);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/* ==================== file: and fal: ==================== */
+
+static int _file_read(struct iobench_target *t, uint64_t off, void *buf, uint32_t len)
+{
+    return pread((int)(intptr_t)t->priv, buf, len, off) == (ssize_t)len ? 0 : -1;
+}
+
+static int _file_write(struct iobench_target *t, uint64_t off, const void *buf, uint32_t len)
+{
+    return pwrite((int)(intptr_t)t->priv, buf, len, off) == (ssize_t)len ? 0 : -1;
+}
+
+static int _file_fill(int fd, uint64_t off, uint64_t len, int value)
+{
+    void *chunk = malloc(IOBENCH_FILL_CHUNK);
+    uint64_t n;
+    int ret = 0;
+
+    if (chunk == NULL)
+        return -1;
+    memset(chunk, value, IOBENCH_FILL_CHUNK);
+    while (len && ret == 0)
+    {
+        n = len > IOBENCH_FILL_CHUNK ? IOBENCH_FILL_CHUNK : len;
+        if (pwrite(fd, chunk, n, off) != (ssize_t)n)
+            ret = -1;
+        off += n;
+        len -= n;
+    }
+    free(chunk);
+    return ret;
+}
+
+static int _fal_prepare(struct iobench_target *t, uint64_t off, uint64_t len)
+{
+    return _file_fill((int)(intptr_t)t->priv, off, len, 0xff);
+}
+
+static void _file_close(struct iobench_target *t)
+{
+    close((int)(intptr_t)t->priv);
+}
+
+static int _file_open(struct iobench_target *t, const char *path, uint64_t area)
+{
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) != 0 ||
+        ((uint64_t)st.st_size < area && _file_fill(fd, st.st_size, area - st.st_size, 0x5a) != 0))
+    {
+        close(fd);
+        return -1;
+    }
+
+    t->size = (uint64_t)st.st_size < area ? area : (uint64_t)st.st_size;
+    t->unit = 512;
+    t->read = _file_read;
+    t->write = _file_write;
+    t->close = _file_close;
+    t->priv = (void *)(intptr_t)fd;
+    return 0;
+}
+
+/* ==================== mem: ==================== */
+
+static int _mem_read(struct iobench_target *t, uint64_t off, void *buf, uint32_t len)
+{
+    memcpy(buf, (uint8_t *)t->priv + off, len);
+    return 0;
+}
+
+static int _mem_write(struct iobench_target *t, uint64_t off, const void *buf, uint32_t len)
+{
+    memcpy((uint8_t *)t->priv + off, buf, len);
+    return 0;
+}
+
+static void _mem_close(struct iobench_target *t)
+{
+    free(t->priv);
+}
+
+static int _mem_open(struct iobench_target *t, uint64_t area)
+{
+    t->priv = iobench_malloc(area);
+    if (t->priv == NULL)
+        return -1;
+    memset(t->priv, 0x5a, area);
+
+    t->size = area;
+    t->unit = 4;
+    t->read = _mem_read;
+    t->write = _mem_write;
+    t->close = _mem_close;
+    return 0;
+}
+
+int iobench_target_open(struct iobench_target *t, const char *spec, uint64_t area)
+{
+    const char *name = strchr(spec, ':');
+
+    if (name == NULL)
+        return -1;
+    name++;
+    strncpy(t->name, name, sizeof(t->name) - 1);
+
+    if (strncmp(spec, "file:", 5) == 0)
+    {
+        t->kind = "file";
+        return _file_open(t, name, area);
+    }
+    if (strncmp(spec, "fal:", 4) == 0)
+    {
+        t->kind = "fal";
+        if (_file_open(t, name, area) != 0)
+            return -1;
+        t->unit = 1;
+        t->erase_before_write = 1;
+        t->prepare = _fal_prepare;
+        return 0;
+    }
+    if (strncmp(spec, "mem:", 4) == 0)
+    {
+        t->kind = "mem";
+        return _mem_open(t, area);
+    }
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    return iobench_main(argc, argv) == 0 ? 0 : 1;
+}
+
+#endif /* IOBENCH_HOST */
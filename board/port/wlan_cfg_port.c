@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-10     RT-Thread    save wlan config to the wlan_cfg FAL partition
+ * 2025-03-02     RT-Thread    two slots with sequence and CRC, power-safe update
+ */
+
+#include <rtthread.h>
+
+#if defined(RT_USING_WIFI) && defined(RT_WLAN_CFG_ENABLE) && defined(RT_USING_FAL)
+
+#include <fal.h>
+#include <wlan_cfg.h>
+
+#define DBG_TAG "app.wlan_cfg"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+
+#define WLAN_CFG_PART_NAME      "wlan_cfg"
+#define WLAN_CFG_SLOT_MAGIC     0x57434653      /* "WCFS" */
+
+/*
+ * The partition is split into two slots of whole erase blocks. An update
+ * erases and writes the slot not in use, data first and the slot head last,
+ * so a power cut leaves either the old record or the new one. The valid slot
+ * with the newer sequence wins on read.
+ */
+struct wlan_cfg_slot_head
+{
+    rt_uint32_t magic;
+    rt_uint32_t seq;
+    rt_uint32_t len;
+    rt_uint32_t crc;        /* CRC-32 of the len data bytes after the head */
+};
+
+static const struct fal_partition *cfg_part;
+static rt_uint32_t cfg_slot_size;
+static int cfg_slot = -1;                       /* valid slot, -1 for none */
+static struct wlan_cfg_slot_head cfg_head;      /* head of that slot */
+
+static rt_uint32_t wlan_cfg_crc32(rt_uint32_t crc, const rt_uint8_t *p, int len)
+{
+    int i;
+
+    crc = ~crc;
+    while (len-- > 0)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/* CRC of a slot's data, read back from flash in small pieces */
+static rt_uint32_t wlan_cfg_slot_crc(int slot, rt_uint32_t len)
+{
+    rt_uint8_t buf[64];
+    rt_uint32_t off = slot * cfg_slot_size + sizeof(struct wlan_cfg_slot_head);
+    rt_uint32_t crc = 0;
+    int n;
+
+    while (len > 0)
+    {
+        n = len > sizeof(buf) ? sizeof(buf) : len;
+        if (fal_partition_read(cfg_part, off, buf, n) < 0)
+        {
+            return ~crc;    /* never matches the stored CRC */
+        }
+        crc = wlan_cfg_crc32(crc, buf, n);
+        off += n;
+        len -= n;
+    }
+    return crc;
+}
+
+static rt_bool_t wlan_cfg_slot_load(int slot, struct wlan_cfg_slot_head *head)
+{
+    if (fal_partition_read(cfg_part, slot * cfg_slot_size, (rt_uint8_t *)head, sizeof(*head)) < 0)
+    {
+        return RT_FALSE;
+    }
+    if ((head->magic != WLAN_CFG_SLOT_MAGIC) ||
+            (head->len > cfg_slot_size - sizeof(*head)))
+    {
+        return RT_FALSE;
+    }
+    return wlan_cfg_slot_crc(slot, head->len) == head->crc;
+}
+
+static void wlan_cfg_slot_scan(void)
+{
+    struct wlan_cfg_slot_head head[2];
+    rt_bool_t valid[2];
+
+    valid[0] = wlan_cfg_slot_load(0, &head[0]);
+    valid[1] = wlan_cfg_slot_load(1, &head[1]);
+    if (valid[0] && valid[1])
+    {
+        /* serial number arithmetic, the sequence may wrap */
+        cfg_slot = ((rt_int32_t)(head[1].seq - head[0].seq) > 0) ? 1 : 0;
+    }
+    else if (valid[0] || valid[1])
+    {
+        cfg_slot = valid[0] ? 0 : 1;
+    }
+    else
+    {
+        cfg_slot = -1;
+        return;
+    }
+    cfg_head = head[cfg_slot];
+}
+
+static int wlan_cfg_read(void *buff, int len)
+{
+    if ((cfg_slot < 0) || ((rt_uint32_t)len > cfg_head.len))
+    {
+        return 0;
+    }
+    if (fal_partition_read(cfg_part, cfg_slot * cfg_slot_size + sizeof(cfg_head), buff, len) < 0)
+    {
+        return 0;
+    }
+    return len;
+}
+
+static int wlan_cfg_get_len(void)
+{
+    return cfg_slot < 0 ? 0 : cfg_head.len;
+}
+
+static int wlan_cfg_write(void *buff, int len)
+{
+    struct wlan_cfg_slot_head head;
+    int slot = (cfg_slot == 0) ? 1 : 0;
+    rt_uint32_t off = slot * cfg_slot_size;
+
+    if ((rt_uint32_t)len > cfg_slot_size - sizeof(head))
+    {
+        return 0;
+    }
+    head.magic = WLAN_CFG_SLOT_MAGIC;
+    head.seq = (cfg_slot < 0) ? 0 : cfg_head.seq + 1;
+    head.len = len;
+    head.crc = wlan_cfg_crc32(0, buff, len);
+
+    if (fal_partition_erase(cfg_part, off, cfg_slot_size) < 0)
+    {
+        return 0;
+    }
+    if (fal_partition_write(cfg_part, off + sizeof(head), buff, len) < 0)
+    {
+        return 0;
+    }
+    /* the head commits the slot, the old one stays valid until it is written */
+    if (fal_partition_write(cfg_part, off, (rt_uint8_t *)&head, sizeof(head)) < 0)
+    {
+        return 0;
+    }
+    if (!wlan_cfg_slot_load(slot, &head))
+    {
+        LOG_E("slot %d verify failed", slot);
+        return 0;
+    }
+    cfg_slot = slot;
+    cfg_head = head;
+    return len;
+}
+
+static const struct rt_wlan_cfg_ops cfg_ops =
+{
+    wlan_cfg_read,
+    wlan_cfg_get_len,
+    wlan_cfg_write,
+};
+
+static int wlan_cfg_port_init(void)
+{
+    const struct fal_flash_dev *flash;
+
+    fal_init();
+    cfg_part = fal_partition_find(WLAN_CFG_PART_NAME);
+    if (cfg_part == RT_NULL)
+    {
+        LOG_W("%s partition not found, wlan config will not be saved", WLAN_CFG_PART_NAME);
+        return -RT_ERROR;
+    }
+    flash = fal_flash_device_find(cfg_part->flash_name);
+    if ((flash == RT_NULL) || (flash->blk_size == 0) ||
+            (cfg_part->len < 2 * flash->blk_size))
+    {
+        LOG_W("%s partition must hold two erase blocks", WLAN_CFG_PART_NAME);
+        return -RT_ERROR;
+    }
+    cfg_slot_size = (cfg_part->len / 2) / flash->blk_size * flash->blk_size;
+    wlan_cfg_slot_scan();
+
+    rt_wlan_cfg_set_ops(&cfg_ops);
+    rt_wlan_cfg_cache_refresh();
+    LOG_D("%d wlan config loaded", rt_wlan_cfg_get_num());
+    return RT_EOK;
+}
+INIT_COMPONENT_EXPORT(wlan_cfg_port_init);
+
+#endif /* RT_USING_WIFI && RT_WLAN_CFG_ENABLE && RT_USING_FAL */
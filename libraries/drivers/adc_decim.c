@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-27     RT-Thread     first version
+ */
+
+/*
+ * The decimator has no RT-Thread dependency; its self-test runs on the board
+ * (adc_stream selftest) and on a PC:
+ *
+ *   cc -O2 -DADC_DECIM_HOST -Ilibraries/drivers/include -o adc_decim \
+ *      libraries/drivers/adc_decim.c
+ *   ./adc_decim
+ */
+
+#include <string.h>
+#include "adc_decim.h"
+
+#ifdef ADC_DECIM_HOST
+#include <stdio.h>
+#include <stdlib.h>
+#define decim_printf            printf
+#define decim_malloc            malloc
+#define decim_free              free
+#else
+#include <rtthread.h>
+#define decim_printf            rt_kprintf
+#define decim_malloc            rt_malloc
+#define decim_free              rt_free
+#endif
+
+static int _ceil_log2(uint32_t v)
+{
+    int n = 0;
+
+    while ((1UL << n) < v)
+        n++;
+    return n;
+}
+
+int adc_decim_init(struct adc_decim *d, int order, int ratio, int in_bits, int frac_bits)
+{
+    int k;
+
+    if (order < 1 || order > ADC_DECIM_ORDER_MAX || ratio < 1 || ratio > ADC_DECIM_RATIO_MAX ||
+        in_bits < 1 || in_bits > 16 || frac_bits < 0 || in_bits + frac_bits > 31)
+        return -1;
+    /* the output of the last comb is the full R^N sum */
+    if (in_bits + order * _ceil_log2(ratio) > 32)
+        return -1;
+
+    memset(d, 0, sizeof(*d));
+    d->order = order;
+    d->ratio = ratio;
+    d->frac_bits = frac_bits;
+    d->gain = 1;
+    for (k = 0; k < order; k++)
+        d->gain *= ratio;
+    d->gain_log2 = (ratio & (ratio - 1)) == 0 ? order * _ceil_log2(ratio) : -1;
+    return 0;
+}
+
+void adc_decim_reset(struct adc_decim *d)
+{
+    d->phase = 0;
+    memset(d->integ, 0, sizeof(d->integ));
+    memset(d->comb, 0, sizeof(d->comb));
+}
+
+static int32_t _scale(const struct adc_decim *d, uint32_t v)
+{
+    uint64_t x = ((uint64_t)v << d->frac_bits) + (d->gain >> 1);
+
+    if (d->gain_log2 >= 0)
+        return (int32_t)(x >> d->gain_log2);
+    return (int32_t)(x / d->gain);
+}
+
+int adc_decim_process(struct adc_decim *d, const uint16_t *in, int stride, int n,
+                      int32_t *out, int out_stride)
+{
+    uint32_t v, t;
+    int i, k, produced = 0;
+
+    for (i = 0; i < n; i++, in += stride)
+    {
+        /* integrators, wrapping: the combs take the differences back out */
+        v = *in;
+        for (k = 0; k < d->order; k++)
+        {
+            d->integ[k] += v;
+            v = d->integ[k];
+        }
+        if (++d->phase < d->ratio)
+            continue;
+
+        d->phase = 0;
+        for (k = 0; k < d->order; k++)
+        {
+            t = v;
+            v -= d->comb[k];
+            d->comb[k] = t;
+        }
+        *out = _scale(d, v);
+        out += out_stride;
+        produced++;
+    }
+
+    return produced;
+}
+
+/* ==================== self-test ==================== */
+
+#define DECIM_TEST_OUTPUTS      40
+#define DECIM_TEST_RATIO_MAX    64
+#define DECIM_TEST_SAMPLES      (DECIM_TEST_OUTPUTS * DECIM_TEST_RATIO_MAX)
+#define DECIM_TEST_CHANNELS     3
+#define DECIM_TEST_BITS         12
+
+struct decim_test
+{
+    uint16_t *in;               /* DECIM_TEST_CHANNELS interleaved */
+    int64_t *work;
+    int32_t out[DECIM_TEST_OUTPUTS * DECIM_TEST_CHANNELS];
+    int32_t ref[DECIM_TEST_OUTPUTS];
+    uint32_t seed;
+    int cases;
+    int failures;
+};
+
+static uint32_t _test_rand(struct decim_test *t)
+{
+    t->seed = t->seed * 1664525UL + 1013904223UL;
+    return t->seed >> 8;
+}
+
+/*
+ * The filter by its definition: N moving sums of R samples over the input
+ * rate, every R-th result kept, in 64 bits so nothing wraps.
+ */
+static void _reference(struct decim_test *t, int ch, int n, int order, int ratio, int frac_bits)
+{
+    int64_t gain = 1, acc;
+    int i, j, k;
+
+    for (i = 0; i < n; i++)
+        t->work[i] = t->in[i * DECIM_TEST_CHANNELS + ch];
+    for (k = 0; k < order; k++)
+    {
+        gain *= ratio;
+        for (i = n - 1; i >= 0; i--)
+        {
+            acc = 0;
+            for (j = i; j >= 0 && j > i - ratio; j--)
+                acc += t->work[j];
+            t->work[i] = acc;
+        }
+    }
+    for (i = 0; i < n / ratio; i++)
+        t->ref[i] = (int32_t)(((t->work[(i + 1) * ratio - 1] << frac_bits) + gain / 2) / gain);
+}
+
+static void _check(struct decim_test *t, const char *what, int order, int ratio, int frac_bits)
+{
+    struct adc_decim d[DECIM_TEST_CHANNELS];
+    int n = DECIM_TEST_OUTPUTS * ratio;
+    int ch, i, done, chunk, produced;
+
+    t->cases++;
+    for (ch = 0; ch < DECIM_TEST_CHANNELS; ch++)
+        adc_decim_init(&d[ch], order, ratio, DECIM_TEST_BITS, frac_bits);
+
+    /* odd chunk sizes, so the phase is carried between calls */
+    produced = 0;
+    for (done = 0; done < n; done += chunk)
+    {
+        chunk = 1 + _test_rand(t) % (3 * ratio);
+        if (chunk > n - done)
+            chunk = n - done;
+        for (ch = 0; ch < DECIM_TEST_CHANNELS; ch++)
+        {
+            i = adc_decim_process(&d[ch], t->in + done * DECIM_TEST_CHANNELS + ch, DECIM_TEST_CHANNELS,
+                                  chunk, t->out + produced * DECIM_TEST_CHANNELS + ch, DECIM_TEST_CHANNELS);
+        }
+        produced += i;
+    }
+    if (produced != DECIM_TEST_OUTPUTS)
+    {
+        decim_printf("adc_decim: %s N=%d R=%d frac=%d: %d outputs, expected %d\n", what, order, ratio,
+                     frac_bits, produced, DECIM_TEST_OUTPUTS);
+        t->failures++;
+        return;
+    }
+
+    for (ch = 0; ch < DECIM_TEST_CHANNELS; ch++)
+    {
+        _reference(t, ch, n, order, ratio, frac_bits);
+        for (i = 0; i < DECIM_TEST_OUTPUTS; i++)
+        {
+            if (t->out[i * DECIM_TEST_CHANNELS + ch] != t->ref[i])
+            {
+                decim_printf("adc_decim: %s N=%d R=%d frac=%d ch%d out[%d] = %d, expected %d\n", what, order,
+                             ratio, frac_bits, ch, i, (int)t->out[i * DECIM_TEST_CHANNELS + ch],
+                             (int)t->ref[i]);
+                t->failures++;
+                return;
+            }
+        }
+    }
+}
+
+static void _check_dc(struct decim_test *t, int order, int ratio, int frac_bits)
+{
+    int32_t expect = ((1 << DECIM_TEST_BITS) - 1) << frac_bits;
+    int i;
+
+    /* past the filling up, full scale in gives full scale out */
+    for (i = order; i < DECIM_TEST_OUTPUTS; i++)
+    {
+        if (t->out[i * DECIM_TEST_CHANNELS] != expect)
+        {
+            decim_printf("adc_decim: dc N=%d R=%d frac=%d out[%d] = %d, expected %d\n", order, ratio,
+                         frac_bits, i, (int)t->out[i * DECIM_TEST_CHANNELS], (int)expect);
+            t->failures++;
+            return;
+        }
+    }
+}
+
+int adc_decim_selftest(void)
+{
+    static const uint16_t ratios[] = {1, 2, 3, 5, 8, 10, 16, 64};
+    struct decim_test *t;
+    struct adc_decim d;
+    int order, r, frac, i, fits;
+
+    t = decim_malloc(sizeof(*t));
+    if (t == NULL)
+        return 1;
+    memset(t, 0, sizeof(*t));
+    t->in = decim_malloc(DECIM_TEST_SAMPLES * DECIM_TEST_CHANNELS * sizeof(uint16_t));
+    t->work = decim_malloc(DECIM_TEST_SAMPLES * sizeof(int64_t));
+    if (t->in == NULL || t->work == NULL)
+    {
+        t->failures = 1;
+        goto __exit;
+    }
+    t->seed = 1;
+
+    for (order = 1; order <= ADC_DECIM_ORDER_MAX; order++)
+    {
+        for (r = 0; r < (int)(sizeof(ratios) / sizeof(ratios[0])); r++)
+        {
+            for (frac = 0; frac <= 4; frac += 4)
+            {
+                fits = DECIM_TEST_BITS + order * _ceil_log2(ratios[r]) <= 32;
+                if ((adc_decim_init(&d, order, ratios[r], DECIM_TEST_BITS, frac) == 0) != fits)
+                {
+                    decim_printf("adc_decim: N=%d R=%d accepted wrongly\n", order, ratios[r]);
+                    t->failures++;
+                }
+                if (!fits)
+                    continue;
+
+                for (i = 0; i < DECIM_TEST_SAMPLES * DECIM_TEST_CHANNELS; i++)
+                    t->in[i] = _test_rand(t) & ((1 << DECIM_TEST_BITS) - 1);
+                _check(t, "noise", order, ratios[r], frac);
+
+                /* full scale wraps the integrators again and again */
+                for (i = 0; i < DECIM_TEST_SAMPLES * DECIM_TEST_CHANNELS; i++)
+                    t->in[i] = (1 << DECIM_TEST_BITS) - 1;
+                _check(t, "full", order, ratios[r], frac);
+                _check_dc(t, order, ratios[r], frac);
+            }
+        }
+    }
+
+    decim_printf("adc_decim: %d cases, %d failures\n", t->cases, t->failures);
+
+__exit:
+    i = t->failures;
+    decim_free(t->work);
+    decim_free(t->in);
+    decim_free(t);
+    return i;
+}
+
+#ifdef ADC_DECIM_HOST
+int main(void)
+{
+    return adc_decim_selftest() == 0 ? 0 : 1;
+}
+#endif /* ADC_DECIM_HOST */
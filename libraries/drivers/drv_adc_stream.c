@@ -0,0 +1,772 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-27     RT-Thread    first version
+ */
+
+/*
+ * ADC1 streaming, without a thread polling the converter.
+ *
+ * TIM6 update events trigger a scan of the configured inputs and GPDMA1
+ * channel 12 stores every conversion in a circular buffer (one linked-list
+ * node looping on itself). The half-transfer and transfer-complete interrupts
+ * each hand over the half the DMA just left: its cache lines are dropped,
+ * every channel goes through its CIC decimator and the output is committed
+ * as one block to a ring of reserved slots. The reader takes the oldest
+ * committed block and releases it when done; when it falls behind the
+ * decimators keep running and the blocks are dropped, so the next one is
+ * flagged with a gap instead of carrying stale filter state.
+ *
+ * Block timestamps count timer periods, so they do not jitter with the
+ * interrupt latency. An ADC overrun leaves the position in the scan unknown:
+ * the stream is restarted from the reader and placed back on the tick clock.
+ */
+
+#include <board.h>
+#include <rtthread.h>
+#include <rtdevice.h>
+
+#ifdef BSP_USING_ADC_STREAM
+#include "drv_adc_stream.h"
+#include "adc_decim.h"
+
+#define DBG_TAG "drv.adc_stream"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+
+#define ADC_STREAM_BITS             12
+#define ADC_STREAM_SAMPLETIME       ADC_SAMPLETIME_47CYCLES_5
+#define ADC_STREAM_CONV_CYCLES      60      /* 47.5 sampling + 12.5 conversion */
+#define ADC_STREAM_CLOCK_DIV        4       /* ADC_CLOCK_SYNC_PCLK_DIV4 */
+#define ADC_STREAM_DMA_MAX          0xFFFF  /* bytes in a GPDMA block */
+#define ADC_STREAM_IRQ_PRIORITY     5
+
+struct adc_stream
+{
+    ADC_HandleTypeDef hadc;
+    DMA_HandleTypeDef hdma;
+    DMA_QListTypeDef queue;
+    struct adc_stream_config cfg;
+    struct adc_decim decim[ADC_STREAM_CHANNELS_MAX];
+
+    rt_uint16_t *dma_buf;               /* two halves of half_scans scans */
+    rt_uint32_t half_scans;
+    rt_uint32_t dma_bytes;
+
+    struct adc_stream_block *ring;
+    rt_int32_t *ring_data;
+    rt_int32_t *scratch;                /* decimator output while the ring is full */
+    volatile rt_uint32_t head;          /* committed by the interrupt */
+    volatile rt_uint32_t tail;          /* released by the reader */
+    struct rt_semaphore sem;
+    rt_bool_t sem_inited;
+
+    rt_uint32_t seq;
+    rt_uint64_t frame;
+    rt_uint32_t flags;                  /* for the next committed block */
+    rt_uint32_t timer_clk;
+    rt_uint32_t period;                 /* timer clocks per scan */
+    volatile rt_bool_t running;
+    volatile rt_bool_t stalled;
+    struct adc_stream_stats stats;
+};
+
+static struct adc_stream _stream;
+/* fetched by the DMA at every loop */
+rt_align(32) static DMA_NodeTypeDef _node;
+
+static const rt_uint32_t _ranks[ADC_STREAM_CHANNELS_MAX] =
+{
+    ADC_REGULAR_RANK_1,  ADC_REGULAR_RANK_2,  ADC_REGULAR_RANK_3,  ADC_REGULAR_RANK_4,
+    ADC_REGULAR_RANK_5,  ADC_REGULAR_RANK_6,  ADC_REGULAR_RANK_7,  ADC_REGULAR_RANK_8,
+    ADC_REGULAR_RANK_9,  ADC_REGULAR_RANK_10, ADC_REGULAR_RANK_11, ADC_REGULAR_RANK_12,
+    ADC_REGULAR_RANK_13, ADC_REGULAR_RANK_14, ADC_REGULAR_RANK_15, ADC_REGULAR_RANK_16,
+};
+
+/* BSP_ADC_STREAM_INPUTS: "<input>:<pin>,...", the pin as "PA.3", or "-" for an internal input */
+static rt_err_t _config_default(struct adc_stream_config *cfg)
+{
+    const char *p = BSP_ADC_STREAM_INPUTS;
+    char name[8];
+    int input, n;
+
+    rt_memset(cfg, 0, sizeof(*cfg));
+    while (*p != '\0')
+    {
+        if (cfg->channels == ADC_STREAM_CHANNELS_MAX || *p < '0' || *p > '9')
+            return -RT_EINVAL;
+        for (input = 0; *p >= '0' && *p <= '9'; p++)
+            input = input * 10 + *p - '0';
+        if (*p != ':')
+            return -RT_EINVAL;
+        for (p++, n = 0; *p != '\0' && *p != ','; p++)
+        {
+            if (n == sizeof(name) - 1)
+                return -RT_EINVAL;
+            name[n++] = *p;
+        }
+        name[n] = '\0';
+        if (*p == ',')
+            p++;
+
+        cfg->channel[cfg->channels] = input;
+        cfg->pin[cfg->channels] = rt_strcmp(name, "-") == 0 ? -1 : rt_pin_get(name);
+        if (rt_strcmp(name, "-") != 0 && cfg->pin[cfg->channels] < 0)
+            return -RT_EINVAL;
+        cfg->channels++;
+    }
+
+    cfg->rate = BSP_ADC_STREAM_RATE;
+    cfg->order = BSP_ADC_STREAM_ORDER;
+    cfg->ratio = BSP_ADC_STREAM_RATIO;
+    cfg->frac_bits = BSP_ADC_STREAM_FRAC_BITS;
+    cfg->block_frames = BSP_ADC_STREAM_BLOCK_FRAMES;
+    cfg->blocks = BSP_ADC_STREAM_BLOCKS;
+    return cfg->channels ? RT_EOK : -RT_EINVAL;
+}
+
+static rt_uint32_t _timer_clock(void)
+{
+    RCC_ClkInitTypeDef clk = {0};
+    uint32_t latency;
+
+    /* the APB timers run at twice PCLK1 when it is divided */
+    HAL_RCC_GetClockConfig(&clk, &latency);
+    return HAL_RCC_GetPCLK1Freq() * (clk.APB1CLKDivider != RCC_APB1_DIV1 ? 2 : 1);
+}
+
+static rt_err_t _config_check(struct adc_stream *s)
+{
+    struct adc_stream_config *cfg = &s->cfg;
+    rt_uint32_t adc_clk = HAL_RCC_GetHCLKFreq() / ADC_STREAM_CLOCK_DIV;
+    int ch;
+
+    if (cfg->channels < 1 || cfg->channels > ADC_STREAM_CHANNELS_MAX || cfg->rate == 0 ||
+        cfg->block_frames == 0 || cfg->blocks < 2)
+        return -RT_EINVAL;
+    for (ch = 0; ch < cfg->channels; ch++)
+    {
+        if (cfg->channel[ch] > 19)
+        {
+            LOG_E("ADC1 has no input %d", cfg->channel[ch]);
+            return -RT_EINVAL;
+        }
+        if (adc_decim_init(&s->decim[ch], cfg->order, cfg->ratio, ADC_STREAM_BITS, cfg->frac_bits) != 0)
+        {
+            LOG_E("decimator order %d, ratio %d, %d fraction bits does not fit 32 bits", cfg->order,
+                  cfg->ratio, cfg->frac_bits);
+            return -RT_EINVAL;
+        }
+    }
+    if ((rt_uint64_t)cfg->rate * cfg->channels * ADC_STREAM_CONV_CYCLES > adc_clk)
+    {
+        LOG_E("%d inputs take %d us, more than a scan period", cfg->channels,
+              cfg->channels * ADC_STREAM_CONV_CYCLES / (adc_clk / 1000000));
+        return -RT_EINVAL;
+    }
+
+    s->half_scans = cfg->block_frames * cfg->ratio;
+    s->dma_bytes = 2 * s->half_scans * cfg->channels * sizeof(rt_uint16_t);
+    if (s->dma_bytes > ADC_STREAM_DMA_MAX)
+    {
+        LOG_E("DMA buffer of %d bytes, the GPDMA takes up to %d: fewer frames per block", s->dma_bytes,
+              ADC_STREAM_DMA_MAX);
+        return -RT_EINVAL;
+    }
+
+    return RT_EOK;
+}
+
+static void _buffers_free(struct adc_stream *s)
+{
+    if (s->dma_buf != RT_NULL)
+        rt_free_align(s->dma_buf);
+    rt_free(s->ring);
+    rt_free(s->ring_data);
+    rt_free(s->scratch);
+    s->dma_buf = RT_NULL;
+    s->ring = RT_NULL;
+    s->ring_data = RT_NULL;
+    s->scratch = RT_NULL;
+}
+
+static rt_err_t _buffers_alloc(struct adc_stream *s)
+{
+    struct adc_stream_config *cfg = &s->cfg;
+    rt_uint32_t block_values = cfg->block_frames * cfg->channels;
+    int i;
+
+    /* AXI SRAM, reachable by the GPDMA; whole cache lines, the CPU never writes them */
+    s->dma_buf = rt_malloc_align(RT_ALIGN(s->dma_bytes, 32), 32);
+    s->ring = rt_malloc(cfg->blocks * sizeof(struct adc_stream_block));
+    s->ring_data = rt_malloc(cfg->blocks * block_values * sizeof(rt_int32_t));
+    s->scratch = rt_malloc(block_values * sizeof(rt_int32_t));
+    if (s->dma_buf == RT_NULL || s->ring == RT_NULL || s->ring_data == RT_NULL || s->scratch == RT_NULL)
+    {
+        _buffers_free(s);
+        return -RT_ENOMEM;
+    }
+
+    /* no dirty line of the previous owner may be evicted over the samples */
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t *)s->dma_buf, RT_ALIGN(s->dma_bytes, 32));
+    for (i = 0; i < cfg->blocks; i++)
+        s->ring[i].data = s->ring_data + i * block_values;
+
+    return RT_EOK;
+}
+
+static void _timer_start(struct adc_stream *s)
+{
+    rt_uint32_t psc;
+
+    s->timer_clk = _timer_clock();
+    s->period = (s->timer_clk + s->cfg.rate / 2) / s->cfg.rate;
+    psc = (s->period - 1) / 0x10000;
+    s->period = s->period / (psc + 1) * (psc + 1);
+    s->stats.scan_rate = s->timer_clk / s->period;
+
+    /* TRGO on update, started after the ADC waits for it */
+    __HAL_RCC_TIM6_CLK_ENABLE();
+    TIM6->CR1 = 0;
+    TIM6->PSC = psc;
+    TIM6->ARR = s->period / (psc + 1) - 1;
+    TIM6->CR2 = TIM_CR2_MMS_1;
+    TIM6->EGR = TIM_EGR_UG;
+    TIM6->SR = 0;
+    TIM6->CR1 = TIM_CR1_CEN;
+}
+
+static void _timer_stop(void)
+{
+    TIM6->CR1 = 0;
+    __HAL_RCC_TIM6_CLK_DISABLE();
+}
+
+static rt_err_t _adc_init(struct adc_stream *s)
+{
+    struct adc_stream_config *cfg = &s->cfg;
+    ADC_ChannelConfTypeDef conf = {0};
+    GPIO_InitTypeDef gpio = {0};
+    int ch;
+
+    __HAL_RCC_ADC12_CLK_ENABLE();
+    for (ch = 0; ch < cfg->channels; ch++)
+    {
+        if (cfg->pin[ch] < 0)
+            continue;
+        gpio.Pin = 1u << (cfg->pin[ch] & 0xF);
+        gpio.Mode = GPIO_MODE_ANALOG;
+        gpio.Pull = GPIO_NOPULL;
+        HAL_GPIO_Init((GPIO_TypeDef *)(GPIOA_BASE + 0x400u * (cfg->pin[ch] >> 4)), &gpio);
+    }
+
+    s->hadc.Instance = ADC1;
+    s->hadc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    s->hadc.Init.Resolution = ADC_RESOLUTION_12B;
+    s->hadc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    s->hadc.Init.ScanConvMode = cfg->channels > 1 ? ADC_SCAN_ENABLE : ADC_SCAN_DISABLE;
+    s->hadc.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+    s->hadc.Init.LowPowerAutoWait = DISABLE;
+    s->hadc.Init.ContinuousConvMode = DISABLE;
+    s->hadc.Init.NbrOfConversion = cfg->channels;
+    s->hadc.Init.DiscontinuousConvMode = DISABLE;
+    s->hadc.Init.ExternalTrigConv = ADC_EXTERNALTRIG_T6_TRGO;
+    s->hadc.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    s->hadc.Init.SamplingMode = ADC_SAMPLING_MODE_NORMAL;
+    s->hadc.Init.ConversionDataManagement = ADC_CONVERSIONDATA_DMA_CIRCULAR;
+    s->hadc.Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+    s->hadc.Init.OversamplingMode = DISABLE;
+    if (HAL_ADC_Init(&s->hadc) != HAL_OK)
+    {
+        LOG_E("ADC1 init failed");
+        return -RT_ERROR;
+    }
+
+    for (ch = 0; ch < cfg->channels; ch++)
+    {
+        conf.Channel = __LL_ADC_DECIMAL_NB_TO_CHANNEL(cfg->channel[ch]);
+        conf.Rank = _ranks[ch];
+        conf.SamplingTime = ADC_STREAM_SAMPLETIME;
+        conf.SingleDiff = ADC_SINGLE_ENDED;
+        conf.OffsetNumber = ADC_OFFSET_NONE;
+        conf.Offset = 0;
+        conf.OffsetSign = ADC_OFFSET_SIGN_NEGATIVE;
+        if (HAL_ADC_ConfigChannel(&s->hadc, &conf) != HAL_OK)
+        {
+            LOG_E("ADC1 input %d failed", cfg->channel[ch]);
+            return -RT_ERROR;
+        }
+    }
+
+    if (HAL_ADCEx_Calibration_Start(&s->hadc, ADC_SINGLE_ENDED) != HAL_OK)
+    {
+        LOG_E("ADC1 calibration failed");
+        return -RT_ERROR;
+    }
+
+    HAL_NVIC_SetPriority(ADC1_2_IRQn, ADC_STREAM_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(ADC1_2_IRQn);
+    return RT_EOK;
+}
+
+/* one node looping on itself; HAL_ADC_Start_DMA() fills in the addresses and the length */
+static rt_err_t _dma_init(struct adc_stream *s)
+{
+    DMA_NodeConfTypeDef node = {0};
+
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+    s->hdma.Instance = GPDMA1_Channel12;
+    s->hdma.InitLinkedList.Priority = DMA_HIGH_PRIORITY;
+    s->hdma.InitLinkedList.LinkStepMode = DMA_LSM_FULL_EXECUTION;
+    s->hdma.InitLinkedList.LinkAllocatedPort = DMA_LINK_ALLOCATED_PORT1;
+    s->hdma.InitLinkedList.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+    s->hdma.InitLinkedList.LinkedListMode = DMA_LINKEDLIST_CIRCULAR;
+    if (HAL_DMAEx_List_Init(&s->hdma) != HAL_OK)
+    {
+        LOG_E("DMA init failed");
+        return -RT_ERROR;
+    }
+
+    node.NodeType = DMA_GPDMA_LINEAR_NODE;
+    node.Init.Request = GPDMA1_REQUEST_ADC1;
+    node.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+    node.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    node.Init.SrcInc = DMA_SINC_FIXED;
+    node.Init.DestInc = DMA_DINC_INCREMENTED;
+    node.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_HALFWORD;
+    node.Init.DestDataWidth = DMA_DEST_DATAWIDTH_HALFWORD;
+    node.Init.SrcBurstLength = 1;
+    node.Init.DestBurstLength = 1;
+    node.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT1;
+    node.Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+    node.Init.Mode = DMA_NORMAL;
+    node.DataHandlingConfig.DataExchange = DMA_EXCHANGE_NONE;
+    node.DataHandlingConfig.DataAlignment = DMA_DATA_RIGHTALIGN_ZEROPADDED;
+    node.TriggerConfig.TriggerPolarity = DMA_TRIG_POLARITY_MASKED;
+    node.SrcAddress = (uint32_t)&ADC1->DR;
+    node.DstAddress = (uint32_t)s->dma_buf;
+    node.DataSize = s->dma_bytes;
+
+    rt_memset(&s->queue, 0, sizeof(s->queue));
+    if (HAL_DMAEx_List_BuildNode(&node, &_node) != HAL_OK ||
+        HAL_DMAEx_List_InsertNode_Tail(&s->queue, &_node) != HAL_OK ||
+        HAL_DMAEx_List_SetCircularMode(&s->queue) != HAL_OK ||
+        HAL_DMAEx_List_LinkQ(&s->hdma, &s->queue) != HAL_OK)
+    {
+        LOG_E("DMA list failed");
+        return -RT_ERROR;
+    }
+    __HAL_LINKDMA(&s->hadc, DMA_Handle, s->hdma);
+
+    HAL_NVIC_SetPriority(GPDMA1_Channel12_IRQn, ADC_STREAM_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(GPDMA1_Channel12_IRQn);
+    return RT_EOK;
+}
+
+static rt_err_t _conversions_start(struct adc_stream *s)
+{
+    if (HAL_ADC_Start_DMA(&s->hadc, (uint32_t *)s->dma_buf, s->dma_bytes / sizeof(rt_uint16_t)) != HAL_OK)
+        return -RT_ERROR;
+    /* the start patched the node, the DMA reloads it at the end of the buffer */
+    SCB_CleanDCache_by_Addr((uint32_t *)&_node, sizeof(_node));
+    return RT_EOK;
+}
+
+/* from the reader: the timer keeps running, the ADC starts again at the next scan */
+static void _stream_restart(struct adc_stream *s)
+{
+    rt_uint64_t elapsed_us;
+    int ch;
+
+    HAL_ADC_Stop_DMA(&s->hadc);
+    for (ch = 0; ch < s->cfg.channels; ch++)
+        adc_decim_reset(&s->decim[ch]);
+
+    /* how many scans were lost is not known: back on the tick clock */
+    elapsed_us = (rt_uint64_t)(rt_tick_get() - s->stats.start_tick) * (1000000 / RT_TICK_PER_SECOND);
+    s->frame = elapsed_us * (s->timer_clk / 1000000) / ((rt_uint64_t)s->period * s->cfg.ratio);
+    s->flags |= ADC_STREAM_BLOCK_START | ADC_STREAM_BLOCK_GAP;
+    s->stalled = RT_FALSE;
+    if (_conversions_start(s) != RT_EOK)
+        LOG_E("restart failed");
+}
+
+/* ==================== interrupts ==================== */
+
+static void _stream_half(struct adc_stream *s, const rt_uint16_t *half)
+{
+    struct adc_stream_config *cfg = &s->cfg;
+    struct adc_stream_block *block = RT_NULL;
+    rt_uint32_t start = DWT->CYCCNT;
+    rt_int32_t *out = s->scratch;
+    int ch;
+
+    if (!s->running)
+        return;
+
+    SCB_InvalidateDCache_by_Addr((uint32_t *)half, s->dma_bytes / 2);
+
+    /* reserve */
+    if (s->head - s->tail < cfg->blocks)
+    {
+        block = &s->ring[s->head % cfg->blocks];
+        out = block->data;
+    }
+    else
+    {
+        /* the reader is behind: keep the filter state, drop the output */
+        s->stats.dropped++;
+        s->flags |= ADC_STREAM_BLOCK_GAP;
+    }
+
+    /* a half holds whole output frames, every channel gives block_frames */
+    for (ch = 0; ch < cfg->channels; ch++)
+        adc_decim_process(&s->decim[ch], half + ch, cfg->channels, s->half_scans, out + ch, cfg->channels);
+
+    /* commit */
+    if (block != RT_NULL)
+    {
+        block->seq = s->seq;
+        block->flags = s->flags;
+        block->frame = s->frame;
+        block->timestamp_us = s->frame * cfg->ratio * s->period / (s->timer_clk / 1000000);
+        block->frames = cfg->block_frames;
+        block->channels = cfg->channels;
+        s->flags = 0;
+        __DMB();
+        s->head++;
+        s->stats.blocks++;
+        rt_sem_release(&s->sem);
+    }
+    s->seq++;
+    s->frame += cfg->block_frames;
+    s->stats.scans += s->half_scans;
+
+    start = DWT->CYCCNT - start;
+    s->stats.isr_cycles += start;
+    if (start > s->stats.isr_max_cycles)
+        s->stats.isr_max_cycles = start;
+}
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc == &_stream.hadc)
+        _stream_half(&_stream, _stream.dma_buf);
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc == &_stream.hadc)
+        _stream_half(&_stream, _stream.dma_buf + _stream.half_scans * _stream.cfg.channels);
+}
+
+void HAL_ADC_ErrorCallback(ADC_HandleTypeDef *hadc)
+{
+    struct adc_stream *s = &_stream;
+
+    if (hadc != &s->hadc || !s->running)
+        return;
+    if (hadc->ErrorCode & HAL_ADC_ERROR_OVR)
+        s->stats.adc_overruns++;
+    if (hadc->ErrorCode & HAL_ADC_ERROR_DMA)
+        s->stats.dma_errors++;
+    /* the DMA requests stop until the stream is restarted, let the reader do it */
+    s->stalled = RT_TRUE;
+    rt_sem_release(&s->sem);
+}
+
+void GPDMA1_Channel12_IRQHandler(void)
+{
+    rt_interrupt_enter();
+    HAL_DMA_IRQHandler(&_stream.hdma);
+    rt_interrupt_leave();
+}
+
+void ADC1_2_IRQHandler(void)
+{
+    rt_interrupt_enter();
+    HAL_ADC_IRQHandler(&_stream.hadc);
+    rt_interrupt_leave();
+}
+
+/* ==================== API ==================== */
+
+static void _hw_deinit(struct adc_stream *s)
+{
+    _timer_stop();
+    HAL_NVIC_DisableIRQ(GPDMA1_Channel12_IRQn);
+    HAL_NVIC_DisableIRQ(ADC1_2_IRQn);
+    /* also after a failed start, linked or not */
+    if (s->hadc.DMA_Handle != RT_NULL)
+        HAL_ADC_Stop_DMA(&s->hadc);
+    HAL_DMAEx_List_DeInit(&s->hdma);
+    HAL_ADC_DeInit(&s->hadc);
+}
+
+rt_err_t adc_stream_start(const struct adc_stream_config *cfg)
+{
+    struct adc_stream *s = &_stream;
+    struct adc_stream_config def;
+    rt_err_t err;
+
+    if (s->running)
+        return -RT_EBUSY;
+    if (cfg == RT_NULL)
+    {
+        if (_config_default(&def) != RT_EOK)
+        {
+            LOG_E("bad BSP_ADC_STREAM_INPUTS \"%s\"", BSP_ADC_STREAM_INPUTS);
+            return -RT_EINVAL;
+        }
+        cfg = &def;
+    }
+
+    rt_memset(&s->hadc, 0, sizeof(s->hadc));
+    rt_memset(&s->hdma, 0, sizeof(s->hdma));
+    rt_memset(&s->stats, 0, sizeof(s->stats));
+    s->cfg = *cfg;
+    err = _config_check(s);
+    if (err != RT_EOK)
+        return err;
+    err = _buffers_alloc(s);
+    if (err != RT_EOK)
+        return err;
+
+    if (!s->sem_inited)
+    {
+        rt_sem_init(&s->sem, "adc_strm", 0, RT_IPC_FLAG_PRIO);
+        s->sem_inited = RT_TRUE;
+    }
+    rt_sem_control(&s->sem, RT_IPC_CMD_RESET, RT_NULL);
+    s->head = 0;
+    s->tail = 0;
+    s->seq = 0;
+    s->frame = 0;
+    s->flags = ADC_STREAM_BLOCK_START;
+    s->stalled = RT_FALSE;
+
+    /* the interrupts are timed with the cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    err = _adc_init(s);
+    if (err == RT_EOK)
+        err = _dma_init(s);
+    if (err == RT_EOK)
+    {
+        s->running = RT_TRUE;
+        err = _conversions_start(s);
+    }
+    if (err != RT_EOK)
+    {
+        s->running = RT_FALSE;
+        _hw_deinit(s);
+        _buffers_free(s);
+        return err;
+    }
+    s->stats.start_tick = rt_tick_get();
+    _timer_start(s);
+
+    LOG_I("%d inputs at %d Hz, CIC order %d / %d, %d frames per block", s->cfg.channels, s->stats.scan_rate,
+          s->cfg.order, s->cfg.ratio, s->cfg.block_frames);
+    return RT_EOK;
+}
+
+/* call it from the reader, or once nothing reads any more: the blocks are freed */
+rt_err_t adc_stream_stop(void)
+{
+    struct adc_stream *s = &_stream;
+
+    if (!s->running)
+        return -RT_ERROR;
+
+    s->running = RT_FALSE;
+    _hw_deinit(s);
+    rt_sem_release(&s->sem);
+    _buffers_free(s);
+    return RT_EOK;
+}
+
+struct adc_stream_block *adc_stream_read(rt_int32_t timeout)
+{
+    struct adc_stream *s = &_stream;
+
+    while (s->running)
+    {
+        if (s->stalled)
+            _stream_restart(s);
+        if (s->head != s->tail)
+            return &s->ring[s->tail % s->cfg.blocks];
+        if (rt_sem_take(&s->sem, timeout) != RT_EOK)
+            break;
+    }
+
+    return RT_NULL;
+}
+
+void adc_stream_release(struct adc_stream_block *block)
+{
+    struct adc_stream *s = &_stream;
+
+    RT_ASSERT(block == &s->ring[s->tail % s->cfg.blocks]);
+    s->tail++;
+}
+
+void adc_stream_get_stats(struct adc_stream_stats *stats)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    *stats = _stream.stats;
+    rt_hw_interrupt_enable(level);
+}
+
+/* ==================== msh ==================== */
+
+#ifdef RT_USING_FINSH
+#include <stdlib.h>
+
+static void _stream_print_stats(void)
+{
+    struct adc_stream_stats stats;
+    rt_uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    adc_stream_get_stats(&stats);
+    rt_kprintf("scan rate %u Hz, %u scans, %u blocks, %u dropped, %u ADC overruns, %u DMA errors\n",
+               stats.scan_rate, (rt_uint32_t)stats.scans, stats.blocks, stats.dropped, stats.adc_overruns,
+               stats.dma_errors);
+    rt_kprintf("interrupts %u us on average, %u us at most\n",
+               stats.blocks + stats.dropped ?
+               (rt_uint32_t)(stats.isr_cycles / (stats.blocks + stats.dropped) / cycles_per_us) : 0,
+               stats.isr_max_cycles / cycles_per_us);
+}
+
+static void _stream_print_block(struct adc_stream_block *block)
+{
+    rt_int64_t sum;
+    int ch, i;
+
+    rt_kprintf("#%u %8u us%s%s:", block->seq, (rt_uint32_t)block->timestamp_us,
+               block->flags & ADC_STREAM_BLOCK_START ? " start" : "",
+               block->flags & ADC_STREAM_BLOCK_GAP ? " gap" : "");
+    for (ch = 0; ch < block->channels; ch++)
+    {
+        sum = 0;
+        for (i = 0; i < block->frames; i++)
+            sum += block->data[i * block->channels + ch];
+        rt_kprintf(" %d", (int)(sum / block->frames));
+    }
+    rt_kprintf("\n");
+}
+
+/*
+ * Drain the stream for a while: the frame rate delivered to the reader, and
+ * the share of the CPU the decimating interrupts took meanwhile.
+ */
+static void _stream_bench(int seconds)
+{
+    struct adc_stream_stats before, after;
+    struct adc_stream_block *block;
+    rt_uint64_t frames = 0, isr;
+    rt_uint32_t start, ms, load;
+    int started = 0, gaps = 0;
+
+    if (seconds < 1)
+        seconds = 1;
+    if (!_stream.running)
+    {
+        if (adc_stream_start(RT_NULL) != RT_EOK)
+            return;
+        started = 1;
+    }
+    /* the blocks queued before the start of the measurement do not count */
+    while ((block = adc_stream_read(0)) != RT_NULL)
+        adc_stream_release(block);
+
+    adc_stream_get_stats(&before);
+    start = rt_tick_get_millisecond();
+    while ((ms = rt_tick_get_millisecond() - start) < (rt_uint32_t)seconds * 1000)
+    {
+        block = adc_stream_read(rt_tick_from_millisecond(100));
+        if (block == RT_NULL)
+            continue;
+        frames += block->frames;
+        if (block->flags & ADC_STREAM_BLOCK_GAP)
+            gaps++;
+        adc_stream_release(block);
+    }
+    adc_stream_get_stats(&after);
+
+    isr = after.isr_cycles - before.isr_cycles;
+    load = (rt_uint32_t)(isr * 10000 / ((rt_uint64_t)ms * (SystemCoreClock / 1000)));
+    rt_kprintf("%u frames in %u ms: %u frames/s per input, %u scans/s (%u expected)\n", (rt_uint32_t)frames, ms,
+               (rt_uint32_t)(frames * 1000 / ms), (rt_uint32_t)((after.scans - before.scans) * 1000 / ms),
+               after.scan_rate);
+    rt_kprintf("CPU in the interrupts %u.%02u%%, %u gaps, %u dropped, %u overruns\n", load / 100, load % 100,
+               gaps, after.dropped - before.dropped, after.adc_overruns - before.adc_overruns);
+    _stream_print_stats();
+
+    if (started)
+        adc_stream_stop();
+}
+
+static void adc_stream(int argc, char **argv)
+{
+    struct adc_stream_block *block;
+    int i, n;
+
+    if (argc >= 2 && rt_strcmp(argv[1], "start") == 0)
+    {
+        if (adc_stream_start(RT_NULL) != RT_EOK)
+            rt_kprintf("start failed\n");
+    }
+    else if (argc >= 2 && rt_strcmp(argv[1], "stop") == 0)
+    {
+        adc_stream_stop();
+    }
+    else if (argc >= 2 && rt_strcmp(argv[1], "stat") == 0)
+    {
+        _stream_print_stats();
+    }
+    else if (argc >= 2 && rt_strcmp(argv[1], "read") == 0)
+    {
+        n = argc >= 3 ? atoi(argv[2]) : 10;
+        for (i = 0; i < n; i++)
+        {
+            block = adc_stream_read(rt_tick_from_millisecond(1000));
+            if (block == RT_NULL)
+            {
+                rt_kprintf("no block, started?\n");
+                break;
+            }
+            _stream_print_block(block);
+            adc_stream_release(block);
+        }
+    }
+    else if (argc >= 2 && rt_strcmp(argv[1], "bench") == 0)
+    {
+        _stream_bench(argc >= 3 ? atoi(argv[2]) : 10);
+    }
+    else if (argc >= 2 && rt_strcmp(argv[1], "selftest") == 0)
+    {
+        adc_decim_selftest();
+    }
+    else
+    {
+        rt_kprintf("Usage:\n");
+        rt_kprintf("adc_stream start|stop     - scan the BSP_ADC_STREAM_INPUTS\n");
+        rt_kprintf("adc_stream stat           - rates, drops and interrupt time\n");
+        rt_kprintf("adc_stream read [n]       - print the mean of each input over n blocks\n");
+        rt_kprintf("adc_stream bench [s]      - sustained rate and CPU load over s seconds\n");
+        rt_kprintf("adc_stream selftest       - check the decimator\n");
+    }
+}
+MSH_CMD_EXPORT(adc_stream, ADC1 streaming: adc_stream <start|stop|stat|read|bench|selftest>);
+#endif /* RT_USING_FINSH */
+
+#endif /* BSP_USING_ADC_STREAM */
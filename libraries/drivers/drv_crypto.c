@@ -0,0 +1,911 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-14     RT-Thread    first version for STM32H7RS CRYP/HASH/PKA/RNG/CRC
+ */
+
+#include "board.h"
+#include <rtdevice.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef BSP_USING_HWCRYPTO
+
+#include "drv_crypto.h"
+
+//#define DRV_DEBUG
+#define LOG_TAG             "drv.crypto"
+#include <drv_log.h>
+
+#define CRYPTO_TIMEOUT_MS       1000
+/* HAL_CRYP_Encrypt/Decrypt take a 16-bit byte count */
+#define CRYP_CHUNK_MAX          0xFFF0U
+/* PKA operands are limited to 4160 bits */
+#define PKA_OPERAND_MAX         (4160 / 8)
+
+static struct stm32_hwcrypto_device crypto_dev;
+
+#if defined(BSP_USING_RNG) || defined(BSP_USING_PKA)
+static RNG_HandleTypeDef rng_handle;
+static rt_bool_t rng_ready = RT_FALSE;
+
+static rt_err_t stm32_rng_init(void)
+{
+    rt_tick_t start;
+
+    if (rng_ready)
+    {
+        return RT_EOK;
+    }
+
+    /* RNG kernel clock is HSI48 */
+    __HAL_RCC_HSI48_ENABLE();
+    start = rt_tick_get();
+    while (READ_BIT(RCC->CR, RCC_CR_HSI48RDY) == 0)
+    {
+        if (rt_tick_get() - start > rt_tick_from_millisecond(CRYPTO_TIMEOUT_MS))
+        {
+            LOG_E("HSI48 not ready");
+            return -RT_ETIMEOUT;
+        }
+    }
+    __HAL_RCC_RNG_CLK_ENABLE();
+
+    rng_handle.Instance = RNG;
+    rng_handle.Init.ClockErrorDetection = RNG_CED_ENABLE;
+    if (HAL_RNG_Init(&rng_handle) != HAL_OK)
+    {
+        LOG_E("RNG init failed");
+        return -RT_ERROR;
+    }
+    rng_ready = RT_TRUE;
+
+    return RT_EOK;
+}
+#endif /* BSP_USING_RNG || BSP_USING_PKA */
+
+#if defined(BSP_USING_RNG)
+static rt_uint32_t _rng_rand(struct hwcrypto_rng *ctx)
+{
+    rt_uint32_t gen_random = 0;
+
+    rt_mutex_take(&crypto_dev.mutex, RT_WAITING_FOREVER);
+    if (stm32_rng_init() == RT_EOK)
+    {
+        HAL_RNG_GenerateRandomNumber(&rng_handle, &gen_random);
+    }
+    rt_mutex_release(&crypto_dev.mutex);
+
+    return gen_random;
+}
+
+static const struct hwcrypto_rng_ops rng_ops =
+{
+    .update = _rng_rand,
+};
+#endif /* BSP_USING_RNG */
+
+#if defined(BSP_USING_CRC)
+static CRC_HandleTypeDef crc_handle;
+/* the configuration currently loaded into the CRC unit */
+static struct hwcrypto_crc_cfg crc_loaded_cfg;
+static rt_bool_t crc_ready = RT_FALSE;
+
+static rt_uint32_t crc_reflect(rt_uint32_t val, rt_uint16_t width)
+{
+    return __RBIT(val) >> (32 - width);
+}
+
+static rt_err_t crc_load_cfg(const struct hwcrypto_crc_cfg *cfg)
+{
+    if (crc_ready && cfg->poly == crc_loaded_cfg.poly &&
+        cfg->width == crc_loaded_cfg.width && cfg->flags == crc_loaded_cfg.flags)
+    {
+        return RT_EOK;
+    }
+
+    crc_handle.Instance = CRC;
+    crc_handle.Init.DefaultPolynomialUse = DEFAULT_POLYNOMIAL_DISABLE;
+    crc_handle.Init.DefaultInitValueUse = DEFAULT_INIT_VALUE_DISABLE;
+    crc_handle.Init.GeneratingPolynomial = cfg->poly;
+    crc_handle.Init.InitValue = cfg->last_val;
+    switch (cfg->width)
+    {
+    case 7:
+        crc_handle.Init.CRCLength = CRC_POLYLENGTH_7B;
+        break;
+    case 8:
+        crc_handle.Init.CRCLength = CRC_POLYLENGTH_8B;
+        break;
+    case 16:
+        crc_handle.Init.CRCLength = CRC_POLYLENGTH_16B;
+        break;
+    case 32:
+        crc_handle.Init.CRCLength = CRC_POLYLENGTH_32B;
+        break;
+    default:
+        return -RT_EINVAL;
+    }
+    crc_handle.Init.InputDataInversionMode = (cfg->flags & CRC_FLAG_REFIN) ?
+            CRC_INPUTDATA_INVERSION_BYTE : CRC_INPUTDATA_INVERSION_NONE;
+    crc_handle.Init.OutputDataInversionMode = (cfg->flags & CRC_FLAG_REFOUT) ?
+            CRC_OUTPUTDATA_INVERSION_ENABLE : CRC_OUTPUTDATA_INVERSION_DISABLE;
+    crc_handle.InputDataFormat = CRC_INPUTDATA_FORMAT_BYTES;
+
+    if (HAL_CRC_Init(&crc_handle) != HAL_OK)
+    {
+        crc_ready = RT_FALSE;
+        return -RT_ERROR;
+    }
+    crc_loaded_cfg = *cfg;
+    crc_ready = RT_TRUE;
+
+    return RT_EOK;
+}
+
+static rt_uint32_t _crc_update(struct hwcrypto_crc *ctx, const rt_uint8_t *in, rt_size_t length)
+{
+    struct hwcrypto_crc_cfg *cfg = &ctx->crc_cfg;
+    rt_uint32_t mask, result = 0;
+
+    rt_mutex_take(&crypto_dev.mutex, RT_WAITING_FOREVER);
+    if (crc_load_cfg(cfg) == RT_EOK)
+    {
+        mask = (cfg->width >= 32) ? 0xFFFFFFFFUL : ((1UL << cfg->width) - 1);
+
+        /* continue from the shift register value the previous update left */
+        WRITE_REG(crc_handle.Instance->INIT, cfg->last_val);
+        __HAL_CRC_DR_RESET(&crc_handle);
+        result = HAL_CRC_Accumulate(&crc_handle, (uint32_t *)(rt_ubase_t)in, length) & mask;
+
+        cfg->last_val = (cfg->flags & CRC_FLAG_REFOUT) ? crc_reflect(result, cfg->width) : result;
+        result = (result ^ cfg->xorout) & mask;
+    }
+    rt_mutex_release(&crypto_dev.mutex);
+
+    return result;
+}
+
+static const struct hwcrypto_crc_ops crc_ops =
+{
+    .update = _crc_update,
+};
+#endif /* BSP_USING_CRC */
+
+#if defined(BSP_USING_HASH)
+struct stm32_hash_ctx
+{
+    HASH_HandleTypeDef hhash;
+    rt_uint32_t context[HASH_CONTEXT_WORDS];    /* saved while another context owns the unit */
+    rt_uint8_t tail[4];                         /* input that does not fill a word yet */
+    rt_uint8_t tail_len;
+    rt_uint8_t started;                         /* the unit holds a partial digest */
+};
+
+/* the context whose state is live in the HASH unit */
+static struct stm32_hash_ctx *hash_owner = RT_NULL;
+
+static rt_uint32_t hash_algorithm(hwcrypto_type type)
+{
+    switch (type)
+    {
+    case HWCRYPTO_TYPE_SHA224:
+        return HASH_ALGOSELECTION_SHA224;
+    case HWCRYPTO_TYPE_SHA256:
+        return HASH_ALGOSELECTION_SHA256;
+    case HWCRYPTO_TYPE_SHA384:
+        return HASH_ALGOSELECTION_SHA384;
+    case HWCRYPTO_TYPE_SHA512:
+        return HASH_ALGOSELECTION_SHA512;
+    default:
+        return HASH_ALGOSELECTION_SHA1;
+    }
+}
+
+static rt_size_t hash_digest_len(hwcrypto_type type)
+{
+    switch (type)
+    {
+    case HWCRYPTO_TYPE_SHA224:
+        return 28;
+    case HWCRYPTO_TYPE_SHA256:
+        return 32;
+    case HWCRYPTO_TYPE_SHA384:
+        return 48;
+    case HWCRYPTO_TYPE_SHA512:
+        return 64;
+    default:
+        return 20;
+    }
+}
+
+/* Swap the HASH unit over to ctx. The TLS handshake keeps several running
+ * digests at once, so the previous owner's registers are parked in its
+ * context buffer and restored when it is used again. */
+static rt_err_t hash_acquire(struct hwcrypto_hash *hash_ctx)
+{
+    struct stm32_hash_ctx *ctx = (struct stm32_hash_ctx *)hash_ctx->parent.contex;
+
+    if (hash_owner == ctx)
+    {
+        return RT_EOK;
+    }
+    if (hash_owner && hash_owner->started)
+    {
+        HAL_HASH_Suspend(&hash_owner->hhash, (uint8_t *)hash_owner->context);
+    }
+    hash_owner = RT_NULL;
+
+    if (ctx->started)
+    {
+        HAL_HASH_Resume(&ctx->hhash, (uint8_t *)ctx->context);
+    }
+    else
+    {
+        ctx->hhash.Instance = HASH;
+        ctx->hhash.Init.DataType = HASH_BYTE_SWAP;
+        ctx->hhash.Init.Algorithm = hash_algorithm(hash_ctx->parent.type);
+        if (HAL_HASH_Init(&ctx->hhash) != HAL_OK)
+        {
+            return -RT_ERROR;
+        }
+    }
+    hash_owner = ctx;
+
+    return RT_EOK;
+}
+
+static rt_err_t _hash_update(struct hwcrypto_hash *hash_ctx, const rt_uint8_t *in, rt_size_t length)
+{
+    struct stm32_hash_ctx *ctx = (struct stm32_hash_ctx *)hash_ctx->parent.contex;
+    rt_size_t fill, whole;
+    rt_err_t err;
+
+    /* HAL_HASH_Accumulate only takes whole words */
+    if (ctx->tail_len + length < sizeof(ctx->tail))
+    {
+        rt_memcpy(&ctx->tail[ctx->tail_len], in, length);
+        ctx->tail_len += length;
+        return RT_EOK;
+    }
+
+    rt_mutex_take(&crypto_dev.mutex, RT_WAITING_FOREVER);
+    err = hash_acquire(hash_ctx);
+    if (err != RT_EOK)
+    {
+        goto __exit;
+    }
+
+    if (ctx->tail_len)
+    {
+        fill = sizeof(ctx->tail) - ctx->tail_len;
+        rt_memcpy(&ctx->tail[ctx->tail_len], in, fill);
+        in += fill;
+        length -= fill;
+        if (HAL_HASH_Accumulate(&ctx->hhash, ctx->tail, sizeof(ctx->tail), CRYPTO_TIMEOUT_MS) != HAL_OK)
+        {
+            err = -RT_ERROR;
+            goto __exit;
+        }
+        ctx->tail_len = 0;
+        ctx->started = 1;
+    }
+
+    whole = length & ~(rt_size_t)3;
+    if (whole)
+    {
+        if (HAL_HASH_Accumulate(&ctx->hhash, in, whole, CRYPTO_TIMEOUT_MS) != HAL_OK)
+        {
+            err = -RT_ERROR;
+            goto __exit;
+        }
+        ctx->started = 1;
+    }
+    rt_memcpy(ctx->tail, in + whole, length - whole);
+    ctx->tail_len = length - whole;
+
+__exit:
+    rt_mutex_release(&crypto_dev.mutex);
+    return err;
+}
+
+static rt_err_t _hash_finish(struct hwcrypto_hash *hash_ctx, rt_uint8_t *out, rt_size_t length)
+{
+    struct stm32_hash_ctx *ctx = (struct stm32_hash_ctx *)hash_ctx->parent.contex;
+    rt_uint8_t digest[64];
+    rt_size_t digest_len = hash_digest_len(hash_ctx->parent.type);
+    rt_err_t err;
+
+    rt_mutex_take(&crypto_dev.mutex, RT_WAITING_FOREVER);
+    err = hash_acquire(hash_ctx);
+    if (err == RT_EOK &&
+        HAL_HASH_AccumulateLast(&ctx->hhash, ctx->tail, ctx->tail_len, digest, CRYPTO_TIMEOUT_MS) != HAL_OK)
+    {
+        err = -RT_ERROR;
+    }
+    ctx->tail_len = 0;
+    ctx->started = 0;
+    rt_mutex_release(&crypto_dev.mutex);
+
+    if (err == RT_EOK)
+    {
+        rt_memcpy(out, digest, length < digest_len ? length : digest_len);
+    }
+
+    return err;
+}
+
+static const struct hwcrypto_hash_ops hash_ops =
+{
+    .update = _hash_update,
+    .finish = _hash_finish,
+};
+#endif /* BSP_USING_HASH */
+
+#if defined(BSP_USING_CRYP)
+static CRYP_HandleTypeDef cryp_handle;
+static rt_uint32_t cryp_key[8];
+static rt_uint32_t cryp_iv[4];
+static rt_bool_t cryp_ready = RT_FALSE;
+
+/* the CRYP key and IV registers take big-endian words */
+static void cryp_load_be(rt_uint32_t *dst, const rt_uint8_t *src, rt_size_t words)
+{
+    rt_size_t i;
+
+    for (i = 0; i < words; i++, src += 4)
+    {
+        dst[i] = ((rt_uint32_t)src[0] << 24) | ((rt_uint32_t)src[1] << 16) |
+                 ((rt_uint32_t)src[2] << 8) | (rt_uint32_t)src[3];
+    }
+}
+
+static void cryp_ctr_add(rt_uint8_t *ctr, rt_uint32_t blocks)
+{
+    rt_uint32_t carry = blocks;
+    int i;
+
+    for (i = 15; i >= 0 && carry; i--)
+    {
+        carry += ctr[i];
+        ctr[i] = (rt_uint8_t)carry;
+        carry >>= 8;
+    }
+}
+
+static rt_err_t cryp_init(void)
+{
+    if (cryp_ready)
+    {
+        return RT_EOK;
+    }
+
+    cryp_handle.Instance = CRYP;
+    cryp_handle.Init.DataType = CRYP_DATATYPE_8B;
+    cryp_handle.Init.KeySize = CRYP_KEYSIZE_128B;
+    cryp_handle.Init.pKey = cryp_key;
+    cryp_handle.Init.Algorithm = CRYP_AES_ECB;
+    cryp_handle.Init.DataWidthUnit = CRYP_DATAWIDTHUNIT_BYTE;
+    cryp_handle.Init.HeaderWidthUnit = CRYP_HEADERWIDTHUNIT_WORD;
+    cryp_handle.Init.KeyIVConfigSkip = CRYP_KEYIVCONFIG_ALWAYS;
+    cryp_handle.Init.KeyMode = CRYP_KEYMODE_NORMAL;
+    if (HAL_CRYP_Init(&cryp_handle) != HAL_OK)
+    {
+        LOG_E("CRYP init failed");
+        return -RT_ERROR;
+    }
+    cryp_ready = RT_TRUE;
+
+    return RT_EOK;
+}
+
+static rt_err_t _cryp_crypt(struct hwcrypto_symmetric *symmetric_ctx, struct hwcrypto_symmetric_info *info)
+{
+    CRYP_ConfigTypeDef conf = {0};
+    hwcrypto_type type = symmetric_ctx->parent.type;
+    rt_uint8_t next_iv[16];
+    rt_size_t done, chunk;
+    rt_uint64_t to_wrap;
+    HAL_StatusTypeDef status = HAL_OK;
+    uint32_t *in, *out;
+
+    if ((info->length % 16) != 0)
+    {
+        return -RT_EINVAL;
+    }
+
+    switch (symmetric_ctx->key_bitlen)
+    {
+    case 128:
+        conf.KeySize = CRYP_KEYSIZE_128B;
+        break;
+    case 192:
+        conf.KeySize = CRYP_KEYSIZE_192B;
+        break;
+    case 256:
+        conf.KeySize = CRYP_KEYSIZE_256B;
+        break;
+    default:
+        return -RT_EINVAL;
+    }
+
+    switch (type)
+    {
+    case HWCRYPTO_TYPE_AES_ECB:
+        conf.Algorithm = CRYP_AES_ECB;
+        break;
+    case HWCRYPTO_TYPE_AES_CBC:
+        conf.Algorithm = CRYP_AES_CBC;
+        break;
+    case HWCRYPTO_TYPE_AES_CTR:
+        conf.Algorithm = CRYP_AES_CTR;
+        break;
+    default:
+        return -RT_ERROR;
+    }
+    conf.DataType = CRYP_DATATYPE_8B;
+    conf.DataWidthUnit = CRYP_DATAWIDTHUNIT_BYTE;
+    conf.HeaderWidthUnit = CRYP_HEADERWIDTHUNIT_WORD;
+    conf.KeyIVConfigSkip = CRYP_KEYIVCONFIG_ALWAYS;
+    conf.KeyMode = CRYP_KEYMODE_NORMAL;
+    conf.pKey = cryp_key;
+    conf.pInitVect = cryp_iv;
+
+    rt_mutex_take(&crypto_dev.mutex, RT_WAITING_FOREVER);
+    if (cryp_init() != RT_EOK)
+    {
+        rt_mutex_release(&crypto_dev.mutex);
+        return -RT_ERROR;
+    }
+
+    cryp_load_be(cryp_key, symmetric_ctx->key, symmetric_ctx->key_bitlen / 32);
+    for (done = 0; done < info->length && status == HAL_OK; done += chunk)
+    {
+        chunk = info->length - done;
+        if (chunk > CRYP_CHUNK_MAX)
+        {
+            chunk = CRYP_CHUNK_MAX;
+        }
+        if (type == HWCRYPTO_TYPE_AES_CTR)
+        {
+            /* the peripheral only increments the low 32 bits of the counter */
+            to_wrap = 0x100000000ULL - (((rt_uint32_t)symmetric_ctx->iv[12] << 24) |
+                                        ((rt_uint32_t)symmetric_ctx->iv[13] << 16) |
+                                        ((rt_uint32_t)symmetric_ctx->iv[14] << 8) |
+                                        (rt_uint32_t)symmetric_ctx->iv[15]);
+            if ((rt_uint64_t)chunk / 16 > to_wrap)
+            {
+                chunk = (rt_size_t)to_wrap * 16;
+            }
+        }
+        if (type == HWCRYPTO_TYPE_AES_CBC && info->mode == HWCRYPTO_MODE_DECRYPT)
+        {
+            /* in and out may overlap, keep the last ciphertext block */
+            rt_memcpy(next_iv, info->in + done + chunk - 16, 16);
+        }
+
+        cryp_load_be(cryp_iv, symmetric_ctx->iv, 4);
+        in = (uint32_t *)(rt_ubase_t)(info->in + done);
+        out = (uint32_t *)(info->out + done);
+        status = HAL_CRYP_SetConfig(&cryp_handle, &conf);
+        if (status != HAL_OK)
+        {
+            break;
+        }
+        if (info->mode == HWCRYPTO_MODE_ENCRYPT)
+        {
+            status = HAL_CRYP_Encrypt(&cryp_handle, in, chunk, out, CRYPTO_TIMEOUT_MS);
+        }
+        else
+        {
+            status = HAL_CRYP_Decrypt(&cryp_handle, in, chunk, out, CRYPTO_TIMEOUT_MS);
+        }
+
+        if (type == HWCRYPTO_TYPE_AES_CBC)
+        {
+            if (info->mode == HWCRYPTO_MODE_ENCRYPT)
+            {
+                rt_memcpy(symmetric_ctx->iv, info->out + done + chunk - 16, 16);
+            }
+            else
+            {
+                rt_memcpy(symmetric_ctx->iv, next_iv, 16);
+            }
+        }
+        else if (type == HWCRYPTO_TYPE_AES_CTR)
+        {
+            cryp_ctr_add(symmetric_ctx->iv, chunk / 16);
+        }
+    }
+    rt_mutex_release(&crypto_dev.mutex);
+
+    return status == HAL_OK ? RT_EOK : -RT_ERROR;
+}
+
+static const struct hwcrypto_symmetric_ops cryp_ops =
+{
+    .crypt = _cryp_crypt,
+};
+#endif /* BSP_USING_CRYP */
+
+#if defined(BSP_USING_PKA)
+static PKA_HandleTypeDef pka_handle;
+static rt_bool_t pka_ready = RT_FALSE;
+
+static rt_err_t pka_init(void)
+{
+    if (pka_ready)
+    {
+        return RT_EOK;
+    }
+
+    /* the PKA RAM is only usable once the RNG is running */
+    if (stm32_rng_init() != RT_EOK)
+    {
+        return -RT_ERROR;
+    }
+    __HAL_RCC_PKA_CLK_ENABLE();
+    pka_handle.Instance = PKA;
+    if (HAL_PKA_Init(&pka_handle) != HAL_OK)
+    {
+        LOG_E("PKA init failed");
+        return -RT_ERROR;
+    }
+    pka_ready = RT_TRUE;
+
+    return RT_EOK;
+}
+
+/* hw_bignum_mpi limbs are little-endian bytes, PKA operands big-endian */
+static void bignum_to_be(rt_uint8_t *dst, const struct hw_bignum_mpi *n, rt_size_t len)
+{
+    rt_size_t i;
+
+    rt_memset(dst, 0, len);
+    for (i = 0; i < n->total && i < len; i++)
+    {
+        dst[len - 1 - i] = n->p[i];
+    }
+}
+
+static rt_err_t _bignum_exptmod(struct hwcrypto_bignum *bignum_ctx,
+                                struct hw_bignum_mpi *x,
+                                const struct hw_bignum_mpi *a,
+                                const struct hw_bignum_mpi *b,
+                                const struct hw_bignum_mpi *c)
+{
+    PKA_ModExpInTypeDef in;
+    rt_size_t op_len, exp_len, i;
+    rt_uint8_t *buf, *base, *mod, *exp, *res;
+    rt_err_t err = RT_EOK;
+
+    op_len = rt_hwcrypto_bignum_get_len(c);
+    exp_len = rt_hwcrypto_bignum_get_len(b);
+    if (op_len == 0 || exp_len == 0 || op_len > PKA_OPERAND_MAX || exp_len > PKA_OPERAND_MAX ||
+        (rt_size_t)rt_hwcrypto_bignum_get_len(a) > op_len)
+    {
+        return -RT_EINVAL;
+    }
+
+    buf = rt_malloc(op_len * 3 + exp_len);
+    if (buf == RT_NULL)
+    {
+        return -RT_ENOMEM;
+    }
+    base = buf;
+    mod = base + op_len;
+    res = mod + op_len;
+    exp = res + op_len;
+    bignum_to_be(base, a, op_len);
+    bignum_to_be(mod, c, op_len);
+    bignum_to_be(exp, b, exp_len);
+
+    in.OpSize = op_len;
+    in.expSize = exp_len;
+    in.pOp1 = base;
+    in.pMod = mod;
+    in.pExp = exp;
+
+    rt_mutex_take(&crypto_dev.mutex, RT_WAITING_FOREVER);
+    if (pka_init() != RT_EOK || HAL_PKA_ModExp(&pka_handle, &in, CRYPTO_TIMEOUT_MS) != HAL_OK)
+    {
+        err = -RT_ERROR;
+    }
+    else
+    {
+        HAL_PKA_ModExp_GetResult(&pka_handle, res);
+    }
+    rt_mutex_release(&crypto_dev.mutex);
+
+    if (err == RT_EOK && x->total < op_len)
+    {
+        rt_free(x->p);
+        x->p = rt_malloc(op_len);
+        x->total = (x->p != RT_NULL) ? op_len : 0;
+        if (x->p == RT_NULL)
+        {
+            err = -RT_ENOMEM;
+        }
+    }
+    if (err == RT_EOK)
+    {
+        rt_memset(x->p, 0, x->total);
+        for (i = 0; i < op_len; i++)
+        {
+            x->p[i] = res[op_len - 1 - i];
+        }
+        x->sign = 1;
+    }
+
+    rt_memset(buf, 0, op_len * 3 + exp_len);
+    rt_free(buf);
+
+    return err;
+}
+
+static const struct hwcrypto_bignum_ops bignum_ops =
+{
+    .add = RT_NULL,
+    .sub = RT_NULL,
+    .mul = RT_NULL,
+    .mulmod = RT_NULL,
+    .exptmod = _bignum_exptmod,
+};
+#endif /* BSP_USING_PKA */
+
+static rt_err_t _crypto_create(struct rt_hwcrypto_ctx *ctx)
+{
+    rt_err_t res = RT_EOK;
+
+    switch (ctx->type & HWCRYPTO_MAIN_TYPE_MASK)
+    {
+#if defined(BSP_USING_RNG)
+    case HWCRYPTO_TYPE_RNG:
+        ((struct hwcrypto_rng *)ctx)->ops = &rng_ops;
+        break;
+#endif /* BSP_USING_RNG */
+
+#if defined(BSP_USING_CRC)
+    case HWCRYPTO_TYPE_CRC:
+        ((struct hwcrypto_crc *)ctx)->ops = &crc_ops;
+        break;
+#endif /* BSP_USING_CRC */
+
+#if defined(BSP_USING_HASH)
+    case HWCRYPTO_TYPE_SHA1:
+    case HWCRYPTO_TYPE_SHA2:
+        ctx->contex = rt_calloc(1, sizeof(struct stm32_hash_ctx));
+        if (ctx->contex == RT_NULL)
+        {
+            res = -RT_ENOMEM;
+            break;
+        }
+        ((struct hwcrypto_hash *)ctx)->ops = &hash_ops;
+        break;
+#endif /* BSP_USING_HASH */
+
+#if defined(BSP_USING_CRYP)
+    case HWCRYPTO_TYPE_AES:
+        ((struct hwcrypto_symmetric *)ctx)->ops = &cryp_ops;
+        break;
+#endif /* BSP_USING_CRYP */
+
+#if defined(BSP_USING_PKA)
+    case HWCRYPTO_TYPE_BIGNUM:
+        ((struct hwcrypto_bignum *)ctx)->ops = &bignum_ops;
+        break;
+#endif /* BSP_USING_PKA */
+
+    default:
+        res = -RT_ERROR;
+        break;
+    }
+
+    return res;
+}
+
+static void _crypto_destroy(struct rt_hwcrypto_ctx *ctx)
+{
+    switch (ctx->type & HWCRYPTO_MAIN_TYPE_MASK)
+    {
+#if defined(BSP_USING_HASH)
+    case HWCRYPTO_TYPE_SHA1:
+    case HWCRYPTO_TYPE_SHA2:
+        rt_mutex_take(&crypto_dev.mutex, RT_WAITING_FOREVER);
+        if (hash_owner == ctx->contex)
+        {
+            hash_owner = RT_NULL;
+        }
+        rt_mutex_release(&crypto_dev.mutex);
+        rt_free(ctx->contex);
+        ctx->contex = RT_NULL;
+        break;
+#endif /* BSP_USING_HASH */
+
+    default:
+        break;
+    }
+}
+
+static rt_err_t _crypto_clone(struct rt_hwcrypto_ctx *des, const struct rt_hwcrypto_ctx *src)
+{
+    rt_err_t res = RT_EOK;
+
+    switch (src->type & HWCRYPTO_MAIN_TYPE_MASK)
+    {
+#if defined(BSP_USING_HASH)
+    case HWCRYPTO_TYPE_SHA1:
+    case HWCRYPTO_TYPE_SHA2:
+    {
+        struct stm32_hash_ctx *hash_src = (struct stm32_hash_ctx *)src->contex;
+
+        if (des->contex == RT_NULL || hash_src == RT_NULL)
+        {
+            res = -RT_EINVAL;
+            break;
+        }
+        rt_mutex_take(&crypto_dev.mutex, RT_WAITING_FOREVER);
+        /* a live digest is only in the unit, snapshot it first */
+        if (hash_owner == hash_src && hash_src->started)
+        {
+            HAL_HASH_Suspend(&hash_src->hhash, (uint8_t *)hash_src->context);
+        }
+        rt_memcpy(des->contex, hash_src, sizeof(struct stm32_hash_ctx));
+        rt_mutex_release(&crypto_dev.mutex);
+        break;
+    }
+#endif /* BSP_USING_HASH */
+
+    default:
+        break;
+    }
+
+    return res;
+}
+
+static void _crypto_reset(struct rt_hwcrypto_ctx *ctx)
+{
+    switch (ctx->type & HWCRYPTO_MAIN_TYPE_MASK)
+    {
+#if defined(BSP_USING_HASH)
+    case HWCRYPTO_TYPE_SHA1:
+    case HWCRYPTO_TYPE_SHA2:
+    {
+        struct stm32_hash_ctx *hash = (struct stm32_hash_ctx *)ctx->contex;
+
+        rt_mutex_take(&crypto_dev.mutex, RT_WAITING_FOREVER);
+        if (hash_owner == hash)
+        {
+            hash_owner = RT_NULL;
+        }
+        hash->started = 0;
+        hash->tail_len = 0;
+        rt_mutex_release(&crypto_dev.mutex);
+        break;
+    }
+#endif /* BSP_USING_HASH */
+
+    default:
+        break;
+    }
+}
+
+static const struct rt_hwcrypto_ops _ops =
+{
+    .create = _crypto_create,
+    .destroy = _crypto_destroy,
+    .copy = _crypto_clone,
+    .reset = _crypto_reset,
+};
+
+int stm32_hw_crypto_device_init(void)
+{
+    rt_err_t result;
+
+#if defined(BSP_USING_CRC)
+    __HAL_RCC_CRC_CLK_ENABLE();
+#endif
+#if defined(BSP_USING_HASH)
+    __HAL_RCC_HASH_CLK_ENABLE();
+#endif
+#if defined(BSP_USING_CRYP)
+    __HAL_RCC_CRYP_CLK_ENABLE();
+#endif
+
+    crypto_dev.dev.ops = &_ops;
+    crypto_dev.dev.id = ((rt_uint64_t)HAL_GetUIDw1() << 32) | HAL_GetUIDw0();
+    crypto_dev.dev.user_data = &crypto_dev;
+
+    result = rt_hwcrypto_register(&crypto_dev.dev, RT_HWCRYPTO_DEFAULT_NAME);
+    if (result != RT_EOK)
+    {
+        LOG_E("hwcrypto register failed");
+        return result;
+    }
+    rt_mutex_init(&crypto_dev.mutex, RT_HWCRYPTO_DEFAULT_NAME, RT_IPC_FLAG_PRIO);
+
+    return RT_EOK;
+}
+INIT_DEVICE_EXPORT(stm32_hw_crypto_device_init);
+
+#if defined(RT_USING_FINSH) && (defined(BSP_USING_CRYP) || defined(BSP_USING_HASH))
+#include <finsh.h>
+
+/* raw peripheral throughput, to compare with the mbedTLS software numbers */
+static void crypto_bench(int argc, char **argv)
+{
+    rt_size_t len = 4096;
+    int loops = 64, i;
+    rt_uint8_t *buf;
+    rt_tick_t start, ms;
+
+    if (argc > 1)
+    {
+        loops = atoi(argv[1]);
+        if (loops <= 0)
+        {
+            loops = 64;
+        }
+    }
+    buf = rt_malloc(len);
+    if (buf == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        return;
+    }
+    rt_memset(buf, 0x5a, len);
+
+#if defined(BSP_USING_CRYP)
+    {
+        static const rt_uint8_t key[16] = {0};
+        rt_uint8_t iv[16] = {0};
+        struct rt_hwcrypto_ctx *aes;
+
+        aes = rt_hwcrypto_symmetric_create(rt_hwcrypto_dev_default(), HWCRYPTO_TYPE_AES_CBC);
+        if (aes)
+        {
+            rt_hwcrypto_symmetric_setkey(aes, key, 128);
+            rt_hwcrypto_symmetric_setiv(aes, iv, sizeof(iv));
+            start = rt_tick_get();
+            for (i = 0; i < loops; i++)
+            {
+                rt_hwcrypto_symmetric_crypt(aes, HWCRYPTO_MODE_ENCRYPT, len, buf, buf);
+            }
+            ms = (rt_tick_get() - start) * 1000 / RT_TICK_PER_SECOND;
+            rt_kprintf("aes-128-cbc: %d KB in %d ms\n", (int)(len * loops / 1024), (int)ms);
+            rt_hwcrypto_symmetric_destroy(aes);
+        }
+    }
+#endif /* BSP_USING_CRYP */
+
+#if defined(BSP_USING_HASH)
+    {
+        rt_uint8_t digest[32];
+        struct rt_hwcrypto_ctx *sha;
+
+        sha = rt_hwcrypto_hash_create(rt_hwcrypto_dev_default(), HWCRYPTO_TYPE_SHA256);
+        if (sha)
+        {
+            start = rt_tick_get();
+            for (i = 0; i < loops; i++)
+            {
+                rt_hwcrypto_hash_update(sha, buf, len);
+            }
+            rt_hwcrypto_hash_finish(sha, digest, sizeof(digest));
+            ms = (rt_tick_get() - start) * 1000 / RT_TICK_PER_SECOND;
+            rt_kprintf("sha256     : %d KB in %d ms\n", (int)(len * loops / 1024), (int)ms);
+            rt_hwcrypto_hash_destroy(sha);
+        }
+    }
+#endif /* BSP_USING_HASH */
+
+    rt_free(buf);
+}
+MSH_CMD_EXPORT(crypto_bench, hardware crypto throughput: crypto_bench [loops]);
+#endif /* RT_USING_FINSH */
+
+#endif /* BSP_USING_HWCRYPTO */
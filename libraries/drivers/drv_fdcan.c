@@ -7,11 +7,13 @@
  * Date           Author       Notes
  * 2020-02-24     heyuan       the first version
  * 2020-08-17     malongwei    Fix something
+ * 2025-02-28     RT-Thread    port to the H7RS message RAM, TX FIFO, timestamps, bench
  */
 
 #include "board.h"
 #include <rtthread.h>
 #include <rtdevice.h>
+#include <stdlib.h>
 
 #ifdef RT_USING_CAN
 
@@ -23,10 +25,21 @@
 #define LOG_TAG    "drv_can"
 #include <drv_log.h>
 
+/*
+ * Both interrupt lines run HAL_FDCAN_IRQHandler(), which serves every pending
+ * source whatever its line, so they must not preempt each other: the receive
+ * path is the single producer of the framework's frame ring.
+ */
+#define FDCAN_IRQ_PRIORITY      0
+
+#define FDCAN_TX_ELEMENTS_ALL   (FDCAN_TX_BUFFER0 | FDCAN_TX_BUFFER1 | FDCAN_TX_BUFFER2)
+
 #ifdef BSP_USING_FDCAN1
 static _stm32_fdcan_t st_DrvCan1=
 {
     .name = "fdcan1",
+    .tx_pin = BSP_FDCAN1_TX_PIN,
+    .rx_pin = BSP_FDCAN1_RX_PIN,
     .fdcanHandle.Instance = FDCAN1,
 };
 #endif
@@ -35,67 +48,125 @@ static _stm32_fdcan_t st_DrvCan1=
 static _stm32_fdcan_t st_DrvCan2=
 {
     .name = "fdcan2",
+    .tx_pin = BSP_FDCAN2_TX_PIN,
+    .rx_pin = BSP_FDCAN2_RX_PIN,
     .fdcanHandle.Instance = FDCAN2,
 };
 #endif
 
-
-static const _stm32_fdcan_NTconfig_t st_CanNTconfig[]=
-/*baud brp sjw tseg1 tseg2*/
+struct _fdcan_timing_limits
 {
-    {CAN1MBaud,     10,8,15,4},
-    {CAN800kBaud,   10,8,20,4},
-    {CAN500kBaud,   20,8,15,4},
-    {CAN250kBaud,   20,8,35,4},
-    {CAN125kBaud,   40,8,35,4},
-    {CAN100kBaud,   40,8,44,5},
-    {CAN50kBaud,    80,8,44,5},
-    {CAN20kBaud,    200,8,44,5},
-    {CAN10kBaud,    400,8,44,5}
+    rt_uint16_t brp;
+    rt_uint16_t seg1;
+    rt_uint16_t seg2;
+    rt_uint16_t sjw;
 };
 
+static const struct _fdcan_timing_limits st_CanNominalLimits = {512, 256, 128, 128};
+#ifdef RT_CAN_USING_CANFD
+static const struct _fdcan_timing_limits st_CanDataLimits = {32, 32, 16, 16};
+#endif
+
+static _stm32_fdcan_t *_inline_can_from_handle(FDCAN_HandleTypeDef *hfdcan)
+{
+    return rt_container_of(hfdcan, _stm32_fdcan_t, fdcanHandle);
+}
+
 /*
-*function name:_inline_get_NTbaud_index
-*Inf: get can normal transmit baud rate config index
+*function name:_inline_can_bit_timing
+*Inf: split a bit of baud_rate into time quanta of the kernel clock
 *
+*#param clock:kernel clock in Hz
 *#param baud_rate:decimalism numeral
+*#param sample_point:percent of the bit
 *
-*#return config index
+*#return RT_EOK, or -RT_ERROR when the clock does not divide into the rate
 */
-static uint32_t _inline_get_NTbaud_index(uint32_t baud_rate)
+static rt_err_t _inline_can_bit_timing(rt_uint32_t clock, rt_uint32_t baud_rate, rt_uint32_t sample_point,
+                                       const struct _fdcan_timing_limits *limits, struct rt_can_bit_timing *timing)
 {
-    uint32_t len, index;
+    rt_uint32_t brp, tq, seg1, seg2;
 
-    len = sizeof(st_CanNTconfig) / sizeof(st_CanNTconfig[0]);
+    if (baud_rate == 0)
+    {
+        return -RT_ERROR;
+    }
 
-    for (index = 0; index < len; index++)
+    /* the smallest prescaler gives the most quanta, the finest sample point */
+    for (brp = 1; brp <= limits->brp; brp++)
     {
-        if (st_CanNTconfig[index].u32NBaudrate == baud_rate)
+        if (clock % (baud_rate * brp) != 0)
+        {
+            continue;
+        }
+        tq = clock / (baud_rate * brp);
+        if (tq < 4)
+        {
+            break;
+        }
+        seg1 = tq * sample_point / 100 - 1;
+        seg2 = tq - 1 - seg1;
+        if (seg1 > limits->seg1 || seg2 > limits->seg2)
+        {
+            continue;
+        }
 
-        return index;
+        timing->prescaler = brp;
+        timing->num_seg1 = seg1;
+        timing->num_seg2 = seg2;
+        timing->num_sjw = seg2 < limits->sjw ? seg2 : limits->sjw;
+        timing->num_sspoff = 0;
+        return RT_EOK;
     }
 
-    return 0;
+    return -RT_ERROR;
+}
+
+static rt_uint32_t _inline_can_clock(void)
+{
+    RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
+
+    /* HSE: the bit rates come out exact, whatever the PLLs are set to */
+    PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_FDCAN;
+    PeriphClkInit.FdcanClockSelection = RCC_FDCANCLKSOURCE_HSE;
+    HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit);
+
+    return HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN);
+}
+
+/*
+ * The timestamp counter is 16 bits of nominal bit times. Every look at it,
+ * and at least one per wrap (the wrap-around interrupt), carries it into 32
+ * bits. Runs on the receive interrupt only.
+ */
+static rt_uint32_t _inline_can_timestamp_now(_stm32_fdcan_t *pdrv_can)
+{
+    rt_uint16_t now = HAL_FDCAN_GetTimestampCounter(&pdrv_can->fdcanHandle);
+
+    pdrv_can->u32TsNow += (rt_uint16_t)(now - pdrv_can->u16TsLast);
+    pdrv_can->u16TsLast = now;
+    return pdrv_can->u32TsNow;
 }
 
-static void _inline_can_tx_header_init(_stm32_fdcan_t *pCan)
+#ifdef RT_CAN_USING_TIMESTAMP
+static rt_uint32_t _inline_can_timestamp(_stm32_fdcan_t *pdrv_can, rt_uint16_t stamp)
 {
-      /* Prepare Tx Header */
-      pCan->TxHeader.Identifier = 0x000000;
-      pCan->TxHeader.IdType = FDCAN_EXTENDED_ID;
-      pCan->TxHeader.TxFrameType = FDCAN_DATA_FRAME;
-      pCan->TxHeader.DataLength = FDCAN_DLC_BYTES_8;
-      pCan->TxHeader.ErrorStateIndicator = FDCAN_ESI_ACTIVE;
-      pCan->TxHeader.BitRateSwitch = FDCAN_BRS_OFF;
-      pCan->TxHeader.FDFormat = FDCAN_CLASSIC_CAN;
-      pCan->TxHeader.TxEventFifoControl = FDCAN_NO_TX_EVENTS;
-      pCan->TxHeader.MessageMarker = 0;
+    rt_uint32_t now = _inline_can_timestamp_now(pdrv_can);
+
+    /* the frame started less than one wrap ago */
+    return now - (rt_uint16_t)((rt_uint16_t)now - stamp);
 }
+#endif
 
 static rt_err_t _inline_can_config(struct rt_can_device *can, struct can_configure *cfg)
 {
     _stm32_fdcan_t *pdrv_can;
-    rt_uint32_t tmp_u32Index;
+    FDCAN_HandleTypeDef *hfdcan;
+    struct rt_can_bit_timing nominal;
+    rt_uint32_t clock;
+#ifdef RT_CAN_USING_CANFD
+    struct rt_can_bit_timing data;
+#endif
 
     RT_ASSERT(can);
     RT_ASSERT(cfg);
@@ -103,67 +174,109 @@ static rt_err_t _inline_can_config(struct rt_can_device *can, struct can_configu
     pdrv_can = (_stm32_fdcan_t *)can->parent.user_data;
 
     RT_ASSERT(pdrv_can);
+    hfdcan = &pdrv_can->fdcanHandle;
+
+    clock = _inline_can_clock();
+#ifdef RT_CAN_USING_CANFD
+    if (cfg->use_bit_timing)
+    {
+        nominal = cfg->can_timing;
+        data = cfg->canfd_timing;
+    }
+    else
+#endif
+    {
+        if (_inline_can_bit_timing(clock, cfg->baud_rate, 80, &st_CanNominalLimits, &nominal) != RT_EOK)
+        {
+            LOG_E("%s: %d bit/s does not divide from %d Hz", pdrv_can->name, cfg->baud_rate, clock);
+            return -RT_ERROR;
+        }
+#ifdef RT_CAN_USING_CANFD
+        if (cfg->enable_canfd &&
+            _inline_can_bit_timing(clock, cfg->baud_rate_fd, 75, &st_CanDataLimits, &data) != RT_EOK)
+        {
+            LOG_E("%s: %d bit/s does not divide from %d Hz", pdrv_can->name, cfg->baud_rate_fd, clock);
+            return -RT_ERROR;
+        }
+#endif
+    }
 
-    pdrv_can->fdcanHandle.Init.FrameFormat = FDCAN_FRAME_CLASSIC;
-    pdrv_can->fdcanHandle.Init.Mode = FDCAN_MODE_NORMAL;
-    pdrv_can->fdcanHandle.Init.AutoRetransmission = DISABLE;
-    pdrv_can->fdcanHandle.Init.TransmitPause = DISABLE;
-    pdrv_can->fdcanHandle.Init.ProtocolException = DISABLE;
+    hfdcan->Init.ClockDivider = FDCAN_CLOCK_DIV1;
+    hfdcan->Init.FrameFormat = FDCAN_FRAME_CLASSIC;
+    hfdcan->Init.Mode = FDCAN_MODE_NORMAL;
+    hfdcan->Init.AutoRetransmission = DISABLE;
+    hfdcan->Init.TransmitPause = DISABLE;
+    hfdcan->Init.ProtocolException = DISABLE;
 
     switch (cfg->mode)
     {
     case RT_CAN_MODE_NORMAL:
-        pdrv_can->fdcanHandle.Init.Mode = FDCAN_MODE_NORMAL;
+        hfdcan->Init.Mode = FDCAN_MODE_NORMAL;
         break;
-    case RT_CAN_MODE_LISEN:
-        pdrv_can->fdcanHandle.Init.Mode = FDCAN_MODE_BUS_MONITORING;
+    case RT_CAN_MODE_LISTEN:
+        hfdcan->Init.Mode = FDCAN_MODE_BUS_MONITORING;
         break;
     case RT_CAN_MODE_LOOPBACK:
-        pdrv_can->fdcanHandle.Init.Mode = FDCAN_MODE_INTERNAL_LOOPBACK;
+        /* the frames go out on the bus as well */
+        hfdcan->Init.Mode = FDCAN_MODE_EXTERNAL_LOOPBACK;
+        break;
+    case RT_CAN_MODE_LOOPBACKANLISTEN:
+        hfdcan->Init.Mode = FDCAN_MODE_INTERNAL_LOOPBACK;
         break;
     default:
-        pdrv_can->fdcanHandle.Init.Mode = FDCAN_MODE_NORMAL;
+        hfdcan->Init.Mode = FDCAN_MODE_NORMAL;
         break;
     }
 
-    /*config baud rate*/
-    tmp_u32Index = _inline_get_NTbaud_index(cfg->baud_rate);
-
-    pdrv_can->fdcanHandle.Init.NominalPrescaler = st_CanNTconfig[tmp_u32Index].u16Nbrp;
-    pdrv_can->fdcanHandle.Init.NominalSyncJumpWidth = st_CanNTconfig[tmp_u32Index].u8Nsjw;
-    pdrv_can->fdcanHandle.Init.NominalTimeSeg1 = st_CanNTconfig[tmp_u32Index].u8Ntseg1;
-    pdrv_can->fdcanHandle.Init.NominalTimeSeg2 = st_CanNTconfig[tmp_u32Index].u8Ntseg2;
+    hfdcan->Init.NominalPrescaler = nominal.prescaler;
+    hfdcan->Init.NominalSyncJumpWidth = nominal.num_sjw;
+    hfdcan->Init.NominalTimeSeg1 = nominal.num_seg1;
+    hfdcan->Init.NominalTimeSeg2 = nominal.num_seg2;
+    hfdcan->Init.DataPrescaler = 1;
+    hfdcan->Init.DataSyncJumpWidth = 1;
+    hfdcan->Init.DataTimeSeg1 = 1;
+    hfdcan->Init.DataTimeSeg2 = 1;
+#ifdef RT_CAN_USING_CANFD
+    if (cfg->enable_canfd)
+    {
+        hfdcan->Init.FrameFormat = FDCAN_FRAME_FD_BRS;
+        hfdcan->Init.DataPrescaler = data.prescaler;
+        hfdcan->Init.DataSyncJumpWidth = data.num_sjw;
+        hfdcan->Init.DataTimeSeg1 = data.num_seg1;
+        hfdcan->Init.DataTimeSeg2 = data.num_seg2;
+    }
+#endif
 
+    hfdcan->Init.StdFiltersNbr = 2;
+    hfdcan->Init.ExtFiltersNbr = 2;
+    /* priority mode sends by identifier, the other one in write order */
+    hfdcan->Init.TxFifoQueueMode = cfg->privmode ? FDCAN_TX_QUEUE_OPERATION : FDCAN_TX_FIFO_OPERATION;
 
-    if(pdrv_can->fdcanHandle.Instance == FDCAN1)
+    if (HAL_FDCAN_GetState(hfdcan) == HAL_FDCAN_STATE_BUSY)
     {
-        pdrv_can->fdcanHandle.Init.MessageRAMOffset = 0;
+        HAL_FDCAN_Stop(hfdcan);
     }
-    else
+    if (HAL_FDCAN_Init(hfdcan) != HAL_OK)
     {
-        pdrv_can->fdcanHandle.Init.MessageRAMOffset = 1280;
+        return -RT_ERROR;
     }
-    pdrv_can->fdcanHandle.Init.StdFiltersNbr = 2;
-    pdrv_can->fdcanHandle.Init.ExtFiltersNbr = 2;
-    pdrv_can->fdcanHandle.Init.RxFifo0ElmtsNbr = 1;
-    pdrv_can->fdcanHandle.Init.RxFifo0ElmtSize = FDCAN_DATA_BYTES_8;
-    pdrv_can->fdcanHandle.Init.RxBuffersNbr = 0;
-    pdrv_can->fdcanHandle.Init.TxEventsNbr = 0;
-    pdrv_can->fdcanHandle.Init.TxBuffersNbr = 3;
-    pdrv_can->fdcanHandle.Init.TxFifoQueueElmtsNbr = 0;
-    pdrv_can->fdcanHandle.Init.TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;
-    pdrv_can->fdcanHandle.Init.TxElmtSize = FDCAN_DATA_BYTES_8;
-
-    if (HAL_FDCAN_Init(&pdrv_can->fdcanHandle) != HAL_OK)
+#ifdef RT_CAN_USING_CANFD
+    if (cfg->enable_canfd)
     {
-        return -RT_ERROR;
+        /* at a fast data phase the transceiver loop delay exceeds the sample point */
+        HAL_FDCAN_ConfigTxDelayCompensation(hfdcan, data.num_sspoff ? data.num_sspoff :
+                                            data.prescaler * (data.num_seg1 + 1), 0);
+        HAL_FDCAN_EnableTxDelayCompensation(hfdcan);
     }
+#endif
+    /* RX timestamps count nominal bit times */
+    HAL_FDCAN_ConfigTimestampCounter(hfdcan, FDCAN_TIMESTAMP_PRESC_1);
+    HAL_FDCAN_EnableTimestampCounter(hfdcan, FDCAN_TIMESTAMP_INTERNAL);
+    pdrv_can->u16TsLast = HAL_FDCAN_GetTimestampCounter(hfdcan);
     /* default filter config */
-    HAL_FDCAN_ConfigFilter(&pdrv_can->fdcanHandle , &pdrv_can->FilterConfig);
-    /*init fdcan tx header*/
-    _inline_can_tx_header_init(pdrv_can);
+    HAL_FDCAN_ConfigFilter(hfdcan, &pdrv_can->FilterConfig);
     /* can start */
-    HAL_FDCAN_Start(&pdrv_can->fdcanHandle);
+    HAL_FDCAN_Start(hfdcan);
     return RT_EOK;
 }
 
@@ -175,10 +288,12 @@ static rt_err_t _inline_can_filter_config(_stm32_fdcan_t *pdrv_can,struct rt_can
      /* get default filter */
     for (tmp_i32IndexCount = 0; tmp_i32IndexCount < puser_can_filter_config->count; tmp_i32IndexCount++)
     {
-        pdrv_can->FilterConfig.FilterIndex = puser_can_filter_config->items[tmp_i32IndexCount].hdr;
-        pdrv_can->FilterConfig.FilterID1 = puser_can_filter_config->items[tmp_i32IndexCount].id;
-        pdrv_can->FilterConfig.FilterID2 = puser_can_filter_config->items[tmp_i32IndexCount].mask;
-        if(puser_can_filter_config->items[tmp_i32IndexCount].ide == RT_CAN_EXTID)
+        struct rt_can_filter_item *item = &puser_can_filter_config->items[tmp_i32IndexCount];
+
+        pdrv_can->FilterConfig.FilterIndex = item->hdr_bank >= 0 ? item->hdr_bank : tmp_i32IndexCount;
+        pdrv_can->FilterConfig.FilterID1 = item->id;
+        pdrv_can->FilterConfig.FilterID2 = item->mask;
+        if(item->ide == RT_CAN_EXTID)
         {
             pdrv_can->FilterConfig.IdType = FDCAN_EXTENDED_ID;
         }
@@ -187,7 +302,8 @@ static rt_err_t _inline_can_filter_config(_stm32_fdcan_t *pdrv_can,struct rt_can
             pdrv_can->FilterConfig.IdType = FDCAN_STANDARD_ID;
         }
         pdrv_can->FilterConfig.FilterType = FDCAN_FILTER_MASK;
-        pdrv_can->FilterConfig.FilterConfig = FDCAN_FILTER_TO_RXFIFO0;
+        pdrv_can->FilterConfig.FilterConfig = item->rxfifo == CAN_RX_FIFO1 ?
+                                              FDCAN_FILTER_TO_RXFIFO1 : FDCAN_FILTER_TO_RXFIFO0;
         if(HAL_FDCAN_ConfigFilter(&pdrv_can->fdcanHandle , &pdrv_can->FilterConfig) != HAL_OK)
         {
             return -RT_ERROR;
@@ -196,12 +312,33 @@ static rt_err_t _inline_can_filter_config(_stm32_fdcan_t *pdrv_can,struct rt_can
     return RT_EOK;
 }
 
+static void _inline_can_enable_irq(_stm32_fdcan_t *pdrv_can, IRQn_Type it0, IRQn_Type it1, rt_uint32_t line)
+{
+    IRQn_Type irq = line == FDCAN_INTERRUPT_LINE0 ? it0 : it1;
+
+    HAL_NVIC_SetPriority(irq, FDCAN_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(irq);
+}
+
+static void _inline_can_irq(_stm32_fdcan_t *pdrv_can, rt_uint32_t line)
+{
+    if(FDCAN1 == pdrv_can->fdcanHandle.Instance)
+    {
+        _inline_can_enable_irq(pdrv_can, FDCAN1_IT0_IRQn, FDCAN1_IT1_IRQn, line);
+    }
+    else
+    {
+        _inline_can_enable_irq(pdrv_can, FDCAN2_IT0_IRQn, FDCAN2_IT1_IRQn, line);
+    }
+}
+
 static rt_err_t _inline_can_control(struct rt_can_device *can, int cmd, void *arg)
 {
 
     rt_uint32_t argval;
     _stm32_fdcan_t *pdrv_can;
     struct rt_can_filter_config *filter_cfg;
+    struct rt_can_bit_timing timing;
 
     RT_ASSERT(can != RT_NULL);
     pdrv_can = (_stm32_fdcan_t *)can->parent.user_data;
@@ -214,12 +351,14 @@ static rt_err_t _inline_can_control(struct rt_can_device *can, int cmd, void *ar
         argval = (rt_uint32_t) arg;
         if (argval == RT_DEVICE_FLAG_INT_RX)
         {
-            HAL_FDCAN_DeactivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_RX_FIFO0_NEW_MESSAGE);
+            HAL_FDCAN_DeactivateNotification(&pdrv_can->fdcanHandle,
+                                             FDCAN_IT_RX_FIFO0_NEW_MESSAGE | FDCAN_IT_RX_FIFO0_MESSAGE_LOST |
+                                             FDCAN_IT_RX_FIFO1_NEW_MESSAGE | FDCAN_IT_RX_FIFO1_MESSAGE_LOST |
+                                             FDCAN_IT_TIMESTAMP_WRAPAROUND);
         }
         else if (argval == RT_DEVICE_FLAG_INT_TX)
         {
-            HAL_FDCAN_DeactivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_TX_FIFO_EMPTY);
-            HAL_FDCAN_DeactivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_TX_COMPLETE);
+            HAL_FDCAN_DeactivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_TX_COMPLETE | FDCAN_IT_TX_ABORT_COMPLETE);
         }
         else if (argval == RT_DEVICE_CAN_INT_ERR)
         {
@@ -234,60 +373,34 @@ static rt_err_t _inline_can_control(struct rt_can_device *can, int cmd, void *ar
         argval = (rt_uint32_t) arg;
         if (argval == RT_DEVICE_FLAG_INT_RX)
         {
-            HAL_FDCAN_ConfigInterruptLines(&pdrv_can->fdcanHandle, FDCAN_IT_RX_FIFO0_NEW_MESSAGE, FDCAN_INTERRUPT_LINE0);
-            HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_RX_FIFO0_NEW_MESSAGE, 0);
-
-            if(FDCAN1 == pdrv_can->fdcanHandle.Instance)
-            {
-                HAL_NVIC_SetPriority(FDCAN1_IT0_IRQn, 0, 1);
-                HAL_NVIC_EnableIRQ(FDCAN1_IT0_IRQn);
-            }
-            else
-            {
-                HAL_NVIC_SetPriority(FDCAN2_IT0_IRQn, 0, 1);
-                HAL_NVIC_EnableIRQ(FDCAN2_IT0_IRQn);
-            }
-
+            /* one interrupt empties the FIFO, a lost message is reported with it */
+            HAL_FDCAN_ConfigInterruptLines(&pdrv_can->fdcanHandle,
+                                           FDCAN_IT_LIST_RX_FIFO0 | FDCAN_IT_LIST_RX_FIFO1 | FDCAN_IT_LIST_MISC,
+                                           FDCAN_INTERRUPT_LINE0);
+            HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle,
+                                           FDCAN_IT_RX_FIFO0_NEW_MESSAGE | FDCAN_IT_RX_FIFO0_MESSAGE_LOST |
+                                           FDCAN_IT_RX_FIFO1_NEW_MESSAGE | FDCAN_IT_RX_FIFO1_MESSAGE_LOST |
+                                           FDCAN_IT_TIMESTAMP_WRAPAROUND, 0);
+            _inline_can_irq(pdrv_can, FDCAN_INTERRUPT_LINE0);
         }
         else if (argval == RT_DEVICE_FLAG_INT_TX)
         {
-            HAL_FDCAN_ConfigInterruptLines(&pdrv_can->fdcanHandle, FDCAN_IT_TX_COMPLETE, FDCAN_INTERRUPT_LINE1);
-            HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_TX_COMPLETE, FDCAN_TX_BUFFER0);
-            HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_TX_COMPLETE, FDCAN_TX_BUFFER1);
-            HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_TX_COMPLETE, FDCAN_TX_BUFFER2);
-
-            if(FDCAN1 == pdrv_can->fdcanHandle.Instance)
-            {
-                HAL_NVIC_SetPriority(FDCAN1_IT1_IRQn, 0, 2);
-                HAL_NVIC_EnableIRQ(FDCAN1_IT1_IRQn);
-            }
-            else
-            {
-                HAL_NVIC_SetPriority(FDCAN2_IT1_IRQn, 0, 2);
-                HAL_NVIC_EnableIRQ(FDCAN2_IT1_IRQn);
-            }
+            HAL_FDCAN_ConfigInterruptLines(&pdrv_can->fdcanHandle, FDCAN_IT_LIST_SMSG, FDCAN_INTERRUPT_LINE1);
+            HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle, FDCAN_IT_TX_COMPLETE | FDCAN_IT_TX_ABORT_COMPLETE,
+                                           FDCAN_TX_ELEMENTS_ALL);
+            _inline_can_irq(pdrv_can, FDCAN_INTERRUPT_LINE1);
         }
         else if (argval == RT_DEVICE_CAN_INT_ERR)
         {
-            HAL_FDCAN_ConfigInterruptLines(&pdrv_can->fdcanHandle, FDCAN_IT_BUS_OFF, FDCAN_INTERRUPT_LINE1);
-            HAL_FDCAN_ConfigInterruptLines(&pdrv_can->fdcanHandle, FDCAN_IT_ERROR_WARNING, FDCAN_INTERRUPT_LINE1);
-            HAL_FDCAN_ConfigInterruptLines(&pdrv_can->fdcanHandle, FDCAN_IT_ERROR_PASSIVE, FDCAN_INTERRUPT_LINE1);
-            HAL_FDCAN_ConfigInterruptLines(&pdrv_can->fdcanHandle, FDCAN_IT_ARB_PROTOCOL_ERROR, FDCAN_INTERRUPT_LINE1);
+            HAL_FDCAN_ConfigInterruptLines(&pdrv_can->fdcanHandle,
+                                           FDCAN_IT_LIST_BIT_LINE_ERROR | FDCAN_IT_LIST_PROTOCOL_ERROR,
+                                           FDCAN_INTERRUPT_LINE1);
 
             HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_BUS_OFF, 0);
             HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_ERROR_WARNING, 0);
             HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_ERROR_PASSIVE, 0);
             HAL_FDCAN_ActivateNotification(&pdrv_can->fdcanHandle,  FDCAN_IT_ARB_PROTOCOL_ERROR, 0);
-            if(FDCAN1 == pdrv_can->fdcanHandle.Instance)
-            {
-                HAL_NVIC_SetPriority(FDCAN1_IT1_IRQn, 0, 2);
-                HAL_NVIC_EnableIRQ(FDCAN1_IT1_IRQn);
-            }
-            else
-            {
-                HAL_NVIC_SetPriority(FDCAN2_IT1_IRQn, 0, 2);
-                HAL_NVIC_EnableIRQ(FDCAN2_IT1_IRQn);
-            }
+            _inline_can_irq(pdrv_can, FDCAN_INTERRUPT_LINE1);
         }
         break;
     case RT_CAN_CMD_SET_FILTER:
@@ -299,15 +412,15 @@ static rt_err_t _inline_can_control(struct rt_can_device *can, int cmd, void *ar
         else
         {
             filter_cfg = (struct rt_can_filter_config *)arg;
-            _inline_can_filter_config(pdrv_can, filter_cfg);
+            return _inline_can_filter_config(pdrv_can, filter_cfg);
         }
         break;
     case RT_CAN_CMD_SET_MODE:
         argval = (rt_uint32_t) arg;
         if (argval != RT_CAN_MODE_NORMAL &&
-            argval != RT_CAN_MODE_LISEN &&
+            argval != RT_CAN_MODE_LISTEN &&
             argval != RT_CAN_MODE_LOOPBACK &&
-            argval != RT_CAN_MODE_LOOPBACKANLISEN)
+            argval != RT_CAN_MODE_LOOPBACKANLISTEN)
         {
             return -RT_ERROR;
         }
@@ -319,16 +432,8 @@ static rt_err_t _inline_can_control(struct rt_can_device *can, int cmd, void *ar
         break;
     case RT_CAN_CMD_SET_BAUD:
         argval = (rt_uint32_t ) arg;
-        /*just low to 50kbit/s*/
-        if (argval != CAN1MBaud &&
-            argval != CAN800kBaud &&
-            argval != CAN500kBaud &&
-            argval != CAN250kBaud &&
-            argval != CAN125kBaud &&
-            argval != CAN100kBaud &&
-            argval != CAN50kBaud  &&
-            argval != CAN20kBaud  &&
-            argval != CAN10kBaud)
+        if (_inline_can_bit_timing(HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN), argval, 80,
+                                   &st_CanNominalLimits, &timing) != RT_EOK)
         {
             return -RT_ERROR;
         }
@@ -338,6 +443,45 @@ static rt_err_t _inline_can_control(struct rt_can_device *can, int cmd, void *ar
             return _inline_can_config(&pdrv_can->device, &pdrv_can->device.config);
         }
         break;
+#ifdef RT_CAN_USING_CANFD
+    case RT_CAN_CMD_SET_CANFD:
+        argval = (rt_uint32_t) arg;
+        if (argval != pdrv_can->device.config.enable_canfd)
+        {
+            pdrv_can->device.config.enable_canfd = argval;
+            return _inline_can_config(&pdrv_can->device, &pdrv_can->device.config);
+        }
+        break;
+    case RT_CAN_CMD_SET_BAUD_FD:
+        argval = (rt_uint32_t) arg;
+        if (_inline_can_bit_timing(HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN), argval, 75,
+                                   &st_CanDataLimits, &timing) != RT_EOK)
+        {
+            return -RT_ERROR;
+        }
+        if (argval != pdrv_can->device.config.baud_rate_fd)
+        {
+            pdrv_can->device.config.baud_rate_fd = argval;
+            return _inline_can_config(&pdrv_can->device, &pdrv_can->device.config);
+        }
+        break;
+    case RT_CAN_CMD_SET_BITTIMING:
+    {
+        struct rt_can_bit_timing_config *timing_cfg = (struct rt_can_bit_timing_config *)arg;
+
+        if (timing_cfg == RT_NULL || timing_cfg->count < 1 || timing_cfg->count > 2)
+        {
+            return -RT_ERROR;
+        }
+        pdrv_can->device.config.can_timing = timing_cfg->items[0];
+        if (timing_cfg->count == 2)
+        {
+            pdrv_can->device.config.canfd_timing = timing_cfg->items[1];
+        }
+        pdrv_can->device.config.use_bit_timing = 1;
+        return _inline_can_config(&pdrv_can->device, &pdrv_can->device.config);
+    }
+#endif /* RT_CAN_USING_CANFD */
 
     case RT_CAN_CMD_SET_PRIV:
         argval = (rt_uint32_t) arg;
@@ -349,8 +493,8 @@ static rt_err_t _inline_can_control(struct rt_can_device *can, int cmd, void *ar
         if (argval != pdrv_can->device.config.privmode)
         {
             pdrv_can->device.config.privmode = argval;
-
-            return RT_EOK;
+            /* switches the TX elements between FIFO and queue */
+            return _inline_can_config(&pdrv_can->device, &pdrv_can->device.config);
         }
         break;
     case RT_CAN_CMD_GET_STATUS:
@@ -372,12 +516,15 @@ static rt_err_t _inline_can_control(struct rt_can_device *can, int cmd, void *ar
     return RT_EOK;
 }
 
-static int _inline_can_sendmsg(struct rt_can_device *can, const void *buf, rt_uint32_t box_num)
+static rt_ssize_t _inline_can_sendmsg(struct rt_can_device *can, const void *buf, rt_uint32_t box_num)
 {
 
     _stm32_fdcan_t *pdrv_can;
-    struct rt_can_msg *pmsg;
-    uint32_t tmp_u32DataLen;
+    const struct rt_can_msg *pmsg;
+    FDCAN_TxHeaderTypeDef tx_header;
+    rt_uint32_t tmp_u32DlcMax = FDCAN_DLC_BYTES_8;
+    rt_uint32_t put;
+    rt_base_t level;
     RT_ASSERT(can);
     RT_ASSERT(buf);
 
@@ -385,51 +532,44 @@ static int _inline_can_sendmsg(struct rt_can_device *can, const void *buf, rt_ui
 
     RT_ASSERT(pdrv_can);
 
-    pmsg = (struct rt_can_msg *) buf;
-
-    /* Check the parameters */
-    if(pmsg->len > 8)
-    {
-        tmp_u32DataLen = 8;
-    }
-    else
-    {
-        tmp_u32DataLen = pmsg->len;
-    }
-    tmp_u32DataLen <<=16;
+    pmsg = (const struct rt_can_msg *) buf;
 
-    if(pmsg->ide == RT_CAN_EXTID)
+    tx_header.Identifier = pmsg->id;
+    tx_header.IdType = pmsg->ide == RT_CAN_EXTID ? FDCAN_EXTENDED_ID : FDCAN_STANDARD_ID;
+    tx_header.TxFrameType = RT_CAN_DTR == pmsg->rtr ? FDCAN_DATA_FRAME : FDCAN_REMOTE_FRAME;
+    tx_header.ErrorStateIndicator = FDCAN_ESI_ACTIVE;
+    tx_header.BitRateSwitch = FDCAN_BRS_OFF;
+    tx_header.FDFormat = FDCAN_CLASSIC_CAN;
+#ifdef RT_CAN_USING_CANFD
+    if (pmsg->fd_frame)
     {
-        pdrv_can->TxHeader.IdType = FDCAN_EXTENDED_ID;
+        tmp_u32DlcMax = FDCAN_DLC_BYTES_64;
+        tx_header.FDFormat = FDCAN_FD_CAN;
+        tx_header.BitRateSwitch = pmsg->brs ? FDCAN_BRS_ON : FDCAN_BRS_OFF;
     }
-    else
-    {
-        pdrv_can->TxHeader.IdType = FDCAN_STANDARD_ID;
-    }
-    if (RT_CAN_DTR == pmsg->rtr)
-    {
-        pdrv_can->TxHeader.TxFrameType = FDCAN_DATA_FRAME;
-    }
-    else
-    {
-        pdrv_can->TxHeader.TxFrameType = FDCAN_REMOTE_FRAME;
-    }
-
-    pdrv_can->TxHeader.Identifier = pmsg->id;
-    pdrv_can->TxHeader.DataLength = tmp_u32DataLen;
-    if(HAL_FDCAN_AddMessageToTxBuffer(&pdrv_can->fdcanHandle, &pdrv_can->TxHeader, pmsg->data, FDCAN_TX_BUFFER0+box_num) != HAL_OK)
+#endif
+    /* len is the data length code, the byte count up to 8 */
+    tx_header.DataLength = pmsg->len > tmp_u32DlcMax ? tmp_u32DlcMax : pmsg->len;
+    tx_header.TxEventFifoControl = FDCAN_NO_TX_EVENTS;
+    tx_header.MessageMarker = 0;
+
+    /* the completion interrupt maps the element back to the box */
+    level = rt_hw_interrupt_disable();
+    if (HAL_FDCAN_AddMessageToTxFifoQ(&pdrv_can->fdcanHandle, &tx_header, pmsg->data) != HAL_OK)
     {
+        rt_hw_interrupt_enable(level);
         return -RT_ERROR;
     }
-    else
-    {
-        /* Request transmission */
-        HAL_FDCAN_EnableTxBufferRequest(&pdrv_can->fdcanHandle,FDCAN_TX_BUFFER0+box_num);
-        return RT_EOK;
-    }
+    put = __CLZ(__RBIT(HAL_FDCAN_GetLatestTxFifoQRequestBuffer(&pdrv_can->fdcanHandle)));
+    pdrv_can->u8TxBox[put] = box_num;
+    pdrv_can->stats.tx_frames++;
+    rt_hw_interrupt_enable(level);
+
+    return RT_EOK;
 }
 
-static int _inline_can_recvmsg(struct rt_can_device *can, void *buf, rt_uint32_t fifo)
+/* one frame out of the FIFO, -RT_ERROR once it is empty */
+static rt_ssize_t _inline_can_recvmsg(struct rt_can_device *can, void *buf, rt_uint32_t fifo)
 {
 
     struct rt_can_msg *pmsg;
@@ -444,32 +584,38 @@ static int _inline_can_recvmsg(struct rt_can_device *can, void *buf, rt_uint32_t
     {
         return -RT_ERROR;
     }
+
+    if(pdrv_can->RxHeader.IdType == FDCAN_EXTENDED_ID)
+    {
+        pmsg->ide = RT_CAN_EXTID;
+    }
     else
     {
-        if(pdrv_can->RxHeader.IdType == FDCAN_EXTENDED_ID)
-        {
-            pmsg->ide = RT_CAN_EXTID;
-        }
-        else
-        {
-            pmsg->ide = RT_CAN_STDID;
-        }
-
-        if(pdrv_can->RxHeader.RxFrameType == FDCAN_DATA_FRAME)
-        {
-            pmsg->rtr = RT_CAN_DTR;
-        }
-        else
-        {
-            pmsg->rtr = RT_CAN_RTR;
-        }
-        pmsg->id = pdrv_can->RxHeader.Identifier;
-
-        pmsg->len = (pdrv_can->RxHeader.DataLength>>16)&0x0f;
+        pmsg->ide = RT_CAN_STDID;
+    }
 
-        pmsg->hdr = pdrv_can->RxHeader.FilterIndex;
-        return RT_EOK;
+    if(pdrv_can->RxHeader.RxFrameType == FDCAN_DATA_FRAME)
+    {
+        pmsg->rtr = RT_CAN_DTR;
+    }
+    else
+    {
+        pmsg->rtr = RT_CAN_RTR;
     }
+    pmsg->id = pdrv_can->RxHeader.Identifier;
+    pmsg->len = pdrv_can->RxHeader.DataLength;
+#ifdef RT_CAN_USING_CANFD
+    pmsg->fd_frame = pdrv_can->RxHeader.FDFormat == FDCAN_FD_CAN;
+    pmsg->brs = pdrv_can->RxHeader.BitRateSwitch == FDCAN_BRS_ON;
+#endif
+    /* set for frames no filter matched */
+    pmsg->hdr_index = pdrv_can->RxHeader.IsFilterMatchingFrame ? -1 : (rt_int32_t)pdrv_can->RxHeader.FilterIndex;
+    pmsg->rxfifo = fifo;
+#ifdef RT_CAN_USING_TIMESTAMP
+    pmsg->timestamp = _inline_can_timestamp(pdrv_can, pdrv_can->RxHeader.RxTimestamp);
+#endif
+    pdrv_can->stats.rx_frames++;
+    return RT_EOK;
 }
 
 static const struct rt_can_ops _can_ops =
@@ -480,127 +626,153 @@ static const struct rt_can_ops _can_ops =
     _inline_can_recvmsg,
 };
 
-void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
+static void _inline_can_rx_isr(_stm32_fdcan_t *pdrv_can, rt_uint32_t fifo, rt_uint32_t lost)
 {
-    if((RxFifo0ITs & FDCAN_IT_RX_FIFO0_NEW_MESSAGE) != RESET)
-    {
-        if(hfdcan->Instance == FDCAN1)
-        {
-#ifdef BSP_USING_FDCAN1
-            //CAN1
-            /* Retreive Rx messages from RX FIFO0 */
-            rt_hw_can_isr(&st_DrvCan1.device, RT_CAN_EVENT_RX_IND | 0 << 8);
-#endif
-        }
-        else
-        {
-#ifdef BSP_USING_FDCAN2
-            //CAN2
-            /* Retreive Rx messages from RX FIFO0 */
-            rt_hw_can_isr(&st_DrvCan2.device, RT_CAN_EVENT_RX_IND | 0 << 8);
-#endif
-        }
-    }
-}
+    rt_uint32_t start = DWT->CYCCNT;
+    rt_uint32_t frames = pdrv_can->stats.rx_frames;
+    int event = RT_CAN_EVENT_RX_IND;
 
-void HAL_FDCAN_TxBufferCompleteCallback(FDCAN_HandleTypeDef *hfdcan, uint32_t BufferIndexes)
-{
-    if(hfdcan->Instance == FDCAN1)
+    if (lost)
     {
-#ifdef BSP_USING_FDCAN1
-        //can1
-        rt_hw_can_isr(&st_DrvCan1.device, RT_CAN_EVENT_TX_DONE | ((BufferIndexes-1) << 8));
-#endif
+        pdrv_can->stats.rx_lost++;
+        event = RT_CAN_EVENT_RXOF_IND;
     }
-    else
+#ifdef RT_CAN_USING_BATCH
+    /* the framework empties the FIFO in this one call */
+    rt_hw_can_isr(&pdrv_can->device, event | fifo << 8);
+#else
+    /* the new message flag is cleared already, whatever is left would wait for the next frame */
+    do
     {
-#ifdef BSP_USING_FDCAN2
-        //can2
-        rt_hw_can_isr(&st_DrvCan2.device, RT_CAN_EVENT_TX_DONE | ((BufferIndexes-1) << 8));
+        rt_hw_can_isr(&pdrv_can->device, event | fifo << 8);
+        event = RT_CAN_EVENT_RX_IND;
+    } while (HAL_FDCAN_GetRxFifoFillLevel(&pdrv_can->fdcanHandle, FDCAN_RX_FIFO0 + fifo) != 0);
 #endif
+
+    frames = pdrv_can->stats.rx_frames - frames;
+    if (frames > pdrv_can->stats.rx_batch_max)
+    {
+        pdrv_can->stats.rx_batch_max = frames;
     }
+    pdrv_can->stats.rx_irqs++;
+    pdrv_can->stats.rx_cycles += DWT->CYCCNT - start;
+}
 
+void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
+{
+    _inline_can_rx_isr(_inline_can_from_handle(hfdcan), CAN_RX_FIFO0,
+                       RxFifo0ITs & FDCAN_IT_RX_FIFO0_MESSAGE_LOST);
 }
 
+void HAL_FDCAN_RxFifo1Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo1ITs)
+{
+    _inline_can_rx_isr(_inline_can_from_handle(hfdcan), CAN_RX_FIFO1,
+                       RxFifo1ITs & FDCAN_IT_RX_FIFO1_MESSAGE_LOST);
+}
 
-void HAL_FDCAN_TxFifoEmptyCallback(FDCAN_HandleTypeDef *hfdcan)
+void HAL_FDCAN_TimestampWraparoundCallback(FDCAN_HandleTypeDef *hfdcan)
 {
-    if(hfdcan->Instance == FDCAN1)
-    {
-        //can1
-    }
-    else
+    _inline_can_timestamp_now(_inline_can_from_handle(hfdcan));
+}
+
+/* BufferIndexes has a bit per TX element, each element knows its box */
+static void _inline_can_tx_isr(_stm32_fdcan_t *pdrv_can, rt_uint32_t BufferIndexes, int event)
+{
+    rt_uint32_t put;
+
+    while (BufferIndexes)
     {
-        //can2
+        put = __CLZ(__RBIT(BufferIndexes));
+        BufferIndexes &= BufferIndexes - 1;
+        rt_hw_can_isr(&pdrv_can->device, event | (pdrv_can->u8TxBox[put] << 8));
     }
 }
 
+void HAL_FDCAN_TxBufferCompleteCallback(FDCAN_HandleTypeDef *hfdcan, uint32_t BufferIndexes)
+{
+    _inline_can_tx_isr(_inline_can_from_handle(hfdcan), BufferIndexes, RT_CAN_EVENT_TX_DONE);
+}
+
+void HAL_FDCAN_TxFifoEmptyCallback(FDCAN_HandleTypeDef *hfdcan)
+{
+}
+
+/* without automatic retransmission a frame that failed ends up here */
 void HAL_FDCAN_TxBufferAbortCallback(FDCAN_HandleTypeDef *hfdcan, uint32_t BufferIndexes)
 {
+    _stm32_fdcan_t *pdrv_can = _inline_can_from_handle(hfdcan);
+    rt_uint32_t tmp = BufferIndexes;
 
+    while (tmp)
+    {
+        pdrv_can->stats.tx_failed++;
+        tmp &= tmp - 1;
+    }
+    _inline_can_tx_isr(pdrv_can, BufferIndexes, RT_CAN_EVENT_TX_FAIL);
 }
 
 void HAL_FDCAN_ErrorCallback(FDCAN_HandleTypeDef *hfdcan)
 {
+    _stm32_fdcan_t *pdrv_can = _inline_can_from_handle(hfdcan);
     rt_uint32_t tmp_u32Errcount;
     rt_uint32_t tmp_u32status;
     uint32_t ret = HAL_FDCAN_GetError(hfdcan);
 
-    if(hfdcan->Instance == FDCAN1)
+    if( (ret & FDCAN_IT_ARB_PROTOCOL_ERROR) &&
+        (hfdcan->Instance->CCCR & FDCAN_CCCR_INIT_Msk))
     {
-#ifdef BSP_USING_FDCAN1
-        //can1
-        if( (ret & FDCAN_IT_ARB_PROTOCOL_ERROR) &&
-            (hfdcan->Instance->CCCR & FDCAN_CCCR_INIT_Msk))
-        {
-            //hfdcan->Instance->CCCR |= FDCAN_CCCR_CCE_Msk;
-            hfdcan->Instance->CCCR &= ~FDCAN_CCCR_INIT_Msk;
-            st_DrvCan1.device.status.errcode = 0xff;
-        }
-        else
-        {
-            tmp_u32Errcount = st_DrvCan1.fdcanHandle.Instance->ECR;
-            tmp_u32status = st_DrvCan1.fdcanHandle.Instance->PSR;
-
-            st_DrvCan1.device.status.rcverrcnt = (tmp_u32Errcount>>8)&0x000000ff;
-            st_DrvCan1.device.status.snderrcnt = (tmp_u32Errcount)&0x000000ff;
-            st_DrvCan1.device.status.lasterrtype = tmp_u32status&0x000000007;
-        }
-#endif /*BSP_USING_FDCAN1*/
+        //hfdcan->Instance->CCCR |= FDCAN_CCCR_CCE_Msk;
+        hfdcan->Instance->CCCR &= ~FDCAN_CCCR_INIT_Msk;
+        pdrv_can->device.status.errcode = 0xff;
     }
     else
     {
-#ifdef BSP_USING_FDCAN2
-        if( (ret & FDCAN_IT_ARB_PROTOCOL_ERROR) &&
-            (hfdcan->Instance->CCCR & FDCAN_CCCR_INIT_Msk))
-        {
-            //hfdcan->Instance->CCCR |= FDCAN_CCCR_CCE_Msk;
-            hfdcan->Instance->CCCR &= ~FDCAN_CCCR_INIT_Msk;
-            st_DrvCan2.device.status.errcode = 0xff;
-        }
-        else
+        tmp_u32Errcount = hfdcan->Instance->ECR;
+        tmp_u32status = hfdcan->Instance->PSR;
+
+        pdrv_can->device.status.rcverrcnt = (tmp_u32Errcount>>8)&0x000000ff;
+        pdrv_can->device.status.snderrcnt = (tmp_u32Errcount)&0x000000ff;
+        pdrv_can->device.status.lasterrtype = tmp_u32status&0x000000007;
+    }
+}
+
+void HAL_FDCAN_MspInit(FDCAN_HandleTypeDef *hfdcan)
+{
+    _stm32_fdcan_t *pdrv_can = _inline_can_from_handle(hfdcan);
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    const char *pins[2] = {pdrv_can->tx_pin, pdrv_can->rx_pin};
+    rt_base_t pin;
+    int i;
+
+    __HAL_RCC_FDCAN_CLK_ENABLE();
+
+    for (i = 0; i < 2; i++)
+    {
+        pin = rt_pin_get(pins[i]);
+        if (pin < 0)
         {
-            //can2
-            tmp_u32Errcount = st_DrvCan2.fdcanHandle.Instance->ECR;
-            tmp_u32status = st_DrvCan2.fdcanHandle.Instance->PSR;
-            st_DrvCan2.device.status.rcverrcnt = (tmp_u32Errcount>>8)&0x000000ff;
-            st_DrvCan2.device.status.snderrcnt = (tmp_u32Errcount)&0x000000ff;
-            st_DrvCan2.device.status.lasterrtype = tmp_u32status&0x000000007;
+            LOG_E("%s: bad pin %s", pdrv_can->name, pins[i]);
+            continue;
         }
-#endif /*BSP_USING_FDCAN2*/
+        GPIO_InitStruct.Pin = 1u << (pin & 0xF);
+        GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+        GPIO_InitStruct.Pull = GPIO_NOPULL;
+        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+        GPIO_InitStruct.Alternate = GPIO_AF9_FDCAN1;
+        HAL_GPIO_Init((GPIO_TypeDef *)(GPIOA_BASE + 0x400u * (pin >> 4)), &GPIO_InitStruct);
     }
 }
 
 #ifdef BSP_USING_FDCAN1
 
-void FDCAN1_IT0_IRQHandler(void)             /* FDCAN2 interrupt line 0      */
+void FDCAN1_IT0_IRQHandler(void)             /* FDCAN1 interrupt line 0      */
 {
     rt_interrupt_enter();
     HAL_FDCAN_IRQHandler(&st_DrvCan1.fdcanHandle);
     rt_interrupt_leave();
 }
 
-void FDCAN1_IT1_IRQHandler(void)             /* FDCAN2 interrupt line 1      */
+void FDCAN1_IT1_IRQHandler(void)             /* FDCAN1 interrupt line 1      */
 {
     rt_interrupt_enter();
     HAL_FDCAN_IRQHandler(&st_DrvCan1.fdcanHandle);
@@ -628,13 +800,17 @@ void FDCAN2_IT1_IRQHandler(void)             /* FDCAN2 interrupt line 1      */
 
 static int rt_hw_can_init(void)
 {
-    struct can_configure config;
+    struct can_configure config = CANDEFAULTCONFIG;
     config.baud_rate = CAN250kBaud;
-    config.msgboxsz = 48;
-    config.sndboxnumber = 1;
+    config.msgboxsz = BSP_FDCAN_RX_FRAMES;
+    /* one box per TX element */
+    config.sndboxnumber = FDCAN_TX_FIFO_ELEMENTS;
     config.mode = RT_CAN_MODE_NORMAL;
     config.privmode = RT_CAN_MODE_NOPRIV;
     config.ticks = 50;
+#ifdef RT_CAN_USING_CANFD
+    config.baud_rate_fd = 2000000;
+#endif
     /* config default filter */
     FDCAN_FilterTypeDef sFilterConfig;
     sFilterConfig.IdType = FDCAN_STANDARD_ID;
@@ -657,7 +833,7 @@ static int rt_hw_can_init(void)
     st_DrvCan2.FilterConfig = sFilterConfig;
     st_DrvCan2.device.config = config;
 
-    /* register FDCAN1 device */
+    /* register FDCAN2 device */
     rt_hw_can_register(&st_DrvCan2.device, st_DrvCan2.name, &_can_ops, &st_DrvCan2);
 #endif /* BSP_USING_FDCAN2 */
 
@@ -665,5 +841,286 @@ static int rt_hw_can_init(void)
 }
 INIT_BOARD_EXPORT(rt_hw_can_init);
 
+#ifdef RT_USING_FINSH
+#define FDCAN_BENCH_BURST       16
+#define FDCAN_BENCH_READ        32
+
+static const rt_uint8_t _dlc_bytes[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+struct fdcan_bench
+{
+    rt_device_t dev;
+    struct rt_semaphore rx_sem;
+    struct rt_semaphore done;
+    volatile int stop;
+    rt_uint32_t dlc;
+    rt_uint32_t fd;
+    rt_uint32_t next;               /* sequence number of the next frame written */
+    rt_uint32_t write_short;        /* writes that came back with fewer frames */
+    struct rt_can_msg tx[FDCAN_BENCH_BURST];
+    struct rt_can_msg rx[FDCAN_BENCH_READ];
+};
+
+static struct fdcan_bench *_bench;
+
+static rt_err_t _bench_rx_ind(rt_device_t dev, rt_size_t size)
+{
+    rt_sem_release(&_bench->rx_sem);
+    return RT_EOK;
+}
+
+/* bursts keep every TX element busy, the bus runs back to back */
+static void _bench_writer(void *parameter)
+{
+    struct fdcan_bench *b = (struct fdcan_bench *)parameter;
+    rt_uint32_t i, n;
+
+    while (!b->stop)
+    {
+        for (i = 0; i < FDCAN_BENCH_BURST; i++)
+        {
+            b->tx[i].id = 0x123;
+            b->tx[i].len = b->dlc;
+#ifdef RT_CAN_USING_CANFD
+            b->tx[i].fd_frame = b->fd;
+            b->tx[i].brs = b->fd;
+#endif
+            rt_memcpy(b->tx[i].data, &b->next, sizeof(b->next));
+            b->next++;
+        }
+        n = rt_device_write(b->dev, 0, b->tx, sizeof(b->tx)) / sizeof(b->tx[0]);
+        if (n != FDCAN_BENCH_BURST)
+        {
+            b->write_short++;
+        }
+    }
+    rt_sem_release(&b->done);
+}
+
+static void _bench_stats(_stm32_fdcan_t *pdrv_can)
+{
+    struct stm32_fdcan_stats *st = &pdrv_can->stats;
+    rt_uint32_t per_frame = st->rx_frames ? (rt_uint32_t)(st->rx_cycles / st->rx_frames) : 0;
+
+    rt_kprintf("%s: rx %u frames in %u interrupts (%u.%02u each, max %u), %u overruns of the controller FIFO\n",
+               pdrv_can->name, st->rx_frames, st->rx_irqs,
+               st->rx_irqs ? st->rx_frames / st->rx_irqs : 0,
+               st->rx_irqs ? st->rx_frames * 100 / st->rx_irqs % 100 : 0,
+               st->rx_batch_max, st->rx_lost);
+    rt_kprintf("%s: rx interrupt %u cycles per frame, the CPU could take %u frames/s\n", pdrv_can->name,
+               per_frame, per_frame ? SystemCoreClock / per_frame : 0);
+    rt_kprintf("%s: tx %u frames queued, %u failed; framework rx %u, ring drops %u, tx %u, tx drops %u\n",
+               pdrv_can->name, st->tx_frames, st->tx_failed, pdrv_can->device.status.rcvpkg,
+               pdrv_can->device.status.dropedrcvpkg, pdrv_can->device.status.sndpkg,
+               pdrv_can->device.status.dropedsndpkg);
+}
+
+static void _bench_run(_stm32_fdcan_t *pdrv_can, rt_uint32_t seconds, rt_uint32_t bytes,
+                       rt_uint32_t baud, rt_uint32_t baud_fd)
+{
+    struct fdcan_bench *b;
+    struct can_configure saved = pdrv_can->device.config;
+    rt_uint32_t frames = 0, reads = 0, lost = 0, expect = 0, seq, n, i;
+    rt_uint32_t ts_back = 0, ts_first = 0, ts_last = 0;
+    rt_tick_t start, elapsed;
+    rt_thread_t writer;
+    rt_base_t level;
+
+    if (pdrv_can->device.parent.ref_count != 0)
+    {
+        rt_kprintf("%s is open, close it first\n", pdrv_can->name);
+        return;
+    }
+    b = rt_calloc(1, sizeof(*b));
+    if (b == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        return;
+    }
+    for (b->dlc = 0; b->dlc < 15 && _dlc_bytes[b->dlc] < bytes; b->dlc++)
+        ;
+    b->fd = _dlc_bytes[b->dlc] > 8;
+    b->dev = &pdrv_can->device.parent;
+    rt_sem_init(&b->rx_sem, "cbrx", 0, RT_IPC_FLAG_FIFO);
+    rt_sem_init(&b->done, "cbdn", 0, RT_IPC_FLAG_FIFO);
+    _bench = b;
+
+    if (rt_device_open(b->dev, RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_INT_TX) != RT_EOK)
+    {
+        rt_kprintf("%s: open failed\n", pdrv_can->name);
+        goto __exit;
+    }
+    /* no transceiver needed: the controller hears itself and keeps off the bus */
+    if (rt_device_control(b->dev, RT_CAN_CMD_SET_MODE, (void *)RT_CAN_MODE_LOOPBACKANLISTEN) != RT_EOK ||
+        rt_device_control(b->dev, RT_CAN_CMD_SET_BAUD, (void *)baud) != RT_EOK)
+    {
+        rt_kprintf("%s: %u bit/s not available\n", pdrv_can->name, baud);
+        goto __close;
+    }
+#ifdef RT_CAN_USING_CANFD
+    if (rt_device_control(b->dev, RT_CAN_CMD_SET_BAUD_FD, (void *)baud_fd) != RT_EOK ||
+        rt_device_control(b->dev, RT_CAN_CMD_SET_CANFD, (void *)b->fd) != RT_EOK)
+    {
+        rt_kprintf("%s: %u bit/s data phase not available\n", pdrv_can->name, baud_fd);
+        goto __close;
+    }
+#else
+    if (b->fd)
+    {
+        rt_kprintf("%s: more than 8 bytes needs RT_CAN_USING_CANFD\n", pdrv_can->name);
+        goto __close;
+    }
+#endif
+    rt_device_set_rx_indicate(b->dev, _bench_rx_ind);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    level = rt_hw_interrupt_disable();
+    rt_memset(&pdrv_can->stats, 0, sizeof(pdrv_can->stats));
+    rt_memset(&pdrv_can->device.status, 0, sizeof(pdrv_can->device.status));
+    rt_hw_interrupt_enable(level);
+
+    writer = rt_thread_create("cbtx", _bench_writer, b, 2048, RT_THREAD_PRIORITY_MAX / 2 + 1, 10);
+    if (writer == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        goto __close;
+    }
+    start = rt_tick_get();
+    rt_thread_startup(writer);
+
+    /* stop writing after the time, read until the bus has been quiet a while */
+    while (1)
+    {
+        elapsed = rt_tick_get() - start;
+        if (!b->stop && elapsed >= seconds * RT_TICK_PER_SECOND)
+        {
+            b->stop = 1;
+            rt_sem_take(&b->done, RT_TICK_PER_SECOND);
+        }
+        n = rt_device_read(b->dev, 0, b->rx, sizeof(b->rx)) / sizeof(b->rx[0]);
+        if (n == 0)
+        {
+            if (rt_sem_take(&b->rx_sem, RT_TICK_PER_SECOND / 10) != RT_EOK && b->stop)
+            {
+                break;
+            }
+            continue;
+        }
+        reads++;
+        for (i = 0; i < n; i++)
+        {
+            rt_memcpy(&seq, b->rx[i].data, sizeof(seq));
+            if (seq != expect)
+            {
+                lost += seq - expect;
+            }
+            expect = seq + 1;
+#ifdef RT_CAN_USING_TIMESTAMP
+            if (frames + i == 0)
+            {
+                ts_first = b->rx[i].timestamp;
+            }
+            else if ((rt_int32_t)(b->rx[i].timestamp - ts_last) < 0)
+            {
+                ts_back++;
+            }
+            ts_last = b->rx[i].timestamp;
+#endif
+        }
+        frames += n;
+    }
+    elapsed = rt_tick_get() - start;
+
+    rt_kprintf("%s: %u bit/s, %u bytes per frame%s, %u s, bursts of %u\n", pdrv_can->name, baud,
+               _dlc_bytes[b->dlc], b->fd ? " (FD)" : "", seconds, FDCAN_BENCH_BURST);
+    rt_kprintf("%s: %u written, %u read in %u reads, %u frames/s, %u missing (tx drops included), %u short writes\n", pdrv_can->name,
+               b->next, frames, reads, (rt_uint32_t)((rt_uint64_t)frames * RT_TICK_PER_SECOND / elapsed),
+               lost + (b->next - expect), b->write_short);
+#ifdef RT_CAN_USING_TIMESTAMP
+    rt_kprintf("%s: timestamps span %u bit times, %u went backwards\n", pdrv_can->name, ts_last - ts_first, ts_back);
+#else
+    RT_UNUSED(ts_back);
+    RT_UNUSED(ts_first);
+    RT_UNUSED(ts_last);
+#endif
+    _bench_stats(pdrv_can);
+
+__close:
+    rt_device_set_rx_indicate(b->dev, RT_NULL);
+    rt_device_control(b->dev, RT_CAN_CMD_SET_MODE, (void *)saved.mode);
+    rt_device_control(b->dev, RT_CAN_CMD_SET_BAUD, (void *)saved.baud_rate);
+#ifdef RT_CAN_USING_CANFD
+    rt_device_control(b->dev, RT_CAN_CMD_SET_CANFD, (void *)saved.enable_canfd);
+    rt_device_control(b->dev, RT_CAN_CMD_SET_BAUD_FD, (void *)saved.baud_rate_fd);
+#else
+    RT_UNUSED(baud_fd);
+#endif
+    rt_device_close(b->dev);
+__exit:
+    _bench = RT_NULL;
+    rt_sem_detach(&b->rx_sem);
+    rt_sem_detach(&b->done);
+    rt_free(b);
+}
+
+static void fdcan(int argc, char **argv)
+{
+    _stm32_fdcan_t *pdrv_can;
+    rt_device_t dev;
+
+    dev = rt_device_find(argc >= 3 && rt_strncmp(argv[2], "fdcan", 5) == 0 ? argv[2] : "fdcan1");
+    if (dev == RT_NULL)
+    {
+        dev = rt_device_find("fdcan2");
+    }
+    if (dev == RT_NULL)
+    {
+        rt_kprintf("no fdcan device\n");
+        return;
+    }
+    pdrv_can = (_stm32_fdcan_t *)dev->user_data;
+
+    if (argc >= 2 && rt_strcmp(argv[1], "stat") == 0)
+    {
+        _bench_stats(pdrv_can);
+    }
+    else if (argc >= 2 && rt_strcmp(argv[1], "bench") == 0)
+    {
+        rt_uint32_t seconds = argc >= 3 ? atoi(argv[2]) : 5;
+        rt_uint32_t bytes = argc >= 4 ? atoi(argv[3]) : 8;
+
+        if (seconds < 1)
+        {
+            seconds = 1;
+        }
+        if (bytes < 4)
+        {
+            /* room for the sequence number */
+            bytes = 4;
+        }
+        _bench_run(pdrv_can, seconds, bytes, argc >= 5 ? atoi(argv[4]) : CAN1MBaud,
+                   argc >= 6 ? atoi(argv[5]) : 4000000);
+    }
+#ifdef RT_CAN_USING_BATCH
+    else if (argc >= 2 && rt_strcmp(argv[1], "selftest") == 0)
+    {
+        can_ring_selftest();
+    }
+#endif
+    else
+    {
+        rt_kprintf("Usage:\n");
+        rt_kprintf("fdcan stat [dev]                   - driver and framework counters\n");
+        rt_kprintf("fdcan bench [s] [bytes] [bit/s] [data bit/s]\n");
+        rt_kprintf("                                   - internal loopback at line rate, counts the lost frames\n");
+#ifdef RT_CAN_USING_BATCH
+        rt_kprintf("fdcan selftest                     - check the frame ring\n");
+#endif
+    }
+}
+MSH_CMD_EXPORT(fdcan, FDCAN counters and loopback bench: fdcan <stat|bench|selftest>);
+#endif /* RT_USING_FINSH */
+
 #endif /* BSP_USING_FDCAN1 || BSP_USING_FDCAN2 */
 #endif /* RT_USING_CAN */
@@ -6,6 +6,7 @@
  * Change Logs:
  * Date         Author          Notes
  * 2024-10-30   Evlers          first version
+ * 2025-02-18   RT-Thread       eMMC on SDIO1, DDR52, direct DMA and long transfers
  */
 
 #include "board.h"
@@ -31,6 +32,11 @@ static struct rt_mmcsd_host *host2;
 
 #define SDIO_TX_RX_COMPLETE_TIMEOUT_LOOPS    (1000000)
 
+#define SDIO_CMD_SEND_STATUS                 (13)
+#define SDIO_R1_READY_FOR_DATA               (1U << 8)
+#define SDIO_R1_CURRENT_STATE(_r1)           (((_r1) >> 9) & 0x0F)
+#define SDIO_R1_STATE_TRAN                   (4)
+
 #define RTHW_SDIO_LOCK(_sdio)   rt_mutex_take(&_sdio->mutex, RT_WAITING_FOREVER)
 #define RTHW_SDIO_UNLOCK(_sdio) rt_mutex_release(&_sdio->mutex);
 
@@ -268,14 +274,20 @@ static void rthw_sdio_send_command(struct rthw_sdio *sdio, struct sdio_pkg *pkg)
     /* data pre configuration */
     if (data != RT_NULL)
     {
+        /* pkg->buff is the bounce buffer or the caller's buffer, both cache line aligned */
         if (data->flags & DATA_DIR_WRITE)
         {
-            SCB_CleanDCache_by_Addr((uint32_t*)sdio->cache_buf, data->blks * data->blksize);
+            SCB_CleanDCache_by_Addr((uint32_t*)pkg->buff, data->blks * data->blksize);
         }
-        else
+        else if (pkg->buff == sdio->cache_buf)
         {
             SCB_InvalidateDCache_by_Addr((uint32_t*)sdio->cache_buf, data->blks * data->blksize + 32);
         }
+        else
+        {
+            /* only the lines of the caller's buffer, the next line is not ours */
+            SCB_InvalidateDCache_by_Addr((uint32_t*)pkg->buff, data->blks * data->blksize);
+        }
 
         reg_cmd |= SDMMC_CMD_CMDTRANS;
         __HAL_SD_DISABLE_IT(&sdio->sdio_des.hw_sdio, SDMMC_MASK_CMDRENDIE | SDMMC_MASK_CMDSENTIE);
@@ -283,7 +295,7 @@ static void rthw_sdio_send_command(struct rthw_sdio *sdio, struct sdio_pkg *pkg)
         hsd->DLEN = data->blks * data->blksize;
         hsd->DCTRL = (get_order(data->blksize) << 4) | (data->flags & DATA_DIR_READ ? SDMMC_DCTRL_DTDIR : 0) | \
                                                         (data->flags & DATA_STREAM ? SDMMC_DCTRL_DTMODE_0 : 0);
-        hsd->IDMABASER = (rt_uint32_t)sdio->cache_buf;
+        hsd->IDMABASER = (rt_uint32_t)pkg->buff;
         hsd->IDMACTRL = SDMMC_IDMA_IDMAEN;
     }
      /* config cmd reg */
@@ -318,11 +330,124 @@ static void rthw_sdio_send_command(struct rthw_sdio *sdio, struct sdio_pkg *pkg)
     /* data post configuration */
     if (data != RT_NULL)
     {
-        if (data->flags & DATA_DIR_READ)
+        if ((data->flags & DATA_DIR_READ) && pkg->buff == sdio->cache_buf)
         {
             SCB_CleanInvalidateDCache_by_Addr((uint32_t*)((uint32_t)sdio->cache_buf & ~(32U - 1U)), data->blks * data->blksize + 32U);
             rt_memcpy(data->buf, sdio->cache_buf, data->blks * data->blksize);
         }
+        else if (data->flags & DATA_DIR_READ)
+        {
+            /* drop the lines the CPU may have speculatively fetched during the DMA */
+            SCB_InvalidateDCache_by_Addr((uint32_t*)pkg->buff, data->blks * data->blksize);
+        }
+    }
+}
+
+/**
+  * @brief  This function check whether the IDMA can use the caller's buffer.
+  * @param  data  rt_mmcsd_data
+  * @retval RT_TRUE if the buffer is cache line aligned, a whole number of lines and not in the TCM
+  */
+static rt_bool_t rthw_sdio_dma_direct(struct rt_mmcsd_data *data)
+{
+    rt_uint32_t addr = (rt_uint32_t)data->buf;
+    rt_uint32_t size = data->blks * data->blksize;
+
+    return ((addr & (SDIO_ALIGN_LEN - 1)) == 0) && ((size & (SDIO_ALIGN_LEN - 1)) == 0) &&
+           (addr >= SDIO_DMA_ADDR_MIN);
+}
+
+/**
+  * @brief  This function wait until the card is back in the transfer state.
+  * @param  sdio rthw_sdio
+  * @retval RT_EOK or -RT_ETIMEOUT
+  */
+static rt_err_t rthw_sdio_wait_ready(struct rthw_sdio *sdio)
+{
+    struct rt_mmcsd_cmd cmd;
+    struct sdio_pkg pkg;
+    rt_tick_t start = rt_tick_get();
+
+    do
+    {
+        rt_memset(&cmd, 0, sizeof(cmd));
+        rt_memset(&pkg, 0, sizeof(pkg));
+        cmd.cmd_code = SDIO_CMD_SEND_STATUS;
+        cmd.arg = sdio->host->card->rca << 16;
+        cmd.flags = RESP_R1 | CMD_AC;
+        pkg.cmd = &cmd;
+        rthw_sdio_send_command(sdio, &pkg);
+        if (cmd.err == RT_EOK && (cmd.resp[0] & SDIO_R1_READY_FOR_DATA) &&
+            SDIO_R1_CURRENT_STATE(cmd.resp[0]) == SDIO_R1_STATE_TRAN)
+        {
+            return RT_EOK;
+        }
+    } while (rt_tick_get() - start < rt_tick_from_millisecond(1000));
+
+    return -RT_ETIMEOUT;
+}
+
+/**
+  * @brief  This function send a multiple block transfer larger than the bounce buffer
+  *         from an unaligned buffer, as several transfers of the bounce buffer size.
+  * @param  sdio rthw_sdio
+  * @param  req  request
+  * @retval None
+  */
+static void rthw_sdio_request_split(struct rthw_sdio *sdio, struct rt_mmcsd_req *req)
+{
+    struct rt_mmcsd_cmd *cmd = req->cmd;
+    struct rt_mmcsd_data *data = cmd->data;
+    struct rt_mmcsd_cmd sub_cmd;
+    struct rt_mmcsd_data sub_data;
+    struct sdio_pkg pkg;
+    rt_uint32_t chunk = SDIO_BUFF_SIZE / data->blksize;
+    rt_uint32_t done, size;
+    rt_bool_t byte_addr = !(sdio->host->card->flags & CARD_FLAG_SDHC);
+
+    for (done = 0; done < data->blks; done += sub_data.blks)
+    {
+        sub_cmd = *cmd;
+        sub_data = *data;
+        sub_cmd.data = &sub_data;
+        sub_cmd.arg += byte_addr ? done * data->blksize : done;
+        sub_data.buf = (rt_uint32_t *)((rt_uint8_t *)data->buf + done * data->blksize);
+        sub_data.blks = (data->blks - done > chunk) ? chunk : data->blks - done;
+        size = sub_data.blks * sub_data.blksize;
+
+        if ((data->flags & DATA_DIR_WRITE) && done != 0)
+        {
+            /* the card is still programming the previous piece */
+            if (rthw_sdio_wait_ready(sdio) != RT_EOK)
+            {
+                cmd->err = -RT_ETIMEOUT;
+                return;
+            }
+        }
+        if (data->flags & DATA_DIR_WRITE)
+        {
+            rt_memcpy(sdio->cache_buf, sub_data.buf, size);
+        }
+
+        rt_memset(&pkg, 0, sizeof(pkg));
+        pkg.cmd = &sub_cmd;
+        pkg.buff = sdio->cache_buf;
+        rthw_sdio_send_command(sdio, &pkg);
+
+        if (req->stop != RT_NULL)
+        {
+            rt_memset(&pkg, 0, sizeof(pkg));
+            pkg.cmd = req->stop;
+            rthw_sdio_send_command(sdio, &pkg);
+        }
+
+        cmd->err = sub_cmd.err;
+        data->err = sub_data.err;
+        rt_memcpy(cmd->resp, sub_cmd.resp, sizeof(cmd->resp));
+        if (cmd->err != RT_EOK || data->err != RT_EOK)
+        {
+            return;
+        }
     }
 }
 
@@ -345,14 +470,28 @@ static void rthw_sdio_request(struct rt_mmcsd_host *host, struct rt_mmcsd_req *r
         rt_memset(&pkg, 0, sizeof(pkg));
         data = req->cmd->data;
         pkg.cmd = req->cmd;
+        pkg.buff = sdio->cache_buf;
 
         if (data != RT_NULL)
         {
             rt_uint32_t size = data->blks * data->blksize;
 
-            RT_ASSERT(size <= SDIO_BUFF_SIZE);
-
-            if (data->flags & DATA_DIR_WRITE)
+            if (rthw_sdio_dma_direct(data))
+            {
+                /* DMA straight from/to the caller's buffer, no copy */
+                pkg.buff = data->buf;
+            }
+            else if (size > SDIO_BUFF_SIZE)
+            {
+                /* only the block read/write of the SDIO1 card is longer than the bounce buffer */
+                RT_ASSERT(host->card != RT_NULL);
+                RT_ASSERT(req->cmd->cmd_code == READ_MULTIPLE_BLOCK || req->cmd->cmd_code == WRITE_MULTIPLE_BLOCK);
+                rthw_sdio_request_split(sdio, req);
+                RTHW_SDIO_UNLOCK(sdio);
+                mmcsd_req_complete(sdio->host);
+                return;
+            }
+            else if (data->flags & DATA_DIR_WRITE)
             {
                 rt_memcpy(sdio->cache_buf, data->buf, size);
             }
@@ -414,7 +553,8 @@ static void rthw_sdio_iocfg(struct rt_mmcsd_host *host, struct rt_mmcsd_io_cfg *
 
     if (sdmmc_clk != 0U)
     {
-        hsd->Init.ClockDiv = sdmmc_clk / (2U * clk);
+        /* round up, the card clock must not exceed the requested rate */
+        hsd->Init.ClockDiv = (sdmmc_clk + 2U * clk - 1U) / (2U * clk);
         /* Configure the SDMMC peripheral */
         Init.ClockEdge           = hsd->Init.ClockEdge;
         Init.ClockPowerSave      = hsd->Init.ClockPowerSave;
@@ -497,6 +637,11 @@ static void rthw_sdio_iocfg(struct rt_mmcsd_host *host, struct rt_mmcsd_io_cfg *
             }
         }
         (void)SDMMC_Init(hsd->Instance, Init);
+        if (io_cfg->timing == MMCSD_TIMING_MMC_DDR52)
+        {
+            /* SDMMC_Init() clears the DDR bit */
+            hsd->Instance->CLKCR |= SDMMC_CLKCR_DDR;
+        }
     }
     switch ((io_cfg->power_mode)&0X03)
     {
@@ -644,6 +789,21 @@ struct rt_mmcsd_host *sdio_host_create(struct stm32_sdio_des *sdio_des)
     host->max_blk_size = 512;
     host->max_blk_count = 512;
 
+#ifdef BSP_USING_SDIO1
+    if(sdio_des->hw_sdio.Instance == SDMMC1)
+    {
+        /* block transfers longer than the bounce buffer, see rthw_sdio_request_split() */
+        host->max_seg_size = SDIO1_MAX_SEG_SIZE;
+#ifdef BSP_SDIO1_USING_EMMC
+        host->flags = MMCSD_BUSWIDTH_8 | MMCSD_BUSWIDTH_4 | MMCSD_MUTBLKWRITE |
+                      MMCSD_SUP_HIGHSPEED | MMCSD_SUP_NONREMOVABLE;
+#ifdef BSP_EMMC_USING_DDR52
+        host->flags |= MMCSD_SUP_DDR_3V3;
+#endif /* BSP_EMMC_USING_DDR52 */
+#endif /* BSP_SDIO1_USING_EMMC */
+    }
+#endif /* BSP_USING_SDIO1 */
+
     /* link up host and sdio */
     sdio->host = host;
     host->private_data = sdio;
@@ -666,6 +826,36 @@ static rt_uint32_t stm32_sdio_clock_get(void)
     return HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_SDMMC12);
 }
 
+#ifdef BSP_SDIO1_USING_EMMC
+/**
+  * @brief  This function configure D4-D7 of SDMMC1, HAL_SD_MspInit() only sets up the 4-bit bus.
+  * @retval None
+  */
+static void stm32_emmc_msp_init(void)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    __HAL_RCC_GPIOC_CLK_ENABLE();
+    /**SDMMC1 GPIO Configuration
+    PB8     ------> SDMMC1_D4
+    PB9     ------> SDMMC1_D5
+    PC6     ------> SDMMC1_D6
+    PC7     ------> SDMMC1_D7
+    */
+    GPIO_InitStruct.Pin = GPIO_PIN_8|GPIO_PIN_9;
+    GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    GPIO_InitStruct.Alternate = GPIO_AF12_SDMMC1;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+    GPIO_InitStruct.Pin = GPIO_PIN_6|GPIO_PIN_7;
+    GPIO_InitStruct.Alternate = GPIO_AF11_SDMMC1;
+    HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+}
+#endif /* BSP_SDIO1_USING_EMMC */
+
 void SDMMC1_IRQHandler(void)
 {
     /* enter interrupt */
@@ -693,6 +883,9 @@ int rt_hw_sdio_init(void)
     sdio_des1.hw_sdio.Instance = SDMMC1;
 
     HAL_SD_MspInit(&sdio_des1.hw_sdio);
+#ifdef BSP_SDIO1_USING_EMMC
+    stm32_emmc_msp_init();
+#endif
     HAL_NVIC_SetPriority(SDMMC1_IRQn, 2, 0);
     HAL_NVIC_EnableIRQ(SDMMC1_IRQn);
 
@@ -739,4 +932,131 @@ void stm32_mmcsd_change(void)
 #endif /* BSP_USING_SDIO2 */
 }
 
+#ifdef RT_USING_FINSH
+#include <stdlib.h>
+
+#define BLK_BENCH_SEQ_SECTORS   128     /* 64 KB per sequential request */
+#define BLK_BENCH_RND_SECTORS   8       /* 4 KB per random request */
+#define BLK_BENCH_RND_COUNT     1000
+
+static void blk_bench_report(const char *name, rt_uint32_t sectors, rt_uint32_t ops, rt_tick_t ticks, rt_size_t err)
+{
+    rt_uint32_t ms = ticks * 1000 / RT_TICK_PER_SECOND;
+
+    if (ms == 0)
+    {
+        ms = 1;
+    }
+    rt_kprintf("  %-10s %6u KB in %5u ms  %6u KB/s  %5u IOPS%s\n", name, sectors / 2, ms,
+               (rt_uint32_t)((rt_uint64_t)sectors * 500 / ms), (rt_uint32_t)((rt_uint64_t)ops * 1000 / ms),
+               err ? "  (I/O error)" : "");
+}
+
+/* total sectors in requests of count, random ones at count-aligned positions within span sectors of start */
+static rt_size_t blk_bench_run(rt_device_t dev, rt_uint8_t *buf, rt_uint32_t start, rt_uint32_t span,
+                               rt_uint32_t count, rt_uint32_t total, rt_bool_t write, rt_bool_t random)
+{
+    rt_uint32_t done, pos, ops = 0;
+    rt_size_t err = 0;
+    rt_tick_t tick = rt_tick_get();
+
+    for (done = 0; done < total; done += count)
+    {
+        pos = random ? start + (rand() % (span / count)) * count : start + done;
+        if ((write ? rt_device_write(dev, pos, buf, count) : rt_device_read(dev, pos, buf, count)) != count)
+        {
+            err++;
+        }
+        ops++;
+    }
+    blk_bench_report(random ? (write ? "rand write" : "rand read") : (write ? "seq write" : "seq read"),
+                     total, ops, rt_tick_get() - tick, err);
+    return err;
+}
+
+/* raw throughput of a block device, run it on the eMMC build and the SD card build to compare */
+static void blk_bench(int argc, char **argv)
+{
+    struct rt_device_blk_geometry geometry;
+    rt_device_t dev;
+    rt_uint8_t *mem, *buf;
+    rt_uint32_t mb = 16, total, start;
+    rt_bool_t write = RT_FALSE, unaligned = RT_FALSE;
+    int i;
+
+    if (argc < 2)
+    {
+        rt_kprintf("Usage: blk_bench <device> [MB] [-w] [-u]\n");
+        rt_kprintf("  -w also write, destroys the data at the end of the device\n");
+        rt_kprintf("  -u unaligned buffer, through the bounce buffer\n");
+        return;
+    }
+    for (i = 2; i < argc; i++)
+    {
+        if (!rt_strcmp(argv[i], "-w"))
+            write = RT_TRUE;
+        else if (!rt_strcmp(argv[i], "-u"))
+            unaligned = RT_TRUE;
+        else
+            mb = atoi(argv[i]);
+    }
+
+    dev = rt_device_find(argv[1]);
+    if (dev == RT_NULL || dev->type != RT_Device_Class_Block)
+    {
+        rt_kprintf("%s is not a block device\n", argv[1]);
+        return;
+    }
+    if (rt_device_open(dev, RT_DEVICE_OFLAG_RDWR) != RT_EOK)
+    {
+        rt_kprintf("open %s failed\n", argv[1]);
+        return;
+    }
+    rt_device_control(dev, RT_DEVICE_CTRL_BLK_GETGEOME, &geometry);
+    total = mb * 2048;
+    if (geometry.bytes_per_sector != 512 || total == 0 || total > geometry.sector_count)
+    {
+        rt_kprintf("bad size, %u sectors of %u bytes\n", geometry.sector_count, geometry.bytes_per_sector);
+        rt_device_close(dev);
+        return;
+    }
+    total -= total % BLK_BENCH_SEQ_SECTORS;
+    /* the end of the device, away from the file system structures at the front */
+    start = (geometry.sector_count - total) & ~(BLK_BENCH_RND_SECTORS - 1);
+
+    mem = rt_malloc_align(BLK_BENCH_SEQ_SECTORS * 512 + SDIO_ALIGN_LEN, SDIO_ALIGN_LEN);
+    if (mem == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        rt_device_close(dev);
+        return;
+    }
+    buf = unaligned ? mem + 4 : mem;
+    for (i = 0; i < BLK_BENCH_SEQ_SECTORS * 512; i++)
+    {
+        buf[i] = (rt_uint8_t)i;
+    }
+
+    rt_kprintf("%s: %u MB at sector %u, %s buffer\n", argv[1], total / 2048, start,
+               unaligned ? "unaligned" : "aligned");
+    if (write)
+    {
+        blk_bench_run(dev, buf, start, total, BLK_BENCH_SEQ_SECTORS, total, RT_TRUE, RT_FALSE);
+    }
+    blk_bench_run(dev, buf, start, total, BLK_BENCH_SEQ_SECTORS, total, RT_FALSE, RT_FALSE);
+    /* random requests stay inside the same MB area, however small it is */
+    if (write)
+    {
+        blk_bench_run(dev, buf, start, total, BLK_BENCH_RND_SECTORS, BLK_BENCH_RND_COUNT * BLK_BENCH_RND_SECTORS,
+                      RT_TRUE, RT_TRUE);
+    }
+    blk_bench_run(dev, buf, start, total, BLK_BENCH_RND_SECTORS, BLK_BENCH_RND_COUNT * BLK_BENCH_RND_SECTORS,
+                  RT_FALSE, RT_TRUE);
+
+    rt_free_align(mem);
+    rt_device_close(dev);
+}
+MSH_CMD_EXPORT(blk_bench, block device throughput: blk_bench <device> [MB] [-w] [-u]);
+#endif /* RT_USING_FINSH */
+
 #endif /* RT_USING_SDIO */
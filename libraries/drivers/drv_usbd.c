@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2019-04-10     ZYH          first version
  * 2019-10-27     flybreak     Compatible with the HS
+ * 2025-03-01     RT-Thread    isochronous IN endpoint for the audio class
  */
 
 #include <rtthread.h>
@@ -30,6 +31,7 @@ static struct ep_id _ep_pool[] =
     {0x3,  USB_EP_ATTR_BULK,        USB_DIR_IN,     64, ID_UNASSIGNED},
 #if !defined(SOC_SERIES_STM32F1)
     {0x3,  USB_EP_ATTR_BULK,        USB_DIR_OUT,    64, ID_UNASSIGNED},
+    {0x4,  USB_EP_ATTR_ISOC,        USB_DIR_IN,     256, ID_UNASSIGNED},
 #endif
     {0xFF, USB_EP_ATTR_TYPE_MASK,   USB_DIR_MASK,   0,  ID_ASSIGNED  },
 };
@@ -67,6 +69,12 @@ void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
     }
 }
 
+/* the packet missed its frame and was flushed, report it done with nothing sent */
+void HAL_PCD_ISOINIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+    rt_usbd_ep_in_handler(&_stm_udc, 0x80 | epnum, 0);
+}
+
 void HAL_PCD_ConnectCallback(PCD_HandleTypeDef *hpcd)
 {
     rt_usbd_connect_handler(&_stm_udc);
@@ -139,8 +147,9 @@ static rt_err_t _ep_enable(uep_t ep)
 {
     RT_ASSERT(ep != RT_NULL);
     RT_ASSERT(ep->ep_desc != RT_NULL);
+    /* the attributes also carry the isochronous sync type */
     HAL_PCD_EP_Open(&_stm_pcd, ep->ep_desc->bEndpointAddress,
-                    ep->ep_desc->wMaxPacketSize, ep->ep_desc->bmAttributes);
+                    ep->ep_desc->wMaxPacketSize, USB_EP_ATTR(ep->ep_desc->bmAttributes));
     return RT_EOK;
 }
 
@@ -152,20 +161,20 @@ static rt_err_t _ep_disable(uep_t ep)
     return RT_EOK;
 }
 
-static rt_size_t _ep_read(rt_uint8_t address, void *buffer)
+static rt_ssize_t _ep_read(rt_uint8_t address, void *buffer)
 {
     rt_size_t size = 0;
     RT_ASSERT(buffer != RT_NULL);
     return size;
 }
 
-static rt_size_t _ep_read_prepare(rt_uint8_t address, void *buffer, rt_size_t size)
+static rt_ssize_t _ep_read_prepare(rt_uint8_t address, void *buffer, rt_size_t size)
 {
     HAL_PCD_EP_Receive(&_stm_pcd, address, buffer, size);
     return size;
 }
 
-static rt_size_t _ep_write(rt_uint8_t address, void *buffer, rt_size_t size)
+static rt_ssize_t _ep_write(rt_uint8_t address, void *buffer, rt_size_t size)
 {
     HAL_PCD_EP_Transmit(&_stm_pcd, address, buffer, size);
     return size;
@@ -196,7 +205,7 @@ static rt_err_t _init(rt_device_t device)
     memset(&pcd->Init, 0, sizeof pcd->Init);
     pcd->Init.dev_endpoints = 8;
     pcd->Init.speed = USBD_PCD_SPEED;
-    pcd->Init.ep0_mps = DEP0CTL_MPS_64;
+    pcd->Init.ep0_mps = EP_MPS_64;
 #if !defined(SOC_SERIES_STM32F1)
     pcd->Init.phy_itface = USBD_PCD_PHY_MODULE;
 #endif
@@ -211,6 +220,7 @@ static rt_err_t _init(rt_device_t device)
     HAL_PCDEx_SetTxFiFo(pcd, 1, 0x40);
     HAL_PCDEx_SetTxFiFo(pcd, 2, 0x40);
     HAL_PCDEx_SetTxFiFo(pcd, 3, 0x40);
+    HAL_PCDEx_SetTxFiFo(pcd, 4, 0x40);
 #else
     HAL_PCDEx_PMAConfig(pcd, 0x00, PCD_SNG_BUF, 0x18);
     HAL_PCDEx_PMAConfig(pcd, 0x80, PCD_SNG_BUF, 0x58);
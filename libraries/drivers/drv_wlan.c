@@ -10,6 +10,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-08-30     ZeroFree     the first version
+ * 2025-02-12     RT-Thread    read the firmware in place from memory-mapped NOR
  */
 
 #include <rtthread.h>
@@ -103,6 +104,69 @@ static const char wifi_nvram_image[] =
         "spurconfig=0x3"                                                     "\x00"
         "\x00\x00";
 
+#ifdef BSP_USING_WIFI_RESOURCE_XIP
+#ifndef BSP_WIFI_RESOURCE_XIP_BASE
+#define BSP_WIFI_RESOURCE_XIP_BASE       0x70000000
+#endif
+#define WIFI_XIP_VERIFY_SIZE             64
+
+/* memory-mapped view of the wifi_image partition, RT_NULL if not usable */
+static const rt_uint8_t *wifi_image_xip = RT_NULL;
+
+static void wifi_image_xip_init(void)
+{
+    const struct fal_flash_dev *flash;
+    const rt_uint8_t *addr;
+    rt_uint8_t head[WIFI_XIP_VERIFY_SIZE];
+
+    flash = fal_flash_device_find(partition->flash_name);
+    if (flash == RT_NULL)
+    {
+        return;
+    }
+    addr = (const rt_uint8_t *)(BSP_WIFI_RESOURCE_XIP_BASE + flash->addr + partition->offset);
+
+    /* make sure the mapping really shows this partition before trusting it */
+    if (fal_partition_read(partition, 0, head, sizeof(head)) < 0 ||
+        rt_memcmp(head, addr, sizeof(head)) != 0)
+    {
+        LOG_W("%s is not memory-mapped at 0x%08x, using copy read", WIFI_IMAGE_PARTITION_NAME, (rt_ubase_t)addr);
+        return;
+    }
+    wifi_image_xip = addr;
+}
+#endif /* BSP_USING_WIFI_RESOURCE_XIP */
+
+/**
+ * Zero-copy access to a resource block.
+ *
+ * Returns a pointer the caller may read (or feed to the SDMMC IDMA) in place,
+ * or RT_NULL when the block has to be fetched with wiced_platform_resource_read().
+ */
+const void *wiced_platform_resource_map(int resource, uint32_t offset, uint32_t size)
+{
+    if (resource == 0)
+    {
+#ifdef BSP_USING_WIFI_RESOURCE_XIP
+        /* IDMA needs word aligned addresses */
+        if (wifi_image_xip != RT_NULL && (offset + size) <= partition->len &&
+            (((rt_ubase_t)(wifi_image_xip + offset)) & 0x3) == 0)
+        {
+            return wifi_image_xip + offset;
+        }
+#endif
+    }
+    else if (resource == 1)
+    {
+        if ((offset + size) <= sizeof(wifi_nvram_image))
+        {
+            return &wifi_nvram_image[offset];
+        }
+    }
+
+    return RT_NULL;
+}
+
 int wiced_platform_resource_size(int resource)
 {
     int size = 0;
@@ -124,6 +188,13 @@ int wiced_platform_resource_read(int resource, uint32_t offset, void* buffer, ui
 {
     if (resource == 0)
     {
+#ifdef BSP_USING_WIFI_RESOURCE_XIP
+        if (wifi_image_xip != RT_NULL)
+        {
+            rt_memcpy(buffer, wifi_image_xip + offset, buffer_size);
+            return buffer_size;
+        }
+#endif
         /* read RF firmware from partition */
         fal_partition_read(partition, offset, buffer, buffer_size);
     }
@@ -200,8 +271,24 @@ static void wifi_init_thread_entry(void *parameter)
 
     if (rt_ota_part_fw_verify(partition) >= 0)
     {
+        rt_tick_t tick;
+        rt_size_t total, used, max_used;
+
+#ifdef BSP_USING_WIFI_RESOURCE_XIP
+        wifi_image_xip_init();
+#endif
+        tick = rt_tick_get();
         /* initialize low level wifi(ap6212) library */
         wifi_hw_init();
+        rt_memory_info(&total, &used, &max_used);
+        LOG_I("firmware download %d ms (%s), heap peak %d bytes",
+              (rt_tick_get() - tick) * 1000 / RT_TICK_PER_SECOND,
+#ifdef BSP_USING_WIFI_RESOURCE_XIP
+              wifi_image_xip ? "xip" : "copy",
+#else
+              "copy",
+#endif
+              max_used);
 
         /* waiting for sdio bus stability */
         rt_thread_delay(WIFI_INIT_WAIT_TIME);
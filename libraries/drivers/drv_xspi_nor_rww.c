@@ -0,0 +1,736 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-24     RT-Thread    first version
+ */
+
+/*
+ * Program and erase the NOR flash the firmware executes from (norflash0).
+ *
+ * XSPI2 either serves the memory-mapped window or sends commands, so every
+ * flash command runs from RAM with the interrupts masked and the window off.
+ * Such a window lasts at most BSP_XSPI_NOR_RWW_SLICE_US: a longer program or
+ * erase is suspended, the window restored and the interrupts unmasked, and
+ * the command is resumed in the next window. While it is suspended the code
+ * keeps executing in place; only the block being erased reads back wrong, so
+ * the partition reads take the same lock as the writes.
+ *
+ * Interrupts with a priority above BSP_XSPI_NOR_RWW_IRQ_PRIORITY stay enabled
+ * in the windows. The vector table is then copied to RAM, and their handlers
+ * must be in RAM as well (XSPI_NOR_RAMFUNC).
+ *
+ * The commands use the instruction, address and data formats of the
+ * memory-mapped read the bootloader set up, so the same code runs in SPI and
+ * in octal DTR mode.
+ */
+
+#include <rtthread.h>
+#include <rthw.h>
+#include <fal.h>
+#include "drv_xspi_nor_rww.h"
+
+#ifdef BSP_USING_XSPI_NOR_RWW
+
+#define DBG_TAG "drv.nor_rww"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+
+#ifndef BSP_XSPI_NOR_MMAP_BASE
+#define BSP_XSPI_NOR_MMAP_BASE      0x70000000
+#endif
+
+#define NOR_PAGE_SIZE               256
+#define NOR_SECTOR_SIZE             4096
+#define NOR_BLOCK_SIZE              (64 * 1024)
+
+#define NOR_CMD_WRITE_ENABLE        0x06
+#define NOR_CMD_READ_STATUS         0x05
+#define NOR_CMD_PAGE_PROG           0x02
+#define NOR_CMD_PAGE_PROG_4B        0x12
+#define NOR_CMD_ERASE_4K            0x20
+#define NOR_CMD_ERASE_4K_4B         0x21
+#define NOR_CMD_ERASE_64K           0xD8
+#define NOR_CMD_ERASE_64K_4B        0xDC
+#ifdef BSP_XSPI_NOR_RWW_MX66UW1G45G
+#define NOR_FLASH_SIZE              (128 * 1024 * 1024)
+#define NOR_CMD_SUSPEND             0xB0
+#define NOR_CMD_RESUME              0x30
+#else
+#define NOR_FLASH_SIZE              (64 * 1024 * 1024)
+#define NOR_CMD_SUSPEND             0x75
+#define NOR_CMD_RESUME              0x7A
+#endif
+#define NOR_SR_WIP                  0x01
+
+/*
+ * The firmware image (QFLASH in link.lds, LR_IROM1 in link.sct) executes
+ * from the first 8 MB, it is never programmed or erased here. The partitions
+ * in fal_cfg.h start after it.
+ */
+#define NOR_FIRMWARE_SIZE           (8 * 1024 * 1024)
+
+/* dummy cycles of a register read, as in the component drivers */
+#define NOR_REG_DUMMY_OCTAL         4
+#define NOR_REG_DUMMY_OCTAL_DTR     8
+
+#define NOR_PROG_TIMEOUT_MS         10
+#define NOR_ERASE_TIMEOUT_MS        2000
+#define NOR_SUSPEND_TIMEOUT_US      100
+
+/* system exceptions and the interrupts up to FDCAN2_IT1 */
+#define NOR_VECTORS                 (16 + FDCAN2_IT1_IRQn + 1)
+
+#define NOR_MMAP(addr)              ((const rt_uint8_t *)(BSP_XSPI_NOR_MMAP_BASE + (addr)))
+
+enum nor_op_state
+{
+    NOR_OP_START,
+    NOR_OP_RUNNING,
+    NOR_OP_SUSPENDED,
+    NOR_OP_DONE,
+    NOR_OP_ERROR,
+};
+
+struct nor_op
+{
+    rt_uint8_t cmd;
+    rt_uint32_t addr;
+    rt_uint8_t *data;               /* page in RAM, RT_NULL for an erase */
+    rt_uint32_t size;
+    rt_uint32_t slice;              /* cycles, 0 never suspends */
+    rt_uint32_t timeout;            /* cycles in one window */
+    int state;
+};
+
+/* the memory-mapped read configuration, and the phases the commands reuse */
+static struct
+{
+    rt_uint32_t cr, ccr, tcr, ir;
+    rt_uint32_t ccr_inst;
+    rt_uint32_t ccr_addr;
+    rt_uint32_t ccr_data;
+    rt_bool_t octal;                /* 16 bit instructions */
+    rt_bool_t inverted;             /* the second instruction byte is the complement */
+    rt_bool_t addr_4b;
+    rt_bool_t dtr;
+} _xspi;
+
+static struct rt_mutex _nor_lock;
+static rt_bool_t _nor_inited = RT_FALSE;
+static rt_uint8_t _nor_page[NOR_PAGE_SIZE] rt_align(4);
+static rt_uint8_t _nor_old[NOR_PAGE_SIZE];
+static rt_uint32_t _cycles_per_us;
+static rt_uint32_t _slice_cycles;
+static struct xspi_nor_rww_stats _stats;
+static rt_uint32_t _max_window_cycles;
+
+#if BSP_XSPI_NOR_RWW_IRQ_PRIORITY > 0
+static rt_uint32_t _ram_vectors[NOR_VECTORS] rt_align(1024);
+#endif
+
+/* ==================== RAM: runs with the XIP window off ==================== */
+
+XSPI_NOR_RAMFUNC static rt_uint32_t _irq_mask(void)
+{
+#if BSP_XSPI_NOR_RWW_IRQ_PRIORITY > 0
+    rt_uint32_t level = __get_BASEPRI();
+
+    __set_BASEPRI_MAX(BSP_XSPI_NOR_RWW_IRQ_PRIORITY << (8 - __NVIC_PRIO_BITS));
+#else
+    rt_uint32_t level = __get_PRIMASK();
+
+    __disable_irq();
+#endif
+    __DSB();
+    __ISB();
+    return level;
+}
+
+XSPI_NOR_RAMFUNC static void _irq_unmask(rt_uint32_t level)
+{
+#if BSP_XSPI_NOR_RWW_IRQ_PRIORITY > 0
+    __set_BASEPRI(level);
+#else
+    __set_PRIMASK(level);
+#endif
+}
+
+XSPI_NOR_RAMFUNC static void _xspi_wait_idle(void)
+{
+    while (XSPI2->SR & XSPI_SR_BUSY);
+}
+
+XSPI_NOR_RAMFUNC static void _xspi_mmap_off(void)
+{
+    __DSB();
+    XSPI2->CR |= XSPI_CR_ABORT;
+    while (XSPI2->CR & XSPI_CR_ABORT);
+    _xspi_wait_idle();
+    XSPI2->CR &= ~XSPI_CR_FMODE_Msk;
+}
+
+XSPI_NOR_RAMFUNC static void _xspi_mmap_on(void)
+{
+    _xspi_wait_idle();
+    XSPI2->CR = _xspi.cr & ~XSPI_CR_FMODE_Msk;
+    XSPI2->CCR = _xspi.ccr;
+    XSPI2->TCR = _xspi.tcr;
+    XSPI2->IR = _xspi.ir;
+    XSPI2->CR = _xspi.cr;
+    __DSB();
+    __ISB();
+}
+
+/*
+ * One command in indirect mode. A program writes the data; with read set the
+ * data is read back (status register), after the register dummy cycles.
+ */
+XSPI_NOR_RAMFUNC static void _xspi_command(rt_uint8_t cmd, rt_bool_t with_addr, rt_uint32_t addr,
+                                           rt_uint8_t *data, rt_uint32_t size, rt_bool_t read)
+{
+    volatile rt_uint8_t *dr = (volatile rt_uint8_t *)&XSPI2->DR;
+    rt_uint32_t ccr = _xspi.ccr_inst;
+    rt_uint32_t inst = cmd;
+    rt_uint32_t i;
+
+    if (_xspi.octal)
+    {
+        inst = (inst << 8) | (rt_uint8_t)(_xspi.inverted ? ~cmd : cmd);
+    }
+    if (with_addr)
+    {
+        ccr |= _xspi.ccr_addr;
+    }
+    if (size)
+    {
+        ccr |= _xspi.ccr_data;
+        if (read && _xspi.dtr)
+        {
+            ccr |= XSPI_CCR_DQSE;
+        }
+    }
+
+    _xspi_wait_idle();
+    XSPI2->CR = (XSPI2->CR & ~XSPI_CR_FMODE_Msk) | (read ? XSPI_CR_FMODE_0 : 0);
+    if (size)
+    {
+        XSPI2->DLR = size - 1;
+    }
+    XSPI2->CCR = ccr;
+    XSPI2->TCR = (read && _xspi.octal) ? (_xspi.dtr ? NOR_REG_DUMMY_OCTAL_DTR : NOR_REG_DUMMY_OCTAL) : 0;
+    XSPI2->IR = inst;
+    if (with_addr)
+    {
+        XSPI2->AR = addr;
+    }
+
+    for (i = 0; i < size; i++)
+    {
+        while (!(XSPI2->SR & (XSPI_SR_FTF | XSPI_SR_TCF)));
+        if (read)
+            data[i] = *dr;
+        else
+            *dr = data[i];
+    }
+    while (!(XSPI2->SR & XSPI_SR_TCF));
+    XSPI2->FCR = XSPI_FCR_CTCF;
+}
+
+XSPI_NOR_RAMFUNC static rt_uint8_t _nor_status(void)
+{
+    rt_uint8_t sr[2];
+
+    /* the octal status read carries an address, DTR reads a byte on each edge */
+    _xspi_command(NOR_CMD_READ_STATUS, _xspi.octal, 0, sr, _xspi.dtr ? 2 : 1, RT_TRUE);
+    return sr[0];
+}
+
+/*
+ * Suspend the running command. The window may only be turned back on with
+ * the flash idle: a suspend that does not take is waited out for the time
+ * the whole command may need, and a chip still busy after that would fault
+ * the first fetch from the window, so the system is reset from RAM instead.
+ */
+XSPI_NOR_RAMFUNC static void _nor_suspend(struct nor_op *op)
+{
+    rt_uint32_t wait;
+
+    _xspi_command(NOR_CMD_SUSPEND, RT_FALSE, 0, RT_NULL, 0, RT_FALSE);
+    wait = DWT->CYCCNT;
+    while (_nor_status() & NOR_SR_WIP)
+    {
+        if (DWT->CYCCNT - wait >= NOR_SUSPEND_TIMEOUT_US * _cycles_per_us)
+        {
+            op->state = NOR_OP_ERROR;
+            break;
+        }
+    }
+
+    wait = DWT->CYCCNT;
+    while (_nor_status() & NOR_SR_WIP)
+    {
+        if (DWT->CYCCNT - wait >= op->timeout)
+        {
+            NVIC_SystemReset();
+        }
+    }
+}
+
+/*
+ * One window with the XIP off: start or resume the command, run it for a
+ * slice. Returns the cycles the interrupts were masked, the longest is kept.
+ * The window is only turned back on with the flash idle, finished or
+ * suspended.
+ */
+XSPI_NOR_RAMFUNC static rt_uint32_t _nor_window(struct nor_op *op)
+{
+    rt_uint32_t level, start, elapsed;
+
+    level = _irq_mask();
+    start = DWT->CYCCNT;
+    _xspi_mmap_off();
+
+    if (op->state == NOR_OP_START)
+    {
+        _xspi_command(NOR_CMD_WRITE_ENABLE, RT_FALSE, 0, RT_NULL, 0, RT_FALSE);
+        _xspi_command(op->cmd, RT_TRUE, op->addr, op->data, op->size, RT_FALSE);
+    }
+    else
+    {
+        _xspi_command(NOR_CMD_RESUME, RT_FALSE, 0, RT_NULL, 0, RT_FALSE);
+    }
+    op->state = NOR_OP_RUNNING;
+
+    while (_nor_status() & NOR_SR_WIP)
+    {
+        elapsed = DWT->CYCCNT - start;
+        /* the slice first, a long slice must not turn into a timeout */
+        if (op->slice && elapsed >= op->slice)
+        {
+            op->state = NOR_OP_SUSPENDED;
+            _nor_suspend(op);
+            break;
+        }
+        if (elapsed >= op->timeout)
+        {
+            /* the flash never finished, stop it before the window comes back */
+            _nor_suspend(op);
+            op->state = NOR_OP_ERROR;
+            break;
+        }
+    }
+    if (op->state == NOR_OP_RUNNING)
+    {
+        op->state = NOR_OP_DONE;
+    }
+
+    _xspi_mmap_on();
+    start = DWT->CYCCNT - start;
+    if (start > _max_window_cycles)
+    {
+        _max_window_cycles = start;
+    }
+    _irq_unmask(level);
+
+    return start;
+}
+
+/* ==================== thread side ==================== */
+
+static void _nor_invalidate(rt_uint32_t addr, rt_uint32_t size)
+{
+    rt_uint32_t start = RT_ALIGN_DOWN(BSP_XSPI_NOR_MMAP_BASE + addr, 32);
+    rt_uint32_t end = RT_ALIGN(BSP_XSPI_NOR_MMAP_BASE + addr + size, 32);
+
+    SCB_InvalidateDCache_by_Addr((void *)start, end - start);
+}
+
+/*
+ * Run a command to completion. Between the windows the thread sleeps for a
+ * tick, so threads of any priority and the interrupts run while the command
+ * is suspended.
+ */
+static int _nor_run(struct nor_op *op, rt_uint32_t timeout_ms)
+{
+    rt_uint32_t busy = 0;
+
+    op->state = NOR_OP_START;
+    op->slice = _slice_cycles;
+    op->timeout = timeout_ms * 1000 * _cycles_per_us;
+
+    while (1)
+    {
+        busy += _nor_window(op);
+        _stats.windows++;
+        if (op->state != NOR_OP_SUSPENDED)
+        {
+            break;
+        }
+        _stats.suspends++;
+
+        /* only the time in the windows counts, the flash does not progress while suspended */
+        if (busy >= op->timeout)
+        {
+            op->state = NOR_OP_ERROR;
+            break;
+        }
+        rt_thread_mdelay(1);
+    }
+
+    if (op->state != NOR_OP_DONE)
+    {
+        LOG_E("command 0x%02x at 0x%08x failed", op->cmd, op->addr);
+        return -RT_EIO;
+    }
+    return RT_EOK;
+}
+
+int xspi_nor_rww_read(rt_uint32_t addr, void *buf, rt_size_t size)
+{
+    if (!_nor_inited || addr + size > NOR_FLASH_SIZE)
+    {
+        return -RT_EINVAL;
+    }
+
+    rt_mutex_take(&_nor_lock, RT_WAITING_FOREVER);
+    rt_memcpy(buf, NOR_MMAP(addr), size);
+    rt_mutex_release(&_nor_lock);
+
+    return size;
+}
+
+static rt_bool_t _nor_verify(const rt_uint8_t *flash, const rt_uint8_t *old, const rt_uint8_t *data, rt_uint32_t size)
+{
+    rt_uint32_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (flash[i] != (old[i] & data[i]))
+        {
+            return RT_FALSE;
+        }
+    }
+    return RT_TRUE;
+}
+
+int xspi_nor_rww_write(rt_uint32_t addr, const void *buf, rt_size_t size)
+{
+    const rt_uint8_t *src = (const rt_uint8_t *)buf;
+    struct nor_op op;
+    rt_uint32_t chunk, lo, hi;
+    rt_size_t done = 0;
+    int ret = RT_EOK;
+
+    if (!_nor_inited || addr < NOR_FIRMWARE_SIZE || addr + size > NOR_FLASH_SIZE)
+    {
+        return -RT_EINVAL;
+    }
+
+    rt_mutex_take(&_nor_lock, RT_WAITING_FOREVER);
+    while (done < size)
+    {
+        chunk = NOR_PAGE_SIZE - (addr + done) % NOR_PAGE_SIZE;
+        if (chunk > size - done)
+        {
+            chunk = size - done;
+        }
+
+        /* DTR programs whole 16 bit words, 0xFF leaves a byte unchanged */
+        lo = _xspi.dtr ? (addr + done) & 1 : 0;
+        hi = _xspi.dtr ? (lo + chunk) & 1 : 0;
+        _nor_page[0] = 0xFF;
+        if (hi)
+        {
+            _nor_page[lo + chunk] = 0xFF;
+        }
+        /* the source may be in the XIP window too, which is off during the command */
+        rt_memcpy(_nor_page + lo, src + done, chunk);
+        /* programming only clears bits, the page then holds old & new */
+        rt_memcpy(_nor_old, NOR_MMAP(addr + done), chunk);
+
+        op.cmd = _xspi.addr_4b ? NOR_CMD_PAGE_PROG_4B : NOR_CMD_PAGE_PROG;
+        op.addr = addr + done - lo;
+        op.data = _nor_page;
+        op.size = lo + chunk + hi;
+        ret = _nor_run(&op, NOR_PROG_TIMEOUT_MS);
+        _nor_invalidate(addr + done, chunk);
+        if (ret == RT_EOK && !_nor_verify(NOR_MMAP(addr + done), _nor_old, _nor_page + lo, chunk))
+        {
+            LOG_E("program verify failed at 0x%08x", addr + done);
+            ret = -RT_EIO;
+        }
+        if (ret != RT_EOK)
+        {
+            break;
+        }
+        _stats.programs++;
+        done += chunk;
+    }
+    rt_mutex_release(&_nor_lock);
+
+    return ret == RT_EOK ? (int)size : ret;
+}
+
+static rt_bool_t _nor_blank(rt_uint32_t addr, rt_uint32_t size)
+{
+    const rt_uint32_t *p = (const rt_uint32_t *)NOR_MMAP(addr);
+    rt_uint32_t i;
+
+    for (i = 0; i < size / 4; i++)
+    {
+        if (p[i] != 0xFFFFFFFF)
+        {
+            return RT_FALSE;
+        }
+    }
+    return RT_TRUE;
+}
+
+int xspi_nor_rww_erase(rt_uint32_t addr, rt_size_t size)
+{
+    rt_uint32_t end = addr + size, len;
+    struct nor_op op;
+    rt_tick_t start;
+    int ret = RT_EOK;
+
+    if (!_nor_inited || addr < NOR_FIRMWARE_SIZE || end > NOR_FLASH_SIZE)
+    {
+        return -RT_EINVAL;
+    }
+
+    rt_mutex_take(&_nor_lock, RT_WAITING_FOREVER);
+    addr = RT_ALIGN_DOWN(addr, NOR_SECTOR_SIZE);
+    while (addr < end)
+    {
+        /* a 64 KB block erases in about the time of three 4 KB sectors */
+        if (addr % NOR_BLOCK_SIZE == 0 && end - addr >= NOR_BLOCK_SIZE)
+        {
+            len = NOR_BLOCK_SIZE;
+            op.cmd = _xspi.addr_4b ? NOR_CMD_ERASE_64K_4B : NOR_CMD_ERASE_64K;
+        }
+        else
+        {
+            len = NOR_SECTOR_SIZE;
+            op.cmd = _xspi.addr_4b ? NOR_CMD_ERASE_4K_4B : NOR_CMD_ERASE_4K;
+        }
+        op.addr = addr;
+        op.data = RT_NULL;
+        op.size = 0;
+
+        start = rt_tick_get();
+        ret = _nor_run(&op, NOR_ERASE_TIMEOUT_MS);
+        start = rt_tick_get() - start;
+        if (start * 1000 / RT_TICK_PER_SECOND > _stats.max_erase_ms)
+        {
+            _stats.max_erase_ms = start * 1000 / RT_TICK_PER_SECOND;
+        }
+        _nor_invalidate(addr, len);
+        if (ret == RT_EOK && !_nor_blank(addr, len))
+        {
+            LOG_E("erase verify failed at 0x%08x", addr);
+            ret = -RT_EIO;
+        }
+        if (ret != RT_EOK)
+        {
+            break;
+        }
+        _stats.erases++;
+        addr += len;
+    }
+    rt_mutex_release(&_nor_lock);
+
+    return ret == RT_EOK ? (int)size : ret;
+}
+
+void xspi_nor_rww_get_stats(struct xspi_nor_rww_stats *stats)
+{
+    *stats = _stats;
+    stats->max_window_us = _cycles_per_us ? _max_window_cycles / _cycles_per_us : 0;
+}
+
+void xspi_nor_rww_reset_stats(void)
+{
+    rt_memset(&_stats, 0, sizeof(_stats));
+    _max_window_cycles = 0;
+}
+
+/* ==================== FAL device ==================== */
+
+static int _nor_init(void)
+{
+    if (_nor_inited)
+    {
+        return 0;
+    }
+
+    if ((XSPI2->CR & XSPI_CR_FMODE_Msk) != XSPI_CR_FMODE_Msk)
+    {
+        LOG_E("XSPI2 is not in memory-mapped mode");
+        return -RT_ERROR;
+    }
+    _xspi.cr = XSPI2->CR;
+    _xspi.ccr = XSPI2->CCR;
+    _xspi.tcr = XSPI2->TCR;
+    _xspi.ir = XSPI2->IR;
+    _xspi.ccr_inst = _xspi.ccr & (XSPI_CCR_IMODE_Msk | XSPI_CCR_IDTR | XSPI_CCR_ISIZE_Msk);
+    _xspi.ccr_addr = _xspi.ccr & (XSPI_CCR_ADMODE_Msk | XSPI_CCR_ADDTR | XSPI_CCR_ADSIZE_Msk);
+    _xspi.ccr_data = _xspi.ccr & (XSPI_CCR_DMODE_Msk | XSPI_CCR_DDTR);
+    _xspi.octal = (_xspi.ccr & XSPI_CCR_ISIZE_Msk) == XSPI_CCR_ISIZE_0;
+    _xspi.inverted = ((_xspi.ir ^ (_xspi.ir >> 8)) & 0xFF) == 0xFF;
+    _xspi.addr_4b = (_xspi.ccr & XSPI_CCR_ADSIZE_Msk) == XSPI_CCR_ADSIZE_Msk;
+    _xspi.dtr = (_xspi.ccr & XSPI_CCR_DDTR) != 0;
+
+    /* the windows are timed with the cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    _cycles_per_us = SystemCoreClock / 1000000;
+    _slice_cycles = BSP_XSPI_NOR_RWW_SLICE_US * _cycles_per_us;
+
+#if BSP_XSPI_NOR_RWW_IRQ_PRIORITY > 0
+    /* the interrupts left enabled need their vectors while the window is off */
+    if (SCB->VTOR >= BSP_XSPI_NOR_MMAP_BASE && SCB->VTOR < BSP_XSPI_NOR_MMAP_BASE + NOR_FLASH_SIZE)
+    {
+        rt_base_t level;
+
+        rt_memcpy(_ram_vectors, (const void *)SCB->VTOR, sizeof(_ram_vectors));
+        SCB_CleanDCache_by_Addr(_ram_vectors, sizeof(_ram_vectors));
+        level = rt_hw_interrupt_disable();
+        SCB->VTOR = (rt_uint32_t)_ram_vectors;
+        __DSB();
+        __ISB();
+        rt_hw_interrupt_enable(level);
+    }
+#endif
+
+    rt_mutex_init(&_nor_lock, "nor_rww", RT_IPC_FLAG_PRIO);
+    _nor_inited = RT_TRUE;
+    LOG_I("%s mode, %d bit address, windows up to %d us", _xspi.octal ? (_xspi.dtr ? "octal DTR" : "octal") : "SPI",
+          _xspi.addr_4b ? 32 : 24, BSP_XSPI_NOR_RWW_SLICE_US);
+
+    return 0;
+}
+
+static int _nor_read(long offset, rt_uint8_t *buf, rt_size_t size);
+static int _nor_write(long offset, const rt_uint8_t *buf, rt_size_t size);
+static int _nor_erase(long offset, rt_size_t size);
+
+struct fal_flash_dev nor_flash0 =
+{
+    .name       = NOR_FLASH_DEV_NAME,
+    .addr       = 0,
+    .len        = NOR_FLASH_SIZE,
+    .blk_size   = NOR_SECTOR_SIZE,
+    .ops        = {_nor_init, _nor_read, _nor_write, _nor_erase},
+    .write_gran = 1
+};
+
+static int _nor_read(long offset, rt_uint8_t *buf, rt_size_t size)
+{
+    return xspi_nor_rww_read(nor_flash0.addr + offset, buf, size);
+}
+
+static int _nor_write(long offset, const rt_uint8_t *buf, rt_size_t size)
+{
+    return xspi_nor_rww_write(nor_flash0.addr + offset, buf, size);
+}
+
+static int _nor_erase(long offset, rt_size_t size)
+{
+    return xspi_nor_rww_erase(nor_flash0.addr + offset, size);
+}
+
+/* ==================== msh ==================== */
+
+#ifdef RT_USING_FINSH
+#include <stdlib.h>
+
+#define NOR_BENCH_SIZE      NOR_BLOCK_SIZE
+
+/* timed with the cycle counter, the tick stops in a long window */
+static void _nor_bench_report(const char *name, rt_uint32_t cycles)
+{
+    struct xspi_nor_rww_stats stats;
+
+    xspi_nor_rww_get_stats(&stats);
+    rt_kprintf("%-18s %5u ms, interrupts masked up to %6u us, %u windows, %u suspends\n", name,
+               cycles / _cycles_per_us / 1000, stats.max_window_us, stats.windows, stats.suspends);
+    xspi_nor_rww_reset_stats();
+}
+
+/* erase and program the last 64 KB block of a partition, sliced and in one window */
+static void _nor_bench(const char *name)
+{
+    const struct fal_partition *part = fal_partition_find(name);
+    rt_uint32_t addr, slice, i;
+    rt_uint8_t *buf;
+    rt_uint32_t start;
+
+    if (part == RT_NULL || rt_strcmp(part->flash_name, NOR_FLASH_DEV_NAME) != 0 || part->len < NOR_BENCH_SIZE)
+    {
+        rt_kprintf("%s is not a partition of %s with 64 KB\n", name, NOR_FLASH_DEV_NAME);
+        return;
+    }
+    buf = rt_malloc(NOR_BENCH_SIZE);
+    if (buf == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        return;
+    }
+    for (i = 0; i < NOR_BENCH_SIZE; i++)
+    {
+        buf[i] = (rt_uint8_t)(i * 7 + (i >> 8));
+    }
+    addr = nor_flash0.addr + RT_ALIGN_DOWN(part->offset + part->len - NOR_BENCH_SIZE, NOR_BLOCK_SIZE);
+    slice = _slice_cycles;
+    xspi_nor_rww_reset_stats();
+
+    rt_kprintf("%s, 64 KB at 0x%08x, slices of %d us\n", name, addr, BSP_XSPI_NOR_RWW_SLICE_US);
+    start = DWT->CYCCNT;
+    xspi_nor_rww_erase(addr, NOR_BENCH_SIZE);
+    _nor_bench_report("erase 64 KB", DWT->CYCCNT - start);
+
+    start = DWT->CYCCNT;
+    xspi_nor_rww_write(addr, buf, NOR_BENCH_SIZE);
+    _nor_bench_report("program 64 KB", DWT->CYCCNT - start);
+
+    /* the same without suspending, as every erase ran before */
+    _slice_cycles = 0;
+    start = DWT->CYCCNT;
+    xspi_nor_rww_erase(addr, NOR_BENCH_SIZE);
+    _nor_bench_report("erase, one window", DWT->CYCCNT - start);
+    _slice_cycles = slice;
+
+    rt_free(buf);
+}
+
+static void nor_rww(int argc, char **argv)
+{
+    struct xspi_nor_rww_stats stats;
+
+    if (argc >= 2 && rt_strcmp(argv[1], "stat") == 0)
+    {
+        xspi_nor_rww_get_stats(&stats);
+        rt_kprintf("programs %u, erases %u, windows %u, suspends %u\n",
+                   stats.programs, stats.erases, stats.windows, stats.suspends);
+        rt_kprintf("interrupts masked up to %u us, longest erase %u ms\n",
+                   stats.max_window_us, stats.max_erase_ms);
+    }
+    else if (argc == 4 && rt_strcmp(argv[1], "bench") == 0 && rt_strcmp(argv[3], "yes") == 0)
+    {
+        _nor_bench(argv[2]);
+    }
+    else
+    {
+        rt_kprintf("Usage:\n");
+        rt_kprintf("nor_rww stat              - program/erase statistics\n");
+        rt_kprintf("nor_rww bench <part> yes  - erase and program the last 64 KB of <part>\n");
+    }
+}
+MSH_CMD_EXPORT(nor_rww, XIP NOR program/erase service: nor_rww <stat|bench>);
+#endif /* RT_USING_FINSH */
+
+#endif /* BSP_USING_XSPI_NOR_RWW */
@@ -6,11 +6,20 @@
  * Change Logs:
  * Date           Author       Notes
  * 2024-10-11     stackyuan  the first version
+ * 2025-02-15     RT-Thread  report memory-mapped partitions for zero-copy send
+ * 2025-02-24     RT-Thread  no zero-copy send with the program/erase service
  */
 
 #include <rtthread.h>
 #include <rtdevice.h>
 #include <fal.h>
+
+/* XSPI2 memory-mapped window of the NOR flash */
+#ifndef BSP_XSPI_NOR_MMAP_BASE
+#define BSP_XSPI_NOR_MMAP_BASE      0x70000000
+#endif
+#define NOR_MMAP_VERIFY_SIZE        32
+
 static int rt_norflash_init(void)
 {
 //    extern rt_spi_flash_device_t rt_sfud_flash_probe(const char *spi_flash_dev_name, const char *spi_dev_name);
@@ -28,3 +37,29 @@ static int rt_norflash_init(void)
 #ifndef FIRMWARE_EXEC_USING_QEMU
 INIT_ENV_EXPORT(rt_norflash_init);
 #endif
+
+/* the Ethernet DMA must not read the window while drv_xspi_nor_rww.c has it off */
+#if defined(RT_USING_SAL) && !defined(BSP_USING_XSPI_NOR_RWW)
+/* used by sal_sendfile_fal() to reference flash contents instead of copying them */
+const void *sal_fal_partition_map(const struct fal_partition *part)
+{
+    const struct fal_flash_dev *flash;
+    const rt_uint8_t *addr;
+    rt_uint8_t head[NOR_MMAP_VERIFY_SIZE];
+
+    flash = fal_flash_device_find(part->flash_name);
+    if (flash == RT_NULL || rt_strcmp(flash->name, "norflash0") != 0)
+    {
+        return RT_NULL;
+    }
+    addr = (const rt_uint8_t *)(BSP_XSPI_NOR_MMAP_BASE + flash->addr + part->offset);
+
+    /* only trust the window if it shows the same bytes as the FAL read path */
+    if (fal_partition_read(part, 0, head, sizeof(head)) < 0 || rt_memcmp(head, addr, sizeof(head)) != 0)
+    {
+        return RT_NULL;
+    }
+
+    return addr;
+}
+#endif /* RT_USING_SAL && !BSP_USING_XSPI_NOR_RWW */
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-27     RT-Thread     first version
+ */
+
+/*
+ * CIC decimator for the ADC stream: N integrators at the input rate, the
+ * rate reduced by R, N combs with a differential delay of one at the output
+ * rate, and the gain of R^N taken out of the result. Order 1 is a boxcar
+ * average of R samples. Integer only, with modulo 2^32 registers, so the
+ * input bits plus N * log2(R) must fit in 32 bits.
+ *
+ * The first N outputs after a reset are the filter filling up.
+ */
+
+#ifndef __ADC_DECIM_H__
+#define __ADC_DECIM_H__
+
+#include <stdint.h>
+
+#define ADC_DECIM_ORDER_MAX     4
+#define ADC_DECIM_RATIO_MAX     1024
+
+struct adc_decim
+{
+    uint8_t order;
+    uint8_t frac_bits;          /* bits of resolution kept below the input LSB */
+    int8_t gain_log2;           /* log2(R^N) when R is a power of two, else -1 */
+    uint16_t ratio;
+    uint16_t phase;
+    uint32_t gain;              /* R^N */
+    uint32_t integ[ADC_DECIM_ORDER_MAX];
+    uint32_t comb[ADC_DECIM_ORDER_MAX];
+};
+
+/* 0, or -1 when the orders, ratio and bits do not fit the registers */
+int adc_decim_init(struct adc_decim *d, int order, int ratio, int in_bits, int frac_bits);
+void adc_decim_reset(struct adc_decim *d);
+/*
+ * Filter n samples taken every stride elements of in (one channel of an
+ * interleaved scan), store an output every out_stride elements of out.
+ * Returns the number of outputs, which depends on the phase left by the
+ * previous call: n / R, rounded either way.
+ */
+int adc_decim_process(struct adc_decim *d, const uint16_t *in, int stride, int n,
+                      int32_t *out, int out_stride);
+/* compare with a direct moving-sum implementation, returns the failures */
+int adc_decim_selftest(void);
+
+#endif /* __ADC_DECIM_H__ */
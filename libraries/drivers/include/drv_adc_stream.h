@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-27     RT-Thread     first version
+ */
+
+#ifndef __DRV_ADC_STREAM_H__
+#define __DRV_ADC_STREAM_H__
+
+#include <rtthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADC_STREAM_CHANNELS_MAX     16
+
+/* block flags */
+#define ADC_STREAM_BLOCK_START      0x01    /* first block after a start: the decimators are filling up */
+#define ADC_STREAM_BLOCK_GAP        0x02    /* blocks were dropped or the ADC overran just before this one */
+
+struct adc_stream_config
+{
+    rt_uint8_t channels;
+    rt_uint8_t channel[ADC_STREAM_CHANNELS_MAX];     /* ADC1 inputs in scan order */
+    rt_base_t pin[ADC_STREAM_CHANNELS_MAX];         /* set to analog, -1 for internal inputs */
+    rt_uint32_t rate;                               /* scans per second */
+    rt_uint8_t order;                               /* CIC order, 1 is a boxcar average */
+    rt_uint16_t ratio;                              /* scans per output frame */
+    rt_uint8_t frac_bits;                           /* resolution kept below the ADC LSB */
+    rt_uint16_t block_frames;                       /* output frames per block */
+    rt_uint16_t blocks;                             /* blocks in the ring */
+};
+
+struct adc_stream_block
+{
+    rt_uint32_t seq;                /* blocks since the start, dropped ones included */
+    rt_uint32_t flags;
+    rt_uint64_t frame;              /* first frame, counted from the start */
+    rt_uint64_t timestamp_us;       /* of the first frame, from the scan timer, since the start */
+    rt_uint16_t frames;
+    rt_uint8_t channels;
+    rt_int32_t *data;               /* frames x channels, interleaved */
+};
+
+struct adc_stream_stats
+{
+    rt_tick_t start_tick;           /* relates timestamp_us to the system time */
+    rt_uint32_t scan_rate;          /* as the timer runs, in Hz */
+    rt_uint64_t scans;
+    rt_uint32_t blocks;             /* committed */
+    rt_uint32_t dropped;            /* the reader was behind, the ring was full */
+    rt_uint32_t adc_overruns;       /* the DMA was late, the stream restarted */
+    rt_uint32_t dma_errors;
+    rt_uint64_t isr_cycles;         /* CPU cycles spent in the half-transfer callbacks */
+    rt_uint32_t isr_max_cycles;
+};
+
+/* cfg RT_NULL: the scan and rates from the Kconfig */
+rt_err_t adc_stream_start(const struct adc_stream_config *cfg);
+rt_err_t adc_stream_stop(void);
+/* the oldest committed block, RT_NULL on timeout or when stopped */
+struct adc_stream_block *adc_stream_read(rt_int32_t timeout);
+/* hand the block from adc_stream_read() back to the ring */
+void adc_stream_release(struct adc_stream_block *block);
+void adc_stream_get_stats(struct adc_stream_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DRV_ADC_STREAM_H__ */
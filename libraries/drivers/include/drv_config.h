@@ -116,6 +116,7 @@ extern "C" {
 #elif  defined(SOC_SERIES_STM32H7RS)
 #include "config/uart_config.h"
 #include "config/spi_config.h"
+#include "config/usbd_config.h"
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-14     RT-Thread    first version for STM32H7RS CRYP/HASH/PKA/RNG/CRC
+ */
+
+#ifndef __DRV_CRYPTO_H__
+#define __DRV_CRYPTO_H__
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <board.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* words saved by HAL_HASH_Suspend(): IMR, STR, CR and the 103 CSR registers */
+#define HASH_CONTEXT_WORDS      (3 + 103)
+
+struct stm32_hwcrypto_device
+{
+    struct rt_hwcrypto_device dev;
+    struct rt_mutex mutex;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DRV_CRYPTO_H__ */
@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2020-02-24     heyuan       the first version
  * 2020-08-17     malongwei    Fix something
+ * 2025-02-28     RT-Thread    port to the H7RS message RAM, TX FIFO, timestamps, statistics
  */
 
 #ifndef __DRV_FDCAN_H__
@@ -21,27 +22,35 @@
 extern "C" {
 #endif
 
+/* the message RAM of this part has a fixed layout: 3 elements per FIFO */
+#define FDCAN_TX_FIFO_ELEMENTS  3
+
+struct stm32_fdcan_stats
+{
+    rt_uint32_t rx_irqs;            /* receive interrupts */
+    rt_uint32_t rx_frames;          /* frames taken out of the message RAM */
+    rt_uint32_t rx_batch_max;       /* most frames taken in one interrupt */
+    rt_uint32_t rx_lost;            /* interrupts that found a FIFO had overrun */
+    rt_uint64_t rx_cycles;          /* CPU cycles in the receive interrupt */
+    rt_uint32_t tx_frames;          /* queued into the TX FIFO */
+    rt_uint32_t tx_failed;          /* not sent, the controller gave up on them */
+};
+
 typedef struct
 {
     const char *name;
+    const char *tx_pin;
+    const char *rx_pin;
     FDCAN_HandleTypeDef fdcanHandle;
     FDCAN_RxHeaderTypeDef RxHeader;
-    FDCAN_TxHeaderTypeDef TxHeader;
-    uint8_t u8RxDataBuffer[8];
-    uint8_t u8TxDataBuufer[8];
     FDCAN_FilterTypeDef FilterConfig; /*FDCAN filter*/
+    rt_uint8_t u8TxBox[FDCAN_TX_FIFO_ELEMENTS]; /* send box of the frame in each TX element */
+    rt_uint16_t u16TsLast;          /* timestamp counter at the last look */
+    rt_uint32_t u32TsNow;           /* the counter extended to 32 bits */
+    struct stm32_fdcan_stats stats;
     struct rt_can_device device;      /* inherit from can device */
 } _stm32_fdcan_t;
 
-typedef struct
-{
-    uint32_t u32NBaudrate;
-    uint16_t u16Nbrp;
-    uint8_t u8Nsjw;
-    uint8_t u8Ntseg1;
-    uint8_t u8Ntseg2;
-} _stm32_fdcan_NTconfig_t;
-
 
 #ifdef __cplusplus
 }
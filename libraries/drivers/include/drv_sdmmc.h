@@ -6,6 +6,7 @@
  * Change Logs:
  * Date         Author          Notes
  * 2024-10-30   Evlers          first version
+ * 2025-02-18   RT-Thread       add SDIO1_MAX_SEG_SIZE and SDIO_DMA_ADDR_MIN
  */
 
 #ifndef __DRV_SDMMC_H__
@@ -37,6 +38,16 @@
 #define SDIO_ALIGN_LEN       (32)
 #endif
 
+/* longest block transfer of SDIO1, unaligned buffers are split to the bounce buffer size */
+#ifndef SDIO1_MAX_SEG_SIZE
+#define SDIO1_MAX_SEG_SIZE   (64 * 1024)
+#endif
+
+/* the IDMA can't reach the TCM, buffers below the AXI SRAM go through the bounce buffer */
+#ifndef SDIO_DMA_ADDR_MIN
+#define SDIO_DMA_ADDR_MIN    (0x24000000U)
+#endif
+
 #ifndef SDIO_MAX_FREQ
 #define SDIO_MAX_FREQ        (50 * 1000 * 1000)
 #endif
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date         Author          Notes
+ * 2025-02-24   RT-Thread       first version
+ */
+
+#ifndef __DRV_XSPI_NOR_RWW_H__
+#define __DRV_XSPI_NOR_RWW_H__
+
+#include <rtthread.h>
+#include <drv_common.h>
+
+/*
+ * Code that has to run while the XIP window is off: the flash sequences of
+ * the service, and the handlers of the interrupts left enabled by
+ * BSP_XSPI_NOR_RWW_IRQ_PRIORITY, together with everything they call.
+ */
+#define XSPI_NOR_RAMFUNC        rt_section(".RamFunc")
+
+struct xspi_nor_rww_stats
+{
+    rt_uint32_t programs;           /* pages */
+    rt_uint32_t erases;             /* 4 KB and 64 KB erase commands */
+    rt_uint32_t windows;            /* times the XIP window was switched off */
+    rt_uint32_t suspends;
+    rt_uint32_t max_window_us;      /* longest time with the interrupts masked */
+    rt_uint32_t max_erase_ms;       /* longest erase command, suspended time included */
+};
+
+int xspi_nor_rww_read(rt_uint32_t addr, void *buf, rt_size_t size);
+int xspi_nor_rww_write(rt_uint32_t addr, const void *buf, rt_size_t size);
+int xspi_nor_rww_erase(rt_uint32_t addr, rt_size_t size);
+
+void xspi_nor_rww_get_stats(struct xspi_nor_rww_stats *stats);
+void xspi_nor_rww_reset_stats(void);
+
+#endif /* __DRV_XSPI_NOR_RWW_H__ */
@@ -175,7 +175,7 @@ DSTATUS MMC_getCardInfo(uint8_t lun)
   * @param  count: Number of sectors to read (1..128)
   * @retval DRESULT: Operation result
   */
-DRESULT MMC_read(uint8_t lun, uint8_t *buff, uint16_t sector, uint32_t count)
+DRESULT MMC_read(uint8_t lun, uint8_t *buff, uint32_t sector, uint32_t count)
 {
   DRESULT res = RES_ERROR;
   ReadStatus = 0;
@@ -224,7 +224,7 @@ DRESULT MMC_read(uint8_t lun, uint8_t *buff, uint16_t sector, uint32_t count)
   * @retval DRESULT: Operation result
   */
 //#if _USE_WRITE == 1
-DRESULT MMC_write(uint8_t lun, const uint8_t *buff, uint16_t sector, uint32_t count)
+DRESULT MMC_write(uint8_t lun, const uint8_t *buff, uint32_t sector, uint32_t count)
 {
   DRESULT res = RES_ERROR;
   WriteStatus = 0;
@@ -46,8 +46,8 @@ typedef enum {
 
 DSTATUS MMC_initialize(uint8_t lun);
 DSTATUS MMC_getCardInfo(uint8_t lun);
-DRESULT MMC_read(uint8_t lun, uint8_t *buff, uint16_t sector, uint32_t count);
-DRESULT MMC_write(uint8_t lun, const uint8_t *buff, uint16_t sector, uint32_t count);
+DRESULT MMC_read(uint8_t lun, uint8_t *buff, uint32_t sector, uint32_t count);
+DRESULT MMC_write(uint8_t lun, const uint8_t *buff, uint32_t sector, uint32_t count);
 #endif /* __MMC_DISKIO_H */
 
 
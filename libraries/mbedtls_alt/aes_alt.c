@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-14     RT-Thread    AES on the STM32H7RS CRYP through hwcrypto
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include <mbedtls/config.h>
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_AES_C) && defined(MBEDTLS_AES_ALT)
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <string.h>
+#include <mbedtls/aes.h>
+#include <mbedtls/platform_util.h>
+
+#if defined(MBEDTLS_CIPHER_MODE_XTS)
+#error "AES-XTS is not offloaded, disable MBEDTLS_CIPHER_MODE_XTS"
+#endif
+
+#ifndef MBEDTLS_ERR_AES_HW_ACCEL_FAILED
+#define MBEDTLS_ERR_AES_HW_ACCEL_FAILED     -0x0025
+#endif
+
+static int aes_hw_crypt(mbedtls_aes_context *ctx, hwcrypto_type type, int mode,
+                        size_t length, const unsigned char *input, unsigned char *output)
+{
+    if (ctx->hw == RT_NULL)
+    {
+        return MBEDTLS_ERR_AES_HW_ACCEL_FAILED;
+    }
+    if (rt_hwcrypto_symmetric_set_type(ctx->hw, type) != RT_EOK ||
+        rt_hwcrypto_symmetric_crypt(ctx->hw,
+                                    mode == MBEDTLS_AES_ENCRYPT ? HWCRYPTO_MODE_ENCRYPT : HWCRYPTO_MODE_DECRYPT,
+                                    length, input, output) != RT_EOK)
+    {
+        return MBEDTLS_ERR_AES_HW_ACCEL_FAILED;
+    }
+
+    return 0;
+}
+
+void mbedtls_aes_init(mbedtls_aes_context *ctx)
+{
+    memset(ctx, 0, sizeof(mbedtls_aes_context));
+}
+
+void mbedtls_aes_free(mbedtls_aes_context *ctx)
+{
+    if (ctx == NULL)
+    {
+        return;
+    }
+    if (ctx->hw)
+    {
+        rt_hwcrypto_symmetric_destroy(ctx->hw);
+    }
+    mbedtls_platform_zeroize(ctx, sizeof(mbedtls_aes_context));
+}
+
+int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits)
+{
+    if (keybits != 128 && keybits != 192 && keybits != 256)
+    {
+        return MBEDTLS_ERR_AES_INVALID_KEY_LENGTH;
+    }
+    if (ctx->hw == RT_NULL)
+    {
+        ctx->hw = rt_hwcrypto_symmetric_create(rt_hwcrypto_dev_default(), HWCRYPTO_TYPE_AES_ECB);
+        if (ctx->hw == RT_NULL)
+        {
+            return MBEDTLS_ERR_AES_HW_ACCEL_FAILED;
+        }
+    }
+    if (rt_hwcrypto_symmetric_setkey(ctx->hw, key, keybits) != RT_EOK)
+    {
+        return MBEDTLS_ERR_AES_HW_ACCEL_FAILED;
+    }
+    ctx->keybits = keybits;
+
+    return 0;
+}
+
+/* CRYP derives the decryption key schedule itself */
+int mbedtls_aes_setkey_dec(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits)
+{
+    return mbedtls_aes_setkey_enc(ctx, key, keybits);
+}
+
+int mbedtls_internal_aes_encrypt(mbedtls_aes_context *ctx, const unsigned char input[16], unsigned char output[16])
+{
+    return aes_hw_crypt(ctx, HWCRYPTO_TYPE_AES_ECB, MBEDTLS_AES_ENCRYPT, 16, input, output);
+}
+
+int mbedtls_internal_aes_decrypt(mbedtls_aes_context *ctx, const unsigned char input[16], unsigned char output[16])
+{
+    return aes_hw_crypt(ctx, HWCRYPTO_TYPE_AES_ECB, MBEDTLS_AES_DECRYPT, 16, input, output);
+}
+
+#if !defined(MBEDTLS_DEPRECATED_REMOVED)
+void mbedtls_aes_encrypt(mbedtls_aes_context *ctx, const unsigned char input[16], unsigned char output[16])
+{
+    mbedtls_internal_aes_encrypt(ctx, input, output);
+}
+
+void mbedtls_aes_decrypt(mbedtls_aes_context *ctx, const unsigned char input[16], unsigned char output[16])
+{
+    mbedtls_internal_aes_decrypt(ctx, input, output);
+}
+#endif /* !MBEDTLS_DEPRECATED_REMOVED */
+
+int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx, int mode,
+                          const unsigned char input[16], unsigned char output[16])
+{
+    return aes_hw_crypt(ctx, HWCRYPTO_TYPE_AES_ECB, mode, 16, input, output);
+}
+
+#if defined(MBEDTLS_CIPHER_MODE_CBC)
+int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx, int mode, size_t length, unsigned char iv[16],
+                          const unsigned char *input, unsigned char *output)
+{
+    int ret;
+
+    if (length % 16)
+    {
+        return MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH;
+    }
+    if (length == 0)
+    {
+        return 0;
+    }
+    if (ctx->hw == RT_NULL || rt_hwcrypto_symmetric_setiv(ctx->hw, iv, 16) != RT_EOK)
+    {
+        return MBEDTLS_ERR_AES_HW_ACCEL_FAILED;
+    }
+    ret = aes_hw_crypt(ctx, HWCRYPTO_TYPE_AES_CBC, mode, length, input, output);
+    if (ret == 0)
+    {
+        /* the driver leaves the chaining value in the context */
+        rt_hwcrypto_symmetric_getiv(ctx->hw, iv, 16);
+    }
+
+    return ret;
+}
+#endif /* MBEDTLS_CIPHER_MODE_CBC */
+
+#if defined(MBEDTLS_CIPHER_MODE_CFB)
+int mbedtls_aes_crypt_cfb128(mbedtls_aes_context *ctx, int mode, size_t length, size_t *iv_off,
+                             unsigned char iv[16], const unsigned char *input, unsigned char *output)
+{
+    size_t n = *iv_off;
+    unsigned char c;
+    int ret;
+
+    if (n > 15)
+    {
+        return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+    }
+    while (length--)
+    {
+        if (n == 0)
+        {
+            ret = mbedtls_internal_aes_encrypt(ctx, iv, iv);
+            if (ret != 0)
+            {
+                return ret;
+            }
+        }
+        if (mode == MBEDTLS_AES_DECRYPT)
+        {
+            c = *input++;
+            *output++ = (unsigned char)(c ^ iv[n]);
+            iv[n] = c;
+        }
+        else
+        {
+            iv[n] = *output++ = (unsigned char)(iv[n] ^ *input++);
+        }
+        n = (n + 1) & 0x0F;
+    }
+    *iv_off = n;
+
+    return 0;
+}
+
+int mbedtls_aes_crypt_cfb8(mbedtls_aes_context *ctx, int mode, size_t length, unsigned char iv[16],
+                           const unsigned char *input, unsigned char *output)
+{
+    unsigned char c, ov[17];
+    int ret;
+
+    while (length--)
+    {
+        memcpy(ov, iv, 16);
+        ret = mbedtls_internal_aes_encrypt(ctx, iv, iv);
+        if (ret != 0)
+        {
+            return ret;
+        }
+        if (mode == MBEDTLS_AES_DECRYPT)
+        {
+            ov[16] = *input;
+        }
+        c = *output++ = (unsigned char)(iv[0] ^ *input++);
+        if (mode == MBEDTLS_AES_ENCRYPT)
+        {
+            ov[16] = c;
+        }
+        memcpy(iv, ov + 1, 16);
+    }
+
+    return 0;
+}
+#endif /* MBEDTLS_CIPHER_MODE_CFB */
+
+#if defined(MBEDTLS_CIPHER_MODE_OFB)
+int mbedtls_aes_crypt_ofb(mbedtls_aes_context *ctx, size_t length, size_t *iv_off,
+                          unsigned char iv[16], const unsigned char *input, unsigned char *output)
+{
+    size_t n = *iv_off;
+    int ret;
+
+    if (n > 15)
+    {
+        return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+    }
+    while (length--)
+    {
+        if (n == 0)
+        {
+            ret = mbedtls_internal_aes_encrypt(ctx, iv, iv);
+            if (ret != 0)
+            {
+                return ret;
+            }
+        }
+        *output++ = *input++ ^ iv[n];
+        n = (n + 1) & 0x0F;
+    }
+    *iv_off = n;
+
+    return 0;
+}
+#endif /* MBEDTLS_CIPHER_MODE_OFB */
+
+#if defined(MBEDTLS_CIPHER_MODE_CTR)
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx, size_t length, size_t *nc_off,
+                          unsigned char nonce_counter[16], unsigned char stream_block[16],
+                          const unsigned char *input, unsigned char *output)
+{
+    size_t n = *nc_off, whole;
+    int i, ret;
+
+    if (n > 15)
+    {
+        return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+    }
+
+    /* use up the key stream left from the previous call */
+    while (n != 0 && length)
+    {
+        *output++ = *input++ ^ stream_block[n];
+        n = (n + 1) & 0x0F;
+        length--;
+    }
+
+    whole = length & ~(size_t)0x0F;
+    if (whole)
+    {
+        if (ctx->hw == RT_NULL || rt_hwcrypto_symmetric_setiv(ctx->hw, nonce_counter, 16) != RT_EOK)
+        {
+            return MBEDTLS_ERR_AES_HW_ACCEL_FAILED;
+        }
+        ret = aes_hw_crypt(ctx, HWCRYPTO_TYPE_AES_CTR, MBEDTLS_AES_ENCRYPT, whole, input, output);
+        if (ret != 0)
+        {
+            return ret;
+        }
+        rt_hwcrypto_symmetric_getiv(ctx->hw, nonce_counter, 16);
+        input += whole;
+        output += whole;
+        length -= whole;
+    }
+
+    if (length)
+    {
+        ret = mbedtls_internal_aes_encrypt(ctx, nonce_counter, stream_block);
+        if (ret != 0)
+        {
+            return ret;
+        }
+        for (i = 16; i > 0; i--)
+        {
+            if (++nonce_counter[i - 1] != 0)
+            {
+                break;
+            }
+        }
+        while (length--)
+        {
+            *output++ = *input++ ^ stream_block[n];
+            n++;
+        }
+    }
+    *nc_off = n;
+
+    return 0;
+}
+#endif /* MBEDTLS_CIPHER_MODE_CTR */
+
+#endif /* MBEDTLS_AES_C && MBEDTLS_AES_ALT */
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-14     RT-Thread    AES on the STM32H7RS CRYP through hwcrypto
+ */
+
+#ifndef __AES_ALT_H__
+#define __AES_ALT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct rt_hwcrypto_ctx;
+
+typedef struct mbedtls_aes_context
+{
+    struct rt_hwcrypto_ctx *hw;         /* hwcrypto AES context, holds the key */
+    unsigned int keybits;
+} mbedtls_aes_context;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AES_ALT_H__ */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-14     RT-Thread    SHA-224/256 on the STM32H7RS HASH through hwcrypto
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include <mbedtls/config.h>
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_SHA256_C) && defined(MBEDTLS_SHA256_ALT)
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <string.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/platform_util.h>
+
+#ifndef MBEDTLS_ERR_SHA256_HW_ACCEL_FAILED
+#define MBEDTLS_ERR_SHA256_HW_ACCEL_FAILED  -0x0037
+#endif
+
+static hwcrypto_type sha256_type(const mbedtls_sha256_context *ctx)
+{
+    return ctx->is224 ? HWCRYPTO_TYPE_SHA224 : HWCRYPTO_TYPE_SHA256;
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(mbedtls_sha256_context));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+    if (ctx == NULL)
+    {
+        return;
+    }
+    if (ctx->hw)
+    {
+        rt_hwcrypto_hash_destroy(ctx->hw);
+    }
+    mbedtls_platform_zeroize(ctx, sizeof(mbedtls_sha256_context));
+}
+
+/* the TLS handshake clones its running transcript hash for every Finished */
+void mbedtls_sha256_clone(mbedtls_sha256_context *dst, const mbedtls_sha256_context *src)
+{
+    dst->is224 = src->is224;
+    if (src->hw == RT_NULL)
+    {
+        return;
+    }
+    if (dst->hw == RT_NULL)
+    {
+        dst->hw = rt_hwcrypto_hash_create(rt_hwcrypto_dev_default(), sha256_type(src));
+        if (dst->hw == RT_NULL)
+        {
+            return;
+        }
+    }
+    rt_hwcrypto_hash_cpy(dst->hw, src->hw);
+}
+
+int mbedtls_sha256_starts_ret(mbedtls_sha256_context *ctx, int is224)
+{
+    ctx->is224 = is224;
+    if (ctx->hw == RT_NULL)
+    {
+        ctx->hw = rt_hwcrypto_hash_create(rt_hwcrypto_dev_default(), sha256_type(ctx));
+        if (ctx->hw == RT_NULL)
+        {
+            return MBEDTLS_ERR_SHA256_HW_ACCEL_FAILED;
+        }
+        return 0;
+    }
+    rt_hwcrypto_hash_reset(ctx->hw);
+    if (rt_hwcrypto_hash_set_type(ctx->hw, sha256_type(ctx)) != RT_EOK)
+    {
+        return MBEDTLS_ERR_SHA256_HW_ACCEL_FAILED;
+    }
+
+    return 0;
+}
+
+int mbedtls_sha256_update_ret(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+    if (ilen == 0)
+    {
+        return 0;
+    }
+    if (ctx->hw == RT_NULL || rt_hwcrypto_hash_update(ctx->hw, input, ilen) != RT_EOK)
+    {
+        return MBEDTLS_ERR_SHA256_HW_ACCEL_FAILED;
+    }
+
+    return 0;
+}
+
+int mbedtls_sha256_finish_ret(mbedtls_sha256_context *ctx, unsigned char output[32])
+{
+    if (ctx->hw == RT_NULL ||
+        rt_hwcrypto_hash_finish(ctx->hw, output, ctx->is224 ? 28 : 32) != RT_EOK)
+    {
+        return MBEDTLS_ERR_SHA256_HW_ACCEL_FAILED;
+    }
+
+    return 0;
+}
+
+int mbedtls_internal_sha256_process(mbedtls_sha256_context *ctx, const unsigned char data[64])
+{
+    return mbedtls_sha256_update_ret(ctx, data, 64);
+}
+
+#if !defined(MBEDTLS_DEPRECATED_REMOVED)
+void mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
+{
+    mbedtls_sha256_starts_ret(ctx, is224);
+}
+
+void mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+    mbedtls_sha256_update_ret(ctx, input, ilen);
+}
+
+void mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32])
+{
+    mbedtls_sha256_finish_ret(ctx, output);
+}
+
+void mbedtls_sha256_process(mbedtls_sha256_context *ctx, const unsigned char data[64])
+{
+    mbedtls_internal_sha256_process(ctx, data);
+}
+#endif /* !MBEDTLS_DEPRECATED_REMOVED */
+
+#endif /* MBEDTLS_SHA256_C && MBEDTLS_SHA256_ALT */
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-14     RT-Thread    SHA-224/256 on the STM32H7RS HASH through hwcrypto
+ */
+
+#ifndef __SHA256_ALT_H__
+#define __SHA256_ALT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct rt_hwcrypto_ctx;
+
+typedef struct mbedtls_sha256_context
+{
+    struct rt_hwcrypto_ctx *hw;         /* hwcrypto SHA2 context, created on first use */
+    int is224;
+} mbedtls_sha256_context;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SHA256_ALT_H__ */
@@ -6,17 +6,40 @@
  * Change Logs:
  * Date           Author       Notes
  * 2010-02-06     Bernard      Add elm_init function declaration
+ * 2025-02-19     RT-Thread    add the sector cache interface
  */
 
 #ifndef __DFS_ELM_H__
 #define __DFS_ELM_H__
 
+#include <rtthread.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int elm_init(void);
 
+#ifdef RT_DFS_ELM_USING_CACHE
+struct dfs_elm_cache_stats
+{
+    rt_uint32_t hits;           /* sectors read from the cache */
+    rt_uint32_t misses;         /* sectors read from the device */
+    rt_uint32_t readahead;      /* sectors read ahead */
+    rt_uint32_t writes;         /* sectors written into the cache */
+    rt_uint32_t write_hits;     /* sectors written again before the write back */
+    rt_uint32_t coalesced;      /* sectors merged into a previous write back request */
+    rt_uint32_t evict_writes;   /* write backs to free a line */
+    rt_uint32_t flushes;        /* write backs on sync */
+    rt_uint32_t dev_reads;      /* read requests to the device */
+    rt_uint32_t dev_writes;     /* write requests to the device */
+};
+
+/* write the dirty sectors of all volumes back, before the medium goes away; -RT_EIO if any were lost */
+int dfs_elm_cache_flush(void);
+int dfs_elm_cache_get_stats(int drv, struct dfs_elm_cache_stats *stats);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -103,6 +103,8 @@ int dfs_file_mmap2(struct dfs_file *fd, struct dfs_mmap2_args *mmap2);
 #define RT_FIOFTRUNCATE  0x52540000U
 #define RT_FIOGETADDR    0x52540001U
 #define RT_FIOMMAP2      0x52540002U
+#define RT_FIOFALLOCATE  0x52540003U /* off_t *, allocate a contiguous file of this size */
+#define RT_FIORAWSEQ     0x52540004U /* int *, 1: write a contiguous file straight to its sectors */
 
 #ifdef __cplusplus
 }
@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2020/08/21     ShaoJinchun  first version
+ * 2025-02-25     RT-Thread    block compressed files and the decompressed block cache
  */
 
 #include <rtthread.h>
@@ -30,6 +31,12 @@
 #define CROMFS_PATITION_HEAD_SIZE 256
 #define CROMFS_DIRENT_CACHE_SIZE  8
 
+#ifdef RT_DFS_CROMFS_CACHE_BLOCKS
+#define CROMFS_BLOCK_CACHE_SIZE   RT_DFS_CROMFS_CACHE_BLOCKS
+#else
+#define CROMFS_BLOCK_CACHE_SIZE   16
+#endif
+
 #define CROMFS_MAGIC   "CROMFSMG"
 
 #define CROMFS_CT_ASSERT(name, x) \
@@ -42,7 +49,7 @@ typedef struct
 {
     uint8_t magic[8];        /* CROMFS_MAGIC */
     uint32_t version;
-    uint32_t partition_attr; /* expand, now reserved 0 */
+    uint32_t partition_attr; /* CROMFS_PART_ATTR_xxx */
     uint32_t partition_size; /* with partition head */
     uint32_t root_dir_pos;   /* root dir pos */
     uint32_t root_dir_size;
@@ -54,6 +61,19 @@ typedef struct
     uint8_t padding[CROMFS_PATITION_HEAD_SIZE - sizeof(partition_head_data)];
 } partition_head;
 
+/*
+ * With CROMFS_PART_ATTR_BLOCKS the data of a regular file is a table of
+ * uint32_t block end offsets (relative to the end of the table) followed by
+ * the blocks, each a zlib stream of at most (1 << block shift) bytes, so a
+ * read only inflates the blocks it touches. A block whose stored size equals
+ * its original size did not compress and is stored as is. Symbolic links
+ * and images without the attribute hold one zlib stream per file.
+ */
+#define CROMFS_PART_ATTR_BLOCKS          (0x1UL)
+#define CROMFS_PART_ATTR_BLOCK_SHIFT(a)  (((a) >> 8) & 0xFFUL)
+#define CROMFS_BLOCK_SHIFT_MIN           9   /* zlib window sizes */
+#define CROMFS_BLOCK_SHIFT_MAX           15
+
 enum
 {
     CROMFS_DIRENT_ATTR_FILE    = 0x0UL,
@@ -93,6 +113,14 @@ typedef struct
     uint8_t *buff;
 } cromfs_dirent_cache;
 
+typedef struct
+{
+    rt_list_t list;
+    uint32_t partition_pos;     /* of the file, CROMFS_POS_ERROR when unused */
+    uint32_t index;
+    uint8_t *buff;
+} cromfs_block_cache;
+
 typedef struct st_cromfs_info
 {
     rt_device_t device;
@@ -105,6 +133,15 @@ typedef struct st_cromfs_info
     rt_list_t cromfs_dirent_cache_head;
     int cromfs_dirent_cache_nr;
     const void *data;
+    uint32_t blk_shift;         /* 0 when the files are single zlib streams */
+    cromfs_block_cache *blk_cache;
+    rt_list_t blk_lru;
+    uint8_t *blk_pool;
+    uint8_t *blk_zbuff;         /* compressed block being inflated */
+    z_stream blk_strm;
+    uint32_t blk_hits;
+    uint32_t blk_misses;
+    uint32_t blk_inflated;
 } cromfs_info;
 
 typedef struct
@@ -116,6 +153,8 @@ typedef struct
     uint8_t *buff;
     uint32_t partition_size;
     int data_valid;
+    uint32_t blk_nr;
+    uint32_t *blk_end;
 } file_info;
 
 /**********************************/
@@ -506,6 +545,214 @@ static void cromfs_dirent_cache_destroy(cromfs_info *ci)
 
 /**********************************/
 
+static void cromfs_block_cache_destroy(cromfs_info *ci)
+{
+    if (ci->blk_shift)
+    {
+        inflateEnd(&ci->blk_strm);
+    }
+    free(ci->blk_cache);
+    free(ci->blk_pool);
+    free(ci->blk_zbuff);
+    ci->blk_cache = NULL;
+    ci->blk_pool = NULL;
+    ci->blk_zbuff = NULL;
+    ci->blk_shift = 0;
+}
+
+static int cromfs_block_cache_init(cromfs_info *ci)
+{
+    uint32_t shift = CROMFS_PART_ATTR_BLOCK_SHIFT(ci->part_info.partition_attr);
+    int i = 0;
+
+    if (shift < CROMFS_BLOCK_SHIFT_MIN || shift > CROMFS_BLOCK_SHIFT_MAX)
+    {
+        return -RT_ERROR;
+    }
+
+    ci->blk_cache = (cromfs_block_cache *)malloc(CROMFS_BLOCK_CACHE_SIZE * sizeof *ci->blk_cache);
+    ci->blk_pool = (uint8_t *)malloc(CROMFS_BLOCK_CACHE_SIZE << shift);
+    ci->blk_zbuff = (uint8_t *)malloc(1UL << shift);
+    memset(&ci->blk_strm, 0, sizeof ci->blk_strm);
+    if (!ci->blk_cache || !ci->blk_pool || !ci->blk_zbuff ||
+            inflateInit2(&ci->blk_strm, shift) != Z_OK)
+    {
+        cromfs_block_cache_destroy(ci);
+        return -ENOMEM;
+    }
+    ci->blk_shift = shift;
+
+    rt_list_init(&ci->blk_lru);
+    for (i = 0; i < CROMFS_BLOCK_CACHE_SIZE; i++)
+    {
+        ci->blk_cache[i].partition_pos = CROMFS_POS_ERROR;
+        ci->blk_cache[i].buff = ci->blk_pool + (i << shift);
+        rt_list_insert_before(&ci->blk_lru, &ci->blk_cache[i].list);
+    }
+
+    return RT_EOK;
+}
+
+static void cromfs_block_cache_drop(cromfs_info *ci)
+{
+    int i = 0;
+
+    for (i = 0; ci->blk_cache && i < CROMFS_BLOCK_CACHE_SIZE; i++)
+    {
+        ci->blk_cache[i].partition_pos = CROMFS_POS_ERROR;
+    }
+    ci->blk_hits = 0;
+    ci->blk_misses = 0;
+    ci->blk_inflated = 0;
+}
+
+/* the block stays valid until the lock is released */
+static uint8_t *cromfs_block_get(cromfs_info *ci, file_info *fi, uint32_t index)
+{
+    rt_list_t *l = NULL;
+    cromfs_block_cache *blk = NULL;
+    uint32_t start = 0, size = 0, osize = 0, pos = 0;
+
+    /* find */
+    for (l = ci->blk_lru.next; l != &ci->blk_lru; l = l->next)
+    {
+        blk = (cromfs_block_cache *)l;
+        if (blk->partition_pos == fi->partition_pos && blk->index == index)
+        {
+            rt_list_remove(l);
+            rt_list_insert_after(&ci->blk_lru, l);
+            ci->blk_hits++;
+            return blk->buff;
+        }
+    }
+    ci->blk_misses++;
+
+    /* not found, reuse the least recently used one */
+    blk = (cromfs_block_cache *)ci->blk_lru.prev;
+    blk->partition_pos = CROMFS_POS_ERROR;
+
+    start = index ? fi->blk_end[index - 1] : 0;
+    if (fi->blk_end[index] < start)
+    {
+        return NULL;
+    }
+    size = fi->blk_end[index] - start;
+    osize = fi->size - (index << ci->blk_shift);
+    if (osize > (1UL << ci->blk_shift))
+    {
+        osize = 1UL << ci->blk_shift;
+    }
+    if (size > osize)
+    {
+        return NULL;
+    }
+    pos = fi->partition_pos + fi->blk_nr * sizeof(uint32_t) + start;
+
+    if (size == osize)
+    {
+        if (cromfs_read_bytes(ci, pos, blk->buff, size) != size)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        if (cromfs_read_bytes(ci, pos, ci->blk_zbuff, size) != size)
+        {
+            return NULL;
+        }
+        inflateReset(&ci->blk_strm);
+        ci->blk_strm.next_in = ci->blk_zbuff;
+        ci->blk_strm.avail_in = size;
+        ci->blk_strm.next_out = blk->buff;
+        ci->blk_strm.avail_out = osize;
+        if (inflate(&ci->blk_strm, Z_FINISH) != Z_STREAM_END || ci->blk_strm.total_out != osize)
+        {
+            return NULL;
+        }
+        ci->blk_inflated++;
+    }
+
+    blk->partition_pos = fi->partition_pos;
+    blk->index = index;
+    rt_list_remove(&blk->list);
+    rt_list_insert_after(&ci->blk_lru, &blk->list);
+    return blk->buff;
+}
+
+static int cromfs_block_read(cromfs_info *ci, file_info *fi, uint8_t *buf, uint32_t pos, uint32_t length)
+{
+    uint32_t mask = (1UL << ci->blk_shift) - 1;
+    uint32_t off = 0, len = 0;
+    uint8_t *blk = NULL;
+
+    while (length)
+    {
+        off = pos & mask;
+        len = mask + 1 - off;
+        if (len > length)
+        {
+            len = length;
+        }
+        blk = cromfs_block_get(ci, fi, pos >> ci->blk_shift);
+        if (!blk)
+        {
+            return -RT_EIO;
+        }
+        memcpy(buf, blk + off, len);
+        buf += len;
+        pos += len;
+        length -= len;
+    }
+
+    return RT_EOK;
+}
+
+static int cromfs_block_table_load(cromfs_info *ci, file_info *fi)
+{
+    uint32_t table_size = 0;
+
+    fi->blk_nr = (fi->size + (1UL << ci->blk_shift) - 1) >> ci->blk_shift;
+    if (!fi->blk_nr)
+    {
+        return RT_EOK;
+    }
+    table_size = fi->blk_nr * sizeof(uint32_t);
+    if (table_size > fi->partition_size)
+    {
+        return -RT_ERROR;
+    }
+    fi->blk_end = (uint32_t *)malloc(table_size);
+    if (!fi->blk_end)
+    {
+        return -ENOMEM;
+    }
+    if (cromfs_read_bytes(ci, fi->partition_pos, fi->blk_end, table_size) != table_size ||
+            fi->blk_end[fi->blk_nr - 1] != fi->partition_size - table_size)
+    {
+        free(fi->blk_end);
+        fi->blk_end = NULL;
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+
+static void cromfs_file_info_free(file_info *fi)
+{
+    if (fi->buff)
+    {
+        free(fi->buff);
+    }
+    if (fi->blk_end)
+    {
+        free(fi->blk_end);
+    }
+    free(fi);
+}
+
+/**********************************/
+
 #ifdef RT_USING_PAGECACHE
 static ssize_t dfs_cromfs_page_read(struct dfs_file *file, struct dfs_page *page);
 
@@ -570,6 +817,16 @@ static int dfs_cromfs_mount(struct dfs_mnt *mnt, unsigned long rwflag, const voi
         return -RT_ERROR;
     }
     ci->partition_size = ci->part_info.partition_size;
+    if ((ci->part_info.partition_attr & CROMFS_PART_ATTR_BLOCKS) &&
+            cromfs_block_cache_init(ci) != RT_EOK)
+    {
+        if (ci->device)
+        {
+            rt_device_close(ci->device);
+        }
+        free(ci);
+        return -ENOMEM;
+    }
     mnt->data = ci;
 
     rt_mutex_init(&ci->lock, "crom", RT_IPC_FLAG_FIFO);
@@ -595,6 +852,7 @@ static int dfs_cromfs_unmount(struct dfs_mnt *mnt)
     }
 
     cromfs_dirent_cache_destroy(ci);
+    cromfs_block_cache_destroy(ci);
 
     while (ci->cromfs_avl_root)
     {
@@ -605,11 +863,7 @@ static int dfs_cromfs_unmount(struct dfs_mnt *mnt)
         fi = node->fi;
         cromfs_avl_remove(node, &ci->cromfs_avl_root);
         free(node);
-        if (fi->buff)
-        {
-            free(fi->buff);
-        }
-        free(fi);
+        cromfs_file_info_free(fi);
     }
 
     if (ci->device)
@@ -804,7 +1058,23 @@ static ssize_t dfs_cromfs_read(struct dfs_file *file, void *buf, size_t count, o
     {
         RT_ASSERT(fi->size != 0);
 
-        if (fi->buff)
+        if (fi->blk_end)
+        {
+            int read_ret = 0;
+
+            result =  rt_mutex_take(&ci->lock, RT_WAITING_FOREVER);
+            if (result != RT_EOK)
+            {
+                return 0;
+            }
+            read_ret = cromfs_block_read(ci, fi, (uint8_t *)buf, *pos, length);
+            rt_mutex_release(&ci->lock);
+            if (read_ret < 0)
+            {
+                return -EIO;
+            }
+        }
+        else if (fi->buff)
         {
             int fill_ret = 0;
 
@@ -877,6 +1147,8 @@ static file_info *inset_file_info(cromfs_info *ci, uint32_t partition_pos, int f
     }
     fi->partition_pos = partition_pos;
     fi->ci = ci;
+    fi->blk_nr = 0;
+    fi->blk_end = NULL;
     if (file_type == CROMFS_DIRENT_ATTR_DIR)
     {
         fi->size = size;
@@ -886,7 +1158,14 @@ static file_info *inset_file_info(cromfs_info *ci, uint32_t partition_pos, int f
         fi->size = osize;
         fi->partition_size = size;
         fi->data_valid = 0;
-        if (osize)
+        if (file_type == CROMFS_DIRENT_ATTR_FILE && ci->blk_shift)
+        {
+            if (cromfs_block_table_load(ci, fi) != RT_EOK)
+            {
+                goto err;
+            }
+        }
+        else if (osize)
         {
             file_buff = (void *)malloc(osize);
             if (!file_buff)
@@ -901,6 +1180,10 @@ static file_info *inset_file_info(cromfs_info *ci, uint32_t partition_pos, int f
     node = (struct cromfs_avl_struct *)malloc(sizeof *node);
     if (!node)
     {
+        if (fi->blk_end)
+        {
+            free(fi->blk_end);
+        }
         goto err;
     }
     node->avl_key = partition_pos;
@@ -932,11 +1215,7 @@ static void deref_file_info(cromfs_info *ci, uint32_t partition_pos)
             fi = node->fi;
             cromfs_avl_remove(node, &ci->cromfs_avl_root);
             free(node);
-            if (fi->buff)
-            {
-                free(fi->buff);
-            }
-            free(fi);
+            cromfs_file_info_free(fi);
         }
     }
 }
@@ -1380,3 +1659,54 @@ int dfs_cromfs_init(void)
     return 0;
 }
 INIT_COMPONENT_EXPORT(dfs_cromfs_init);
+
+static cromfs_info *cromfs_info_get(const char *path)
+{
+    struct dfs_mnt *mnt = dfs_mnt_lookup(path);
+
+    if (!mnt || mnt->fs_ops != &_cromfs_ops || !mnt->data)
+    {
+        return NULL;
+    }
+    return (cromfs_info *)mnt->data;
+}
+
+int dfs_cromfs_cache_stats(const char *path, struct dfs_cromfs_cache_stats *stats)
+{
+    cromfs_info *ci = cromfs_info_get(path);
+
+    if (!ci || !stats)
+    {
+        return -EINVAL;
+    }
+    if (rt_mutex_take(&ci->lock, RT_WAITING_FOREVER) != RT_EOK)
+    {
+        return -EINTR;
+    }
+    stats->block_size = ci->blk_shift ? (1UL << ci->blk_shift) : 0;
+    stats->blocks = ci->blk_shift ? CROMFS_BLOCK_CACHE_SIZE : 0;
+    stats->hits = ci->blk_hits;
+    stats->misses = ci->blk_misses;
+    stats->inflated = ci->blk_inflated;
+    rt_mutex_release(&ci->lock);
+
+    return RT_EOK;
+}
+
+int dfs_cromfs_cache_drop(const char *path)
+{
+    cromfs_info *ci = cromfs_info_get(path);
+
+    if (!ci)
+    {
+        return -EINVAL;
+    }
+    if (rt_mutex_take(&ci->lock, RT_WAITING_FOREVER) != RT_EOK)
+    {
+        return -EINTR;
+    }
+    cromfs_block_cache_drop(ci);
+    rt_mutex_release(&ci->lock);
+
+    return RT_EOK;
+}
@@ -6,11 +6,28 @@
  * Change Logs:
  * Date           Author       Notes
  * 2020/08/21     ShaoJinchun  firset version
+ * 2025-02-25     RT-Thread    decompressed block cache statistics
  */
 
 #ifndef  __DFS_CROMFS_H__
 #define  __DFS_CROMFS_H__
 
+#include <rtthread.h>
+
+struct dfs_cromfs_cache_stats
+{
+    rt_uint32_t block_size;     /* 0 for an image without blocks */
+    rt_uint32_t blocks;         /* cache capacity */
+    rt_uint32_t hits;
+    rt_uint32_t misses;
+    rt_uint32_t inflated;       /* misses on compressed blocks */
+};
+
 int dfs_cromfs_init(void);
 
+/* path is anywhere in a mounted cromfs */
+int dfs_cromfs_cache_stats(const char *path, struct dfs_cromfs_cache_stats *stats);
+/* empty the block cache and clear the counters */
+int dfs_cromfs_cache_drop(const char *path);
+
 #endif  /*__DFS_CROMFS_H__*/
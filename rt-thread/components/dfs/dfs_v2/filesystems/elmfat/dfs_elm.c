@@ -15,6 +15,7 @@
  * 2017-02-13     Hichard      Update Fatfs version to 0.12b, support exFAT.
  * 2017-04-11     Bernard      fix the st_blksize issue.
  * 2017-05-26     Urey         fix f_mount error when mount more fats
+ * 2025-03-02     RT-Thread    port the sector cache and the raw sequential write from DFS v1
  */
 
 #include <rtthread.h>
@@ -31,6 +32,7 @@
 #include <dfs_dentry.h>
 #include <dfs_file.h>
 #include <dfs_mnt.h>
+#include "dfs_elm_cache.h"
 
 #ifdef RT_USING_PAGECACHE
 #include "dfs_pcache.h"
@@ -60,6 +62,27 @@ static struct dfs_aspace_ops dfs_elm_aspace_ops =
 
 static rt_device_t disk[FF_VOLUMES] = {0};
 
+#ifdef RT_DFS_ELM_USE_EXPAND
+#ifndef RT_DFS_ELM_RAW_FILES
+#define RT_DFS_ELM_RAW_FILES 2
+#endif
+
+#if FF_FS_TINY
+#error "the raw sequential write needs the file window of each file, FF_FS_TINY 0"
+#endif
+/* FA_DIRTY of ff.c, FIL.buf[] holds data not yet written to FIL.sect */
+#define ELM_FA_DIRTY    0x80
+
+/* files in raw sequential mode, their data sectors are written without the FAT (RT_FIORAWSEQ) */
+static struct elm_raw_file
+{
+    FIL *fd;
+    DWORD cluster;      /* first cluster of the contiguous chain */
+    LBA_t sector;       /* first sector of the chain */
+    DWORD sectors;      /* sectors in the chain */
+} raw_files[RT_DFS_ELM_RAW_FILES];
+#endif
+
 int dfs_elm_unmount(struct dfs_mnt *mnt);
 
 static int elm_result_to_dfs(FRESULT result)
@@ -126,6 +149,116 @@ static int get_disk(rt_device_t id)
     return -1;
 }
 
+#ifdef RT_DFS_ELM_USE_EXPAND
+static struct elm_raw_file *elm_raw_find(FIL *fd)
+{
+    int i;
+
+    for (i = 0; i < RT_DFS_ELM_RAW_FILES; i++)
+    {
+        if (raw_files[i].fd == fd)
+            return &raw_files[i];
+    }
+    return RT_NULL;
+}
+
+static int elm_raw_enable(FIL *fd)
+{
+    FATFS *fs = fd->obj.fs;
+    struct elm_raw_file *raw;
+    DWORD tbl[4];
+    FRESULT result;
+
+    if (elm_raw_find(fd) != RT_NULL)
+        return 0;
+
+    /* write the file buffer out, the raw writes go around it */
+    result = f_sync(fd);
+    if (result != FR_OK)
+        return elm_result_to_dfs(result);
+
+    /* a link map with a single fragment means the cluster chain is contiguous */
+    tbl[0] = sizeof(tbl) / sizeof(tbl[0]);
+    fd->cltbl = tbl;
+    result = f_lseek(fd, CREATE_LINKMAP);
+    fd->cltbl = RT_NULL;
+    if (result == FR_NOT_ENOUGH_CORE || (result == FR_OK && tbl[1] == 0))
+        return -EINVAL; /* fragmented or empty, RT_FIOFALLOCATE first */
+    if (result != FR_OK)
+        return elm_result_to_dfs(result);
+
+    rt_enter_critical();
+    raw = elm_raw_find(RT_NULL);
+    if (raw != RT_NULL)
+    {
+        raw->cluster = tbl[2];
+        raw->sector = fs->database + (LBA_t)fs->csize * (tbl[2] - 2);
+        raw->sectors = tbl[1] * fs->csize;
+        raw->fd = fd;
+    }
+    rt_exit_critical();
+
+    return raw != RT_NULL ? 0 : -EBUSY;
+}
+
+static void elm_raw_disable(FIL *fd)
+{
+    struct elm_raw_file *raw = elm_raw_find(fd);
+
+    if (raw != RT_NULL)
+        raw->fd = RT_NULL;
+}
+
+/* whole sectors at a sector aligned position, inside the allocated chain */
+static ssize_t elm_raw_write(struct elm_raw_file *raw, FIL *fd, const void *buf, size_t len)
+{
+    FATFS *fs = fd->obj.fs;
+    DWORD bcs = (DWORD)fs->csize * SS(fs);
+    LBA_t sect;
+    UINT count;
+
+    sect = raw->sector + (LBA_t)(fd->fptr / SS(fs));
+    count = len / SS(fs);
+
+    /*
+     * A partial f_write may have left the file window dirty. Write it out
+     * first: inside the range the raw data then replaces it, outside it is
+     * kept, and the window is never flushed later to a stale sector.
+     */
+    if (fd->flag & ELM_FA_DIRTY)
+    {
+        if (disk_write(fs->pdrv, fd->buf, fd->sect, 1) != RES_OK)
+            return -EIO;
+        fd->flag &= (BYTE)~ELM_FA_DIRTY;
+    }
+    if (disk_write(fs->pdrv, buf, sect, count) != RES_OK)
+        return -EIO;
+
+    /* keep the position FatFs sees consistent, clust is the cluster of the last byte written */
+    fd->fptr += (FSIZE_t)count * SS(fs);
+    fd->clust = raw->cluster + (DWORD)((fd->fptr - 1) / bcs);
+    /* the file window may hold one of the sectors just written, it is clean, drop it */
+    if (fd->sect >= sect && fd->sect < sect + count)
+        fd->sect = 0;
+
+    return count * SS(fs);
+}
+
+/* the raw write when fd is in raw mode and len whole sectors fit at fptr, -ENOTSUP to take f_write */
+static ssize_t elm_raw_try_write(FIL *fd, const void *buf, size_t len)
+{
+    struct elm_raw_file *raw = elm_raw_find(fd);
+    UINT ss = SS(fd->obj.fs);
+
+    if (raw == RT_NULL || len < ss || len % ss != 0 || fd->fptr % ss != 0 ||
+        fd->fptr + len > f_size(fd) || fd->fptr + len > (FSIZE_t)raw->sectors * ss)
+    {
+        return -ENOTSUP;
+    }
+    return elm_raw_write(raw, fd, buf, len);
+}
+#endif /* RT_DFS_ELM_USE_EXPAND */
+
 static int dfs_elm_mount(struct dfs_mnt *mnt, unsigned long rwflag, const void *data)
 {
     FATFS *fat;
@@ -171,6 +304,11 @@ static int dfs_elm_mount(struct dfs_mnt *mnt, unsigned long rwflag, const void *
         return -ENOMEM;
     }
 
+#ifdef RT_DFS_ELM_USING_CACHE
+    /* without memory for the cache the volume works uncached */
+    dfs_elm_cache_attach(index, mnt->dev_id);
+#endif
+
     /* mount fatfs, always 0 logic driver */
     result = f_mount(fat, (const TCHAR *)logic_nbr, 1);
     if (result == FR_OK)
@@ -183,6 +321,9 @@ static int dfs_elm_mount(struct dfs_mnt *mnt, unsigned long rwflag, const void *
         if (dir == RT_NULL)
         {
             f_mount(RT_NULL, (const TCHAR *)logic_nbr, 1);
+#ifdef RT_DFS_ELM_USING_CACHE
+            dfs_elm_cache_detach(index);
+#endif
             disk[index] = RT_NULL;
             rt_free(fat);
             rt_device_close(mnt->dev_id);
@@ -202,6 +343,9 @@ static int dfs_elm_mount(struct dfs_mnt *mnt, unsigned long rwflag, const void *
 
 __err:
     f_mount(RT_NULL, (const TCHAR *)logic_nbr, 1);
+#ifdef RT_DFS_ELM_USING_CACHE
+    dfs_elm_cache_detach(index);
+#endif
     disk[index] = RT_NULL;
     rt_free(fat);
     rt_device_close(mnt->dev_id);
@@ -230,6 +374,10 @@ int dfs_elm_unmount(struct dfs_mnt *mnt)
         return elm_result_to_dfs(result);
 
     mnt->data = RT_NULL;
+#ifdef RT_DFS_ELM_USING_CACHE
+    /* f_mount() doesn't write anything back, the cached sectors are written here */
+    dfs_elm_cache_detach(index);
+#endif
     disk[index] = RT_NULL;
     rt_free(fat);
     rt_device_close(mnt->dev_id);
@@ -532,6 +680,9 @@ int dfs_elm_close(struct dfs_file *file)
         fd = (FIL *)(file->vnode->data);
         RT_ASSERT(fd != RT_NULL);
 
+#ifdef RT_DFS_ELM_USE_EXPAND
+        elm_raw_disable(fd);
+#endif
         f_close(fd);
         /* release memory */
         rt_free(fd);
@@ -552,6 +703,43 @@ int dfs_elm_ioctl(struct dfs_file *file, int cmd, void *args)
         off_t offset = (off_t)(size_t)(args);
         return dfs_elm_truncate(file, offset);
     }
+#ifdef RT_DFS_ELM_USE_EXPAND
+    case RT_FIOFALLOCATE:
+    {
+        FIL *fd;
+        FRESULT result;
+        fd = (FIL *)(file->vnode->data);
+        RT_ASSERT(fd != RT_NULL);
+
+        /* f_expand only allocates an empty file */
+        if (f_size(fd) != 0 || *(off_t *)args <= 0)
+            return -EINVAL;
+
+        rt_mutex_take(&file->vnode->lock, RT_WAITING_FOREVER);
+        result = f_expand(fd, (FSIZE_t)*(off_t *)args, 1);
+        if (result == FR_OK)
+            file->vnode->size = f_size(fd);
+        rt_mutex_release(&file->vnode->lock);
+        if (result == FR_DENIED)
+            return -ENOSPC; /* no contiguous free space of that size */
+        return elm_result_to_dfs(result);
+    }
+    case RT_FIORAWSEQ:
+    {
+        FIL *fd;
+        int ret = 0;
+        fd = (FIL *)(file->vnode->data);
+        RT_ASSERT(fd != RT_NULL);
+
+        rt_mutex_take(&file->vnode->lock, RT_WAITING_FOREVER);
+        if (*(int *)args)
+            ret = elm_raw_enable(fd);
+        else
+            elm_raw_disable(fd);
+        rt_mutex_release(&file->vnode->lock);
+        return ret;
+    }
+#endif
     case F_GETLK:
         return 0;
     case F_SETLK:
@@ -603,6 +791,18 @@ ssize_t dfs_elm_write(struct dfs_file *file, const void *buf, size_t len, off_t
     RT_ASSERT(fd != RT_NULL);
     rt_mutex_take(&file->vnode->lock, RT_WAITING_FOREVER);
     f_lseek(fd, *pos);
+#ifdef RT_DFS_ELM_USE_EXPAND
+    {
+        ssize_t ret = elm_raw_try_write(fd, buf, len);
+
+        if (ret != -ENOTSUP)
+        {
+            *pos = fd->fptr;
+            rt_mutex_release(&file->vnode->lock);
+            return ret;
+        }
+    }
+#endif
     result = f_write(fd, buf, len, &byte_write);
     /* update position and file size */
     *pos = fd->fptr;
@@ -1051,6 +1251,18 @@ ssize_t dfs_elm_page_write(struct dfs_page *page)
     RT_ASSERT(fd != RT_NULL);
     rt_mutex_take(&page->aspace->vnode->lock, RT_WAITING_FOREVER);
     f_lseek(fd, page->fpos);
+#ifdef RT_DFS_ELM_USE_EXPAND
+    {
+        /* a page of a file in raw mode goes to its sectors with one request */
+        ssize_t ret = elm_raw_try_write(fd, page->page, page->len);
+
+        if (ret != -ENOTSUP)
+        {
+            rt_mutex_release(&page->aspace->vnode->lock);
+            return ret;
+        }
+    }
+#endif
     result = f_write(fd, page->page, page->len, &byte_write);
     rt_mutex_release(&page->aspace->vnode->lock);
     if (result == FR_OK)
@@ -1132,6 +1344,15 @@ DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, UINT count)
     rt_size_t result;
     rt_device_t device = disk[drv];
 
+#ifdef RT_DFS_ELM_USING_CACHE
+    DRESULT res;
+
+    if (dfs_elm_cache_read(drv, buff, sector, count, &res))
+    {
+        return res;
+    }
+#endif
+
     result = rt_device_read(device, sector, buff, count);
     if (result == count)
     {
@@ -1147,6 +1368,15 @@ DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, UINT count)
     rt_size_t result;
     rt_device_t device = disk[drv];
 
+#ifdef RT_DFS_ELM_USING_CACHE
+    DRESULT res;
+
+    if (dfs_elm_cache_write(drv, buff, sector, count, &res))
+    {
+        return res;
+    }
+#endif
+
     result = rt_device_write(device, sector, buff, count);
     if (result == count)
     {
@@ -1195,10 +1425,21 @@ DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
     }
     else if (ctrl == CTRL_SYNC)
     {
+#ifdef RT_DFS_ELM_USING_CACHE
+        if (dfs_elm_cache_sync(drv) != RES_OK)
+        {
+            rt_device_control(device, RT_DEVICE_CTRL_BLK_SYNC, RT_NULL);
+            return RES_ERROR;
+        }
+#endif
         rt_device_control(device, RT_DEVICE_CTRL_BLK_SYNC, RT_NULL);
     }
     else if (ctrl == CTRL_TRIM)
     {
+#ifdef RT_DFS_ELM_USING_CACHE
+        /* keep the erase ordered after the writes of the same sectors */
+        dfs_elm_cache_sync(drv);
+#endif
         rt_device_control(device, RT_DEVICE_CTRL_BLK_ERASE, buff);
     }
 
@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2023-05-05     RTT          Implement mnt in dfs v2.0
  * 2023-10-23     Shell        fix synchronization of data to icache
+ * 2025-02-20     RT-Thread    support the targets without MMU
  */
 
 #define DBG_TAG "dfs.pcache"
@@ -16,9 +17,11 @@
 #include "dfs_pcache.h"
 #include "dfs_dentry.h"
 #include "dfs_mnt.h"
+#ifdef ARCH_MM_MMU
 #include "mm_page.h"
 #include <mmu.h>
 #include <tlb.h>
+#endif
 
 #include <rthw.h>
 
@@ -44,6 +47,24 @@
 #define RT_PAGECACHE_GC_STOP_LEVEL  70
 #endif
 
+#ifndef ARCH_MM_MMU
+/* without MMU the pages come from the system heap, no more than this share of it */
+#ifndef RT_PAGECACHE_HEAP_PERCENT
+#define RT_PAGECACHE_HEAP_PERCENT   25
+#endif
+
+#ifndef ARCH_PAGE_SIZE
+#ifdef RT_PAGECACHE_PAGE_SIZE
+#define ARCH_PAGE_SIZE              RT_PAGECACHE_PAGE_SIZE
+#else
+#define ARCH_PAGE_SIZE              4096
+#endif
+#endif
+
+/* page buffers are handed to the block drivers, keep them on cache lines for DMA */
+#define PCACHE_PAGE_ALIGN           32
+#endif /* ARCH_MM_MMU */
+
 #define PCACHE_MQ_GC    1
 #define PCACHE_MQ_WB    2
 
@@ -62,6 +83,9 @@ struct dfs_pcache_mq_obj
     rt_uint32_t cmd;
 };
 
+/* RT_PAGECACHE_COUNT, limited to what the heap can give on targets without MMU */
+static rt_size_t pcache_pages_max = RT_PAGECACHE_COUNT;
+
 static struct dfs_page *dfs_page_lookup(struct dfs_file *file, off_t pos);
 static void dfs_page_ref(struct dfs_page *page);
 static int dfs_page_inactive(struct dfs_page *page);
@@ -131,7 +155,7 @@ void dfs_pcache_release(size_t count)
 
     if (count == 0)
     {
-        count = rt_atomic_load(&(__pcache.pages_count)) - RT_PAGECACHE_COUNT * RT_PAGECACHE_GC_STOP_LEVEL / 100;
+        count = rt_atomic_load(&(__pcache.pages_count)) - pcache_pages_max * RT_PAGECACHE_GC_STOP_LEVEL / 100;
     }
 
     node = __pcache.list_inactive.next;
@@ -198,7 +222,7 @@ static int dfs_pcache_limit_check(void)
 {
     int index = 4;
 
-    while (index && rt_atomic_load(&(__pcache.pages_count)) > RT_PAGECACHE_COUNT * RT_PAGECACHE_GC_WORK_LEVEL / 100)
+    while (index && rt_atomic_load(&(__pcache.pages_count)) > pcache_pages_max * RT_PAGECACHE_GC_WORK_LEVEL / 100)
     {
         dfs_pcache_release(0);
         index --;
@@ -321,6 +345,19 @@ static int dfs_pcache_init(void)
 
     rt_mutex_init(&__pcache.lock, "pcache", RT_IPC_FLAG_PRIO);
 
+#ifndef ARCH_MM_MMU
+    {
+        rt_size_t total = 0, used = 0, max_used = 0;
+
+        rt_memory_info(&total, &used, &max_used);
+        if (total && pcache_pages_max > total / 100 * RT_PAGECACHE_HEAP_PERCENT / ARCH_PAGE_SIZE)
+        {
+            pcache_pages_max = total / 100 * RT_PAGECACHE_HEAP_PERCENT / ARCH_PAGE_SIZE;
+        }
+        LOG_I("page cache: %d pages of %d bytes", pcache_pages_max, ARCH_PAGE_SIZE);
+    }
+#endif
+
     __pcache.mqueue = rt_mq_create("pcache", sizeof(struct dfs_pcache_mq_obj), 1024, RT_IPC_FLAG_FIFO);
     tid = rt_thread_create("pcache", dfs_pcache_thread, 0, 8192, 25, 5);
     if (tid)
@@ -626,7 +663,7 @@ static int dfs_pcache_dump(int argc, char **argv)
 
     dfs_pcache_lock();
 
-    rt_kprintf("total pages count: %d / %d\n", rt_atomic_load(&(__pcache.pages_count)), RT_PAGECACHE_COUNT);
+    rt_kprintf("total pages count: %d / %d\n", rt_atomic_load(&(__pcache.pages_count)), pcache_pages_max);
 
     rt_list_for_each(node, &__pcache.list_active)
     {
@@ -668,6 +705,7 @@ static int dfs_page_unmap(struct dfs_page *page)
         dfs_page_dirty(page);
     }
 
+#ifdef ARCH_MM_MMU
     while (next != &page->mmap_head)
     {
         map = rt_list_entry(next, struct dfs_mmap, mmap_node);
@@ -687,6 +725,10 @@ static int dfs_page_unmap(struct dfs_page *page)
             rt_free(map);
         }
     }
+#else
+    /* nothing maps the pages without MMU */
+    (void)map;
+#endif
 
     rt_list_init(&page->mmap_head);
 
@@ -700,7 +742,11 @@ static struct dfs_page *dfs_page_create(void)
     page = rt_calloc(1, sizeof(struct dfs_page));
     if (page)
     {
+#ifdef ARCH_MM_MMU
         page->page = rt_pages_alloc_ext(0, PAGE_ANY_AVAILABLE);
+#else
+        page->page = rt_malloc_align(ARCH_PAGE_SIZE, PCACHE_PAGE_ALIGN);
+#endif
         if (page->page)
         {
             //memset(page->page, 0x00, ARCH_PAGE_SIZE);
@@ -753,7 +799,11 @@ static void dfs_page_release(struct dfs_page *page)
         }
         RT_ASSERT(page->is_dirty == 0);
 
+#ifdef ARCH_MM_MMU
         rt_pages_free(page->page, 0);
+#else
+        rt_free_align(page->page);
+#endif
         page->page = RT_NULL;
         rt_free(page);
     }
@@ -1054,11 +1104,11 @@ static struct dfs_page *dfs_page_lookup(struct dfs_file *file, off_t pos)
         {
             dfs_aspace_unlock(aspace);
 
-            if (rt_atomic_load(&(__pcache.pages_count)) >= RT_PAGECACHE_COUNT)
+            if (rt_atomic_load(&(__pcache.pages_count)) >= pcache_pages_max)
             {
                 dfs_pcache_limit_check();
             }
-            else if (rt_atomic_load(&(__pcache.pages_count)) >= RT_PAGECACHE_COUNT * RT_PAGECACHE_GC_WORK_LEVEL / 100)
+            else if (rt_atomic_load(&(__pcache.pages_count)) >= pcache_pages_max * RT_PAGECACHE_GC_WORK_LEVEL / 100)
             {
                 dfs_pcache_mq_work(PCACHE_MQ_GC);
             }
@@ -1272,6 +1322,7 @@ int dfs_aspace_clean(struct dfs_aspace *aspace)
     return 0;
 }
 
+#ifdef ARCH_MM_MMU
 void *dfs_aspace_mmap(struct dfs_file *file, struct rt_varea *varea, void *vaddr)
 {
     void *ret = RT_NULL;
@@ -1510,4 +1561,6 @@ int dfs_aspace_mmap_write(struct dfs_file *file, struct rt_varea *varea, void *d
     return ret;
 }
 
+#endif /* ARCH_MM_MMU */
+
 #endif
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-19     RT-Thread    the first version
+ * 2025-02-19     RT-Thread    add elm_rec
+ */
+
+/*
+ * elm_bench: the small file workloads the sector cache is for. Run it once
+ * with "elm_cache on" and once with "elm_cache off", the device request
+ * counts show what the cache saved.
+ *
+ * elm_rec: a long streaming write like a recorder, into a file growing
+ * cluster by cluster, a pre-allocated file, or a pre-allocated file in raw
+ * sequential mode.
+ */
+
+#include <rtthread.h>
+#include <dfs_file.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include "dfs_elm.h"
+
+#ifdef RT_USING_FINSH
+#include <stdlib.h>
+
+#ifdef RT_DFS_ELM_USING_CACHE
+
+#define ELM_BENCH_APPENDS       512
+#define ELM_BENCH_APPEND_SIZE   64
+#define ELM_BENCH_SYNC_EVERY    8
+#define ELM_BENCH_FILES         128
+
+static void _bench_requests(rt_uint32_t *reads, rt_uint32_t *writes)
+{
+    struct dfs_elm_cache_stats stats;
+    int drv;
+
+    *reads = *writes = 0;
+    for (drv = 0; drv < RT_DFS_ELM_DRIVES; drv++)
+    {
+        if (dfs_elm_cache_get_stats(drv, &stats) == RT_EOK)
+        {
+            *reads += stats.dev_reads;
+            *writes += stats.dev_writes;
+        }
+    }
+}
+
+static void _bench_report(const char *name, int ops, rt_tick_t ticks, rt_uint32_t reads, rt_uint32_t writes)
+{
+    rt_uint32_t ms = ticks * 1000 / RT_TICK_PER_SECOND;
+    rt_uint32_t r, w;
+
+    _bench_requests(&r, &w);
+    rt_kprintf("%-16s %5d ops %6u ms %7u ops/s, device reads %u writes %u\n", name, ops, ms,
+               ms ? (rt_uint32_t)ops * 1000 / ms : 0, r - reads, w - writes);
+}
+
+/* small appends with periodic fsync, then a listing of a directory of small files */
+static void elm_bench(int argc, char **argv)
+{
+    char path[DFS_PATH_MAX];
+    char *buf;
+    rt_uint32_t reads, writes;
+    rt_tick_t tick;
+    struct dirent *ent;
+    DIR *dir;
+    int fd, i, n;
+
+    if (argc != 2)
+    {
+        rt_kprintf("Usage: elm_bench <dir on a fat volume>, compare with elm_cache on/off\n");
+        return;
+    }
+
+    buf = rt_malloc(ELM_BENCH_APPEND_SIZE);
+    if (buf == RT_NULL)
+    {
+        return;
+    }
+    rt_memset(buf, 'a', ELM_BENCH_APPEND_SIZE);
+
+    /* small appends */
+    rt_snprintf(path, sizeof(path), "%s/append.bin", argv[1]);
+    unlink(path);
+    fd = open(path, O_WRONLY | O_CREAT | O_APPEND);
+    if (fd < 0)
+    {
+        rt_kprintf("open %s failed\n", path);
+        rt_free(buf);
+        return;
+    }
+    _bench_requests(&reads, &writes);
+    tick = rt_tick_get();
+    for (i = 0; i < ELM_BENCH_APPENDS; i++)
+    {
+        if (write(fd, buf, ELM_BENCH_APPEND_SIZE) != ELM_BENCH_APPEND_SIZE)
+            break;
+        if ((i + 1) % ELM_BENCH_SYNC_EVERY == 0)
+            fsync(fd);
+    }
+    close(fd);
+    _bench_report("append 64B", i, rt_tick_get() - tick, reads, writes);
+    unlink(path);
+
+    /* directory of small files */
+    rt_snprintf(path, sizeof(path), "%s/elm_bench", argv[1]);
+    mkdir(path, 0);
+    _bench_requests(&reads, &writes);
+    tick = rt_tick_get();
+    for (i = 0; i < ELM_BENCH_FILES; i++)
+    {
+        rt_snprintf(path, sizeof(path), "%s/elm_bench/file_%03d.txt", argv[1], i);
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC);
+        if (fd < 0)
+            break;
+        write(fd, buf, ELM_BENCH_APPEND_SIZE);
+        close(fd);
+    }
+    _bench_report("create", i, rt_tick_get() - tick, reads, writes);
+
+    rt_snprintf(path, sizeof(path), "%s/elm_bench", argv[1]);
+    _bench_requests(&reads, &writes);
+    tick = rt_tick_get();
+    n = 0;
+    dir = opendir(path);
+    if (dir)
+    {
+        while ((ent = readdir(dir)) != RT_NULL)
+        {
+            struct stat st;
+
+            /* ls does a stat per entry */
+            rt_snprintf(path, sizeof(path), "%s/elm_bench/%s", argv[1], ent->d_name);
+            stat(path, &st);
+            n++;
+        }
+        closedir(dir);
+    }
+    _bench_report("list + stat", n, rt_tick_get() - tick, reads, writes);
+
+    for (i = 0; i < ELM_BENCH_FILES; i++)
+    {
+        rt_snprintf(path, sizeof(path), "%s/elm_bench/file_%03d.txt", argv[1], i);
+        unlink(path);
+    }
+    rt_snprintf(path, sizeof(path), "%s/elm_bench", argv[1]);
+    rmdir(path);
+    rt_free(buf);
+}
+MSH_CMD_EXPORT(elm_bench, elm-FAT small append and directory listing benchmark: elm_bench <dir>);
+
+#endif /* RT_DFS_ELM_USING_CACHE */
+
+#ifdef RT_DFS_ELM_USE_EXPAND
+/* DFS v2: around the page cache, every write reaches elm-FAT when it is issued */
+#ifdef O_DIRECT
+#define ELM_REC_OFLAGS          (O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT)
+#else
+#define ELM_REC_OFLAGS          (O_WRONLY | O_CREAT | O_TRUNC)
+#endif
+
+/* elm_rec <file> [MB] [chunk KB] [grow|expand|raw] */
+static void elm_rec(int argc, char **argv)
+{
+    rt_uint32_t total_mb = 1024, chunk = 64 * 1024;
+    rt_uint32_t start, t, ms, max_ms = 0, slow = 0, n = 0, writes;
+    rt_uint64_t done = 0, size;
+    const char *mode = "raw";
+    off_t length;
+    char *buf;
+    int fd, on = 1;
+
+    if (argc < 2)
+    {
+        rt_kprintf("Usage: elm_rec <file> [MB, 1024] [chunk KB, 64] [grow|expand|raw]\n");
+        return;
+    }
+    if (argc > 2)
+        total_mb = atoi(argv[2]);
+    if (argc > 3)
+        chunk = atoi(argv[3]) * 1024;
+    if (argc > 4)
+        mode = argv[4];
+    if (total_mb == 0 || chunk == 0 || chunk % 512)
+    {
+        rt_kprintf("bad size\n");
+        return;
+    }
+    size = (rt_uint64_t)total_mb * 1024 * 1024;
+    writes = (rt_uint32_t)(size / chunk);
+
+    buf = rt_malloc_align(chunk, 32);
+    if (buf == RT_NULL)
+    {
+        rt_kprintf("no memory for a %u byte chunk\n", chunk);
+        return;
+    }
+    rt_memset(buf, 0x5a, chunk);
+
+    unlink(argv[1]);
+    fd = open(argv[1], ELM_REC_OFLAGS);
+    if (fd < 0)
+    {
+        rt_kprintf("open %s failed\n", argv[1]);
+        rt_free_align(buf);
+        return;
+    }
+
+    start = rt_tick_get_millisecond();
+    if (rt_strcmp(mode, "grow") != 0)
+    {
+        length = (off_t)size;
+        if (ioctl(fd, RT_FIOFALLOCATE, &length) < 0)
+        {
+            rt_kprintf("no contiguous space for %u MB\n", total_mb);
+            goto __exit;
+        }
+        rt_kprintf("allocated %u MB in %u ms\n", total_mb, rt_tick_get_millisecond() - start);
+        if (rt_strcmp(mode, "raw") == 0 && ioctl(fd, RT_FIORAWSEQ, &on) < 0)
+        {
+            rt_kprintf("raw sequential mode failed\n");
+            goto __exit;
+        }
+    }
+
+    start = rt_tick_get_millisecond();
+    for (n = 0; n < writes; n++)
+    {
+        t = rt_tick_get_millisecond();
+        if (write(fd, buf, chunk) != (ssize_t)chunk)
+        {
+            rt_kprintf("write failed at %u MB\n", (rt_uint32_t)(done >> 20));
+            break;
+        }
+        ms = rt_tick_get_millisecond() - t;
+        if (ms > max_ms)
+            max_ms = ms;
+        /* writes slower than a 2 MB/s stream can absorb with a single chunk of buffering */
+        if (ms > chunk / 2048)
+            slow++;
+        done += chunk;
+        if ((done & ((64 << 20) - 1)) == 0)
+            rt_kprintf("%u MB\n", (rt_uint32_t)(done >> 20));
+    }
+    fsync(fd);
+    ms = rt_tick_get_millisecond() - start;
+
+    rt_kprintf("%s: %u MB in %u ms, %u KB/s, worst write %u ms, %u of %u writes over %u ms\n", mode,
+               (rt_uint32_t)(done >> 20), ms, ms ? (rt_uint32_t)(done / ms * 1000 / 1024) : 0,
+               max_ms, slow, n, chunk / 2048);
+
+__exit:
+    close(fd);
+    rt_free_align(buf);
+}
+MSH_CMD_EXPORT(elm_rec, elm-FAT streaming write benchmark: elm_rec <file> [MB] [chunk KB] [grow|expand|raw]);
+#endif /* RT_DFS_ELM_USE_EXPAND */
+
+#endif /* RT_USING_FINSH */
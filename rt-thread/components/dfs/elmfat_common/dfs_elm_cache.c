@@ -0,0 +1,891 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-19     RT-Thread    the first version
+ * 2025-03-02     RT-Thread    sticky write back error, host self-test
+ */
+
+/*
+ * Sector cache between elm-FAT's disk_read()/disk_write() and the block device.
+ * Both the DFS v1 and v2 elm-FAT SConscripts build it, against their own
+ * ff.h, diskio.h and dfs_elm.h.
+ *
+ * Small requests (FAT table, directory entries, partial clusters) go through
+ * a per volume pool of sector lines kept in LRU order. A run of sequential
+ * single sector misses turns on read-ahead, which fills the following
+ * sectors with one multi-block read. Writes only dirty the lines, dirty
+ * lines are written back in sector order and adjacent sectors go out as one
+ * multi-block write, on eviction, on CTRL_SYNC (f_sync, f_close), on unmount
+ * and on dfs_elm_cache_flush(). Requests of a whole staging buffer or more
+ * bypass the pool, they are already efficient.
+ *
+ * A write back that fails outside a sync (eviction, read-ahead) cannot be
+ * reported to its caller; the error is kept and returned by the next sync
+ * of the volume, so f_sync()/f_close() fail instead of losing data quietly.
+ *
+ * dfs_elm_cache_selftest() runs the cache against a RAM disk and a
+ * reference image; on a PC, with a small stand-in for the RT-Thread calls:
+ *
+ *   cc -O2 -DELM_CACHE_HOST -o elm_cache \
+ *      rt-thread/components/dfs/elmfat_common/dfs_elm_cache.c
+ *   ./elm_cache
+ */
+
+#ifdef ELM_CACHE_HOST
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* what the cache uses of ff.h, diskio.h, dfs_elm.h and RT-Thread */
+typedef uint8_t BYTE;
+typedef unsigned int UINT;
+typedef uint32_t DWORD;
+typedef enum { RES_OK = 0, RES_ERROR, RES_WRPRT, RES_NOTRDY, RES_PARERR } DRESULT;
+typedef int rt_bool_t;
+typedef uint32_t rt_uint32_t;
+typedef size_t rt_size_t;
+
+#define FF_VOLUMES                      1
+#define FF_MAX_SS                       512
+#define RT_DFS_ELM_USING_CACHE
+#define RT_DFS_ELM_CACHE_SECTORS        16
+#define RT_DFS_ELM_CACHE_READAHEAD      4
+#define RT_NAME_MAX                     8
+#define RT_TRUE                         1
+#define RT_FALSE                        0
+#define RT_NULL                         NULL
+#define RT_EOK                          0
+#define RT_ERROR                        1
+#define RT_ENOMEM                       5
+#define RT_EINVAL                       10
+#define RT_EIO                          8
+#define RT_WAITING_FOREVER              (-1)
+#define RT_IPC_FLAG_PRIO                0
+#define RT_DEVICE_CTRL_BLK_GETGEOME     0x10
+#define RT_ASSERT(x)                    do { if (!(x)) abort(); } while (0)
+#define LOG_E(...)                      (printf("E/elm.cache: " __VA_ARGS__), printf("\n"))
+#define LOG_W(...)                      (printf("W/elm.cache: " __VA_ARGS__), printf("\n"))
+#define rt_kprintf                      printf
+#define rt_snprintf                     snprintf
+#define rt_memcpy                       memcpy
+#define rt_memset                       memset
+#define rt_calloc                       calloc
+#define rt_free                         free
+#define rt_free_align                   free
+#define rt_malloc_align(size, align)    aligned_alloc(align, ((size) + (align) - 1) / (align) * (align))
+
+struct dfs_elm_cache_stats
+{
+    rt_uint32_t hits, misses, readahead, writes, write_hits, coalesced;
+    rt_uint32_t evict_writes, flushes, dev_reads, dev_writes;
+};
+
+typedef struct rt_list_node
+{
+    struct rt_list_node *next, *prev;
+} rt_list_t;
+
+#define rt_list_entry(node, type, member)   ((type *)((char *)(node) - offsetof(type, member)))
+#define rt_list_for_each_entry(pos, head, member) \
+    for (pos = rt_list_entry((head)->next, __typeof__(*pos), member); \
+         &pos->member != (head); \
+         pos = rt_list_entry(pos->member.next, __typeof__(*pos), member))
+
+static void rt_list_init(rt_list_t *l)
+{
+    l->next = l->prev = l;
+}
+
+static void rt_list_insert_after(rt_list_t *l, rt_list_t *n)
+{
+    l->next->prev = n;
+    n->next = l->next;
+    l->next = n;
+    n->prev = l;
+}
+
+static void rt_list_insert_before(rt_list_t *l, rt_list_t *n)
+{
+    l->prev->next = n;
+    n->prev = l->prev;
+    l->prev = n;
+    n->next = l;
+}
+
+static void rt_list_remove(rt_list_t *n)
+{
+    n->next->prev = n->prev;
+    n->prev->next = n->next;
+    n->next = n->prev = n;
+}
+
+/* one thread, the lock only has to exist */
+struct rt_mutex
+{
+    int taken;
+};
+#define rt_mutex_init(m, name, flag)    ((m)->taken = 0)
+#define rt_mutex_take(m, timeout)       ((m)->taken++)
+#define rt_mutex_release(m)             ((m)->taken--)
+#define rt_mutex_detach(m)              ((void)(m))
+
+struct rt_device_blk_geometry
+{
+    rt_uint32_t sector_count;
+    rt_uint32_t bytes_per_sector;
+    rt_uint32_t block_size;
+};
+
+/* RAM disk, writes fail while fail_writes is set */
+struct rt_device
+{
+    BYTE *image;
+    DWORD sectors;
+    int fail_writes;
+};
+typedef struct rt_device *rt_device_t;
+
+static rt_size_t rt_device_read(rt_device_t dev, DWORD pos, void *buffer, rt_size_t size)
+{
+    if (pos + size > dev->sectors)
+        return 0;
+    memcpy(buffer, dev->image + (size_t)pos * FF_MAX_SS, size * FF_MAX_SS);
+    return size;
+}
+
+static rt_size_t rt_device_write(rt_device_t dev, DWORD pos, const void *buffer, rt_size_t size)
+{
+    if (dev->fail_writes || pos + size > dev->sectors)
+        return 0;
+    memcpy(dev->image + (size_t)pos * FF_MAX_SS, buffer, size * FF_MAX_SS);
+    return size;
+}
+
+static int rt_device_control(rt_device_t dev, int cmd, void *args)
+{
+    struct rt_device_blk_geometry *geometry = (struct rt_device_blk_geometry *)args;
+
+    (void)cmd;
+    geometry->sector_count = dev->sectors;
+    geometry->bytes_per_sector = FF_MAX_SS;
+    geometry->block_size = FF_MAX_SS;
+    return RT_EOK;
+}
+
+int dfs_elm_cache_attach(BYTE drv, rt_device_t dev);
+void dfs_elm_cache_detach(BYTE drv);
+rt_bool_t dfs_elm_cache_read(BYTE drv, BYTE *buff, DWORD sector, UINT count, DRESULT *res);
+rt_bool_t dfs_elm_cache_write(BYTE drv, const BYTE *buff, DWORD sector, UINT count, DRESULT *res);
+DRESULT dfs_elm_cache_sync(BYTE drv);
+int dfs_elm_cache_get_stats(int drv, struct dfs_elm_cache_stats *stats);
+int dfs_elm_cache_selftest(void);
+#else
+#include <rtthread.h>
+#include <rtdevice.h>
+#include "ffconf.h"
+#include "ff.h"
+#include "diskio.h"
+#include "dfs_elm_cache.h"
+#endif /* ELM_CACHE_HOST */
+
+#ifdef RT_DFS_ELM_USING_CACHE
+
+#ifndef ELM_CACHE_HOST
+#define DBG_TAG "elm.cache"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+#endif
+
+#ifndef RT_DFS_ELM_CACHE_SECTORS
+#define RT_DFS_ELM_CACHE_SECTORS        64
+#endif
+
+#ifndef RT_DFS_ELM_CACHE_READAHEAD
+#define RT_DFS_ELM_CACHE_READAHEAD      16
+#endif
+
+#if RT_DFS_ELM_CACHE_READAHEAD >= RT_DFS_ELM_CACHE_SECTORS
+#error "RT_DFS_ELM_CACHE_READAHEAD must be less than RT_DFS_ELM_CACHE_SECTORS"
+#endif
+
+/* sequential single sector misses before the read-ahead starts */
+#define ELM_CACHE_SEQ_TRIGGER           2
+/* buffers handed to the block device are cache line aligned, so the SDMMC DMA can use them */
+#define ELM_CACHE_ALIGN                 32
+
+struct elm_cache_line
+{
+    rt_list_t list;                     /* LRU, the most recent first */
+    DWORD sector;
+    rt_bool_t valid;
+    rt_bool_t dirty;
+    BYTE *data;
+};
+
+struct elm_cache
+{
+    rt_device_t dev;
+    UINT ssize;
+    DWORD sector_count;
+    struct rt_mutex lock;
+    rt_list_t lru;
+    struct elm_cache_line lines[RT_DFS_ELM_CACHE_SECTORS];
+    BYTE *pool;
+    BYTE *stage;                        /* RT_DFS_ELM_CACHE_READAHEAD sectors, read-ahead and write-back */
+    struct elm_cache_line *run[RT_DFS_ELM_CACHE_SECTORS];
+
+    DWORD next_sector;                  /* the sector after the last miss */
+    rt_uint32_t seq_misses;
+    rt_bool_t bypass;
+    DRESULT error;                      /* a write back failed since the last sync, which returns it */
+
+    struct dfs_elm_cache_stats stats;
+};
+
+static struct elm_cache *elm_caches[FF_VOLUMES];
+
+static struct elm_cache_line *_lookup(struct elm_cache *cache, DWORD sector)
+{
+    struct elm_cache_line *line;
+
+    rt_list_for_each_entry(line, &cache->lru, list)
+    {
+        if (line->valid && line->sector == sector)
+        {
+            return line;
+        }
+    }
+    return RT_NULL;
+}
+
+static void _touch(struct elm_cache *cache, struct elm_cache_line *line)
+{
+    rt_list_remove(&line->list);
+    rt_list_insert_after(&cache->lru, &line->list);
+}
+
+static DRESULT _dev_read(struct elm_cache *cache, BYTE *buff, DWORD sector, UINT count)
+{
+    cache->stats.dev_reads++;
+    return rt_device_read(cache->dev, sector, buff, count) == count ? RES_OK : RES_ERROR;
+}
+
+static DRESULT _dev_write(struct elm_cache *cache, const BYTE *buff, DWORD sector, UINT count)
+{
+    cache->stats.dev_writes++;
+    return rt_device_write(cache->dev, sector, buff, count) == count ? RES_OK : RES_ERROR;
+}
+
+/*
+ * write the dirty lines in run[0..count), sectors ascending, adjacent ones with one request;
+ * a failure is also kept in cache->error for the next sync
+ */
+static DRESULT _write_run(struct elm_cache *cache, struct elm_cache_line **run, int count)
+{
+    DRESULT res = RES_OK;
+    int start, n, i;
+
+    for (start = 0; start < count; start += n)
+    {
+        for (n = 1; start + n < count && n < RT_DFS_ELM_CACHE_READAHEAD &&
+                    run[start + n]->sector == run[start]->sector + n; n++);
+
+        if (n == 1)
+        {
+            /* the line itself is aligned, no copy */
+            if (_dev_write(cache, run[start]->data, run[start]->sector, 1) != RES_OK)
+            {
+                res = cache->error = RES_ERROR;
+                continue;
+            }
+        }
+        else
+        {
+            for (i = 0; i < n; i++)
+            {
+                rt_memcpy(cache->stage + i * cache->ssize, run[start + i]->data, cache->ssize);
+            }
+            if (_dev_write(cache, cache->stage, run[start]->sector, n) != RES_OK)
+            {
+                res = cache->error = RES_ERROR;
+                continue;
+            }
+            cache->stats.coalesced += n - 1;
+        }
+        for (i = 0; i < n; i++)
+        {
+            run[start + i]->dirty = RT_FALSE;
+        }
+    }
+    return res;
+}
+
+/* evict the LRU line, the dirty neighbours of a dirty victim are written with it */
+static struct elm_cache_line *_evict(struct elm_cache *cache)
+{
+    struct elm_cache_line *victim, *line;
+    DWORD first;
+    int count = 0;
+
+    victim = rt_list_entry(cache->lru.prev, struct elm_cache_line, list);
+    if (victim->valid && victim->dirty)
+    {
+        /* walk back to the start of the dirty run, then collect it forward */
+        first = victim->sector;
+        while (first > 0 && (line = _lookup(cache, first - 1)) != RT_NULL && line->dirty &&
+               victim->sector - (first - 1) < RT_DFS_ELM_CACHE_READAHEAD)
+        {
+            first--;
+        }
+        while (count < RT_DFS_ELM_CACHE_READAHEAD && (line = _lookup(cache, first + count)) != RT_NULL &&
+               line->dirty)
+        {
+            cache->run[count++] = line;
+        }
+        cache->stats.evict_writes++;
+        if (_write_run(cache, cache->run, count) != RES_OK)
+        {
+            /* the line is needed, its data is lost; the next sync reports it */
+            LOG_E("write back sector %u failed", victim->sector);
+        }
+    }
+    victim->valid = RT_FALSE;
+    victim->dirty = RT_FALSE;
+    return victim;
+}
+
+static struct elm_cache_line *_install(struct elm_cache *cache, DWORD sector)
+{
+    struct elm_cache_line *line = _evict(cache);
+
+    line->sector = sector;
+    line->valid = RT_TRUE;
+    _touch(cache, line);
+    return line;
+}
+
+/* write all dirty lines back, returns the error of this or any earlier write back since the last one */
+static DRESULT _flush(struct elm_cache *cache)
+{
+    struct elm_cache_line *line;
+    DRESULT res;
+    int count = 0, i, j;
+
+    rt_list_for_each_entry(line, &cache->lru, list)
+    {
+        if (line->valid && line->dirty)
+        {
+            /* insertion sort by sector, the pool is small */
+            for (i = count; i > 0 && cache->run[i - 1]->sector > line->sector; i--)
+            {
+                cache->run[i] = cache->run[i - 1];
+            }
+            cache->run[i] = line;
+            count++;
+        }
+    }
+    if (count > 0)
+    {
+        cache->stats.flushes++;
+        if (_write_run(cache, cache->run, count) != RES_OK)
+        {
+            /* drop what could not be written, the card may be gone */
+            for (j = 0; j < count; j++)
+            {
+                cache->run[j]->dirty = RT_FALSE;
+                cache->run[j]->valid = RT_FALSE;
+            }
+        }
+    }
+
+    res = cache->error;
+    cache->error = RES_OK;
+    return res;
+}
+
+static DRESULT _read_ahead(struct elm_cache *cache, DWORD sector, UINT count)
+{
+    struct elm_cache_line *line;
+    UINT i;
+
+    if (cache->sector_count && sector + count > cache->sector_count)
+    {
+        count = cache->sector_count - sector;
+    }
+
+    /* the lines about to be reused are written back first, the write back also goes through stage */
+    line = rt_list_entry(cache->lru.prev, struct elm_cache_line, list);
+    for (i = 0; i < count; i++)
+    {
+        if (line->valid && line->dirty)
+        {
+            cache->run[0] = line;
+            _write_run(cache, cache->run, 1);
+        }
+        line = rt_list_entry(line->list.prev, struct elm_cache_line, list);
+    }
+
+    if (_dev_read(cache, cache->stage, sector, count) != RES_OK)
+    {
+        return RES_ERROR;
+    }
+    for (i = 0; i < count; i++)
+    {
+        /* a cached line is newer or the same */
+        if (_lookup(cache, sector + i) == RT_NULL)
+        {
+            line = _install(cache, sector + i);
+            rt_memcpy(line->data, cache->stage + i * cache->ssize, cache->ssize);
+        }
+    }
+    cache->stats.readahead += count;
+    return RES_OK;
+}
+
+static DRESULT _read(struct elm_cache *cache, BYTE *buff, DWORD sector, UINT count)
+{
+    struct elm_cache_line *line;
+    UINT i;
+
+    if (count >= RT_DFS_ELM_CACHE_READAHEAD)
+    {
+        /* long read, straight from the device, then lay the dirty lines over it */
+        if (_dev_read(cache, buff, sector, count) != RES_OK)
+        {
+            return RES_ERROR;
+        }
+        for (i = 0; i < count; i++)
+        {
+            line = _lookup(cache, sector + i);
+            if (line && line->dirty)
+            {
+                rt_memcpy(buff + i * cache->ssize, line->data, cache->ssize);
+            }
+        }
+        cache->next_sector = sector + count;
+        return RES_OK;
+    }
+
+    for (i = 0; i < count; i++, buff += cache->ssize)
+    {
+        line = _lookup(cache, sector + i);
+        if (line)
+        {
+            cache->stats.hits++;
+            _touch(cache, line);
+            rt_memcpy(buff, line->data, cache->ssize);
+            continue;
+        }
+
+        cache->stats.misses++;
+        if (sector + i == cache->next_sector)
+        {
+            cache->seq_misses++;
+        }
+        else
+        {
+            cache->seq_misses = 0;
+        }
+        cache->next_sector = sector + i + 1;
+
+        if (cache->seq_misses >= ELM_CACHE_SEQ_TRIGGER)
+        {
+            if (_read_ahead(cache, sector + i, RT_DFS_ELM_CACHE_READAHEAD) != RES_OK)
+            {
+                return RES_ERROR;
+            }
+            line = _lookup(cache, sector + i);
+        }
+        else
+        {
+            line = _install(cache, sector + i);
+            if (_dev_read(cache, line->data, sector + i, 1) != RES_OK)
+            {
+                line->valid = RT_FALSE;
+                return RES_ERROR;
+            }
+        }
+        rt_memcpy(buff, line->data, cache->ssize);
+    }
+    return RES_OK;
+}
+
+static DRESULT _write(struct elm_cache *cache, const BYTE *buff, DWORD sector, UINT count)
+{
+    struct elm_cache_line *line;
+    UINT i;
+
+    if (count >= RT_DFS_ELM_CACHE_READAHEAD)
+    {
+        /* long write, straight to the device, the cached copies become clean */
+        if (_dev_write(cache, buff, sector, count) != RES_OK)
+        {
+            return RES_ERROR;
+        }
+        for (i = 0; i < count; i++)
+        {
+            line = _lookup(cache, sector + i);
+            if (line)
+            {
+                rt_memcpy(line->data, buff + i * cache->ssize, cache->ssize);
+                line->dirty = RT_FALSE;
+            }
+        }
+        return RES_OK;
+    }
+
+    for (i = 0; i < count; i++, buff += cache->ssize)
+    {
+        line = _lookup(cache, sector + i);
+        if (line)
+        {
+            /* the same FAT or directory sector written again */
+            cache->stats.write_hits++;
+            _touch(cache, line);
+        }
+        else
+        {
+            line = _install(cache, sector + i);
+        }
+        rt_memcpy(line->data, buff, cache->ssize);
+        line->dirty = RT_TRUE;
+    }
+    cache->stats.writes += count;
+    return RES_OK;
+}
+
+int dfs_elm_cache_attach(BYTE drv, rt_device_t dev)
+{
+    struct elm_cache *cache;
+    struct rt_device_blk_geometry geometry;
+    char name[RT_NAME_MAX];
+    int i;
+
+    RT_ASSERT(drv < FF_VOLUMES);
+
+    rt_memset(&geometry, 0, sizeof(geometry));
+    rt_device_control(dev, RT_DEVICE_CTRL_BLK_GETGEOME, &geometry);
+    if (geometry.bytes_per_sector == 0 || geometry.bytes_per_sector > FF_MAX_SS)
+    {
+        return -RT_EINVAL;
+    }
+
+    cache = rt_calloc(1, sizeof(struct elm_cache));
+    if (cache == RT_NULL)
+    {
+        return -RT_ENOMEM;
+    }
+    cache->ssize = geometry.bytes_per_sector;
+    cache->sector_count = geometry.sector_count;
+    cache->pool = rt_malloc_align(cache->ssize * RT_DFS_ELM_CACHE_SECTORS, ELM_CACHE_ALIGN);
+    cache->stage = rt_malloc_align(cache->ssize * RT_DFS_ELM_CACHE_READAHEAD, ELM_CACHE_ALIGN);
+    if (cache->pool == RT_NULL || cache->stage == RT_NULL)
+    {
+        LOG_W("no memory for the sector cache of drive %d", drv);
+        if (cache->pool)
+            rt_free_align(cache->pool);
+        if (cache->stage)
+            rt_free_align(cache->stage);
+        rt_free(cache);
+        return -RT_ENOMEM;
+    }
+
+    cache->dev = dev;
+    cache->next_sector = (DWORD)-1;
+    rt_list_init(&cache->lru);
+    for (i = 0; i < RT_DFS_ELM_CACHE_SECTORS; i++)
+    {
+        cache->lines[i].data = cache->pool + i * cache->ssize;
+        rt_list_insert_before(&cache->lru, &cache->lines[i].list);
+    }
+    rt_snprintf(name, sizeof(name), "elmc%d", drv);
+    rt_mutex_init(&cache->lock, name, RT_IPC_FLAG_PRIO);
+
+    elm_caches[drv] = cache;
+    return RT_EOK;
+}
+
+void dfs_elm_cache_detach(BYTE drv)
+{
+    struct elm_cache *cache = elm_caches[drv];
+
+    if (cache == RT_NULL)
+    {
+        return;
+    }
+
+    rt_mutex_take(&cache->lock, RT_WAITING_FOREVER);
+    if (_flush(cache) != RES_OK)
+    {
+        LOG_E("drive %d: cached sectors lost on detach", drv);
+    }
+    elm_caches[drv] = RT_NULL;
+    rt_mutex_release(&cache->lock);
+
+    rt_mutex_detach(&cache->lock);
+    rt_free_align(cache->pool);
+    rt_free_align(cache->stage);
+    rt_free(cache);
+}
+
+rt_bool_t dfs_elm_cache_read(BYTE drv, BYTE *buff, DWORD sector, UINT count, DRESULT *res)
+{
+    struct elm_cache *cache = elm_caches[drv];
+
+    if (cache == RT_NULL)
+    {
+        return RT_FALSE;
+    }
+
+    rt_mutex_take(&cache->lock, RT_WAITING_FOREVER);
+    /* bypassed requests are still counted, for the comparison with the cache on */
+    *res = cache->bypass ? _dev_read(cache, buff, sector, count) : _read(cache, buff, sector, count);
+    rt_mutex_release(&cache->lock);
+    return RT_TRUE;
+}
+
+rt_bool_t dfs_elm_cache_write(BYTE drv, const BYTE *buff, DWORD sector, UINT count, DRESULT *res)
+{
+    struct elm_cache *cache = elm_caches[drv];
+
+    if (cache == RT_NULL)
+    {
+        return RT_FALSE;
+    }
+
+    rt_mutex_take(&cache->lock, RT_WAITING_FOREVER);
+    /* bypassed requests are still counted, for the comparison with the cache on */
+    *res = cache->bypass ? _dev_write(cache, buff, sector, count) : _write(cache, buff, sector, count);
+    rt_mutex_release(&cache->lock);
+    return RT_TRUE;
+}
+
+DRESULT dfs_elm_cache_sync(BYTE drv)
+{
+    struct elm_cache *cache = elm_caches[drv];
+    DRESULT res;
+
+    if (cache == RT_NULL)
+    {
+        return RES_OK;
+    }
+
+    rt_mutex_take(&cache->lock, RT_WAITING_FOREVER);
+    res = _flush(cache);
+    rt_mutex_release(&cache->lock);
+    return res;
+}
+
+int dfs_elm_cache_flush(void)
+{
+    int drv, err = RT_EOK;
+
+    for (drv = 0; drv < FF_VOLUMES; drv++)
+    {
+        if (dfs_elm_cache_sync(drv) != RES_OK)
+        {
+            err = -RT_EIO;
+        }
+    }
+    return err;
+}
+
+int dfs_elm_cache_get_stats(int drv, struct dfs_elm_cache_stats *stats)
+{
+    struct elm_cache *cache;
+
+    if (drv < 0 || drv >= FF_VOLUMES || (cache = elm_caches[drv]) == RT_NULL)
+    {
+        return -RT_ERROR;
+    }
+    rt_mutex_take(&cache->lock, RT_WAITING_FOREVER);
+    *stats = cache->stats;
+    rt_mutex_release(&cache->lock);
+    return RT_EOK;
+}
+
+#ifdef RT_USING_FINSH
+
+static void elm_cache(int argc, char **argv)
+{
+    struct elm_cache *cache;
+    int drv, i;
+
+    if (argc == 2 && (!rt_strcmp(argv[1], "on") || !rt_strcmp(argv[1], "off")))
+    {
+        for (drv = 0; drv < FF_VOLUMES; drv++)
+        {
+            cache = elm_caches[drv];
+            if (cache == RT_NULL)
+                continue;
+            rt_mutex_take(&cache->lock, RT_WAITING_FOREVER);
+            _flush(cache);
+            /* the lines may be stale once the volume is written around the cache */
+            for (i = 0; i < RT_DFS_ELM_CACHE_SECTORS; i++)
+            {
+                cache->lines[i].valid = RT_FALSE;
+            }
+            cache->bypass = (argv[1][1] == 'f');
+            rt_mutex_release(&cache->lock);
+        }
+        return;
+    }
+    if (argc == 2 && !rt_strcmp(argv[1], "reset"))
+    {
+        for (drv = 0; drv < FF_VOLUMES; drv++)
+        {
+            if (elm_caches[drv])
+                rt_memset(&elm_caches[drv]->stats, 0, sizeof(elm_caches[drv]->stats));
+        }
+        return;
+    }
+    if (argc != 1)
+    {
+        rt_kprintf("Usage: elm_cache [on|off|reset]\n");
+        return;
+    }
+
+    for (drv = 0; drv < FF_VOLUMES; drv++)
+    {
+        cache = elm_caches[drv];
+        if (cache == RT_NULL)
+            continue;
+        rt_kprintf("drive %d (%.*s)%s: %d lines, read-ahead %d\n", drv, RT_NAME_MAX, cache->dev->parent.name,
+                   cache->bypass ? " bypassed" : "", RT_DFS_ELM_CACHE_SECTORS, RT_DFS_ELM_CACHE_READAHEAD);
+        rt_kprintf("  read hits %u, misses %u, read-ahead sectors %u\n",
+                   cache->stats.hits, cache->stats.misses, cache->stats.readahead);
+        rt_kprintf("  sectors written %u, rewritten in cache %u, coalesced %u, evictions %u, flushes %u\n",
+                   cache->stats.writes, cache->stats.write_hits, cache->stats.coalesced,
+                   cache->stats.evict_writes, cache->stats.flushes);
+        rt_kprintf("  device reads %u, device writes %u\n", cache->stats.dev_reads, cache->stats.dev_writes);
+    }
+}
+MSH_CMD_EXPORT(elm_cache, elm-FAT sector cache: elm_cache [on|off|reset]);
+#endif /* RT_USING_FINSH */
+
+#ifdef ELM_CACHE_HOST
+#define ELM_TEST_SECTORS        256
+#define ELM_TEST_OPS            200000
+
+static BYTE _test_ref[ELM_TEST_SECTORS * FF_MAX_SS];
+static BYTE _test_img[ELM_TEST_SECTORS * FF_MAX_SS];
+static BYTE _test_buf[RT_DFS_ELM_CACHE_READAHEAD * 2 * FF_MAX_SS];
+static rt_uint32_t _test_seed = 1;
+
+static rt_uint32_t _test_rand(void)
+{
+    _test_seed = _test_seed * 1103515245 + 12345;
+    return _test_seed >> 8;
+}
+
+static int _test_check(const char *what, int ok)
+{
+    if (!ok)
+        printf("elm_cache: %s\n", what);
+    return !ok;
+}
+
+/* random reads, writes and syncs, with runs of sequential sectors, checked against a reference image */
+static int _test_random(struct rt_device *dev)
+{
+    DWORD sector = 0, count, i;
+    DRESULT res;
+    int failures = 0, op;
+
+    for (op = 0; op < ELM_TEST_OPS && failures < 10; op++)
+    {
+        count = 1 + _test_rand() % (RT_DFS_ELM_CACHE_READAHEAD * 2);
+        sector = (_test_rand() % 4) ? sector + 1 : _test_rand() % ELM_TEST_SECTORS;
+        if (sector + count > ELM_TEST_SECTORS)
+            sector = ELM_TEST_SECTORS - count;
+
+        switch (_test_rand() % 8)
+        {
+        case 0:
+            failures += _test_check("sync failed", dfs_elm_cache_sync(0) == RES_OK);
+            failures += _test_check("image differs after sync",
+                                    memcmp(_test_img, _test_ref, sizeof(_test_ref)) == 0);
+            break;
+        case 1: case 2: case 3:
+            for (i = 0; i < count * FF_MAX_SS; i++)
+                _test_buf[i] = (BYTE)_test_rand();
+            dfs_elm_cache_write(0, _test_buf, sector, count, &res);
+            memcpy(_test_ref + sector * FF_MAX_SS, _test_buf, count * FF_MAX_SS);
+            failures += _test_check("write failed", res == RES_OK);
+            break;
+        default:
+            dfs_elm_cache_read(0, _test_buf, sector, count, &res);
+            failures += _test_check("read failed", res == RES_OK);
+            failures += _test_check("read differs", memcmp(_test_buf, _test_ref + sector * FF_MAX_SS,
+                                                          count * FF_MAX_SS) == 0);
+            break;
+        }
+    }
+    (void)dev;
+    return failures;
+}
+
+/* write backs that fail outside a sync are reported by the next sync, once */
+static int _test_sticky_error(struct rt_device *dev)
+{
+    DRESULT res;
+    DWORD sector;
+    int failures = 0;
+
+    memset(_test_buf, 0x5a, FF_MAX_SS);
+    dfs_elm_cache_sync(0);
+    dfs_elm_cache_write(0, _test_buf, 0, 1, &res);
+    dev->fail_writes = 1;
+    /* push sector 0 out of the pool with single sector writes far from it */
+    for (sector = 2; sector < 2 + RT_DFS_ELM_CACHE_SECTORS * 2; sector += 2)
+        dfs_elm_cache_write(0, _test_buf, sector, 1, &res);
+    dev->fail_writes = 0;
+    failures += _test_check("eviction error not reported by sync", dfs_elm_cache_sync(0) != RES_OK);
+    failures += _test_check("error reported twice", dfs_elm_cache_sync(0) == RES_OK);
+
+    dfs_elm_cache_write(0, _test_buf, 1, 1, &res);
+    dev->fail_writes = 1;
+    failures += _test_check("sync write back error not reported", dfs_elm_cache_sync(0) != RES_OK);
+    dev->fail_writes = 0;
+    failures += _test_check("sync after a reported error failed", dfs_elm_cache_sync(0) == RES_OK);
+    return failures;
+}
+
+int dfs_elm_cache_selftest(void)
+{
+    struct dfs_elm_cache_stats stats;
+    struct rt_device dev;
+    int failures;
+
+    memset(&stats, 0, sizeof(stats));
+    memset(&dev, 0, sizeof(dev));
+    dev.image = _test_img;
+    dev.sectors = ELM_TEST_SECTORS;
+    if (dfs_elm_cache_attach(0, &dev) != RT_EOK)
+    {
+        printf("elm_cache: attach failed\n");
+        return 1;
+    }
+    failures = _test_random(&dev);
+    dfs_elm_cache_get_stats(0, &stats);
+    failures += _test_sticky_error(&dev);
+    dfs_elm_cache_detach(0);
+
+    printf("elm_cache: %u hits, %u misses, %u read ahead, %u coalesced, %d failures\n",
+           stats.hits, stats.misses, stats.readahead, stats.coalesced, failures);
+    return failures;
+}
+
+int main(void)
+{
+    return dfs_elm_cache_selftest() == 0 ? 0 : 1;
+}
+#endif /* ELM_CACHE_HOST */
+
+#endif /* RT_DFS_ELM_USING_CACHE */
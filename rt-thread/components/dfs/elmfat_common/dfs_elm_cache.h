@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-19     RT-Thread    the first version
+ */
+
+#ifndef __DFS_ELM_CACHE_H__
+#define __DFS_ELM_CACHE_H__
+
+#include <rtthread.h>
+#include "ff.h"
+#include "diskio.h"
+#include "dfs_elm.h"
+
+#ifdef RT_DFS_ELM_USING_CACHE
+
+int dfs_elm_cache_attach(BYTE drv, rt_device_t dev);
+void dfs_elm_cache_detach(BYTE drv);
+
+/* RT_FALSE when the drive is not cached, the request goes to the device */
+rt_bool_t dfs_elm_cache_read(BYTE drv, BYTE *buff, DWORD sector, UINT count, DRESULT *res);
+rt_bool_t dfs_elm_cache_write(BYTE drv, const BYTE *buff, DWORD sector, UINT count, DRESULT *res);
+DRESULT dfs_elm_cache_sync(BYTE drv);
+
+#endif /* RT_DFS_ELM_USING_CACHE */
+
+#endif /* __DFS_ELM_CACHE_H__ */
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2006-2023, RT-Thread Development Team
+ * Copyright (c) 2006-2025, RT-Thread Development Team
  *
  * SPDX-License-Identifier: Apache-2.0
  *
@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2017-05-09     Urey         first version
  * 2019-07-09     Zero-Free    improve device ops interface and data flows
+ * 2025-03-02     RT-Thread    record straight into pipe blocks, readers share them
  */
 
 #include <stdio.h>
@@ -268,10 +269,17 @@ static rt_err_t _audio_dev_init(struct rt_device *dev)
             LOG_E("malloc memory for for record pipe failed");
             return -RT_ENOMEM;
         }
-        rt_audio_pipe_init(&record->pipe, "record",
-                           (rt_int32_t)(RT_PIPE_FLAG_FORCE_WR | RT_PIPE_FLAG_BLOCK_RD),
-                           buffer,
-                           RT_AUDIO_RECORD_PIPE_SIZE);
+        if (rt_audio_pipe_init(&record->pipe, "record",
+                               (rt_int32_t)(RT_PIPE_FLAG_FORCE_WR | RT_PIPE_FLAG_BLOCK_RD),
+                               buffer,
+                               RT_AUDIO_RECORD_PIPE_SIZE,
+                               RT_AUDIO_RECORD_PIPE_BLOCK_SIZE) != RT_EOK)
+        {
+            rt_free(buffer);
+            rt_free(record);
+            LOG_E("record pipe of %d bytes holds less than two blocks", RT_AUDIO_RECORD_PIPE_SIZE);
+            return -RT_EINVAL;
+        }
 
         record->activated = RT_FALSE;
         audio->record = record;
@@ -282,7 +290,7 @@ static rt_err_t _audio_dev_init(struct rt_device *dev)
         audio->ops->init(audio);
 
     /* get replay buffer information */
-    if (audio->ops->buffer_info)
+    if (audio->ops->buffer_info && audio->replay)
         audio->ops->buffer_info(audio, &audio->replay->buf_info);
 
     return result;
@@ -610,3 +618,19 @@ void rt_audio_rx_done(struct rt_audio_device *audio, rt_uint8_t *pbuf, rt_size_t
     if (audio->parent.rx_indicate != RT_NULL)
         audio->parent.rx_indicate(&audio->parent, len);
 }
+
+rt_uint8_t *rt_audio_rx_claim(struct rt_audio_device *audio)
+{
+    /* a block of record->pipe.block_size bytes to record into */
+    return rt_audio_pipe_claim(&audio->record->pipe);
+}
+
+void rt_audio_rx_commit(struct rt_audio_device *audio, rt_size_t len)
+{
+    /* hand the claimed block to the readers, no copy */
+    rt_audio_pipe_commit(&audio->record->pipe, len);
+
+    /* invoke callback */
+    if (audio->parent.rx_indicate != RT_NULL)
+        audio->parent.rx_indicate(&audio->parent, len);
+}
@@ -1,187 +1,287 @@
 /*
- * Copyright (c) 2006-2023, RT-Thread Development Team
+ * Copyright (c) 2006-2025, RT-Thread Development Team
  *
  * SPDX-License-Identifier: Apache-2.0
  *
  * Change Logs:
  * Date           Author       Notes
  * 2012-09-30     Bernard      first version.
+ * 2025-03-02     RT-Thread    blocks handed out by reference to any number of readers
  */
 
 #include <rthw.h>
 #include <rtdevice.h>
 #include "audio_pipe.h"
 
-static void _rt_pipe_resume_writer(struct rt_audio_pipe *pipe)
-{
-    if (!rt_list_isempty(&pipe->suspended_write_list))
-    {
-        rt_thread_t thread;
+#ifndef MIN
+#define MIN(a, b)         ((a) < (b) ? (a) : (b))
+#endif
 
-        RT_ASSERT(pipe->flag & RT_PIPE_FLAG_BLOCK_WR);
+static rt_list_t _audio_pipes = RT_LIST_OBJECT_INIT(_audio_pipes);
 
-        /* get suspended thread */
-        thread = RT_THREAD_LIST_NODE_ENTRY(pipe->suspended_write_list.next);
+/*
+ * The block the reader should read next, NULL when it has read all of them.
+ * Called with interrupts disabled; blocks the producer got to first are
+ * counted as dropped.
+ */
+static struct rt_audio_pipe_block *_reader_fetch(struct rt_audio_pipe *pipe,
+                                                 struct rt_audio_pipe_reader *reader)
+{
+    rt_uint32_t slot;
+
+    while (reader->seq != pipe->head)
+    {
+        if (pipe->head - reader->seq > pipe->block_count)
+        {
+            reader->dropped += pipe->head - pipe->block_count - reader->seq;
+            reader->seq = pipe->head - pipe->block_count;
+            reader->offset = 0;
+        }
 
-        /* resume the write thread */
-        rt_thread_resume(thread);
+        slot = reader->seq % pipe->block_count;
+        if (slot != (rt_uint32_t)pipe->claimed && pipe->blocks[slot].seq == reader->seq)
+            return &pipe->blocks[slot];
 
-        rt_schedule();
+        /* the oldest one, and the producer is filling it again */
+        reader->dropped++;
+        reader->seq++;
+        reader->offset = 0;
     }
+
+    return RT_NULL;
 }
 
-static rt_ssize_t rt_pipe_read(rt_device_t dev,
-                              rt_off_t    pos,
-                              void       *buffer,
-                              rt_size_t   size)
+rt_ssize_t rt_audio_pipe_acquire(struct rt_audio_pipe *pipe, struct rt_audio_pipe_reader *reader,
+                                 const void **data, rt_int32_t timeout)
 {
     rt_base_t level;
-    rt_thread_t thread;
-    struct rt_audio_pipe *pipe;
-    rt_size_t read_nbytes;
+    struct rt_audio_pipe_block *block;
 
-    pipe = (struct rt_audio_pipe *)dev;
     RT_ASSERT(pipe != RT_NULL);
+    RT_ASSERT(reader != RT_NULL && reader->held == 0);
 
-    if (!(pipe->flag & RT_PIPE_FLAG_BLOCK_RD))
+    for (;;)
     {
         level = rt_hw_interrupt_disable();
-        read_nbytes = rt_ringbuffer_get(&(pipe->ringbuffer), (rt_uint8_t *)buffer, size);
+        block = _reader_fetch(pipe, reader);
+        if (block != RT_NULL)
+        {
+            block->refs++;
+            reader->held = (rt_uint16_t)(block - pipe->blocks) + 1;
+            rt_hw_interrupt_enable(level);
 
-        /* if the ringbuffer is empty, there won't be any writer waiting */
-        if (read_nbytes)
-            _rt_pipe_resume_writer(pipe);
+            *data = block->data + reader->offset;
+            return block->size - reader->offset;
+        }
 
+        if (timeout == 0)
+        {
+            rt_hw_interrupt_enable(level);
+            return 0;
+        }
+        reader->waiting = RT_TRUE;
         rt_hw_interrupt_enable(level);
 
-        return read_nbytes;
+        if (rt_sem_take(&reader->sem, timeout) != RT_EOK)
+        {
+            reader->waiting = RT_FALSE;
+            return 0;
+        }
     }
+}
 
-    thread = rt_thread_self();
+void rt_audio_pipe_release(struct rt_audio_pipe *pipe, struct rt_audio_pipe_reader *reader, rt_size_t used)
+{
+    rt_base_t level;
+    struct rt_audio_pipe_block *block;
+
+    RT_ASSERT(pipe != RT_NULL);
+    RT_ASSERT(reader != RT_NULL && reader->held != 0);
+
+    level = rt_hw_interrupt_disable();
+    block = &pipe->blocks[reader->held - 1];
+    block->refs--;
+    reader->held = 0;
+    reader->bytes += used;
+    reader->offset += used;
+    if (reader->offset >= block->size)
+    {
+        reader->seq++;
+        reader->offset = 0;
+        reader->blocks++;
+    }
+    rt_hw_interrupt_enable(level);
+}
+
+rt_uint8_t *rt_audio_pipe_claim(struct rt_audio_pipe *pipe)
+{
+    rt_base_t level;
+    rt_uint32_t slot;
 
-    /* current context checking */
-    RT_DEBUG_NOT_IN_INTERRUPT;
+    RT_ASSERT(pipe != RT_NULL);
 
-    do
+    level = rt_hw_interrupt_disable();
+    slot = pipe->head % pipe->block_count;
+    if (pipe->blocks[slot].refs != 0)
     {
-        level = rt_hw_interrupt_disable();
-        read_nbytes = rt_ringbuffer_get(&(pipe->ringbuffer), (rt_uint8_t *)buffer, size);
-        if (read_nbytes == 0)
-        {
-            rt_thread_suspend(thread);
-            /* waiting on suspended read list */
-            rt_list_insert_before(&(pipe->suspended_read_list),
-                                  &RT_THREAD_LIST_NODE(thread));
-            rt_hw_interrupt_enable(level);
+        pipe->overruns++;
+        rt_hw_interrupt_enable(level);
+        return RT_NULL;
+    }
+    pipe->claimed = (rt_int16_t)slot;
+    rt_hw_interrupt_enable(level);
 
-            rt_schedule();
-        }
-        else
+    return pipe->blocks[slot].data;
+}
+
+void rt_audio_pipe_commit(struct rt_audio_pipe *pipe, rt_size_t size)
+{
+    rt_base_t level;
+    rt_list_t *node;
+    struct rt_audio_pipe_block *block;
+    struct rt_audio_pipe_reader *reader;
+
+    RT_ASSERT(pipe != RT_NULL && pipe->claimed >= 0);
+
+    level = rt_hw_interrupt_disable();
+    block = &pipe->blocks[pipe->claimed];
+    block->size = MIN(size, pipe->block_size);
+    block->seq = pipe->head;
+    pipe->claimed = -1;
+    pipe->head++;
+    pipe->committed++;
+
+    rt_list_for_each(node, &pipe->readers)
+    {
+        reader = rt_list_entry(node, struct rt_audio_pipe_reader, list);
+        if (reader->waiting)
         {
-            _rt_pipe_resume_writer(pipe);
-            rt_hw_interrupt_enable(level);
-            break;
+            reader->waiting = RT_FALSE;
+            rt_sem_release(&reader->sem);
         }
     }
-    while (read_nbytes == 0);
+    rt_hw_interrupt_enable(level);
 
-    return read_nbytes;
+    if (pipe->parent.rx_indicate)
+        pipe->parent.rx_indicate(&pipe->parent, block->size);
 }
 
-static void _rt_pipe_resume_reader(struct rt_audio_pipe *pipe)
+rt_err_t rt_audio_pipe_reader_attach(struct rt_audio_pipe *pipe, struct rt_audio_pipe_reader *reader, const char *name)
 {
-    if (pipe->parent.rx_indicate)
-        pipe->parent.rx_indicate(&pipe->parent,
-                                 rt_ringbuffer_data_len(&pipe->ringbuffer));
+    rt_base_t level;
 
-    if (!rt_list_isempty(&pipe->suspended_read_list))
-    {
-        rt_thread_t thread;
+    RT_ASSERT(pipe != RT_NULL);
+    RT_ASSERT(reader != RT_NULL);
 
-        RT_ASSERT(pipe->flag & RT_PIPE_FLAG_BLOCK_RD);
+    rt_memset(reader, 0, sizeof(*reader));
+    reader->name = name;
+    reader->since = rt_tick_get();
+    rt_sem_init(&reader->sem, name, 0, RT_IPC_FLAG_FIFO);
 
-        /* get suspended thread */
-        thread = RT_THREAD_LIST_NODE_ENTRY(pipe->suspended_read_list.next);
+    level = rt_hw_interrupt_disable();
+    reader->seq = pipe->head;
+    rt_list_insert_before(&pipe->readers, &reader->list);
+    rt_hw_interrupt_enable(level);
 
-        /* resume the read thread */
-        rt_thread_resume(thread);
+    return RT_EOK;
+}
 
-        rt_schedule();
+void rt_audio_pipe_reader_detach(struct rt_audio_pipe *pipe, struct rt_audio_pipe_reader *reader)
+{
+    rt_base_t level;
+
+    RT_ASSERT(pipe != RT_NULL);
+    RT_ASSERT(reader != RT_NULL);
+
+    level = rt_hw_interrupt_disable();
+    if (reader->held)
+    {
+        pipe->blocks[reader->held - 1].refs--;
+        reader->held = 0;
     }
+    rt_list_remove(&reader->list);
+    rt_hw_interrupt_enable(level);
+
+    rt_sem_detach(&reader->sem);
 }
 
-static rt_ssize_t rt_pipe_write(rt_device_t dev,
-                               rt_off_t    pos,
-                               const void *buffer,
-                               rt_size_t   size)
+static rt_ssize_t rt_audio_pipe_read(rt_device_t dev,
+                              rt_off_t    pos,
+                              void       *buffer,
+                              rt_size_t   size)
 {
-    rt_base_t level;
-    rt_thread_t thread;
     struct rt_audio_pipe *pipe;
-    rt_size_t write_nbytes;
+    const void *data;
+    rt_ssize_t avail;
+    rt_size_t read_nbytes = 0;
 
     pipe = (struct rt_audio_pipe *)dev;
     RT_ASSERT(pipe != RT_NULL);
 
-    if ((pipe->flag & RT_PIPE_FLAG_FORCE_WR) ||
-            !(pipe->flag & RT_PIPE_FLAG_BLOCK_WR))
+    if (pipe->flag & RT_PIPE_FLAG_BLOCK_RD)
     {
-        level = rt_hw_interrupt_disable();
-
-        if (pipe->flag & RT_PIPE_FLAG_FORCE_WR)
-            write_nbytes = rt_ringbuffer_put_force(&(pipe->ringbuffer),
-                                                   (const rt_uint8_t *)buffer, size);
-        else
-            write_nbytes = rt_ringbuffer_put(&(pipe->ringbuffer),
-                                             (const rt_uint8_t *)buffer, size);
-
-        _rt_pipe_resume_reader(pipe);
+        /* current context checking */
+        RT_DEBUG_NOT_IN_INTERRUPT;
+    }
 
-        rt_hw_interrupt_enable(level);
+    /* wait for the first byte only, then take what is there */
+    while (read_nbytes < size)
+    {
+        avail = rt_audio_pipe_acquire(pipe, &pipe->reader, &data,
+                                      (read_nbytes == 0 && (pipe->flag & RT_PIPE_FLAG_BLOCK_RD)) ?
+                                      RT_WAITING_FOREVER : 0);
+        if (avail <= 0)
+            break;
 
-        return write_nbytes;
+        avail = MIN((rt_size_t)avail, size - read_nbytes);
+        rt_memcpy((rt_uint8_t *)buffer + read_nbytes, data, avail);
+        rt_audio_pipe_release(pipe, &pipe->reader, avail);
+        read_nbytes += avail;
     }
 
-    thread = rt_thread_self();
+    return read_nbytes;
+}
 
-    /* current context checking */
-    RT_DEBUG_NOT_IN_INTERRUPT;
+static rt_ssize_t rt_audio_pipe_write(rt_device_t dev,
+                               rt_off_t    pos,
+                               const void *buffer,
+                               rt_size_t   size)
+{
+    struct rt_audio_pipe *pipe;
+    rt_uint8_t *block;
+    rt_size_t chunk, write_nbytes = 0;
 
-    do
-    {
-        level = rt_hw_interrupt_disable();
-        write_nbytes = rt_ringbuffer_put(&(pipe->ringbuffer), (const rt_uint8_t *)buffer, size);
-        if (write_nbytes == 0)
-        {
-            /* pipe full, waiting on suspended write list */
-            rt_thread_suspend(thread);
-            /* waiting on suspended read list */
-            rt_list_insert_before(&(pipe->suspended_write_list),
-                                  &RT_THREAD_LIST_NODE(thread));
-            rt_hw_interrupt_enable(level);
+    pipe = (struct rt_audio_pipe *)dev;
+    RT_ASSERT(pipe != RT_NULL);
 
-            rt_schedule();
-        }
-        else
-        {
-            _rt_pipe_resume_reader(pipe);
-            rt_hw_interrupt_enable(level);
+    /* one block per block_size bytes, a short write makes a short block */
+    while (write_nbytes < size)
+    {
+        block = rt_audio_pipe_claim(pipe);
+        if (block == RT_NULL)
             break;
-        }
+
+        chunk = MIN(pipe->block_size, size - write_nbytes);
+        rt_memcpy(block, (const rt_uint8_t *)buffer + write_nbytes, chunk);
+        rt_audio_pipe_commit(pipe, chunk);
+        write_nbytes += chunk;
     }
-    while (write_nbytes == 0);
 
     return write_nbytes;
 }
 
-static rt_err_t rt_pipe_control(rt_device_t dev, int cmd, void *args)
+static rt_err_t rt_audio_pipe_control(rt_device_t dev, int cmd, void *args)
 {
     struct rt_audio_pipe *pipe;
+    rt_uint32_t unread;
 
     pipe = (struct rt_audio_pipe *)dev;
 
     if (cmd == PIPE_CTRL_GET_SPACE && args)
-        *(rt_size_t *)args = rt_ringbuffer_space_len(&pipe->ringbuffer);
+    {
+        unread = MIN(pipe->head - pipe->reader.seq, pipe->block_count);
+        *(rt_size_t *)args = (pipe->block_count - unread) * pipe->block_size;
+    }
     return RT_EOK;
 }
 
@@ -191,9 +291,9 @@ const static struct rt_device_ops audio_pipe_ops =
     RT_NULL,
     RT_NULL,
     RT_NULL,
-    rt_pipe_read,
-    rt_pipe_write,
-    rt_pipe_control
+    rt_audio_pipe_read,
+    rt_audio_pipe_write,
+    rt_audio_pipe_control
 };
 #endif
 
@@ -206,6 +306,7 @@ const static struct rt_device_ops audio_pipe_ops =
  * @param flag the attribute of the pipe device
  * @param buf  the buffer of pipe device
  * @param size the size of pipe device buffer
+ * @param block_size the most bytes the producer commits at once
  *
  * @return the operation status, RT_EOK on successful
  */
@@ -213,20 +314,49 @@ rt_err_t rt_audio_pipe_init(struct rt_audio_pipe *pipe,
                             const char *name,
                             rt_int32_t flag,
                             rt_uint8_t *buf,
-                            rt_size_t size)
+                            rt_size_t size,
+                            rt_size_t block_size)
 {
+    rt_base_t level;
+    rt_size_t count, i;
+    rt_uint8_t *data;
+
     RT_ASSERT(pipe);
     RT_ASSERT(buf);
 
-    /* initialize suspended list */
-    rt_list_init(&pipe->suspended_read_list);
-    rt_list_init(&pipe->suspended_write_list);
-
-    /* initialize ring buffer */
-    rt_ringbuffer_init(&pipe->ringbuffer, buf, size);
+    /* the descriptors first, then the blocks, all out of buf */
+    block_size = RT_ALIGN(block_size, RT_ALIGN_SIZE);
+    count = size / (block_size + sizeof(struct rt_audio_pipe_block));
+    if (count < 2 || count > 0x7fff)
+        return -RT_EINVAL;
+
+    pipe->blocks = (struct rt_audio_pipe_block *)buf;
+    data = (rt_uint8_t *)RT_ALIGN((rt_ubase_t)(pipe->blocks + count), RT_ALIGN_SIZE);
+    if (data + count * block_size > buf + size)
+        count--;
+    for (i = 0; i < count; i++)
+    {
+        pipe->blocks[i].data = data + i * block_size;
+        pipe->blocks[i].size = 0;
+        pipe->blocks[i].seq = (rt_uint32_t)(i - count);
+        pipe->blocks[i].refs = 0;
+    }
+    pipe->block_size = block_size;
+    pipe->block_count = (rt_uint16_t)count;
+    pipe->claimed = -1;
+    pipe->head = 0;
+    pipe->committed = 0;
+    pipe->overruns = 0;
 
     pipe->flag = flag;
 
+    rt_list_init(&pipe->readers);
+    rt_audio_pipe_reader_attach(pipe, &pipe->reader, name);
+
+    level = rt_hw_interrupt_disable();
+    rt_list_insert_before(&_audio_pipes, &pipe->list);
+    rt_hw_interrupt_enable(level);
+
     /* create pipe */
     pipe->parent.type    = RT_Device_Class_Pipe;
 #ifdef RT_USING_DEVICE_OPS
@@ -235,9 +365,9 @@ rt_err_t rt_audio_pipe_init(struct rt_audio_pipe *pipe,
     pipe->parent.init    = RT_NULL;
     pipe->parent.open    = RT_NULL;
     pipe->parent.close   = RT_NULL;
-    pipe->parent.read    = rt_pipe_read;
-    pipe->parent.write   = rt_pipe_write;
-    pipe->parent.control = rt_pipe_control;
+    pipe->parent.read    = rt_audio_pipe_read;
+    pipe->parent.write   = rt_audio_pipe_write;
+    pipe->parent.control = rt_audio_pipe_control;
 #endif
 
     return rt_device_register(&(pipe->parent), name, RT_DEVICE_FLAG_RDWR);
@@ -252,14 +382,23 @@ rt_err_t rt_audio_pipe_init(struct rt_audio_pipe *pipe,
  */
 rt_err_t rt_audio_pipe_detach(struct rt_audio_pipe *pipe)
 {
+    rt_base_t level;
+
+    rt_audio_pipe_reader_detach(pipe, &pipe->reader);
+
+    level = rt_hw_interrupt_disable();
+    rt_list_remove(&pipe->list);
+    rt_hw_interrupt_enable(level);
+
     return rt_device_unregister(&pipe->parent);
 }
 
 #ifdef RT_USING_HEAP
-rt_err_t rt_audio_pipe_create(const char *name, rt_int32_t flag, rt_size_t size)
+rt_err_t rt_audio_pipe_create(const char *name, rt_int32_t flag, rt_size_t size, rt_size_t block_size)
 {
     rt_uint8_t *rb_memptr = RT_NULL;
     struct rt_audio_pipe *pipe = RT_NULL;
+    rt_err_t result;
 
     /* get aligned size */
     size = RT_ALIGN(size, RT_ALIGN_SIZE);
@@ -267,7 +406,7 @@ rt_err_t rt_audio_pipe_create(const char *name, rt_int32_t flag, rt_size_t size)
     if (pipe == RT_NULL)
         return -RT_ENOMEM;
 
-    /* create ring buffer of pipe */
+    /* create the blocks of pipe */
     rb_memptr = (rt_uint8_t *)rt_malloc(size);
     if (rb_memptr == RT_NULL)
     {
@@ -275,7 +414,14 @@ rt_err_t rt_audio_pipe_create(const char *name, rt_int32_t flag, rt_size_t size)
         return -RT_ENOMEM;
     }
 
-    return rt_audio_pipe_init(pipe, name, flag, rb_memptr, size);
+    result = rt_audio_pipe_init(pipe, name, flag, rb_memptr, size, block_size);
+    if (result != RT_EOK)
+    {
+        rt_free(rb_memptr);
+        rt_free(pipe);
+    }
+
+    return result;
 }
 
 void rt_audio_pipe_destroy(struct rt_audio_pipe *pipe)
@@ -287,10 +433,85 @@ void rt_audio_pipe_destroy(struct rt_audio_pipe *pipe)
     rt_audio_pipe_detach(pipe);
 
     /* release memory */
-    rt_free(pipe->ringbuffer.buffer_ptr);
+    rt_free(pipe->blocks);
     rt_free(pipe);
 
     return;
 }
 
 #endif /* RT_USING_HEAP */
+
+#ifdef RT_USING_FINSH
+static void _pipe_print(struct rt_audio_pipe *pipe)
+{
+    rt_list_t *node;
+    struct rt_audio_pipe_reader *reader;
+    rt_tick_t ticks;
+
+    rt_kprintf("%s: %u blocks x %u B, %u B data, %u B descriptors, %u B pipe\n",
+               pipe->parent.parent.name, pipe->block_count, pipe->block_size,
+               pipe->block_count * pipe->block_size,
+               pipe->block_count * (rt_uint32_t)sizeof(struct rt_audio_pipe_block),
+               (rt_uint32_t)sizeof(struct rt_audio_pipe));
+    rt_kprintf("  committed %u, overruns %u (the slot was still held)\n",
+               pipe->committed, pipe->overruns);
+    rt_kprintf("  %-*.*s %10s %12s %8s %8s %5s\n", RT_NAME_MAX, RT_NAME_MAX,
+               "reader", "blocks", "bytes", "B/s", "dropped", "held");
+
+    rt_list_for_each(node, &pipe->readers)
+    {
+        reader = rt_list_entry(node, struct rt_audio_pipe_reader, list);
+        ticks = rt_tick_get() - reader->since;
+        rt_kprintf("  %-*.*s %10u %12u %8u %8u %5s\n", RT_NAME_MAX, RT_NAME_MAX,
+                   reader->name, reader->blocks, reader->bytes,
+                   ticks ? (rt_uint32_t)((rt_uint64_t)reader->bytes * RT_TICK_PER_SECOND / ticks) : 0,
+                   reader->dropped, reader->held ? "yes" : "-");
+    }
+    rt_kprintf("  %u B per reader, no copy of the data\n",
+               (rt_uint32_t)sizeof(struct rt_audio_pipe_reader));
+}
+
+static int audio_pipe(int argc, char **argv)
+{
+    rt_list_t *node, *rnode;
+    struct rt_audio_pipe *pipe;
+    struct rt_audio_pipe_reader *reader;
+    rt_base_t level;
+
+    if (argc > 1 && !rt_strcmp(argv[1], "reset"))
+    {
+        level = rt_hw_interrupt_disable();
+        rt_list_for_each(node, &_audio_pipes)
+        {
+            pipe = rt_list_entry(node, struct rt_audio_pipe, list);
+            pipe->committed = 0;
+            pipe->overruns = 0;
+            rt_list_for_each(rnode, &pipe->readers)
+            {
+                reader = rt_list_entry(rnode, struct rt_audio_pipe_reader, list);
+                reader->blocks = 0;
+                reader->bytes = 0;
+                reader->dropped = 0;
+                reader->since = rt_tick_get();
+            }
+        }
+        rt_hw_interrupt_enable(level);
+        return 0;
+    }
+    else if (argc > 1)
+    {
+        rt_kprintf("Usage: audio_pipe [reset]\n");
+        return -1;
+    }
+
+    if (rt_list_isempty(&_audio_pipes))
+        rt_kprintf("no audio pipe\n");
+    rt_list_for_each(node, &_audio_pipes)
+    {
+        _pipe_print(rt_list_entry(node, struct rt_audio_pipe, list));
+    }
+
+    return 0;
+}
+MSH_CMD_EXPORT(audio_pipe, audio pipes and their readers: audio_pipe [reset]);
+#endif /* RT_USING_FINSH */
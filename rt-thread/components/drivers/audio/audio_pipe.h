@@ -1,16 +1,25 @@
 /*
- * Copyright (c) 2006-2023, RT-Thread Development Team
+ * Copyright (c) 2006-2025, RT-Thread Development Team
  *
  * SPDX-License-Identifier: Apache-2.0
  *
  * Change Logs:
  * Date           Author       Notes
+ * 2025-03-02     RT-Thread    blocks handed out by reference to any number of readers
  */
 #ifndef __AUDIO_PIPE_H__
 #define __AUDIO_PIPE_H__
 
 /**
  * Pipe Device
+ *
+ * The pipe keeps the newest blocks the producer committed. Every reader has
+ * its own position in them: it is handed a pointer into a block, not a copy,
+ * and the block is not reused while a reader holds it. A reader that falls
+ * more than a pipe behind loses the oldest blocks and counts them.
+ *
+ * rt_device_read() on the pipe goes through a reader of its own and copies,
+ * as it always did.
  */
 #include <rtdevice.h>
 
@@ -34,26 +43,54 @@ enum rt_audio_pipe_flag
     RT_PIPE_FLAG_NONBLOCK_RDWR = 0x00,
     /* read would block */
     RT_PIPE_FLAG_BLOCK_RD = 0x01,
-    /* write would block */
+    /* writing never blocks and always drops the oldest blocks, the two flags
+     * below are kept for the callers that still pass them */
     RT_PIPE_FLAG_BLOCK_WR = 0x02,
-    /* write to this pipe will discard some data when the pipe is full.
-     * When this flag is set, RT_PIPE_FLAG_BLOCK_WR will be ignored since write
-     * operation will always be success. */
     RT_PIPE_FLAG_FORCE_WR = 0x04,
 };
 
+struct rt_audio_pipe_block
+{
+    rt_uint8_t *data;
+    rt_uint32_t size;                   /* bytes committed into it */
+    rt_uint32_t seq;                    /* which block of the stream it holds */
+    rt_uint16_t refs;                   /* readers holding it */
+};
+
+struct rt_audio_pipe_reader
+{
+    rt_list_t list;
+    const char *name;
+    rt_uint32_t seq;                    /* the block it reads next */
+    rt_uint32_t offset;                 /* bytes of that block already consumed */
+    rt_uint16_t held;                   /* slot + 1 of the block it holds, 0 for none */
+    rt_bool_t waiting;
+    struct rt_semaphore sem;
+
+    rt_uint32_t blocks;                 /* blocks consumed */
+    rt_uint32_t bytes;                  /* bytes consumed */
+    rt_uint32_t dropped;                /* blocks lost for being too slow */
+    rt_tick_t since;
+};
+
 struct rt_audio_pipe
 {
     struct rt_device parent;
 
-    /* ring buffer in pipe device */
-    struct rt_ringbuffer ringbuffer;
+    struct rt_audio_pipe_block *blocks;
+    rt_uint32_t block_size;
+    rt_uint16_t block_count;
+    rt_int16_t claimed;                 /* slot the producer is filling, -1 for none */
+    volatile rt_uint32_t head;          /* sequence of the next block committed */
 
     rt_int32_t flag;
 
-    /* suspended list */
-    rt_list_t suspended_read_list;
-    rt_list_t suspended_write_list;
+    rt_list_t readers;
+    struct rt_audio_pipe_reader reader; /* the one behind rt_device_read() */
+    rt_list_t list;
+
+    rt_uint32_t committed;              /* blocks committed */
+    rt_uint32_t overruns;               /* blocks not taken, the slot was still held */
 
     struct rt_audio_portal_device *write_portal;
     struct rt_audio_portal_device *read_portal;
@@ -61,15 +98,34 @@ struct rt_audio_pipe
 
 #define PIPE_CTRL_GET_SPACE          0x14            /**< get the remaining size of a pipe device */
 
+/* buf is split into as many blocks of block_size as fit, with their descriptors */
 rt_err_t rt_audio_pipe_init(struct rt_audio_pipe *pipe,
                       const char *name,
                       rt_int32_t flag,
                       rt_uint8_t *buf,
-                      rt_size_t size);
+                      rt_size_t size,
+                      rt_size_t block_size);
 rt_err_t rt_audio_pipe_detach(struct rt_audio_pipe *pipe);
 #ifdef RT_USING_HEAP
-rt_err_t rt_audio_pipe_create(const char *name, rt_int32_t flag, rt_size_t size);
+rt_err_t rt_audio_pipe_create(const char *name, rt_int32_t flag, rt_size_t size, rt_size_t block_size);
 void rt_audio_pipe_destroy(struct rt_audio_pipe *pipe);
 #endif /* RT_USING_HEAP */
 
+/* producer: the block to fill, block_size bytes, RT_NULL when a reader still holds it */
+rt_uint8_t *rt_audio_pipe_claim(struct rt_audio_pipe *pipe);
+/* producer: publish the claimed block with size bytes in it */
+void rt_audio_pipe_commit(struct rt_audio_pipe *pipe, rt_size_t size);
+
+/* the reader starts at the next block committed */
+rt_err_t rt_audio_pipe_reader_attach(struct rt_audio_pipe *pipe, struct rt_audio_pipe_reader *reader, const char *name);
+void rt_audio_pipe_reader_detach(struct rt_audio_pipe *pipe, struct rt_audio_pipe_reader *reader);
+/*
+ * Hold the unconsumed rest of the reader's next block, waiting up to timeout
+ * for one. Returns its size and points data at it, 0 when nothing came.
+ */
+rt_ssize_t rt_audio_pipe_acquire(struct rt_audio_pipe *pipe, struct rt_audio_pipe_reader *reader,
+                                 const void **data, rt_int32_t timeout);
+/* give the held block back with used bytes of it consumed */
+void rt_audio_pipe_release(struct rt_audio_pipe *pipe, struct rt_audio_pipe_reader *reader, rt_size_t used);
+
 #endif /* __AUDIO_PIPE_H__ */
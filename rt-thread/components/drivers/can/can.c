@@ -7,6 +7,7 @@
  * Date           Author            Notes
  * 2015-05-14     aubrcool@qq.com   first version
  * 2015-07-06     Bernard           code cleanup and remove RT_CAN_USING_LED;
+ * 2025-02-28     RT-Thread         batched receive through a frame ring, pipelined send
  */
 
 #include <rthw.h>
@@ -43,6 +44,19 @@ static rt_err_t rt_can_init(struct rt_device *dev)
 /*
  * can interrupt routines
  */
+#ifdef RT_CAN_USING_BATCH
+rt_inline int _can_int_rx(struct rt_can_device *can, struct rt_can_msg *data, int msgs)
+{
+    struct rt_can_rx_fifo *rx_fifo;
+
+    RT_ASSERT(can != RT_NULL);
+    rx_fifo = (struct rt_can_rx_fifo *) can->can_rx;
+    RT_ASSERT(rx_fifo != RT_NULL);
+
+    /* single reader: the batch leaves the ring with at most two copies */
+    return can_ring_read(&rx_fifo->ring, data, msgs / sizeof(struct rt_can_msg)) * sizeof(struct rt_can_msg);
+}
+#else
 rt_inline int _can_int_rx(struct rt_can_device *can, struct rt_can_msg *data, int msgs)
 {
     int size;
@@ -126,7 +140,85 @@ rt_inline int _can_int_rx(struct rt_can_device *can, struct rt_can_msg *data, in
 
     return (size - msgs);
 }
+#endif /*RT_CAN_USING_BATCH*/
 
+#ifdef RT_CAN_USING_BATCH
+/*
+ * Every free send box gets a frame before the first completion is waited
+ * for, so a burst leaves back to back. The driver sends from a FIFO, the
+ * boxes complete in the order they were filled. Returns the frames sent
+ * before the first failure.
+ */
+rt_inline int _can_int_tx(struct rt_can_device *can, const struct rt_can_msg *data, int msgs)
+{
+    int count, sent = 0, done = 0, failed = 0;
+    rt_base_t level;
+    rt_list_t inflight;
+    struct rt_can_tx_fifo *tx_fifo;
+    struct rt_can_sndbxinx_list *tx_box;
+
+    RT_ASSERT(can != RT_NULL);
+
+    tx_fifo = (struct rt_can_tx_fifo *) can->can_tx;
+    RT_ASSERT(tx_fifo != RT_NULL);
+
+    count = msgs / sizeof(struct rt_can_msg);
+    rt_list_init(&inflight);
+    while (1)
+    {
+        /* block for a box only when none is in flight */
+        while (sent < count && !failed &&
+               rt_sem_take(&(tx_fifo->sem), rt_list_isempty(&inflight) ? RT_WAITING_FOREVER : 0) == RT_EOK)
+        {
+            level = rt_hw_interrupt_disable();
+            tx_box = rt_list_entry(tx_fifo->freelist.next, struct rt_can_sndbxinx_list, list);
+            rt_list_remove(&tx_box->list);
+            rt_hw_interrupt_enable(level);
+
+            tx_box->result = RT_CAN_SND_RESULT_WAIT;
+            rt_completion_init(&tx_box->completion);
+            if (can->ops->sendmsg(can, &data[sent], tx_box - tx_fifo->buffer) != RT_EOK)
+            {
+                level = rt_hw_interrupt_disable();
+                rt_list_insert_before(&tx_fifo->freelist, &tx_box->list);
+                can->status.dropedsndpkg++;
+                rt_hw_interrupt_enable(level);
+                rt_sem_release(&(tx_fifo->sem));
+                failed = 1;
+                break;
+            }
+            rt_list_insert_before(&inflight, &tx_box->list);
+            can->status.sndchange = 1;
+            sent++;
+        }
+        if (rt_list_isempty(&inflight))
+            break;
+
+        /* the oldest one */
+        tx_box = rt_list_entry(inflight.next, struct rt_can_sndbxinx_list, list);
+        rt_completion_wait(&(tx_box->completion), RT_WAITING_FOREVER);
+        rt_list_remove(&tx_box->list);
+
+        level = rt_hw_interrupt_disable();
+        if (tx_box->result == RT_CAN_SND_RESULT_OK)
+        {
+            can->status.sndpkg++;
+            if (!failed)
+                done++;
+        }
+        else
+        {
+            can->status.dropedsndpkg++;
+            failed = 1;
+        }
+        rt_list_insert_before(&tx_fifo->freelist, &tx_box->list);
+        rt_hw_interrupt_enable(level);
+        rt_sem_release(&(tx_fifo->sem));
+    }
+
+    return done * sizeof(struct rt_can_msg);
+}
+#else
 rt_inline int _can_int_tx(struct rt_can_device *can, const struct rt_can_msg *data, int msgs)
 {
     int size;
@@ -200,6 +292,7 @@ err_ret:
 
     return (size - msgs);
 }
+#endif /*RT_CAN_USING_BATCH*/
 
 rt_inline int _can_int_tx_priv(struct rt_can_device *can, const struct rt_can_msg *data, int msgs)
 {
@@ -277,8 +370,18 @@ static rt_err_t rt_can_open(struct rt_device *dev, rt_uint16_t oflag)
     {
         if (oflag & RT_DEVICE_FLAG_INT_RX)
         {
-            int i = 0;
             struct rt_can_rx_fifo *rx_fifo;
+#ifdef RT_CAN_USING_BATCH
+            rt_uint32_t slots = can_ring_slots(can->config.msgboxsz);
+
+            /* the whole frame pool up front, nothing is allocated per frame */
+            rx_fifo = (struct rt_can_rx_fifo *) rt_malloc(sizeof(struct rt_can_rx_fifo) +
+                      slots * sizeof(struct rt_can_msg));
+            RT_ASSERT(rx_fifo != RT_NULL);
+
+            can_ring_init(&rx_fifo->ring, rx_fifo + 1, sizeof(struct rt_can_msg), slots);
+#else
+            int i = 0;
 
             rx_fifo = (struct rt_can_rx_fifo *) rt_malloc(sizeof(struct rt_can_rx_fifo) +
                       can->config.msgboxsz * sizeof(struct rt_can_msg_list));
@@ -297,6 +400,7 @@ static rt_err_t rt_can_open(struct rt_device *dev, rt_uint16_t oflag)
                 rx_fifo->buffer[i].owner = RT_NULL;
 #endif
             }
+#endif /*RT_CAN_USING_BATCH*/
             can->can_rx = rx_fifo;
 
             dev->open_flag |= RT_DEVICE_FLAG_INT_RX;
@@ -756,6 +860,52 @@ rt_err_t rt_hw_can_register(struct rt_can_device    *can,
 }
 
 /* ISR for can interrupt */
+#ifdef RT_CAN_USING_BATCH
+struct can_rx_source
+{
+    struct rt_can_device *can;
+    rt_uint32_t fifo;
+};
+
+static int _can_rx_fetch(void *ctx, void *slot)
+{
+    struct can_rx_source *src = (struct can_rx_source *)ctx;
+
+    return src->can->ops->recvmsg(src->can, slot, src->fifo) == RT_EOK ? 0 : -1;
+}
+
+/* empty the controller FIFO, publish its frames at once, indicate once */
+static void _can_isr_rx(struct rt_can_device *can, rt_uint32_t fifo)
+{
+    struct can_rx_source src = {can, fifo};
+    struct rt_can_rx_fifo *rx_fifo;
+    struct rt_can_msg scratch;
+    rt_uint32_t n, dropped = 0;
+    rt_base_t level;
+
+    rx_fifo = (struct rt_can_rx_fifo *)can->can_rx;
+    RT_ASSERT(rx_fifo != RT_NULL);
+    RT_ASSERT(can->parent.open_flag & RT_DEVICE_FLAG_INT_RX);
+
+    /* bounded by the ring size, in case the driver never runs dry */
+    n = can_ring_drain(&rx_fifo->ring, _can_rx_fetch, &src, &scratch,
+                       rx_fifo->ring.mask + 1, &dropped);
+    if (n + dropped == 0)
+        return;
+
+    level = rt_hw_interrupt_disable();
+    can->status.rcvpkg += n + dropped;
+    can->status.dropedrcvpkg += dropped;
+    can->status.rcvchange = 1;
+    rt_hw_interrupt_enable(level);
+
+    if (n != 0 && can->parent.rx_indicate != RT_NULL)
+    {
+        can->parent.rx_indicate(&can->parent, can_ring_count(&rx_fifo->ring) * sizeof(struct rt_can_msg));
+    }
+}
+#endif /*RT_CAN_USING_BATCH*/
+
 void rt_hw_can_isr(struct rt_can_device *can, int event)
 {
     switch (event & 0xff)
@@ -768,6 +918,10 @@ void rt_hw_can_isr(struct rt_can_device *can, int event)
         rt_hw_interrupt_enable(level);
     }
     case RT_CAN_EVENT_RX_IND:
+#ifdef RT_CAN_USING_BATCH
+        _can_isr_rx(can, event >> 8);
+        break;
+#else
     {
         struct rt_can_msg tmpmsg;
         struct rt_can_rx_fifo *rx_fifo;
@@ -881,6 +1035,7 @@ void rt_hw_can_isr(struct rt_can_device *can, int event)
         }
         break;
     }
+#endif /*RT_CAN_USING_BATCH*/
 
     case RT_CAN_EVENT_TX_DONE:
     case RT_CAN_EVENT_TX_FAIL:
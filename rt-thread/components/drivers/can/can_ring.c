@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-28     RT-Thread     first version
+ */
+
+/*
+ * The ring has no RT-Thread dependency; can_ring_selftest() runs on the
+ * target and on a PC, where a second thread also reads while the first one
+ * drains:
+ *
+ *   cc -O2 -DCAN_RING_HOST -Irt-thread/components/drivers/include \
+ *      -o can_ring rt-thread/components/drivers/can/can_ring.c -lpthread
+ *   ./can_ring
+ */
+
+#include <string.h>
+#include "drivers/can_ring.h"
+
+#ifdef CAN_RING_HOST
+#include <stdio.h>
+#define ring_printf             printf
+#else
+#include <rtthread.h>
+#define ring_printf             rt_kprintf
+#endif
+
+/*
+ * Orders the slot accesses against the index stores. One core sees its own
+ * accesses in order, so this only has to stop the compiler; the host test
+ * needs the real fence.
+ */
+#if defined(__ICCARM__)
+#include <intrinsics.h>
+#define can_ring_barrier()      __DMB()
+#elif defined(__CC_ARM)
+#define can_ring_barrier()      __dmb(0xF)
+#else
+#define can_ring_barrier()      __sync_synchronize()
+#endif
+
+uint32_t can_ring_slots(uint32_t n)
+{
+    uint32_t slots = 1;
+
+    while (slots < n)
+        slots <<= 1;
+    return slots;
+}
+
+int can_ring_init(struct can_ring *r, void *buf, uint32_t esize, uint32_t slots)
+{
+    if (slots == 0 || (slots & (slots - 1)) != 0 || esize == 0)
+        return -1;
+
+    r->buf = buf;
+    r->esize = esize;
+    r->mask = slots - 1;
+    r->head = 0;
+    r->tail = 0;
+    return 0;
+}
+
+uint32_t can_ring_count(const struct can_ring *r)
+{
+    return r->head - r->tail;
+}
+
+void *can_ring_slot(struct can_ring *r, uint32_t i)
+{
+    uint32_t head = r->head;
+
+    if (head - r->tail + i > r->mask)
+        return NULL;
+    return r->buf + ((head + i) & r->mask) * r->esize;
+}
+
+void can_ring_commit(struct can_ring *r, uint32_t n)
+{
+    if (n == 0)
+        return;
+    /* the frames are in the slots before the reader can see them */
+    can_ring_barrier();
+    r->head += n;
+}
+
+uint32_t can_ring_drain(struct can_ring *r, can_ring_fetch_t fetch, void *ctx,
+                        void *scratch, uint32_t limit, uint32_t *dropped)
+{
+    uint32_t n = 0, lost = 0;
+    void *slot;
+
+    while (n + lost < limit)
+    {
+        slot = can_ring_slot(r, n);
+        if (slot == NULL)
+            slot = scratch;
+        if (fetch(ctx, slot) != 0)
+            break;
+        if (slot == scratch)
+            lost++;
+        else
+            n++;
+    }
+
+    can_ring_commit(r, n);
+    if (dropped != NULL)
+        *dropped += lost;
+    return n;
+}
+
+uint32_t can_ring_read(struct can_ring *r, void *dst, uint32_t max)
+{
+    uint32_t tail = r->tail, n, first, at;
+
+    n = r->head - tail;
+    /* the slots are read after the head that published them */
+    can_ring_barrier();
+    if (n > max)
+        n = max;
+    if (n == 0)
+        return 0;
+
+    at = tail & r->mask;
+    first = r->mask + 1 - at;
+    if (first > n)
+        first = n;
+    memcpy(dst, r->buf + at * r->esize, first * r->esize);
+    if (n > first)
+        memcpy((uint8_t *)dst + first * r->esize, r->buf, (n - first) * r->esize);
+
+    /* and copied out before the producer may reuse them */
+    can_ring_barrier();
+    r->tail = tail + n;
+    return n;
+}
+
+/* ==================== self-test ==================== */
+
+#define RING_TEST_SLOTS         16
+#define RING_TEST_ROUNDS        20000
+
+struct ring_test_frame
+{
+    uint32_t seq;
+    uint32_t check[3];          /* derived from seq, catches torn copies */
+};
+
+struct ring_test_source
+{
+    uint32_t next;
+    uint32_t avail;             /* frames in the fake controller FIFO */
+};
+
+static void _frame_fill(struct ring_test_frame *f, uint32_t seq)
+{
+    f->seq = seq;
+    f->check[0] = ~seq;
+    f->check[1] = seq * 2654435761U;
+    f->check[2] = seq ^ 0x5a5a5a5aUL;
+}
+
+static int _frame_ok(const struct ring_test_frame *f)
+{
+    return f->check[0] == ~f->seq && f->check[1] == f->seq * 2654435761U &&
+           f->check[2] == (f->seq ^ 0x5a5a5a5aUL);
+}
+
+static int _source_fetch(void *ctx, void *slot)
+{
+    struct ring_test_source *s = ctx;
+
+    if (s->avail == 0)
+        return -1;
+    s->avail--;
+    _frame_fill(slot, s->next++);
+    return 0;
+}
+
+static uint32_t _test_rand(uint32_t *seed)
+{
+    *seed = *seed * 1664525UL + 1013904223UL;
+    return *seed >> 8;
+}
+
+/*
+ * The consumer side: the frames come oldest first, and every gap in the
+ * sequence is a frame the producer counted as dropped.
+ */
+struct ring_test_reader
+{
+    uint32_t expect;
+    uint32_t frames;
+    uint32_t gaps;
+    int failures;
+};
+
+static void _reader_check(struct ring_test_reader *rd, const struct ring_test_frame *f, uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (!_frame_ok(&f[i]) || (int32_t)(f[i].seq - rd->expect) < 0)
+        {
+            if (rd->failures++ == 0)
+                ring_printf("can_ring: frame %u torn or out of order, expected %u\n",
+                            (unsigned)f[i].seq, (unsigned)rd->expect);
+            continue;
+        }
+        rd->gaps += f[i].seq - rd->expect;
+        rd->expect = f[i].seq + 1;
+        rd->frames++;
+    }
+}
+
+static int _check_sequence(uint32_t start, uint32_t seed)
+{
+    struct ring_test_frame slots[RING_TEST_SLOTS], out[RING_TEST_SLOTS + 3], scratch;
+    struct ring_test_source src = {0, 0};
+    struct ring_test_reader rd = {0, 0, 0, 0};
+    struct can_ring r;
+    uint32_t round, n, dropped = 0, published = 0, before, lost;
+    int failures = 0;
+
+    can_ring_init(&r, slots, sizeof(slots[0]), RING_TEST_SLOTS);
+    /* both indices about to wrap */
+    r.head = r.tail = start;
+
+    for (round = 0; round < RING_TEST_ROUNDS; round++)
+    {
+        /* an interrupt finds 0..5 frames, drains at most limit of them */
+        src.avail += _test_rand(&seed) % 6;
+        before = can_ring_count(&r);
+        lost = dropped;
+        n = can_ring_drain(&r, _source_fetch, &src, &scratch, 1 + _test_rand(&seed) % 8, &dropped);
+        published += n;
+        if (can_ring_count(&r) != before + n || can_ring_count(&r) > RING_TEST_SLOTS)
+        {
+            ring_printf("can_ring: count %u after publishing %u onto %u\n",
+                        (unsigned)can_ring_count(&r), (unsigned)n, (unsigned)before);
+            failures++;
+        }
+        if (dropped != lost && can_ring_count(&r) != RING_TEST_SLOTS)
+        {
+            ring_printf("can_ring: dropped with free slots\n");
+            failures++;
+        }
+
+        /* the reader asks for 0..RING_TEST_SLOTS + 2 frames, not every round */
+        if (_test_rand(&seed) % 3 != 0)
+        {
+            n = can_ring_read(&r, out, _test_rand(&seed) % (RING_TEST_SLOTS + 3));
+            _reader_check(&rd, out, n);
+        }
+    }
+    /* the rest */
+    while ((n = can_ring_read(&r, out, RING_TEST_SLOTS + 3)) != 0)
+        _reader_check(&rd, out, n);
+    src.avail = 0;
+
+    if (rd.frames != published || rd.gaps + (src.next - rd.expect) != dropped || dropped == 0)
+    {
+        ring_printf("can_ring: %u published, %u read, %u gaps, %u dropped\n", (unsigned)published,
+                    (unsigned)rd.frames, (unsigned)rd.gaps, (unsigned)dropped);
+        failures++;
+    }
+    return failures + rd.failures;
+}
+
+int can_ring_selftest(void)
+{
+    static const uint32_t starts[] = {0, 5, 0xfffffff0UL, 0xffffffffUL};
+    static const uint32_t sizes[][2] = {{0, 1}, {1, 1}, {3, 4}, {16, 16}, {17, 32}};
+    struct ring_test_frame slots[RING_TEST_SLOTS], scratch;
+    struct ring_test_source src = {0, 0};
+    struct can_ring r;
+    uint32_t i, dropped = 0;
+    int failures = 0;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        if (can_ring_slots(sizes[i][0]) != sizes[i][1])
+        {
+            ring_printf("can_ring: %u slots for %u\n", (unsigned)can_ring_slots(sizes[i][0]),
+                        (unsigned)sizes[i][0]);
+            failures++;
+        }
+    }
+    if (can_ring_init(&r, slots, sizeof(slots[0]), 12) == 0 ||
+        can_ring_init(&r, slots, sizeof(slots[0]), 0) == 0)
+    {
+        ring_printf("can_ring: took a slot count that is not a power of two\n");
+        failures++;
+    }
+
+    /* a full ring still empties the source, and keeps the oldest frames */
+    can_ring_init(&r, slots, sizeof(slots[0]), RING_TEST_SLOTS);
+    src.avail = RING_TEST_SLOTS + 5;
+    if (can_ring_drain(&r, _source_fetch, &src, &scratch, 0xffffffffUL, &dropped) != RING_TEST_SLOTS ||
+        dropped != 5 || src.avail != 0 || ((struct ring_test_frame *)can_ring_slot(&r, 0)) != NULL ||
+        slots[RING_TEST_SLOTS - 1].seq != RING_TEST_SLOTS - 1)
+    {
+        ring_printf("can_ring: overflow kept %u dropped %u\n", (unsigned)can_ring_count(&r),
+                    (unsigned)dropped);
+        failures++;
+    }
+
+    for (i = 0; i < sizeof(starts) / sizeof(starts[0]); i++)
+        failures += _check_sequence(starts[i], 1 + i);
+
+    ring_printf("can_ring: %d failures\n", failures);
+    return failures;
+}
+
+#ifdef CAN_RING_HOST
+#include <pthread.h>
+#include <sched.h>
+
+#define RING_THREAD_FRAMES      4000000UL
+#define RING_THREAD_HIGH_WATER  48      /* of 64 slots, the producer backs off above it */
+
+static struct can_ring _ring;
+static struct ring_test_frame _ring_slots[64];
+static volatile int _ring_done;
+static uint32_t _ring_dropped, _ring_sent;
+
+/*
+ * Bursts of up to 3 frames, as the controller FIFO would hold them, at a
+ * bus-like pace. Above the high water mark the producer gives up the CPU, as
+ * the receive interrupt lets the reader thread run between frames; without it
+ * a single core host runs the producer for a whole time slice and drops
+ * nearly every frame.
+ */
+static void *_producer(void *arg)
+{
+    struct ring_test_source src = {0, 0};
+    struct ring_test_frame scratch;
+    volatile uint32_t spin;
+    uint32_t seed = 7;
+
+    (void)arg;
+    while (src.next < RING_THREAD_FRAMES)
+    {
+        for (spin = _test_rand(&seed) % 256; spin != 0; spin--)
+            ;
+        while (can_ring_count(&_ring) > RING_THREAD_HIGH_WATER)
+            sched_yield();
+        src.avail = 1 + _test_rand(&seed) % 3;
+        can_ring_drain(&_ring, _source_fetch, &src, &scratch, 0xffffffffUL, &_ring_dropped);
+        src.avail = 0;
+    }
+    _ring_sent = src.next;
+    __sync_synchronize();
+    _ring_done = 1;
+    return NULL;
+}
+
+static int _threaded(void)
+{
+    struct ring_test_frame out[40];
+    struct ring_test_reader rd = {0, 0, 0, 0};
+    uint32_t seed = 11, n;
+    pthread_t tid;
+    int done;
+
+    can_ring_init(&_ring, _ring_slots, sizeof(_ring_slots[0]), 64);
+    pthread_create(&tid, NULL, _producer, NULL);
+    do
+    {
+        done = _ring_done;
+        __sync_synchronize();
+        n = can_ring_read(&_ring, out, 1 + _test_rand(&seed) % 40);
+        _reader_check(&rd, out, n);
+        /* an empty ring, the reader thread would wait on its semaphore */
+        if (n == 0 && !done)
+            sched_yield();
+    } while (!done || n != 0);
+    pthread_join(tid, NULL);
+
+    printf("can_ring: threaded %u frames, %u read, %u dropped, %u gaps\n", (unsigned)_ring_sent,
+           (unsigned)rd.frames, (unsigned)_ring_dropped, (unsigned)(rd.gaps + (_ring_sent - rd.expect)));
+    if (rd.frames + _ring_dropped != _ring_sent || rd.gaps + (_ring_sent - rd.expect) != _ring_dropped)
+        rd.failures++;
+    /* the concurrent read path is what this run is for, not the drop path */
+    if (rd.frames < _ring_sent / 10 * 9)
+    {
+        printf("can_ring: the reader only got %u of %u frames\n", (unsigned)rd.frames, (unsigned)_ring_sent);
+        rd.failures++;
+    }
+    return rd.failures;
+}
+
+int main(void)
+{
+    int failures = can_ring_selftest();
+
+    failures += _threaded();
+    return failures == 0 ? 0 : 1;
+}
+#endif /* CAN_RING_HOST */
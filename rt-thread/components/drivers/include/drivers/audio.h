@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2006-2023, RT-Thread Development Team
+ * Copyright (c) 2006-2025, RT-Thread Development Team
  *
  * SPDX-License-Identifier: Apache-2.0
  *
@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2017-05-09     Urey         first version
  * 2019-07-09     Zero-Free    improve device ops interface and data flows
+ * 2025-03-02     RT-Thread    record straight into pipe blocks
  *
  */
 
@@ -162,6 +163,9 @@ struct rt_audio_device
 rt_err_t    rt_audio_register(struct rt_audio_device *audio, const char *name, rt_uint32_t flag, void *data);
 void        rt_audio_tx_complete(struct rt_audio_device *audio);
 void        rt_audio_rx_done(struct rt_audio_device *audio, rt_uint8_t *pbuf, rt_size_t len);
+/* record without the copy of rt_audio_rx_done(): fill the claimed block, then commit it */
+rt_uint8_t *rt_audio_rx_claim(struct rt_audio_device *audio);
+void        rt_audio_rx_commit(struct rt_audio_device *audio, rt_size_t len);
 
 /* Device Control Commands */
 #define CODEC_CMD_RESET             0
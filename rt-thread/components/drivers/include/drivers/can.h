@@ -8,12 +8,16 @@
  * 2015-05-14     aubrcool@qq.com   first version
  * 2015-07-06     Bernard           remove RT_CAN_USING_LED.
  * 2022-05-08     hpmicro           add CANFD support, fixed typos
+ * 2025-02-28     RT-Thread         add batched receive and receive timestamps
  */
 
 #ifndef CAN_H_
 #define CAN_H_
 
 #include <rtthread.h>
+#ifdef RT_CAN_USING_BATCH
+#include "can_ring.h"
+#endif
 
 #ifndef RT_CANMSG_BOX_SZ
 #define RT_CANMSG_BOX_SZ    16
@@ -296,6 +300,9 @@ struct rt_can_msg
     rt_uint32_t rxfifo : 2;/*Redefined to return :CAN RX FIFO0/CAN RX FIFO1*/
     rt_uint32_t reserved : 6;
 #endif
+#ifdef RT_CAN_USING_TIMESTAMP
+    rt_uint32_t timestamp;
+#endif
 #ifdef RT_CAN_USING_CANFD
     rt_uint8_t data[64];
 #else
@@ -316,11 +323,16 @@ struct rt_can_msg_list
 
 struct rt_can_rx_fifo
 {
+#ifdef RT_CAN_USING_BATCH
+    /* frame pool, filled by the interrupt, emptied by read */
+    struct can_ring ring;
+#else
     /* software fifo */
     struct rt_can_msg_list *buffer;
     rt_uint32_t freenumbers;
     struct rt_list_node freelist;
     struct rt_list_node uselist;
+#endif
 };
 
 #define RT_CAN_SND_RESULT_OK        0
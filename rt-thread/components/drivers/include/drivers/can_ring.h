@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author        Notes
+ * 2025-02-28     RT-Thread     first version
+ */
+
+/*
+ * Single producer, single consumer frame ring for the CAN framework. The
+ * producer is the receive interrupt: it fills as many slots as the controller
+ * has frames and publishes them with one store of the head. The consumer is
+ * the reader: it copies a batch out with at most two memcpy() and frees the
+ * slots with one store of the tail. Neither side disables interrupts.
+ *
+ * The indices run freely modulo 2^32, the slot count is a power of two.
+ */
+
+#ifndef __CAN_RING_H__
+#define __CAN_RING_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct can_ring
+{
+    uint8_t *buf;
+    uint32_t esize;             /* bytes per slot */
+    uint32_t mask;              /* slots - 1 */
+    volatile uint32_t head;     /* written by the producer only */
+    volatile uint32_t tail;     /* written by the consumer only */
+};
+
+/* returns 0 with a stored frame, anything else once the source is empty */
+typedef int (*can_ring_fetch_t)(void *ctx, void *slot);
+
+/* the power of two at or above n, what can_ring_init() takes */
+uint32_t can_ring_slots(uint32_t n);
+/* 0, or -1 when slots is not a power of two */
+int can_ring_init(struct can_ring *r, void *buf, uint32_t esize, uint32_t slots);
+uint32_t can_ring_count(const struct can_ring *r);
+
+/* producer: the i-th free slot past the published ones, NULL when full */
+void *can_ring_slot(struct can_ring *r, uint32_t i);
+/* producer: publish the first n slots handed out by can_ring_slot() */
+void can_ring_commit(struct can_ring *r, uint32_t n);
+/*
+ * Producer: fetch frames into the ring until the source is empty or limit
+ * frames were fetched, then publish them at once. With the ring full the
+ * frames still go through scratch so the source is emptied, and are counted
+ * in dropped. Returns the frames published.
+ */
+uint32_t can_ring_drain(struct can_ring *r, can_ring_fetch_t fetch, void *ctx,
+                        void *scratch, uint32_t limit, uint32_t *dropped);
+
+/* consumer: copy up to max frames out, oldest first, returns the count */
+uint32_t can_ring_read(struct can_ring *r, void *dst, uint32_t max);
+
+/* returns the failures */
+int can_ring_selftest(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAN_RING_H__ */
@@ -296,6 +296,9 @@ int rt_usbd_hid_class_register(void);
 int rt_usbd_msc_class_register(void);
 int rt_usbd_rndis_class_register(void);
 int rt_usbd_winusb_class_register(void);
+#ifdef RT_USBD_MIC_PUSH
+void rt_usbd_uac_mic_write(const rt_int32_t *samples, rt_size_t count, rt_size_t stride);
+#endif
 
 #ifdef RT_USB_DEVICE_COMPOSITE
 rt_err_t rt_usbd_function_set_iad(ufunction_t func, uiad_desc_t iad_desc);
@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2015-06-15     hichard      first version
+ * 2025-02-18     RT-Thread    set HS_TIMING before the DDR bus width
  */
 
 #include <drivers/mmcsd_core.h>
@@ -390,13 +391,6 @@ static int mmc_select_bus_width(struct rt_mmcsd_card *card, rt_uint8_t *ext_csd)
         }
     }
 
-    if (!err && ddr)
-    {
-        err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
-                         EXT_CSD_BUS_WIDTH,
-                         ext_csd_bits[idx][1]);
-    }
-
     if (!err)
     {
         if (card->flags & (CARD_FLAG_HIGHSPEED | CARD_FLAG_HIGHSPEED_DDR))
@@ -408,6 +402,14 @@ static int mmc_select_bus_width(struct rt_mmcsd_card *card, rt_uint8_t *ext_csd)
         }
     }
 
+    /* the card only accepts a DDR bus width once HS_TIMING is set */
+    if (!err && ddr)
+    {
+        err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+                         EXT_CSD_BUS_WIDTH,
+                         ext_csd_bits[idx][1]);
+    }
+
     return err;
 }
 rt_err_t mmc_send_op_cond(struct rt_mmcsd_host *host,
@@ -1,16 +1,20 @@
 /*
- * Copyright (c) 2006-2023, RT-Thread Development Team
+ * Copyright (c) 2006-2025, RT-Thread Development Team
  *
  * SPDX-License-Identifier: Apache-2.0
  *
  * Change Logs:
  * Date           Author       Notes
  * 2019-09-07     flybreak     the first version
+ * 2025-03-01     RT-Thread    stream from a sample ring, adaptive packet size, statistics
  */
 
 #include <rthw.h>
 #include <rtdevice.h>
 #include "drivers/usb_device.h"
+#ifdef RT_USING_CPUTIME
+#include <drivers/cputime.h>
+#endif
 
 #include "uaudioreg.h"
 
@@ -18,13 +22,41 @@
 #define DBG_LVL              DBG_INFO
 #include <rtdbg.h>
 
+#ifdef RT_USBD_MIC_SAMPLERATE
+#define RECORD_SAMPLERATE   RT_USBD_MIC_SAMPLERATE
+#else
 #define RECORD_SAMPLERATE   16000
+#endif
 #define RECORD_CHANNEL      1
+#ifdef RT_USBD_MIC_24BIT
+#define RESOLUTION_BITS     24
+#else
 #define RESOLUTION_BITS     16
+#endif
+
+#ifdef RT_USBD_MIC_RING_MS
+#define RECORD_RING_MS      RT_USBD_MIC_RING_MS
+#else
+#define RECORD_RING_MS      128
+#endif
 
 #define RESOLUTION_BYTE     (RESOLUTION_BITS / 8)
-#define RECORD_PER_MS_SZ    ((RECORD_SAMPLERATE * RECORD_CHANNEL * RESOLUTION_BYTE) / 1000)
-#define RECORD_BUFFER_SZ    (RECORD_PER_MS_SZ * 20)  /* 20ms */
+#define SAMPLE_BYTES        (RESOLUTION_BYTE * RECORD_CHANNEL)
+
+/*
+ * The endpoint is asynchronous: the capture clock runs free of the SOF and the
+ * host follows it by the packet sizes. A packet carries the samples of one
+ * frame, one sample more or less now and then keeps the ring at its target.
+ */
+#define PACKET_NOMINAL      (RECORD_SAMPLERATE / 1000)
+#define PACKET_REMAINDER    (RECORD_SAMPLERATE % 1000)
+#define PACKET_MAX          (PACKET_NOMINAL + 2)
+/* one trim sample per this many packets at most, ~2000 ppm at 16 kHz */
+#define PACKET_TRIM_PERIOD  32
+/* the fill average follows in 2^8 packets, the capture bursts average out */
+#define FILL_AVG_SHIFT      8
+/* samples kept past the end of a capture burst against late packets */
+#define FILL_MARGIN         (4 * PACKET_MAX)
 
 #if defined(RT_USBD_MIC_DEVICE_NAME)
     #define MIC_DEVICE_NAME    RT_USBD_MIC_DEVICE_NAME
@@ -34,7 +66,6 @@
 
 #define EVENT_RECORD_START   (1 << 0)
 #define EVENT_RECORD_STOP    (1 << 1)
-#define EVENT_RECORD_DATA    (1 << 2)
 
 #define MIC_INTF_STR_INDEX 8
 /*
@@ -45,7 +76,8 @@
 #define UAC_CS_ENDPOINT             0x25
 
 #define UAC_MAX_PACKET_SIZE         64
-#define UAC_EP_MAX_PACKET_SIZE      32
+#define UAC_EP_MAX_PACKET_SIZE      (PACKET_MAX * SAMPLE_BYTES)
+#define UAC_EP_ATTR_ISOC_ASYNC      (USB_EP_ATTR_ISOC | 0x04)
 #define UAC_CHANNEL_NUM             RECORD_CHANNEL
 
 struct uac_ac_descriptor
@@ -67,7 +99,7 @@ struct uac_as_descriptor
     struct uinterface_descriptor intf_desc;
     struct usb_audio_streaming_interface_descriptor hdr_desc;
     struct usb_audio_streaming_type1_descriptor format_type_desc;
-    struct uendpoint_descriptor ep_desc;
+    usb_endpoint_descriptor_audio_t ep_desc;
     struct usb_audio_streaming_endpoint_descriptor as_ep_desc;
 };
 
@@ -75,16 +107,52 @@ struct uac_as_descriptor
  * uac mic device type
  */
 
+struct uac_mic_stats
+{
+    rt_uint32_t packets;            /* packets the host took */
+    rt_uint32_t idle;               /* empty packets before the ring filled */
+    rt_uint32_t missed;             /* packets not taken in their frame, sent again */
+    rt_uint32_t size[3];            /* packets of nominal - 1, nominal, nominal + 1 samples */
+    rt_uint32_t underruns;          /* packets short of samples */
+    rt_uint32_t overruns;           /* samples dropped, the ring was full */
+    rt_uint32_t fill_min;
+    rt_uint32_t fill_max;
+    rt_uint32_t pushes;
+    rt_uint64_t samples;
+    rt_uint64_t push_cycles;        /* CPU time of the producer */
+    rt_uint64_t send_cycles;        /* CPU time of packet sizing and arming */
+    rt_uint64_t since;
+};
+
 struct uac_audio_mic
 {
+    ufunction_t  func;
+    uep_t        ep;
+    volatile rt_bool_t streaming;
+
+    /*
+     * Sample ring, the indices count samples and run freely. The first
+     * PACKET_MAX samples are mirrored past the end so a packet is always one
+     * contiguous piece of the ring, sent from where it lies.
+     */
+    rt_uint8_t  *ring;
+    rt_uint32_t  mask;
+    volatile rt_uint32_t head;      /* written by the producer only */
+    volatile rt_uint32_t tail;      /* advanced when the host took a packet */
+    volatile rt_uint32_t burst;     /* largest piece the producer delivered */
+
+    rt_bool_t    primed;
+    rt_uint32_t  armed;             /* samples in the packet on the bus */
+    rt_uint32_t  rate_acc;
+    rt_uint32_t  trim_count;
+    rt_int32_t   fill_avg;          /* Q8 */
+
+    struct uac_mic_stats stats;
+
+#ifndef RT_USBD_MIC_PUSH
     rt_device_t  dev;
     rt_event_t   event;
-    rt_uint8_t   open_count;
-
-    rt_uint8_t  *buffer;
-    rt_uint32_t  buffer_index;
-
-    uep_t        ep;
+#endif
 };
 static struct uac_audio_mic mic;
 
@@ -259,19 +327,21 @@ static struct uac_as_descriptor as_desc =
         FORMAT_TYPE,
         FORMAT_TYPE_I,
         UAC_CHANNEL_NUM,
-        2,         /* Subframe Size: 2 */
+        RESOLUTION_BYTE,    /* Subframe Size */
         RESOLUTION_BITS,
         0x01,      /* Samples Frequence Type: 1 */
         {0},       /* Samples Frequence */
     },
-    /* Endpoint Descriptor */
+    /* Endpoint Descriptor, the audio class one with bRefresh and bSynchAddress */
     {
-        USB_DESC_LENGTH_ENDPOINT,
+        sizeof(usb_endpoint_descriptor_audio_t),
         USB_DESC_TYPE_ENDPOINT,
         USB_DYNAMIC | USB_DIR_IN,
-        USB_EP_ATTR_ISOC,
+        UAC_EP_ATTR_ISOC_ASYNC,
         UAC_EP_MAX_PACKET_SIZE,
         0x01,
+        0x00,
+        0x00,
     },
     /* AS Endpoint Descriptor */
     {
@@ -281,23 +351,243 @@ static struct uac_as_descriptor as_desc =
     },
 };
 
-void mic_entry(void *parameter)
+static rt_uint64_t _mic_cycles(void)
 {
-    struct rt_audio_caps caps = {0};
-    rt_uint32_t e, index;
+#ifdef RT_USING_CPUTIME
+    return clock_cpu_gettime();
+#else
+    return 0;
+#endif
+}
+
+static rt_uint32_t _mic_target(void)
+{
+    rt_uint32_t burst = mic.burst;
+
+    /* keep a burst and the margin on the way in, never more than fits */
+    if (burst + FILL_MARGIN > mic.mask + 1 - PACKET_MAX)
+    {
+        burst = mic.mask + 1 - PACKET_MAX - FILL_MARGIN;
+    }
+    return burst + FILL_MARGIN;
+}
+
+/*
+ * Size the next packet and hand it to the controller straight from the ring.
+ * Runs from the IN completion on the usb device thread.
+ */
+static void _mic_send(ufunction_t func)
+{
+    rt_uint64_t start = _mic_cycles();
+    rt_uint32_t fill, n, target;
+    rt_int32_t err;
+
+    fill = mic.head - mic.tail;
+    target = _mic_target();
+    n = 0;
+
+    if (!mic.primed && mic.burst != 0 && fill >= target)
+    {
+        /* start right after a burst with one burst and the margin queued */
+        mic.tail = mic.head - target;
+        fill = target;
+        mic.fill_avg = (rt_int32_t)(target - mic.burst / 2) << 8;
+        mic.trim_count = 0;
+        mic.primed = RT_TRUE;
+    }
+
+    if (mic.primed)
+    {
+        n = PACKET_NOMINAL;
+        mic.rate_acc += PACKET_REMAINDER;
+        if (mic.rate_acc >= 1000)
+        {
+            mic.rate_acc -= 1000;
+            n++;
+        }
+
+        /* the average sits half a burst below the fill right after one */
+        mic.fill_avg += ((rt_int32_t)(fill << 8) - mic.fill_avg) >> FILL_AVG_SHIFT;
+        if (++mic.trim_count >= PACKET_TRIM_PERIOD)
+        {
+            mic.trim_count = 0;
+            err = (mic.fill_avg >> 8) - (rt_int32_t)(target - mic.burst / 2);
+            if (err > PACKET_NOMINAL / 2)
+            {
+                n++;
+            }
+            else if (err < -(PACKET_NOMINAL / 2))
+            {
+                n--;
+            }
+        }
+
+        if (fill < mic.stats.fill_min)
+        {
+            mic.stats.fill_min = fill;
+        }
+        if (fill > mic.stats.fill_max)
+        {
+            mic.stats.fill_max = fill;
+        }
+        if (fill < n)
+        {
+            mic.stats.underruns++;
+            n = fill;
+            if (fill == 0)
+            {
+                /* the source stopped, fill up again before going on */
+                mic.primed = RT_FALSE;
+            }
+        }
+        if (n + 1 >= PACKET_NOMINAL && n <= PACKET_NOMINAL + 1)
+        {
+            mic.stats.size[n + 1 - PACKET_NOMINAL]++;
+        }
+    }
+    else
+    {
+        mic.stats.idle++;
+    }
+
+    mic.armed = n;
+    mic.ep->request.buffer = mic.ring + (mic.tail & mic.mask) * SAMPLE_BYTES;
+    mic.ep->request.size = n * SAMPLE_BYTES;
+    mic.ep->request.req_type = UIO_REQUEST_WRITE;
+    rt_usbd_io_request(func->device, mic.ep, &mic.ep->request);
+
+    mic.stats.send_cycles += _mic_cycles() - start;
+}
+
+/*
+ * Producer side: store count samples at the head, or as many as fit, and
+ * publish them with the head. Only the producer writes the ring, the volatile
+ * stores keep the samples ahead of the head.
+ */
+static rt_uint32_t _mic_room(rt_uint32_t count)
+{
+    rt_uint32_t room = mic.mask + 1 - (mic.head - mic.tail);
+
+    if (count > mic.burst)
+    {
+        mic.burst = count;
+    }
+    if (count > room)
+    {
+        mic.stats.overruns += count - room;
+        count = room;
+    }
+    return count;
+}
+
+#ifdef RT_USBD_MIC_PUSH
+/**
+ * This function feeds the microphone from the capture interrupt.
+ *
+ * @param samples the first sample, 32 bits with the sample in the top bits.
+ * @param count the number of samples.
+ * @param stride the distance between samples, e.g. 2 for the left slot of I2S.
+ */
+void rt_usbd_uac_mic_write(const rt_int32_t *samples, rt_size_t count, rt_size_t stride)
+{
+    volatile rt_uint8_t *slot;
+    rt_uint64_t start;
+    rt_uint32_t head, pos, i;
+    rt_int32_t sample;
+
+    if (!mic.streaming || mic.ring == RT_NULL)
+    {
+        return;
+    }
+    start = _mic_cycles();
+
+    count = _mic_room(count);
+    head = mic.head;
+    for (i = 0; i < count; i++)
+    {
+        pos = (head + i) & mic.mask;
+        sample = samples[i * stride];
+        slot = mic.ring + pos * SAMPLE_BYTES;
+#if RESOLUTION_BITS == 24
+        slot[0] = (rt_uint8_t)(sample >> 8);
+        slot[1] = (rt_uint8_t)(sample >> 16);
+        slot[2] = (rt_uint8_t)(sample >> 24);
+#else
+        *(volatile rt_int16_t *)slot = (rt_int16_t)(sample >> 16);
+#endif
+        if (pos < PACKET_MAX)
+        {
+            slot += (mic.mask + 1) * SAMPLE_BYTES;
+#if RESOLUTION_BITS == 24
+            slot[0] = (rt_uint8_t)(sample >> 8);
+            slot[1] = (rt_uint8_t)(sample >> 16);
+            slot[2] = (rt_uint8_t)(sample >> 24);
+#else
+            *(volatile rt_int16_t *)slot = (rt_int16_t)(sample >> 16);
+#endif
+        }
+    }
+    mic.head = head + count;
+
+    mic.stats.pushes++;
+    mic.stats.samples += count;
+    mic.stats.push_cycles += _mic_cycles() - start;
+}
+
+#else /* RT_USBD_MIC_PUSH */
+
+/* reads the audio device into the ring where it lies, up to the ring end */
+static void _mic_read_device(void)
+{
+    rt_uint64_t start;
+    rt_uint32_t head, pos, room, n;
+    rt_size_t size;
+
+    head = mic.head;
+    pos = head & mic.mask;
+    room = mic.mask + 1 - (head - mic.tail);
+    if (room > mic.mask + 1 - pos)
+    {
+        room = mic.mask + 1 - pos;
+    }
+    if (room == 0)
+    {
+        /* the host is not taking the samples, the device drops them */
+        rt_thread_mdelay(1);
+        return;
+    }
 
-    mic.buffer = rt_malloc(RECORD_BUFFER_SZ);
-    if (mic.buffer == RT_NULL)
+    size = rt_device_read(mic.dev, 0, mic.ring + pos * SAMPLE_BYTES, room * SAMPLE_BYTES);
+    n = size / SAMPLE_BYTES;
+    if (n == 0)
+    {
+        rt_thread_mdelay(1);
+        return;
+    }
+    start = _mic_cycles();
+    if (pos < PACKET_MAX)
     {
-        LOG_E("malloc failed");
-        goto __exit;
+        rt_memcpy(mic.ring + (mic.mask + 1 + pos) * SAMPLE_BYTES, mic.ring + pos * SAMPLE_BYTES,
+                  ((pos + n < PACKET_MAX ? pos + n : PACKET_MAX) - pos) * SAMPLE_BYTES);
     }
+    _mic_room(n);
+    mic.head = head + n;
+
+    mic.stats.pushes++;
+    mic.stats.samples += n;
+    mic.stats.push_cycles += _mic_cycles() - start;
+}
+
+void mic_entry(void *parameter)
+{
+    struct rt_audio_caps caps = {0};
+    rt_uint32_t e;
 
     mic.dev = rt_device_find(MIC_DEVICE_NAME);
     if (mic.dev == RT_NULL)
     {
         LOG_E("can't find device:%s", MIC_DEVICE_NAME);
-        goto __exit;
+        return;
     }
 
     while (1)
@@ -308,7 +598,7 @@ void mic_entry(void *parameter)
         {
             continue;
         }
-        if (mic.open_count == 0)
+        if (!mic.streaming)
         {
             continue;
         }
@@ -323,52 +613,55 @@ void mic_entry(void *parameter)
         caps.udata.config.samplebits = RESOLUTION_BITS;
         rt_device_control(mic.dev, AUDIO_CTL_CONFIGURE, &caps);
 
-        while (1)
+        while (mic.streaming)
         {
-            if (rt_event_recv(mic.event, EVENT_RECORD_DATA | EVENT_RECORD_STOP,
-                              RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
-                              1000, &e) != RT_EOK)
-            {
-                if (mic.open_count > 0)
-                    continue;
-                else
-                    break;
-            }
-            if (e & EVENT_RECORD_DATA)
-            {
-                index = (mic.buffer_index >= RECORD_BUFFER_SZ / 2) ? 0 : (RECORD_BUFFER_SZ / 2);
-                rt_device_read(mic.dev, 0, mic.buffer + index, RECORD_BUFFER_SZ / 2);
-            }
-            else if (e & EVENT_RECORD_STOP)
-            {
-                break;
-            }
+            _mic_read_device();
         }
         LOG_D("record stop");
         rt_device_close(mic.dev);
     }
-
-__exit:
-    if (mic.buffer)
-        rt_free(mic.buffer);
 }
+#endif /* RT_USBD_MIC_PUSH */
 
 static rt_err_t _record_start(ufunction_t func)
 {
-    mic.ep->request.buffer = RT_NULL;
-    mic.ep->request.size = UAC_EP_MAX_PACKET_SIZE;
-    mic.ep->request.req_type = UIO_REQUEST_WRITE;
-    rt_usbd_io_request(func->device, mic.ep, &mic.ep->request);
+    rt_base_t level;
 
-    mic.open_count ++;
+    if (mic.streaming || mic.ring == RT_NULL)
+    {
+        return 0;
+    }
+
+    level = rt_hw_interrupt_disable();
+    mic.tail = mic.head;
+    mic.burst = 0;
+    rt_hw_interrupt_enable(level);
+    mic.primed = RT_FALSE;
+    mic.rate_acc = 0;
+    mic.stats.fill_min = ~0u;
+    mic.stats.fill_max = 0;
+    mic.stats.since = _mic_cycles();
+    mic.streaming = RT_TRUE;
+
+    /* the first packets are empty until the ring has filled */
+    _mic_send(func);
+
+#ifndef RT_USBD_MIC_PUSH
     rt_event_send(mic.event, EVENT_RECORD_START);
+#endif
     return 0;
 }
 
 static rt_err_t _record_stop(ufunction_t func)
 {
-    mic.open_count --;
+    if (!mic.streaming)
+    {
+        return 0;
+    }
+    mic.streaming = RT_FALSE;
+#ifndef RT_USBD_MIC_PUSH
     rt_event_send(mic.event, EVENT_RECORD_STOP);
+#endif
     return 0;
 }
 
@@ -377,20 +670,21 @@ static rt_err_t _ep_data_in_handler(ufunction_t func, rt_size_t size)
     RT_ASSERT(func != RT_NULL);
     LOG_D("_ep_data_in_handler");
 
-    mic.ep->request.buffer = mic.buffer + mic.buffer_index;
-    mic.ep->request.size = UAC_EP_MAX_PACKET_SIZE;
-    mic.ep->request.req_type = UIO_REQUEST_WRITE;
-    rt_usbd_io_request(func->device, mic.ep, &mic.ep->request);
-
-    mic.buffer_index += UAC_EP_MAX_PACKET_SIZE;
-    if (mic.buffer_index >= RECORD_BUFFER_SZ)
+    /* a packet not taken in its frame comes back with nothing sent */
+    if (mic.armed != 0 && size < mic.armed * SAMPLE_BYTES)
     {
-        mic.buffer_index = 0;
-        rt_event_send(mic.event, EVENT_RECORD_DATA);
+        mic.stats.missed++;
     }
-    else if (mic.buffer_index == RECORD_BUFFER_SZ / 2)
+    else if (mic.armed != 0)
     {
-        rt_event_send(mic.event, EVENT_RECORD_DATA);
+        mic.tail += mic.armed;
+        mic.stats.packets++;
+    }
+    mic.armed = 0;
+
+    if (mic.streaming)
+    {
+        _mic_send(func);
     }
 
     return RT_EOK;
@@ -412,11 +706,11 @@ static rt_err_t _interface_as_handler(ufunction_t func, ureq_t setup)
             break;
         case USB_REQ_SET_INTERFACE:
             LOG_D("set interface handler");
-            if (setup->wValue == 1)
+            if ((setup->wValue & 0xFF) == 1)
             {
                 _record_start(func);
             }
-            else if (setup->wValue == 0)
+            else if ((setup->wValue & 0xFF) == 0)
             {
                 _record_stop(func);
             }
@@ -530,7 +824,8 @@ ufunction_t rt_usbd_function_uac_mic_create(udevice_t device)
 
     /* create endpoint */
     as_desc_t = (struct uac_as_descriptor *)setting_as->desc;
-    mic.ep = rt_usbd_endpoint_new(&as_desc_t->ep_desc, _ep_data_in_handler);
+    mic.ep = rt_usbd_endpoint_new((uep_desc_t)&as_desc_t->ep_desc, _ep_data_in_handler);
+    mic.func = func;
 
     /* add the endpoint to the alternate setting */
     rt_usbd_altsetting_add_endpoint(setting_as, mic.ep);
@@ -551,20 +846,89 @@ ufunction_t rt_usbd_function_uac_mic_create(udevice_t device)
 
 int audio_mic_init(void)
 {
-    rt_thread_t mic_tid;
-    mic.event = rt_event_create("mic_event", RT_IPC_FLAG_FIFO);
+    rt_uint32_t slots = 1;
 
-    mic_tid = rt_thread_create("mic_thread",
-                               mic_entry, RT_NULL,
-                               1024,
-                               5, 10);
+    while (slots < RECORD_RING_MS * RECORD_SAMPLERATE / 1000)
+    {
+        slots <<= 1;
+    }
+    mic.ring = rt_malloc_align((slots + PACKET_MAX) * SAMPLE_BYTES, RT_ALIGN_SIZE);
+    if (mic.ring == RT_NULL)
+    {
+        LOG_E("no memory for %d samples", slots);
+        return -RT_ENOMEM;
+    }
+    mic.mask = slots - 1;
+
+#ifndef RT_USBD_MIC_PUSH
+    {
+        rt_thread_t mic_tid;
+
+        mic.event = rt_event_create("mic_event", RT_IPC_FLAG_FIFO);
+        mic_tid = rt_thread_create("mic_thread",
+                                   mic_entry, RT_NULL,
+                                   1024,
+                                   5, 10);
 
-    if (mic_tid != RT_NULL)
-        rt_thread_startup(mic_tid);
+        if (mic_tid != RT_NULL)
+            rt_thread_startup(mic_tid);
+    }
+#endif
     return RT_EOK;
 }
 INIT_COMPONENT_EXPORT(audio_mic_init);
 
+#ifdef RT_USING_FINSH
+static rt_uint32_t _mic_per(rt_uint64_t cycles, rt_uint32_t count)
+{
+    return count ? (rt_uint32_t)(cycles / count) : 0;
+}
+
+static void uac_mic(int argc, char **argv)
+{
+    struct uac_mic_stats st;
+    rt_uint64_t elapsed;
+    rt_uint32_t fill, share;
+    rt_base_t level;
+
+    if (argc >= 2 && rt_strcmp(argv[1], "reset") == 0)
+    {
+        level = rt_hw_interrupt_disable();
+        rt_memset(&mic.stats, 0, sizeof(mic.stats));
+        mic.stats.fill_min = ~0u;
+        mic.stats.since = _mic_cycles();
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+
+    level = rt_hw_interrupt_disable();
+    st = mic.stats;
+    fill = mic.head - mic.tail;
+    rt_hw_interrupt_enable(level);
+
+    rt_kprintf("%s, %d Hz, %d bit, ring %d samples, target %d, burst %d, fill %d (%d..%d)\n",
+               mic.streaming ? (mic.primed ? "streaming" : "filling") : "idle",
+               RECORD_SAMPLERATE, RESOLUTION_BITS, mic.mask + 1, _mic_target(), mic.burst, fill,
+               st.fill_min == ~0u ? 0 : st.fill_min, st.fill_max);
+    rt_kprintf("packets %u: %u/%u/%u of %d/%d/%d samples, %u empty while filling, %u missed frames\n",
+               st.packets, st.size[0], st.size[1], st.size[2],
+               PACKET_NOMINAL - 1, PACKET_NOMINAL, PACKET_NOMINAL + 1, st.idle, st.missed);
+    rt_kprintf("underruns %u packets, overruns %u samples, %u samples in %u pieces\n",
+               st.underruns, st.overruns, (rt_uint32_t)st.samples, st.pushes);
+#ifdef RT_USING_CPUTIME
+    elapsed = clock_cpu_gettime() - st.since;
+    share = elapsed ? (rt_uint32_t)((st.push_cycles + st.send_cycles) * 10000 / elapsed) : 0;
+    rt_kprintf("cycles: %u per piece, %u per packet, CPU %u.%02u%%\n",
+               _mic_per(st.push_cycles, st.pushes), _mic_per(st.send_cycles, st.packets + st.idle),
+               share / 100, share % 100);
+#else
+    RT_UNUSED(elapsed);
+    RT_UNUSED(share);
+#endif
+}
+MSH_CMD_EXPORT(uac_mic, USB microphone counters: uac_mic [reset]);
+#endif /* RT_USING_FINSH */
+
 /*
  *  register uac class
  */
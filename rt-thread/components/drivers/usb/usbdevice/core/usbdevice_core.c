@@ -11,6 +11,7 @@
  * 2013-04-26     aozima       add DEVICEQUALIFIER support.
  * 2013-07-25     Yi Qiu       update for USB CV test
  * 2017-11-15     ZYH          fix ep0 transform error
+ * 2025-03-01     RT-Thread    match endpoints by transfer type only
  */
 
 #include <rtthread.h>
@@ -1895,7 +1896,8 @@ static rt_err_t rt_usbd_ep_assign(udevice_t device, uep_t ep)
     while(device->dcd->ep_pool[i].addr != 0xFF)
     {
         if(device->dcd->ep_pool[i].status == ID_UNASSIGNED &&
-            ep->ep_desc->bmAttributes == device->dcd->ep_pool[i].type && (EP_ADDRESS(ep) & 0x80) == device->dcd->ep_pool[i].dir)
+            USB_EP_ATTR(ep->ep_desc->bmAttributes) == device->dcd->ep_pool[i].type &&
+            (EP_ADDRESS(ep) & 0x80) == device->dcd->ep_pool[i].dir)
         {
             EP_ADDRESS(ep) |= device->dcd->ep_pool[i].addr;
             ep->id = &device->dcd->ep_pool[i];
@@ -286,6 +286,14 @@ rt_err_t rt_wlan_cfg_save(struct rt_wlan_cfg_info *cfg_info)
         return RT_EOK;
     }
 
+    /* same network and key: keep the cached PMK and lease */
+    if ((idx >= 0) && (cfg_info->fast.pmk_len == 0) && (cfg_info->fast.lease_ip == 0) &&
+            (cfg_cache->cfg_info[idx].key.len == cfg_info->key.len) &&
+            (rt_memcmp(&cfg_cache->cfg_info[idx].key.val[0], &cfg_info->key.val[0], cfg_info->key.len) == 0))
+    {
+        cfg_info->fast = cfg_cache->cfg_info[idx].fast;
+    }
+
     /* not find iteam with cache, Add iteam to the head   */
     if ((idx == -1) && (cfg_cache->num < RT_WLAN_CFG_INFO_MAX))
     {
@@ -334,6 +342,100 @@ int rt_wlan_cfg_read_index(struct rt_wlan_cfg_info *cfg_info, int index)
     return 1;
 }
 
+static int rt_wlan_cfg_index_of(const rt_wlan_ssid_t *ssid)
+{
+    int i;
+
+    for (i = 0; i < cfg_cache->num; i++)
+    {
+        if ((cfg_cache->cfg_info[i].info.ssid.len == ssid->len) &&
+                (rt_memcmp(&cfg_cache->cfg_info[i].info.ssid.val[0], &ssid->val[0], ssid->len) == 0))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int rt_wlan_cfg_find(const rt_wlan_ssid_t *ssid, struct rt_wlan_cfg_info *cfg_info)
+{
+    int index;
+
+    rt_wlan_cfg_init();
+
+    if ((ssid == RT_NULL) || (cfg_info == RT_NULL) || (ssid->len == 0))
+        return 0;
+
+    WLAN_CFG_LOCK();
+    index = rt_wlan_cfg_index_of(ssid);
+    if (index < 0)
+    {
+        WLAN_CFG_UNLOCK();
+        return 0;
+    }
+    *cfg_info = cfg_cache->cfg_info[index];
+    WLAN_CFG_UNLOCK();
+    return 1;
+}
+
+rt_err_t rt_wlan_cfg_set_pmk(const rt_wlan_ssid_t *ssid, const rt_uint8_t *pmk, int pmk_len)
+{
+    struct rt_wlan_cfg_fast *fast;
+    int index;
+
+    rt_wlan_cfg_init();
+
+    if ((ssid == RT_NULL) || (pmk_len < 0) || (pmk_len > RT_WLAN_PMK_LENGTH))
+        return -RT_EINVAL;
+
+    WLAN_CFG_LOCK();
+    index = rt_wlan_cfg_index_of(ssid);
+    if (index < 0)
+    {
+        WLAN_CFG_UNLOCK();
+        return -RT_EEMPTY;
+    }
+    fast = &cfg_cache->cfg_info[index].fast;
+    if ((fast->pmk_len == pmk_len) && (rt_memcmp(fast->pmk, pmk, pmk_len) == 0))
+    {
+        WLAN_CFG_UNLOCK();
+        return RT_EOK;
+    }
+    rt_memset(fast->pmk, 0, sizeof(fast->pmk));
+    rt_memcpy(fast->pmk, pmk, pmk_len);
+    fast->pmk_len = pmk_len;
+    WLAN_CFG_UNLOCK();
+
+    return rt_wlan_cfg_cache_save();
+}
+
+rt_err_t rt_wlan_cfg_set_lease(const rt_wlan_ssid_t *ssid, rt_uint32_t ip)
+{
+    int index;
+
+    rt_wlan_cfg_init();
+
+    if (ssid == RT_NULL)
+        return -RT_EINVAL;
+
+    WLAN_CFG_LOCK();
+    index = rt_wlan_cfg_index_of(ssid);
+    if (index < 0)
+    {
+        WLAN_CFG_UNLOCK();
+        return -RT_EEMPTY;
+    }
+    if (cfg_cache->cfg_info[index].fast.lease_ip == ip)
+    {
+        WLAN_CFG_UNLOCK();
+        return RT_EOK;
+    }
+    cfg_cache->cfg_info[index].fast.lease_ip = ip;
+    WLAN_CFG_UNLOCK();
+
+    return rt_wlan_cfg_cache_save();
+}
+
 int rt_wlan_cfg_delete_index(int index)
 {
     struct rt_wlan_cfg_info *cfg_info;
@@ -21,12 +21,22 @@ extern "C" {
 #define RT_WLAN_CFG_INFO_MAX    (3) /* min is 1 */
 #endif
 
-#define RT_WLAN_CFG_MAGIC       (0x426f6d62)
+#define RT_WLAN_CFG_MAGIC       (0x426f6d63)
+
+/* state kept from the last successful association, used to skip the scan */
+struct rt_wlan_cfg_fast
+{
+    rt_uint8_t pmk[RT_WLAN_PMK_LENGTH];
+    rt_uint8_t pmk_len;
+    rt_uint8_t reserved[3];
+    rt_uint32_t lease_ip;       /* last DHCP address, network byte order */
+};
 
 struct rt_wlan_cfg_info
 {
     struct rt_wlan_info info;
     struct rt_wlan_key key;
+    struct rt_wlan_cfg_fast fast;
 };
 
 typedef int (*rt_wlan_wr)(void *buff, int len);
@@ -48,6 +58,12 @@ int rt_wlan_cfg_read(struct rt_wlan_cfg_info *cfg_info, int num);
 
 int rt_wlan_cfg_read_index(struct rt_wlan_cfg_info *cfg_info, int index);
 
+int rt_wlan_cfg_find(const rt_wlan_ssid_t *ssid, struct rt_wlan_cfg_info *cfg_info);
+
+rt_err_t rt_wlan_cfg_set_pmk(const rt_wlan_ssid_t *ssid, const rt_uint8_t *pmk, int pmk_len);
+
+rt_err_t rt_wlan_cfg_set_lease(const rt_wlan_ssid_t *ssid, rt_uint32_t ip);
+
 rt_err_t rt_wlan_cfg_save(struct rt_wlan_cfg_info *cfg_info);
 
 rt_err_t rt_wlan_cfg_cache_refresh(void);
@@ -86,6 +86,12 @@ rt_err_t rt_wlan_dev_init(struct rt_wlan_device *device, rt_wlan_mode_t mode)
 }
 
 rt_err_t rt_wlan_dev_connect(struct rt_wlan_device *device, struct rt_wlan_info *info, const char *password, int password_len)
+{
+    return rt_wlan_dev_connect_pmk(device, info, password, password_len, RT_NULL, 0);
+}
+
+rt_err_t rt_wlan_dev_connect_pmk(struct rt_wlan_device *device, struct rt_wlan_info *info, const char *password, int password_len,
+    const rt_uint8_t *pmk, int pmk_len)
 {
     rt_err_t result = RT_EOK;
     struct rt_sta_info sta_info;
@@ -115,11 +121,36 @@ rt_err_t rt_wlan_dev_connect(struct rt_wlan_device *device, struct rt_wlan_info
     }
     sta_info.channel = info->channel;
     sta_info.security = info->security;
+    if ((pmk != RT_NULL) && (pmk_len > 0) && (pmk_len <= RT_WLAN_PMK_LENGTH))
+    {
+        rt_memcpy(sta_info.pmk, pmk, pmk_len);
+        sta_info.pmk_len = pmk_len;
+    }
 
     result = rt_device_control(RT_DEVICE(device), RT_WLAN_CMD_JOIN, &sta_info);
     return result;
 }
 
+int rt_wlan_dev_get_pmk(struct rt_wlan_device *device, rt_uint8_t pmk[], int len)
+{
+    struct rt_wlan_buff buff;
+    rt_err_t result;
+
+    if (device == RT_NULL)
+    {
+        return -RT_EIO;
+    }
+
+    buff.data = pmk;
+    buff.len = len;
+    result = rt_device_control(RT_DEVICE(device), RT_WLAN_CMD_GET_PMK, &buff);
+    if (result != RT_EOK)
+    {
+        return result;
+    }
+    return buff.len;
+}
+
 rt_err_t rt_wlan_dev_fast_connect(struct rt_wlan_device *device, struct rt_wlan_info *info, const char *password, int password_len)
 {
     rt_err_t result = RT_EOK;
@@ -607,6 +638,39 @@ rt_err_t rt_wlan_dev_report_data(struct rt_wlan_device *device, void *buff, int
 #endif
 }
 
+void *rt_wlan_dev_alloc_buff(struct rt_wlan_device *device, int len, void **payload)
+{
+#ifdef RT_WLAN_PROT_ENABLE
+    if (device == RT_NULL || payload == RT_NULL)
+    {
+        return RT_NULL;
+    }
+    return rt_wlan_dev_alloc_prot_buff(device, len, payload);
+#else
+    return RT_NULL;
+#endif
+}
+
+void rt_wlan_dev_free_buff(struct rt_wlan_device *device, void *buff)
+{
+#ifdef RT_WLAN_PROT_ENABLE
+    if (device == RT_NULL || buff == RT_NULL)
+    {
+        return;
+    }
+    rt_wlan_dev_free_prot_buff(device, buff);
+#endif
+}
+
+rt_err_t rt_wlan_dev_report_buff(struct rt_wlan_device *device, void *buff, int len)
+{
+#ifdef RT_WLAN_PROT_ENABLE
+    return rt_wlan_dev_transfer_prot_buff(device, buff, len);
+#else
+    return -RT_ERROR;
+#endif
+}
+
 rt_err_t rt_wlan_dev_enter_mgnt_filter(struct rt_wlan_device *device)
 {
     rt_err_t result = RT_EOK;
@@ -872,6 +936,30 @@ static rt_err_t _rt_wlan_dev_control(rt_device_t dev, int cmd, void *args)
             err = wlan->ops->wlan_set_mac(wlan, mac);
         break;
     }
+    case RT_WLAN_CMD_GET_PMK:
+    {
+        struct rt_wlan_buff *buff = (struct rt_wlan_buff *)args;
+        int len;
+
+        LOG_D("%s %d cmd[%d]:%s  run......", __FUNCTION__, __LINE__, RT_WLAN_CMD_GET_PMK, "RT_WLAN_CMD_GET_PMK");
+        if (wlan->ops->wlan_get_pmk)
+        {
+            len = wlan->ops->wlan_get_pmk(wlan, buff->data, buff->len);
+            if (len < 0)
+            {
+                err = len;
+            }
+            else
+            {
+                buff->len = len;
+            }
+        }
+        else
+        {
+            err = -RT_EEMPTY;
+        }
+        break;
+    }
     case RT_WLAN_CMD_GET_MAC:
     {
         rt_uint8_t *mac = args;
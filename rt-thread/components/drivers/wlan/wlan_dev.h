@@ -47,6 +47,7 @@ typedef enum
     RT_WLAN_CMD_GET_MAC,
     RT_WLAN_CMD_GET_FAST_CONNECT_INFO,
     RT_WLAN_CMD_FAST_CONNECT,
+    RT_WLAN_CMD_GET_PMK,           /* get PMK of the current association */
 } rt_wlan_cmd_t;
 
 typedef enum
@@ -89,6 +90,8 @@ typedef enum
 #define RT_WLAN_PASSWORD_MAX_LENGTH   (32)   /* PASSWORD MAX LEN*/
 #endif
 
+#define RT_WLAN_PMK_LENGTH       (32)   /* WPA/WPA2 pairwise master key */
+
 #ifndef RT_WLAN_DEV_EVENT_NUM
 #define RT_WLAN_DEV_EVENT_NUM  (2)   /* EVENT GROUP MAX NUM */
 #endif
@@ -465,6 +468,9 @@ struct rt_sta_info
     rt_uint8_t bssid[6];
     rt_uint16_t channel;
     rt_wlan_security_t security;
+    /* cached PMK, lets the driver skip the passphrase derivation */
+    rt_uint8_t pmk[RT_WLAN_PMK_LENGTH];
+    rt_uint8_t pmk_len;
 };
 
 struct rt_ap_info
@@ -485,6 +491,13 @@ struct rt_scan_info
     rt_bool_t passive;
 };
 
+/* one fragment of a scatter-gather frame, see wlan_send_sg */
+struct rt_wlan_sg
+{
+    void *buff;
+    int len;
+};
+
 struct rt_wlan_dev_ops
 {
     rt_err_t (*wlan_init)(struct rt_wlan_device *wlan);
@@ -513,6 +526,8 @@ struct rt_wlan_dev_ops
     int (*wlan_send_raw_frame)(struct rt_wlan_device *wlan, void *buff, int len);
     int (*wlan_get_fast_info)(void *data);
     rt_err_t (*wlan_fast_connect)(void *data,rt_int32_t len);
+    int (*wlan_send_sg)(struct rt_wlan_device *wlan, const struct rt_wlan_sg *sg, int sg_num, int len);
+    int (*wlan_get_pmk)(struct rt_wlan_device *wlan, rt_uint8_t pmk[], int len);
 };
 
 /*
@@ -524,6 +539,9 @@ rt_err_t rt_wlan_dev_init(struct rt_wlan_device *device, rt_wlan_mode_t mode);
  * wlan device station interface
  */
 rt_err_t rt_wlan_dev_connect(struct rt_wlan_device *device, struct rt_wlan_info *info, const char *password, int password_len);
+rt_err_t rt_wlan_dev_connect_pmk(struct rt_wlan_device *device, struct rt_wlan_info *info, const char *password, int password_len,
+    const rt_uint8_t *pmk, int pmk_len);
+int rt_wlan_dev_get_pmk(struct rt_wlan_device *device, rt_uint8_t pmk[], int len);
 rt_err_t rt_wlan_dev_fast_connect(struct rt_wlan_device *device, struct rt_wlan_info *info, const char *password, int password_len);
 rt_err_t rt_wlan_dev_disconnect(struct rt_wlan_device *device);
 int rt_wlan_dev_get_rssi(struct rt_wlan_device *device);
@@ -589,6 +607,10 @@ rt_country_code_t rt_wlan_dev_get_country(struct rt_wlan_device *device);
  * wlan device datat transfer interface
  */
 rt_err_t rt_wlan_dev_report_data(struct rt_wlan_device *device, void *buff, int len);
+/* zero-copy receive: the driver fills a protocol buffer and hands it up, report_buff always takes it */
+void *rt_wlan_dev_alloc_buff(struct rt_wlan_device *device, int len, void **payload);
+void rt_wlan_dev_free_buff(struct rt_wlan_device *device, void *buff);
+rt_err_t rt_wlan_dev_report_buff(struct rt_wlan_device *device, void *buff, int len);
 // void rt_wlan_dev_data_ready(struct rt_wlan_device *device, int len);
 
 /*
@@ -42,6 +42,26 @@
 #define RT_WLAN_PROT_LWIP_NAME  ("lwip")
 #endif
 
+#ifndef RT_WLAN_PROT_LWIP_SG_MAX
+#define RT_WLAN_PROT_LWIP_SG_MAX  (8)
+#endif
+
+/*
+ * Seeding INIT-REBOOT writes dhcp->state and dhcp->offered_ip_addr, which are
+ * internals of struct dhcp and only checked against lwIP 2.1; lwIP exposes no
+ * public call for it. Other versions fall back to a plain dhcp_start().
+ */
+#if defined(RT_LWIP_DHCP) && defined(RT_WLAN_JOIN_FAST_CACHE) && !defined(RT_USING_LWIP141)
+#include <lwip/init.h>
+#if (LWIP_VERSION_MAJOR == 2) && (LWIP_VERSION_MINOR == 1)
+#define WLAN_LWIP_DHCP_REBOOT
+#include <lwip/dhcp.h>
+#include <lwip/prot/dhcp.h>
+#include <wlan_cfg.h>
+#include <wlan_mgnt.h>
+#endif /* LWIP_VERSION 2.1 */
+#endif
+
 struct lwip_prot_des
 {
     struct rt_wlan_prot prot;
@@ -49,6 +69,9 @@ struct lwip_prot_des
     rt_int8_t connected_flag;
     struct rt_timer timer;
     struct rt_work work;
+#ifdef WLAN_LWIP_DHCP_REBOOT
+    rt_uint32_t lease_ip;
+#endif
 };
 
 static void netif_is_ready(struct rt_work *work, void *parameter)
@@ -152,6 +175,49 @@ static void timer_callback(void *parameter)
 
 }
 
+#ifdef WLAN_LWIP_DHCP_REBOOT
+static rt_uint32_t rt_wlan_lwip_cached_lease(void)
+{
+    rt_wlan_ssid_t ssid;
+    struct rt_wlan_cfg_info cfg_info;
+
+    if ((rt_wlan_get_sta_ssid(&ssid) != RT_EOK) ||
+            (rt_wlan_cfg_find(&ssid, &cfg_info) == 0))
+    {
+        return 0;
+    }
+    return cfg_info.fast.lease_ip;
+}
+
+/*
+ * Runs in the tcpip thread. DHCP is started while the link is still down,
+ * then seeded with the previous lease so that bringing the link up sends an
+ * INIT-REBOOT request instead of a full DISCOVER. A NAK or timeout falls
+ * back to DISCOVER inside lwIP.
+ */
+static err_t rt_wlan_lwip_dhcp_start(struct netif *netif)
+{
+    struct eth_device *eth_dev = (struct eth_device *)netif->state;
+    struct lwip_prot_des *lwip_prot = rt_container_of(eth_dev, struct lwip_prot_des, eth);
+    struct dhcp *dhcp;
+    err_t err;
+
+    if (netif_is_link_up(netif))
+    {
+        netif_set_link_down(netif);
+    }
+    err = dhcp_start(netif);
+    dhcp = netif_dhcp_data(netif);
+    if ((err == ERR_OK) && (dhcp != RT_NULL) && (lwip_prot->lease_ip != 0))
+    {
+        ip4_addr_set_u32(&dhcp->offered_ip_addr, lwip_prot->lease_ip);
+        dhcp->state = DHCP_STATE_REBOOTING;
+    }
+    netif_set_link_up(netif);
+    return err;
+}
+#endif /* WLAN_LWIP_DHCP_REBOOT */
+
 static void netif_set_connected(void *parameter)
 {
     struct rt_wlan_device *wlan = parameter;
@@ -168,10 +234,15 @@ static void netif_set_connected(void *parameter)
         if (wlan->mode == RT_WLAN_STATION)
         {
             LOG_D("F:%s L:%d dhcp start run", __FUNCTION__, __LINE__);
+#ifdef WLAN_LWIP_DHCP_REBOOT
+            lwip_prot->lease_ip = rt_wlan_lwip_cached_lease();
+            netifapi_netif_common(eth_dev->netif, NULL, rt_wlan_lwip_dhcp_start);
+#else
             netifapi_netif_common(eth_dev->netif, netif_set_link_up, NULL);
 #ifdef RT_LWIP_DHCP
             netifapi_dhcp_start(eth_dev->netif);
 #endif
+#endif /* WLAN_LWIP_DHCP_REBOOT */
             rt_timer_start(&lwip_prot->timer);
         }
         else if (wlan->mode == RT_WLAN_AP)
@@ -298,6 +369,85 @@ static rt_err_t rt_wlan_lwip_protocol_control(rt_device_t device, int cmd, void
     return err;
 }
 
+struct lwip_prot_stats
+{
+    rt_uint32_t rx_zero_copy;
+    rt_uint32_t rx_copy;
+    rt_uint32_t rx_drop;
+    rt_uint32_t tx_sg;
+    rt_uint32_t tx_direct;
+    rt_uint32_t tx_flatten;
+    rt_uint32_t tx_flatten_bytes;
+};
+
+static struct lwip_prot_stats lwip_prot_stats;
+
+#ifndef RT_WLAN_PROT_LWIP_PBUF_FORCE
+static struct pbuf *rt_wlan_lwip_pbuf_alloc(int len)
+{
+    struct pbuf *p;
+
+    /* the driver needs one contiguous payload, a chained pool pbuf is useless here */
+    p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+    if (p != RT_NULL && p->len != p->tot_len)
+    {
+        pbuf_free(p);
+        p = RT_NULL;
+    }
+    if (p == RT_NULL)
+    {
+        p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+    }
+    return p;
+}
+
+static void *rt_wlan_lwip_protocol_alloc_buff(struct rt_wlan_device *wlan, int len, void **payload)
+{
+    struct pbuf *p;
+
+    p = rt_wlan_lwip_pbuf_alloc(len);
+    if (p == RT_NULL)
+    {
+        lwip_prot_stats.rx_drop++;
+        return RT_NULL;
+    }
+    *payload = p->payload;
+    return p;
+}
+
+static void rt_wlan_lwip_protocol_free_buff(struct rt_wlan_device *wlan, void *buff)
+{
+    pbuf_free((struct pbuf *)buff);
+}
+
+static rt_err_t rt_wlan_lwip_protocol_recv_buff(struct rt_wlan_device *wlan, void *buff, int len)
+{
+    struct eth_device *eth_dev = &((struct lwip_prot_des *)wlan->prot)->eth;
+    struct pbuf *p = buff;
+
+    if (eth_dev->netif == RT_NULL)
+    {
+        pbuf_free(p);
+        return -RT_ERROR;
+    }
+
+    /* the frame may be shorter than the buffer the driver asked for */
+    if (len < p->tot_len)
+    {
+        pbuf_realloc(p, len);
+    }
+    if ((eth_dev->netif->input(p, eth_dev->netif)) != ERR_OK)
+    {
+        LOG_D("F:%s L:%d IP input error", __FUNCTION__, __LINE__);
+        pbuf_free(p);
+        lwip_prot_stats.rx_drop++;
+        return -RT_ERROR;
+    }
+    lwip_prot_stats.rx_zero_copy++;
+    return RT_EOK;
+}
+#endif /* RT_WLAN_PROT_LWIP_PBUF_FORCE */
+
 static rt_err_t rt_wlan_lwip_protocol_recv(struct rt_wlan_device *wlan, void *buff, int len)
 {
     struct eth_device *eth_dev = &((struct lwip_prot_des *)wlan->prot)->eth;
@@ -320,37 +470,28 @@ static rt_err_t rt_wlan_lwip_protocol_recv(struct rt_wlan_device *wlan, void *bu
     }
 #else
     {
-        int count = 0;
-
-        while (p == RT_NULL)
+        /*
+         * This runs in the driver receive context, never sleep waiting for
+         * a pbuf: drop the frame and let the upper layer retransmit.
+         */
+        p = rt_wlan_lwip_pbuf_alloc(len);
+        if (p == RT_NULL)
         {
-            p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
-            if (p != RT_NULL)
-                break;
-
-            p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
-            if (p != RT_NULL)
-                break;
-
-            LOG_D("F:%s L:%d wait for pbuf_alloc!", __FUNCTION__, __LINE__);
-            rt_thread_delay(1);
-            count++;
-
-            //wait for 10ms or give up!!
-            if (count >= 10)
-            {
-                LOG_W("F:%s L:%d pbuf allocate fail!!!", __FUNCTION__, __LINE__);
-                return -RT_ENOMEM;
-            }
+            LOG_D("F:%s L:%d pbuf allocate fail!", __FUNCTION__, __LINE__);
+            lwip_prot_stats.rx_drop++;
+            return -RT_ENOMEM;
         }
         /*copy data dat -> pbuf*/
-        pbuf_take(p, buff, len);
+        rt_memcpy(p->payload, buff, len);
         if ((eth_dev->netif->input(p, eth_dev->netif)) != ERR_OK)
         {
             LOG_D("F:%s L:%d IP input error", __FUNCTION__, __LINE__);
             pbuf_free(p);
             p = RT_NULL;
+            lwip_prot_stats.rx_drop++;
+            return RT_EOK;
         }
+        lwip_prot_stats.rx_copy++;
         LOG_D("F:%s L:%d netif iput success! len:%d", __FUNCTION__, __LINE__, len);
         return RT_EOK;
     }
@@ -382,9 +523,36 @@ static rt_err_t rt_wlan_lwip_protocol_send(rt_device_t device, struct pbuf *p)
         {
             frame = (rt_uint8_t *)p->payload;
             rt_wlan_prot_transfer_dev(wlan, frame, p->tot_len);
+            lwip_prot_stats.tx_direct++;
             LOG_D("F:%s L:%d run len:%d", __FUNCTION__, __LINE__, p->tot_len);
             return RT_EOK;
         }
+
+        /* hand the pbuf chain to the driver as it is */
+        if (wlan->ops->wlan_send_sg != RT_NULL)
+        {
+            struct rt_wlan_sg sg[RT_WLAN_PROT_LWIP_SG_MAX];
+            struct pbuf *q;
+            int sg_num = 0;
+
+            for (q = p; q != RT_NULL && sg_num < RT_WLAN_PROT_LWIP_SG_MAX; q = q->next)
+            {
+                if (q->len == 0)
+                    continue;
+                sg[sg_num].buff = q->payload;
+                sg[sg_num].len = q->len;
+                sg_num++;
+            }
+            if (q == RT_NULL)
+            {
+                rt_wlan_prot_transfer_dev_sg(wlan, sg, sg_num, p->tot_len);
+                lwip_prot_stats.tx_sg++;
+                LOG_D("F:%s L:%d run len:%d sg:%d", __FUNCTION__, __LINE__, p->tot_len, sg_num);
+                return RT_EOK;
+            }
+            /* too many fragments, fall back to a flat copy */
+        }
+
         frame = rt_malloc(p->tot_len);
         if (frame == RT_NULL)
         {
@@ -395,6 +563,8 @@ static rt_err_t rt_wlan_lwip_protocol_send(rt_device_t device, struct pbuf *p)
         pbuf_copy_partial(p, frame, p->tot_len, 0);
         /* send data */
         rt_wlan_prot_transfer_dev(wlan, frame, p->tot_len);
+        lwip_prot_stats.tx_flatten++;
+        lwip_prot_stats.tx_flatten_bytes += p->tot_len;
         LOG_D("F:%s L:%d run len:%d", __FUNCTION__, __LINE__, p->tot_len);
         rt_free(frame);
         return RT_EOK;
@@ -527,7 +697,16 @@ static struct rt_wlan_prot_ops ops =
 {
     rt_wlan_lwip_protocol_recv,
     rt_wlan_lwip_protocol_register,
-    rt_wlan_lwip_protocol_unregister
+    rt_wlan_lwip_protocol_unregister,
+#ifdef RT_WLAN_PROT_LWIP_PBUF_FORCE
+    RT_NULL,
+    RT_NULL,
+    RT_NULL
+#else
+    rt_wlan_lwip_protocol_alloc_buff,
+    rt_wlan_lwip_protocol_free_buff,
+    rt_wlan_lwip_protocol_recv_buff
+#endif
 };
 
 int rt_wlan_lwip_init(void)
@@ -554,5 +733,18 @@ int rt_wlan_lwip_init(void)
 }
 INIT_PREV_EXPORT(rt_wlan_lwip_init);
 
+#ifdef RT_USING_FINSH
+static void wlan_lwip_stats(void)
+{
+    rt_kprintf("rx zero-copy : %u\n", lwip_prot_stats.rx_zero_copy);
+    rt_kprintf("rx copied    : %u\n", lwip_prot_stats.rx_copy);
+    rt_kprintf("rx dropped   : %u\n", lwip_prot_stats.rx_drop);
+    rt_kprintf("tx direct    : %u\n", lwip_prot_stats.tx_direct);
+    rt_kprintf("tx sg        : %u\n", lwip_prot_stats.tx_sg);
+    rt_kprintf("tx flattened : %u (%u bytes)\n", lwip_prot_stats.tx_flatten, lwip_prot_stats.tx_flatten_bytes);
+}
+MSH_CMD_EXPORT(wlan_lwip_stats, show wlan lwip datapath statistics);
+#endif
+
 #endif
 #endif
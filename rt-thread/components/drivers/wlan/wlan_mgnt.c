@@ -121,6 +121,9 @@ static struct rt_mutex complete_mutex;
 static struct rt_timer reconnect_time;
 #endif
 
+/* tick of the last join request, used to report join-to-IP time */
+static rt_tick_t join_tick;
+
 rt_inline int _sta_is_null(void)
 {
     if (_sta_mgnt.device == RT_NULL)
@@ -441,6 +444,18 @@ static void rt_wlan_event_dispatch(struct rt_wlan_device *device, rt_wlan_dev_ev
                 rt_exit_critical();
                 RT_WLAN_LOG_D("run save config! ssid:%s len%d", _sta_mgnt.info.ssid.val, _sta_mgnt.info.ssid.len);
                 rt_wlan_cfg_save(&cfg_info);
+#ifdef RT_WLAN_JOIN_FAST_CACHE
+                {
+                    rt_uint8_t pmk[RT_WLAN_PMK_LENGTH];
+                    int pmk_len;
+
+                    pmk_len = rt_wlan_dev_get_pmk(_sta_mgnt.device, pmk, sizeof(pmk));
+                    if (pmk_len > 0)
+                    {
+                        rt_wlan_cfg_set_pmk(&cfg_info.info.ssid, pmk, pmk_len);
+                    }
+                }
+#endif
             }
         }
 #endif
@@ -874,13 +889,85 @@ static void rt_wlan_join_scan_callback(int event, struct rt_wlan_buff *buff, voi
 }
 #endif
 
+static rt_err_t rt_wlan_connect_adv_pmk(struct rt_wlan_info *info, const char *password,
+                                        const rt_uint8_t *pmk, int pmk_len);
+
+/* start a join and block until the driver reports success or failure */
+static rt_err_t rt_wlan_join_wait(struct rt_wlan_info *info, const char *password,
+                                  const rt_uint8_t *pmk, int pmk_len)
+{
+    rt_err_t err;
+    struct rt_wlan_complete_des *complete;
+    rt_uint32_t set = 0, recved = 0;
+
+    /* create event wait complete */
+    complete = rt_wlan_complete_create("join");
+    if (complete == RT_NULL)
+    {
+        return -RT_ENOMEM;
+    }
+    /* run connect adv */
+    err = rt_wlan_connect_adv_pmk(info, password, pmk, pmk_len);
+    if (err != RT_EOK)
+    {
+        rt_wlan_complete_delete(complete);
+        return err;
+    }
+
+    /* Initializing events that need to wait */
+    set |= 0x1 << RT_WLAN_DEV_EVT_CONNECT;
+    set |= 0x1 << RT_WLAN_DEV_EVT_CONNECT_FAIL;
+    /* Check whether there is a waiting event */
+    rt_wlan_complete_wait(complete, set, RT_WLAN_CONNECT_WAIT_MS, &recved);
+    rt_wlan_complete_delete(complete);
+    /* check event */
+    set = 0x1 << RT_WLAN_DEV_EVT_CONNECT;
+    if (!(recved & set))
+    {
+        return -RT_ERROR;
+    }
+    return RT_EOK;
+}
+
+#ifdef RT_WLAN_JOIN_FAST_CACHE
+/*
+ * Directed join with the BSSID/channel/security of the last good
+ * association, skipping the full scan. Only used when the cached key
+ * matches the requested password.
+ */
+static rt_err_t rt_wlan_join_cached(struct rt_wlan_info *info, const char *password)
+{
+    struct rt_wlan_cfg_info cfg_info;
+    int password_len = password ? rt_strlen(password) : 0;
+    const rt_uint8_t zero_bssid[RT_WLAN_BSSID_MAX_LENGTH] = { 0 };
+
+    if (rt_wlan_cfg_find(&info->ssid, &cfg_info) == 0)
+    {
+        return -RT_EEMPTY;
+    }
+    if ((cfg_info.key.len != password_len) ||
+            (rt_memcmp(&cfg_info.key.val[0], password, password_len) != 0) ||
+            (cfg_info.info.channel <= 0) ||
+            (rt_memcmp(cfg_info.info.bssid, zero_bssid, RT_WLAN_BSSID_MAX_LENGTH) == 0))
+    {
+        return -RT_EEMPTY;
+    }
+
+    info->security = cfg_info.info.security;
+    info->band = cfg_info.info.band;
+    info->channel = cfg_info.info.channel;
+    rt_memcpy(info->bssid, cfg_info.info.bssid, RT_WLAN_BSSID_MAX_LENGTH);
+
+    RT_WLAN_LOG_D("cached join ssid:%s chn:%d", info->ssid.val, info->channel);
+    return rt_wlan_join_wait(info, password, cfg_info.fast.pmk, cfg_info.fast.pmk_len);
+}
+#endif
+
 rt_err_t rt_wlan_connect(const char *ssid, const char *password)
 {
     rt_err_t err = RT_EOK;
     int ssid_len = 0;
     struct rt_wlan_info info;
-    struct rt_wlan_complete_des *complete;
-    rt_uint32_t set = 0, recved = 0;
 
     /* sta dev Can't be NULL */
     if (_sta_is_null())
@@ -913,11 +1000,28 @@ rt_err_t rt_wlan_connect(const char *ssid, const char *password)
     rt_memcpy(&info.ssid.val[0],ssid,rt_strlen(ssid));
     info.ssid.len = rt_strlen(ssid);
 
+#ifdef RT_WLAN_JOIN_FAST_CACHE
+    err = rt_wlan_join_cached(&info, password);
+    if (err == RT_EOK)
+    {
+        MGNT_UNLOCK();
+        return err;
+    }
+    if (err != -RT_EEMPTY)
+    {
+        RT_WLAN_LOG_I("cached join failed, scanning for ssid:%s", ssid);
+    }
+    INVALID_INFO(&info);
+    rt_memcpy(&info.ssid.val[0], ssid, ssid_len);
+    info.ssid.len = ssid_len;
+#endif
+
 #ifdef RT_WLAN_JOIN_SCAN_BY_MGNT
     err = rt_wlan_register_event_handler(RT_WLAN_EVT_SCAN_REPORT,rt_wlan_join_scan_callback,&info);
     if(err != RT_EOK)
     {
         LOG_E("Scan register user callback error:%d!\n",err);
+        MGNT_UNLOCK();
         return err;
     }
 
@@ -925,6 +1029,7 @@ rt_err_t rt_wlan_connect(const char *ssid, const char *password)
     if(err != RT_EOK)
     {
         LOG_E("Scan with info error:%d!\n",err);
+        MGNT_UNLOCK();
         return err;
     }
 
@@ -939,41 +1044,24 @@ rt_err_t rt_wlan_connect(const char *ssid, const char *password)
                   info.ssid.val, info.bssid[0], info.bssid[1], info.bssid[2], info.bssid[3], info.bssid[4], info.bssid[5]);
 #endif
 
-    /* create event wait complete */
-    complete = rt_wlan_complete_create("join");
-    if (complete == RT_NULL)
-    {
-        MGNT_UNLOCK();
-        return -RT_ENOMEM;
-    }
-    /* run connect adv */
-    err = rt_wlan_connect_adv(&info, password);
+    err = rt_wlan_join_wait(&info, password, RT_NULL, 0);
     if (err != RT_EOK)
-    {
-        rt_wlan_complete_delete(complete);
-        MGNT_UNLOCK();
-        return err;
-    }
-
-    /* Initializing events that need to wait */
-    set |= 0x1 << RT_WLAN_DEV_EVT_CONNECT;
-    set |= 0x1 << RT_WLAN_DEV_EVT_CONNECT_FAIL;
-    /* Check whether there is a waiting event */
-    rt_wlan_complete_wait(complete, set, RT_WLAN_CONNECT_WAIT_MS, &recved);
-    rt_wlan_complete_delete(complete);
-    /* check event */
-    set = 0x1 << RT_WLAN_DEV_EVT_CONNECT;
-    if (!(recved & set))
     {
         RT_WLAN_LOG_I("wifi connect failed!");
         MGNT_UNLOCK();
-        return -RT_ERROR;
+        return err;
     }
     MGNT_UNLOCK();
     return err;
 }
 
 rt_err_t rt_wlan_connect_adv(struct rt_wlan_info *info, const char *password)
+{
+    return rt_wlan_connect_adv_pmk(info, password, RT_NULL, 0);
+}
+
+static rt_err_t rt_wlan_connect_adv_pmk(struct rt_wlan_info *info, const char *password,
+                                        const rt_uint8_t *pmk, int pmk_len)
 {
     int password_len = 0;
     rt_err_t err = RT_EOK;
@@ -1035,11 +1123,12 @@ rt_err_t rt_wlan_connect_adv(struct rt_wlan_info *info, const char *password)
     rt_exit_critical();
     /* run wifi connect */
     _sta_mgnt.state |= RT_WLAN_STATE_CONNECTING;
+    join_tick = rt_tick_get();
 
     err = rt_wlan_dev_fast_connect(_sta_mgnt.device, info, password, password_len);
     if(err != RT_EOK)
     {
-        err = rt_wlan_dev_connect(_sta_mgnt.device, info, password, password_len);
+        err = rt_wlan_dev_connect_pmk(_sta_mgnt.device, info, password, password_len, pmk, pmk_len);
         if (err != RT_EOK)
         {
             rt_enter_critical();
@@ -1192,6 +1281,26 @@ rt_err_t rt_wlan_get_info(struct rt_wlan_info *info)
     return -RT_ERROR;
 }
 
+/*
+ * SSID of the current connection, copied from the management state without
+ * taking the management lock or asking the device for the RSSI, so that it
+ * can be called from the protocol stack on the connect path.
+ */
+rt_err_t rt_wlan_get_sta_ssid(rt_wlan_ssid_t *ssid)
+{
+    if (_sta_is_null())
+    {
+        return -RT_EIO;
+    }
+
+    if (rt_wlan_is_connected() == RT_TRUE)
+    {
+        *ssid = _sta_mgnt.info.ssid;
+        return RT_EOK;
+    }
+    return -RT_ERROR;
+}
+
 int rt_wlan_get_rssi(void)
 {
     int rssi = 0;
@@ -1728,6 +1837,14 @@ int rt_wlan_prot_ready_event(struct rt_wlan_device *wlan, struct rt_wlan_buff *b
     level = rt_hw_interrupt_disable();
     _sta_mgnt.state |= RT_WLAN_STATE_READY;
     rt_hw_interrupt_enable(level);
+    RT_WLAN_LOG_I("join to ip: %d ms", (rt_tick_get() - join_tick) * 1000 / RT_TICK_PER_SECOND);
+#ifdef RT_WLAN_JOIN_FAST_CACHE
+    /* remember the lease so the next association can INIT-REBOOT */
+    if (buff->len == sizeof(rt_uint32_t))
+    {
+        rt_wlan_cfg_set_lease(&_sta_mgnt.info.ssid, *(rt_uint32_t *)buff->data);
+    }
+#endif
 #ifdef RT_WLAN_WORK_THREAD_ENABLE
     rt_wlan_send_to_thread(RT_WLAN_EVT_READY, buff->data, buff->len);
 #else
@@ -98,6 +98,7 @@ rt_bool_t rt_wlan_is_ready(void);
 rt_err_t rt_wlan_set_mac(rt_uint8_t *mac);
 rt_err_t rt_wlan_get_mac(rt_uint8_t *mac);
 rt_err_t rt_wlan_get_info(struct rt_wlan_info *info);
+rt_err_t rt_wlan_get_sta_ssid(rt_wlan_ssid_t *ssid);
 int rt_wlan_get_rssi(void);
 
 /*
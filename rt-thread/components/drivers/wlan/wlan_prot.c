@@ -329,6 +329,15 @@ rt_err_t rt_wlan_prot_transfer_dev(struct rt_wlan_device *wlan, void *buff, int
     return -RT_ERROR;
 }
 
+rt_err_t rt_wlan_prot_transfer_dev_sg(struct rt_wlan_device *wlan, const struct rt_wlan_sg *sg, int sg_num, int len)
+{
+    if (wlan->ops->wlan_send_sg != RT_NULL)
+    {
+        return wlan->ops->wlan_send_sg(wlan, sg, sg_num, len);
+    }
+    return -RT_ENOSYS;
+}
+
 rt_err_t rt_wlan_dev_transfer_prot(struct rt_wlan_device *wlan, void *buff, int len)
 {
     struct rt_wlan_prot *prot = wlan->prot;
@@ -340,6 +349,41 @@ rt_err_t rt_wlan_dev_transfer_prot(struct rt_wlan_device *wlan, void *buff, int
     return -RT_ERROR;
 }
 
+void *rt_wlan_dev_alloc_prot_buff(struct rt_wlan_device *wlan, int len, void **payload)
+{
+    struct rt_wlan_prot *prot = wlan->prot;
+
+    if (prot != RT_NULL && prot->ops->prot_alloc_buff != RT_NULL)
+    {
+        return prot->ops->prot_alloc_buff(wlan, len, payload);
+    }
+    return RT_NULL;
+}
+
+void rt_wlan_dev_free_prot_buff(struct rt_wlan_device *wlan, void *buff)
+{
+    struct rt_wlan_prot *prot = wlan->prot;
+
+    if (prot != RT_NULL && prot->ops->prot_free_buff != RT_NULL)
+    {
+        prot->ops->prot_free_buff(wlan, buff);
+    }
+}
+
+rt_err_t rt_wlan_dev_transfer_prot_buff(struct rt_wlan_device *wlan, void *buff, int len)
+{
+    struct rt_wlan_prot *prot = wlan->prot;
+
+    if (prot != RT_NULL && prot->ops->prot_recv_buff != RT_NULL)
+    {
+        return prot->ops->prot_recv_buff(wlan, buff, len);
+    }
+
+    /* the buffer is consumed on every path, as prot_recv_buff does on its errors */
+    rt_wlan_dev_free_prot_buff(wlan, buff);
+    return -RT_ERROR;
+}
+
 extern int rt_wlan_prot_ready_event(struct rt_wlan_device *wlan, struct rt_wlan_buff *buff);
 int rt_wlan_prot_ready(struct rt_wlan_device *wlan, struct rt_wlan_buff *buff)
 {
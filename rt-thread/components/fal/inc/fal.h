@@ -120,6 +120,85 @@ int fal_partition_erase_all(const struct fal_partition *part);
  */
 void fal_show_part_table(void);
 
+#ifdef FAL_USING_WRITE_BUFFER
+/* =============== buffered write API =============== */
+/**
+ * open a write buffer on the partition
+ * Small writes are collected into whole program pages before they reach the
+ * flash driver, blocks known to be blank are tracked so they are not erased
+ * again. Writes and erases through the plain partition API make the buffer
+ * forget that state for the blocks they touch; flush before mixing them so
+ * the buffered page lands first.
+ *
+ * @param part partition
+ * @param flags 0 or FAL_WBUF_AUTO_ERASE
+ *
+ * @return != NULL: write buffer
+ *            NULL: no memory
+ */
+fal_wbuf_t fal_wbuf_open(const struct fal_partition *part, uint32_t flags);
+
+/**
+ * write data through the buffer, the data may stay in RAM until the page is
+ * complete, another page is written or fal_wbuf_flush() is called
+ *
+ * @param wbuf write buffer
+ * @param addr relative address for partition
+ * @param buf write buffer
+ * @param size write size
+ *
+ * @return >= 0: successful write data size
+ *           -1: error
+ */
+int fal_wbuf_write(fal_wbuf_t wbuf, uint32_t addr, const uint8_t *buf, size_t size);
+
+/**
+ * read data, including the data still in the buffer
+ *
+ * @return >= 0: successful read data size
+ *           -1: error
+ */
+int fal_wbuf_read(fal_wbuf_t wbuf, uint32_t addr, uint8_t *buf, size_t size);
+
+/**
+ * erase the blocks covering the range, blank blocks are skipped
+ *
+ * @return >= 0: successful erased data size
+ *           -1: error
+ */
+int fal_wbuf_erase(fal_wbuf_t wbuf, uint32_t addr, size_t size);
+
+/**
+ * erase the blocks covering the range in a background thread and return at
+ * once, a later write or erase of those blocks then finds them blank
+ *
+ * @return 0: queued
+ *        -1: error
+ */
+int fal_wbuf_erase_ahead(fal_wbuf_t wbuf, uint32_t addr, size_t size);
+
+/**
+ * program the buffered page
+ *
+ * @return 0: success
+ *        -1: error
+ */
+int fal_wbuf_flush(fal_wbuf_t wbuf);
+
+/**
+ * flush, stop the background erase and free the buffer
+ *
+ * @return 0: success
+ *        -1: the last flush failed
+ */
+int fal_wbuf_close(fal_wbuf_t wbuf);
+
+/**
+ * get the operation counters of the buffer
+ */
+void fal_wbuf_get_stats(fal_wbuf_t wbuf, struct fal_wbuf_stats *stats);
+#endif /* FAL_USING_WRITE_BUFFER */
+
 /* =============== API provided to RT-Thread =============== */
 /**
  * create RT-Thread block device by specified partition
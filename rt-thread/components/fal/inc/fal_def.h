@@ -129,4 +129,25 @@ struct fal_partition
 };
 typedef struct fal_partition *fal_partition_t;
 
+#ifdef FAL_USING_WRITE_BUFFER
+/* fal_wbuf_open() flags: erase a block on the first write into it unless it is blank */
+#define FAL_WBUF_AUTO_ERASE            0x01
+
+/**
+ * FAL write buffer statistics
+ */
+struct fal_wbuf_stats
+{
+    uint32_t writes;                   /* fal_wbuf_write() calls */
+    uint32_t write_bytes;
+    uint32_t programs;                 /* write operations passed to the flash driver */
+    uint32_t program_bytes;
+    uint32_t erases;                   /* blocks erased */
+    uint32_t erase_skipped;            /* blocks found or known blank, not erased */
+    uint32_t blank_checks;             /* blocks read back to look for a blank one */
+};
+
+typedef struct fal_wbuf *fal_wbuf_t;
+#endif /* FAL_USING_WRITE_BUFFER */
+
 #endif /* _FAL_DEF_H_ */
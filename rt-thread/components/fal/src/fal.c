@@ -22,9 +22,16 @@ int fal_init(void)
 {
     extern int fal_flash_init(void);
     extern int fal_partition_init(void);
+#ifdef FAL_USING_WRITE_BUFFER
+    extern void fal_wbuf_init(void);
+#endif
 
     int result;
 
+#ifdef FAL_USING_WRITE_BUFFER
+    fal_wbuf_init();
+#endif
+
     /* initialize all flash device on FAL flash table */
     result = fal_flash_init();
 
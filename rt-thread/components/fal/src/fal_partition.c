@@ -337,6 +337,10 @@ const struct fal_partition *fal_partition_find(const char *name)
     return NULL;
 }
 
+#ifdef FAL_USING_WRITE_BUFFER
+extern void fal_wbuf_invalidate(const struct fal_flash_dev *flash, long offset, size_t size);
+#endif
+
 static const struct fal_flash_dev *flash_device_find_by_part(const struct fal_partition *part)
 {
     assert(part >= partition_table);
@@ -465,6 +469,10 @@ int fal_partition_write(const struct fal_partition *part, uint32_t addr, const u
     {
         log_e("Partition write error! Flash device(%s) write error!", part->flash_name);
     }
+#ifdef FAL_USING_WRITE_BUFFER
+    /* an open write buffer must not trust what it knew about these blocks */
+    fal_wbuf_invalidate(flash_dev, part->offset + addr, size);
+#endif
 
     return ret;
 }
@@ -504,6 +512,9 @@ int fal_partition_erase(const struct fal_partition *part, uint32_t addr, size_t
     {
         log_e("Partition erase error! Flash device(%s) erase error!", part->flash_name);
     }
+#ifdef FAL_USING_WRITE_BUFFER
+    fal_wbuf_invalidate(flash_dev, part->offset + addr, size);
+#endif
 
     return ret;
 }
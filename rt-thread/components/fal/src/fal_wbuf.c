@@ -0,0 +1,1063 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-22     RT-Thread    the first version
+ */
+
+/*
+ * Buffered, erase aware writes to a FAL partition.
+ *
+ * One program page is kept in RAM. Writes are merged into it with the NOR rule
+ * (new = old & data), so writing the page later gives the same flash content as
+ * the individual writes would have. The page is programmed when a write fills
+ * it to its end, when another page is written, or on flush. Whole pages with
+ * nothing buffered go to the driver straight from the caller's buffer.
+ *
+ * Two bitmaps with one bit per erase block:
+ *  - blank: the block is all 0xFF, set after an erase or a successful blank
+ *    check, cleared by the first program into it. Erasing a blank block is
+ *    skipped.
+ *  - ready: the block has been made blank or programmed since the buffer was
+ *    opened. With FAL_WBUF_AUTO_ERASE it is programmed without another erase,
+ *    and the erase thread never erases it.
+ *
+ * fal_wbuf_erase_ahead() hands a range to a low priority thread which makes
+ * the blocks blank one by one, taking the lock per block so the writer waits
+ * for at most one block erase.
+ *
+ * fal_partition_write() and fal_partition_erase() clear both bits of the
+ * blocks they touch in every open buffer on that flash, so a block changed
+ * behind the buffer's back is checked or erased again before it is used.
+ *
+ * The check on the simulated flash also builds on a PC, with pthreads in
+ * place of the RT-Thread threads and locks:
+ *   cc -O2 -DFAL_WBUF_HOST -o fal_wbuf rt-thread/components/fal/src/fal_wbuf.c -lpthread
+ *   ./fal_wbuf
+ */
+
+#ifdef FAL_WBUF_HOST
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+/* what the buffer uses of fal.h and RT-Thread */
+#define FAL_USING_WRITE_BUFFER
+#define FAL_WBUF_AUTO_ERASE             0x01
+#define FAL_CALLOC                      calloc
+#define FAL_FREE                        free
+#define assert(EXPR)                    do { if (!(EXPR)) abort(); } while (0)
+#define log_e(...)                      (printf("[E/FAL] " __VA_ARGS__), printf("\n"))
+
+struct fal_flash_dev
+{
+    char name[24];
+    uint32_t addr;
+    size_t len;
+    size_t blk_size;
+    struct
+    {
+        int (*init)(void);
+        int (*read)(long offset, uint8_t *buf, size_t size);
+        int (*write)(long offset, const uint8_t *buf, size_t size);
+        int (*erase)(long offset, size_t size);
+    } ops;
+    size_t write_gran;
+};
+
+struct fal_partition
+{
+    uint32_t magic_word;
+    char name[24];
+    char flash_name[24];
+    long offset;
+    size_t len;
+    uint32_t reserved;
+};
+
+struct fal_wbuf_stats
+{
+    uint32_t writes;
+    uint32_t write_bytes;
+    uint32_t programs;
+    uint32_t program_bytes;
+    uint32_t erases;
+    uint32_t erase_skipped;
+    uint32_t blank_checks;
+};
+typedef struct fal_wbuf *fal_wbuf_t;
+
+static const struct fal_flash_dev *fal_flash_device_find(const char *name)
+{
+    (void)name;
+    return NULL;
+}
+
+typedef int rt_bool_t;
+typedef struct rt_slist_node { struct rt_slist_node *next; } rt_slist_t;
+struct rt_mutex { pthread_mutex_t m; };
+struct rt_semaphore { sem_t s; };
+struct host_thread { pthread_t tid; void (*entry)(void *); void *parameter; };
+typedef struct host_thread *rt_thread_t;
+
+#define RT_TRUE                         1
+#define RT_FALSE                        0
+#define RT_NULL                         NULL
+#define RT_WAITING_FOREVER              (-1)
+#define RT_IPC_FLAG_PRIO                0
+#define RT_SLIST_OBJECT_INIT(object)    { RT_NULL }
+#define rt_slist_entry(node, type, member) \
+    ((type *)((char *)(node) - (size_t)&((type *)0)->member))
+#define rt_slist_for_each(pos, head)    for (pos = (head)->next; pos != RT_NULL; pos = pos->next)
+#define rt_kprintf                      printf
+#define rt_memcpy                       memcpy
+#define rt_memset                       memset
+#define rt_memcmp                       memcmp
+#define rt_malloc                       malloc
+#define rt_free                         free
+#define rt_mutex_init(mx, name, flag)   pthread_mutex_init(&(mx)->m, NULL)
+#define rt_mutex_detach(mx)             pthread_mutex_destroy(&(mx)->m)
+#define rt_mutex_take(mx, t)            pthread_mutex_lock(&(mx)->m)
+#define rt_mutex_release(mx)            pthread_mutex_unlock(&(mx)->m)
+#define rt_sem_init(sm, name, v, flag)  sem_init(&(sm)->s, 0, v)
+#define rt_sem_detach(sm)               sem_destroy(&(sm)->s)
+#define rt_sem_take(sm, t)              sem_wait(&(sm)->s)
+#define rt_sem_release(sm)              sem_post(&(sm)->s)
+#define rt_thread_mdelay(ms)            usleep((ms) * 1000)
+
+static void rt_slist_append(rt_slist_t *l, rt_slist_t *n)
+{
+    while (l->next)
+        l = l->next;
+    l->next = n;
+    n->next = RT_NULL;
+}
+
+static void rt_slist_remove(rt_slist_t *l, rt_slist_t *n)
+{
+    while (l->next && l->next != n)
+        l = l->next;
+    if (l->next)
+        l->next = n->next;
+}
+
+static void *host_thread_entry(void *arg)
+{
+    struct host_thread *thread = (struct host_thread *)arg;
+
+    thread->entry(thread->parameter);
+    free(thread);
+    return NULL;
+}
+
+static rt_thread_t rt_thread_create(const char *name, void (*entry)(void *), void *parameter,
+                                    uint32_t stack_size, uint8_t priority, uint32_t tick)
+{
+    struct host_thread *thread = (struct host_thread *)calloc(1, sizeof(*thread));
+
+    if (thread)
+    {
+        thread->entry = entry;
+        thread->parameter = parameter;
+    }
+    return thread;
+}
+
+static void rt_thread_startup(rt_thread_t thread)
+{
+    pthread_create(&thread->tid, NULL, host_thread_entry, thread);
+    pthread_detach(thread->tid);
+}
+#else
+#include <fal.h>
+#include <string.h>
+#include <stdlib.h>
+#endif /* FAL_WBUF_HOST */
+
+#ifdef FAL_USING_WRITE_BUFFER
+
+#ifndef FAL_WBUF_PAGE_SIZE
+#define FAL_WBUF_PAGE_SIZE              256
+#endif
+
+#ifndef FAL_WBUF_ERASE_THREAD_PRIORITY
+#define FAL_WBUF_ERASE_THREAD_PRIORITY  25
+#endif
+#define FAL_WBUF_ERASE_THREAD_STACK     1024
+
+#define FAL_WBUF_NO_PAGE                0xFFFFFFFFUL
+
+struct fal_wbuf
+{
+    const struct fal_flash_dev *flash;
+    long base;                          /* partition offset on the flash device */
+    uint32_t len;
+    uint32_t blk_size;
+    uint32_t flags;
+
+    uint32_t *blank;
+    uint32_t *ready;
+
+    uint8_t page[FAL_WBUF_PAGE_SIZE];   /* 0xFF where nothing is buffered */
+    uint32_t page_addr;
+    uint32_t dirty_lo;
+    uint32_t dirty_hi;
+    int err;
+
+    struct rt_mutex lock;
+
+    rt_thread_t eraser;
+    struct rt_semaphore erase_sem;
+    volatile rt_bool_t running;
+    uint32_t ahead_pos;                 /* next block for the erase thread */
+    uint32_t ahead_end;
+
+    struct fal_wbuf_stats stats;
+    rt_slist_t node;                    /* on wbuf_list */
+};
+
+/* the open buffers, for fal_wbuf_invalidate() */
+static rt_slist_t wbuf_list = RT_SLIST_OBJECT_INIT(wbuf_list);
+static struct rt_mutex wbuf_list_lock;
+static rt_bool_t wbuf_list_ready = RT_FALSE;
+
+#define BIT_GET(map, n)                 ((map)[(n) / 32] & (1UL << ((n) % 32)))
+#define BIT_SET(map, n)                 ((map)[(n) / 32] |= (1UL << ((n) % 32)))
+#define BIT_CLR(map, n)                 ((map)[(n) / 32] &= ~(1UL << ((n) % 32)))
+
+static int wbuf_program(struct fal_wbuf *wbuf, uint32_t addr, const uint8_t *buf, size_t size)
+{
+    uint32_t blk;
+
+    wbuf->stats.programs++;
+    wbuf->stats.program_bytes += size;
+    for (blk = addr / wbuf->blk_size; blk <= (addr + size - 1) / wbuf->blk_size; blk++)
+    {
+        /* holds data now, the erase thread must not touch it */
+        BIT_CLR(wbuf->blank, blk);
+        BIT_SET(wbuf->ready, blk);
+    }
+
+    if (wbuf->flash->ops.write(wbuf->base + addr, buf, size) < 0)
+    {
+        log_e("Write buffer program error! Flash device(%s) address 0x%08x.", wbuf->flash->name, addr);
+        return -1;
+    }
+    return 0;
+}
+
+/* read the block back, a blank one needs no erase */
+static rt_bool_t wbuf_blank_check(struct fal_wbuf *wbuf, uint32_t blk)
+{
+    uint32_t addr = blk * wbuf->blk_size, end = addr + wbuf->blk_size;
+    uint32_t chunk[64];
+    size_t i;
+
+    wbuf->stats.blank_checks++;
+    for (; addr < end; addr += sizeof(chunk))
+    {
+        if (wbuf->flash->ops.read(wbuf->base + addr, (uint8_t *)chunk, sizeof(chunk)) < 0)
+        {
+            return RT_FALSE;
+        }
+        for (i = 0; i < sizeof(chunk) / sizeof(chunk[0]); i++)
+        {
+            if (chunk[i] != 0xFFFFFFFFUL)
+            {
+                return RT_FALSE;
+            }
+        }
+    }
+    return RT_TRUE;
+}
+
+/* make the block blank, called with the lock held */
+static int wbuf_blank_block(struct fal_wbuf *wbuf, uint32_t blk)
+{
+    if (BIT_GET(wbuf->blank, blk) || wbuf_blank_check(wbuf, blk))
+    {
+        wbuf->stats.erase_skipped++;
+        BIT_SET(wbuf->blank, blk);
+        return 0;
+    }
+
+    wbuf->stats.erases++;
+    if (wbuf->flash->ops.erase(wbuf->base + blk * wbuf->blk_size, wbuf->blk_size) < 0)
+    {
+        log_e("Write buffer erase error! Flash device(%s) block %d.", wbuf->flash->name, blk);
+        return -1;
+    }
+    BIT_SET(wbuf->blank, blk);
+    return 0;
+}
+
+/* with FAL_WBUF_AUTO_ERASE the first write into a block erases it */
+static int wbuf_prepare(struct fal_wbuf *wbuf, uint32_t addr, size_t size)
+{
+    uint32_t blk;
+
+    if (!(wbuf->flags & FAL_WBUF_AUTO_ERASE))
+    {
+        return 0;
+    }
+
+    for (blk = addr / wbuf->blk_size; blk <= (addr + size - 1) / wbuf->blk_size; blk++)
+    {
+        if (BIT_GET(wbuf->ready, blk))
+        {
+            continue;
+        }
+        if (wbuf_blank_block(wbuf, blk) < 0)
+        {
+            return -1;
+        }
+        BIT_SET(wbuf->ready, blk);
+    }
+    return 0;
+}
+
+static void wbuf_attach(struct fal_wbuf *wbuf)
+{
+    rt_mutex_init(&wbuf->lock, "fal_wb", RT_IPC_FLAG_PRIO);
+    rt_sem_init(&wbuf->erase_sem, "fal_wb", 0, RT_IPC_FLAG_PRIO);
+
+    rt_mutex_take(&wbuf_list_lock, RT_WAITING_FOREVER);
+    rt_slist_append(&wbuf_list, &wbuf->node);
+    rt_mutex_release(&wbuf_list_lock);
+}
+
+static void wbuf_detach(struct fal_wbuf *wbuf)
+{
+    rt_mutex_take(&wbuf_list_lock, RT_WAITING_FOREVER);
+    rt_slist_remove(&wbuf_list, &wbuf->node);
+    rt_mutex_release(&wbuf_list_lock);
+
+    rt_sem_detach(&wbuf->erase_sem);
+    rt_mutex_detach(&wbuf->lock);
+}
+
+/* called by fal_init() */
+void fal_wbuf_init(void)
+{
+    if (!wbuf_list_ready)
+    {
+        rt_mutex_init(&wbuf_list_lock, "fal_wbl", RT_IPC_FLAG_PRIO);
+        wbuf_list_ready = RT_TRUE;
+    }
+}
+
+/*
+ * Called by fal_partition_write() and fal_partition_erase() after they
+ * changed [offset, offset + size) of the flash device: the blocks are no
+ * longer known blank nor prepared by the buffer. Data still in a buffered
+ * page is kept.
+ */
+void fal_wbuf_invalidate(const struct fal_flash_dev *flash, long offset, size_t size)
+{
+    struct fal_wbuf *wbuf;
+    rt_slist_t *node;
+    long from, to;
+    uint32_t blk, last;
+
+    if (!wbuf_list_ready || size == 0)
+    {
+        return;
+    }
+
+    rt_mutex_take(&wbuf_list_lock, RT_WAITING_FOREVER);
+    rt_slist_for_each(node, &wbuf_list)
+    {
+        wbuf = rt_slist_entry(node, struct fal_wbuf, node);
+        from = offset > wbuf->base ? offset : wbuf->base;
+        to = offset + (long)size < wbuf->base + (long)wbuf->len ? offset + (long)size : wbuf->base + (long)wbuf->len;
+        if (wbuf->flash != flash || from >= to)
+        {
+            continue;
+        }
+
+        rt_mutex_take(&wbuf->lock, RT_WAITING_FOREVER);
+        last = (to - 1 - wbuf->base) / wbuf->blk_size;
+        for (blk = (from - wbuf->base) / wbuf->blk_size; blk <= last; blk++)
+        {
+            BIT_CLR(wbuf->blank, blk);
+            BIT_CLR(wbuf->ready, blk);
+        }
+        rt_mutex_release(&wbuf->lock);
+    }
+    rt_mutex_release(&wbuf_list_lock);
+}
+
+static int wbuf_flush_page(struct fal_wbuf *wbuf)
+{
+    int ret = 0;
+
+    if (wbuf->page_addr != FAL_WBUF_NO_PAGE && wbuf->dirty_hi > wbuf->dirty_lo)
+    {
+        ret = wbuf_program(wbuf, wbuf->page_addr + wbuf->dirty_lo, wbuf->page + wbuf->dirty_lo,
+                           wbuf->dirty_hi - wbuf->dirty_lo);
+    }
+    wbuf->page_addr = FAL_WBUF_NO_PAGE;
+    return ret;
+}
+
+fal_wbuf_t fal_wbuf_open(const struct fal_partition *part, uint32_t flags)
+{
+    const struct fal_flash_dev *flash;
+    struct fal_wbuf *wbuf;
+    uint32_t words;
+
+    assert(part);
+
+    flash = fal_flash_device_find(part->flash_name);
+    if (flash == NULL || flash->blk_size == 0 || part->offset % flash->blk_size != 0)
+    {
+        log_e("Write buffer open error! Partition(%s) is not aligned to the flash blocks.", part->name);
+        return NULL;
+    }
+
+    wbuf = (struct fal_wbuf *)FAL_CALLOC(1, sizeof(struct fal_wbuf));
+    if (wbuf == NULL)
+    {
+        return NULL;
+    }
+    wbuf->flash = flash;
+    wbuf->base = part->offset;
+    wbuf->len = part->len;
+    wbuf->blk_size = flash->blk_size;
+    wbuf->flags = flags;
+    wbuf->page_addr = FAL_WBUF_NO_PAGE;
+
+    words = (wbuf->len / wbuf->blk_size + 31) / 32;
+    wbuf->blank = (uint32_t *)FAL_CALLOC(words * 2, sizeof(uint32_t));
+    if (wbuf->blank == NULL)
+    {
+        FAL_FREE(wbuf);
+        return NULL;
+    }
+    wbuf->ready = wbuf->blank + words;
+    wbuf_attach(wbuf);
+
+    return wbuf;
+}
+
+int fal_wbuf_write(fal_wbuf_t wbuf, uint32_t addr, const uint8_t *buf, size_t size)
+{
+    uint32_t page, off, n, i;
+    size_t total = size;
+
+    assert(wbuf);
+    assert(buf);
+
+    if (addr + size > wbuf->len)
+    {
+        log_e("Write buffer write error! Partition address out of bound.");
+        return -1;
+    }
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    rt_mutex_take(&wbuf->lock, RT_WAITING_FOREVER);
+    wbuf->stats.writes++;
+    wbuf->stats.write_bytes += size;
+
+    if (wbuf_prepare(wbuf, addr, size) < 0)
+    {
+        goto __error;
+    }
+
+    while (size)
+    {
+        page = addr & ~(FAL_WBUF_PAGE_SIZE - 1);
+        off = addr - page;
+
+        if (page != wbuf->page_addr)
+        {
+            if (wbuf_flush_page(wbuf) < 0)
+            {
+                goto __error;
+            }
+
+            /* whole pages with nothing buffered skip the copy */
+            if (off == 0 && size >= FAL_WBUF_PAGE_SIZE)
+            {
+                n = size & ~(FAL_WBUF_PAGE_SIZE - 1);
+                if (wbuf_program(wbuf, addr, buf, n) < 0)
+                {
+                    goto __error;
+                }
+                addr += n;
+                buf += n;
+                size -= n;
+                continue;
+            }
+
+            rt_memset(wbuf->page, 0xFF, FAL_WBUF_PAGE_SIZE);
+            wbuf->page_addr = page;
+            wbuf->dirty_lo = FAL_WBUF_PAGE_SIZE;
+            wbuf->dirty_hi = 0;
+        }
+
+        n = FAL_WBUF_PAGE_SIZE - off;
+        if (n > size)
+        {
+            n = size;
+        }
+        for (i = 0; i < n; i++)
+        {
+            wbuf->page[off + i] &= buf[i];
+        }
+        if (off < wbuf->dirty_lo)
+        {
+            wbuf->dirty_lo = off;
+        }
+        if (off + n > wbuf->dirty_hi)
+        {
+            wbuf->dirty_hi = off + n;
+        }
+        addr += n;
+        buf += n;
+        size -= n;
+
+        /* a sequential writer reached the end of the page */
+        if (wbuf->dirty_hi == FAL_WBUF_PAGE_SIZE && wbuf_flush_page(wbuf) < 0)
+        {
+            goto __error;
+        }
+    }
+
+    rt_mutex_release(&wbuf->lock);
+    return total;
+
+__error:
+    wbuf->err = -1;
+    rt_mutex_release(&wbuf->lock);
+    return -1;
+}
+
+int fal_wbuf_read(fal_wbuf_t wbuf, uint32_t addr, uint8_t *buf, size_t size)
+{
+    uint32_t from, to, i;
+
+    assert(wbuf);
+    assert(buf);
+
+    if (addr + size > wbuf->len)
+    {
+        log_e("Write buffer read error! Partition address out of bound.");
+        return -1;
+    }
+
+    rt_mutex_take(&wbuf->lock, RT_WAITING_FOREVER);
+    if (wbuf->flash->ops.read(wbuf->base + addr, buf, size) < 0)
+    {
+        rt_mutex_release(&wbuf->lock);
+        return -1;
+    }
+
+    /* what the flash will hold once the page is programmed */
+    if (wbuf->page_addr != FAL_WBUF_NO_PAGE)
+    {
+        from = addr > wbuf->page_addr ? addr : wbuf->page_addr;
+        to = addr + size < wbuf->page_addr + FAL_WBUF_PAGE_SIZE ? addr + size : wbuf->page_addr + FAL_WBUF_PAGE_SIZE;
+        for (i = from; i < to; i++)
+        {
+            buf[i - addr] &= wbuf->page[i - wbuf->page_addr];
+        }
+    }
+    rt_mutex_release(&wbuf->lock);
+
+    return size;
+}
+
+int fal_wbuf_erase(fal_wbuf_t wbuf, uint32_t addr, size_t size)
+{
+    uint32_t blk, last;
+    int ret = 0;
+
+    assert(wbuf);
+
+    if (addr + size > wbuf->len)
+    {
+        log_e("Write buffer erase error! Partition address out of bound.");
+        return -1;
+    }
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    rt_mutex_take(&wbuf->lock, RT_WAITING_FOREVER);
+    /* the buffered page may belong to the erased range */
+    if (wbuf_flush_page(wbuf) < 0)
+    {
+        ret = -1;
+    }
+    last = (addr + size - 1) / wbuf->blk_size;
+    for (blk = addr / wbuf->blk_size; ret == 0 && blk <= last; blk++)
+    {
+        if (wbuf_blank_block(wbuf, blk) < 0)
+        {
+            ret = -1;
+        }
+        else
+        {
+            BIT_SET(wbuf->ready, blk);
+        }
+    }
+    rt_mutex_release(&wbuf->lock);
+
+    return ret < 0 ? -1 : (int)size;
+}
+
+static void wbuf_erase_entry(void *parameter)
+{
+    struct fal_wbuf *wbuf = (struct fal_wbuf *)parameter;
+
+    while (wbuf->running)
+    {
+        rt_sem_take(&wbuf->erase_sem, RT_WAITING_FOREVER);
+
+        while (wbuf->running)
+        {
+            rt_mutex_take(&wbuf->lock, RT_WAITING_FOREVER);
+            if (wbuf->ahead_pos >= wbuf->ahead_end)
+            {
+                rt_mutex_release(&wbuf->lock);
+                break;
+            }
+            /* a block the writer has already started is left alone */
+            if (!BIT_GET(wbuf->ready, wbuf->ahead_pos) &&
+                (wbuf->page_addr == FAL_WBUF_NO_PAGE || wbuf->page_addr / wbuf->blk_size != wbuf->ahead_pos))
+            {
+                wbuf_blank_block(wbuf, wbuf->ahead_pos);
+            }
+            wbuf->ahead_pos++;
+            rt_mutex_release(&wbuf->lock);
+        }
+    }
+
+    wbuf->eraser = RT_NULL;
+}
+
+int fal_wbuf_erase_ahead(fal_wbuf_t wbuf, uint32_t addr, size_t size)
+{
+    assert(wbuf);
+
+    if (addr + size > wbuf->len)
+    {
+        log_e("Write buffer erase error! Partition address out of bound.");
+        return -1;
+    }
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    rt_mutex_take(&wbuf->lock, RT_WAITING_FOREVER);
+    if (wbuf->eraser == RT_NULL)
+    {
+        wbuf->running = RT_TRUE;
+        wbuf->eraser = rt_thread_create("fal_era", wbuf_erase_entry, wbuf,
+                                        FAL_WBUF_ERASE_THREAD_STACK, FAL_WBUF_ERASE_THREAD_PRIORITY, 10);
+        if (wbuf->eraser == RT_NULL)
+        {
+            wbuf->running = RT_FALSE;
+            rt_mutex_release(&wbuf->lock);
+            return -1;
+        }
+        rt_thread_startup(wbuf->eraser);
+    }
+    /* a new range replaces the rest of the old one */
+    wbuf->ahead_pos = addr / wbuf->blk_size;
+    wbuf->ahead_end = (addr + size - 1) / wbuf->blk_size + 1;
+    rt_mutex_release(&wbuf->lock);
+
+    rt_sem_release(&wbuf->erase_sem);
+    return 0;
+}
+
+int fal_wbuf_flush(fal_wbuf_t wbuf)
+{
+    int ret;
+
+    assert(wbuf);
+
+    rt_mutex_take(&wbuf->lock, RT_WAITING_FOREVER);
+    ret = wbuf_flush_page(wbuf);
+    if (ret < 0)
+    {
+        wbuf->err = -1;
+    }
+    rt_mutex_release(&wbuf->lock);
+
+    return ret;
+}
+
+int fal_wbuf_close(fal_wbuf_t wbuf)
+{
+    int ret;
+
+    assert(wbuf);
+
+    if (wbuf->eraser)
+    {
+        wbuf->running = RT_FALSE;
+        rt_sem_release(&wbuf->erase_sem);
+        /* the thread clears eraser when it leaves */
+        while (wbuf->eraser != RT_NULL)
+        {
+            rt_thread_mdelay(10);
+        }
+    }
+
+    ret = fal_wbuf_flush(wbuf) < 0 || wbuf->err < 0 ? -1 : 0;
+
+    wbuf_detach(wbuf);
+    FAL_FREE(wbuf->blank);
+    FAL_FREE(wbuf);
+
+    return ret;
+}
+
+void fal_wbuf_get_stats(fal_wbuf_t wbuf, struct fal_wbuf_stats *stats)
+{
+    assert(wbuf);
+
+    rt_mutex_take(&wbuf->lock, RT_WAITING_FOREVER);
+    *stats = wbuf->stats;
+    rt_mutex_release(&wbuf->lock);
+}
+
+#if (defined(RT_USING_FINSH) && defined(FINSH_USING_MSH)) || defined(FAL_WBUF_HOST)
+
+#define FAL_WBUF_SIM_BLK_SIZE           4096
+#define FAL_WBUF_SIM_SIZE               (16 * FAL_WBUF_SIM_BLK_SIZE)
+#define FAL_WBUF_BENCH_SIZE             (256 * 1024)
+
+/*
+ * A flash device in RAM that enforces the NOR rules: programming can only
+ * clear bits, erase works on whole aligned blocks. It counts the page
+ * program operations the data would need on a real NOR flash.
+ */
+static uint8_t *sim_mem;
+static uint32_t sim_page_programs, sim_erases, sim_violations;
+
+static int sim_read(long offset, uint8_t *buf, size_t size)
+{
+    rt_memcpy(buf, sim_mem + offset, size);
+    return size;
+}
+
+static int sim_write(long offset, const uint8_t *buf, size_t size)
+{
+    size_t i;
+
+    sim_page_programs += (offset + size - 1) / FAL_WBUF_PAGE_SIZE - offset / FAL_WBUF_PAGE_SIZE + 1;
+    for (i = 0; i < size; i++)
+    {
+        if ((sim_mem[offset + i] & buf[i]) != buf[i])
+        {
+            sim_violations++;
+        }
+        sim_mem[offset + i] &= buf[i];
+    }
+    return size;
+}
+
+static int sim_erase(long offset, size_t size)
+{
+    if (offset % FAL_WBUF_SIM_BLK_SIZE || size % FAL_WBUF_SIM_BLK_SIZE)
+    {
+        sim_violations++;
+        return -1;
+    }
+    sim_erases += size / FAL_WBUF_SIM_BLK_SIZE;
+    rt_memset(sim_mem + offset, 0xFF, size);
+    return size;
+}
+
+static struct fal_flash_dev sim_flash =
+{
+    .name = "wbuf_sim",
+    .addr = 0,
+    .len = FAL_WBUF_SIM_SIZE,
+    .blk_size = FAL_WBUF_SIM_BLK_SIZE,
+    .ops = { NULL, sim_read, sim_write, sim_erase },
+    .write_gran = 1,
+};
+
+static void sim_reset(uint8_t *expect, uint32_t seed)
+{
+    uint32_t i;
+
+    /* even blocks hold old data, odd blocks are blank */
+    srand(seed);
+    for (i = 0; i < FAL_WBUF_SIM_SIZE; i++)
+    {
+        sim_mem[i] = (i / FAL_WBUF_SIM_BLK_SIZE) & 1 ? 0xFF : rand();
+        expect[i] = rand();
+    }
+    sim_page_programs = sim_erases = sim_violations = 0;
+}
+
+static struct fal_wbuf *sim_open(uint32_t flags)
+{
+    struct fal_wbuf *wbuf = (struct fal_wbuf *)FAL_CALLOC(1, sizeof(struct fal_wbuf));
+    uint32_t words = (FAL_WBUF_SIM_SIZE / FAL_WBUF_SIM_BLK_SIZE + 31) / 32;
+
+    if (wbuf == NULL)
+    {
+        return NULL;
+    }
+    wbuf->blank = (uint32_t *)FAL_CALLOC(words * 2, sizeof(uint32_t));
+    if (wbuf->blank == NULL)
+    {
+        FAL_FREE(wbuf);
+        return NULL;
+    }
+    wbuf->ready = wbuf->blank + words;
+    wbuf->flash = &sim_flash;
+    wbuf->len = FAL_WBUF_SIM_SIZE;
+    wbuf->blk_size = FAL_WBUF_SIM_BLK_SIZE;
+    wbuf->flags = flags;
+    wbuf->page_addr = FAL_WBUF_NO_PAGE;
+    wbuf_attach(wbuf);
+    return wbuf;
+}
+
+/* write the whole simulated flash in random small pieces, in order */
+static int sim_stream(struct fal_wbuf *wbuf, const uint8_t *expect, rt_bool_t buffered)
+{
+    uint32_t addr, n;
+    uint8_t check[64];
+
+    for (addr = 0; addr < FAL_WBUF_SIM_SIZE; addr += n)
+    {
+        n = rand() % 48 + 1;
+        if (addr + n > FAL_WBUF_SIM_SIZE)
+        {
+            n = FAL_WBUF_SIM_SIZE - addr;
+        }
+        if (buffered)
+        {
+            if (fal_wbuf_write(wbuf, addr, expect + addr, n) != (int)n ||
+                fal_wbuf_read(wbuf, addr, check, n) != (int)n || rt_memcmp(check, expect + addr, n))
+            {
+                return -1;
+            }
+        }
+        else if (sim_write(addr, expect + addr, n) != (int)n)
+        {
+            return -1;
+        }
+    }
+    return buffered ? fal_wbuf_flush(wbuf) : 0;
+}
+
+/* returns 0 when all the cases pass */
+static int fal_wbuf_check(void)
+{
+    struct fal_wbuf *wbuf;
+    uint8_t *expect;
+    uint32_t pass = 0, blk;
+
+    sim_mem = (uint8_t *)rt_malloc(FAL_WBUF_SIM_SIZE);
+    expect = (uint8_t *)rt_malloc(FAL_WBUF_SIM_SIZE);
+    if (sim_mem == NULL || expect == NULL)
+    {
+        rt_kprintf("No memory for the simulated flash.\n");
+        goto __exit;
+    }
+
+    /* unbuffered: erase everything, then one driver write per piece */
+    sim_reset(expect, 1);
+    sim_erase(0, FAL_WBUF_SIM_SIZE);
+    sim_stream(NULL, expect, RT_FALSE);
+    rt_kprintf("direct     : %5u page programs, %2u erases, %u violations\n",
+               sim_page_programs, sim_erases, sim_violations);
+
+    /* buffered with erase on first write */
+    sim_reset(expect, 1);
+    wbuf = sim_open(FAL_WBUF_AUTO_ERASE);
+    if (wbuf && sim_stream(wbuf, expect, RT_TRUE) == 0 && sim_violations == 0 &&
+        rt_memcmp(sim_mem, expect, FAL_WBUF_SIM_SIZE) == 0 &&
+        sim_erases == FAL_WBUF_SIM_SIZE / FAL_WBUF_SIM_BLK_SIZE / 2)
+    {
+        pass++;
+    }
+    rt_kprintf("auto erase : %5u page programs, %2u erases, %u violations\n",
+               sim_page_programs, sim_erases, sim_violations);
+    if (wbuf)
+    {
+        fal_wbuf_close(wbuf);
+    }
+
+    /* erase ahead in the background, then explicit erases find the blocks blank */
+    sim_reset(expect, 2);
+    wbuf = sim_open(0);
+    if (wbuf && fal_wbuf_erase_ahead(wbuf, 0, FAL_WBUF_SIM_SIZE) == 0)
+    {
+        while (wbuf->ahead_pos < wbuf->ahead_end)
+        {
+            rt_thread_mdelay(1);
+        }
+        if (fal_wbuf_erase(wbuf, 0, FAL_WBUF_SIM_SIZE) == FAL_WBUF_SIM_SIZE &&
+            sim_stream(wbuf, expect, RT_TRUE) == 0 && sim_violations == 0 &&
+            rt_memcmp(sim_mem, expect, FAL_WBUF_SIM_SIZE) == 0 &&
+            wbuf->stats.erases == FAL_WBUF_SIM_SIZE / FAL_WBUF_SIM_BLK_SIZE / 2 &&
+            wbuf->stats.erase_skipped == FAL_WBUF_SIM_SIZE / FAL_WBUF_SIM_BLK_SIZE * 3 / 2)
+        {
+            pass++;
+        }
+    }
+    rt_kprintf("erase ahead: %5u page programs, %2u erases, %u violations\n",
+               sim_page_programs, sim_erases, sim_violations);
+    if (wbuf)
+    {
+        fal_wbuf_close(wbuf);
+    }
+
+    /*
+     * a plain partition write into a block the buffer has prepared: the
+     * block must be erased again before the buffer programs it
+     */
+    sim_reset(expect, 3);
+    blk = 2;
+    wbuf = sim_open(FAL_WBUF_AUTO_ERASE);
+    if (wbuf && sim_stream(wbuf, expect, RT_TRUE) == 0)
+    {
+        rt_memset(sim_mem + blk * FAL_WBUF_SIM_BLK_SIZE, 0x00, FAL_WBUF_SIM_BLK_SIZE / 2);
+        fal_wbuf_invalidate(&sim_flash, blk * FAL_WBUF_SIM_BLK_SIZE, FAL_WBUF_SIM_BLK_SIZE / 2);
+        if (fal_wbuf_write(wbuf, blk * FAL_WBUF_SIM_BLK_SIZE, expect + blk * FAL_WBUF_SIM_BLK_SIZE,
+                           FAL_WBUF_SIM_BLK_SIZE) == FAL_WBUF_SIM_BLK_SIZE &&
+            fal_wbuf_flush(wbuf) == 0 && sim_violations == 0 &&
+            rt_memcmp(sim_mem, expect, FAL_WBUF_SIM_SIZE) == 0)
+        {
+            pass++;
+        }
+    }
+    rt_kprintf("raw write  : %5u page programs, %2u erases, %u violations\n",
+               sim_page_programs, sim_erases, sim_violations);
+    if (wbuf)
+    {
+        fal_wbuf_close(wbuf);
+    }
+
+    rt_kprintf("Write buffer check %s.\n", pass == 3 ? "passed" : "FAILED");
+
+__exit:
+    rt_free(expect);
+    rt_free(sim_mem);
+    sim_mem = NULL;
+    return pass == 3 ? 0 : -1;
+}
+#endif /* (RT_USING_FINSH && FINSH_USING_MSH) || FAL_WBUF_HOST */
+
+#if defined(RT_USING_FINSH) && defined(FINSH_USING_MSH)
+
+#include <finsh.h>
+
+/* the same small writes straight to the partition and through the buffer */
+static void fal_wbuf_bench(const struct fal_partition *part, uint32_t chunk)
+{
+    struct fal_wbuf_stats stats;
+    uint32_t size = part->len < FAL_WBUF_BENCH_SIZE ? part->len : FAL_WBUF_BENCH_SIZE;
+    uint32_t addr, n, start, direct_ms;
+    fal_wbuf_t wbuf;
+    uint8_t *data;
+
+    data = (uint8_t *)rt_malloc(chunk);
+    if (data == NULL)
+    {
+        return;
+    }
+    for (n = 0; n < chunk; n++)
+    {
+        data[n] = n;
+    }
+
+    start = rt_tick_get_millisecond();
+    fal_partition_erase(part, 0, size);
+    for (addr = 0; addr < size; addr += n)
+    {
+        n = size - addr < chunk ? size - addr : chunk;
+        if (fal_partition_write(part, addr, data, n) < 0)
+        {
+            break;
+        }
+    }
+    direct_ms = rt_tick_get_millisecond() - start;
+    rt_kprintf("direct  : %u KB in %u B writes, %u ms, %u driver writes\n",
+               size / 1024, chunk, direct_ms, (size + chunk - 1) / chunk);
+
+    wbuf = fal_wbuf_open(part, FAL_WBUF_AUTO_ERASE);
+    if (wbuf == NULL)
+    {
+        rt_free(data);
+        return;
+    }
+    start = rt_tick_get_millisecond();
+    fal_wbuf_erase_ahead(wbuf, 0, size);
+    for (addr = 0; addr < size; addr += n)
+    {
+        n = size - addr < chunk ? size - addr : chunk;
+        if (fal_wbuf_write(wbuf, addr, data, n) < 0)
+        {
+            break;
+        }
+    }
+    fal_wbuf_flush(wbuf);
+    fal_wbuf_get_stats(wbuf, &stats);
+    rt_kprintf("buffered: %u KB in %u B writes, %u ms, %u driver writes, %u erases, %u blank skipped\n",
+               size / 1024, chunk, rt_tick_get_millisecond() - start, stats.programs,
+               stats.erases, stats.erase_skipped);
+    fal_wbuf_close(wbuf);
+    rt_free(data);
+}
+
+static void fal_wbuf(int argc, char **argv)
+{
+    const struct fal_partition *part;
+
+    if (argc == 2 && !strcmp(argv[1], "check"))
+    {
+        fal_wbuf_check();
+    }
+    else if (argc >= 4 && !strcmp(argv[1], "bench") && !strcmp(argv[argc - 1], "yes"))
+    {
+        part = fal_partition_find(argv[2]);
+        if (part == NULL)
+        {
+            rt_kprintf("Partition %s not found.\n", argv[2]);
+            return;
+        }
+        fal_wbuf_bench(part, argc > 4 ? strtol(argv[3], NULL, 0) : 32);
+    }
+    else
+    {
+        rt_kprintf("Usage: fal_wbuf check                          - check on a simulated NOR flash in RAM\n");
+        rt_kprintf("       fal_wbuf bench <part_name> [size] yes   - compare small writes, ERASES the partition\n");
+    }
+}
+MSH_CMD_EXPORT(fal_wbuf, FAL write buffer check and benchmark);
+
+#endif /* defined(RT_USING_FINSH) && defined(FINSH_USING_MSH) */
+
+#ifdef FAL_WBUF_HOST
+int main(void)
+{
+    fal_wbuf_init();
+    return fal_wbuf_check() == 0 ? 0 : 1;
+}
+#endif /* FAL_WBUF_HOST */
+
+#endif /* FAL_USING_WRITE_BUFFER */
@@ -7,6 +7,15 @@
  * Date           Author            Notes
  * 2017/11/30     Bernard           The first version.
  * 2024/03/29     TroyMitchelle     Add all function comments
+ * 2025/02/20     RT-Thread         Map in place, share read only copies, msync
+ */
+
+/*
+ * mmap without MMU. A read only mapping of a file system that keeps its
+ * files in memory (RT_FIOGETADDR, e.g. romfs) points into the file system
+ * itself. Otherwise the range is copied into the heap, read only copies of
+ * the same file range are shared by all the mappings, and MAP_SHARED
+ * writable copies are written back to the file by msync() and munmap().
  */
 
 #include <stdint.h>
@@ -15,12 +24,145 @@
 #include <rtthread.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
 #include <sys/errno.h>
+#include <sys/ioctl.h>
+
+#ifdef RT_USING_DFS
+#include <dfs_file.h>
+#ifdef RT_USING_DFS_V2
+#include <dfs.h>
+#include <dfs_dentry.h>
+#endif
+#endif
 
 #include "sys/mman.h"
 
+/* the heap copies are aligned for the DMA of the block drivers */
+#define MMAN_ALIGN      32
+
+struct mman_region
+{
+    rt_list_t list;
+    void *addr;
+    size_t length;
+    rt_bool_t in_place;         /* memory of the file system, not freed */
+    int fd;                     /* dup of the file for a MAP_SHARED writable copy, -1 if none */
+    off_t offset;
+    char *path;                 /* set for a shared read only copy */
+    int ref;
+};
+
+static rt_list_t _regions = RT_LIST_OBJECT_INIT(_regions);
+static struct rt_mutex _regions_lock;
+static rt_bool_t _regions_inited = RT_FALSE;
+
+static void _regions_take(void)
+{
+    if (_regions_inited == RT_FALSE)
+    {
+        rt_enter_critical();
+        if (_regions_inited == RT_FALSE)
+        {
+            rt_mutex_init(&_regions_lock, "mman", RT_IPC_FLAG_PRIO);
+            _regions_inited = RT_TRUE;
+        }
+        rt_exit_critical();
+    }
+    rt_mutex_take(&_regions_lock, RT_WAITING_FOREVER);
+}
+
+static void _regions_release(void)
+{
+    rt_mutex_release(&_regions_lock);
+}
+
+static struct mman_region *_region_find(void *addr)
+{
+    struct mman_region *region;
+
+    rt_list_for_each_entry(region, &_regions, list)
+    {
+        if ((uint8_t *)addr >= (uint8_t *)region->addr &&
+            (uint8_t *)addr < (uint8_t *)region->addr + region->length)
+        {
+            return region;
+        }
+    }
+    return RT_NULL;
+}
+
+/* the full path of an open file, for sharing the copies; RT_NULL when unknown */
+static char *_file_path(int fd)
+{
+    char *path = RT_NULL;
+#if defined(RT_USING_DFS) && defined(RT_USING_DFS_V2)
+    struct dfs_file *file = fd_get(fd);
+
+    if (file && file->dentry)
+    {
+        path = dfs_dentry_full_path(file->dentry);
+    }
+#endif
+    return path;
+}
+
+/* keep the file for the write back, POSIX lets the caller close it after mmap() */
+static int _file_hold(int fd)
+{
+#if defined(RT_USING_DFS) && defined(RT_USING_DFS_V2)
+    return dfs_dup(fd, DFS_STDIO_OFFSET);
+#else
+    /* no dup() here, the caller keeps the file open until munmap() */
+    return fd;
+#endif
+}
+
+static void _file_drop(int fd)
+{
+#if defined(RT_USING_DFS) && defined(RT_USING_DFS_V2)
+    close(fd);
+#endif
+}
+
+static int _read_at(int fd, void *buf, size_t length, off_t offset)
+{
+    off_t cur;
+    ssize_t bytes;
+
+    cur = lseek(fd, 0, SEEK_CUR);
+    if (lseek(fd, offset, SEEK_SET) != offset)
+    {
+        return -1;
+    }
+    bytes = read(fd, buf, length);
+    lseek(fd, cur, SEEK_SET);
+
+    return bytes == (ssize_t)length ? 0 : -1;
+}
+
+static int _write_back(struct mman_region *region, void *addr, size_t length)
+{
+    off_t cur, offset;
+    ssize_t bytes;
+
+    if (region->fd < 0)
+    {
+        return 0;
+    }
+
+    offset = region->offset + ((uint8_t *)addr - (uint8_t *)region->addr);
+    cur = lseek(region->fd, 0, SEEK_CUR);
+    lseek(region->fd, offset, SEEK_SET);
+    bytes = write(region->fd, addr, length);
+    lseek(region->fd, cur, SEEK_SET);
+    fsync(region->fd);
+
+    return bytes == (ssize_t)length ? 0 : -1;
+}
+
 /**
  * @brief   Maps a region of memory into the calling process's address space.
  * @param   addr    Desired starting address of the mapping.
@@ -34,40 +176,137 @@
 void *mmap(void *addr, size_t length, int prot, int flags,
     int fd, off_t offset)
 {
-    uint8_t *mem;
+    struct mman_region *region;
+    rt_bool_t shared_write;
+    char *path = RT_NULL;
+    uint8_t *mem = RT_NULL;
+
+    if (length == 0 || offset < 0)
+    {
+        errno = EINVAL;
+        return MAP_FAILED;
+    }
 
     if (addr)
     {
-        mem = addr;
+        /* the caller's memory, just a copy of the file */
+        if (_read_at(fd, addr, length, offset) != 0)
+        {
+            errno = EIO;
+            return MAP_FAILED;
+        }
+        return addr;
     }
-    else mem = (uint8_t *)malloc(length);
 
-    if (mem)
+    shared_write = (prot & PROT_WRITE) && (flags & MAP_TYPE) == MAP_SHARED;
+
+    region = (struct mman_region *)rt_calloc(1, sizeof(struct mman_region));
+    if (region == RT_NULL)
     {
-        off_t cur;
-        size_t read_bytes;
+        errno = ENOMEM;
+        return MAP_FAILED;
+    }
+    region->fd = -1;
+    region->offset = offset;
+    region->length = length;
+    region->ref = 1;
 
-        cur = lseek(fd, 0, SEEK_SET);
+    _regions_take();
 
-        lseek(fd, offset, SEEK_SET);
-        read_bytes = read(fd, mem, length);
-        if (read_bytes != length)
+#ifdef RT_USING_DFS
+    /* a file system in memory, read only mappings point into it */
+    if (!(prot & PROT_WRITE))
+    {
+        struct stat st;
+
+        if (ioctl(fd, RT_FIOGETADDR, &mem) == 0 && mem &&
+            fstat(fd, &st) == 0 && offset + (off_t)length <= st.st_size)
         {
-            if (addr == RT_NULL)
+            region->addr = mem + offset;
+            region->in_place = RT_TRUE;
+            goto __insert;
+        }
+        mem = RT_NULL;
+    }
+#endif
+
+    if (!(prot & PROT_WRITE))
+    {
+        /* another read only copy of the same range */
+        path = _file_path(fd);
+        if (path)
+        {
+            struct mman_region *copy;
+
+            rt_list_for_each_entry(copy, &_regions, list)
             {
-                /* read failed */
-                free(mem);
-                mem = RT_NULL;
+                if (copy->path && copy->offset == offset && copy->length == length &&
+                    strcmp(copy->path, path) == 0)
+                {
+                    copy->ref++;
+                    _regions_release();
+                    rt_free(path);
+                    rt_free(region);
+                    return copy->addr;
+                }
             }
         }
-        lseek(fd, cur, SEEK_SET);
+    }
 
-        return mem;
+    mem = (uint8_t *)rt_malloc_align(length, MMAN_ALIGN);
+    if (mem == RT_NULL || _read_at(fd, mem, length, offset) != 0)
+    {
+        _regions_release();
+        errno = mem ? EIO : ENOMEM;
+        if (mem)
+            rt_free_align(mem);
+        rt_free(path);
+        rt_free(region);
+        return MAP_FAILED;
+    }
+    region->addr = mem;
+    region->path = path;
+    if (shared_write)
+    {
+        region->fd = _file_hold(fd);
     }
 
-    errno = ENOMEM;
+__insert:
+    rt_list_insert_after(&_regions, &region->list);
+    _regions_release();
+
+    return region->addr;
+}
+
+/**
+ * @brief   Writes a MAP_SHARED writable mapping back to its file.
+ * @param   addr    Address inside the mapping.
+ * @param   length  Length to write back.
+ * @param   flags   MS_ASYNC, MS_SYNC or MS_INVALIDATE, all write synchronously.
+ * @return  Upon success, returns 0; otherwise, -1 is returned.
+ */
+int msync(void *addr, size_t length, int flags)
+{
+    struct mman_region *region;
+    int ret = -1;
 
-    return MAP_FAILED;
+    _regions_take();
+    region = _region_find(addr);
+    if (region)
+    {
+        if ((uint8_t *)addr + length > (uint8_t *)region->addr + region->length)
+        {
+            length = (uint8_t *)region->addr + region->length - (uint8_t *)addr;
+        }
+        ret = _write_back(region, addr, length);
+    }
+    _regions_release();
+
+    if (ret != 0)
+    {
+        errno = region ? EIO : ENOMEM;
+    }
+    return ret;
 }
 
 /**
@@ -78,11 +317,42 @@ void *mmap(void *addr, size_t length, int prot, int flags,
  */
 int munmap(void *addr, size_t length)
 {
-    if (addr)
+    struct mman_region *region;
+
+    if (addr == RT_NULL)
     {
-        free(addr);
+        errno = EINVAL;
+        return -1;
+    }
+
+    _regions_take();
+    region = _region_find(addr);
+    if (region == RT_NULL)
+    {
+        _regions_release();
+        /* the caller's memory, mapped with an address */
+        return 0;
+    }
+
+    if (--region->ref > 0)
+    {
+        _regions_release();
         return 0;
     }
+    rt_list_remove(&region->list);
+    _regions_release();
+
+    if (region->fd >= 0)
+    {
+        _write_back(region, region->addr, region->length);
+        _file_drop(region->fd);
+    }
+    if (region->in_place == RT_FALSE)
+    {
+        rt_free_align(region->addr);
+    }
+    rt_free(region->path);
+    rt_free(region);
 
-    return -1;
+    return 0;
 }
@@ -7,6 +7,7 @@
  * Date           Author            Notes
  * 2017/11/30     Bernard           The first version.
  * 2024/03/29     TroyMitchelle     Add comments for all macros
+ * 2025/02/20     RT-Thread         Add msync
  */
 
 #ifndef __SYS_MMAN_H__
@@ -59,6 +60,7 @@ extern "C" {
 
 void *mmap (void *start, size_t len, int prot, int flags, int fd, off_t off);
 int munmap (void *start, size_t len);
+int msync (void *start, size_t len, int flags);
 
 #ifdef __cplusplus
 }
@@ -31,6 +31,7 @@
  * Date           Author       Notes
  * 2014-04-01     Ren.Haibo    the first version
  * 2018-06-12     aozima       ignore DHCP_OPTION_SERVER_ID.
+ * 2025-02-17     RT-Thread    offer the upstream DNS server when forwarding through NAT.
  */
 
 #include <stdio.h>
@@ -45,6 +46,7 @@
 #include <netif/ethernetif.h>
 #include <lwip/ip.h>
 #include <lwip/init.h>
+#include <lwip/dns.h>
 
 #if (LWIP_VERSION) < 0x02000000U
     #error "not support old LWIP"
@@ -298,6 +300,26 @@ dhcp_server_option_find(u8_t *buf, u16_t len, u8_t option)
     return NULL;
 }
 
+#ifndef DHCP_DNS_SERVER_IP
+/* fill the DNS server option: the upstream resolver when NATed, else the gateway */
+static void
+dhcp_server_dns(struct netif *netif, u8_t *opt_buf)
+{
+#if defined(LWIP_USING_NAT) && LWIP_DNS
+    /* clients are NATed to the upstream network, the gateway has no resolver */
+    const ip_addr_t *dns = dns_getserver(0);
+
+    if (!ip_addr_isany(dns))
+    {
+        SMEMCPY(opt_buf, &ip_2_ip4(dns)->addr, 4);
+        return;
+    }
+#endif
+    /* default use gatewary dns server */
+    SMEMCPY(opt_buf, &(netif->ip_addr), 4);
+}
+#endif /* DHCP_DNS_SERVER_IP */
+
 /**
 * If an incoming DHCP message is in response to us, then trigger the state machine
 */
@@ -421,8 +443,7 @@ dhcp_server_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t
                 SMEMCPY(opt_buf, &ip_2_ip4(&dns_addr)->addr, 4);
             }
 #else
-            /* default use gatewary dns server */
-            SMEMCPY(opt_buf, &(dhcp_server->netif->ip_addr), 4);
+            dhcp_server_dns(dhcp_server->netif, opt_buf);
 #endif /* DHCP_DNS_SERVER_IP */
             opt_buf += 4;
 
@@ -498,8 +519,7 @@ dhcp_server_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t
                             SMEMCPY(opt_buf, &ip_2_ip4(&dns_addr)->addr, 4);
                         }
 #else
-                        /* default use gatewary dns server */
-                        SMEMCPY(opt_buf, &(dhcp_server->netif->ip_addr), 4);
+                        dhcp_server_dns(dhcp_server->netif, opt_buf);
 #endif /* DHCP_DNS_SERVER_IP */
                         opt_buf += 4;
 
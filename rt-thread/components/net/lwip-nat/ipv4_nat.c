@@ -31,40 +31,38 @@
  * Date           Author       Notes
  * 2015-01-26     Hichard      porting to RT-Thread
  * 2015-01-27     Bernard      code cleanup for lwIP in RT-Thread
+ * 2025-02-17     RT-Thread    lwIP 2.x input hook, hashed sessions, fast path, stats
  */
 
 /*
- * TODOS:
- *  - we should decide if we want to use static tables for NAT or a linked
- *    list.
- *  - we should allocate icmp ping id if multiple clients are sending
- *    ping requests.
- *  - maybe we could hash the identifiers for TCP, ICMP and UDP and use
- *    a single table structure. This would reduce the code amount although
- *    it will cost performance.
- *  - NAT code must check for broadcast addresses and NOT forward
- *    them.
+ * Sessions live in one static table shared by TCP, UDP and ICMP echo. The
+ * outside port (or ICMP echo id) of a session is LWIP_NAT_PORT_BASE plus its
+ * slot index, so replies find their session by index. Outgoing packets are
+ * looked up in a hash of (proto, source, sport, dest, dport).
  *
- *  - netif_remove must notify NAT code when a NAT'ed interface is removed
- *  - allocate NAT entries from a new memp pool instead of the heap
- *  - let ttl be ticks, not seconds
+ * Packets enter through LWIP_HOOK_IP4_INPUT before lwIP decides whether they
+ * are for us. When the interfaces use ip_nat_netif_input() as their input
+ * function, translated packets are forwarded from the receiving thread under
+ * the core lock instead of being queued to the tcpip thread.
  *
- * HOWTO USE:
+ * All functions except ip_nat_netif_input() must run in the tcpip thread or
+ * with the core locked.
  *
- * Shows how to create NAT between a PPP interface and an internal NIC.
- * In this case the network 213.129.231.168/29 is nat'ed when packets
- * are sent to the destination network 10.0.0.0/24 (untypical example -
- * most users will have the other way around).
+ * HOWTO USE:
  *
- * Step 1) Execute when network interfaces are ready.
+ * NAT the network behind EMAC_if out through PPP_IF:
  *
  * new_nat_entry.out_if = (struct netif *)&PPP_IF;
  * new_nat_entry.in_if = (struct netif *)&EMAC_if;
- * IP4_ADDR(&new_nat_entry.source_net, 213, 129, 231, 168);
- * IP4_ADDR(&new_nat_entry.source_netmask, 255, 255, 255, 248);
- * IP4_ADDR(&new_nat_entry.dest_net, 10, 0, 0, 0);
- * IP4_ADDR(&new_nat_entry.source_netmask, 255, 0, 0, 0);
+ * IP4_ADDR(&new_nat_entry.source_net, 192, 168, 169, 0);
+ * IP4_ADDR(&new_nat_entry.source_netmask, 255, 255, 255, 0);
+ * IP4_ADDR(&new_nat_entry.dest_net, 0, 0, 0, 0);
+ * IP4_ADDR(&new_nat_entry.dest_netmask, 0, 0, 0, 0);
+ * LOCK_TCPIP_CORE();
  * ip_nat_add(&new_nat_entry);
+ * UNLOCK_TCPIP_CORE();
+ *
+ * For WLAN AP+STA there is ip_nat_ap_sta_enable() / msh "nat ap_sta on".
  */
 
 #include "ipv4_nat.h"
@@ -73,18 +71,19 @@
 #ifdef LWIP_USING_NAT
 
 #include "lwip/ip.h"
-#include "lwip/inet.h"
+#include "lwip/ip4.h"
+#include "lwip/inet_chksum.h"
 #include "lwip/netif.h"
-#include "lwip/ip_addr.h"
 #include "lwip/icmp.h"
-#include "lwip/tcp_impl.h"
-#include "lwip/udp.h"
+#include "lwip/tcpip.h"
 #include "lwip/mem.h"
 #include "lwip/sys.h"
-#include "lwip/timers.h"
-#include "netif/etharp.h"
+#include "lwip/timeouts.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/prot/udp.h"
+#include "lwip/prot/ethernet.h"
 
-#include <limits.h>
 #include <string.h>
 
 /** Define this to enable debug output of this module */
@@ -92,20 +91,23 @@
 #define LWIP_NAT_DEBUG      LWIP_DBG_OFF
 #endif
 
-#define LWIP_NAT_TTL_INFINITE                    (INT_MAX)
-#define LWIP_NAT_DEFAULT_TTL_SECONDS             (128)
-#define LWIP_NAT_FORWARD_HEADER_SIZE_MIN         (sizeof(struct eth_hdr))
-
-#define LWIP_NAT_DEFAULT_STATE_TABLES_ICMP       (4)
-#define LWIP_NAT_DEFAULT_STATE_TABLES_TCP        (32)
-#define LWIP_NAT_DEFAULT_STATE_TABLES_UDP        (32)
+#ifndef LWIP_NAT_SESSION_NUM
+#define LWIP_NAT_SESSION_NUM                     (128)
+#endif
+#ifndef LWIP_NAT_HASH_SIZE
+#define LWIP_NAT_HASH_SIZE                       (64)   /* power of two */
+#endif
 
-#define LWIP_NAT_DEFAULT_TCP_SOURCE_PORT         (40000)
-#define LWIP_NAT_DEFAULT_UDP_SOURCE_PORT         (40000)
+/* outside ports LWIP_NAT_PORT_BASE .. +LWIP_NAT_SESSION_NUM-1, below the
+   lwIP ephemeral range so they never collide with local sockets */
+#define LWIP_NAT_PORT_BASE                       (40000)
+#define LWIP_NAT_IDX_NONE                        (0xFFFF)
 
-#define IPNAT_ENTRY_RESET(x) do { \
-  (x)->ttl = 0; \
-} while(0)
+/* idle timeouts in seconds */
+#define LWIP_NAT_TCP_TIMEOUT                     (300)
+#define LWIP_NAT_TCP_CLOSE_TIMEOUT               (10)
+#define LWIP_NAT_UDP_TIMEOUT                     (60)
+#define LWIP_NAT_ICMP_TIMEOUT                    (10)
 
 typedef struct ip_nat_conf
 {
@@ -113,87 +115,115 @@ typedef struct ip_nat_conf
   ip_nat_entry_t      entry;
 } ip_nat_conf_t;
 
-typedef struct ip_nat_entry_common
+typedef struct ip_nat_session
 {
-  s32_t           ttl; /* @todo: do we really need this to be signed?? */
-  ip_addr_t       source;
-  ip_addr_t       dest;
-  ip_nat_conf_t   *cfg;
-} ip_nat_entry_common_t;
+  ip_nat_conf_t *cfg;      /* NULL if the slot is free */
+  ip4_addr_t     source;   /* inside host */
+  ip4_addr_t     dest;     /* remote host */
+  u16_t          sport;    /* inside port or ICMP echo id, network order */
+  u16_t          dport;    /* remote port, network order, 0 for ICMP */
+  u8_t           proto;
+  u8_t           closing;  /* TCP FIN or RST seen */
+  u16_t          next;     /* hash chain, or free list when unused */
+  u32_t          last_used;
+} ip_nat_session_t;
+
+static ip_nat_conf_t *ip_nat_cfg = NULL;
+static ip_nat_session_t ip_nat_table[LWIP_NAT_SESSION_NUM];
+static u16_t ip_nat_hash_head[LWIP_NAT_HASH_SIZE];
+static u16_t ip_nat_free_head = LWIP_NAT_IDX_NONE;
+static ip_nat_stats_t ip_nat_stats;
+static u8_t ip_nat_inited;
 
-typedef struct ip_nat_entries_icmp
+static void ip_nat_chksum_adjust(u8_t *chksum, const u8_t *optr, s16_t olen, const u8_t *nptr, s16_t nlen);
+
+#if defined(LWIP_DEBUG) && (LWIP_NAT_DEBUG & LWIP_DBG_ON)
+static void
+ip_nat_dbg_session(const char *msg, const ip_nat_session_t *s)
+{
+  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("%s: proto %" U16_F " %" U16_F ".%" U16_F ".%" U16_F ".%" U16_F ":%" U16_F
+    " -> %" U16_F ".%" U16_F ".%" U16_F ".%" U16_F ":%" U16_F " as port %" U16_F "\n", msg, (u16_t)s->proto,
+    ip4_addr1_16(&s->source), ip4_addr2_16(&s->source), ip4_addr3_16(&s->source), ip4_addr4_16(&s->source),
+    lwip_ntohs(s->sport),
+    ip4_addr1_16(&s->dest), ip4_addr2_16(&s->dest), ip4_addr3_16(&s->dest), ip4_addr4_16(&s->dest),
+    lwip_ntohs(s->dport), (u16_t)(LWIP_NAT_PORT_BASE + (s - ip_nat_table))));
+}
+#else
+#define ip_nat_dbg_session(msg, s)
+#endif /* defined(LWIP_DEBUG) && (LWIP_NAT_DEBUG & LWIP_DBG_ON) */
+
+static u16_t
+ip_nat_hash(u8_t proto, u32_t src, u16_t sport, u32_t dst, u16_t dport)
 {
-  ip_nat_entry_common_t common;
-  u16_t                 id;
-  u16_t                 seqno;
-} ip_nat_entries_icmp_t;
+  u32_t h = src ^ (dst * 31) ^ (((u32_t)sport << 16) | dport) ^ proto;
 
-typedef struct ip_nat_entries_tcp
+  h ^= h >> 16;
+  h *= 0x45d9f3b;
+  h ^= h >> 16;
+  return (u16_t)(h & (LWIP_NAT_HASH_SIZE - 1));
+}
+
+static u16_t
+ip_nat_session_hash(const ip_nat_session_t *s)
 {
-  ip_nat_entry_common_t common;
-  u16_t                 nport;
-  u16_t                 sport;
-  u16_t                 dport;
-} ip_nat_entries_tcp_t;
+  return ip_nat_hash(s->proto, ip4_addr_get_u32(&s->source), s->sport, ip4_addr_get_u32(&s->dest), s->dport);
+}
 
-typedef struct ip_nat_entries_udp
+static u16_t
+ip_nat_nport(const ip_nat_session_t *s)
 {
-  ip_nat_entry_common_t common;
-  u16_t                 nport;
-  u16_t                 sport;
-  u16_t                 dport;
-} ip_nat_entries_udp_t;
+  return lwip_htons((u16_t)(LWIP_NAT_PORT_BASE + (s - ip_nat_table)));
+}
 
-typedef union u_nat_entry
+static void
+ip_nat_session_free(ip_nat_session_t *s)
 {
-  ip_nat_entry_common_t *cmn;
-  ip_nat_entries_tcp_t  *tcp;
-  ip_nat_entries_icmp_t *icmp;
-  ip_nat_entries_udp_t  *udp;
-} nat_entry_t;
+  u16_t idx = (u16_t)(s - ip_nat_table);
+  u16_t *link = &ip_nat_hash_head[ip_nat_session_hash(s)];
 
-static ip_nat_conf_t *ip_nat_cfg = NULL;
-static ip_nat_entries_icmp_t ip_nat_icmp_table[LWIP_NAT_DEFAULT_STATE_TABLES_ICMP];
-static ip_nat_entries_tcp_t ip_nat_tcp_table[LWIP_NAT_DEFAULT_STATE_TABLES_TCP];
-static ip_nat_entries_udp_t ip_nat_udp_table[LWIP_NAT_DEFAULT_STATE_TABLES_UDP];
-
-/* ----------------------- Static functions (COMMON) --------------------*/
-static void     ip_nat_chksum_adjust(u8_t *chksum, const u8_t *optr, s16_t olen, const u8_t *nptr, s16_t nlen);
-static void     ip_nat_cmn_init(ip_nat_conf_t *nat_config, const struct ip_hdr *iphdr,
-                                 ip_nat_entry_common_t *nat_entry);
-static ip_nat_conf_t *ip_nat_shallnat(const struct ip_hdr *iphdr);
-static void     ip_nat_reset_state(ip_nat_conf_t *cfg);
-
-/* ----------------------- Static functions (DEBUG) ---------------------*/
-#if defined(LWIP_DEBUG) && (LWIP_NAT_DEBUG & LWIP_DBG_ON)
-static void     ip_nat_dbg_dump(const char *msg, const struct ip_hdr *iphdr);
-static void     ip_nat_dbg_dump_ip(const ip_addr_t *addr);
-static void     ip_nat_dbg_dump_icmp_nat_entry(const char *msg, const ip_nat_entries_icmp_t *nat_entry);
-static void     ip_nat_dbg_dump_tcp_nat_entry(const char *msg, const ip_nat_entries_tcp_t *nat_entry);
-static void     ip_nat_dbg_dump_udp_nat_entry(const char *msg, const ip_nat_entries_udp_t *nat_entry);
-static void     ip_nat_dbg_dump_init(ip_nat_conf_t *ip_nat_cfg_new);
-static void     ip_nat_dbg_dump_remove(ip_nat_conf_t *cur);
-#else /* defined(LWIP_DEBUG) && (LWIP_NAT_DEBUG & LWIP_DBG_ON) */
-#define ip_nat_dbg_dump(msg, iphdr)
-#define ip_nat_dbg_dump_ip(addr)
-#define ip_nat_dbg_dump_icmp_nat_entry(msg, nat_entry)
-#define ip_nat_dbg_dump_tcp_nat_entry(msg, nat_entry)
-#define ip_nat_dbg_dump_udp_nat_entry(msg, nat_entry)
-#define ip_nat_dbg_dump_init(ip_nat_cfg_new)
-#define ip_nat_dbg_dump_remove(cur)
-#endif /* defined(LWIP_DEBUG) && (LWIP_NAT_DEBUG & LWIP_DBG_ON) */
+  while (*link != LWIP_NAT_IDX_NONE) {
+    if (*link == idx) {
+      *link = s->next;
+      break;
+    }
+    link = &ip_nat_table[*link].next;
+  }
+
+  s->cfg = NULL;
+  s->next = ip_nat_free_head;
+  ip_nat_free_head = idx;
+  ip_nat_stats.sessions--;
+}
+
+static u32_t
+ip_nat_timeout_ms(const ip_nat_session_t *s)
+{
+  switch (s->proto) {
+    case IP_PROTO_TCP:
+      return (s->closing ? LWIP_NAT_TCP_CLOSE_TIMEOUT : LWIP_NAT_TCP_TIMEOUT) * 1000;
+    case IP_PROTO_UDP:
+      return LWIP_NAT_UDP_TIMEOUT * 1000;
+    default:
+      return LWIP_NAT_ICMP_TIMEOUT * 1000;
+  }
+}
 
-/* ----------------------- Static functions (TCP) -----------------------*/
-static ip_nat_entries_tcp_t *ip_nat_tcp_lookup_incoming(const struct ip_hdr *iphdr, const struct tcp_hdr *tcphdr);
-static ip_nat_entries_tcp_t *ip_nat_tcp_lookup_outgoing(ip_nat_conf_t *nat_config,
-                                                         const struct ip_hdr *iphdr, const struct tcp_hdr *tcphdr,
-                                                         u8_t allocate);
+/** Free every session idle for longer than its timeout */
+static void
+ip_nat_expire(void)
+{
+  u32_t now = sys_now();
+  int i;
 
-/* ----------------------- Static functions (UDP) -----------------------*/
-static ip_nat_entries_udp_t *ip_nat_udp_lookup_incoming(const struct ip_hdr *iphdr, const struct udp_hdr *udphdr);
-static ip_nat_entries_udp_t *ip_nat_udp_lookup_outgoing(ip_nat_conf_t *nat_config,
-                                                         const struct ip_hdr *iphdr, const struct udp_hdr *udphdr,
-                                                         u8_t allocate);
+  for (i = 0; i < LWIP_NAT_SESSION_NUM; i++) {
+    ip_nat_session_t *s = &ip_nat_table[i];
+    if (s->cfg != NULL && (u32_t)(now - s->last_used) > ip_nat_timeout_ms(s)) {
+      ip_nat_dbg_session("ip_nat_expire", s);
+      ip_nat_session_free(s);
+      ip_nat_stats.expired++;
+    }
+  }
+}
 
 /**
  * Timer callback function that calls ip_nat_tmr() and reschedules itself.
@@ -210,49 +240,38 @@ nat_timer(void *arg)
   sys_timeout(LWIP_NAT_TMR_INTERVAL_SEC * 1000, nat_timer, NULL);
 }
 
-/** Initialize this module */
+/** Initialize this module, called by ip_nat_add() if not done before */
 void
 ip_nat_init(void)
 {
   int i;
-  extern void lwip_ip_input_set_hook(int (*hook)(struct pbuf *p, struct netif *inp));
 
-  /* @todo: this can be omitted since we trust static variables
-            to be initialized to zero */
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-    IPNAT_ENTRY_RESET(&ip_nat_icmp_table[i].common);
+  if (ip_nat_inited) {
+    return;
   }
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    IPNAT_ENTRY_RESET(&ip_nat_tcp_table[i].common);
+
+  for (i = 0; i < LWIP_NAT_HASH_SIZE; i++) {
+    ip_nat_hash_head[i] = LWIP_NAT_IDX_NONE;
   }
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    IPNAT_ENTRY_RESET(&ip_nat_udp_table[i].common);
+  for (i = 0; i < LWIP_NAT_SESSION_NUM; i++) {
+    ip_nat_table[i].cfg = NULL;
+    ip_nat_table[i].next = (i + 1 < LWIP_NAT_SESSION_NUM) ? (u16_t)(i + 1) : LWIP_NAT_IDX_NONE;
   }
+  ip_nat_free_head = 0;
+  memset(&ip_nat_stats, 0, sizeof(ip_nat_stats));
 
-  /* we must lock scheduler to protect following code */
-  rt_enter_critical();
-
-  /* add a lwip timer for NAT */
   sys_timeout(LWIP_NAT_TMR_INTERVAL_SEC * 1000, nat_timer, NULL);
-
-  /* un-protect */
-  rt_exit_critical();
+  ip_nat_inited = 1;
 }
 
-/** Allocate a new ip_nat_conf_t item */
-static ip_nat_conf_t*
-ip_nat_alloc(void)
-{
-  ip_nat_conf_t *ret = (ip_nat_conf_t*)mem_malloc(sizeof(ip_nat_conf_t));
-  return ret;
-}
-
-/** Free a removed ip_nat_conf_t item */
-static void
-ip_nat_free(ip_nat_conf_t *item)
+/** The NAT timer function, to be called at an interval of
+ * LWIP_NAT_TMR_INTERVAL_SEC seconds.
+ */
+void
+ip_nat_tmr(void)
 {
-  LWIP_ASSERT("item != NULL", item != NULL);
-  mem_free(item);
+  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_tmr: removing old entries\n"));
+  ip_nat_expire();
 }
 
 /** Add a new NAT entry
@@ -263,31 +282,43 @@ ip_nat_free(ip_nat_conf_t *item)
 err_t
 ip_nat_add(const ip_nat_entry_t *new_entry)
 {
-  err_t err = ERR_VAL;
   ip_nat_conf_t *cur = ip_nat_cfg;
-  ip_nat_conf_t *ip_nat_cfg_new = ip_nat_alloc();
+  ip_nat_conf_t *ip_nat_cfg_new;
+
   LWIP_ASSERT("new_entry != NULL", new_entry != NULL);
+  LWIP_ASSERT_CORE_LOCKED();
 
-  if (ip_nat_cfg_new != NULL) {
-    SMEMCPY(&ip_nat_cfg_new->entry, new_entry, sizeof(ip_nat_entry_t));
-    ip_nat_cfg_new->next = NULL;
+  ip_nat_init();
 
-    ip_nat_dbg_dump_init(ip_nat_cfg_new);
+  ip_nat_cfg_new = (ip_nat_conf_t *)mem_malloc(sizeof(ip_nat_conf_t));
+  if (ip_nat_cfg_new == NULL) {
+    return ERR_MEM;
+  }
+  SMEMCPY(&ip_nat_cfg_new->entry, new_entry, sizeof(ip_nat_entry_t));
+  ip_nat_cfg_new->next = NULL;
 
-    if (ip_nat_cfg == NULL) {
-      ip_nat_cfg = ip_nat_cfg_new;
-    } else {
-      /* @todo: do we really need to enqueue the new entry at the end?? */
-      while (cur->next != NULL) {
-        cur = cur->next;
-      }
-      cur->next = ip_nat_cfg_new;
-    }
-    err = ERR_OK;
+  if (ip_nat_cfg == NULL) {
+    ip_nat_cfg = ip_nat_cfg_new;
   } else {
-    err = ERR_MEM;
+    while (cur->next != NULL) {
+      cur = cur->next;
+    }
+    cur->next = ip_nat_cfg_new;
+  }
+  return ERR_OK;
+}
+
+/** Drop all sessions created by a rule */
+static void
+ip_nat_reset_state(ip_nat_conf_t *cfg)
+{
+  int i;
+
+  for (i = 0; i < LWIP_NAT_SESSION_NUM; i++) {
+    if (ip_nat_table[i].cfg == cfg) {
+      ip_nat_session_free(&ip_nat_table[i]);
+    }
   }
-  return err;
 }
 
 /** Remove a NAT entry previously added by 'ip_nat_add()'.
@@ -298,628 +329,486 @@ void
 ip_nat_remove(const ip_nat_entry_t *remove_entry)
 {
   ip_nat_conf_t *cur = ip_nat_cfg;
-  ip_nat_conf_t *next;
   ip_nat_conf_t *previous = NULL;
 
-  while (cur != NULL) {
-    /* Remove the NAT interfaces */
-    if ((cur->entry.source_net.addr     == remove_entry->source_net.addr) &&
-        (cur->entry.source_netmask.addr == remove_entry->source_netmask.addr) &&
-        (cur->entry.dest_net.addr       == remove_entry->dest_net.addr) &&
-        (cur->entry.dest_netmask.addr   == remove_entry->dest_netmask.addr) &&
-        (cur->entry.out_if              == remove_entry->out_if) &&
-        (cur->entry.in_if               == remove_entry->in_if))
-    {
-      ip_nat_dbg_dump_remove(cur);
+  LWIP_ASSERT_CORE_LOCKED();
 
+  while (cur != NULL) {
+    if (ip4_addr_cmp(ip_2_ip4(&cur->entry.source_net), ip_2_ip4(&remove_entry->source_net)) &&
+        ip4_addr_cmp(ip_2_ip4(&cur->entry.source_netmask), ip_2_ip4(&remove_entry->source_netmask)) &&
+        ip4_addr_cmp(ip_2_ip4(&cur->entry.dest_net), ip_2_ip4(&remove_entry->dest_net)) &&
+        ip4_addr_cmp(ip_2_ip4(&cur->entry.dest_netmask), ip_2_ip4(&remove_entry->dest_netmask)) &&
+        (cur->entry.out_if == remove_entry->out_if) &&
+        (cur->entry.in_if == remove_entry->in_if)) {
       ip_nat_reset_state(cur);
-      next = cur->next;
-      if (cur == ip_nat_cfg) {
-        ip_nat_cfg = next;
+      if (previous == NULL) {
+        ip_nat_cfg = cur->next;
       } else {
-        LWIP_ASSERT("NULL != previous", NULL != previous);
-        previous->next = next;
+        previous->next = cur->next;
       }
-      /* free 'cur' or there will be a memory leak */
-      ip_nat_free(cur);
+      mem_free(cur);
       return;
-    } else {
-      previous = cur;
-      cur = cur->next;
     }
+    previous = cur;
+    cur = cur->next;
   }
 }
 
-/** Reset a NAT configured entry to be reused.
- * Effectively calls IPNAT_ENTRY_RESET() on 'cfg'.
+void
+ip_nat_get_stats(ip_nat_stats_t *stats)
+{
+  SMEMCPY(stats, &ip_nat_stats, sizeof(ip_nat_stats_t));
+}
+
+/** Check that p starts with a complete, unfragmented IPv4 header followed
+ * by at least min_size bytes in the same pbuf.
  *
- * @param cfg NAT entry to reset
+ * @return the transport header, NULL if the packet is not translatable
  */
-static void
-ip_nat_reset_state(ip_nat_conf_t *cfg)
+static void *
+ip_nat_check_header(struct pbuf *p, u16_t min_size)
 {
-  int i;
+  struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+  u16_t iphdr_hlen, iphdr_len;
 
-  /* @todo: optimize this!!!
-     why do we search for it anyway, if we have the pointer??? */
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-    if(ip_nat_icmp_table[i].common.cfg == cfg) {
-      IPNAT_ENTRY_RESET(&ip_nat_icmp_table[i].common);
-    }
+  if (p->len < IP_HLEN) {
+    return NULL;
   }
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    if(ip_nat_tcp_table[i].common.cfg == cfg) {
-      IPNAT_ENTRY_RESET(&ip_nat_tcp_table[i].common);
-    }
+  iphdr_hlen = IPH_HL(iphdr) * 4;
+  iphdr_len = lwip_ntohs(IPH_LEN(iphdr));
+  if (iphdr_hlen < IP_HLEN || p->len < iphdr_hlen + min_size ||
+      iphdr_len < iphdr_hlen + min_size || iphdr_len > p->tot_len) {
+    return NULL;
   }
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    if(ip_nat_udp_table[i].common.cfg == cfg) {
-      IPNAT_ENTRY_RESET(&ip_nat_udp_table[i].common);
-    }
+  if ((IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK | IP_MF)) != 0) {
+    return NULL;
   }
+  return (u8_t *)p->payload + iphdr_hlen;
 }
 
-/** Check if this packet should be routed or should be translated
- *
- * @param iphdr the IP header to check
- * @return - a NAT entry if the packet shall be translated,
- *         - NULL if the packet shall be routed normally
- */
-static ip_nat_conf_t *
-ip_nat_shallnat(const struct ip_hdr *iphdr)
+/** Final checks shared by both directions, before a header is modified */
+static u8_t
+ip_nat_check_forward(struct pbuf *p, struct ip_hdr *iphdr)
 {
-  ip_nat_conf_t *nat_config = ip_nat_cfg;
+  u16_t iphdr_len = lwip_ntohs(IPH_LEN(iphdr));
 
-  for (nat_config = ip_nat_cfg; nat_config != NULL; nat_config = nat_config->next) {
-      if (ip_addr_netcmp(&(iphdr->dest), &(nat_config->entry.dest_net),
-                       &(nat_config->entry.dest_netmask)) ||
-      ip_addr_netcmp(&(iphdr->src), &(nat_config->entry.source_net),
-                     &(nat_config->entry.source_netmask))) {
-        break;
-    }
+#if CHECKSUM_CHECK_IP
+  if (inet_chksum(iphdr, IPH_HL(iphdr) * 4) != 0) {
+    ip_nat_stats.drop_hdr++;
+    return 0;
+  }
+#endif
+  if (IPH_TTL(iphdr) <= 1) {
+    ip_nat_stats.drop_ttl++;
+    return 0;
   }
+  /* Ethernet padding of short frames */
+  if (iphdr_len < p->tot_len) {
+    pbuf_realloc(p, iphdr_len);
+  }
+  return 1;
+}
 
-  return nat_config;
+static void
+ip_nat_dec_ttl(struct ip_hdr *iphdr)
+{
+  u8_t old[2];
+
+  /* TTL and protocol form one 16 bit word of the header checksum */
+  old[0] = iphdr->_ttl;
+  old[1] = iphdr->_proto;
+  IPH_TTL_SET(iphdr, IPH_TTL(iphdr) - 1);
+  ip_nat_chksum_adjust((u8_t *)&iphdr->_chksum, old, 2, &iphdr->_ttl, 2);
 }
 
-/** Check if the IP header can be hidden and if the remaining packet
- * is long enough. p->payload is reset to the IP header on return.
- *
- * @param p received packet, p->payload pointing to IP header
- * @param min_size minimum p->tot_len after hiding IP header
- * @return a pointer to the next header (after IP header),
- *         NULL if hiding IP header fails or the packet is too short
- */
-static void*
-ip_nat_check_header(struct pbuf *p, u16_t min_size)
+/** Rewrite one address (and port) of the transport header checksum */
+static void
+ip_nat_l4_adjust(u8_t proto, void *l4hdr, const u8_t *oaddr, const u8_t *naddr,
+                 const u16_t *oport, const u16_t *nport)
 {
-  void *ret = NULL;
-  struct ip_hdr  *iphdr = (struct ip_hdr*)p->payload;
-  s16_t iphdr_len = IPH_HL(iphdr) * 4;
+  u8_t *chksum;
 
-  if(!pbuf_header(p, -iphdr_len)) {
-    if(p->tot_len >= min_size) {
-      ret = p->payload;
-    }
-    /* Restore pbuf payload pointer from previous header check. */
-    pbuf_header(p, iphdr_len);
+  switch (proto) {
+    case IP_PROTO_TCP:
+      chksum = (u8_t *)&((struct tcp_hdr *)l4hdr)->chksum;
+      break;
+    case IP_PROTO_UDP:
+      /* a zero UDP checksum means none was computed */
+      if (((struct udp_hdr *)l4hdr)->chksum == 0) {
+        return;
+      }
+      chksum = (u8_t *)&((struct udp_hdr *)l4hdr)->chksum;
+      break;
+    default:
+      /* ICMP does not cover the IP addresses */
+      chksum = (u8_t *)&((struct icmp_echo_hdr *)l4hdr)->chksum;
+      oaddr = NULL;
+      break;
+  }
+  ip_nat_chksum_adjust(chksum, (const u8_t *)oport, 2, (const u8_t *)nport, 2);
+  if (oaddr != NULL) {
+    ip_nat_chksum_adjust(chksum, oaddr, 4, naddr, 4);
   }
-  return ret;
 }
 
-/** Input processing: check if a received packet belongs to a NAT entry
- * and if so, translated it and send it on.
- *
- * @param p received packet
- * @return 1 if the packet has been consumed (it was a NAT packet),
- *         0 if the packet has not been consumed (no NAT packet)
+/** Split a transport header into ports; ICMP echo uses the id as sport.
+ * @return 0 if the protocol/type is not translated
  */
-u8_t
-ip_nat_input(struct pbuf *p)
+static u8_t
+ip_nat_l4_ports(struct pbuf *p, u8_t proto, void **l4hdr, u16_t **sport, u16_t **dport, u8_t outgoing)
 {
-  struct ip_hdr        *iphdr = (struct ip_hdr*)p->payload;
-  struct tcp_hdr       *tcphdr;
-  struct udp_hdr       *udphdr;
   struct icmp_echo_hdr *icmphdr;
-  nat_entry_t           nat_entry;
-  err_t                 err;
-  u8_t                  consumed = 0;
-  int                   i;
-  struct pbuf          *q = NULL;
 
-  nat_entry.cmn = NULL;
-  ip_nat_dbg_dump("ip_nat_in: checking nat for", iphdr);
-
-  switch (IPH_PROTO(iphdr)) {
+  switch (proto) {
     case IP_PROTO_TCP:
-      tcphdr = (struct tcp_hdr*)ip_nat_check_header(p, sizeof(struct tcp_hdr));
-      if (tcphdr == NULL) {
-        LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_input: short tcp packet (%" U16_F " bytes) discarded\n", p->tot_len));
-      } else {
-        nat_entry.tcp = ip_nat_tcp_lookup_incoming(iphdr, tcphdr);
-        if (nat_entry.tcp != NULL) {
-          /* Refresh TCP entry */
-          nat_entry.tcp->common.ttl = LWIP_NAT_DEFAULT_TTL_SECONDS;
-          tcphdr->dest = nat_entry.tcp->sport;
-          /* Adjust TCP checksum for changed destination port */
-          ip_nat_chksum_adjust((u8_t *)&(tcphdr->chksum),
-            (u8_t *)&(nat_entry.tcp->nport), 2, (u8_t *)&(tcphdr->dest), 2);
-          /* Adjust TCP checksum for changing dest IP address */
-          ip_nat_chksum_adjust((u8_t *)&(tcphdr->chksum),
-            (u8_t *)&(nat_entry.cmn->cfg->entry.out_if->ip_addr.addr), 4,
-            (u8_t *)&(nat_entry.cmn->source.addr), 4);
-
-          consumed = 1;
-        }
+      *l4hdr = ip_nat_check_header(p, TCP_HLEN);
+      if (*l4hdr == NULL) {
+        return 0;
       }
-      break;
-
+      *sport = &((struct tcp_hdr *)*l4hdr)->src;
+      *dport = &((struct tcp_hdr *)*l4hdr)->dest;
+      return 1;
     case IP_PROTO_UDP:
-      udphdr = (struct udp_hdr *)ip_nat_check_header(p, sizeof(struct udp_hdr));
-      if (udphdr == NULL) {
-        LWIP_DEBUGF(LWIP_NAT_DEBUG,
-          ("ip_nat_input: short udp packet (%" U16_F " bytes) discarded\n",
-          p->tot_len));
-      } else {
-        nat_entry.udp = ip_nat_udp_lookup_incoming(iphdr, udphdr);
-        if (nat_entry.udp != NULL) {
-          /* Refresh UDP entry */
-          nat_entry.udp->common.ttl = LWIP_NAT_DEFAULT_TTL_SECONDS;
-          udphdr->dest = nat_entry.udp->sport;
-          /* Adjust UDP checksum for changed destination port */
-          ip_nat_chksum_adjust((u8_t *)&(udphdr->chksum),
-            (u8_t *)&(nat_entry.udp->nport), 2, (u8_t *)&(udphdr->dest), 2);
-          /* Adjust UDP checksum for changing dest IP address */
-          ip_nat_chksum_adjust((u8_t *)&(udphdr->chksum),
-            (u8_t *)&(nat_entry.cmn->cfg->entry.out_if->ip_addr.addr), 4,
-            (u8_t *)&(nat_entry.cmn->source.addr), 4);
-
-          consumed = 1;
-        }
+      *l4hdr = ip_nat_check_header(p, UDP_HLEN);
+      if (*l4hdr == NULL) {
+        return 0;
       }
-      break;
-
+      *sport = &((struct udp_hdr *)*l4hdr)->src;
+      *dport = &((struct udp_hdr *)*l4hdr)->dest;
+      return 1;
     case IP_PROTO_ICMP:
       icmphdr = (struct icmp_echo_hdr *)ip_nat_check_header(p, sizeof(struct icmp_echo_hdr));
-      if (icmphdr == NULL) {
-        LWIP_DEBUGF(LWIP_NAT_DEBUG,
-          ("ip_nat_out: short icmp echo reply packet (%" U16_F " bytes) discarded\n",
-          p->tot_len));
-      } else {
-        if (ICMP_ER == ICMPH_TYPE(icmphdr)) {
-          for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-            nat_entry.icmp = &ip_nat_icmp_table[i];
-            if ((nat_entry.icmp->common.ttl) &&
-                (iphdr->src.addr == nat_entry.icmp->common.dest.addr) &&
-                (nat_entry.icmp->id == icmphdr->id) &&
-                (nat_entry.icmp->seqno == icmphdr->seqno)) {
-              ip_nat_dbg_dump_icmp_nat_entry("found existing nat entry: ", nat_entry.icmp);
-              consumed = 1;
-              IPNAT_ENTRY_RESET(nat_entry.cmn);
-              break;
-            }
-          }
-        }
+      if (icmphdr == NULL || ICMPH_TYPE(icmphdr) != (outgoing ? ICMP_ECHO : ICMP_ER)) {
+        return 0;
       }
-      break;
-
+      *l4hdr = icmphdr;
+      *sport = &icmphdr->id;
+      *dport = &icmphdr->id;
+      return 1;
     default:
-      break;
+      return 0;
   }
-
-  if(consumed) {
-    /* packet consumed, send it out on in_if */
-    struct netif *in_if;
-
-    /* check if the pbuf has room for link headers */
-    if (pbuf_header(p, PBUF_LINK_HLEN)) {
-      /* pbuf has no room for link headers, allocate an extra pbuf */
-      q = pbuf_alloc(PBUF_LINK, 0, PBUF_RAM);
-      if (q == NULL) {
-        LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_input: no pbuf for outgoing header\n"));
-        // rt_kprintf("ip_nat_input: no pbuf for outgoing header\n");
-        /* @todo: stats? */
-        pbuf_free(p);
-        p = NULL;
-        return 1;
-      } else {
-        pbuf_cat(q, p);
-      }
-    } else {
-      /* restore p->payload to IP header */
-      if (pbuf_header(p, -PBUF_LINK_HLEN)) {
-        LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_input: restoring header failed\n"));
-        // rt_kprintf("ip_nat_input: restoring header failed\n");
-        /* @todo: stats? */
-        pbuf_free(p);
-        p = NULL;
-        return 1;
-      }
-      else q = p;
-    }
-    /* if we come here, q is the pbuf to send (either points to p or to a chain) */
-    in_if = nat_entry.cmn->cfg->entry.in_if;
-    iphdr->dest.addr = nat_entry.cmn->source.addr;
-    ip_nat_chksum_adjust((u8_t *) & IPH_CHKSUM(iphdr),
-      (u8_t *) & (nat_entry.cmn->cfg->entry.out_if->ip_addr.addr), 4,
-      (u8_t *) & (iphdr->dest.addr), 4);
-
-    ip_nat_dbg_dump("ip_nat_input: packet back to source after nat: ", iphdr);
-    LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_input: sending packet on interface ("));
-    ip_nat_dbg_dump_ip(&(in_if->ip_addr));
-    LWIP_DEBUGF(LWIP_NAT_DEBUG, (")\n"));
-
-    err = in_if->output(in_if, q, (ip_addr_t *)&(iphdr->dest));
-    if(err != ERR_OK) {
-      LWIP_DEBUGF(LWIP_NAT_DEBUG,
-        ("ip_nat_input: failed to send rewritten packet. link layer returned %d\n",
-        err));
-      // rt_kprintf("ip_nat_input: failed to send rewritten packet. link layer returned %d\n", err);
-    }
-    /* now that q (and/or p) is sent (or not), give up the reference to it
-       this frees the input pbuf (p) as we have consumed it. */
-    pbuf_free(q);
-  }
-  return consumed;
 }
 
-/** Check if one NAT entry timed out */
 static void
-ip_nat_check_timeout(ip_nat_entry_common_t *nat_entry)
+ip_nat_track_tcp(ip_nat_session_t *s, void *l4hdr)
 {
-  if(nat_entry->ttl > 0) {
-    if(nat_entry->ttl != LWIP_NAT_TTL_INFINITE) {
-      /* this is not a 'no-timeout' entry */
-      if(nat_entry->ttl > LWIP_NAT_TMR_INTERVAL_SEC) {
-        nat_entry->ttl -= LWIP_NAT_TMR_INTERVAL_SEC;
-      } else {
-        nat_entry->ttl = 0;
-      }
-    }
+  if (s->proto == IP_PROTO_TCP && (TCPH_FLAGS((struct tcp_hdr *)l4hdr) & (TCP_FIN | TCP_RST))) {
+    s->closing = 1;
   }
 }
 
-/** The NAT timer function, to be called at an interval of
- * LWIP_NAT_TMR_INTERVAL_SEC seconds.
- */
-void
-ip_nat_tmr(void)
+static u8_t
+ip_nat_send(struct pbuf *p, struct netif *netif, const ip4_addr_p_t *dest)
 {
-  int i;
+  ip4_addr_t nexthop;
 
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_tmr: removing old entries\n"));
-
-  for(i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-    ip_nat_check_timeout((ip_nat_entry_common_t *) & ip_nat_icmp_table[i]);
-  }
-  for(i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    ip_nat_check_timeout((ip_nat_entry_common_t *) & ip_nat_tcp_table[i]);
-  }
-  for(i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    ip_nat_check_timeout((ip_nat_entry_common_t *) & ip_nat_udp_table[i]);
+  ip4_addr_copy(nexthop, *dest);
+  if (netif->output(netif, p, &nexthop) != ERR_OK) {
+    LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat: failed to send rewritten packet\n"));
+    ip_nat_stats.drop_output++;
+    return 0;
   }
+  return 1;
 }
 
-/** Check if we want to perform NAT with this packet. If so, send it out on
- * the correct interface.
+/** Input processing: check if a packet received on an outside interface
+ * belongs to a NAT session and if so, translate it and send it on.
  *
- * @param p the packet to test/send
- * @return 1: the packet has been sent using NAT,
- *         0: the packet did not belong to a NAT entry
+ * @param p received packet, p->payload pointing to the IP header
+ * @param inp interface the packet was received on
+ * @return 1 if the packet has been consumed (it was a NAT packet),
+ *         0 if the packet has not been consumed (no NAT packet)
  */
 u8_t
-ip_nat_out(struct pbuf *p)
-{
-  u8_t                  sent = 0;
-  err_t                 err;
-  struct ip_hdr        *iphdr = p->payload;
-  struct icmp_echo_hdr *icmphdr;
-  struct tcp_hdr       *tcphdr;
-  struct udp_hdr       *udphdr;
-  ip_nat_conf_t        *nat_config;
-  nat_entry_t           nat_entry;
-  int             i;
+ip_nat_input(struct pbuf *p, struct netif *inp)
+{
+  struct ip_hdr    *iphdr = (struct ip_hdr *)p->payload;
+  ip_nat_conf_t    *cfg;
+  ip_nat_session_t *s;
+  void             *l4hdr;
+  u16_t            *sport, *dport;
+  u16_t             idx, oport;
+  u8_t              proto;
+
+  for (cfg = ip_nat_cfg; cfg != NULL; cfg = cfg->next) {
+    if (cfg->entry.out_if == inp) {
+      break;
+    }
+  }
+  if (cfg == NULL || ip_nat_check_header(p, 0) == NULL ||
+      !ip4_addr_cmp(&iphdr->dest, netif_ip4_addr(inp))) {
+    return 0;
+  }
 
-  nat_entry.cmn = NULL;
+  proto = IPH_PROTO(iphdr);
+  if (!ip_nat_l4_ports(p, proto, &l4hdr, &sport, &dport, 0)) {
+    return 0;
+  }
 
-  ip_nat_dbg_dump("ip_nat_out: checking nat for", iphdr);
+  /* replies carry the outside port as destination, which is the slot index */
+  idx = (u16_t)(lwip_ntohs(*dport) - LWIP_NAT_PORT_BASE);
+  if (idx >= LWIP_NAT_SESSION_NUM) {
+    return 0;
+  }
+  s = &ip_nat_table[idx];
+  if (s->cfg == NULL || s->proto != proto || s->cfg->entry.out_if != inp ||
+      !ip4_addr_cmp(&iphdr->src, &s->dest) || (proto != IP_PROTO_ICMP && *sport != s->dport)) {
+    return 0;
+  }
 
-  /* Check if this packet should be routed or should be translated */
-  nat_config = ip_nat_shallnat(iphdr);
-  if (nat_config != NULL ) {
-    if (nat_config->entry.out_if == NULL) {
-      LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_out: no external interface for nat table entry\n"));
-    } else {
-      switch (IPH_PROTO(iphdr))
-      {
-      case IP_PROTO_TCP:
-        tcphdr = (struct tcp_hdr *)ip_nat_check_header(p, sizeof(struct tcp_hdr));
-        if (tcphdr == NULL) {
-          LWIP_DEBUGF(LWIP_NAT_DEBUG,
-            ("ip_nat_out: short tcp packet (%" U16_F " bytes) discarded\n", p->tot_len));
-        } else {
-          nat_entry.tcp = ip_nat_tcp_lookup_outgoing(nat_config, iphdr, tcphdr, 1);
-          if (nat_entry.tcp != NULL) {
-            /* Adjust TCP checksum for changing source port */
-            tcphdr->src = nat_entry.tcp->nport;
-            ip_nat_chksum_adjust((u8_t *)&(tcphdr->chksum),
-              (u8_t *)&(nat_entry.tcp->sport), 2, (u8_t *)&(tcphdr->src), 2);
-            /* Adjust TCP checksum for changing source IP address */
-            ip_nat_chksum_adjust((u8_t *)&(tcphdr->chksum),
-              (u8_t *)&(nat_entry.cmn->source.addr), 4,
-              (u8_t *)&(nat_entry.cmn->cfg->entry.out_if->ip_addr.addr), 4);
-          }
-        }
-        break;
+  if (!ip_nat_check_forward(p, iphdr)) {
+    pbuf_free(p);
+    return 1;
+  }
 
-      case IP_PROTO_UDP:
-        udphdr = (struct udp_hdr *)ip_nat_check_header(p, sizeof(struct udp_hdr));
-        if (udphdr == NULL) {
-          LWIP_DEBUGF(LWIP_NAT_DEBUG,
-            ("ip_nat_out: short udp packet (%" U16_F " bytes) discarded\n", p->tot_len));
-        } else {
-          nat_entry.udp = ip_nat_udp_lookup_outgoing(nat_config, iphdr, udphdr, 1);
-          if (nat_entry.udp != NULL) {
-            /* Adjust UDP checksum for changing source port */
-            udphdr->src = nat_entry.udp->nport;
-            ip_nat_chksum_adjust((u8_t *)&(udphdr->chksum),
-              (u8_t *)&(nat_entry.udp->sport), 2, (u8_t *) & (udphdr->src), 2);
-            /* Adjust UDP checksum for changing source IP address */
-            ip_nat_chksum_adjust((u8_t *)&(udphdr->chksum),
-              (u8_t *)&(nat_entry.cmn->source.addr), 4,
-              (u8_t *)&(nat_entry.cmn->cfg->entry.out_if->ip_addr.addr), 4);
-          }
-        }
-        break;
+  s->last_used = sys_now();
+  ip_nat_track_tcp(s, l4hdr);
 
-      case IP_PROTO_ICMP:
-        icmphdr = (struct icmp_echo_hdr *)ip_nat_check_header(p, sizeof(struct icmp_echo_hdr));
-        if(icmphdr == NULL) {
-          LWIP_DEBUGF(LWIP_NAT_DEBUG,
-            ("ip_nat_out: short icmp echo packet (%" U16_F " bytes) discarded\n", p->tot_len));
-        } else {
-          if (ICMPH_TYPE(icmphdr) == ICMP_ECHO) {
-            for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-              if (!ip_nat_icmp_table[i].common.ttl) {
-                nat_entry.icmp = &ip_nat_icmp_table[i];
-                ip_nat_cmn_init(nat_config, iphdr, nat_entry.cmn);
-                nat_entry.icmp->id = icmphdr->id;
-                nat_entry.icmp->seqno = icmphdr->seqno;
-                ip_nat_dbg_dump_icmp_nat_entry(" ip_nat_out: created new NAT entry ", nat_entry.icmp);
-                break;
-              }
-            }
-            if (NULL == nat_entry.icmp)
-            {
-              LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_out: no more NAT entries for ICMP available\n"));
-            }
-          }
-        }
-        break;
-      default:
-        break;
-      }
+  oport = *dport;
+  *dport = s->sport;
+  ip_nat_l4_adjust(proto, l4hdr, (const u8_t *)&iphdr->dest, (const u8_t *)&s->source, &oport, dport);
+  ip_nat_chksum_adjust((u8_t *)&iphdr->_chksum, (const u8_t *)&iphdr->dest, 4, (const u8_t *)&s->source, 4);
+  ip4_addr_copy(iphdr->dest, s->source);
+  ip_nat_dec_ttl(iphdr);
 
-      if (nat_entry.cmn != NULL) {
-        struct netif *out_if = nat_entry.cmn->cfg->entry.out_if;
-        /* Exchange the IP source address with the address of the interface
-        * where the packet will be sent.
-        */
-        /* @todo: check nat_config->entry.out_if agains nat_entry.cmn->cfg->entry.out_if */
-        iphdr->src.addr = nat_config->entry.out_if->ip_addr.addr;
-        ip_nat_chksum_adjust((u8_t *) & IPH_CHKSUM(iphdr),
-          (u8_t *) & (nat_entry.cmn->source.addr), 4, (u8_t *) & iphdr->src.addr, 4);
-
-        ip_nat_dbg_dump("ip_nat_out: rewritten packet", iphdr);
-        LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_out: sending packet on interface ("));
-        ip_nat_dbg_dump_ip(&(out_if->ip_addr));
-        LWIP_DEBUGF(LWIP_NAT_DEBUG, (")\n"));
-
-        err = out_if->output(out_if, p, (ip_addr_t *)&(iphdr->dest));
-        if (err != ERR_OK) {
-          LWIP_DEBUGF(LWIP_NAT_DEBUG,
-            ("ip_nat_out: failed to send rewritten packet. link layer returned %d\n", err));
-          // rt_kprintf("ip_nat_out: failed to send rewritten packet. link layer returned %d\n", err);
-        } else {
-          sent = 1;
-        }
-      }
-    }
+  if (ip_nat_send(p, s->cfg->entry.in_if, &iphdr->dest)) {
+    ip_nat_stats.in_pkts++;
   }
-
-  return sent;
+  pbuf_free(p);
+  return 1;
 }
 
-/** Initialize common parts of a NAT entry
+/** Find the rule that translates a packet received on inp, if any
  *
- * @param nat_config NAT config entry
- * @param iphdr IP header from which to initialize the entry
- * @param nat_entry entry to initialize
+ * @param iphdr the IP header to check
+ * @param inp interface the packet was received on
+ * @return - a NAT rule if the packet shall be translated,
+ *         - NULL if the packet shall be handled normally
  */
-static void
-ip_nat_cmn_init(ip_nat_conf_t *nat_config, const struct ip_hdr *iphdr, ip_nat_entry_common_t *nat_entry)
+static ip_nat_conf_t *
+ip_nat_shallnat(const struct ip_hdr *iphdr, struct netif *inp)
 {
-  LWIP_ASSERT("NULL != nat_entry", NULL != nat_entry);
-  LWIP_ASSERT("NULL != nat_config", NULL != nat_config);
-  LWIP_ASSERT("NULL != iphdr", NULL != iphdr);
-  nat_entry->cfg = nat_config;
-  nat_entry->dest = *((ip_addr_t *)&iphdr->dest);
-  nat_entry->source = *((ip_addr_t *)&iphdr->src);
-  nat_entry->ttl = LWIP_NAT_DEFAULT_TTL_SECONDS;
-}
+  ip_nat_conf_t *nat_config;
+  struct netif *netif;
 
-/**
- * This function checks for incoming packets if we already have a NAT entry.
- * If yes a pointer to the NAT entry is returned. Otherwise NULL.
- *
- * @param iphdr The IP header.
- * @param udphdr The UDP header.
- * @return A pointer to an existing NAT entry or
- *         NULL if none is found.
- */
-static ip_nat_entries_udp_t *
-ip_nat_udp_lookup_incoming(const struct ip_hdr *iphdr, const struct udp_hdr *udphdr)
-{
-  int i;
-  ip_nat_entries_udp_t *nat_entry = NULL;
-
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    if (ip_nat_udp_table[i].common.ttl) {
-      if ((iphdr->src.addr == ip_nat_udp_table[i].common.dest.addr) &&
-          (udphdr->src == ip_nat_udp_table[i].dport) &&
-          (udphdr->dest == ip_nat_udp_table[i].nport)) {
-        nat_entry = &ip_nat_udp_table[i];
-        ip_nat_dbg_dump_udp_nat_entry("ip_nat_udp_lookup_incoming: found existing nat entry: ",
-                                      nat_entry);
-        break;
-      }
+  for (nat_config = ip_nat_cfg; nat_config != NULL; nat_config = nat_config->next) {
+    struct netif *out_if = nat_config->entry.out_if;
+
+    if ((nat_config->entry.in_if == inp) && (out_if != NULL) &&
+        netif_is_up(out_if) && netif_is_link_up(out_if) &&
+        !ip4_addr_isany_val(*netif_ip4_addr(out_if)) &&
+        ip4_addr_netcmp(&iphdr->src, ip_2_ip4(&nat_config->entry.source_net),
+                        ip_2_ip4(&nat_config->entry.source_netmask)) &&
+        ip4_addr_netcmp(&iphdr->dest, ip_2_ip4(&nat_config->entry.dest_net),
+                        ip_2_ip4(&nat_config->entry.dest_netmask))) {
+      break;
+    }
+  }
+  if (nat_config == NULL) {
+    return NULL;
+  }
+
+  /* broadcasts, multicasts and traffic for the router itself are never translated */
+  if (ip4_addr_isbroadcast(&iphdr->dest, inp) || ip4_addr_ismulticast(&iphdr->dest)) {
+    return NULL;
+  }
+  for (netif = netif_list; netif != NULL; netif = netif->next) {
+    if (ip4_addr_cmp(&iphdr->dest, netif_ip4_addr(netif))) {
+      return NULL;
     }
   }
-  return nat_entry;
+  return nat_config;
 }
 
-/**
- * This function checks if we already have a NAT entry for this UDP connection.
- * If yes the a pointer to this NAT entry is returned.
+/** Check if we want to perform NAT with a packet received on an inside
+ * interface. If so, send it out on the correct interface.
  *
- * @param nat_config NAT config entry
- * @param iphdr The IP header.
- * @param udphdr The UDP header.
- * @param allocate If no existing NAT entry is found and this flag is true
- *        a NAT entry is allocated.
+ * @param p the packet to test/send, p->payload pointing to the IP header
+ * @param inp interface the packet was received on
+ * @return 1: the packet has been consumed (sent or dropped) by NAT,
+ *         0: the packet did not belong to a NAT rule
  */
-static ip_nat_entries_udp_t *
-ip_nat_udp_lookup_outgoing(ip_nat_conf_t *nat_config, const struct ip_hdr *iphdr,
-                           const struct udp_hdr *udphdr, u8_t allocate)
-{
-  int i;
-  nat_entry_t nat_entry;
-  int last_free = -1;
-
-  nat_entry.cmn = NULL;
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    if (ip_nat_udp_table[i].common.ttl) {
-      if ((iphdr->src.addr == ip_nat_udp_table[i].common.source.addr) &&
-          (iphdr->dest.addr == ip_nat_udp_table[i].common.dest.addr) &&
-          (udphdr->src == ip_nat_udp_table[i].sport) &&
-          (udphdr->dest == ip_nat_udp_table[i].dport)) {
-        nat_entry.udp = &ip_nat_udp_table[i];
-
-        ip_nat_dbg_dump_udp_nat_entry("ip_nat_udp_lookup_outgoing: found existing nat entry: ",
-                                      nat_entry.udp);
-        break;
-      }
-    } else {
-        last_free = i;
+u8_t
+ip_nat_out(struct pbuf *p, struct netif *inp)
+{
+  struct ip_hdr    *iphdr = (struct ip_hdr *)p->payload;
+  ip_nat_conf_t    *nat_config;
+  ip_nat_session_t *s = NULL;
+  struct netif     *out_if;
+  void             *l4hdr;
+  u16_t            *sport, *dport;
+  u16_t             rport, oport, hash, idx;
+  u8_t              proto;
+
+  if (ip_nat_check_header(p, 0) == NULL) {
+    return 0;
+  }
+  nat_config = ip_nat_shallnat(iphdr, inp);
+  if (nat_config == NULL) {
+    return 0;
+  }
+
+  proto = IPH_PROTO(iphdr);
+  if (!ip_nat_l4_ports(p, proto, &l4hdr, &sport, &dport, 1)) {
+    return 0;
+  }
+  rport = (proto == IP_PROTO_ICMP) ? 0 : *dport;
+
+  hash = ip_nat_hash(proto, ip4_addr_get_u32(&iphdr->src), *sport, ip4_addr_get_u32(&iphdr->dest), rport);
+  for (idx = ip_nat_hash_head[hash]; idx != LWIP_NAT_IDX_NONE; idx = ip_nat_table[idx].next) {
+    s = &ip_nat_table[idx];
+    if (s->proto == proto && s->sport == *sport && s->dport == rport &&
+        ip4_addr_cmp(&iphdr->src, &s->source) && ip4_addr_cmp(&iphdr->dest, &s->dest)) {
+      break;
     }
+    s = NULL;
   }
-  if (nat_entry.cmn == NULL) {
-    if (allocate) {
-      if (last_free != -1) {
-        nat_entry.udp = &ip_nat_udp_table[last_free];
-        nat_entry.udp->nport = htons((u16_t) (LWIP_NAT_DEFAULT_UDP_SOURCE_PORT + i));
-        nat_entry.udp->sport = udphdr->src;
-        nat_entry.udp->dport = udphdr->dest;
-        ip_nat_cmn_init(nat_config, iphdr, nat_entry.cmn);
-
-        ip_nat_dbg_dump_udp_nat_entry("ip_nat_udp_lookup_outgoing: created new nat entry: ",
-                                      nat_entry.udp);
-      } else {
-        LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_udp_lookup_outgoing: no more NAT entries available\n"));
-        // rt_kprintf("ip_nat_udp_lookup_outgoing: no more NAT entries available\n");
-      }
+
+  if (!ip_nat_check_forward(p, iphdr)) {
+    pbuf_free(p);
+    return 1;
+  }
+
+  if (s == NULL) {
+    if (ip_nat_free_head == LWIP_NAT_IDX_NONE) {
+      ip_nat_expire();
+    }
+    if (ip_nat_free_head == LWIP_NAT_IDX_NONE) {
+      LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_out: no more NAT entries available\n"));
+      ip_nat_stats.drop_full++;
+      pbuf_free(p);
+      return 1;
     }
+    idx = ip_nat_free_head;
+    s = &ip_nat_table[idx];
+    ip_nat_free_head = s->next;
+
+    s->cfg = nat_config;
+    ip4_addr_copy(s->source, iphdr->src);
+    ip4_addr_copy(s->dest, iphdr->dest);
+    s->sport = *sport;
+    s->dport = rport;
+    s->proto = proto;
+    s->closing = 0;
+    s->next = ip_nat_hash_head[hash];
+    ip_nat_hash_head[hash] = idx;
+    ip_nat_stats.created++;
+    ip_nat_stats.sessions++;
+    ip_nat_dbg_session("ip_nat_out: created new session", s);
+  }
+
+  s->last_used = sys_now();
+  ip_nat_track_tcp(s, l4hdr);
+
+  out_if = s->cfg->entry.out_if;
+  oport = *sport;
+  *sport = ip_nat_nport(s);
+  ip_nat_l4_adjust(proto, l4hdr, (const u8_t *)&iphdr->src, (const u8_t *)netif_ip4_addr(out_if), &oport, sport);
+  ip_nat_chksum_adjust((u8_t *)&iphdr->_chksum, (const u8_t *)&iphdr->src, 4,
+                       (const u8_t *)netif_ip4_addr(out_if), 4);
+  ip4_addr_copy(iphdr->src, *netif_ip4_addr(out_if));
+  ip_nat_dec_ttl(iphdr);
+
+  if (ip_nat_send(p, out_if, &iphdr->dest)) {
+    ip_nat_stats.out_pkts++;
   }
-  return nat_entry.udp;
+  pbuf_free(p);
+  return 1;
 }
 
-/**
- * This function checks for incoming packets if we already have a NAT entry.
- * If yes a pointer to the NAT entry is returned. Otherwise NULL.
- *
- * @param iphdr The IP header.
- * @param tcphdr The TCP header.
- * @return A pointer to an existing NAT entry or NULL if none is found.
- */
-static ip_nat_entries_tcp_t *
-ip_nat_tcp_lookup_incoming(const struct ip_hdr *iphdr, const struct tcp_hdr *tcphdr)
+int
+ip_nat_ip4_input_hook(struct pbuf *p, struct netif *inp)
 {
-  int i;
-  ip_nat_entries_tcp_t *nat_entry = NULL;
+  if (ip_nat_cfg == NULL) {
+    return 0;
+  }
+  if (ip_nat_input(p, inp)) {
+    return 1;
+  }
+  return ip_nat_out(p, inp);
+}
 
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    if (ip_nat_tcp_table[i].common.ttl) {
-      if ((iphdr->src.addr == ip_nat_tcp_table[i].common.dest.addr) &&
-          (tcphdr->src == ip_nat_tcp_table[i].dport) &&
-          (tcphdr->dest == ip_nat_tcp_table[i].nport)) {
-        nat_entry = &ip_nat_tcp_table[i];
+#if LWIP_TCPIP_CORE_LOCKING
+/** Lock-free look at the raw packet: could it be NAT traffic at all? */
+static u8_t
+ip_nat_fast_candidate(const struct ip_hdr *iphdr, struct netif *inp)
+{
+  const u8_t *l4hdr = (const u8_t *)iphdr + IPH_HL(iphdr) * 4;
+  u16_t port;
 
-        ip_nat_dbg_dump_tcp_nat_entry("ip_nat_tcp_lookup_incoming: found existing nat entry: ",
-                                      nat_entry);
+  if (IPH_V(iphdr) != 4) {
+    return 0;
+  }
+  if (ip4_addr_cmp(&iphdr->dest, netif_ip4_addr(inp))) {
+    /* addressed to us: only replies to the NAT port range */
+    switch (IPH_PROTO(iphdr)) {
+      case IP_PROTO_TCP:
+      case IP_PROTO_UDP:
+        /* destination port is at the same offset in both headers */
+        port = lwip_ntohs(((const struct udp_hdr *)l4hdr)->dest);
         break;
-      }
+      case IP_PROTO_ICMP:
+        port = lwip_ntohs(((const struct icmp_echo_hdr *)l4hdr)->id);
+        break;
+      default:
+        return 0;
     }
+    return (u16_t)(port - LWIP_NAT_PORT_BASE) < LWIP_NAT_SESSION_NUM;
   }
-  return nat_entry;
+  return !ip4_addr_ismulticast(&iphdr->dest) && !ip4_addr_isbroadcast(&iphdr->dest, inp);
 }
+#endif /* LWIP_TCPIP_CORE_LOCKING */
 
 /**
- * This function checks if we already have a NAT entry for this TCP connection.
- * If yes the a pointer to this NAT entry is returned.
+ * netif->input for interfaces taking part in NAT.
  *
- * @param nat_config NAT config entry
- * @param iphdr The IP header.
- * @param tcphdr The TCP header.
- * @param allocate If no existing NAT entry is found and this flag is true
- *   a NAT entry is allocated.
+ * Candidate packets are translated and sent right here in the receiving
+ * thread with the core lock held, which saves allocating a tcpip message
+ * and switching to the tcpip thread for every forwarded packet. Anything
+ * else, including ARP and traffic for local sockets, goes to tcpip_input().
  */
-static ip_nat_entries_tcp_t *
-ip_nat_tcp_lookup_outgoing(ip_nat_conf_t *nat_config, const struct ip_hdr *iphdr,
-                           const struct tcp_hdr *tcphdr, u8_t allocate)
+err_t
+ip_nat_netif_input(struct pbuf *p, struct netif *inp)
 {
-  int i;
-  nat_entry_t nat_entry;
-  int last_free = -1;
-
-  nat_entry.cmn = NULL;
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    if (ip_nat_tcp_table[i].common.ttl) {
-      if ((iphdr->src.addr == ip_nat_tcp_table[i].common.source.addr) &&
-          (iphdr->dest.addr == ip_nat_tcp_table[i].common.dest.addr) &&
-          (tcphdr->src == ip_nat_tcp_table[i].sport) &&
-          (tcphdr->dest == ip_nat_tcp_table[i].dport)) {
-        nat_entry.tcp = &ip_nat_tcp_table[i];
-
-        ip_nat_dbg_dump_tcp_nat_entry("ip_nat_tcp_lookup_outgoing: found existing nat entry: ",
-                                      nat_entry.tcp);
-        break;
-      }
-    } else {
-        last_free = i;
+#if LWIP_TCPIP_CORE_LOCKING
+  struct ip_hdr *iphdr;
+  u32_t before;
+  u16_t off = 0;
+  u8_t consumed = 0;
+
+  if (inp->flags & NETIF_FLAG_ETHARP) {
+    if (p->len < SIZEOF_ETH_HDR || ((struct eth_hdr *)p->payload)->type != PP_HTONS(ETHTYPE_IP)) {
+      return tcpip_input(p, inp);
     }
+    off = SIZEOF_ETH_HDR;
   }
-  if (nat_entry.cmn == NULL) {
-    if (allocate) {
-      if (last_free != -1) {
-        nat_entry.tcp = &ip_nat_tcp_table[last_free];
-        nat_entry.tcp->nport = htons((u16_t) (LWIP_NAT_DEFAULT_TCP_SOURCE_PORT + i));
-        nat_entry.tcp->sport = tcphdr->src;
-        nat_entry.tcp->dport = tcphdr->dest;
-        ip_nat_cmn_init(nat_config, iphdr, nat_entry.cmn);
-
-        ip_nat_dbg_dump_tcp_nat_entry("ip_nat_tcp_lookup_outgoing: created new nat entry: ",
-                                      nat_entry.tcp);
-      } else {
-        LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_udp_lookup_outgoing: no more NAT entries available\n"));
-        // rt_kprintf("ip_nat_udp_lookup_outgoing: no more NAT entries available\n");
-      }
+  iphdr = (struct ip_hdr *)((u8_t *)p->payload + off);
+  if (p->len < off + IP_HLEN + 8 || p->len < off + IPH_HL(iphdr) * 4 + 8 ||
+      !ip_nat_fast_candidate(iphdr, inp)) {
+    return tcpip_input(p, inp);
+  }
+
+  LOCK_TCPIP_CORE();
+  if (ip_nat_cfg != NULL && pbuf_header(p, -(s16_t)off) == 0) {
+    before = ip_nat_stats.in_pkts + ip_nat_stats.out_pkts;
+    consumed = ip_nat_input(p, inp) || ip_nat_out(p, inp);
+    if (!consumed) {
+      pbuf_header(p, (s16_t)off);
+    } else if (ip_nat_stats.in_pkts + ip_nat_stats.out_pkts != before) {
+      ip_nat_stats.fast_pkts++;
     }
   }
-  return nat_entry.tcp;
+  UNLOCK_TCPIP_CORE();
+
+  if (consumed) {
+    return ERR_OK;
+  }
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+  return tcpip_input(p, inp);
 }
 
 /** Adjusts the checksum of a NAT'ed packet without having to completely recalculate it
- * @todo: verify this works for little- and big-endian
  *
  * @param chksum points to the chksum in the packet
  * @param optr points to the old data in the packet
@@ -935,8 +824,6 @@ ip_nat_chksum_adjust(u8_t *chksum, const u8_t *optr, s16_t olen, const u8_t *npt
   LWIP_ASSERT("NULL != chksum", NULL != chksum);
   LWIP_ASSERT("NULL != optr", NULL != optr);
   LWIP_ASSERT("NULL != nptr", NULL != nptr);
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_chksum_adjust: chksum=%p, optr=%p, olen=%" U16_F ", nptr=%p, nlen=%" U16_F "\n",
-    chksum, optr, olen, nptr, nlen));
   x = chksum[0] * 256 + chksum[1];
   x = ~x & 0xFFFF;
   while (olen) {
@@ -962,171 +849,156 @@ ip_nat_chksum_adjust(u8_t *chksum, const u8_t *optr, s16_t olen, const u8_t *npt
   x = ~x & 0xFFFF;
   chksum[0] = x / 256;
   chksum[1] = x & 0xff;
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_chksum_adjust: chksum = 0x%x\n", *((u16_t *) chksum)));
 }
 
-#if defined(LWIP_DEBUG) && (LWIP_NAT_DEBUG & LWIP_DBG_ON)
-/**
- * This function dumps an IP address
- *
- * @param addr IP address
- */
-static void
-ip_nat_dbg_dump_ip(const ip_addr_t *addr)
-{
-  LWIP_ASSERT("NULL != addr", NULL != addr);
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("%" U16_F ".%" U16_F ".%" U16_F ".%" U16_F,
-    ip4_addr1(addr), ip4_addr2(addr), ip4_addr3(addr), ip4_addr4(addr)));
-}
+#ifdef RT_USING_WIFI
+#include <wlan_mgnt.h>
+#include <netdev.h>
 
-/**
- * This function dumps an IP header
- *
- * @param msg a message to print
- * @param iphdr IP header
- */
-static void
-ip_nat_dbg_dump(const char *msg, const struct ip_hdr *iphdr)
-{
-  LWIP_ASSERT("NULL != msg", NULL != msg);
-  LWIP_ASSERT("NULL != iphdr", NULL != iphdr);
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("%s: IP: (", msg));
-  ip_nat_dbg_dump_ip((ip_addr_t *)&(iphdr->src));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" --> "));
-  ip_nat_dbg_dump_ip((ip_addr_t *)&(iphdr->dest));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" id=%" U16_F ", chksum=%" U16_F ")\n",
-    ntohs(IPH_ID(iphdr)), ntohs(IPH_CHKSUM(iphdr))));
-}
+static ip_nat_entry_t ip_nat_ap_sta_entry;
+static u8_t ip_nat_ap_sta_active;
+#ifdef LWIP_NAT_USING_FASTPATH
+/* input functions replaced by the fast path, put back on disable */
+static netif_input_fn ip_nat_ap_sta_in_input;
+static netif_input_fn ip_nat_ap_sta_out_input;
+#endif
 
-/**
- * This function dumps an ICMP echo reply/recho request nat entry.
- *
- * @param msg a message to print
- * @param nat_entry the ICMP NAT entry to print
- */
-static void
-ip_nat_dbg_dump_icmp_nat_entry(const char *msg, const ip_nat_entries_icmp_t *nat_entry)
+static struct netif *
+ip_nat_wlan_netif(const char *name)
 {
-  LWIP_ASSERT("NULL != msg", NULL != msg);
-  LWIP_ASSERT("NULL != nat_entry", NULL != nat_entry);
-  LWIP_ASSERT("NULL != nat_entry->common.cfg", NULL != nat_entry->common.cfg);
-  LWIP_ASSERT("NULL != nat_entry->common.cfg->entry.out_if",
-    NULL != nat_entry->common.cfg->entry.out_if);
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("%s", msg));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ICMP : ("));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.source));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" --> "));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.dest));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" id=%" U16_F, ntohs(nat_entry->id)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (", seq=%" U16_F, ntohs(nat_entry->seqno)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (") mapped at ("));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.cfg->entry.out_if->ip_addr));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" --> "));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.dest));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" id=%" U16_F, ntohs(nat_entry->id)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (", seq=%" U16_F, ntohs(nat_entry->seqno)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (")\n"));
-}
+  struct rt_wlan_device *wlan = (struct rt_wlan_device *)rt_device_find(name);
 
-/**
- * This function dumps an TCP nat entry.
- *
- * @param msg a message to print
- * @param nat_entry the TCP NAT entry to print
- */
-static void
-ip_nat_dbg_dump_tcp_nat_entry(const char *msg, const ip_nat_entries_tcp_t *nat_entry)
-{
-  LWIP_ASSERT("NULL != msg", NULL != msg);
-  LWIP_ASSERT("NULL != nat_entry", NULL != nat_entry);
-  LWIP_ASSERT("NULL != nat_entry->common.cfg", NULL != nat_entry->common.cfg);
-  LWIP_ASSERT("NULL != nat_entry->common.cfg->entry.out_if",
-    NULL != nat_entry->common.cfg->entry.out_if);
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("%s", msg));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("TCP : ("));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.source));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (":%" U16_F, ntohs(nat_entry->sport)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" --> "));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.dest));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (":%" U16_F, ntohs(nat_entry->dport)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (") mapped at ("));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.cfg->entry.out_if->ip_addr));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (":%" U16_F, ntohs(nat_entry->nport)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" --> "));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.dest));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (":%" U16_F, ntohs(nat_entry->dport)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (")\n"));
+  if (wlan == RT_NULL || wlan->netdev == RT_NULL) {
+    return NULL;
+  }
+  return (struct netif *)wlan->netdev->user_data;
 }
 
 /**
- * This function dumps a UDP NAT entry.
+ * Forward the AP network out through the STA interface.
  *
- * @param msg a message to print
- * @param nat_entry the UDP NAT entry to print
+ * The AP has to be started first so its subnet is known; the STA may
+ * connect later, packets are only translated while it has an address.
  */
-static void
-ip_nat_dbg_dump_udp_nat_entry(const char *msg, const ip_nat_entries_udp_t *nat_entry)
+rt_err_t
+ip_nat_ap_sta_enable(void)
 {
-  LWIP_ASSERT("NULL != msg", NULL != msg);
-  LWIP_ASSERT("NULL != nat_entry", NULL != nat_entry);
-  LWIP_ASSERT("NULL != nat_entry->common.cfg", NULL != nat_entry->common.cfg);
-  LWIP_ASSERT("NULL != nat_entry->common.cfg->entry.out_if",
-    NULL != nat_entry->common.cfg->entry.out_if);
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("%s", msg));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("UDP : ("));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.source));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (":%" U16_F, ntohs(nat_entry->sport)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" --> "));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.dest));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (":%" U16_F, ntohs(nat_entry->dport)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (") mapped at ("));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.cfg->entry.out_if->ip_addr));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (":%" U16_F, ntohs(nat_entry->nport)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" --> "));
-  ip_nat_dbg_dump_ip(&(nat_entry->common.dest));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (":%" U16_F, ntohs(nat_entry->dport)));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (")\n"));
+  struct netif *sta_if = ip_nat_wlan_netif(RT_WLAN_DEVICE_STA_NAME);
+  struct netif *ap_if = ip_nat_wlan_netif(RT_WLAN_DEVICE_AP_NAME);
+  ip_nat_entry_t *entry = &ip_nat_ap_sta_entry;
+  err_t err;
+
+  if (ip_nat_ap_sta_active) {
+    return RT_EOK;
+  }
+  if (sta_if == NULL || ap_if == NULL || !rt_wlan_ap_is_active() ||
+      ip4_addr_isany_val(*netif_ip4_addr(ap_if))) {
+    return -RT_ERROR;
+  }
+
+  memset(entry, 0, sizeof(ip_nat_entry_t));
+  entry->in_if = ap_if;
+  entry->out_if = sta_if;
+  ip4_addr_set_u32(ip_2_ip4(&entry->source_net),
+                   ip4_addr_get_u32(netif_ip4_addr(ap_if)) & ip4_addr_get_u32(netif_ip4_netmask(ap_if)));
+  ip4_addr_copy(*ip_2_ip4(&entry->source_netmask), *netif_ip4_netmask(ap_if));
+
+  LOCK_TCPIP_CORE();
+  err = ip_nat_add(entry);
+  if (err == ERR_OK) {
+#ifdef LWIP_NAT_USING_FASTPATH
+    ip_nat_ap_sta_in_input = ap_if->input;
+    ip_nat_ap_sta_out_input = sta_if->input;
+    ap_if->input = ip_nat_netif_input;
+    sta_if->input = ip_nat_netif_input;
+#endif
+    ip_nat_ap_sta_active = 1;
+  }
+  UNLOCK_TCPIP_CORE();
+
+  return err == ERR_OK ? RT_EOK : -RT_ENOMEM;
 }
 
-/** Prints some info when creating a new NAT entry */
-static void
-ip_nat_dbg_dump_init(ip_nat_conf_t *ip_nat_cfg_new)
+void
+ip_nat_ap_sta_disable(void)
 {
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_init: added new NAT interface\n"));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_init:   "));
-  ip_nat_dbg_dump_ip(&(ip_nat_cfg_new->entry.source_net));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("/"));
-  ip_nat_dbg_dump_ip(&(ip_nat_cfg_new->entry.source_netmask));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("@"));
-  ip_nat_dbg_dump_ip(&(ip_nat_cfg_new->entry.in_if->ip_addr));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" --> "));
-  ip_nat_dbg_dump_ip(&(ip_nat_cfg_new->entry.dest_net));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("/"));
-  ip_nat_dbg_dump_ip(&(ip_nat_cfg_new->entry.dest_netmask));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("@"));
-  ip_nat_dbg_dump_ip(&(ip_nat_cfg_new->entry.out_if->ip_addr));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("\n"));
+  if (!ip_nat_ap_sta_active) {
+    return;
+  }
+
+  LOCK_TCPIP_CORE();
+#ifdef LWIP_NAT_USING_FASTPATH
+  ip_nat_ap_sta_entry.in_if->input = ip_nat_ap_sta_in_input;
+  ip_nat_ap_sta_entry.out_if->input = ip_nat_ap_sta_out_input;
+#endif
+  ip_nat_remove(&ip_nat_ap_sta_entry);
+  ip_nat_ap_sta_active = 0;
+  UNLOCK_TCPIP_CORE();
 }
+#endif /* RT_USING_WIFI */
+
+#ifdef RT_USING_FINSH
+#include <finsh.h>
 
-/** Prints some info when removing a NAT entry */
 static void
-ip_nat_dbg_dump_remove(ip_nat_conf_t *cur)
+nat(int argc, char **argv)
 {
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_remove: removing existing NAT interface\n"));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("ip_nat_remove:   "));
-  ip_nat_dbg_dump_ip(&(cur->entry.source_net));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("/"));
-  ip_nat_dbg_dump_ip(&(cur->entry.source_netmask));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("@"));
-  ip_nat_dbg_dump_ip(&(cur->entry.in_if->ip_addr));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, (" --> "));
-  ip_nat_dbg_dump_ip(&(cur->entry.dest_net));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("/"));
-  ip_nat_dbg_dump_ip(&(cur->entry.dest_netmask));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("@"));
-  ip_nat_dbg_dump_ip(&(cur->entry.out_if->ip_addr));
-  LWIP_DEBUGF(LWIP_NAT_DEBUG, ("\n"));
+  ip_nat_stats_t stats;
+  ip_nat_session_t table[8];
+  u32_t now;
+  int i, shown = 0;
+
+  if (argc > 1 && strcmp(argv[1], "flush") == 0) {
+    ip_nat_conf_t *cfg;
+
+    LOCK_TCPIP_CORE();
+    for (cfg = ip_nat_cfg; cfg != NULL; cfg = cfg->next) {
+      ip_nat_reset_state(cfg);
+    }
+    UNLOCK_TCPIP_CORE();
+    return;
+  }
+#ifdef RT_USING_WIFI
+  if (argc > 2 && strcmp(argv[1], "ap_sta") == 0) {
+    if (strcmp(argv[2], "on") == 0) {
+      if (ip_nat_ap_sta_enable() != RT_EOK) {
+        rt_kprintf("start the AP first (wifi ap <ssid> [password])\n");
+      }
+    } else {
+      ip_nat_ap_sta_disable();
+    }
+    return;
+  }
+#endif
+
+  LOCK_TCPIP_CORE();
+  ip_nat_get_stats(&stats);
+  now = sys_now();
+  for (i = 0; i < LWIP_NAT_SESSION_NUM && shown < 8; i++) {
+    if (ip_nat_table[i].cfg != NULL) {
+      table[shown++] = ip_nat_table[i];
+    }
+  }
+  UNLOCK_TCPIP_CORE();
+
+  rt_kprintf("sessions %u/%u, created %u, expired %u\n", stats.sessions, LWIP_NAT_SESSION_NUM,
+             stats.created, stats.expired);
+  rt_kprintf("packets out %u, in %u, fast path %u\n", stats.out_pkts, stats.in_pkts, stats.fast_pkts);
+  rt_kprintf("drops table full %u, header %u, ttl %u, output %u\n", stats.drop_full, stats.drop_hdr,
+             stats.drop_ttl, stats.drop_output);
+  for (i = 0; i < shown; i++) {
+    ip_nat_session_t *s = &table[i];
+    rt_kprintf("  %-4s %s:%u", s->proto == IP_PROTO_TCP ? "tcp" : s->proto == IP_PROTO_UDP ? "udp" : "icmp",
+               ip4addr_ntoa(&s->source), lwip_ntohs(s->sport));
+    rt_kprintf(" -> %s:%u idle %us\n", ip4addr_ntoa(&s->dest), lwip_ntohs(s->dport),
+               (now - s->last_used) / 1000);
+  }
 }
-#endif /* defined(LWIP_DEBUG) && (LWIP_NAT_DEBUG & LWIP_DBG_ON) */
+#ifdef RT_USING_WIFI
+MSH_CMD_EXPORT(nat, show NAT sessions and counters: nat [flush | ap_sta on|off]);
+#else
+MSH_CMD_EXPORT(nat, show NAT sessions and counters: nat [flush]);
+#endif
+#endif /* RT_USING_FINSH */
 
-#endif /* IP_NAT */
+#endif /* LWIP_USING_NAT */
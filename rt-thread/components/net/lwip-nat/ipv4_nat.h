@@ -31,6 +31,7 @@
  * Date           Author       Notes
  * 2015-01-26     Hichard      porting to RT-Thread
  * 2015-01-27     Bernard      code cleanup for lwIP in RT-Thread
+ * 2025-02-17     RT-Thread    lwIP 2.x input hook, hashed sessions, fast path, stats
  */
 
 #ifndef __LWIP_NAT_H__
@@ -45,7 +46,7 @@
 #include "lwip/opt.h"
 
 /** Timer interval at which to call ip_nat_tmr() */
-#define LWIP_NAT_TMR_INTERVAL_SEC        (30)
+#define LWIP_NAT_TMR_INTERVAL_SEC        (5)
 
 #ifdef __cplusplus
 extern "C" {
@@ -64,13 +65,40 @@ typedef struct ip_nat_entry
   struct netif *in_if;
 } ip_nat_entry_t;
 
+/** Translation and drop counters, see ip_nat_get_stats() */
+typedef struct ip_nat_stats
+{
+  u32_t out_pkts;        /* inside -> outside packets translated */
+  u32_t in_pkts;         /* outside -> inside packets translated */
+  u32_t fast_pkts;       /* of these, forwarded without a tcpip thread round-trip */
+  u32_t sessions;        /* sessions in use */
+  u32_t created;
+  u32_t expired;
+  u32_t drop_full;       /* no free session */
+  u32_t drop_hdr;        /* short packet, bad header checksum, fragment */
+  u32_t drop_ttl;
+  u32_t drop_output;     /* link layer refused the translated packet */
+} ip_nat_stats_t;
+
 void  ip_nat_init(void);
 void  ip_nat_tmr(void);
-u8_t  ip_nat_input(struct pbuf *p);
-u8_t  ip_nat_out(struct pbuf *p);
+u8_t  ip_nat_input(struct pbuf *p, struct netif *inp);
+u8_t  ip_nat_out(struct pbuf *p, struct netif *inp);
+
+/* LWIP_HOOK_IP4_INPUT, returns 1 if the packet was translated and consumed */
+int   ip_nat_ip4_input_hook(struct pbuf *p, struct netif *inp);
+
+/* netif input function doing established sessions under the core lock,
+   everything else goes through tcpip_input() */
+err_t ip_nat_netif_input(struct pbuf *p, struct netif *inp);
 
 err_t ip_nat_add(const ip_nat_entry_t *new_entry);
 void  ip_nat_remove(const ip_nat_entry_t *remove_entry);
+void  ip_nat_get_stats(ip_nat_stats_t *stats);
+
+/* AP+STA forwarding: NAT from the AP network out through the STA interface */
+rt_err_t ip_nat_ap_sta_enable(void);
+void     ip_nat_ap_sta_disable(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-17     RT-Thread    First version
+ */
+
+/*
+ * NAT forwarding benchmark between two virtual interfaces.
+ *
+ * "ni" (10.10.0.1/24) plays the AP side and "no" (10.20.0.1/24) the STA side.
+ * Their output functions only count packets, so the numbers are the cost of
+ * input, translation and handing the packet to the link layer. UDP flows are
+ * sent from 10.10.0.2 to 10.20.0.2, then answered to the translated ports,
+ * once through tcpip_input() and once through ip_nat_netif_input().
+ */
+
+#include <rtthread.h>
+#include "ipv4_nat.h"
+
+#if defined(LWIP_USING_NAT) && defined(RT_USING_FINSH)
+
+#include <stdlib.h>
+#include <string.h>
+#include <finsh.h>
+
+#include "lwip/netif.h"
+#include "lwip/tcpip.h"
+#include "lwip/ip.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+
+#define NAT_BENCH_FLOWS             16
+#define NAT_BENCH_PAYLOAD           64
+#define NAT_BENCH_INSIDE_PORT       5000
+#define NAT_BENCH_REMOTE_PORT       9000
+
+static struct netif bench_in_if;
+static struct netif bench_out_if;
+static volatile rt_uint32_t bench_out_cnt;
+static volatile rt_uint32_t bench_in_cnt;
+static u16_t bench_nport[NAT_BENCH_FLOWS];
+
+/* outside link: remember the translated port of each flow for the replies */
+static err_t bench_out_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    struct udp_hdr *udphdr = (struct udp_hdr *)((u8_t *)p->payload + IP_HLEN);
+    int flow = lwip_ntohs(udphdr->dest) - NAT_BENCH_REMOTE_PORT;
+
+    if (flow >= 0 && flow < NAT_BENCH_FLOWS)
+    {
+        bench_nport[flow] = udphdr->src;
+    }
+    bench_out_cnt++;
+    return ERR_OK;
+}
+
+static err_t bench_in_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    bench_in_cnt++;
+    return ERR_OK;
+}
+
+static err_t bench_netif_init(struct netif *netif)
+{
+    netif->name[0] = 'n';
+    netif->name[1] = (netif == &bench_out_if) ? 'o' : 'i';
+    netif->output = (netif == &bench_out_if) ? bench_out_output : bench_in_output;
+    netif->mtu = 1500;
+    netif->flags = NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+static struct pbuf *bench_packet(const ip4_addr_t *src, u16_t sport, const ip4_addr_t *dst, u16_t dport)
+{
+    struct pbuf *p;
+    struct ip_hdr *iphdr;
+    struct udp_hdr *udphdr;
+    u16_t len = IP_HLEN + UDP_HLEN + NAT_BENCH_PAYLOAD;
+
+    p = pbuf_alloc(PBUF_LINK, len, PBUF_RAM);
+    if (p == RT_NULL)
+    {
+        return RT_NULL;
+    }
+    memset(p->payload, 0, len);
+
+    udphdr = (struct udp_hdr *)((u8_t *)p->payload + IP_HLEN);
+    udphdr->src = lwip_htons(sport);
+    udphdr->dest = lwip_htons(dport);
+    udphdr->len = lwip_htons(UDP_HLEN + NAT_BENCH_PAYLOAD);
+    pbuf_header(p, -IP_HLEN);
+    udphdr->chksum = inet_chksum_pseudo(p, IP_PROTO_UDP, p->tot_len, src, dst);
+    if (udphdr->chksum == 0)
+    {
+        udphdr->chksum = 0xffff;
+    }
+    pbuf_header(p, IP_HLEN);
+
+    iphdr = (struct ip_hdr *)p->payload;
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_LEN_SET(iphdr, lwip_htons(len));
+    IPH_TTL_SET(iphdr, 64);
+    IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+    ip4_addr_copy(iphdr->src, *src);
+    ip4_addr_copy(iphdr->dest, *dst);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+
+    return p;
+}
+
+static rt_bool_t bench_wait(volatile rt_uint32_t *cnt, rt_uint32_t expect)
+{
+    rt_tick_t start = rt_tick_get();
+
+    while (*cnt < expect)
+    {
+        if (rt_tick_get() - start > rt_tick_from_millisecond(1000))
+        {
+            return RT_FALSE;
+        }
+        rt_thread_mdelay(1);
+    }
+    return RT_TRUE;
+}
+
+static void bench_report(const char *name, rt_uint32_t pkts, rt_uint32_t drops, rt_tick_t ticks)
+{
+    rt_uint32_t ms = ticks * 1000 / RT_TICK_PER_SECOND;
+
+    rt_kprintf("  %-9s %7u pkts %5u ms %8u pps  drops %u\n", name, pkts, ms,
+               ms ? (rt_uint32_t)((rt_uint64_t)pkts * 1000 / ms) : 0, drops);
+}
+
+static void bench_run(const char *name, netif_input_fn input, int count)
+{
+    ip4_addr_t inside, remote;
+    struct pbuf *p;
+    rt_uint32_t drops = 0;
+    rt_tick_t start;
+    int i, flow;
+
+    IP4_ADDR(&inside, 10, 10, 0, 2);
+    IP4_ADDR(&remote, 10, 20, 0, 2);
+    bench_out_cnt = 0;
+    bench_in_cnt = 0;
+
+    rt_kprintf("%s:\n", name);
+
+    start = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        flow = i % NAT_BENCH_FLOWS;
+        p = bench_packet(&inside, NAT_BENCH_INSIDE_PORT + flow, &remote, NAT_BENCH_REMOTE_PORT + flow);
+        if (p == RT_NULL || input(p, &bench_in_if) != ERR_OK)
+        {
+            if (p)
+            {
+                pbuf_free(p);
+            }
+            drops++;
+        }
+    }
+    bench_wait(&bench_out_cnt, count - drops);
+    bench_report("outbound", bench_out_cnt, count - bench_out_cnt, rt_tick_get() - start);
+
+    drops = 0;
+    start = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        flow = i % NAT_BENCH_FLOWS;
+        p = bench_packet(&remote, NAT_BENCH_REMOTE_PORT + flow, netif_ip4_addr(&bench_out_if),
+                         lwip_ntohs(bench_nport[flow]));
+        if (p == RT_NULL || input(p, &bench_out_if) != ERR_OK)
+        {
+            if (p)
+            {
+                pbuf_free(p);
+            }
+            drops++;
+        }
+    }
+    bench_wait(&bench_in_cnt, count - drops);
+    bench_report("inbound", bench_in_cnt, count - bench_in_cnt, rt_tick_get() - start);
+}
+
+static void nat_bench(int argc, char **argv)
+{
+    ip4_addr_t addr, mask, gw;
+    ip_nat_entry_t entry;
+    ip_nat_stats_t stats;
+    int count = 10000;
+
+    if (argc > 1)
+    {
+        count = atoi(argv[1]);
+    }
+
+    IP4_ADDR(&mask, 255, 255, 255, 0);
+    ip4_addr_set_zero(&gw);
+    memset(&entry, 0, sizeof(entry));
+    entry.in_if = &bench_in_if;
+    entry.out_if = &bench_out_if;
+    IP4_ADDR(ip_2_ip4(&entry.source_net), 10, 10, 0, 0);
+    IP4_ADDR(ip_2_ip4(&entry.source_netmask), 255, 255, 255, 0);
+
+    LOCK_TCPIP_CORE();
+    IP4_ADDR(&addr, 10, 10, 0, 1);
+    netif_add(&bench_in_if, &addr, &mask, &gw, RT_NULL, bench_netif_init, tcpip_input);
+    IP4_ADDR(&addr, 10, 20, 0, 1);
+    netif_add(&bench_out_if, &addr, &mask, &gw, RT_NULL, bench_netif_init, tcpip_input);
+    netif_set_up(&bench_in_if);
+    netif_set_up(&bench_out_if);
+    if (ip_nat_add(&entry) != ERR_OK)
+    {
+        UNLOCK_TCPIP_CORE();
+        rt_kprintf("ip_nat_add failed\n");
+        goto __exit;
+    }
+    UNLOCK_TCPIP_CORE();
+
+    rt_kprintf("NAT forwarding, %d UDP packets of %d bytes over %d flows\n", count,
+               IP_HLEN + UDP_HLEN + NAT_BENCH_PAYLOAD, NAT_BENCH_FLOWS);
+    bench_run("tcpip_input", tcpip_input, count);
+    bench_run("ip_nat_netif_input", ip_nat_netif_input, count);
+
+    LOCK_TCPIP_CORE();
+    ip_nat_get_stats(&stats);
+    ip_nat_remove(&entry);
+    UNLOCK_TCPIP_CORE();
+    rt_kprintf("fast path packets %u, sessions created %u\n", stats.fast_pkts, stats.created);
+
+__exit:
+    LOCK_TCPIP_CORE();
+    netif_remove(&bench_in_if);
+    netif_remove(&bench_out_if);
+    UNLOCK_TCPIP_CORE();
+}
+MSH_CMD_EXPORT(nat_bench, NAT forwarding rate between two virtual netifs: nat_bench [packets]);
+
+#endif /* LWIP_USING_NAT && RT_USING_FINSH */
@@ -55,6 +55,17 @@
 #define TCPIP_MSG_VAR_ALLOC(name)   API_VAR_ALLOC(struct tcpip_msg, MEMP_TCPIP_MSG_API, name, ERR_MEM)
 #define TCPIP_MSG_VAR_FREE(name)    API_VAR_FREE(MEMP_TCPIP_MSG_API, name)
 
+/* optional port hook timing API calls into the tcpip core: LWIP_HOOK_TCPIP_API_DONE(wait, exec) */
+#ifdef LWIP_HOOK_TCPIP_API_DONE
+#define TCPIP_API_PROF_DECLARE()    u64_t prof_t0 = LWIP_HOOK_TCPIP_API_TIME(), prof_t1 = prof_t0
+#define TCPIP_API_PROF_LOCKED()     prof_t1 = LWIP_HOOK_TCPIP_API_TIME()
+#define TCPIP_API_PROF_DONE()       LWIP_HOOK_TCPIP_API_DONE(prof_t1 - prof_t0, LWIP_HOOK_TCPIP_API_TIME() - prof_t1)
+#else
+#define TCPIP_API_PROF_DECLARE()
+#define TCPIP_API_PROF_LOCKED()
+#define TCPIP_API_PROF_DONE()
+#endif
+
 /* global variables */
 static tcpip_init_done_fn tcpip_init_done;
 static void *tcpip_init_done_arg;
@@ -437,13 +448,17 @@ err_t
 tcpip_send_msg_wait_sem(tcpip_callback_fn fn, void *apimsg, sys_sem_t *sem)
 {
 #if LWIP_TCPIP_CORE_LOCKING
+  TCPIP_API_PROF_DECLARE();
   LWIP_UNUSED_ARG(sem);
   LOCK_TCPIP_CORE();
+  TCPIP_API_PROF_LOCKED();
   fn(apimsg);
   UNLOCK_TCPIP_CORE();
+  TCPIP_API_PROF_DONE();
   return ERR_OK;
 #else /* LWIP_TCPIP_CORE_LOCKING */
   TCPIP_MSG_VAR_DECLARE(msg);
+  TCPIP_API_PROF_DECLARE();
 
   LWIP_ASSERT("semaphore not initialized", sys_sem_valid(sem));
   LWIP_ASSERT("Invalid mbox", sys_mbox_valid_val(tcpip_mbox));
@@ -455,6 +470,9 @@ tcpip_send_msg_wait_sem(tcpip_callback_fn fn, void *apimsg, sys_sem_t *sem)
   sys_mbox_post(&tcpip_mbox, &TCPIP_MSG_VAR_REF(msg));
   sys_arch_sem_wait(sem, 0);
   TCPIP_MSG_VAR_FREE(msg);
+  /* the mailbox round trip is reported as wait */
+  TCPIP_API_PROF_LOCKED();
+  TCPIP_API_PROF_DONE();
   return ERR_OK;
 #endif /* LWIP_TCPIP_CORE_LOCKING */
 }
@@ -474,12 +492,16 @@ tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data *call)
 {
 #if LWIP_TCPIP_CORE_LOCKING
   err_t err;
+  TCPIP_API_PROF_DECLARE();
   LOCK_TCPIP_CORE();
+  TCPIP_API_PROF_LOCKED();
   err = fn(call);
   UNLOCK_TCPIP_CORE();
+  TCPIP_API_PROF_DONE();
   return err;
 #else /* LWIP_TCPIP_CORE_LOCKING */
   TCPIP_MSG_VAR_DECLARE(msg);
+  TCPIP_API_PROF_DECLARE();
 
 #if !LWIP_NETCONN_SEM_PER_THREAD
   err_t err = sys_sem_new(&call->sem, 0);
@@ -502,6 +524,8 @@ tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data *call)
   sys_mbox_post(&tcpip_mbox, &TCPIP_MSG_VAR_REF(msg));
   sys_arch_sem_wait(TCPIP_MSG_VAR_REF(msg).msg.api_call.sem, 0);
   TCPIP_MSG_VAR_FREE(msg);
+  TCPIP_API_PROF_LOCKED();
+  TCPIP_API_PROF_DONE();
 
 #if !LWIP_NETCONN_SEM_PER_THREAD
   sys_sem_free(&call->sem);
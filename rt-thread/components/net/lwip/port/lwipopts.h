@@ -84,6 +84,14 @@
 
 #define LWIP_HAVE_LOOPIF            0
 
+#ifdef SAL_USING_PROFILE
+/* time API calls into the tcpip core for the SAL profiler (net/sal/src/sal_prof.c) */
+unsigned long long sal_prof_now(void);
+void sal_prof_tcpip(unsigned long long wait, unsigned long long exec);
+#define LWIP_HOOK_TCPIP_API_TIME()              sal_prof_now()
+#define LWIP_HOOK_TCPIP_API_DONE(wait, exec)    sal_prof_tcpip(wait, exec)
+#endif
+
 #define LWIP_PLATFORM_BYTESWAP      0
 
 /* #define RT_LWIP_DEBUG */
@@ -354,6 +362,13 @@
 
 #ifdef LWIP_USING_NAT
 #define IP_NAT                      1
+#if RT_USING_LWIP_VER_NUM >= 0x20000
+/* translate before lwIP decides whether the packet is for us (net/lwip-nat/ipv4_nat.c) */
+struct pbuf;
+struct netif;
+int ip_nat_ip4_input_hook(struct pbuf *p, struct netif *inp);
+#define LWIP_HOOK_IP4_INPUT(p, inp)     ip_nat_ip4_input_hook(p, inp)
+#endif
 #else
 #define IP_NAT                      0
 #endif
@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-05-17     ChenYong     First version
+ * 2025-02-15     RT-Thread    add sendmem for zero-copy sal_sendfile
  */
 
 #include <rtthread.h>
@@ -291,6 +292,44 @@ static int inet_poll(struct dfs_file *file, struct rt_pollreq *req)
 }
 #endif
 
+#if LWIP_VERSION >= 0x20100ff && LWIP_TCP
+#include <lwip/priv/sockets_priv.h>
+
+/*
+ * Queue stream data straight into the netconn. netconn_write_partly() waits on the
+ * TCP sent callback when the send buffer is full, so the caller gets backpressure
+ * from the peer's window. With SAL_SENDMEM_NOCOPY the segments reference the data
+ * (PBUF_REF/ROM) instead of copying it into PBUF_RAM.
+ */
+static int inet_sendmem(int socket, const void *data, size_t size, int flags)
+{
+    struct lwip_sock *sock;
+    size_t written = 0;
+    u8_t apiflags;
+    err_t err;
+
+    sock = lwip_socket_dbg_get_socket(socket);
+    if (sock == NULL || sock->conn == NULL || NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_TCP)
+    {
+        return -1;
+    }
+
+    apiflags = (flags & SAL_SENDMEM_NOCOPY) ? NETCONN_NOCOPY : NETCONN_COPY;
+    if (flags & SAL_SENDMEM_MORE)
+    {
+        apiflags |= NETCONN_MORE;
+    }
+
+    err = netconn_write_partly(sock->conn, data, size, apiflags, &written);
+    if (err != ERR_OK && written == 0)
+    {
+        return -1;
+    }
+
+    return (int)written;
+}
+#endif /* LWIP_VERSION >= 0x20100ff && LWIP_TCP */
+
 static const struct sal_socket_ops lwip_socket_ops =
 {
     .socket      = inet_socket,
@@ -316,6 +355,9 @@ static const struct sal_socket_ops lwip_socket_ops =
 #ifdef SAL_USING_POSIX
     .poll        = inet_poll,
 #endif
+#if LWIP_VERSION >= 0x20100ff && LWIP_TCP
+    .sendmem     = inet_sendmem,
+#endif
 };
 
 static const struct sal_netdb_ops lwip_netdb_ops =
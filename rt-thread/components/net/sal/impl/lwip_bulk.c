@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-16     RT-Thread    First version
+ */
+
+#include <rtthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lwip/tcp.h>
+#include <lwip/tcpip.h>
+#include <lwip/ip_addr.h>
+
+#include <sal_lwip_bulk.h>
+
+#define DBG_TAG                        "sal.bulk"
+#define DBG_LVL                        DBG_INFO
+#include <rtdbg.h>
+
+#if LWIP_TCP
+
+struct lwip_bulk_ctx
+{
+    struct tcp_pcb *pcb;
+    ip_addr_t addr;
+    rt_uint16_t port;
+
+    const struct lwip_bulk_vec *vec;
+    int vec_num;
+    int vec_idx;                       /* next buffer to queue */
+    rt_size_t vec_off;                 /* queued bytes of vec[vec_idx] */
+    rt_size_t total;
+    rt_size_t acked;
+
+    rt_uint8_t *rx_buf;
+    rt_size_t rx_size;
+    rt_size_t rx_len;
+    rt_bool_t rx_done;
+
+    err_t err;
+    rt_bool_t finished;
+    struct rt_semaphore done;
+};
+
+/* all functions below run in the tcpip thread */
+
+/* returns ERR_ABRT if the pcb was aborted, callbacks must pass that on to lwIP */
+static err_t bulk_finish(struct lwip_bulk_ctx *ctx, err_t err)
+{
+    err_t ret = ERR_OK;
+
+    if (ctx->finished)
+    {
+        return ERR_OK;
+    }
+    ctx->finished = RT_TRUE;
+    ctx->err = err;
+
+    if (ctx->pcb)
+    {
+        tcp_arg(ctx->pcb, NULL);
+        tcp_sent(ctx->pcb, NULL);
+        tcp_recv(ctx->pcb, NULL);
+        tcp_err(ctx->pcb, NULL);
+        if (err != ERR_OK || tcp_close(ctx->pcb) != ERR_OK)
+        {
+            tcp_abort(ctx->pcb);
+            ret = ERR_ABRT;
+        }
+        ctx->pcb = NULL;
+    }
+
+    rt_sem_release(&ctx->done);
+
+    return ret;
+}
+
+static err_t bulk_check_done(struct lwip_bulk_ctx *ctx)
+{
+    if (ctx->acked == ctx->total && (ctx->rx_buf == RT_NULL || ctx->rx_done))
+    {
+        return bulk_finish(ctx, ERR_OK);
+    }
+
+    return ERR_OK;
+}
+
+/* queue as much as the send buffer takes, the rest goes out from bulk_sent() */
+static void bulk_fill(struct lwip_bulk_ctx *ctx)
+{
+    while (ctx->vec_idx < ctx->vec_num)
+    {
+        const struct lwip_bulk_vec *vec = &ctx->vec[ctx->vec_idx];
+        rt_size_t left = vec->len - ctx->vec_off;
+        tcpwnd_size_t room = tcp_sndbuf(ctx->pcb);
+        u16_t len;
+        u8_t flags = 0;
+
+        if (left == 0)
+        {
+            ctx->vec_idx++;
+            ctx->vec_off = 0;
+            continue;
+        }
+        if (room == 0)
+        {
+            break;
+        }
+
+        if (left > room)
+        {
+            left = room;
+        }
+        len = left > 0xFFFF ? 0xFFFF : (u16_t) left;
+        if (ctx->vec_off + len < vec->len || ctx->vec_idx + 1 < ctx->vec_num)
+        {
+            flags |= TCP_WRITE_FLAG_MORE;
+        }
+        /* ERR_MEM means the segment queue is full, retry when something is acked */
+        if (tcp_write(ctx->pcb, (const rt_uint8_t *) vec->data + ctx->vec_off, len, flags) != ERR_OK)
+        {
+            break;
+        }
+        ctx->vec_off += len;
+    }
+
+    tcp_output(ctx->pcb);
+}
+
+static err_t bulk_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+    struct lwip_bulk_ctx *ctx = (struct lwip_bulk_ctx *) arg;
+
+    ctx->acked += len;
+    bulk_fill(ctx);
+
+    return bulk_check_done(ctx);
+}
+
+static err_t bulk_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+    struct lwip_bulk_ctx *ctx = (struct lwip_bulk_ctx *) arg;
+    rt_size_t copy;
+
+    if (p == NULL)
+    {
+        /* peer closed */
+        ctx->rx_done = RT_TRUE;
+        if (ctx->acked != ctx->total)
+        {
+            return bulk_finish(ctx, ERR_CLSD);
+        }
+        return bulk_check_done(ctx);
+    }
+
+    if (ctx->rx_buf && !ctx->rx_done)
+    {
+        copy = ctx->rx_size - ctx->rx_len;
+        if (copy > p->tot_len)
+        {
+            copy = p->tot_len;
+        }
+        ctx->rx_len += pbuf_copy_partial(p, ctx->rx_buf + ctx->rx_len, (u16_t) copy, 0);
+        if (ctx->rx_len == ctx->rx_size)
+        {
+            ctx->rx_done = RT_TRUE;
+        }
+    }
+    tcp_recved(pcb, p->tot_len);
+    pbuf_free(p);
+
+    return bulk_check_done(ctx);
+}
+
+static void bulk_err(void *arg, err_t err)
+{
+    struct lwip_bulk_ctx *ctx = (struct lwip_bulk_ctx *) arg;
+
+    /* the pcb is already freed */
+    ctx->pcb = NULL;
+    bulk_finish(ctx, err);
+}
+
+static err_t bulk_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+    struct lwip_bulk_ctx *ctx = (struct lwip_bulk_ctx *) arg;
+
+    if (err != ERR_OK)
+    {
+        return bulk_finish(ctx, err);
+    }
+
+    tcp_nagle_disable(pcb);
+    bulk_fill(ctx);
+
+    return bulk_check_done(ctx);
+}
+
+static void bulk_start(void *arg)
+{
+    struct lwip_bulk_ctx *ctx = (struct lwip_bulk_ctx *) arg;
+    err_t err;
+
+    ctx->pcb = tcp_new_ip_type(IP_GET_TYPE(&ctx->addr));
+    if (ctx->pcb == NULL)
+    {
+        bulk_finish(ctx, ERR_MEM);
+        return;
+    }
+
+    tcp_arg(ctx->pcb, ctx);
+    tcp_err(ctx->pcb, bulk_err);
+    tcp_recv(ctx->pcb, bulk_recv);
+    tcp_sent(ctx->pcb, bulk_sent);
+
+    err = tcp_connect(ctx->pcb, &ctx->addr, ctx->port, bulk_connected);
+    if (err != ERR_OK)
+    {
+        bulk_finish(ctx, err);
+    }
+}
+
+static void bulk_abort(void *arg)
+{
+    bulk_finish((struct lwip_bulk_ctx *) arg, ERR_TIMEOUT);
+}
+
+int lwip_bulk_send(const char *ip, rt_uint16_t port, const struct lwip_bulk_vec *vec, int vec_num,
+                   void *rx_buf, rt_size_t rx_size, rt_int32_t timeout)
+{
+    struct lwip_bulk_ctx ctx;
+    int i;
+
+    rt_memset(&ctx, 0, sizeof(ctx));
+    if (!ipaddr_aton(ip, &ctx.addr) || vec == RT_NULL || vec_num <= 0)
+    {
+        return ERR_ARG;
+    }
+    ctx.port = port;
+    ctx.vec = vec;
+    ctx.vec_num = vec_num;
+    for (i = 0; i < vec_num; i++)
+    {
+        ctx.total += vec[i].len;
+    }
+    ctx.rx_buf = (rt_uint8_t *) rx_buf;
+    ctx.rx_size = rx_buf ? rx_size : 0;
+    ctx.rx_done = (ctx.rx_size == 0);
+    rt_sem_init(&ctx.done, "bulk", 0, RT_IPC_FLAG_PRIO);
+
+    if (tcpip_callback(bulk_start, &ctx) != ERR_OK)
+    {
+        rt_sem_detach(&ctx.done);
+        return ERR_MEM;
+    }
+
+    if (rt_sem_take(&ctx.done, rt_tick_from_millisecond(timeout)) != RT_EOK)
+    {
+        /* bulk_abort does nothing if the transfer finished in the meantime */
+        while (tcpip_callback(bulk_abort, &ctx) != ERR_OK)
+        {
+            rt_thread_mdelay(10);
+        }
+        rt_sem_take(&ctx.done, RT_WAITING_FOREVER);
+    }
+    rt_sem_detach(&ctx.done);
+
+    if (ctx.err != ERR_OK)
+    {
+        LOG_D("bulk send to %s:%d failed (%d), %d/%d bytes acked", ip, port, ctx.err, ctx.acked, ctx.total);
+        return ctx.err;
+    }
+
+    return (int) ctx.rx_len;
+}
+
+/* discard server in the tcpip thread, the receiving end for loopback benchmarks */
+static struct tcp_pcb *bench_sink_pcb;
+
+static err_t sink_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+    if (p == NULL)
+    {
+        tcp_close(pcb);
+        return ERR_OK;
+    }
+    tcp_recved(pcb, p->tot_len);
+    pbuf_free(p);
+
+    return ERR_OK;
+}
+
+static err_t sink_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+    if (err != ERR_OK || pcb == NULL)
+    {
+        return ERR_VAL;
+    }
+    tcp_recv(pcb, sink_recv);
+
+    return ERR_OK;
+}
+
+static void sink_start(void *arg)
+{
+    struct tcp_pcb *pcb;
+
+    pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+    if (pcb == NULL || tcp_bind(pcb, IP_ANY_TYPE, (u16_t)(rt_ubase_t) arg) != ERR_OK)
+    {
+        if (pcb)
+        {
+            tcp_close(pcb);
+        }
+        rt_kprintf("sink start failed\n");
+        return;
+    }
+    bench_sink_pcb = tcp_listen(pcb);
+    if (bench_sink_pcb == NULL)
+    {
+        tcp_close(pcb);
+        rt_kprintf("sink start failed\n");
+        return;
+    }
+    tcp_accept(bench_sink_pcb, sink_accept);
+}
+
+int lwip_bulk_sink(rt_uint16_t port)
+{
+    return tcpip_callback(sink_start, (void *)(rt_ubase_t) port);
+}
+
+#endif /* LWIP_TCP */
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-16     RT-Thread    First version
+ */
+
+#include <rtthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(RT_USING_FINSH) && defined(SAL_USING_POSIX)
+#include <finsh.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+#include <sal_lwip_bulk.h>
+
+#define BULK_BENCH_BUF_SIZE            4096
+
+static int bench_socket_send(const char *ip, int port, const rt_uint8_t *buf, rt_size_t total, rt_size_t chunk)
+{
+    struct sockaddr_in addr;
+    rt_size_t sent = 0;
+    int sock, ret, opt = 1;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+    {
+        return -1;
+    }
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    rt_memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+    if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    {
+        closesocket(sock);
+        return -1;
+    }
+    while (sent < total)
+    {
+        ret = send(sock, buf, total - sent > chunk ? chunk : total - sent, 0);
+        if (ret <= 0)
+        {
+            break;
+        }
+        sent += ret;
+    }
+    closesocket(sock);
+
+    return (int) sent;
+}
+
+static void bench_report(const char *name, rt_size_t bytes, rt_tick_t ticks)
+{
+    rt_uint32_t ms = ticks * 1000 / RT_TICK_PER_SECOND;
+
+    rt_kprintf("%-14s %8d bytes %6d ms %6d KB/s\n", name, bytes, ms,
+               ms ? (int)((rt_uint64_t) bytes * 1000 / 1024 / ms) : 0);
+}
+
+/*
+ * sal_bulk_bench sink <port>                    start a discard server on this board
+ * sal_bulk_bench <ip> <port> [kbytes] [chunk]   socket send() loop vs lwip_bulk_send()
+ *
+ * With RT_LWIP_NETIF_LOOPBACK enabled, run the sink and target the board's own
+ * address to compare the paths without radio time.
+ */
+static void sal_bulk_bench(int argc, char **argv)
+{
+    struct lwip_bulk_vec *vec;
+    rt_uint8_t *buf;
+    rt_size_t total, chunk = 512;
+    rt_tick_t start;
+    int i, vec_num, ret;
+
+    if (argc == 3 && strcmp(argv[1], "sink") == 0)
+    {
+        lwip_bulk_sink(atoi(argv[2]));
+        return;
+    }
+    if (argc < 3)
+    {
+        rt_kprintf("Usage: sal_bulk_bench sink <port>\n");
+        rt_kprintf("       sal_bulk_bench <ip> <port> [kbytes] [chunk]\n");
+        return;
+    }
+    total = (argc > 3 ? atoi(argv[3]) : 256) * 1024;
+    if (argc > 4)
+    {
+        chunk = atoi(argv[4]);
+    }
+    if (chunk == 0 || chunk > BULK_BENCH_BUF_SIZE)
+    {
+        chunk = BULK_BENCH_BUF_SIZE;
+    }
+
+    vec_num = (total + BULK_BENCH_BUF_SIZE - 1) / BULK_BENCH_BUF_SIZE;
+    buf = (rt_uint8_t *) rt_malloc(BULK_BENCH_BUF_SIZE);
+    vec = (struct lwip_bulk_vec *) rt_malloc(vec_num * sizeof(struct lwip_bulk_vec));
+    if (buf == RT_NULL || vec == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        goto __exit;
+    }
+    for (i = 0; i < BULK_BENCH_BUF_SIZE; i++)
+    {
+        buf[i] = (rt_uint8_t) i;
+    }
+    for (i = 0; i < vec_num; i++)
+    {
+        vec[i].data = buf;
+        vec[i].len = (i == vec_num - 1) ? total - i * BULK_BENCH_BUF_SIZE : BULK_BENCH_BUF_SIZE;
+    }
+
+    start = rt_tick_get();
+    ret = bench_socket_send(argv[1], atoi(argv[2]), buf, total, chunk);
+    bench_report("socket(chunk)", ret > 0 ? ret : 0, rt_tick_get() - start);
+
+    start = rt_tick_get();
+    ret = bench_socket_send(argv[1], atoi(argv[2]), buf, total, BULK_BENCH_BUF_SIZE);
+    bench_report("socket(4096)", ret > 0 ? ret : 0, rt_tick_get() - start);
+
+    start = rt_tick_get();
+    ret = lwip_bulk_send(argv[1], atoi(argv[2]), vec, vec_num, RT_NULL, 0, 30000);
+    bench_report("lwip raw bulk", ret < 0 ? 0 : total, rt_tick_get() - start);
+    if (ret < 0)
+    {
+        rt_kprintf("lwip_bulk_send failed: %d\n", ret);
+    }
+
+__exit:
+    if (buf)
+    {
+        rt_free(buf);
+    }
+    if (vec)
+    {
+        rt_free(vec);
+    }
+}
+MSH_CMD_EXPORT(sal_bulk_bench, compare socket send with the lwIP raw bulk path);
+#endif /* RT_USING_FINSH && SAL_USING_POSIX */
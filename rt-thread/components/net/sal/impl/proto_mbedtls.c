@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-11-12     ChenYong     First version
+ * 2025-02-14     RT-Thread    add SNI, client session resumption and handshake statistics
  */
 
 #include <rtthread.h>
@@ -21,6 +22,7 @@
 #endif
 #include <netdb.h>
 #include <sal_low_lvl.h>
+#include <sal_prof.h>
 
 #include <netdev.h>
 
@@ -39,6 +41,130 @@
 #define SAL_MEBDTLS_BUFFER_LEN         1024
 #endif
 
+/* number of servers whose last TLS session is kept for resumption */
+#ifndef SAL_MBEDTLS_SESSION_CACHE_NUM
+#define SAL_MBEDTLS_SESSION_CACHE_NUM  2
+#endif
+
+#define SAL_MBEDTLS_HOST_LEN           64
+
+struct mbedtls_session_entry
+{
+    char host[SAL_MBEDTLS_HOST_LEN];
+    mbedtls_ssl_session session;
+    rt_tick_t tick;                             /* last use, oldest entry is replaced */
+    rt_bool_t valid;
+};
+
+struct mbedtls_handshake_stats
+{
+    rt_uint32_t full_num;
+    rt_uint32_t full_ms;
+    rt_uint32_t resumed_num;
+    rt_uint32_t resumed_ms;
+    rt_uint32_t fail_num;
+};
+
+static struct mbedtls_session_entry session_cache[SAL_MBEDTLS_SESSION_CACHE_NUM];
+static struct mbedtls_handshake_stats handshake_stats;
+static struct rt_mutex session_lock;
+
+static struct mbedtls_session_entry *session_cache_find(const char *host)
+{
+    int i;
+
+    for (i = 0; i < SAL_MBEDTLS_SESSION_CACHE_NUM; i++)
+    {
+        if (session_cache[i].valid && rt_strncmp(session_cache[i].host, host, SAL_MBEDTLS_HOST_LEN) == 0)
+        {
+            return &session_cache[i];
+        }
+    }
+
+    return RT_NULL;
+}
+
+/* offer the last session negotiated with this host, returns RT_TRUE if one was set */
+static rt_bool_t session_cache_load(MbedTLSSession *session, unsigned char *master)
+{
+    struct mbedtls_session_entry *entry;
+    rt_bool_t offered = RT_FALSE;
+
+    if (session->host == RT_NULL)
+    {
+        return RT_FALSE;
+    }
+
+    rt_mutex_take(&session_lock, RT_WAITING_FOREVER);
+    entry = session_cache_find(session->host);
+    if (entry && mbedtls_ssl_set_session(&session->ssl, &entry->session) == 0)
+    {
+        rt_memcpy(master, entry->session.master, sizeof(entry->session.master));
+        entry->tick = rt_tick_get();
+        offered = RT_TRUE;
+    }
+    rt_mutex_release(&session_lock);
+
+    return offered;
+}
+
+static void session_cache_save(MbedTLSSession *session)
+{
+    struct mbedtls_session_entry *entry;
+    int i;
+
+    if (session->host == RT_NULL || rt_strlen(session->host) >= SAL_MBEDTLS_HOST_LEN)
+    {
+        return;
+    }
+
+    rt_mutex_take(&session_lock, RT_WAITING_FOREVER);
+    entry = session_cache_find(session->host);
+    if (entry == RT_NULL)
+    {
+        entry = &session_cache[0];
+        for (i = 1; i < SAL_MBEDTLS_SESSION_CACHE_NUM; i++)
+        {
+            if (!entry->valid)
+            {
+                break;
+            }
+            if (!session_cache[i].valid || (rt_tick_t)(entry->tick - session_cache[i].tick) < RT_TICK_MAX / 2)
+            {
+                entry = &session_cache[i];
+            }
+        }
+    }
+    if (entry->valid)
+    {
+        mbedtls_ssl_session_free(&entry->session);
+    }
+    mbedtls_ssl_session_init(&entry->session);
+    entry->valid = (mbedtls_ssl_get_session(&session->ssl, &entry->session) == 0);
+    rt_strncpy(entry->host, session->host, SAL_MBEDTLS_HOST_LEN);
+    entry->tick = rt_tick_get();
+    rt_mutex_release(&session_lock);
+}
+
+static void session_cache_drop(MbedTLSSession *session)
+{
+    struct mbedtls_session_entry *entry;
+
+    if (session->host == RT_NULL)
+    {
+        return;
+    }
+
+    rt_mutex_take(&session_lock, RT_WAITING_FOREVER);
+    entry = session_cache_find(session->host);
+    if (entry)
+    {
+        mbedtls_ssl_session_free(&entry->session);
+        entry->valid = RT_FALSE;
+    }
+    rt_mutex_release(&session_lock);
+}
+
 static void *mebdtls_socket(int socket)
 {
     MbedTLSSession *session = RT_NULL;
@@ -95,7 +221,12 @@ int mbedtls_net_send_cb(void *ctx, const unsigned char *buf, size_t len)
     pf = (struct sal_proto_family *)sock->netdev->sal_user_data;
 
     /* Register scoket sendto option to TLS send data callback */
-    ret = pf->skt_ops->sendto((int) sock->user_data, (void *)buf, len, 0, RT_NULL, RT_NULL);
+    {
+        SAL_PROF_BEGIN(start);
+
+        ret = pf->skt_ops->sendto((int) sock->user_data, (void *)buf, len, 0, RT_NULL, RT_NULL);
+        SAL_PROF_END(start, SAL_PROF_STACK, SAL_PROF_TX, ret);
+    }
     if (ret < 0)
     {
 #ifdef RT_USING_DFS
@@ -132,7 +263,12 @@ int mbedtls_net_recv_cb( void *ctx, unsigned char *buf, size_t len)
     pf = (struct sal_proto_family *)sock->netdev->sal_user_data;
 
     /* Register scoket recvfrom option to TLS recv data callback */
-    ret = pf->skt_ops->recvfrom((int) sock->user_data, (void *)buf, len, 0, RT_NULL, RT_NULL);
+    {
+        SAL_PROF_BEGIN(start);
+
+        ret = pf->skt_ops->recvfrom((int) sock->user_data, (void *)buf, len, 0, RT_NULL, RT_NULL);
+        SAL_PROF_END(start, SAL_PROF_STACK, SAL_PROF_RX, ret);
+    }
     if (ret < 0)
     {
 #ifdef RT_USING_DFS
@@ -153,6 +289,10 @@ int mbedtls_net_recv_cb( void *ctx, unsigned char *buf, size_t len)
 static int mbedtls_connect(void *sock)
 {
     MbedTLSSession *session = RT_NULL;
+    unsigned char offered_master[48];
+    rt_bool_t offered, resumed;
+    rt_tick_t start;
+    rt_uint32_t ms;
     int ret = 0;
 
     RT_ASSERT(sock);
@@ -169,13 +309,36 @@ static int mbedtls_connect(void *sock)
     /* Set the underlying BIO callbacks for write, read and read-with-timeout.  */
     mbedtls_ssl_set_bio(&session->ssl, &session->server_fd, mbedtls_net_send_cb, mbedtls_net_recv_cb, RT_NULL);
 
+    offered = session_cache_load(session, offered_master);
+
+    start = rt_tick_get();
     while ((ret = mbedtls_ssl_handshake(&session->ssl)) != 0)
     {
         if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
         {
+            handshake_stats.fail_num++;
+            if (offered)
+            {
+                session_cache_drop(session);
+            }
             goto __exit;
         }
     }
+    ms = (rt_tick_get() - start) * 1000 / RT_TICK_PER_SECOND;
+
+    /* an abbreviated handshake keeps the master secret of the offered session */
+    resumed = offered && rt_memcmp(session->ssl.session->master, offered_master, sizeof(offered_master)) == 0;
+    if (resumed)
+    {
+        handshake_stats.resumed_num++;
+        handshake_stats.resumed_ms += ms;
+    }
+    else
+    {
+        handshake_stats.full_num++;
+        handshake_stats.full_ms += ms;
+    }
+    rt_memset(offered_master, 0, sizeof(offered_master));
 
     /* Return the result of the certificate verification */
     ret = mbedtls_ssl_get_verify_result(&session->ssl);
@@ -183,9 +346,16 @@ static int mbedtls_connect(void *sock)
     {
         rt_memset(session->buffer, 0x00, session->buffer_len);
         mbedtls_x509_crt_verify_info((char *)session->buffer, session->buffer_len, "  ! ", ret);
+        if (offered)
+        {
+            session_cache_drop(session);
+        }
         goto __exit;
     }
 
+    /* only a verified peer's session may be offered again */
+    session_cache_save(session);
+
     return ret;
 
 __exit:
@@ -221,6 +391,32 @@ static int mbedtls_closesocket(void *sock)
     return 0;
 }
 
+static int mbedtls_set_host_name(void *sock, const void *host_name, size_t size)
+{
+    MbedTLSSession *session = (MbedTLSSession *) sock;
+    char *host;
+
+    if (session == RT_NULL || host_name == RT_NULL || size == 0)
+    {
+        return -1;
+    }
+
+    /* used by mbedtls_client_context() for SNI and certificate name check */
+    host = tls_calloc(1, size + 1);
+    if (host == RT_NULL)
+    {
+        return -1;
+    }
+    rt_memcpy(host, host_name, size);
+    if (session->host)
+    {
+        tls_free(session->host);
+    }
+    session->host = host;
+
+    return 0;
+}
+
 static const struct sal_proto_tls_ops mbedtls_proto_ops=
 {
     RT_NULL,
@@ -229,6 +425,11 @@ static const struct sal_proto_tls_ops mbedtls_proto_ops=
     (int (*)(void *sock, const void *data, size_t size)) mbedtls_client_write,
     (int (*)(void *sock, void *mem, size_t len)) mbedtls_client_read,
     mbedtls_closesocket,
+    RT_NULL,
+    RT_NULL,
+    RT_NULL,
+    RT_NULL,
+    mbedtls_set_host_name,
 };
 
 static const struct sal_proto_tls mbedtls_proto =
@@ -239,6 +440,8 @@ static const struct sal_proto_tls mbedtls_proto =
 
 int sal_mbedtls_proto_init(void)
 {
+    rt_mutex_init(&session_lock, "tls_ses", RT_IPC_FLAG_PRIO);
+
     /* register MbedTLS protocol options to SAL */
     sal_proto_tls_register(&mbedtls_proto);
 
@@ -246,4 +449,28 @@ int sal_mbedtls_proto_init(void)
 }
 INIT_COMPONENT_EXPORT(sal_mbedtls_proto_init);
 
+#ifdef RT_USING_FINSH
+#include <finsh.h>
+
+static void tls_stats(void)
+{
+    rt_kprintf("full handshake   : %d, avg %d ms\n", handshake_stats.full_num,
+               handshake_stats.full_num ? handshake_stats.full_ms / handshake_stats.full_num : 0);
+    rt_kprintf("resumed handshake: %d, avg %d ms\n", handshake_stats.resumed_num,
+               handshake_stats.resumed_num ? handshake_stats.resumed_ms / handshake_stats.resumed_num : 0);
+    rt_kprintf("failed handshake : %d\n", handshake_stats.fail_num);
+#if defined(MBEDTLS_AES_ALT)
+    rt_kprintf("aes              : hw\n");
+#else
+    rt_kprintf("aes              : sw\n");
+#endif
+#if defined(MBEDTLS_SHA256_ALT)
+    rt_kprintf("sha256           : hw\n");
+#else
+    rt_kprintf("sha256           : sw\n");
+#endif
+}
+MSH_CMD_EXPORT(tls_stats, show TLS handshake statistics);
+#endif /* RT_USING_FINSH */
+
 #endif /* SAL_USING_TLS */
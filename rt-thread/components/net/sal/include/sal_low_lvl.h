@@ -8,6 +8,7 @@
  * 2018-05-17     ChenYong     First version
  * 2022-05-15     Meco Man     rename sal.h as sal_low_lvl.h to avoid conflicts
  *                             with Microsoft Visual Studio header file
+ * 2025-02-15     RT-Thread    add sendmem operation for sal_sendfile
  */
 
 #ifndef SAL_LOW_LEVEL_H__
@@ -45,9 +46,14 @@ typedef uint32_t socklen_t;
 #define SAL_SOCKET_OFFSET              0
 #endif
 
+/* sendmem flags */
+#define SAL_SENDMEM_NOCOPY             0x01    /* data stays valid and unchanged until acknowledged */
+#define SAL_SENDMEM_MORE               0x02    /* more data follows, do not push yet */
+
 struct sockaddr;
 struct msghdr;
 struct addrinfo;
+struct fal_partition;
 struct sal_socket
 {
     uint32_t magic;                    /* SAL socket magic word */
@@ -88,6 +94,8 @@ struct sal_socket_ops
 #ifdef SAL_USING_POSIX
     int (*poll)       (struct dfs_file *file, struct rt_pollreq *req);
 #endif
+    /* optional: queue stream data into the protocol stack, blocks on the send window */
+    int (*sendmem)    (int s, const void *data, size_t size, int flags);
 };
 
 /* sal network database name resolving */
@@ -115,6 +123,9 @@ struct sal_socket *sal_get_socket(int sock);
 /* check SAL socket netweork interface device internet status */
 int sal_check_netdev_internet_up(struct netdev *netdev);
 
+/* memory-mapped view of a FAL partition used by sal_sendfile_fal(), RT_NULL if not mapped (weak, provided by BSP) */
+const void *sal_fal_partition_map(const struct fal_partition *part);
+
 #ifdef __cplusplus
 }
 #endif
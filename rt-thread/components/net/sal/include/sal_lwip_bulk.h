@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-16     RT-Thread    First version
+ */
+
+#ifndef SAL_LWIP_BULK_H__
+#define SAL_LWIP_BULK_H__
+
+#include <rtthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct lwip_bulk_vec
+{
+    const void *data;
+    rt_size_t len;
+};
+
+/**
+ * Send a list of buffers over a new TCP connection with the lwIP raw API.
+ *
+ * Connecting, writing and ACK handling all run as callbacks in the tcpip thread;
+ * the caller sleeps once for the whole transfer instead of once per send().
+ * The buffers are referenced, not copied, and must stay valid until this returns.
+ *
+ * @param ip         dotted IPv4 address of the peer
+ * @param port       peer port
+ * @param vec        buffers to send in order
+ * @param vec_num    number of buffers
+ * @param rx_buf     optional buffer for the response, filled until the peer closes or it is full
+ * @param rx_size    size of rx_buf
+ * @param timeout    whole transfer timeout in milliseconds
+ *
+ * @return bytes stored in rx_buf (0 without rx_buf), or a negative lwIP err_t
+ */
+int lwip_bulk_send(const char *ip, rt_uint16_t port, const struct lwip_bulk_vec *vec, int vec_num,
+                   void *rx_buf, rt_size_t rx_size, rt_int32_t timeout);
+
+/* start a discard server on port in the tcpip thread, for loopback benchmarks */
+int lwip_bulk_sink(rt_uint16_t port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAL_LWIP_BULK_H__ */
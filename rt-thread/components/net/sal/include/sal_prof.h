@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-16     RT-Thread    First version
+ */
+
+#ifndef SAL_PROF_H__
+#define SAL_PROF_H__
+
+#include <rtthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* layers a send/recv call passes through, outermost first */
+enum sal_prof_layer
+{
+    SAL_PROF_POSIX = 0,                /* net_sockets.c */
+    SAL_PROF_SAL,                      /* sal_socket.c */
+    SAL_PROF_TLS,                      /* proto_tls ops */
+    SAL_PROF_STACK,                    /* protocol family socket ops, e.g. lwip_sendto */
+    SAL_PROF_LAYER_MAX,
+};
+
+enum sal_prof_dir
+{
+    SAL_PROF_TX = 0,
+    SAL_PROF_RX,
+    SAL_PROF_DIR_MAX,
+};
+
+#ifdef SAL_USING_PROFILE
+
+rt_uint64_t sal_prof_now(void);
+void sal_prof_add(enum sal_prof_layer layer, enum sal_prof_dir dir, int bytes, rt_uint64_t start);
+/* called by lwIP for each API call into the tcpip thread (see lwipopts.h) */
+void sal_prof_tcpip(rt_uint64_t wait, rt_uint64_t exec);
+void sal_prof_reset(void);
+
+#define SAL_PROF_BEGIN(var)                       rt_uint64_t var = sal_prof_now()
+#define SAL_PROF_END(var, layer, dir, bytes)      sal_prof_add(layer, dir, bytes, var)
+
+#else
+
+#define SAL_PROF_BEGIN(var)
+#define SAL_PROF_END(var, layer, dir, bytes)
+
+#endif /* SAL_USING_PROFILE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAL_PROF_H__ */
@@ -350,6 +350,10 @@ int sal_socketpair(int domain, int type, int protocol, int *fds);
 int sal_closesocket(int socket);
 int sal_ioctlsocket(int socket, long cmd, void *arg);
 
+struct fal_partition;
+int sal_sendfile(int socket, int fd, long offset, size_t len);
+int sal_sendfile_fal(int socket, const struct fal_partition *part, uint32_t offset, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
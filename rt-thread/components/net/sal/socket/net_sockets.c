@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2015-02-17     Bernard      First version
  * 2018-05-17     ChenYong     Add socket abstraction layer
+ * 2025-02-16     RT-Thread    Add send/recv profiling
  */
 
 #include <dfs.h>
@@ -15,6 +16,7 @@
 #include <dfs_net.h>
 #include <sys/errno.h>
 #include <sys/socket.h>
+#include <sal_prof.h>
 
 int accept(int s, struct sockaddr *addr, socklen_t *addrlen)
 {
@@ -163,8 +165,12 @@ RTM_EXPORT(listen);
 int recv(int s, void *mem, size_t len, int flags)
 {
     int socket = dfs_net_getsocket(s);
+    int ret;
+    SAL_PROF_BEGIN(start);
 
-    return sal_recvfrom(socket, mem, len, flags, NULL, NULL);
+    ret = sal_recvfrom(socket, mem, len, flags, NULL, NULL);
+    SAL_PROF_END(start, SAL_PROF_POSIX, SAL_PROF_RX, ret);
+    return ret;
 }
 RTM_EXPORT(recv);
 
@@ -188,16 +194,24 @@ int recvfrom(int s, void *mem, size_t len, int flags,
              struct sockaddr *from, socklen_t *fromlen)
 {
     int socket = dfs_net_getsocket(s);
+    int ret;
+    SAL_PROF_BEGIN(start);
 
-    return sal_recvfrom(socket, mem, len, flags, from, fromlen);
+    ret = sal_recvfrom(socket, mem, len, flags, from, fromlen);
+    SAL_PROF_END(start, SAL_PROF_POSIX, SAL_PROF_RX, ret);
+    return ret;
 }
 RTM_EXPORT(recvfrom);
 
 int send(int s, const void *dataptr, size_t size, int flags)
 {
     int socket = dfs_net_getsocket(s);
+    int ret;
+    SAL_PROF_BEGIN(start);
 
-    return sal_sendto(socket, dataptr, size, flags, NULL, 0);
+    ret = sal_sendto(socket, dataptr, size, flags, NULL, 0);
+    SAL_PROF_END(start, SAL_PROF_POSIX, SAL_PROF_TX, ret);
+    return ret;
 }
 RTM_EXPORT(send);
 
@@ -205,8 +219,12 @@ int sendto(int s, const void *dataptr, size_t size, int flags,
            const struct sockaddr *to, socklen_t tolen)
 {
     int socket = dfs_net_getsocket(s);
+    int ret;
+    SAL_PROF_BEGIN(start);
 
-    return sal_sendto(socket, dataptr, size, flags, to, tolen);
+    ret = sal_sendto(socket, dataptr, size, flags, to, tolen);
+    SAL_PROF_END(start, SAL_PROF_POSIX, SAL_PROF_TX, ret);
+    return ret;
 }
 RTM_EXPORT(sendto);
 
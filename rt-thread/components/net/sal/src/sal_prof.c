@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-16     RT-Thread    First version
+ */
+
+#include <rtthread.h>
+#include <rthw.h>
+
+#ifdef SAL_USING_PROFILE
+
+#include <string.h>
+#include <drivers/cputime.h>
+#include <sal_prof.h>
+
+struct sal_prof_counter
+{
+    rt_uint32_t calls;
+    rt_uint64_t bytes;
+    rt_uint64_t cycles;                /* inclusive of inner layers */
+};
+
+struct sal_prof_tcpip
+{
+    rt_uint32_t calls;
+    rt_uint64_t wait;                  /* core lock wait, or mailbox round trip */
+    rt_uint64_t exec;                  /* inside the tcpip core, including send window waits */
+};
+
+static struct sal_prof_counter prof_layer[SAL_PROF_LAYER_MAX][SAL_PROF_DIR_MAX];
+static struct sal_prof_tcpip prof_tcpip;
+
+static const char *const prof_layer_name[SAL_PROF_LAYER_MAX] =
+{
+    "posix", "sal", "tls", "stack",
+};
+
+rt_uint64_t sal_prof_now(void)
+{
+    return clock_cpu_gettime();
+}
+
+void sal_prof_add(enum sal_prof_layer layer, enum sal_prof_dir dir, int bytes, rt_uint64_t start)
+{
+    struct sal_prof_counter *counter = &prof_layer[layer][dir];
+    rt_uint64_t cycles = clock_cpu_gettime() - start;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    counter->calls++;
+    if (bytes > 0)
+    {
+        counter->bytes += bytes;
+    }
+    counter->cycles += cycles;
+    rt_hw_interrupt_enable(level);
+}
+
+void sal_prof_tcpip(rt_uint64_t wait, rt_uint64_t exec)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    prof_tcpip.calls++;
+    prof_tcpip.wait += wait;
+    prof_tcpip.exec += exec;
+    rt_hw_interrupt_enable(level);
+}
+
+void sal_prof_reset(void)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    rt_memset(prof_layer, 0, sizeof(prof_layer));
+    rt_memset(&prof_tcpip, 0, sizeof(prof_tcpip));
+    rt_hw_interrupt_enable(level);
+}
+
+#ifdef RT_USING_FINSH
+#include <finsh.h>
+
+static rt_uint32_t prof_us(rt_uint64_t cycles)
+{
+    return (rt_uint32_t) clock_cpu_microsecond(cycles);
+}
+
+static void sal_prof(int argc, char **argv)
+{
+    struct sal_prof_counter snap[SAL_PROF_LAYER_MAX][SAL_PROF_DIR_MAX];
+    struct sal_prof_tcpip tcpip;
+    rt_uint64_t inner;
+    rt_base_t level;
+    int layer, dir, next;
+
+    if (argc > 1 && strcmp(argv[1], "reset") == 0)
+    {
+        sal_prof_reset();
+        return;
+    }
+
+    level = rt_hw_interrupt_disable();
+    rt_memcpy(snap, prof_layer, sizeof(snap));
+    rt_memcpy(&tcpip, &prof_tcpip, sizeof(tcpip));
+    rt_hw_interrupt_enable(level);
+
+    /* self time is the inclusive time minus the next layer that was entered */
+    rt_kprintf("layer dir      calls      bytes   total us    self us  avg us\n");
+    for (dir = 0; dir < SAL_PROF_DIR_MAX; dir++)
+    {
+        for (layer = 0; layer < SAL_PROF_LAYER_MAX; layer++)
+        {
+            struct sal_prof_counter *c = &snap[layer][dir];
+
+            if (c->calls == 0)
+            {
+                continue;
+            }
+            inner = 0;
+            for (next = layer + 1; next < SAL_PROF_LAYER_MAX; next++)
+            {
+                if (snap[next][dir].calls)
+                {
+                    inner = snap[next][dir].cycles;
+                    break;
+                }
+            }
+            rt_kprintf("%-5s %-3s %10u %10u %10u %10u %7u\n", prof_layer_name[layer], dir == SAL_PROF_TX ? "tx" : "rx",
+                       c->calls, (rt_uint32_t) c->bytes, prof_us(c->cycles),
+                       prof_us(c->cycles > inner ? c->cycles - inner : 0), prof_us(c->cycles) / c->calls);
+        }
+    }
+    rt_kprintf("tcpip api calls %u, wait %u us, exec %u us\n", tcpip.calls, prof_us(tcpip.wait), prof_us(tcpip.exec));
+}
+MSH_CMD_EXPORT(sal_prof, show or reset per-layer socket timing: sal_prof [reset]);
+#endif /* RT_USING_FINSH */
+
+#endif /* SAL_USING_PROFILE */
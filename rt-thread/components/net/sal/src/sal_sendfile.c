@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-15     RT-Thread    First version
+ */
+
+#include <rtthread.h>
+#include <stdlib.h>
+
+#include <sal_socket.h>
+#include <sal_low_lvl.h>
+#include <netdev.h>
+
+#ifdef DFS_USING_POSIX
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#ifdef RT_USING_FAL
+#include <fal.h>
+#endif
+
+#define DBG_TAG                        "sal.sf"
+#define DBG_LVL                        DBG_INFO
+#include <rtdbg.h>
+
+/* bounce buffer for sources that are not memory-mapped, two full-sized TCP segments */
+#ifndef SAL_SENDFILE_BUF_SIZE
+#define SAL_SENDFILE_BUF_SIZE          2920
+#endif
+
+struct sal_sendfile_ctx
+{
+    struct sal_socket *sock;
+    struct sal_proto_family *pf;
+    rt_bool_t direct;                  /* stack provides sendmem */
+};
+
+rt_weak const void *sal_fal_partition_map(const struct fal_partition *part)
+{
+    return RT_NULL;
+}
+
+static int sendfile_begin(int socket, struct sal_sendfile_ctx *ctx)
+{
+    ctx->sock = sal_get_socket(socket);
+    if (ctx->sock == RT_NULL || ctx->sock->netdev == RT_NULL || !netdev_is_up(ctx->sock->netdev))
+    {
+        return -1;
+    }
+
+    ctx->pf = (struct sal_proto_family *) ctx->sock->netdev->sal_user_data;
+    ctx->direct = (ctx->pf->skt_ops->sendmem != RT_NULL);
+#ifdef SAL_USING_TLS
+    /* records have to be encrypted, so TLS sockets go through sal_sendto() */
+    if (ctx->sock->user_data_tls != RT_NULL)
+    {
+        ctx->direct = RT_FALSE;
+    }
+#endif
+
+    return 0;
+}
+
+/* returns the bytes queued; short only on error or send timeout */
+static int sendfile_put(struct sal_sendfile_ctx *ctx, const void *data, size_t size, int flags)
+{
+    const rt_uint8_t *ptr = (const rt_uint8_t *) data;
+    size_t sent = 0;
+    int ret;
+
+    while (sent < size)
+    {
+        if (ctx->direct)
+        {
+            ret = ctx->pf->skt_ops->sendmem((int)(size_t) ctx->sock->user_data, ptr + sent, size - sent, flags);
+        }
+        else
+        {
+            ret = sal_sendto(ctx->sock->socket, ptr + sent, size - sent, 0, RT_NULL, 0);
+        }
+        if (ret <= 0)
+        {
+            break;
+        }
+        sent += ret;
+    }
+
+    return (int) sent;
+}
+
+#ifdef DFS_USING_POSIX
+/**
+ * Send len bytes of a file starting at offset on a connected stream socket.
+ *
+ * The file is read in SAL_SENDFILE_BUF_SIZE pieces and handed to the protocol
+ * stack as it drains, so neither a whole-file buffer nor sleeping between
+ * chunks is needed. The file position of fd is changed.
+ *
+ * @return the number of bytes sent, or -1 if nothing could be sent
+ */
+int sal_sendfile(int socket, int fd, long offset, size_t len)
+{
+    struct sal_sendfile_ctx ctx;
+    rt_uint8_t *buf;
+    size_t total = 0;
+    int n, ret;
+
+    if (sendfile_begin(socket, &ctx) < 0 || lseek(fd, offset, SEEK_SET) < 0)
+    {
+        return -1;
+    }
+
+    buf = (rt_uint8_t *) rt_malloc(SAL_SENDFILE_BUF_SIZE);
+    if (buf == RT_NULL)
+    {
+        return -1;
+    }
+
+    while (total < len)
+    {
+        n = read(fd, buf, len - total > SAL_SENDFILE_BUF_SIZE ? SAL_SENDFILE_BUF_SIZE : len - total);
+        if (n <= 0)
+        {
+            break;
+        }
+        ret = sendfile_put(&ctx, buf, n, total + n < len ? SAL_SENDMEM_MORE : 0);
+        total += ret;
+        if (ret != n)
+        {
+            break;
+        }
+    }
+
+    rt_free(buf);
+
+    return (total > 0 || len == 0) ? (int) total : -1;
+}
+#endif /* DFS_USING_POSIX */
+
+#ifdef RT_USING_FAL
+/**
+ * Send len bytes of a FAL partition starting at offset on a connected stream socket.
+ *
+ * When the BSP reports the partition as memory-mapped the TCP segments reference
+ * the flash directly and nothing is copied. The region must then not be erased or
+ * written until the peer has acknowledged it, which is later than this returns.
+ *
+ * @return the number of bytes sent, or -1 if nothing could be sent
+ */
+int sal_sendfile_fal(int socket, const struct fal_partition *part, uint32_t offset, size_t len)
+{
+    struct sal_sendfile_ctx ctx;
+    const rt_uint8_t *map;
+    rt_uint8_t *buf;
+    size_t total = 0;
+    size_t n;
+    int ret;
+
+    if (part == RT_NULL || offset > part->len || len > part->len - offset)
+    {
+        return -1;
+    }
+    if (sendfile_begin(socket, &ctx) < 0)
+    {
+        return -1;
+    }
+
+    map = (const rt_uint8_t *) sal_fal_partition_map(part);
+    if (map != RT_NULL && ctx.direct)
+    {
+        total = sendfile_put(&ctx, map + offset, len, SAL_SENDMEM_NOCOPY);
+        return (total > 0 || len == 0) ? (int) total : -1;
+    }
+
+    buf = (rt_uint8_t *) rt_malloc(SAL_SENDFILE_BUF_SIZE);
+    if (buf == RT_NULL)
+    {
+        return -1;
+    }
+
+    while (total < len)
+    {
+        n = len - total > SAL_SENDFILE_BUF_SIZE ? SAL_SENDFILE_BUF_SIZE : len - total;
+        if (fal_partition_read(part, offset + total, buf, n) < 0)
+        {
+            break;
+        }
+        ret = sendfile_put(&ctx, buf, n, total + n < len ? SAL_SENDMEM_MORE : 0);
+        total += ret;
+        if ((size_t) ret != n)
+        {
+            break;
+        }
+    }
+
+    rt_free(buf);
+
+    return (total > 0 || len == 0) ? (int) total : -1;
+}
+#endif /* RT_USING_FAL */
+
+#if defined(RT_USING_FINSH) && defined(SAL_USING_POSIX)
+#include <finsh.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#ifdef SAL_USING_LWIP
+#include <lwip/stats.h>
+#endif
+
+#define SENDFILE_BENCH_COPY_BUF        4096
+
+/* lwIP heap high-water mark since the last reset, -1 without MEM_STATS */
+static long bench_heap_peak(rt_bool_t reset)
+{
+#if defined(SAL_USING_LWIP) && LWIP_STATS && MEM_STATS
+    if (reset)
+    {
+        lwip_stats.mem.max = lwip_stats.mem.used;
+        return 0;
+    }
+    return (long) lwip_stats.mem.max;
+#else
+    return -1;
+#endif
+}
+
+static int bench_connect(const char *ip, int port)
+{
+    struct sockaddr_in addr;
+    int sock;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+    {
+        return -1;
+    }
+    rt_memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+    if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    {
+        closesocket(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+static void bench_report(const char *name, int bytes, rt_tick_t ticks, long app_buf, long heap_peak)
+{
+    rt_uint32_t ms = ticks * 1000 / RT_TICK_PER_SECOND;
+
+    rt_kprintf("%-9s %8d bytes %6d ms %6d KB/s  app buffer %5ld  lwIP heap peak %ld\n", name, bytes, ms,
+               ms ? (int)((rt_uint64_t) bytes * 1000 / 1024 / ms) : 0, app_buf, heap_peak);
+}
+
+/* sendfile_bench <ip> <port> <file | fal:partition> [len] */
+static void sendfile_bench(int argc, char **argv)
+{
+    const char *src;
+    size_t len = 0;
+    rt_uint8_t *buf = RT_NULL;
+    int sock, fd = -1, ret, total;
+    long peak;
+    rt_tick_t start;
+#ifdef RT_USING_FAL
+    const struct fal_partition *part = RT_NULL;
+#endif
+
+    if (argc < 4)
+    {
+        rt_kprintf("Usage: sendfile_bench <ip> <port> <file | fal:partition> [len]\n");
+        rt_kprintf("  run a TCP sink on the host, e.g. nc -l <port> > /dev/null\n");
+        return;
+    }
+    src = argv[3];
+    if (argc > 4)
+    {
+        len = atoi(argv[4]);
+    }
+
+#ifdef RT_USING_FAL
+    if (rt_strncmp(src, "fal:", 4) == 0)
+    {
+        part = fal_partition_find(src + 4);
+        if (part == RT_NULL)
+        {
+            rt_kprintf("partition %s not found\n", src + 4);
+            return;
+        }
+        if (len == 0 || len > part->len)
+        {
+            len = part->len;
+        }
+        rt_kprintf("%s: %s\n", part->name, sal_fal_partition_map(part) ? "memory-mapped, zero-copy" : "bounce buffer");
+    }
+    else
+#endif
+    {
+        fd = open(src, O_RDONLY);
+        if (fd < 0)
+        {
+            rt_kprintf("open %s failed\n", src);
+            return;
+        }
+        if (len == 0)
+        {
+            len = lseek(fd, 0, SEEK_END);
+        }
+    }
+
+    /* baseline: read into a user buffer, then send it */
+    buf = (rt_uint8_t *) rt_malloc(SENDFILE_BENCH_COPY_BUF);
+    sock = bench_connect(argv[1], atoi(argv[2]));
+    if (buf == RT_NULL || sock < 0)
+    {
+        rt_kprintf("read/send setup failed\n");
+        if (sock >= 0)
+        {
+            closesocket(sock);
+        }
+        goto __exit;
+    }
+    bench_heap_peak(RT_TRUE);
+    start = rt_tick_get();
+    for (total = 0; total < (int) len; total += ret)
+    {
+        ret = len - total > SENDFILE_BENCH_COPY_BUF ? SENDFILE_BENCH_COPY_BUF : len - total;
+#ifdef RT_USING_FAL
+        if (part)
+        {
+            ret = fal_partition_read(part, total, buf, ret);
+        }
+        else
+#endif
+        {
+            lseek(fd, total, SEEK_SET);
+            ret = read(fd, buf, ret);
+        }
+        if (ret <= 0 || send(sock, buf, ret, 0) != ret)
+        {
+            break;
+        }
+    }
+    peak = bench_heap_peak(RT_FALSE);
+    bench_report("read/send", total, rt_tick_get() - start, SENDFILE_BENCH_COPY_BUF, peak);
+    closesocket(sock);
+    rt_free(buf);
+    buf = RT_NULL;
+
+    sock = bench_connect(argv[1], atoi(argv[2]));
+    if (sock < 0)
+    {
+        rt_kprintf("sendfile setup failed\n");
+        goto __exit;
+    }
+    bench_heap_peak(RT_TRUE);
+    start = rt_tick_get();
+#ifdef RT_USING_FAL
+    if (part)
+    {
+        total = sal_sendfile_fal(sock, part, 0, len);
+    }
+    else
+#endif
+    {
+        total = sal_sendfile(sock, fd, 0, len);
+    }
+    peak = bench_heap_peak(RT_FALSE);
+    bench_report("sendfile", total, rt_tick_get() - start,
+#ifdef RT_USING_FAL
+                 (part && sal_fal_partition_map(part)) ? 0 :
+#endif
+                 SAL_SENDFILE_BUF_SIZE, peak);
+    closesocket(sock);
+
+__exit:
+    if (buf)
+    {
+        rt_free(buf);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+MSH_CMD_EXPORT(sendfile_bench, compare read/send with sal_sendfile throughput and heap);
+#endif /* RT_USING_FINSH && SAL_USING_POSIX */
@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2018-05-23     ChenYong     First version
  * 2018-11-12     ChenYong     Add TLS support
+ * 2025-02-16     RT-Thread    Add per-layer send/recv profiling
  */
 
 #include <rtthread.h>
@@ -24,6 +25,7 @@
 #include <sal_tls.h>
 #endif
 #include <sal_low_lvl.h>
+#include <sal_prof.h>
 #include <netdev.h>
 
 #ifdef SAL_INTERNET_CHECK
@@ -837,6 +839,10 @@ int sal_setsockopt(int socket, int level, int optname, const void *optval, sockl
             SAL_SOCKOPT_PROTO_TLS_EXEC(sock, set_dtls_role, optval, optlen);
             break;
 
+        case TLS_HOST_NAME:
+            SAL_SOCKOPT_PROTO_TLS_EXEC(sock, set_host_name, optval, optlen);
+            break;
+
         default:
             return -1;
         }
@@ -967,6 +973,8 @@ int sal_recvfrom(int socket, void *mem, size_t len, int flags,
 {
     struct sal_socket *sock;
     struct sal_proto_family *pf;
+    int ret;
+    SAL_PROF_BEGIN(start);
 
     /* get the socket object by socket descriptor */
     SAL_SOCKET_OBJ_GET(sock, socket);
@@ -979,21 +987,26 @@ int sal_recvfrom(int socket, void *mem, size_t len, int flags,
 #ifdef SAL_USING_TLS
     if (SAL_SOCKOPS_PROTO_TLS_VALID(sock, recv))
     {
-        int ret;
+        SAL_PROF_BEGIN(tls_start);
 
-        if ((ret = proto_tls->ops->recv(sock->user_data_tls, mem, len)) < 0)
+        ret = proto_tls->ops->recv(sock->user_data_tls, mem, len);
+        SAL_PROF_END(tls_start, SAL_PROF_TLS, SAL_PROF_RX, ret);
+        if (ret < 0)
         {
-            return -1;
+            ret = -1;
         }
-        return ret;
     }
     else
+#endif
     {
-        return pf->skt_ops->recvfrom((int)(size_t)sock->user_data, mem, len, flags, from, fromlen);
+        SAL_PROF_BEGIN(stack_start);
+
+        ret = pf->skt_ops->recvfrom((int)(size_t)sock->user_data, mem, len, flags, from, fromlen);
+        SAL_PROF_END(stack_start, SAL_PROF_STACK, SAL_PROF_RX, ret);
     }
-#else
-    return pf->skt_ops->recvfrom((int)(size_t)sock->user_data, mem, len, flags, from, fromlen);
-#endif
+
+    SAL_PROF_END(start, SAL_PROF_SAL, SAL_PROF_RX, ret);
+    return ret;
 }
 
 int sal_sendto(int socket, const void *dataptr, size_t size, int flags,
@@ -1001,6 +1014,8 @@ int sal_sendto(int socket, const void *dataptr, size_t size, int flags,
 {
     struct sal_socket *sock;
     struct sal_proto_family *pf;
+    int ret;
+    SAL_PROF_BEGIN(start);
 
     /* get the socket object by socket descriptor */
     SAL_SOCKET_OBJ_GET(sock, socket);
@@ -1013,21 +1028,26 @@ int sal_sendto(int socket, const void *dataptr, size_t size, int flags,
 #ifdef SAL_USING_TLS
     if (SAL_SOCKOPS_PROTO_TLS_VALID(sock, send))
     {
-        int ret;
+        SAL_PROF_BEGIN(tls_start);
 
-        if ((ret = proto_tls->ops->send(sock->user_data_tls, dataptr, size)) < 0)
+        ret = proto_tls->ops->send(sock->user_data_tls, dataptr, size);
+        SAL_PROF_END(tls_start, SAL_PROF_TLS, SAL_PROF_TX, ret);
+        if (ret < 0)
         {
-            return -1;
+            ret = -1;
         }
-        return ret;
     }
     else
+#endif
     {
-        return pf->skt_ops->sendto((int) sock->user_data, dataptr, size, flags, to, tolen);
+        SAL_PROF_BEGIN(stack_start);
+
+        ret = pf->skt_ops->sendto((int)(size_t)sock->user_data, dataptr, size, flags, to, tolen);
+        SAL_PROF_END(stack_start, SAL_PROF_STACK, SAL_PROF_TX, ret);
     }
-#else
-    return pf->skt_ops->sendto((int)(size_t)sock->user_data, dataptr, size, flags, to, tolen);
-#endif
+
+    SAL_PROF_END(start, SAL_PROF_SAL, SAL_PROF_TX, ret);
+    return ret;
 }
 
 int sal_socket(int domain, int type, int protocol)
@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2021-02-02     xiangxistu   the first version
  * 2021-03-19     Sherman      Streamline the struct rt_link_session
+ * 2025-02-17     RT-Thread    Add sliding window (selective repeat) mode
  */
 
 #ifndef __RT_LINK_H__
@@ -38,8 +39,21 @@ so the value range after 4-byte alignment is 0-2044.*/
                                         RT_LINK_HEAD_LENGTH - \
                                         RT_LINK_EXTEND_LENGTH - \
                                         RT_LINK_CRC_LENGTH)
+#ifdef RT_LINK_USING_WINDOW
+#ifndef RT_LINK_WINDOW_SIZE
+#define RT_LINK_WINDOW_SIZE             8
+#endif
+/* the receive buffer has to hold a whole window arriving back to back */
+#define RT_LINK_RECEIVE_FRAMES          (RT_LINK_WINDOW_SIZE > RT_LINK_FRAMES_MAX ? \
+                                        RT_LINK_WINDOW_SIZE : RT_LINK_FRAMES_MAX)
+/* set in the parameter of a confirm frame that also carries a cumulative ack */
+#define RT_LINK_CONFIRM_CUMULATIVE      0x8000U
+#else
+#define RT_LINK_RECEIVE_FRAMES          RT_LINK_FRAMES_MAX
+#endif /* RT_LINK_USING_WINDOW */
+
 #define RT_LINK_RECEIVE_BUFFER_LENGTH   (RT_LINK_MAX_FRAME_LENGTH * \
-                                        RT_LINK_FRAMES_MAX + \
+                                        RT_LINK_RECEIVE_FRAMES + \
                                         RT_LINK_HEAD_LENGTH + \
                                         RT_LINK_EXTEND_LENGTH)
 
@@ -155,10 +169,38 @@ struct rt_link_frame
     rt_uint8_t issent;
     rt_uint8_t index;       /* the index frame for long frame */
     rt_uint8_t total;       /* the total frame for long frame */
+#ifdef RT_LINK_USING_WINDOW
+    rt_uint8_t acked;       /* confirmed by the opposite */
+    rt_uint8_t retry;       /* retransmission counter */
+    rt_tick_t sent_tick;    /* time of the last transmission */
+#endif
 
     rt_slist_t slist;       /* the frame will hang on the send list on session */
 };
 
+#ifdef RT_LINK_USING_WINDOW
+/* a frame received ahead of a missing one, kept until the gap is filled */
+struct rt_link_window_slot
+{
+    rt_uint8_t *data;
+    rt_uint16_t data_len;
+    rt_uint16_t parameter;  /* total size of a long package */
+    rt_uint8_t service;
+    rt_uint8_t attribute;
+    rt_uint8_t valid;
+};
+#endif
+
+struct rt_link_stats
+{
+    rt_uint32_t tx_frames;
+    rt_uint32_t tx_retrans;
+    rt_uint32_t rx_frames;
+    rt_uint32_t rx_dup;     /* frames received twice, ack was lost */
+    rt_uint32_t rx_ooo;     /* frames received ahead of a missing one */
+    rt_uint32_t rx_crc_err;
+};
+
 struct rt_link_service
 {
     rt_int32_t timeout_tx;
@@ -190,6 +232,16 @@ struct rt_link_session
     struct rt_link_receive_buffer *rx_buffer;
     rt_uint32_t (*calculate_crc)(rt_uint8_t using_buffer_ring, rt_uint8_t *data, rt_size_t size);
     rt_link_linkstate_e state;  /* Link status */
+
+#ifdef RT_LINK_USING_WINDOW
+    struct rt_link_window_slot rx_window[RT_LINK_WINDOW_SIZE];
+    rt_uint8_t rx_window_head;  /* slot of the frame following rx_seq */
+    rt_uint8_t rx_nack_seq;     /* the missing frame a resend was requested for */
+    rt_uint8_t *rx_long;        /* long package reassembled from in-order frames */
+    rt_uint8_t rx_long_total;
+    rt_uint8_t rx_long_count;
+#endif
+    struct rt_link_stats stats;
 };
 
 #define SERV_ERR_GET(service)   (service->err)
@@ -8,6 +8,7 @@
  * 2021-02-02     xiangxistu   the first version
  * 2021-05-15     Sherman      function rename
  * 2021-07-13     Sherman      add reconnect API
+ * 2025-02-17     RT-Thread    add hwcrypto CRC and direct receive buffer access
  */
 #ifndef __RT_LINK_PORT_H__
 #define __RT_LINK_PORT_H__
@@ -20,14 +21,20 @@ rt_err_t rt_link_port_deinit(void);
 rt_err_t rt_link_port_reconnect(void);
 rt_size_t rt_link_port_send(void *data, rt_size_t length);
 
+/* Provided by rt-link on top of the hwcrypto CRC device */
 #ifdef RT_LINK_USING_HW_CRC
     rt_err_t rt_link_hw_crc32_init(void);
     rt_err_t rt_link_hw_crc32_deinit(void);
     rt_err_t rt_link_hw_crc32_reset(void);
-    rt_uint32_t rt_link_hw_crc32(rt_uint8_t *data, rt_size_t u32_size)
+    rt_uint32_t rt_link_hw_crc32(rt_uint8_t *data, rt_size_t u32_size);
 #endif
 
 /* Called when the hardware receives data and the data is transferred to RTLink */
 rt_size_t rt_link_hw_write_cb(void *data, rt_size_t length);
 
+/* Let the hardware read straight into the RTLink receive buffer:
+ * get the contiguous free space, fill it, then commit the length written */
+rt_size_t rt_link_hw_write_span(rt_uint8_t **span);
+void rt_link_hw_write_commit(rt_size_t length);
+
 #endif /* __RT_LINK_PORT_H__ */
@@ -13,6 +13,7 @@
  *                             Fix known bugs
  * 2021-08-06     Sherman      Add NACK, NCRC, non-blocking transmit mode;
  *                             Add service connection status;
+ * 2025-02-17     RT-Thread    Add sliding window (selective repeat) mode and statistics
  */
 
 #include <rtthread.h>
@@ -53,6 +54,15 @@
 #define RT_LINK_FRAME_SENT      1
 #define RT_LINK_FRAME_NOSEND    0
 
+#ifdef RT_LINK_USING_WINDOW
+#ifndef RT_LINK_WINDOW_RTO
+    #define RT_LINK_WINDOW_RTO      100 /* ms */
+#endif
+#ifndef RT_LINK_WINDOW_RETRY
+    #define RT_LINK_WINDOW_RETRY    5
+#endif
+#endif /* RT_LINK_USING_WINDOW */
+
 typedef enum
 {
     FIND_FRAME_HEAD     = 0,
@@ -70,6 +80,10 @@ struct rt_link_session *rt_link_get_scb(void)
     return rt_link_scb;
 }
 
+#ifdef RT_LINK_USING_WINDOW
+static void rt_link_window_confirm(struct rt_link_frame *receive_frame);
+#endif
+
 static rt_uint8_t rt_link_check_seq(rt_uint8_t new, rt_uint8_t used)
 {
     rt_int16_t compare_seq = 0;
@@ -109,6 +123,10 @@ static int rt_link_frame_init(struct rt_link_frame *frame, rt_uint8_t config)
     frame->total = 0;
     frame->attribute = RT_LINK_RESERVE_FRAME;
     frame->issent = RT_LINK_FRAME_NOSEND;
+#ifdef RT_LINK_USING_WINDOW
+    frame->acked = 0;
+    frame->retry = 0;
+#endif
 
     rt_slist_init(&frame->slist);
 
@@ -213,7 +231,7 @@ static rt_ssize_t frame_send(struct rt_link_frame *frame)
     rt_size_t length = 0;
     rt_uint8_t *data = RT_NULL;
 
-    rt_memset(rt_link_scb->sendbuffer, 0, sizeof(rt_link_scb->sendbuffer));
+    /* every byte that goes out is written below */
     data = rt_link_scb->sendbuffer;
     length = RT_LINK_HEAD_LENGTH;
     if (frame->head.crc)
@@ -246,6 +264,7 @@ static rt_ssize_t frame_send(struct rt_link_frame *frame)
     }
 
     LOG_D("frame send seq(%d) len(%d) attr:(%d), crc:(0x%08x).", frame->head.sequence, length, frame->attribute, frame->crc);
+    rt_link_scb->stats.tx_frames++;
     return rt_link_hw_send(rt_link_scb->sendbuffer, length);
 }
 
@@ -350,13 +369,23 @@ static rt_err_t rt_link_resend_handle(struct rt_link_frame *receive_frame)
         find_frame = rt_container_of(tem_list, struct rt_link_frame, slist);
         if (find_frame->head.sequence == receive_frame->head.sequence)
         {
+#ifdef RT_LINK_USING_WINDOW
+            if (find_frame->issent != RT_LINK_FRAME_SENT || find_frame->acked)
+            {
+                break;
+            }
+            find_frame->sent_tick = rt_tick_get();
+#endif
             LOG_D("resend frame(%d)", find_frame->head.sequence);
             frame_send(find_frame);
+            rt_link_scb->stats.tx_retrans++;
             break;
         }
         tem_list = tem_list->next;
     }
 
+    /* in window mode the frame may have been confirmed in the meantime */
+#ifndef RT_LINK_USING_WINDOW
     if (tem_list == RT_NULL)
     {
         LOG_D("frame resent failed, can't find(%d).", receive_frame->head.sequence);
@@ -364,6 +393,7 @@ static rt_err_t rt_link_resend_handle(struct rt_link_frame *receive_frame)
                                    receive_frame->head.sequence,
                                    RT_LINK_SESSION_END, RT_NULL);
     }
+#endif
     return RT_EOK;
 }
 
@@ -374,13 +404,22 @@ static rt_err_t rt_link_confirm_handle(struct rt_link_frame *receive_frame)
     rt_uint16_t seq_offset = 0;
     LOG_D("confirm seq(%d) frame", receive_frame->head.sequence);
 
-    rt_timer_stop(&rt_link_scb->sendtimer);
-
     if (rt_link_scb->service[receive_frame->head.service] != RT_NULL)
     {
         rt_link_scb->service[receive_frame->head.service]->state = RT_LINK_CONNECT;
     }
 
+#ifdef RT_LINK_USING_WINDOW
+    if (rt_link_scb->state == RT_LINK_CONNECT)
+    {
+        /* the retransmission timer keeps running for the other frames in flight */
+        rt_link_window_confirm(receive_frame);
+        return RT_EOK;
+    }
+#endif
+
+    rt_timer_stop(&rt_link_scb->sendtimer);
+
     if (rt_link_scb->state != RT_LINK_CONNECT)
     {
         /* The handshake success and resends the data frame */
@@ -420,6 +459,7 @@ static void rt_link_recv_finish(rt_uint16_t serv, void *data, rt_size_t size)
 {
     if (rt_link_scb->service[serv] == RT_NULL)
     {
+        rt_free(data);
         rt_link_command_frame_send(serv, 0, RT_LINK_DETACH_FRAME, RT_NULL);
         return;
     }
@@ -435,6 +475,365 @@ static void rt_link_recv_finish(rt_uint16_t serv, void *data, rt_size_t size)
     }
 }
 
+#ifdef RT_LINK_USING_WINDOW
+/*
+ * Sliding window (selective repeat):
+ * up to RT_LINK_WINDOW_SIZE data frames are in flight. The receiver confirms
+ * every frame on its own, carrying the last in-order sequence as a cumulative
+ * ack, and keeps frames that arrive ahead of a missing one until the gap is
+ * filled. Only frames that stay unconfirmed for RT_LINK_WINDOW_RTO are sent
+ * again, the receiver also asks for a missing frame as soon as it sees a gap.
+ */
+
+/* complete the packages at the head of the list whose frames are all confirmed */
+static int rt_link_window_release(void)
+{
+    struct rt_link_frame *frame = RT_NULL;
+    rt_slist_t *tem_list = RT_NULL;
+    rt_uint8_t count = 0;
+    int released = 0;
+
+    while ((tem_list = rt_slist_first(&rt_link_scb->tx_data_slist)) != RT_NULL)
+    {
+        frame = rt_container_of(tem_list, struct rt_link_frame, slist);
+        for (count = frame->total; count > 0 && tem_list != RT_NULL; count--)
+        {
+            frame = rt_container_of(tem_list, struct rt_link_frame, slist);
+            if (!frame->acked)
+            {
+                break;
+            }
+            tem_list = rt_slist_next(tem_list);
+        }
+        if (count > 0)
+        {
+            break;
+        }
+        rt_link_service_send_finish(RT_LINK_EOK);
+        released++;
+    }
+
+    if (rt_slist_first(&rt_link_scb->tx_data_slist) == RT_NULL)
+    {
+        rt_timer_stop(&rt_link_scb->sendtimer);
+    }
+    return released;
+}
+
+/* fill the window with frames that have not been sent yet */
+static void rt_link_window_send(void)
+{
+    struct rt_link_frame *frame = RT_NULL;
+    rt_slist_t *tem_list = RT_NULL;
+    rt_uint8_t inflight = 0;
+    rt_uint8_t sent = 0;
+
+    do
+    {
+        sent = 0;
+        inflight = 0;
+        for (tem_list = rt_slist_first(&rt_link_scb->tx_data_slist);
+             (tem_list != RT_NULL) && (inflight < RT_LINK_WINDOW_SIZE);
+             tem_list = rt_slist_next(tem_list), inflight++)
+        {
+            frame = rt_container_of(tem_list, struct rt_link_frame, slist);
+            if (frame->issent == RT_LINK_FRAME_SENT)
+            {
+                continue;
+            }
+
+            if (frame_send(frame) == 0)
+            {
+                rt_link_scb->service[frame->head.service]->err = RT_LINK_EIO;
+                rt_link_scb->state = RT_LINK_DISCONN;
+                rt_link_service_send_finish(RT_LINK_EIO);
+                return;
+            }
+            frame->issent = RT_LINK_FRAME_SENT;
+            frame->sent_tick = rt_tick_get();
+            frame->retry = 0;
+            /* NACK frame is done once it is on the wire */
+            frame->acked = (frame->head.ack == 0);
+            sent++;
+        }
+        /* released NACK packages make room for more frames */
+    } while (sent && rt_link_window_release());
+
+    if (sent)
+    {
+        rt_int32_t timeout = rt_tick_from_millisecond(RT_LINK_WINDOW_RTO / 2);
+        rt_timer_control(&rt_link_scb->sendtimer, RT_TIMER_CTRL_SET_TIME, &timeout);
+        rt_timer_start(&rt_link_scb->sendtimer);
+    }
+}
+
+static void rt_link_window_confirm(struct rt_link_frame *receive_frame)
+{
+    struct rt_link_frame *frame = RT_NULL;
+    rt_slist_t *tem_list = RT_NULL;
+    rt_uint16_t parameter = receive_frame->extend.parameter;
+    rt_uint8_t inflight = 0;
+
+    for (tem_list = rt_slist_first(&rt_link_scb->tx_data_slist);
+         (tem_list != RT_NULL) && (inflight < RT_LINK_WINDOW_SIZE);
+         tem_list = rt_slist_next(tem_list), inflight++)
+    {
+        frame = rt_container_of(tem_list, struct rt_link_frame, slist);
+        if (frame->issent != RT_LINK_FRAME_SENT)
+        {
+            break;
+        }
+        if (frame->head.sequence == receive_frame->head.sequence)
+        {
+            frame->acked = 1;
+        }
+        else if ((parameter & RT_LINK_CONFIRM_CUMULATIVE) &&
+                 rt_link_check_seq((rt_uint8_t)parameter, frame->head.sequence) < RT_LINK_WINDOW_SIZE)
+        {
+            /* handed up in order by the opposite, its own confirm got lost */
+            frame->acked = 1;
+        }
+    }
+
+    if (rt_link_window_release() && rt_slist_first(&rt_link_scb->tx_data_slist))
+    {
+        LOG_D("Continue sending");
+        rt_event_send(&rt_link_scb->event, RT_LINK_SEND_READY_EVENT);
+    }
+}
+
+/* RT_LINK_SEND_TIMEOUT_EVENT while connected: retransmit the overdue frames */
+static void rt_link_window_timeout(void)
+{
+    struct rt_link_frame *frame = RT_NULL;
+    rt_slist_t *tem_list = RT_NULL;
+    rt_tick_t now = rt_tick_get();
+    rt_tick_t rto = rt_tick_from_millisecond(RT_LINK_WINDOW_RTO);
+    rt_uint8_t inflight = 0;
+
+    rt_link_scb->sendtimer.parameter = 0;
+    for (tem_list = rt_slist_first(&rt_link_scb->tx_data_slist);
+         (tem_list != RT_NULL) && (inflight < RT_LINK_WINDOW_SIZE);
+         tem_list = rt_slist_next(tem_list), inflight++)
+    {
+        frame = rt_container_of(tem_list, struct rt_link_frame, slist);
+        if ((frame->issent != RT_LINK_FRAME_SENT) || frame->acked || (now - frame->sent_tick < rto))
+        {
+            continue;
+        }
+        if (frame->retry >= RT_LINK_WINDOW_RETRY)
+        {
+            goto __timeout;
+        }
+        LOG_D("retransmit seq(%d) retry(%d)", frame->head.sequence, frame->retry);
+        frame_send(frame);
+        frame->sent_tick = now;
+        frame->retry++;
+        rt_link_scb->stats.tx_retrans++;
+    }
+    return;
+
+__timeout:
+    LOG_W("Send timeout, please check the link status!");
+    rt_timer_stop(&rt_link_scb->sendtimer);
+    rt_link_scb->state = RT_LINK_DISCONN;
+    rt_link_service_send_finish(RT_LINK_ETIMEOUT);
+
+    /* the remaining frames go out again after the next handshake */
+    rt_slist_for_each(tem_list, &rt_link_scb->tx_data_slist)
+    {
+        frame = rt_container_of(tem_list, struct rt_link_frame, slist);
+        frame->issent = RT_LINK_FRAME_NOSEND;
+        frame->acked = 0;
+    }
+    if (rt_slist_first(&rt_link_scb->tx_data_slist))
+    {
+        rt_event_send(&rt_link_scb->event, RT_LINK_SEND_READY_EVENT);
+    }
+}
+
+static void rt_link_window_rx_reset(void)
+{
+    struct rt_link_window_slot *slot = RT_NULL;
+    rt_uint8_t i = 0;
+
+    for (i = 0; i < RT_LINK_WINDOW_SIZE; i++)
+    {
+        slot = &rt_link_scb->rx_window[i];
+        if (slot->data)
+        {
+            rt_free(slot->data);
+        }
+        rt_memset(slot, 0, sizeof(struct rt_link_window_slot));
+    }
+    rt_link_scb->rx_window_head = 0;
+    rt_link_scb->rx_nack_seq = rt_link_scb->rx_record.rx_seq;
+
+    if (rt_link_scb->rx_long)
+    {
+        rt_free(rt_link_scb->rx_long);
+        rt_link_scb->rx_long = RT_NULL;
+    }
+    rt_link_scb->rx_long_total = 0;
+    rt_link_scb->rx_long_count = 0;
+}
+
+/* frames of a long package arrive here in order, append them */
+static void rt_link_window_long(struct rt_link_window_slot *slot, rt_uint8_t *ring_data)
+{
+    rt_size_t offset = 0;
+
+    if (rt_link_scb->rx_long_total == 0)
+    {
+        rt_link_scb->rx_long_total = (slot->parameter + RT_LINK_MAX_DATA_LENGTH - 1) / RT_LINK_MAX_DATA_LENGTH;
+        rt_link_scb->rx_long_count = 0;
+        rt_link_scb->rx_long = rt_malloc(slot->parameter);
+        if (rt_link_scb->rx_long == RT_NULL)
+        {
+            /* keep counting frames to find the start of the next package */
+            LOG_W("long data (%dB) alloc failed.", slot->parameter);
+        }
+    }
+
+    offset = rt_link_scb->rx_long_count * RT_LINK_MAX_DATA_LENGTH;
+    if ((rt_link_scb->rx_long != RT_NULL) && (offset + slot->data_len <= slot->parameter))
+    {
+        if (ring_data)
+        {
+            rt_link_hw_copy(rt_link_scb->rx_long + offset, ring_data, slot->data_len);
+        }
+        else
+        {
+            rt_memcpy(rt_link_scb->rx_long + offset, slot->data, slot->data_len);
+        }
+    }
+    if (slot->data)
+    {
+        rt_free(slot->data);
+        slot->data = RT_NULL;
+    }
+
+    if (++rt_link_scb->rx_long_count >= rt_link_scb->rx_long_total)
+    {
+        if (rt_link_scb->rx_long)
+        {
+            rt_link_recv_finish(slot->service, rt_link_scb->rx_long, slot->parameter);
+        }
+        rt_link_scb->rx_long = RT_NULL;
+        rt_link_scb->rx_long_total = 0;
+        rt_link_scb->rx_long_count = 0;
+    }
+}
+
+/* hand up one frame, from the receive buffer or from a window slot */
+static rt_err_t rt_link_window_deliver(struct rt_link_window_slot *slot, rt_uint8_t *ring_data)
+{
+    if (slot->attribute == RT_LINK_LONG_DATA_FRAME)
+    {
+        rt_link_window_long(slot, ring_data);
+    }
+    else
+    {
+        if (ring_data)
+        {
+            slot->data = rt_malloc(slot->data_len);
+            if (slot->data == RT_NULL)
+            {
+                LOG_W("short data %dB alloc failed", slot->data_len);
+                return -RT_ENOMEM;
+            }
+            rt_link_hw_copy(slot->data, ring_data, slot->data_len);
+        }
+        rt_link_recv_finish(slot->service, slot->data, slot->data_len);
+        slot->data = RT_NULL;
+    }
+
+    rt_link_scb->rx_record.rx_seq++;
+    rt_link_scb->rx_window_head = (rt_link_scb->rx_window_head + 1) % RT_LINK_WINDOW_SIZE;
+    return RT_EOK;
+}
+
+static rt_err_t rt_link_window_recv(struct rt_link_frame *receive_frame)
+{
+    struct rt_link_window_slot frame_slot = {0};
+    struct rt_link_window_slot *slot = RT_NULL;
+    rt_uint8_t offset = 0;
+    rt_uint8_t nack_seq = 0;
+
+    offset = rt_link_check_seq(receive_frame->head.sequence, rt_link_scb->rx_record.rx_seq) - 1;
+    if (offset >= RT_LINK_WINDOW_SIZE)
+    {
+        /* handed up already, confirm it again */
+        rt_link_scb->stats.rx_dup++;
+    }
+    else if (offset == 0)
+    {
+        frame_slot.data_len = receive_frame->data_len;
+        frame_slot.parameter = receive_frame->extend.parameter;
+        frame_slot.service = receive_frame->head.service;
+        frame_slot.attribute = receive_frame->attribute;
+        if (rt_link_window_deliver(&frame_slot, receive_frame->real_data) != RT_EOK)
+        {
+            /* no confirm, the opposite will send it again */
+            goto __exit;
+        }
+
+        /* the frames kept behind it can go up now */
+        slot = &rt_link_scb->rx_window[rt_link_scb->rx_window_head];
+        while (slot->valid)
+        {
+            slot->valid = 0;
+            rt_link_window_deliver(slot, RT_NULL);
+            slot = &rt_link_scb->rx_window[rt_link_scb->rx_window_head];
+        }
+    }
+    else
+    {
+        slot = &rt_link_scb->rx_window[(rt_link_scb->rx_window_head + offset) % RT_LINK_WINDOW_SIZE];
+        if (slot->valid)
+        {
+            rt_link_scb->stats.rx_dup++;
+        }
+        else
+        {
+            slot->data = rt_malloc(receive_frame->data_len);
+            if (slot->data == RT_NULL)
+            {
+                LOG_W("window data %dB alloc failed", receive_frame->data_len);
+                goto __exit;
+            }
+            rt_link_hw_copy(slot->data, receive_frame->real_data, receive_frame->data_len);
+            slot->data_len = receive_frame->data_len;
+            slot->parameter = receive_frame->extend.parameter;
+            slot->service = receive_frame->head.service;
+            slot->attribute = receive_frame->attribute;
+            slot->valid = 1;
+            rt_link_scb->stats.rx_ooo++;
+        }
+
+        /* ask for the missing frame once instead of waiting for the retransmission */
+        nack_seq = rt_link_scb->rx_record.rx_seq + 1;
+        if (rt_link_scb->rx_nack_seq != nack_seq)
+        {
+            rt_link_scb->rx_nack_seq = nack_seq;
+            rt_link_command_frame_send(receive_frame->head.service, nack_seq, RT_LINK_RESEND_FRAME, RT_NULL);
+        }
+    }
+
+    if (receive_frame->head.ack)
+    {
+        rt_link_command_frame_send(receive_frame->head.service,
+                                   receive_frame->head.sequence,
+                                   RT_LINK_CONFIRM_FRAME,
+                                   RT_LINK_CONFIRM_CUMULATIVE | rt_link_scb->rx_record.rx_seq);
+    }
+
+__exit:
+    receive_frame->real_data = RT_NULL;
+    return RT_EOK;
+}
+#endif /* RT_LINK_USING_WINDOW */
+
 static rt_err_t rt_link_short_handle(struct rt_link_frame *receive_frame)
 {
     LOG_D("Seq(%d) short data", receive_frame->head.sequence);
@@ -569,6 +968,9 @@ static rt_err_t rt_link_handshake_handle(struct rt_link_frame *receive_frame)
     rt_link_scb->state = RT_LINK_CONNECT;
     /* sync requester tx seq, responder rx seq = requester tx seq */
     rt_link_scb->rx_record.rx_seq = receive_frame->head.sequence;
+#ifdef RT_LINK_USING_WINDOW
+    rt_link_window_rx_reset();
+#endif
     /* sync requester rx seq, responder tx seq = requester rx seq */
     rt_link_scb->tx_seq = (rt_uint8_t)receive_frame->extend.parameter;
 
@@ -624,12 +1026,22 @@ static rt_err_t rt_link_parse_frame(struct rt_link_frame *receive_frame)
         rt_link_detach_handle(receive_frame);
         break;
 
+#ifdef RT_LINK_USING_WINDOW
     case RT_LINK_SHORT_DATA_FRAME:
+    case RT_LINK_LONG_DATA_FRAME:
+        rt_link_scb->stats.rx_frames++;
+        rt_link_window_recv(receive_frame);
+        break;
+#else
+    case RT_LINK_SHORT_DATA_FRAME:
+        rt_link_scb->stats.rx_frames++;
         rt_link_short_handle(receive_frame);
         break;
     case RT_LINK_LONG_DATA_FRAME:
+        rt_link_scb->stats.rx_frames++;
         rt_link_long_handle(receive_frame);
         break;
+#endif /* RT_LINK_USING_WINDOW */
 
     default:
         return -RT_ERROR;
@@ -746,12 +1158,21 @@ static void rt_link_frame_check(void)
             case RT_LINK_CONFIRM_FRAME:
             case RT_LINK_RESEND_FRAME:
             {
+#ifdef RT_LINK_USING_WINDOW
+                /* Check the frame is inside the send window, the handshake confirm is not */
+                if ((rt_link_scb->state == RT_LINK_CONNECT) && (rt_slist_first(&rt_link_scb->tx_data_slist) != RT_NULL))
+                {
+                    send_frame = rt_container_of(rt_link_scb->tx_data_slist.next, struct rt_link_frame, slist);
+                    offset = rt_link_check_seq(receive_frame.head.sequence, send_frame->head.sequence);
+                    if (offset >= RT_LINK_WINDOW_SIZE)
+#else
                 /* Check the send sequence */
                 offset = rt_link_check_seq(receive_frame.head.sequence, rt_link_scb->tx_seq);
                 if (rt_slist_first(&rt_link_scb->tx_data_slist) != RT_NULL)
                 {
                     send_frame = rt_container_of(rt_link_scb->tx_data_slist.next, struct rt_link_frame, slist);
                     if (offset > send_frame->total)
+#endif /* RT_LINK_USING_WINDOW */
                     {
                         /* exceptional frame, ignore it */
                         LOG_D("seq (%d) failed, tx_seq (%d).offset=(%d) total= (%d)", receive_frame.head.sequence, rt_link_scb->tx_seq, offset, send_frame->total);
@@ -767,7 +1188,12 @@ static void rt_link_frame_check(void)
             {
                 /* Check the receive sequence */
                 offset = rt_link_check_seq(receive_frame.head.sequence, rt_link_scb->rx_record.rx_seq) - 1;
+#ifdef RT_LINK_USING_WINDOW
+                /* ahead of rx_seq inside the window, or a repeat that needs another confirm */
+                if ((offset >= RT_LINK_WINDOW_SIZE) && (offset < 256 - RT_LINK_WINDOW_SIZE))
+#else
                 if (offset > RT_LINK_FRAMES_MAX)
+#endif
                 {
                     /* exceptional frame, ignore it */
                     LOG_D("seq (%d) failed, rx_seq (%d) offset=(%d) attr= (%d) status (%d)", receive_frame.head.sequence, rt_link_scb->rx_record.rx_seq, offset, receive_frame.attribute, rt_link_scb->state);
@@ -821,6 +1247,7 @@ static void rt_link_frame_check(void)
                 {
                     /* check failed. ready resent */
                     LOG_D("CRC: calc:(0x%08x) ,recv:(0x%08x).", temporary_crc, receive_frame.crc);
+                    rt_link_scb->stats.rx_crc_err++;
                     rt_link_hw_buffer_point_shift(&rt_link_scb->rx_buffer->read_point, 1);
                     goto __find_head;
                 }
@@ -875,6 +1302,13 @@ static void rt_link_send_ready(void)
 
     if (rt_link_scb->state != RT_LINK_CONNECT)
     {
+#ifdef RT_LINK_USING_WINDOW
+        /* the opposite expects the head frame right after the handshake */
+        if (frame != RT_NULL)
+        {
+            seq = frame->head.sequence - 1;
+        }
+#endif
         rt_link_scb->state = RT_LINK_DISCONN;
         rt_link_command_frame_send(RT_LINK_SERVICE_RTLINK, seq,
                                    RT_LINK_HANDSHAKE_FRAME, rt_link_scb->rx_record.rx_seq);
@@ -885,6 +1319,9 @@ static void rt_link_send_ready(void)
     }
     else
     {
+#ifdef RT_LINK_USING_WINDOW
+        rt_link_window_send();
+#else
         /* Avoid sending the first data frame multiple times */
         if ((frame != RT_NULL) && (frame->issent == RT_LINK_FRAME_NOSEND))
         {
@@ -894,6 +1331,7 @@ static void rt_link_send_ready(void)
                 rt_link_service_send_finish(RT_LINK_EIO);
             }
         }
+#endif /* RT_LINK_USING_WINDOW */
     }
 }
 
@@ -905,6 +1343,13 @@ static void rt_link_frame_recv_timeout(void)
 
 static void rt_link_send_timeout(void)
 {
+#ifdef RT_LINK_USING_WINDOW
+    if (rt_link_scb->state == RT_LINK_CONNECT)
+    {
+        rt_link_window_timeout();
+        return;
+    }
+#endif
     LOG_D("send count(%d)", (rt_uint32_t)rt_link_scb->sendtimer.parameter);
     if ((rt_uint32_t)rt_link_scb->sendtimer.parameter >= 5)
     {
@@ -920,7 +1365,11 @@ static void rt_link_send_timeout(void)
             struct rt_link_frame *frame = rt_container_of(rt_slist_next(&rt_link_scb->tx_data_slist), struct rt_link_frame, slist);
             frame->issent = RT_LINK_FRAME_NOSEND;
             rt_link_command_frame_send(RT_LINK_SERVICE_RTLINK,
+#ifdef RT_LINK_USING_WINDOW
+                                       frame->head.sequence - 1,
+#else
                                        frame->head.sequence,
+#endif
                                        RT_LINK_HANDSHAKE_FRAME,
                                        rt_link_scb->rx_record.rx_seq);
         }
@@ -1141,6 +1590,12 @@ void rtlink_status(void)
         rt_kprintf("\tsend timer state=%d\n", state);
 
         rt_kprintf("\tevent set=0x%08x\n", rt_link_scb->event.set);
+#ifdef RT_LINK_USING_WINDOW
+        rt_kprintf("\twindow=%d rto=%dms\n", RT_LINK_WINDOW_SIZE, RT_LINK_WINDOW_RTO);
+#endif
+        rt_kprintf("\ttx frames=%u retrans=%u\n", rt_link_scb->stats.tx_frames, rt_link_scb->stats.tx_retrans);
+        rt_kprintf("\trx frames=%u dup=%u ooo=%u crc err=%u\n", rt_link_scb->stats.rx_frames,
+                   rt_link_scb->stats.rx_dup, rt_link_scb->stats.rx_ooo, rt_link_scb->stats.rx_crc_err);
         if (rt_link_scb->tx_data_slist.next)
         {
             rt_slist_t *data = RT_NULL;
@@ -1178,6 +1633,9 @@ rt_err_t rt_link_deinit(void)
     rt_link_hw_deinit();
     if (rt_link_scb)
     {
+#ifdef RT_LINK_USING_WINDOW
+        rt_link_window_rx_reset();
+#endif
         rt_timer_detach(&rt_link_scb->longframetimer);
         rt_timer_detach(&rt_link_scb->sendtimer);
         rt_timer_detach(&rt_link_scb->recvtimer);
@@ -1231,6 +1689,9 @@ int rt_link_init(void)
                   RT_NULL, 0, RT_TIMER_FLAG_SOFT_TIMER | RT_TIMER_FLAG_PERIODIC);
 
     rt_link_scb->rx_record.rx_seq = 255;
+#ifdef RT_LINK_USING_WINDOW
+    rt_link_scb->rx_nack_seq = rt_link_scb->rx_record.rx_seq;
+#endif
 
     rt_slist_init(&rt_link_scb->tx_data_slist);
     rt_link_scb->tx_seq = RT_LINK_INIT_FRAME_SEQENCE;
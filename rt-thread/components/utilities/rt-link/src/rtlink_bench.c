@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-17     RT-Thread    the first version
+ */
+
+/*
+ * Throughput of the link to a peer that consumes the data, for example
+ * tools/rtlink_peer.py on a PC, which can also drop frames to simulate loss.
+ * Packages are sent in non-blocking mode so the window stays filled, the
+ * number of packages queued at once is limited by a semaphore. The stop and
+ * wait mode only copes with one queued package, run it with "queued" 1.
+ */
+
+#include <stdlib.h>
+#include <rtthread.h>
+#include <rtlink.h>
+
+#if defined(RT_USING_RT_LINK) && defined(RT_USING_FINSH)
+
+#define RT_LINK_BENCH_QUEUED    8   /* default packages queued at once */
+
+static struct rt_link_service bench_serv;
+static struct rt_semaphore bench_sem;
+static volatile rt_uint32_t bench_errors;
+static volatile rt_uint32_t bench_confirmed;
+
+static void bench_send_cb(struct rt_link_service *service, void *buffer)
+{
+    if (service->err != RT_LINK_EOK)
+    {
+        bench_errors++;
+    }
+    else
+    {
+        bench_confirmed++;
+    }
+    rt_sem_release(&bench_sem);
+}
+
+static void bench_recv_cb(struct rt_link_service *service, void *data, rt_size_t size)
+{
+    if (size)
+    {
+        rt_free(data);
+    }
+}
+
+static void rtlink_bench(int argc, char **argv)
+{
+    struct rt_link_session *scb = rt_link_get_scb();
+    struct rt_link_stats start_stats;
+    rt_uint8_t *buffer = RT_NULL;
+    rt_size_t size = RT_LINK_MAX_DATA_LENGTH;
+    rt_uint32_t seconds = 10;
+    rt_uint64_t bytes = 0;
+    rt_uint32_t queued = 0;
+    rt_uint32_t ms = 0;
+    rt_uint32_t depth = RT_LINK_BENCH_QUEUED;
+    rt_tick_t start, now;
+    rt_size_t i;
+
+    if (argc > 1)
+    {
+        seconds = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        size = atoi(argv[2]);
+    }
+    if (argc > 3)
+    {
+        depth = atoi(argv[3]);
+    }
+    if (scb == RT_NULL || seconds == 0 || size == 0 || size > RT_LINK_MAX_DATA_LENGTH * RT_LINK_FRAMES_MAX || depth == 0)
+    {
+        rt_kprintf("Usage: rtlink_bench [seconds] [package size, max %d] [queued packages]\n",
+                   RT_LINK_MAX_DATA_LENGTH * RT_LINK_FRAMES_MAX);
+        return;
+    }
+
+    buffer = rt_malloc(size);
+    if (buffer == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        return;
+    }
+    for (i = 0; i < size; i++)
+    {
+        buffer[i] = (rt_uint8_t)(i % 93 + 33);
+    }
+
+    rt_memset(&bench_serv, 0, sizeof(bench_serv));
+    bench_serv.service = RT_LINK_SERVICE_MNGT;
+    bench_serv.timeout_tx = RT_WAITING_NO;
+    bench_serv.flag = RT_LINK_FLAG_ACK | RT_LINK_FLAG_CRC;
+    bench_serv.send_cb = bench_send_cb;
+    bench_serv.recv_cb = bench_recv_cb;
+    rt_sem_init(&bench_sem, "rlbench", depth, RT_IPC_FLAG_PRIO);
+    bench_errors = 0;
+    bench_confirmed = 0;
+    rt_link_service_attach(&bench_serv);
+
+    start_stats = scb->stats;
+    start = rt_tick_get();
+    now = start;
+    while (now - start < rt_tick_from_millisecond(seconds * 1000))
+    {
+        if (rt_sem_take(&bench_sem, rt_tick_from_millisecond(1000)) != RT_EOK)
+        {
+            now = rt_tick_get();
+            continue;
+        }
+        /* the buffer is not changed, so it can be queued again before it is confirmed */
+        if (rt_link_send(&bench_serv, buffer, size) == size)
+        {
+            queued++;
+        }
+        else
+        {
+            bench_errors++;
+            rt_sem_release(&bench_sem);
+            rt_thread_mdelay(10);
+        }
+        now = rt_tick_get();
+    }
+
+    /* wait for the packages still in flight */
+    for (i = 0; i < depth; i++)
+    {
+        rt_sem_take(&bench_sem, rt_tick_from_millisecond(2000));
+    }
+    ms = (rt_tick_get() - start) * 1000 / RT_TICK_PER_SECOND;
+    bytes = (rt_uint64_t)bench_confirmed * size;
+
+    rt_kprintf("%u/%u packages of %d bytes confirmed in %u ms, %u bytes/s, %u errors\n",
+               bench_confirmed, queued, size, ms, ms ? (rt_uint32_t)(bytes * 1000 / ms) : 0, bench_errors);
+    rt_kprintf("tx frames %u, retransmitted %u, rx crc errors %u\n",
+               scb->stats.tx_frames - start_stats.tx_frames,
+               scb->stats.tx_retrans - start_stats.tx_retrans,
+               scb->stats.rx_crc_err - start_stats.rx_crc_err);
+
+    rt_link_service_detach(&bench_serv);
+    rt_sem_detach(&bench_sem);
+    rt_free(buffer);
+}
+MSH_CMD_EXPORT(rtlink_bench, rt link throughput: rtlink_bench [seconds] [package size] [queued]);
+
+#endif /* RT_USING_RT_LINK && RT_USING_FINSH */
@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2021-02-02     xiangxistu   the first version
  * 2021-05-08     Sherman      Optimize the operation function on the rt_link_receive_buffer
+ * 2025-02-17     RT-Thread    Add direct receive buffer access, fix hw crc init
  */
 
 #include <rtthread.h>
@@ -232,6 +233,52 @@ rt_size_t rt_link_hw_write_cb(void *data, rt_size_t length)
     return len;
 }
 
+/* contiguous free space at the write point, one byte stays free to tell full from empty */
+rt_size_t rt_link_hw_write_span(rt_uint8_t **span)
+{
+    rt_uint8_t *read_point = RT_NULL;
+
+    if (rx_buffer == RT_NULL)
+    {
+        return 0;
+    }
+
+    read_point = rx_buffer->read_point;
+    *span = rx_buffer->write_point;
+    if (rx_buffer->write_point >= read_point)
+    {
+        /* (data)----(r)----(w)----(end) */
+        if (read_point == rx_buffer->data)
+        {
+            return rx_buffer->end_point - rx_buffer->write_point - 1;
+        }
+        return rx_buffer->end_point - rx_buffer->write_point;
+    }
+    /* (data)----(w)----(r)----(end) */
+    return read_point - rx_buffer->write_point - 1;
+}
+
+/* the hardware wrote length bytes at the span, no more than rt_link_hw_write_span() returned */
+void rt_link_hw_write_commit(rt_size_t length)
+{
+    struct rt_link_session *scb = rt_link_get_scb();
+
+    if ((rx_buffer == RT_NULL) || (length == 0))
+    {
+        return;
+    }
+
+    rx_buffer->write_point += length;
+    if (rx_buffer->write_point >= rx_buffer->end_point)
+    {
+        rx_buffer->write_point = rx_buffer->data;
+    }
+    if (scb)
+    {
+        rt_event_send(&scb->event, RT_LINK_READ_CHECK_EVENT);
+    }
+}
+
 rt_err_t rt_link_hw_init(void)
 {
     struct rt_link_session *scb = rt_link_get_scb();
@@ -253,7 +300,7 @@ rt_err_t rt_link_hw_init(void)
         return -RT_ERROR;
     }
 
-#ifdef LINK_LAYER_USING_HW_CRC
+#ifdef RT_LINK_USING_HW_CRC
     /* crc hardware device for mcu and node */
     if (RT_EOK != rt_link_hw_crc32_init())
     {
@@ -283,7 +330,7 @@ rt_err_t rt_link_hw_deinit(void)
         return -RT_ERROR;
     }
 
-#ifdef LINK_LAYER_USING_HW_CRC
+#ifdef RT_LINK_USING_HW_CRC
     /* crc hardware device for mcu and node */
     if (RT_EOK != rt_link_hw_crc32_deinit())
     {
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-17     RT-Thread    the first version
+ */
+
+/*
+ * rt-link port on a serial V2 device.
+ *
+ * With BSP_UARTx_RX_USING_DMA the uart DMA fills the serial ring buffer, the
+ * receive indication copies it straight into the rt-link receive buffer, so
+ * there is no bounce buffer between the two. With BSP_UARTx_TX_USING_DMA and
+ * no tx buffer (BSP_UARTx_TX_BUFSIZE 0) a frame goes out by DMA directly from
+ * the rt-link send buffer.
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <rthw.h>
+
+#include <rtlink.h>
+#include <rtlink_port.h>
+
+#ifdef RT_LINK_USING_UART
+
+#define DBG_TAG "rtlink_uart"
+#ifdef USING_RT_LINK_HW_DEBUG
+    #define DBG_LVL DBG_LOG
+#else
+    #define DBG_LVL DBG_INFO
+#endif
+#define DBG_COLOR
+#include <rtdbg.h>
+
+static rt_device_t link_serial = RT_NULL;
+static struct rt_mutex link_tx_lock;
+
+/* runs in the uart interrupt, the non-blocking read only takes data out of the ring */
+static rt_err_t rt_link_uart_rx_ind(rt_device_t dev, rt_size_t size)
+{
+    rt_uint8_t *span = RT_NULL;
+    rt_size_t space = 0;
+    rt_size_t len = 0;
+
+    /* the free space may wrap around the end of the receive buffer */
+    while ((space = rt_link_hw_write_span(&span)) > 0)
+    {
+        len = rt_device_read(dev, 0, span, space);
+        rt_link_hw_write_commit(len);
+        if (len < space)
+        {
+            break;
+        }
+    }
+    return RT_EOK;
+}
+
+rt_err_t rt_link_port_init(void)
+{
+    struct serial_configure config;
+
+    link_serial = rt_device_find(RT_LINK_UART_NAME);
+    if (link_serial == RT_NULL)
+    {
+        LOG_E("can't find %s.", RT_LINK_UART_NAME);
+        return -RT_ERROR;
+    }
+
+    config = ((struct rt_serial_device *)link_serial)->config;
+    config.baud_rate = RT_LINK_UART_BAUD_RATE;
+    rt_device_control(link_serial, RT_DEVICE_CTRL_CONFIG, &config);
+
+    rt_mutex_init(&link_tx_lock, "rtlink_tx", RT_IPC_FLAG_PRIO);
+    rt_device_set_rx_indicate(link_serial, rt_link_uart_rx_ind);
+    if (rt_device_open(link_serial, RT_DEVICE_FLAG_RX_NON_BLOCKING | RT_DEVICE_FLAG_TX_BLOCKING) != RT_EOK)
+    {
+        LOG_E("open %s failed.", RT_LINK_UART_NAME);
+        rt_device_set_rx_indicate(link_serial, RT_NULL);
+        rt_mutex_detach(&link_tx_lock);
+        link_serial = RT_NULL;
+        return -RT_ERROR;
+    }
+
+    LOG_I("rtlink on %s, %d bps.", RT_LINK_UART_NAME, RT_LINK_UART_BAUD_RATE);
+    return RT_EOK;
+}
+
+rt_err_t rt_link_port_deinit(void)
+{
+    if (link_serial == RT_NULL)
+    {
+        return RT_EOK;
+    }
+
+    rt_device_set_rx_indicate(link_serial, RT_NULL);
+    rt_device_close(link_serial);
+    rt_mutex_detach(&link_tx_lock);
+    link_serial = RT_NULL;
+    return RT_EOK;
+}
+
+rt_err_t rt_link_port_reconnect(void)
+{
+    rt_link_port_deinit();
+    return rt_link_port_init();
+}
+
+rt_size_t rt_link_port_send(void *data, rt_size_t length)
+{
+    rt_size_t size = 0;
+
+    if (link_serial == RT_NULL)
+    {
+        return 0;
+    }
+
+    /* command frames are also sent from the service attach and detach callers */
+    rt_mutex_take(&link_tx_lock, RT_WAITING_FOREVER);
+    /* the uart DMA reads memory, not the cache */
+    rt_hw_cpu_dcache_ops(RT_HW_CACHE_FLUSH, data, length);
+    size = rt_device_write(link_serial, 0, data, length);
+    rt_mutex_release(&link_tx_lock);
+
+    return size;
+}
+
+#ifdef RT_USING_FINSH
+#include <stdlib.h>
+
+/* change the baud rate at run time, the peer has to follow */
+static void rtlink_baud(int argc, char **argv)
+{
+    struct serial_configure config;
+
+    if (argc != 2 || link_serial == RT_NULL)
+    {
+        rt_kprintf("Usage: rtlink_baud <bps>, after rt-link is attached\n");
+        return;
+    }
+
+    config = ((struct rt_serial_device *)link_serial)->config;
+    config.baud_rate = atoi(argv[1]);
+    rt_device_control(link_serial, RT_DEVICE_CTRL_CONFIG, &config);
+}
+MSH_CMD_EXPORT(rtlink_baud, set the rt link uart baud rate: rtlink_baud <bps>);
+#endif /* RT_USING_FINSH */
+
+#endif /* RT_LINK_USING_UART */
@@ -6,10 +6,20 @@
  * Change Logs:
  * Date           Author       Notes
  * 2021-05-15     Sherman      the first version
+ * 2025-02-17     RT-Thread    CRC32 on the hwcrypto CRC device
  */
 
 #include <rtlink_utils.h>
 
+#ifdef RT_LINK_USING_HW_CRC
+#include <rtdevice.h>
+#include <rtlink_port.h>
+
+#define DBG_TAG "rtlink_crc"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+#endif
+
 /* Calculate the number of '1' */
 int rt_link_utils_num1(rt_uint32_t n)
 {
@@ -22,8 +32,7 @@ int rt_link_utils_num1(rt_uint32_t n)
     return ret;
 }
 
-#ifdef RT_LINK_USING_SF_CRC
-
+/* the table also backs up the hardware CRC when no device is available */
 static rt_uint32_t crc = 0xffffffff;
 const rt_uint32_t crc_table[256] =
 {
@@ -87,4 +96,71 @@ rt_uint32_t rt_link_sf_crc32(rt_uint8_t *data, rt_size_t len)
     }
     return (crc ^ 0xffffffff);
 }
-#endif /* RT_LINK_USING_SF_CRC */
+
+#ifdef RT_LINK_USING_HW_CRC
+#ifdef RT_HWCRYPTO_USING_CRC
+static struct rt_hwcrypto_ctx *crc_ctx = RT_NULL;
+#endif
+
+rt_err_t rt_link_hw_crc32_init(void)
+{
+#ifdef RT_HWCRYPTO_USING_CRC
+    if (crc_ctx == RT_NULL)
+    {
+        crc_ctx = rt_hwcrypto_crc_create(rt_hwcrypto_dev_default(), HWCRYPTO_CRC_CRC32);
+    }
+    if (crc_ctx != RT_NULL)
+    {
+        return RT_EOK;
+    }
+#endif
+    LOG_W("no hardware crc device, use software crc table.");
+    return RT_EOK;
+}
+
+rt_err_t rt_link_hw_crc32_deinit(void)
+{
+#ifdef RT_HWCRYPTO_USING_CRC
+    if (crc_ctx != RT_NULL)
+    {
+        rt_hwcrypto_crc_destroy(crc_ctx);
+        crc_ctx = RT_NULL;
+    }
+#endif
+    return RT_EOK;
+}
+
+rt_err_t rt_link_hw_crc32_reset(void)
+{
+#ifdef RT_HWCRYPTO_USING_CRC
+    /* same CRC-32 as the table: reflected 0x04C11DB7, init and xorout 0xFFFFFFFF */
+    struct hwcrypto_crc_cfg cfg =
+    {
+        .last_val = 0xFFFFFFFF,
+        .poly = 0x04C11DB7,
+        .width = 32,
+        .xorout = 0xFFFFFFFF,
+        .flags = CRC_FLAG_REFIN | CRC_FLAG_REFOUT,
+    };
+
+    if (crc_ctx != RT_NULL)
+    {
+        rt_hwcrypto_crc_cfg(crc_ctx, &cfg);
+        return RT_EOK;
+    }
+#endif
+    return rt_link_sf_crc32_reset();
+}
+
+/* may be called more than once after a reset, the device keeps the running value */
+rt_uint32_t rt_link_hw_crc32(rt_uint8_t *data, rt_size_t u32_size)
+{
+#ifdef RT_HWCRYPTO_USING_CRC
+    if (crc_ctx != RT_NULL)
+    {
+        return rt_hwcrypto_crc_update(crc_ctx, data, u32_size);
+    }
+#endif
+    return rt_link_sf_crc32(data, u32_size);
+}
+#endif /* RT_LINK_USING_HW_CRC */
@@ -0,0 +1,341 @@
+# -*- coding: utf-8 -*-
+"""
+rt-link throughput harness.
+
+serial mode: act as the receiving end of rt-link on a PC, drop frames on
+purpose to simulate a lossy link, and print the goodput every second.
+
+    python3 rtlink_peer.py serial COM5 921600 --loss 0.01 --ack-loss 0.01
+    msh />rtlink_bench 10 1012          (RT_LINK_USING_WINDOW)
+    python3 rtlink_peer.py serial COM5 921600 --loss 0.01 --legacy
+    msh />rtlink_bench 10 1012 1        (stop and wait)
+
+sim mode: connect a model of the rt-link sender to the same receiver over a
+simulated pipe, to sweep baud rate, loss rate and window size without a board.
+
+    python3 rtlink_peer.py sim --baud 115200 921600 2000000 --loss 0 0.01 0.05 --window 1 4 8
+"""
+import argparse
+import heapq
+import random
+import struct
+import sys
+import time
+import zlib
+
+FRAME_HEAD = 0x15
+HEAD_MASK = 0x1F
+HEAD_LEN = 4
+EXTEND_LEN = 4
+CRC_LEN = 4
+MAX_FRAME = 1024
+MAX_DATA = MAX_FRAME - HEAD_LEN - EXTEND_LEN - CRC_LEN
+
+ATTR_RESEND = 0
+ATTR_CONFIRM = 1
+ATTR_HANDSHAKE = 2
+ATTR_DETACH = 3
+ATTR_SESSION_END = 4
+ATTR_LONG = 5
+ATTR_SHORT = 6
+
+CONFIRM_CUMULATIVE = 0x8000
+
+
+class Frame(object):
+    def __init__(self, seq, service, attr, param=0, data=b'', ack=True, crc=True):
+        self.seq = seq & 0xFF
+        self.service = service
+        self.attr = attr
+        self.param = param
+        self.data = data
+        self.ack = ack
+        self.crc = crc
+
+    def pack(self):
+        # struct rt_link_frame_head: magicid:5 extend:1 crc:1 ack:1, sequence, service:5 length:11
+        is_data = self.attr in (ATTR_LONG, ATTR_SHORT)
+        extend = (not is_data) or self.attr == ATTR_LONG
+        crc = self.crc and is_data
+        b0 = FRAME_HEAD | (extend << 5) | (crc << 6) | ((self.ack and is_data) << 7)
+        raw = struct.pack('<BBH', b0, self.seq, self.service | (len(self.data) << 5))
+        if extend:
+            raw += struct.pack('<HH', self.attr, self.param)
+        raw += self.data
+        if crc:
+            raw += struct.pack('<I', zlib.crc32(raw) & 0xFFFFFFFF)
+        return raw
+
+
+class Parser(object):
+    """byte stream to frames, same checks as rt_link_frame_check()"""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.crc_errors = 0
+
+    def feed(self, data):
+        self.buf += data
+        frames = []
+        while True:
+            while self.buf and (self.buf[0] & HEAD_MASK) != FRAME_HEAD:
+                del self.buf[0]
+            if len(self.buf) < HEAD_LEN:
+                break
+            b0, seq, word = struct.unpack_from('<BBH', self.buf)
+            extend, crc, ack = (b0 >> 5) & 1, (b0 >> 6) & 1, (b0 >> 7) & 1
+            service, length = word & 0x1F, word >> 5
+            need = HEAD_LEN + (EXTEND_LEN if extend else 0) + length + (CRC_LEN if crc else 0)
+            if len(self.buf) < need:
+                break
+            attr, param = ATTR_SHORT, 0
+            pos = HEAD_LEN
+            if extend:
+                attr, param = struct.unpack_from('<HH', self.buf, pos)
+                pos += EXTEND_LEN
+            data = bytes(self.buf[pos:pos + length])
+            if crc:
+                (value,) = struct.unpack_from('<I', self.buf, need - CRC_LEN)
+                if value != zlib.crc32(bytes(self.buf[:need - CRC_LEN])) & 0xFFFFFFFF:
+                    self.crc_errors += 1
+                    del self.buf[0]
+                    continue
+            del self.buf[:need]
+            frames.append(Frame(seq, service, attr, param, data, ack, crc))
+        return frames
+
+
+class Receiver(object):
+    """the receiving end: selective repeat window, or the legacy package confirm"""
+
+    def __init__(self, send, window=8, legacy=False, loss=0.0, ack_loss=0.0, rng=random):
+        self.send = send
+        self.window = window
+        self.legacy = legacy
+        self.loss = loss
+        self.ack_loss = ack_loss
+        self.rng = rng
+        self.rx_seq = 255
+        self.nack_seq = 255
+        self.slots = {}
+        self.stats = dict(bytes=0, frames=0, dropped=0, dup=0, ooo=0, acks=0, acks_dropped=0)
+
+    def command(self, seq, service, attr, param=0):
+        if attr == ATTR_CONFIRM and self.rng.random() < self.ack_loss:
+            self.stats['acks_dropped'] += 1
+            return
+        self.stats['acks'] += attr == ATTR_CONFIRM
+        self.send(Frame(seq, service, attr, param))
+
+    def deliver(self, frame):
+        self.stats['bytes'] += len(frame.data)
+        self.rx_seq = (self.rx_seq + 1) & 0xFF
+
+    def on_frame(self, frame):
+        if frame.attr == ATTR_HANDSHAKE:
+            self.rx_seq = frame.seq
+            self.nack_seq = frame.seq
+            self.slots.clear()
+            self.command(frame.seq, frame.service, ATTR_CONFIRM)
+            return
+        if frame.attr not in (ATTR_LONG, ATTR_SHORT):
+            return
+        if self.rng.random() < self.loss:
+            self.stats['dropped'] += 1
+            return
+        self.stats['frames'] += 1
+        offset = (frame.seq - self.rx_seq - 1) & 0xFF
+        if self.legacy:
+            self.on_legacy(frame, offset)
+            return
+
+        if offset >= self.window:
+            self.stats['dup'] += 1
+        elif offset == 0:
+            self.deliver(frame)
+            nxt = (self.rx_seq + 1) & 0xFF
+            while nxt in self.slots:
+                self.deliver(self.slots.pop(nxt))
+                nxt = (self.rx_seq + 1) & 0xFF
+        else:
+            if frame.seq in self.slots:
+                self.stats['dup'] += 1
+            else:
+                self.slots[frame.seq] = frame
+                self.stats['ooo'] += 1
+            missing = (self.rx_seq + 1) & 0xFF
+            if self.nack_seq != missing:
+                self.nack_seq = missing
+                self.command(missing, frame.service, ATTR_RESEND)
+        if frame.ack:
+            self.command(frame.seq, frame.service, ATTR_CONFIRM, CONFIRM_CUMULATIVE | self.rx_seq)
+
+    def on_legacy(self, frame, offset):
+        # the stop and wait sender only needs the confirm of the whole package
+        if offset != 0:
+            if offset >= 256 - 4:
+                self.stats['dup'] += 1
+                if frame.ack:
+                    self.command(self.rx_seq, frame.service, ATTR_CONFIRM)
+            return
+        self.deliver(frame)
+        total = 1
+        if frame.attr == ATTR_LONG:
+            total = (frame.param + MAX_DATA - 1) // MAX_DATA
+            self.slots[frame.seq] = frame
+            if len(self.slots) < total:
+                return
+            self.slots.clear()
+        if frame.ack:
+            self.command(frame.seq, frame.service, ATTR_CONFIRM)
+
+
+def run_serial(args):
+    import serial
+
+    port = serial.Serial(args.port, args.baud, timeout=0.05)
+    parser = Parser()
+    rx = Receiver(lambda f: port.write(f.pack()), args.window, args.legacy, args.loss, args.ack_loss)
+    print('rt-link peer on %s %d bps, window %d%s, loss %.3f, ack loss %.3f' %
+          (args.port, args.baud, args.window, ' (legacy)' if args.legacy else '', args.loss, args.ack_loss))
+
+    last = time.time()
+    last_bytes = 0
+    while True:
+        data = port.read(4096)
+        if data:
+            for frame in parser.feed(data):
+                rx.on_frame(frame)
+        now = time.time()
+        if now - last >= 1.0:
+            s = rx.stats
+            rate = (s['bytes'] - last_bytes) / (now - last)
+            if rate or data:
+                print('%8.0f B/s (%5.1f%% of line)  frames %d dropped %d dup %d ooo %d crc %d acks %d/%d' %
+                      (rate, rate * 1000.0 / args.baud, s['frames'], s['dropped'], s['dup'], s['ooo'],
+                       parser.crc_errors, s['acks'], s['acks'] + s['acks_dropped']))
+            last, last_bytes = now, s['bytes']
+
+
+class Sender(object):
+    """model of the rt-link sender in window mode, window 1 is stop and wait per frame.
+    send() returns when the frame has left the uart, like the blocking DMA write"""
+
+    def __init__(self, send, window, rto, size):
+        self.send = send
+        self.window = window
+        self.rto = rto
+        self.size = min(size, MAX_DATA)
+        self.seq = 0
+        self.inflight = []      # [frame, acked, sent_time]
+        self.bytes = 0
+        self.retrans = 0
+
+    def fill(self, now):
+        while len(self.inflight) < self.window:
+            frame = Frame(self.seq, 3, ATTR_SHORT, data=b'\x55' * self.size)
+            self.seq = (self.seq + 1) & 0xFF
+            self.inflight.append([frame, False, self.send(frame)])
+
+    def release(self):
+        while self.inflight and self.inflight[0][1]:
+            self.bytes += len(self.inflight.pop(0)[0].data)
+
+    def on_frame(self, frame, now):
+        for item in self.inflight:
+            cum = frame.param & 0xFF
+            if frame.attr == ATTR_CONFIRM and (item[0].seq == frame.seq or (
+                    frame.param & CONFIRM_CUMULATIVE and ((cum - item[0].seq) & 0xFF) < self.window)):
+                item[1] = True
+            elif frame.attr == ATTR_RESEND and item[0].seq == frame.seq and not item[1]:
+                self.retrans += 1
+                item[2] = self.send(item[0])
+        self.release()
+        self.fill(now)
+
+    def on_timer(self, now):
+        for item in self.inflight:
+            if not item[1] and now - item[2] >= self.rto:
+                self.retrans += 1
+                item[2] = self.send(item[0])
+
+
+def simulate(baud, loss, window, seconds=5.0, rto=0.1, latency=0.0005, size=MAX_DATA, seed=1):
+    """full duplex uart: frames queue per direction and take 10 bits per byte"""
+    events = []
+    line_free = {'tx': 0.0, 'rx': 0.0}
+    state = {'now': 0.0, 'n': 0}
+    rng = random.Random(seed)
+
+    def transmit(direction, frame, target):
+        start = max(state['now'], line_free[direction])
+        line_free[direction] = start + len(frame.pack()) * 10.0 / baud
+        state['n'] += 1
+        heapq.heappush(events, (line_free[direction] + latency, state['n'], target, frame))
+        return line_free[direction]
+
+    sender = Sender(lambda f: transmit('tx', f, 'rx'), window, rto, size)
+    receiver = Receiver(lambda f: transmit('rx', f, 'tx'), max(window, 1), False, loss, loss, rng)
+    receiver.rx_seq = 255
+    sender.fill(0.0)
+    next_timer = rto / 2
+
+    while state['now'] < seconds:
+        if not events or next_timer <= events[0][0]:
+            state['now'] = next_timer
+            sender.on_timer(next_timer)
+            next_timer += rto / 2
+            continue
+        t, _, target, frame = heapq.heappop(events)
+        state['now'] = t
+        if target == 'rx':
+            receiver.on_frame(frame)
+        else:
+            sender.on_frame(frame, t)
+    return sender.bytes / seconds, sender.retrans
+
+
+def run_sim(args):
+    print('%10s %7s %6s %12s %8s %8s' % ('baud', 'loss', 'window', 'goodput B/s', 'of line', 'retrans'))
+    for baud in args.baud:
+        for loss in args.loss:
+            for window in args.window:
+                rate, retrans = simulate(baud, loss, window, args.seconds, args.rto / 1000.0,
+                                         args.latency / 1000.0, args.size)
+                print('%10d %7.3f %6d %12.0f %7.1f%% %8d' %
+                      (baud, loss, window, rate, rate * 1000.0 / baud, retrans))
+
+
+def main():
+    ap = argparse.ArgumentParser(description='rt-link throughput harness')
+    sub = ap.add_subparsers(dest='mode')
+
+    sp = sub.add_parser('serial', help='receiving peer on a serial port')
+    sp.add_argument('port')
+    sp.add_argument('baud', type=int)
+    sp.add_argument('--window', type=int, default=8, help='RT_LINK_WINDOW_SIZE of the board')
+    sp.add_argument('--legacy', action='store_true', help='board built without RT_LINK_USING_WINDOW')
+    sp.add_argument('--loss', type=float, default=0.0, help='probability to drop a data frame')
+    sp.add_argument('--ack-loss', type=float, default=0.0, help='probability to drop a confirm')
+
+    sm = sub.add_parser('sim', help='sender model and receiver over a simulated pipe')
+    sm.add_argument('--baud', type=int, nargs='+', default=[115200, 921600])
+    sm.add_argument('--loss', type=float, nargs='+', default=[0.0, 0.01, 0.05])
+    sm.add_argument('--window', type=int, nargs='+', default=[1, 4, 8])
+    sm.add_argument('--seconds', type=float, default=5.0)
+    sm.add_argument('--rto', type=float, default=100, help='ms, RT_LINK_WINDOW_RTO')
+    sm.add_argument('--latency', type=float, default=0.5, help='ms, processing delay per frame')
+    sm.add_argument('--size', type=int, default=MAX_DATA)
+
+    args = ap.parse_args()
+    if args.mode == 'serial':
+        run_serial(args)
+    elif args.mode == 'sim':
+        run_sim(args)
+    else:
+        ap.print_help()
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
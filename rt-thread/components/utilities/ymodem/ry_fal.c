@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2006-2025, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2025-02-18     RT-Thread    the first version
+ */
+
+/*
+ * Receive a file by YMODEM straight into a FAL partition.
+ *
+ * The ymodem thread only copies each packet into a small ring and answers ACK
+ * at once. A writer thread takes packets out of the ring and programs them,
+ * and while the ring is empty it erases the blocks ahead of the write pointer,
+ * so the block erase overlaps with the reception of the next packets instead
+ * of stalling the transfer. Every packet is read back after programming and
+ * a CRC-32 of the whole image is kept, it is printed at the end to compare
+ * with the file on the host.
+ *
+ * Nothing may be printed during the transfer, the console is the ymodem line.
+ */
+
+#include <rtthread.h>
+#include <ymodem.h>
+#include <fal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef YMODEM_FAL_RING_PACKETS
+#define YMODEM_FAL_RING_PACKETS     8
+#endif
+
+/* how far to erase ahead when the sender doesn't tell the file size */
+#ifndef YMODEM_FAL_ERASE_AHEAD
+#define YMODEM_FAL_ERASE_AHEAD      (64 * 1024)
+#endif
+
+#ifndef YMODEM_FAL_THREAD_PRIORITY
+#ifdef FINSH_THREAD_PRIORITY
+/* below the shell, the ymodem receiver must never wait for the flash */
+#define YMODEM_FAL_THREAD_PRIORITY  (FINSH_THREAD_PRIORITY + 1)
+#else
+#define YMODEM_FAL_THREAD_PRIORITY  (RT_THREAD_PRIORITY_MAX - 8)
+#endif
+#endif
+
+#define RYM_FAL_PKG_SZ              1024
+
+struct rym_fal_packet
+{
+    rt_uint32_t len;
+    rt_uint8_t data[RYM_FAL_PKG_SZ];
+};
+
+struct rym_fal_ctx
+{
+    struct rym_ctx parent;
+    const struct fal_partition *part;
+    rt_size_t blk_size;
+    rt_bool_t sync;
+
+    /* the ring of received packets, filled by the ymodem thread */
+    struct rym_fal_packet *ring;
+    rt_uint32_t head;
+    rt_uint32_t tail;
+    struct rt_semaphore free_sem;
+    struct rt_semaphore full_sem;
+    struct rt_semaphore exit_sem;
+    rt_thread_t writer;
+    volatile rt_bool_t finish;
+
+    rt_uint8_t *verify;
+    rt_uint8_t next_seq;
+    rt_int32_t flen;            /* file size from the header, -1 for unknown */
+    rt_uint32_t recv_off;       /* bytes received */
+    rt_uint32_t write_off;      /* bytes programmed */
+    rt_uint32_t erase_off;      /* partition erased below this offset */
+    rt_uint32_t crc;
+    int err;
+
+    rt_tick_t start;
+    rt_tick_t end;
+    rt_tick_t erase_ticks;
+    rt_tick_t write_ticks;
+    rt_tick_t stall_ticks;      /* ymodem thread waiting for a free packet */
+    rt_uint32_t dup_packets;
+};
+
+static rt_uint32_t _crc32_update(rt_uint32_t crc, const rt_uint8_t *buf, rt_size_t len)
+{
+    int i;
+
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *buf++;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (-(crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static rt_uint32_t _erase_limit(struct rym_fal_ctx *fctx)
+{
+    rt_uint32_t limit;
+
+    if (fctx->flen >= 0)
+    {
+        limit = RT_ALIGN(fctx->flen, fctx->blk_size);
+    }
+    else
+    {
+        limit = RT_ALIGN(fctx->recv_off + YMODEM_FAL_ERASE_AHEAD, fctx->blk_size);
+    }
+    return limit > fctx->part->len ? fctx->part->len : limit;
+}
+
+static int _erase_block(struct rym_fal_ctx *fctx)
+{
+    rt_tick_t tick = rt_tick_get();
+
+    if (fal_partition_erase(fctx->part, fctx->erase_off, fctx->blk_size) < 0)
+    {
+        return -RT_EIO;
+    }
+    fctx->erase_off += fctx->blk_size;
+    fctx->erase_ticks += rt_tick_get() - tick;
+    return RT_EOK;
+}
+
+static int _program(struct rym_fal_ctx *fctx, const rt_uint8_t *buf, rt_size_t len)
+{
+    rt_tick_t tick;
+
+    /* the erase ahead fell behind, or this is the synchronous mode */
+    while (fctx->erase_off < fctx->write_off + len)
+    {
+        if (_erase_block(fctx) != RT_EOK)
+        {
+            return -RT_EIO;
+        }
+    }
+
+    tick = rt_tick_get();
+    if (fal_partition_write(fctx->part, fctx->write_off, buf, len) < 0)
+    {
+        return -RT_EIO;
+    }
+    if (fal_partition_read(fctx->part, fctx->write_off, fctx->verify, len) < 0
+        || memcmp(fctx->verify, buf, len) != 0)
+    {
+        return -RT_ERROR;
+    }
+    fctx->write_off += len;
+    fctx->write_ticks += rt_tick_get() - tick;
+    return RT_EOK;
+}
+
+static void _rym_fal_writer(void *parameter)
+{
+    struct rym_fal_ctx *fctx = (struct rym_fal_ctx *)parameter;
+    struct rym_fal_packet *pkt;
+
+    while (1)
+    {
+        if (rt_sem_take(&fctx->full_sem, RT_WAITING_NO) != RT_EOK)
+        {
+            if (fctx->finish)
+            {
+                break;
+            }
+            /* nothing to program, erase the next block while the packets come in */
+            if (fctx->err == RT_EOK && fctx->erase_off < _erase_limit(fctx))
+            {
+                if (_erase_block(fctx) != RT_EOK)
+                {
+                    fctx->err = -RT_EIO;
+                }
+                continue;
+            }
+            rt_sem_take(&fctx->full_sem, RT_WAITING_FOREVER);
+        }
+        if (fctx->finish && fctx->tail == fctx->head)
+        {
+            /* the wake up from _rym_fal_stop() */
+            break;
+        }
+
+        pkt = &fctx->ring[fctx->tail % YMODEM_FAL_RING_PACKETS];
+        if (fctx->err == RT_EOK)
+        {
+            fctx->err = _program(fctx, pkt->data, pkt->len);
+        }
+        fctx->tail++;
+        rt_sem_release(&fctx->free_sem);
+    }
+
+    rt_sem_release(&fctx->exit_sem);
+}
+
+/* wait for the packets in the ring to be programmed and stop the writer */
+static void _rym_fal_stop(struct rym_fal_ctx *fctx)
+{
+    if (fctx->writer == RT_NULL)
+    {
+        return;
+    }
+
+    fctx->finish = RT_TRUE;
+    rt_sem_release(&fctx->full_sem);
+    rt_sem_take(&fctx->exit_sem, RT_WAITING_FOREVER);
+    fctx->writer = RT_NULL;
+    fctx->end = rt_tick_get();
+}
+
+static enum rym_code _rym_fal_begin(
+    struct rym_ctx *ctx,
+    rt_uint8_t *buf,
+    rt_size_t len)
+{
+    struct rym_fal_ctx *fctx = (struct rym_fal_ctx *)ctx;
+
+    /* one image per partition, refuse the next file of a batch */
+    if (fctx->start != 0)
+    {
+        return RYM_CODE_CAN;
+    }
+
+    fctx->flen = atoi(1 + (const char *)buf + rt_strnlen((const char *)buf, len - 1));
+    if (fctx->flen == 0)
+    {
+        fctx->flen = -1;
+    }
+    if (fctx->flen > (rt_int32_t)fctx->part->len)
+    {
+        fctx->err = -RT_EFULL;
+        return RYM_CODE_CAN;
+    }
+
+    fctx->next_seq = 1;
+    fctx->start = rt_tick_get();
+    if (!fctx->sync)
+    {
+        fctx->writer = rt_thread_create("ryfal", _rym_fal_writer, fctx, 2048,
+                                        YMODEM_FAL_THREAD_PRIORITY, 10);
+        if (fctx->writer == RT_NULL)
+        {
+            fctx->err = -RT_ENOMEM;
+            return RYM_CODE_CAN;
+        }
+        rt_thread_startup(fctx->writer);
+    }
+
+    return RYM_CODE_ACK;
+}
+
+static enum rym_code _rym_fal_data(
+    struct rym_ctx *ctx,
+    rt_uint8_t *buf,
+    rt_size_t len)
+{
+    struct rym_fal_ctx *fctx = (struct rym_fal_ctx *)ctx;
+    struct rym_fal_packet *pkt;
+    rt_uint8_t seq = ctx->buf[1];
+    rt_tick_t tick;
+
+    /* the sender repeats a packet when our ACK was lost, ymodem.c passes it on again */
+    if (seq == (rt_uint8_t)(fctx->next_seq - 1))
+    {
+        fctx->dup_packets++;
+        return RYM_CODE_ACK;
+    }
+    if (seq != fctx->next_seq || fctx->err != RT_EOK)
+    {
+        if (fctx->err == RT_EOK)
+        {
+            fctx->err = -RT_ERROR;
+        }
+        return RYM_CODE_CAN;
+    }
+    fctx->next_seq++;
+
+    if (fctx->flen >= 0)
+    {
+        /* strip the padding of the last packet */
+        if (fctx->recv_off + len > (rt_uint32_t)fctx->flen)
+        {
+            len = fctx->flen - fctx->recv_off;
+        }
+    }
+    else if (fctx->recv_off + len > fctx->part->len)
+    {
+        fctx->err = -RT_EFULL;
+        return RYM_CODE_CAN;
+    }
+    if (len == 0)
+    {
+        return RYM_CODE_ACK;
+    }
+    fctx->crc = _crc32_update(fctx->crc, buf, len);
+    fctx->recv_off += len;
+
+    if (fctx->sync)
+    {
+        fctx->err = _program(fctx, buf, len);
+        return fctx->err == RT_EOK ? RYM_CODE_ACK : RYM_CODE_CAN;
+    }
+
+    tick = rt_tick_get();
+    rt_sem_take(&fctx->free_sem, RT_WAITING_FOREVER);
+    fctx->stall_ticks += rt_tick_get() - tick;
+
+    pkt = &fctx->ring[fctx->head % YMODEM_FAL_RING_PACKETS];
+    rt_memcpy(pkt->data, buf, len);
+    pkt->len = len;
+    fctx->head++;
+    rt_sem_release(&fctx->full_sem);
+
+    return RYM_CODE_ACK;
+}
+
+static enum rym_code _rym_fal_end(
+    struct rym_ctx *ctx,
+    rt_uint8_t *buf,
+    rt_size_t len)
+{
+    struct rym_fal_ctx *fctx = (struct rym_fal_ctx *)ctx;
+
+    _rym_fal_stop(fctx);
+    if (fctx->end == 0)
+    {
+        fctx->end = rt_tick_get();
+    }
+
+    return RYM_CODE_ACK;
+}
+
+static void _rym_fal_report(struct rym_fal_ctx *fctx, rt_err_t res)
+{
+    rt_uint32_t ms = (fctx->end - fctx->start) * 1000 / RT_TICK_PER_SECOND;
+
+    if (res != RT_EOK || fctx->err != RT_EOK)
+    {
+        rt_kprintf("ymodem to %s failed, ymodem %d, flash %d, %u bytes programmed\n",
+                   fctx->part->name, res, fctx->err, fctx->write_off);
+        return;
+    }
+    rt_kprintf("%u bytes to %s in %u ms, %u B/s, crc32 0x%08x (%s)\n", fctx->write_off,
+               fctx->part->name, ms, ms ? (rt_uint32_t)((rt_uint64_t)fctx->write_off * 1000 / ms) : 0,
+               fctx->crc, fctx->sync ? "sync" : "erase ahead");
+    rt_kprintf("erase %u ms, program and verify %u ms, receiver stalled %u ms, repeated packets %u\n",
+               fctx->erase_ticks * 1000 / RT_TICK_PER_SECOND, fctx->write_ticks * 1000 / RT_TICK_PER_SECOND,
+               fctx->stall_ticks * 1000 / RT_TICK_PER_SECOND, fctx->dup_packets);
+}
+
+/**
+ * receive a file by YMODEM into a FAL partition.
+ *
+ * @param idev the device of the ymodem line
+ * @param part_name the partition name
+ * @param sync RT_TRUE erases and programs in the ymodem thread, for comparison
+ *
+ * @return RT_EOK on success
+ */
+rt_err_t rym_download_fal(rt_device_t idev, const char *part_name, rt_bool_t sync)
+{
+    struct rym_fal_ctx *ctx;
+    const struct fal_flash_dev *flash;
+    rt_err_t res = -RT_ENOMEM;
+
+    RT_ASSERT(idev);
+
+    ctx = rt_calloc(1, sizeof(*ctx));
+    if (ctx == RT_NULL)
+    {
+        rt_kprintf("rt_malloc failed\n");
+        return -RT_ENOMEM;
+    }
+    ctx->part = fal_partition_find(part_name);
+    flash = ctx->part ? fal_flash_device_find(ctx->part->flash_name) : RT_NULL;
+    if (flash == RT_NULL)
+    {
+        rt_kprintf("partition %s not found.\n", part_name);
+        rt_free(ctx);
+        return -RT_ERROR;
+    }
+    ctx->blk_size = flash->blk_size;
+    ctx->sync = sync;
+
+    ctx->verify = rt_malloc(RYM_FAL_PKG_SZ);
+    if (!sync)
+    {
+        ctx->ring = rt_malloc(sizeof(struct rym_fal_packet) * YMODEM_FAL_RING_PACKETS);
+    }
+    if (ctx->verify == RT_NULL || (!sync && ctx->ring == RT_NULL))
+    {
+        rt_kprintf("rt_malloc failed\n");
+        goto __exit;
+    }
+    rt_sem_init(&ctx->free_sem, "ryfree", YMODEM_FAL_RING_PACKETS, RT_IPC_FLAG_FIFO);
+    rt_sem_init(&ctx->full_sem, "ryfull", 0, RT_IPC_FLAG_FIFO);
+    rt_sem_init(&ctx->exit_sem, "ryexit", 0, RT_IPC_FLAG_FIFO);
+
+    res = rym_recv_on_device(&ctx->parent, idev, RT_DEVICE_OFLAG_RDWR | RT_DEVICE_FLAG_INT_RX,
+                             _rym_fal_begin, _rym_fal_data, _rym_fal_end, 1000);
+    /* on_end is not called when the transfer is aborted */
+    _rym_fal_stop(ctx);
+    _rym_fal_report(ctx, res);
+    if (res == RT_EOK && ctx->err != RT_EOK)
+    {
+        res = ctx->err;
+    }
+
+    rt_sem_detach(&ctx->free_sem);
+    rt_sem_detach(&ctx->full_sem);
+    rt_sem_detach(&ctx->exit_sem);
+__exit:
+    rt_free(ctx->ring);
+    rt_free(ctx->verify);
+    rt_free(ctx);
+
+    return res;
+}
+
+#ifdef RT_USING_FINSH
+#include <finsh.h>
+
+static rt_err_t ry_fal(uint8_t argc, char **argv)
+{
+    rt_device_t dev = RT_NULL;
+    rt_bool_t sync = RT_FALSE;
+    const char *part_name = RT_NULL;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-s"))
+        {
+            sync = RT_TRUE;
+        }
+        else if (part_name == RT_NULL)
+        {
+            part_name = argv[i];
+        }
+        else
+        {
+            dev = rt_device_find(argv[i]);
+            if (!dev)
+            {
+                rt_kprintf("could not find device.\n");
+                return -RT_ERROR;
+            }
+        }
+    }
+    if (part_name == RT_NULL)
+    {
+        rt_kprintf("Usage: ry_fal partition [uart0] [-s]\n");
+        return -RT_ERROR;
+    }
+    if (dev == RT_NULL)
+    {
+        dev = rt_console_get_device();
+    }
+
+    return rym_download_fal(dev, part_name, sync);
+}
+MSH_CMD_EXPORT(ry_fal, YMODEM Receive to a FAL partition e.g: ry_fal download [uart0] [-s synchronous erase]);
+
+#endif /* RT_USING_FINSH */
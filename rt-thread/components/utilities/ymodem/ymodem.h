@@ -9,6 +9,7 @@
  * 2013-04-14     Grissiom     initial implementation
  * 2019-12-09     Steven Liu   add YMODEM send protocol
  * 2022-08-04     Meco Man     move error codes to rym_code to silence warnings
+ * 2025-02-18     RT-Thread    add rym_download_fal
  */
 
 #ifndef __YMODEM_H__
@@ -164,4 +165,10 @@ rt_err_t rym_send_on_device(struct rym_ctx *ctx, rt_device_t dev, rt_uint16_t of
                             rym_callback on_begin, rym_callback on_data, rym_callback on_end,
                             int handshake_timeout);
 
+#ifdef YMODEM_USING_FAL_SINK
+/* recv a file on device dev into the FAL partition part_name, see ry_fal.c.
+ * With sync the flash is erased and programmed in the ymodem thread. */
+rt_err_t rym_download_fal(rt_device_t dev, const char *part_name, rt_bool_t sync);
+#endif
+
 #endif
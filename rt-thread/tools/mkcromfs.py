@@ -0,0 +1,150 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2006-2025, RT-Thread Development Team
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Change Logs:
+# Date           Author       Notes
+# 2025-02-25     RT-Thread    first version
+#
+# Pack a directory into a cromfs image (DFS v2 "crom") for a flash partition.
+#
+# Regular files are split into blocks compressed one by one, so a read only
+# inflates the blocks it touches and the file system can cache them. A block
+# that does not get smaller is stored as is. The footprint of each file and
+# of the whole image is printed next to the size the files take uncompressed.
+#
+# On the board the image goes into the "assets" partition of board/port/fal_cfg.h,
+# 8 MB at offset 0x1800000 of the XSPI2 NOR, after the 8 MB firmware image:
+#   python mkcromfs.py assets/ assets.img --partition-size 0x800000
+# then program assets.img at 0x71800000 (the memory-mapped address) with the
+# external loader, or send it with "ry_fal assets" over YMODEM.
+
+import sys
+import os
+import struct
+import zlib
+
+import argparse
+parser = argparse.ArgumentParser()
+parser.add_argument('rootdir', type=str, help='the path to the assets')
+parser.add_argument('output', type=argparse.FileType('wb'), help='output image file name')
+parser.add_argument('--block-size', type=int, default=4096,
+                    help='uncompressed block size, a power of 2 from 512 to 32768, default to 4096.')
+parser.add_argument('--level', type=int, default=9, help='zlib compression level, default to 9.')
+parser.add_argument('--partition-size', default='0',
+                    help='fail if the image does not fit in the partition, e.g. 0x800000.')
+parser.add_argument('--quiet', action='store_true', help='only print the totals')
+
+CROMFS_MAGIC = b'CROMFSMG'
+CROMFS_VERSION = 1
+CROMFS_HEAD_SIZE = 256
+CROMFS_ALIGN = 16
+CROMFS_PART_ATTR_BLOCKS = 0x1
+
+ATTR_FILE = 0
+ATTR_DIR = 1
+ATTR_SYMLINK = 2
+
+def align(size):
+    return (size + CROMFS_ALIGN - 1) & ~(CROMFS_ALIGN - 1)
+
+class Image(object):
+    def __init__(self, block_shift, level):
+        self._data = bytearray(CROMFS_HEAD_SIZE)
+        self.block_shift = block_shift
+        self.level = level
+        self.files = []
+
+    def append(self, data):
+        '''Place data at the end of the image, every object gets its own position.'''
+        pos = len(self._data)
+        self._data += data
+        self._data += b'\0' * (align(max(len(data), 1)) - len(data))
+        return pos
+
+    def pack_blocks(self, data):
+        bs = 1 << self.block_shift
+        blocks = []
+        for i in range(0, len(data), bs):
+            raw = data[i:i + bs]
+            c = zlib.compressobj(self.level, zlib.DEFLATED, self.block_shift)
+            z = c.compress(raw) + c.flush()
+            # the driver tells a stored block by its size
+            blocks.append(z if len(z) < len(raw) else raw)
+
+        table = b''
+        end = 0
+        for b in blocks:
+            end += len(b)
+            table += struct.pack('<I', end)
+        return table + b''.join(blocks)
+
+    def add_file(self, path, name):
+        data = open(path, 'rb').read()
+        packed = self.pack_blocks(data)
+        self.files.append((name, len(data), len(packed)))
+        return (ATTR_FILE, self.append(packed), len(packed), len(data))
+
+    def add_symlink(self, path, name):
+        target = os.readlink(path).encode()
+        packed = zlib.compress(target, self.level)
+        return (ATTR_SYMLINK, self.append(packed), len(packed), len(target))
+
+    def add_dir(self, path, prefix):
+        dirents = b''
+        for name in sorted(os.listdir(path)):
+            full = os.path.join(path, name)
+            rel = prefix + '/' + name
+            if os.path.islink(full):
+                attr, pos, size, osize = self.add_symlink(full, rel)
+            elif os.path.isdir(full):
+                attr, pos, size, osize = self.add_dir(full, rel)
+            elif os.path.isfile(full):
+                attr, pos, size, osize = self.add_file(full, rel)
+            else:
+                continue
+            bname = name.encode()
+            dirents += struct.pack('<HHIII', attr, len(bname), size, osize, pos)
+            dirents += bname + b'\0' * (align(len(bname)) - len(bname))
+        return (ATTR_DIR, self.append(dirents), len(dirents), 0)
+
+    def build(self, rootdir):
+        attr, pos, size, osize = self.add_dir(rootdir, '')
+        head = struct.pack('<8sIIIII', CROMFS_MAGIC, CROMFS_VERSION,
+                           CROMFS_PART_ATTR_BLOCKS | (self.block_shift << 8),
+                           len(self._data), pos, size)
+        self._data[0:len(head)] = head
+        return bytes(self._data)
+
+def ratio(part, whole):
+    return 100.0 * part / whole if whole else 100.0
+
+if __name__ == '__main__':
+    args = parser.parse_args()
+
+    block_shift = args.block_size.bit_length() - 1
+    if args.block_size != (1 << block_shift) or block_shift < 9 or block_shift > 15:
+        print('block size must be a power of 2 from 512 to 32768')
+        sys.exit(-1)
+
+    image = Image(block_shift, args.level)
+    data = image.build(args.rootdir)
+
+    raw = 0
+    if not args.quiet:
+        print('%10s %10s %6s  %s' % ('original', 'packed', 'ratio', 'file'))
+    for name, osize, size in image.files:
+        raw += osize
+        if not args.quiet:
+            print('%10d %10d %5.1f%%  %s' % (osize, size, ratio(size, osize), name))
+    print('%d files, %d bytes uncompressed, image %d bytes (%.1f%%), %d bytes saved, %d byte blocks'
+          % (len(image.files), raw, len(data), ratio(len(data), raw), raw - len(data), args.block_size))
+
+    part_size = int(args.partition_size, 0)
+    if part_size and len(data) > part_size:
+        print('image does not fit in the %d byte partition' % part_size)
+        sys.exit(-1)
+
+    args.output.write(data)
@@ -46,6 +46,7 @@
 #define RT_USING_HEAP
 /* end of Memory Management */
 #define RT_USING_DEVICE
+#define RT_USING_DEVICE_OPS
 #define RT_USING_CONSOLE
 #define RT_CONSOLEBUF_SIZE 128
 #define RT_CONSOLE_DEVICE_NAME "uart4"
@@ -85,9 +86,7 @@
 #define DFS_USING_POSIX
 #define DFS_USING_WORKDIR
 #define DFS_FD_MAX 16
-#define RT_USING_DFS_V1
-#define DFS_FILESYSTEMS_MAX 4
-#define DFS_FILESYSTEM_TYPES_MAX 4
+#define RT_USING_DFS_V2
 #define RT_USING_DFS_ELMFAT
 
 /* elm-chan's FatFs, Generic FAT Filesystem Module */
@@ -106,11 +105,29 @@
 /* end of elm-chan's FatFs, Generic FAT Filesystem Module */
 #define RT_USING_DFS_DEVFS
 #define RT_USING_DFS_ROMFS
+#define RT_USING_DFS_CROMFS
+#define RT_DFS_CROMFS_CACHE_BLOCKS 16
+#define RT_USING_PAGECACHE
+
+/* page cache config */
+
+#define RT_PAGECACHE_PAGE_SIZE 4096
+#define RT_PAGECACHE_HEAP_PERCENT 25
+#define RT_PAGECACHE_COUNT 2048
+#define RT_PAGECACHE_ASPACE_COUNT 512
+#define RT_PAGECACHE_PRELOAD 4
+#define RT_PAGECACHE_HASH_NR 256
+#define RT_PAGECACHE_GC_WORK_LEVEL 90
+#define RT_PAGECACHE_GC_STOP_LEVEL 70
+/* end of page cache config */
 /* end of DFS: device virtual file system */
 #define RT_USING_FAL
 #define FAL_DEBUG_CONFIG
 #define FAL_DEBUG 1
 #define FAL_PART_HAS_TABLE_CFG
+#define FAL_USING_WRITE_BUFFER
+#define FAL_WBUF_PAGE_SIZE 256
+#define FAL_WBUF_ERASE_THREAD_PRIORITY 25
 
 /* Device Drivers */
 
@@ -133,6 +150,26 @@
 #define RT_SFUD_USING_SFDP
 #define RT_SFUD_USING_FLASH_INFO_TABLE
 #define RT_SFUD_SPI_MAX_HZ 50000000
+#define RT_USING_AUDIO
+#define RT_AUDIO_REPLAY_MP_BLOCK_SIZE 512
+#define RT_AUDIO_REPLAY_MP_BLOCK_COUNT 2
+#define RT_AUDIO_RECORD_PIPE_SIZE 16384
+#define RT_AUDIO_RECORD_PIPE_BLOCK_SIZE 2048
+#define RT_USING_HWCRYPTO
+#define RT_HWCRYPTO_DEFAULT_NAME "hwcryto"
+#define RT_HWCRYPTO_IV_MAX_SIZE 16
+#define RT_HWCRYPTO_KEYBIT_MAX_SIZE 256
+#define RT_HWCRYPTO_USING_AES
+#define RT_HWCRYPTO_USING_AES_ECB
+#define RT_HWCRYPTO_USING_AES_CBC
+#define RT_HWCRYPTO_USING_AES_CTR
+#define RT_HWCRYPTO_USING_SHA1
+#define RT_HWCRYPTO_USING_SHA2
+#define RT_HWCRYPTO_USING_SHA2_224
+#define RT_HWCRYPTO_USING_SHA2_256
+#define RT_HWCRYPTO_USING_SHA2_384
+#define RT_HWCRYPTO_USING_SHA2_512
+#define RT_HWCRYPTO_USING_RNG
 #define RT_USING_WIFI
 #define RT_WLAN_DEVICE_STA_NAME "wlan0"
 #define RT_WLAN_DEVICE_AP_NAME "wlan1"
@@ -145,6 +182,7 @@
 #define RT_WLAN_SCAN_SORT
 #define RT_WLAN_MSH_CMD_ENABLE
 #define RT_WLAN_JOIN_SCAN_BY_MGNT
+#define RT_WLAN_JOIN_FAST_CACHE
 #define RT_WLAN_AUTO_CONNECT_ENABLE
 #define AUTO_CONNECTION_PERIOD_MS 2000
 #define RT_WLAN_CFG_ENABLE
@@ -155,6 +193,7 @@
 #define RT_WLAN_DEFAULT_PROT "lwip"
 #define RT_WLAN_PROT_LWIP_ENABLE
 #define RT_WLAN_PROT_LWIP_NAME "lwip"
+#define RT_WLAN_PROT_LWIP_SG_MAX 8
 #define RT_WLAN_WORK_THREAD_ENABLE
 #define RT_WLAN_WORKQUEUE_THREAD_NAME "wlan"
 #define RT_WLAN_WORKQUEUE_THREAD_SIZE 2048
@@ -185,6 +224,7 @@
 #define RT_USING_POSIX_POLL
 #define RT_USING_POSIX_SELECT
 #define RT_USING_POSIX_SOCKET
+#define RT_USING_POSIX_MMAN
 
 /* Interprocess Communication (IPC) */
 
@@ -203,6 +243,7 @@
 /* Docking with protocol stacks */
 
 #define SAL_USING_LWIP
+#define SAL_USING_TLS
 /* end of Docking with protocol stacks */
 #define SAL_USING_POSIX
 #define RT_USING_NETDEV
@@ -264,6 +305,11 @@
 
 /* Utilities */
 
+#define RT_USING_ADT
+#define RT_USING_ADT_AVL
+#define RT_USING_ADT_BITMAP
+#define RT_USING_ADT_HASHMAP
+#define RT_USING_ADT_REF
 /* end of Utilities */
 /* end of RT-Thread Components */
 
@@ -364,6 +410,14 @@
 
 /* security packages */
 
+#define PKG_USING_MBEDTLS
+#define PKG_USING_MBEDTLS_DIGICERT_ROOT_CA
+#define PKG_USING_MBEDTLS_GLOBALSIGN_ROOT_CA
+#define MBEDTLS_ECP_WINDOW_SIZE 2
+#define MBEDTLS_SSL_MAX_CONTENT_LEN 6144
+#define MBEDTLS_MPI_MAX_SIZE 1024
+#define MBEDTLS_CTR_DRBG_KEYSIZE 32
+#define PKG_USING_MBEDTLS_V2281
 /* end of security packages */
 
 /* language packages */
@@ -409,6 +463,16 @@
 /* Micrium: Micrium software products porting for RT-Thread */
 
 /* end of Micrium: Micrium software products porting for RT-Thread */
+#define PKG_USING_LITTLEFS
+#define PKG_USING_LITTLEFS_LATEST_VERSION
+#define LFS_READ_SIZE 16
+#define LFS_PROG_SIZE 256
+#define LFS_BLOCK_SIZE 4096
+#define LFS_CACHE_SIZE 1024
+#define LFS_BLOCK_CYCLES 500
+#define LFS_THREADSAFE
+#define LFS_LOOKAHEAD_MAX 384
+#define PKG_LITTLEFS_VER_NUM 0x99999
 /* end of system packages */
 
 /* peripheral libraries and drivers */
@@ -479,6 +543,9 @@
 
 /* miscellaneous packages */
 
+#define PKG_USING_ZLIB
+#define PKG_USING_ZLIB_LATEST_VERSION
+
 /* project laboratory */
 
 /* end of project laboratory */
@@ -548,8 +615,15 @@
 #define BSP_SCB_ENABLE_I_CACHE
 #define BSP_SCB_ENABLE_D_CACHE
 #define BSP_USING_USB_TO_USART
+#define BSP_USING_XSPI_NORFLASH
+#define BSP_USING_XSPI_NOR_RWW
+#define BSP_XSPI_NOR_RWW_W35T51NW
+#define BSP_XSPI_NOR_RWW_SLICE_US 500
+#define BSP_XSPI_NOR_RWW_IRQ_PRIORITY 0
 #define BSP_USING_FS
 #define BSP_USING_SDCARD_FS
+#define BSP_USING_SPI_FLASH_FS
+#define BSP_USING_CROMFS_ASSETS
 /* end of Onboard Peripheral Drivers */
 
 /* On-chip Peripheral */
@@ -562,6 +636,11 @@
 #define BSP_USING_SDIO
 #define BSP_USING_SDIO1
 #define BSP_USING_SDIO2
+#define BSP_USING_HWCRYPTO
+#define BSP_USING_CRYP
+#define BSP_USING_HASH
+#define BSP_USING_RNG
+#define BSP_USING_MBEDTLS_HW_ALT
 /* end of On-chip Peripheral */
 /* end of Hardware Drivers Config */
 